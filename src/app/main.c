@@ -11,6 +11,10 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+/* C's standard libraries. */
+#include <inttypes.h>
+#include <string.h>
+
 /* This is ESP-IDF's event library.
  * It is used by several components to publish internal state information to
  * other components as needed.
@@ -29,6 +33,16 @@
  */
 #include "esp_log.h"
 
+/* This is ESP-IDF's system library.
+ * - provides the free heap (``esp_get_free_heap_size()``)
+ */
+#include "esp_system.h"
+
+/* This is ESP-IDF's high resolution timer library.
+ * - provides the uptime (``esp_timer_get_time()``)
+ */
+#include "esp_timer.h"
+
 /* This is ESP-IDF's library to interface the non-volatile storage (NVS). */
 #include "nvs_flash.h"
 
@@ -38,6 +52,15 @@
 /* Project-specific library to manage wifi connections. */
 #include "mnet32/mnet32.h"
 
+/* Project-specific web interface of ``mnet32``. */
+#include "mnet32_web/mnet32_web.h"
+
+/* Project-specific library to measure the network link. */
+#include "net_diag/net_diag.h"
+
+/* Project-specific metrics registry. */
+#include "obs32/obs32_metrics.h"
+
 /**
  * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
  *
@@ -45,11 +68,235 @@
  */
 static const char* TAG = "krachkiste.main";
 
+/**
+ * The interval to publish telemetry with ``min_httpd``'s WebSocket push
+ * channel and Server-Sent Events stream, given in milliseconds.
+ */
+#define APP_TELEMETRY_INTERVAL 2000
+
+/**
+ * The interval to log the free heap, given in milliseconds.
+ */
+#define APP_HEAP_LOG_INTERVAL 10000
+
+/**
+ * The maximum length of a telemetry message.
+ */
+#define APP_TELEMETRY_LEN 256
+
+/**
+ * The telemetry messages, that were broadcast with the WebSocket push channel.
+ */
+static struct obs32_metric_counter app_metrics_telemetry_ws = {0};
+
+/**
+ * The telemetry messages, that were published with the Server-Sent Events
+ * stream.
+ */
+static struct obs32_metric_counter app_metrics_telemetry_sse = {0};
+
+/**
+ * Read the free heap.
+ *
+ * @return int64_t The free heap in bytes.
+ */
+static int64_t app_metrics_read_heap(void) {
+    return esp_get_free_heap_size();
+}
+
+/**
+ * Read the minimum of the free heap since the start.
+ *
+ * @return int64_t The minimum free heap in bytes.
+ */
+static int64_t app_metrics_read_heap_min(void) {
+    return esp_get_minimum_free_heap_size();
+}
+
+/**
+ * Read the time since the start.
+ *
+ * @return int64_t The uptime in seconds.
+ */
+static int64_t app_metrics_read_uptime(void) {
+    return esp_timer_get_time() / 1000000;
+}
+
+/**
+ * The metrics of the application, provided with the other components' metrics.
+ */
+static const struct obs32_metric app_metrics_table[] = {
+    {.name = "app_heap_free_bytes",
+     .help = "The free heap.",
+     .type = OBS32_METRIC_GAUGE,
+     .read = app_metrics_read_heap},
+    {.name = "app_heap_min_free_bytes",
+     .help = "The minimum of the free heap since the start.",
+     .type = OBS32_METRIC_GAUGE,
+     .read = app_metrics_read_heap_min},
+    {.name = "app_uptime_seconds",
+     .help = "The time since the start.",
+     .type = OBS32_METRIC_COUNTER,
+     .read = app_metrics_read_uptime},
+    {.name = "app_telemetry_published_total",
+     .help = "Telemetry messages by their channel.",
+     .labels = "channel=\"ws\"",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &app_metrics_telemetry_ws},
+    {.name = "app_telemetry_published_total",
+     .labels = "channel=\"sse\"",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &app_metrics_telemetry_sse},
+};
+
+/**
+ * The group of ::app_metrics_table .
+ */
+static struct obs32_metrics_group app_metrics_group = {
+    .metrics = app_metrics_table,
+    .count = sizeof(app_metrics_table) / sizeof(app_metrics_table[0]),
+};
+
+/**
+ * Hold ``mnet32``'s interactive power save lock while http sessions are open.
+ *
+ * This handler is registered for ``MIN_HTTPD_SESSIONS_CHANGED``, which
+ * provides the current number of open sessions.
+ *
+ * @param arg        Generic arguments.
+ * @param event_base ``esp_event``'s ``EVENT_BASE``.
+ * @param event_id   ``esp_event``'s ``EVENT_ID``.
+ * @param event_data The number of open sessions (``int``).
+ */
+static void app_httpd_sessions_handler(void* arg,
+                                       esp_event_base_t event_base,
+                                       int32_t event_id,
+                                       void* event_data) {
+    static bool locked = false;
+    bool active = *((int*)event_data) > 0;
+
+    if (active == locked)
+        return;
+
+    if (active)
+        mnet32_ps_lock_acquire(MNET32_PS_LOCK_INTERACTIVE);
+    else
+        mnet32_ps_lock_release(MNET32_PS_LOCK_INTERACTIVE);
+    locked = active;
+}
+
+/**
+ * Log the progress of a firmware upload.
+ *
+ * This handler is registered for ``MIN_HTTPD_OTA_PROGRESS``. The upload
+ * occupies ``min_httpd``'s task, so the progress can not be published with
+ * the server's push channels.
+ *
+ * @param arg        Generic arguments.
+ * @param event_base ``esp_event``'s ``EVENT_BASE``.
+ * @param event_id   ``esp_event``'s ``EVENT_ID``.
+ * @param event_data The progress (``struct min_httpd_ota_progress``).
+ */
+static void app_ota_progress_handler(void* arg,
+                                     esp_event_base_t event_base,
+                                     int32_t event_id,
+                                     void* event_data) {
+    const struct min_httpd_ota_progress* progress = event_data;
+
+    ESP_LOGI(TAG,
+             "Firmware upload: %" PRIu32 "/%" PRIu32 " bytes (%" PRIu32
+             " bytes/s)",
+             progress->received,
+             progress->total,
+             progress->rate);
+}
+
+/**
+ * Publish the network's events with ``min_httpd``'s Server-Sent Events stream.
+ *
+ * The event's data is a JSON document, e.g. ``{"event":"ready"}``. As every
+ * event is published with the name ``network``, clients receive the most
+ * recent one, if they can not keep up.
+ *
+ * ``MNET32_EVENT_UNAVAILABLE`` stops ``min_httpd`` before this handler is
+ * called, so it is only published, if the server is still running.
+ *
+ * @param arg        Generic arguments.
+ * @param event_base ``esp_event``'s ``EVENT_BASE``.
+ * @param event_id   ``esp_event``'s ``EVENT_ID``.
+ * @param event_data Unused.
+ */
+static void app_network_event_handler(void* arg,
+                                      esp_event_base_t event_base,
+                                      int32_t event_id,
+                                      void* event_data) {
+    const char* data = (event_id == MNET32_EVENT_READY)
+                           ? "{\"event\":\"ready\"}"
+                           : "{\"event\":\"unavailable\"}";
+
+    esp_err_t ret = min_httpd_sse_publish("network", data, strlen(data));
+    if ((ret != ESP_OK) && (ret != ESP_ERR_INVALID_STATE))
+        ESP_LOGD(TAG, "Could not publish event: %s", esp_err_to_name(ret));
+}
+
+/**
+ * Publish the heap and the network's status to the subscribers of
+ * ``min_httpd``'s WebSocket push channel and as ``status`` event of its
+ * Server-Sent Events stream.
+ *
+ * The message is a JSON document, e.g.
+ * ``{"heap":151204,"heap_min":140112,"net":{"connected":true,"rssi":-61,
+ * "rssi_avg":-63,"rssi_history":[-64,-62,-61],"roam_scans":2,"roams":0}}``,
+ * written with ``min_httpd``'s JSON writer.
+ *
+ * The event is published without clients, too, so new clients receive the
+ * most recent status immediately.
+ */
+static void app_telemetry_publish(void) {
+    struct mnet32_status_snapshot status;
+    mnet32_get_status_snapshot(&status);
+
+    char buf[APP_TELEMETRY_LEN];
+    struct min_httpd_json json;
+    min_httpd_json_init(&json, buf, sizeof(buf), NULL, NULL);
+    min_httpd_json_object_begin(&json);
+    min_httpd_json_heap(&json);
+    min_httpd_json_key(&json, "net");
+    mnet32_status_snapshot_json(&json, &status);
+    min_httpd_json_object_end(&json);
+    if (!min_httpd_json_finish(&json))
+        return;
+    size_t len = json.len;
+
+    esp_err_t ret = ESP_OK;
+    if (min_httpd_ws_get_subscribers() > 0) {
+        ret = min_httpd_ws_broadcast(buf, len);
+        if (ret == ESP_OK)
+            obs32_metrics_inc(&app_metrics_telemetry_ws);
+    }
+    if ((ret != ESP_OK) && (ret != ESP_ERR_INVALID_STATE))
+        ESP_LOGD(TAG, "Could not publish telemetry: %s", esp_err_to_name(ret));
+
+    ret = min_httpd_sse_publish("status", buf, len);
+    if (ret == ESP_OK)
+        obs32_metrics_inc(&app_metrics_telemetry_sse);
+    if ((ret != ESP_OK) && (ret != ESP_ERR_INVALID_STATE) &&
+        (ret != ESP_ERR_NOT_SUPPORTED))
+        ESP_LOGD(TAG, "Could not publish status: %s", esp_err_to_name(ret));
+}
+
 // grabbed this from https://github.com/tonyp7/esp32-wifi-manager/blob/master/examples/default_demo/main/user_main.c
 void monitoring_task(void* pvParameter) {
+    uint32_t elapsed = 0;
+
     for (;;) {
-        ESP_LOGI(TAG, "free heap: %d", esp_get_free_heap_size());
-        vTaskDelay(pdMS_TO_TICKS(10000));
+        if (elapsed == 0)
+            ESP_LOGI(TAG, "free heap: %d", esp_get_free_heap_size());
+
+        app_telemetry_publish();
+
+        vTaskDelay(pdMS_TO_TICKS(APP_TELEMETRY_INTERVAL));
+        elapsed = (elapsed + APP_TELEMETRY_INTERVAL) % APP_HEAP_LOG_INTERVAL;
     }
 }
 
@@ -78,32 +325,43 @@ void app_main(void) {  // cppcheck-suppress unusedFunction
     }
     ESP_ERROR_CHECK(ret);
 
+    // Provide the heap and the telemetry with the other components' metrics
+    obs32_metrics_register(&app_metrics_group);
+
     // grabbed this from https://github.com/tonyp7/esp32-wifi-manager/blob/master/examples/default_demo/main/user_main.c
     /* your code should go here. Here we simply create a task on core 2 that
-     * monitors free heap memory
+     * monitors free heap memory and publishes telemetry
      */
     xTaskCreatePinnedToCore(&monitoring_task,
                             "monitoring_task",
-                            2048,
+                            3072,
                             NULL,
                             1,
                             NULL,
                             1);
 
     // Start ``min_httpd`` as soon as the network becomes ready!
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(
-        MNET32_EVENTS,
-        MNET32_EVENT_READY,
-        &min_httpd_external_event_handler_start,
-        NULL,
-        NULL));
+    // ``mnet32`` might use a dedicated event loop, so its specific function
+    // to register handlers is used.
+    ESP_ERROR_CHECK(
+        mnet32_event_handler_register(MNET32_EVENT_READY,
+                                      &min_httpd_external_event_handler_start,
+                                      NULL,
+                                      NULL));
     // Stop ``min_httpd`` when the network link goes down!
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(
-        MNET32_EVENTS,
-        MNET32_EVENT_UNAVAILABLE,
-        &min_httpd_external_event_handler_stop,
-        NULL,
-        NULL));
+    ESP_ERROR_CHECK(
+        mnet32_event_handler_register(MNET32_EVENT_UNAVAILABLE,
+                                      &min_httpd_external_event_handler_stop,
+                                      NULL,
+                                      NULL));
+    // Publish the network's events with ``min_httpd``'s Server-Sent Events
+    // stream. This is registered after ``min_httpd``'s handlers, so the
+    // server is already running with ``MNET32_EVENT_READY``.
+    ESP_ERROR_CHECK(
+        mnet32_event_handler_register(ESP_EVENT_ANY_ID,
+                                      &app_network_event_handler,
+                                      NULL,
+                                      NULL));
     // Register *URI handlers* of ``mnet32`` component when ``min_httpd`` is
     // ready!
     ESP_ERROR_CHECK(
@@ -112,6 +370,50 @@ void app_main(void) {  // cppcheck-suppress unusedFunction
                                             &mnet32_web_attach_handlers,
                                             NULL,
                                             NULL));
+#if MNET32_WIFI_AP_DNS_ENABLED
+    // ``mnet32`` directs the stations of its access point to ``min_httpd``,
+    // which redirects their connectivity checks to the configuration page.
+    min_httpd_captive_portal_set_target(MNET32_WEB_URL_CONFIG);
+#endif
+
+    // Reduce WiFi power saving, while the web interface is in use.
+    ESP_ERROR_CHECK(
+        esp_event_handler_instance_register(MIN_HTTPD_EVENTS,
+                                            MIN_HTTPD_SESSIONS_CHANGED,
+                                            &app_httpd_sessions_handler,
+                                            NULL,
+                                            NULL));
+
+#if MIN_HTTPD_OTA_ENABLED
+    // Follow firmware uploads in the log.
+    ESP_ERROR_CHECK(
+        esp_event_handler_instance_register(MIN_HTTPD_EVENTS,
+                                            MIN_HTTPD_OTA_PROGRESS,
+                                            &app_ota_progress_handler,
+                                            NULL,
+                                            NULL));
+#endif
+
+#if NET_DIAG_ENABLED
+    // Start the throughput tests of ``net_diag`` with the network, just like
+    // ``min_httpd``, and provide its results with the web interface.
+    ESP_ERROR_CHECK(
+        mnet32_event_handler_register(MNET32_EVENT_READY,
+                                      &net_diag_external_event_handler_start,
+                                      NULL,
+                                      NULL));
+    ESP_ERROR_CHECK(
+        mnet32_event_handler_register(MNET32_EVENT_UNAVAILABLE,
+                                      &net_diag_external_event_handler_stop,
+                                      NULL,
+                                      NULL));
+    ESP_ERROR_CHECK(
+        esp_event_handler_instance_register(MIN_HTTPD_EVENTS,
+                                            MIN_HTTPD_READY,
+                                            &net_diag_web_attach_handlers,
+                                            NULL,
+                                            NULL));
+#endif
 
     mnet32_start();
 }
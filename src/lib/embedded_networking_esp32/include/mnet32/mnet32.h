@@ -5,6 +5,10 @@
 #ifndef SRC_LIB_EMBEDDED_NETWORKING_ESP32_INCLUDE_MNET32_MNET32_H_
 #define SRC_LIB_EMBEDDED_NETWORKING_ESP32_INCLUDE_MNET32_MNET32_H_
 
+/* C's standard libraries. */
+#include <stddef.h>
+#include <stdint.h>
+
 /* This is ESP-IDF's error handling library.
  * - defines ``esp_err_t``
  */
@@ -15,6 +19,7 @@
 
 /* ESP-IDF's wifi library
  * - defines constants used for MNET32_WIFI_STA_THRESHOLD_AUTH
+ * - defines ``wifi_ps_type_t`` used for MNET32_WIFI_PS_IDLE
  */
 #include "esp_wifi.h"
 
@@ -34,6 +39,143 @@
  */
 #define MNET32_NVS_NAMESPACE CONFIG_MNET32_NVS_NAMESPACE
 
+/**
+ * Flag to indicate if the component's events are posted to a dedicated event
+ * loop.
+ *
+ * By default, the component's events are posted to **ESP-IDF**'s default
+ * event loop. If enabled, the component creates a dedicated event loop with
+ * its own task (see ::MNET32_EVENT_LOOP_QUEUE_SIZE and
+ * ::MNET32_EVENT_LOOP_TASK_PRIORITY ).
+ *
+ * Handlers for ``MNET32_EVENTS`` must be registered with
+ * ::mnet32_event_handler_register to work with both settings.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MNET32_EVENT_LOOP_DEDICATED
+#define MNET32_EVENT_LOOP_DEDICATED 1
+#else
+#define MNET32_EVENT_LOOP_DEDICATED 0
+#endif
+
+#if MNET32_EVENT_LOOP_DEDICATED
+/**
+ * The queue size of the dedicated event loop.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_EVENT_LOOP_QUEUE_SIZE CONFIG_MNET32_EVENT_LOOP_QUEUE_SIZE
+
+/**
+ * The **freeRTOS**-specific priority for the dedicated event loop's task.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_EVENT_LOOP_TASK_PRIORITY CONFIG_MNET32_EVENT_LOOP_TASK_PRIORITY
+#else
+#define MNET32_EVENT_LOOP_QUEUE_SIZE 0
+#define MNET32_EVENT_LOOP_TASK_PRIORITY 0
+#endif  // MNET32_EVENT_LOOP_DEDICATED
+
+/**
+ * The stack size of the dedicated event loop's task.
+ *
+ * The handlers of ``MNET32_EVENTS`` are executed in this task, so the value
+ * depends on the registered handlers.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``mnet32.h``.
+ */
+#define MNET32_EVENT_LOOP_TASK_STACK_SIZE 3072
+
+/**
+ * Maximum time to wait while posting an event to a full event loop.
+ *
+ * The value is given in milliseconds.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_EVENT_POST_TIMEOUT CONFIG_MNET32_EVENT_POST_TIMEOUT
+
+/**
+ * Flag to indicate if the component should use Ethernet.
+ *
+ * If enabled, an established Ethernet link is preferred over WiFi. WiFi is
+ * started as fallback, if there is no link or the link goes down.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MNET32_ETH_ENABLED
+#define MNET32_ETH_ENABLED 1
+#else
+#define MNET32_ETH_ENABLED 0
+#endif
+
+#if MNET32_ETH_ENABLED
+/**
+ * Timespan to wait for the handover between Ethernet and WiFi.
+ *
+ * During startup, this is the time to wait for an Ethernet link, before WiFi
+ * is started. If an established Ethernet link goes down, WiFi is started
+ * immediatly and ``MNET32_EVENT_UNAVAILABLE`` is only emitted, if WiFi did not
+ * become ready within this timespan.
+ *
+ * The value is given in milliseconds.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_ETH_HANDOVER_TIMEOUT CONFIG_MNET32_ETH_HANDOVER_TIMEOUT
+
+/**
+ * The GPIO for the SMI's clock (MDC).
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_ETH_MDC_GPIO CONFIG_MNET32_ETH_MDC_GPIO
+
+/**
+ * The GPIO for the SMI's data (MDIO).
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_ETH_MDIO_GPIO CONFIG_MNET32_ETH_MDIO_GPIO
+
+/**
+ * The address of the PHY on the SMI bus.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_ETH_PHY_ADDR CONFIG_MNET32_ETH_PHY_ADDR
+
+/**
+ * The GPIO connected to the PHY's reset pin (``-1`` if not connected).
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_ETH_PHY_RST_GPIO CONFIG_MNET32_ETH_PHY_RST_GPIO
+#endif  // MNET32_ETH_ENABLED
+
+/**
+ * The number of names in the cache of ::mnet32_resolve .
+ *
+ * Every name requires about 100 bytes of memory.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_RESOLVER_CACHE_SIZE CONFIG_MNET32_RESOLVER_CACHE_SIZE
+
 /**
  * The **freeRTOS**-specific priority for the component's task.
  *
@@ -61,12 +203,14 @@
 #define MNET32_TASK_MONITOR_FREQUENCY CONFIG_MNET32_TASK_MONITOR_FREQUENCY
 
 /**
- * The URI to serve the component's web interface from.
+ * The size of a complete dump of the state machine's trace.
  *
- * This is part of the component's configuration and can be adjusted using
- * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ * The dump consists of a header of 12 bytes, followed by the 64 most recent
+ * transitions of 8 bytes each (see ::mnet32_trace_dump ).
+ *
+ * This is determined by the format of the dump and can not be adjusted.
  */
-#define MNET32_WEB_URL_CONFIG CONFIG_MNET32_WEB_URL_CONFIG
+#define MNET32_TRACE_DUMP_LEN (12 + (64 * 8))
 
 /**
  * The channel to be used while providing the project-specific access point.
@@ -76,6 +220,42 @@
  */
 #define MNET32_WIFI_AP_CHANNEL CONFIG_MNET32_WIFI_AP_CHANNEL
 
+/**
+ * Flag to indicate if the component should answer DNS queries in access point
+ * mode.
+ *
+ * If enabled, every query for an address is answered with the access point's
+ * own address (*captive portal*), so clients are directed to the configuration
+ * interface (see ``mnet32_web``) and detect the portal without waiting for
+ * timeouts.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MNET32_WIFI_AP_DNS_ENABLED
+#define MNET32_WIFI_AP_DNS_ENABLED 1
+#else
+#define MNET32_WIFI_AP_DNS_ENABLED 0
+#endif
+
+/**
+ * The **freeRTOS**-specific priority for the task of the DNS responder.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``mnet32.h``.
+ */
+#define MNET32_WIFI_AP_DNS_TASK_PRIORITY 5
+
+/**
+ * The stack size of the DNS responder's task.
+ *
+ * The task holds the buffer of the DNS message (512 bytes) on its stack.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``mnet32.h``.
+ */
+#define MNET32_WIFI_AP_DNS_TASK_STACK_SIZE 2560
+
 /**
  * The maximum number of allowed clients while providing the project-specific
  * access point.
@@ -115,6 +295,107 @@
  */
 #define MNET32_WIFI_AP_SSID CONFIG_MNET32_WIFI_AP_SSID
 
+/**
+ * The power save mode of station mode, while no ::mnet32_ps_lock is held.
+ *
+ * This is either ``WIFI_PS_MAX_MODEM`` (the default) or ``WIFI_PS_MIN_MODEM``.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MNET32_WIFI_PS_IDLE_MIN_MODEM
+#define MNET32_WIFI_PS_IDLE WIFI_PS_MIN_MODEM
+#else
+#define MNET32_WIFI_PS_IDLE WIFI_PS_MAX_MODEM
+#endif
+
+/**
+ * Timespan to wait before a power save mode with *more* power saving is
+ * applied.
+ *
+ * Modes with *less* power saving are applied immediately. The value is given
+ * in milliseconds.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_WIFI_PS_HOLDOFF CONFIG_MNET32_WIFI_PS_HOLDOFF
+
+/**
+ * Flag to indicate if the component should roam to a stronger access point.
+ *
+ * If enabled, the component looks for a stronger access point (BSSID) of the
+ * same network, if the signal strength drops below
+ * ::MNET32_WIFI_ROAM_RSSI_THRESHOLD , and reconnects to it *before* the
+ * connection is lost.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MNET32_WIFI_ROAM_ENABLED
+#define MNET32_WIFI_ROAM_ENABLED 1
+#else
+#define MNET32_WIFI_ROAM_ENABLED 0
+#endif
+
+#if MNET32_WIFI_ROAM_ENABLED
+/**
+ * The signal strength to start looking for a stronger access point, given in
+ * dBm.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_WIFI_ROAM_RSSI_THRESHOLD CONFIG_MNET32_WIFI_ROAM_RSSI_THRESHOLD
+
+/**
+ * The minimum improvement of the signal strength to roam, given in dB.
+ *
+ * Another access point is only used, if its signal is stronger than the
+ * rolling average of the current access point by this margin.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_WIFI_ROAM_RSSI_MARGIN CONFIG_MNET32_WIFI_ROAM_RSSI_MARGIN
+#else
+#define MNET32_WIFI_ROAM_RSSI_THRESHOLD 0
+#define MNET32_WIFI_ROAM_RSSI_MARGIN 0
+#endif  // MNET32_WIFI_ROAM_ENABLED
+
+/**
+ * Timespan to wait after a scan for a stronger access point, before the next
+ * scan may be started.
+ *
+ * While the signal is weak and there is no stronger access point, this limits
+ * the scans, which interrupt the connection briefly. The value is given in
+ * milliseconds.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``mnet32.h``.
+ */
+#define MNET32_WIFI_ROAM_BACKOFF 60000
+
+/**
+ * The maximum number of access points to be evaluated after a scan.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``mnet32.h``.
+ */
+#define MNET32_WIFI_ROAM_SCAN_MAX_RECORDS 8
+
+/**
+ * The number of RSSI samples to keep.
+ *
+ * The RSSI is sampled every ::MNET32_TASK_MONITOR_FREQUENCY milliseconds
+ * while connected in station mode. The rolling average is calculated over
+ * these samples.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``mnet32.h``.
+ */
+#define MNET32_WIFI_RSSI_HISTORY_LEN 12
+
 /**
  * The maximum number of connection attempts for station mode.
  *
@@ -181,11 +462,139 @@ enum mnet32_events {
      * The event is emitted in the following cases:
      *   - the component could successfully establish a connection to a WiFi
      *     network;
-     *   - the component has successfully started its internal access point.
+     *   - the component has successfully started its internal access point;
+     *   - the Ethernet link is up and an IP address was received.
+     *
+     * The event is only emitted, if the network was not available before. If
+     * the Ethernet link goes down and the WiFi becomes ready within
+     * ::MNET32_ETH_HANDOVER_TIMEOUT (or the Ethernet takes over from the
+     * WiFi), the hand-over is *not* announced, neither by this event nor by
+     * ``MNET32_EVENT_UNAVAILABLE``.
      */
     MNET32_EVENT_READY
 };
 
+/**
+ * A snapshot of the component's status.
+ *
+ * See ::mnet32_get_status_snapshot .
+ */
+struct mnet32_status_snapshot {
+    /**
+     * Flag to indicate, if the component is connected in station mode.
+     *
+     * The other fields are only meaningful, if this is ``true``.
+     */
+    bool connected;
+
+    /**
+     * The most recent RSSI sample, given in dBm.
+     */
+    int8_t rssi;
+
+    /**
+     * The rolling average of ``rssi_history``, given in dBm.
+     */
+    int8_t rssi_avg;
+
+    /**
+     * The number of valid samples in ``rssi_history``.
+     */
+    uint8_t rssi_count;
+
+    /**
+     * The most recent RSSI samples, oldest first.
+     */
+    int8_t rssi_history[MNET32_WIFI_RSSI_HISTORY_LEN];
+
+    /**
+     * The number of scans for a stronger access point.
+     */
+    uint32_t roam_scans;
+
+    /**
+     * The number of reconnects to a stronger access point.
+     */
+    uint32_t roams;
+};
+
+/**
+ * Locks to declare activity, that requires less WiFi power saving.
+ *
+ * See ::mnet32_ps_lock_acquire .
+ */
+enum mnet32_ps_lock {
+    /**
+     * Activity with moderate latency requirements, e.g. open http sessions.
+     *
+     * While held, ``WIFI_PS_MIN_MODEM`` is applied.
+     */
+    MNET32_PS_LOCK_INTERACTIVE,
+
+    /**
+     * Activity with high throughput or low latency requirements, e.g.
+     * streaming.
+     *
+     * While held, power saving is disabled (``WIFI_PS_NONE``).
+     */
+    MNET32_PS_LOCK_PERFORMANCE,
+
+    /**
+     * The number of locks, not an actual lock.
+     */
+    MNET32_PS_LOCK_MAX
+};
+
+/**
+ * Delivery statistics of the component's events.
+ *
+ * See ::mnet32_event_get_stats .
+ */
+struct mnet32_event_stats {
+    /**
+     * The number of successfully posted events.
+     */
+    uint32_t posted;
+
+    /**
+     * The number of events, that could not be posted and are therefore lost.
+     */
+    uint32_t dropped;
+
+    /**
+     * The maximum time between posting an event and the start of its
+     * dispatch, given in microseconds.
+     */
+    uint32_t max_dispatch_latency_us;
+};
+
+/**
+ * Statistics of the resolver's cache.
+ *
+ * See ::mnet32_resolver_get_stats .
+ */
+struct mnet32_resolver_stats {
+    /**
+     * The number of lookups, that were answered from the cache.
+     */
+    uint32_t hits;
+
+    /**
+     * The number of lookups, that required a query.
+     */
+    uint32_t misses;
+
+    /**
+     * The number of names, that were refreshed ahead of their expiry.
+     */
+    uint32_t prefetches;
+
+    /**
+     * The number of times the cache was emptied, because the network changed.
+     */
+    uint32_t invalidations;
+};
+
 
 /**
  * The component's entry point.
@@ -210,29 +619,156 @@ esp_err_t mnet32_start(void);
 esp_err_t mnet32_stop(void);
 
 /**
- * Handle the event, that the http server is ready to accept further
- * *URI handlers*.
+ * Register a handler for the component's events.
+ *
+ * This is a thin wrapper around **ESP-IDF**'s
+ * ``esp_event_handler_instance_register()``, that registers the handler with
+ * the actual event loop of the component (see ::MNET32_EVENT_LOOP_DEDICATED ).
  *
- * This is a specific handler, that does not actually parse or verify the
- * event, that triggered its execution.
+ * This may be called before ::mnet32_start.
+ *
+ * @param event_id    The event to handle, see ::mnet32_events , or
+ *                    ``ESP_EVENT_ANY_ID``.
+ * @param handler     The handler function.
+ * @param handler_arg The argument to be passed to the handler.
+ * @param instance    Optional pointer to store the handler's instance, which
+ *                    is required to unregister the handler.
+ * @return esp_err_t  ``ESP_OK`` on success, the error code of **ESP-IDF**'s
+ *                    event library otherwise.
+ */
+esp_err_t mnet32_event_handler_register(
+    int32_t event_id,
+    esp_event_handler_t handler,
+    void* handler_arg,
+    esp_event_handler_instance_t* instance);
+
+/**
+ * Unregister a handler for the component's events.
+ *
+ * @param event_id   The event, as provided to ::mnet32_event_handler_register.
+ * @param instance   The handler's instance.
+ * @return esp_err_t ``ESP_OK`` on success, the error code of **ESP-IDF**'s
+ *                   event library otherwise.
+ */
+esp_err_t mnet32_event_handler_unregister(
+    int32_t event_id,
+    esp_event_handler_instance_t instance);
+
+/**
+ * Get the delivery statistics of the component's events.
+ *
+ * @param stats The statistics are copied into this struct.
+ */
+void mnet32_event_get_stats(struct mnet32_event_stats* stats);
+
+/**
+ * Get a snapshot of the component's status.
+ *
+ * The RSSI history is reset with every new connection, the counters are kept
+ * while the component is running.
+ *
+ * @param snapshot The status is copied into this struct.
+ */
+void mnet32_get_status_snapshot(struct mnet32_status_snapshot* snapshot);
+
+/**
+ * Get the address of the current interface.
+ *
+ * @param address The address (IPv4, network byte order), e.g. to be used as
+ *                ``sin_addr.s_addr``.
+ * @return esp_err_t ``ESP_OK`` on success, ``ESP_ERR_INVALID_STATE`` if there
+ *                   is no interface (i.e. no network) and the error code of
+ *                   **ESP-IDF**'s network interface library otherwise.
+ */
+esp_err_t mnet32_get_address(uint32_t* address);
+
+/**
+ * Store the credentials of the WiFi network to connect to.
+ *
+ * The credentials are written to the non-volatile storage and the WiFi is
+ * restarted, so they are used immediately. This blocks, while the non-volatile
+ * storage is written.
+ *
+ * @param ssid The SSID of the network, at most 31 characters.
+ * @param psk  The pre-shared key of the network, at most 63 characters.
+ * @return esp_err_t ``ESP_OK`` on success, ``ESP_ERR_INVALID_ARG`` if a
+ *                   credential is missing or too long and the error code of
+ *                   **ESP-IDF**'s NVS library otherwise.
+ */
+esp_err_t mnet32_set_credentials(const char* ssid, const char* psk);
+
+/**
+ * Acquire a lock to declare activity, that requires less WiFi power saving.
+ *
+ * The locks are counted, so every call must be matched by a call of
+ * ::mnet32_ps_lock_release . The power save mode of station mode is derived
+ * from the held locks; a mode with *less* power saving is applied
+ * immediately, a mode with *more* power saving only after
+ * ::MNET32_WIFI_PS_HOLDOFF .
+ *
+ * Locks may be acquired independently of the component's state, they are
+ * applied as soon as the WiFi is started in station mode.
+ *
+ * @param lock The lock to be acquired.
+ * @return esp_err_t ``ESP_OK`` or ``ESP_ERR_INVALID_ARG`` if ``lock`` is not
+ *                   a valid ::mnet32_ps_lock .
+ */
+esp_err_t mnet32_ps_lock_acquire(enum mnet32_ps_lock lock);
+
+/**
+ * Release a lock, that was acquired with ::mnet32_ps_lock_acquire .
+ *
+ * @param lock The lock to be released.
+ * @return esp_err_t ``ESP_OK``, ``ESP_ERR_INVALID_ARG`` if ``lock`` is not a
+ *                   valid ::mnet32_ps_lock or ``ESP_ERR_INVALID_STATE`` if
+ *                   ``lock`` is not held.
+ */
+esp_err_t mnet32_ps_lock_release(enum mnet32_ps_lock lock);
+
+/**
+ * Resolve the address of a name, using the component's cache.
+ *
+ * Names are cached for the TTL of the DNS answer (at most one hour) and names,
+ * that are looked up repeatedly, are refreshed by the component's task ahead
+ * of their expiry. Thus, connections to stream or API servers usually do not
+ * wait for a DNS lookup. The cache holds ::MNET32_RESOLVER_CACHE_SIZE names
+ * and is emptied whenever the component gets an address (including a change
+ * of the medium) or the network becomes unavailable.
+ *
+ * On a cache miss, the function blocks until the DNS server responds, for at
+ * most a few seconds. IPv4 addresses in dotted notation are returned as is.
+ *
+ * @param name    The name to resolve, e.g. ``example.com``.
+ * @param address The address (IPv4, network byte order), e.g. to be used as
+ *                ``sin_addr.s_addr``.
+ * @return esp_err_t ``ESP_OK`` on success, ``ESP_ERR_NOT_FOUND`` if the name
+ *                   has no address, ``ESP_ERR_TIMEOUT`` if the DNS server did
+ *                   not respond, ``ESP_ERR_INVALID_STATE`` if there is no DNS
+ *                   server (i.e. no network) and ``ESP_FAIL`` otherwise.
+ */
+esp_err_t mnet32_resolve(const char* name, uint32_t* address);
+
+/**
+ * Get the statistics of the resolver's cache.
+ *
+ * @param stats The statistics are copied into this struct.
+ */
+void mnet32_resolver_get_stats(struct mnet32_resolver_stats* stats);
+
+/**
+ * Dump the binary trace of the component's state machine.
  *
- * This requires the *calling code*, or more specifically, the code that
- * connects this handler with events, to specifically select the events, that
- * should make this component register its specific *URI handlers*.
+ * The dump consists of a header, followed by the most recent transitions,
+ * oldest first. It may be decoded with ``tools/mnet32/trace.py``.
  *
- * @param arg        Generic arguments.
- * @param event_base ``esp_event``'s ``EVENT_BASE``. Every event is specified
- *                   by the ``EVENT_BASE`` and its ``EVENT_ID``.
- * @param event_id   ``esp_event``'s ``EVENT_ID``. Every event is specified by
- *                   the ``EVENT_BASE`` and its ``EVENT_ID``.
- * @param event_data Events might provide a pointer to additional,
- *                   event-related data. This handler assumes, that the
- *                   provided ``arg`` is an actual ``http_handle_t*`` to the
- *                   http server instance.
+ * @param buffer   The buffer to write the dump to.
+ * @param buf_size The size of ``buffer``; a buffer of
+ *                 ::MNET32_TRACE_DUMP_LEN bytes holds a complete dump. If the
+ *                 buffer is too small, only the most recent transitions are
+ *                 included.
+ * @return size_t  The number of bytes written to ``buffer`` or ``0``, if the
+ *                 buffer can not even hold the header.
  */
-void mnet32_web_attach_handlers(void* arg,
-                                esp_event_base_t event_base,
-                                int32_t event_id,
-                                void* event_data);
+size_t mnet32_trace_dump(uint8_t* buffer, size_t buf_size);
 
 #endif  // SRC_LIB_EMBEDDED_NETWORKING_ESP32_INCLUDE_MNET32_MNET32_H_
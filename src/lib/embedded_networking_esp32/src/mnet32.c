@@ -28,11 +28,18 @@
 #include "mnet32/mnet32.h"
 
 /* C's standard libraries. */
+#include <stdint.h>
 #include <string.h>
 
 /* Other headers of the component. */
+#include "mnet32_eth.h"       // Ethernet-related functions
+#include "mnet32_event.h"     // emit the component's events
+#include "mnet32_fsm.h"       // the state machine engine
 #include "mnet32_internal.h"  // The private header
+#include "mnet32_metrics.h"   // count and time the notifications
+#include "mnet32_resolver.h"  // refresh and invalidate the resolver's cache
 #include "mnet32_state.h"     // manage the internal state
+#include "mnet32_trace.h"     // trace the notifications and wakeups
 #include "mnet32_wifi.h"      // WiFi-related functions
 
 /* This is ESP-IDF's error handling library.
@@ -41,6 +48,13 @@
  */
 #include "esp_err.h"
 
+/* ESP-IDF's Ethernet library.
+ * The header has to be included here, because the component uses one single
+ * event handler function (::mnet32_event_handler), thus, the specific
+ * Ethernet-related events must be known.
+ */
+#include "esp_eth.h"
+
 /* This is ESP-IDF's event library. */
 #include "esp_event.h"
 
@@ -56,6 +70,9 @@
 /* ESP-IDF's network abstraction layer. */
 #include "esp_netif.h"
 
+/* ESP-IDF's high resolution timer, used to time the transitions. */
+#include "esp_timer.h"
+
 /* ESP-IDF's wifi library.
  * The header has to be included here, because the component uses one single
  * event handler function (::mnet32_event_handler), thus, the specific
@@ -65,26 +82,26 @@
 
 /* FreeRTOS headers.
  * - the ``FreeRTOS.h`` is required
+ * - ``queue.h`` for the notifications of the task
  * - ``task.h`` for task management
  */
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/task.h"
 
 
 /* ***** DEFINES *********************************************************** */
 
 /**
- * The index to be used by ``xTaskNotifyWaitIndex``.
- *
- * **freeRTOS** does support tasks with with multiple *notifications*, however,
- * **ESP-IDF** limits this to just one, which is placed at index ``0`` (multiple
- * notification values are supported starting at 10.4.0).
+ * The number of notifications, that may be queued for the component's task.
  *
- * The component however uses the generic versions of ``xTaskNotifyWait()`` and
- * ``xTaskNotify()``, so this constant ensures, that the notifications will be
- * send to the right *receiver*.
+ * The event handler runs in a task of higher priority than ::mnet32_task , so
+ * several notifications may be sent, before the first one is processed (e.g.
+ * ``WIFI_EVENT_STA_DISCONNECTED`` followed by ``WIFI_EVENT_SCAN_DONE``). They
+ * are queued, so none of them is lost; if the queue is full, the notification
+ * is dropped and counted (see ``mnet32_notifications_dropped_total``).
  */
-#define MNET32_TASK_NOTIFICATION_INDEX 0
+#define MNET32_TASK_QUEUE_LEN 8
 
 /**
  * The stack size to allocate for this component's task / thread.
@@ -103,12 +120,6 @@
 #define MNET32_TASK_STACK_SIZE 3072
 
 
-/* ***** TYPES ************************************************************* */
-
-/* Define the component-specific event base. */
-ESP_EVENT_DEFINE_BASE(MNET32_EVENTS);
-
-
 /* ***** VARIABLES ********************************************************* */
 
 /**
@@ -125,7 +136,190 @@ static const char* TAG = "mnet32";
 static void mnet32_task(void* task_parameters);
 static esp_err_t mnet32_deinit(void);
 static esp_err_t mnet32_init(void);
-static void mnet32_emit_event(int32_t event_id, void* event_data);
+
+static bool mnet32_guard_eth_handover_pending(void);
+static bool mnet32_guard_medium_ethernet(void);
+static bool mnet32_guard_medium_unspecified(void);
+static bool mnet32_guard_wifi_ap_no_stations(void);
+static bool mnet32_guard_wifi_ap_no_stations_eth_deferred(void);
+static bool mnet32_guard_wifi_sta_attempts_exceeded(void);
+
+static void mnet32_network_ready(void);
+static void mnet32_network_unavailable(void);
+static void mnet32_action_eth_defer(void);
+static void mnet32_action_eth_failover(void);
+static void mnet32_action_eth_got_ip(void);
+static void mnet32_action_eth_handover_failed(void);
+static void mnet32_action_eth_link_lost(void);
+static void mnet32_action_eth_no_link(void);
+static void mnet32_action_eth_start(void);
+static void mnet32_action_networking_stop(void);
+static void mnet32_action_wifi_ap_fallback(void);
+static void mnet32_action_wifi_ap_start(void);
+static void mnet32_action_wifi_ap_timer_start(void);
+static void mnet32_action_wifi_ap_timer_stop(void);
+static void mnet32_action_wifi_restart(void);
+static void mnet32_action_wifi_roam_evaluate(void);
+static void mnet32_action_wifi_roam_scan(void);
+static void mnet32_action_wifi_start(void);
+static void mnet32_action_wifi_sta_connect(void);
+static void mnet32_action_wifi_sta_connected(void);
+
+
+/* ***** TRANSITION TABLE **************************************************
+ * (technically, this is a ``variable``, but as the guard and action functions
+ *  must be referenced, this must come after the ``prototypes``)
+ */
+
+/**
+ * Shortcuts for the ``from_mask`` of the transitions.
+ */
+#define FROM_ANY MNET32_FSM_FROM_ANY
+#define FROM_DOWN MNET32_FSM_FROM(MNET32_STATUS_DOWN)
+#define FROM_READY MNET32_FSM_FROM(MNET32_STATUS_READY)
+#define FROM_CONNECTING MNET32_FSM_FROM(MNET32_STATUS_CONNECTING)
+#define FROM_IDLE MNET32_FSM_FROM(MNET32_STATUS_IDLE)
+#define FROM_BUSY MNET32_FSM_FROM(MNET32_STATUS_BUSY)
+
+/**
+ * The component's state machine.
+ *
+ * For every notification of ::mnet32_task, the first transition matching the
+ * current status (and the optional guard) is executed by
+ * ::mnet32_fsm_dispatch . Notifications without a matching transition are
+ * counted as invalid transitions.
+ */
+static const struct mnet32_fsm_transition mnet32_transitions[] = {
+    /* Commands */
+    {FROM_ANY,
+     MNET32_NOTIFICATION_CMD_NETWORKING_STOP,
+     NULL,
+     mnet32_action_networking_stop,
+     MNET32_STATUS_DOWN},
+    {FROM_ANY,
+     MNET32_NOTIFICATION_CMD_WIFI_START,
+     NULL,
+     mnet32_action_wifi_start,
+     MNET32_FSM_KEEP},
+    {FROM_ANY,
+     MNET32_NOTIFICATION_CMD_WIFI_RESTART,
+     NULL,
+     mnet32_action_wifi_restart,
+     MNET32_STATUS_DOWN},
+    {FROM_ANY,
+     MNET32_NOTIFICATION_CMD_ETH_START,
+     NULL,
+     mnet32_action_eth_start,
+     MNET32_FSM_KEEP},
+
+    /* Ethernet */
+    {FROM_DOWN | FROM_READY | FROM_CONNECTING | FROM_IDLE,
+     MNET32_NOTIFICATION_EVENT_ETH_GOT_IP,
+     NULL,
+     mnet32_action_eth_got_ip,
+     MNET32_STATUS_READY},
+    {FROM_BUSY,
+     MNET32_NOTIFICATION_EVENT_ETH_GOT_IP,
+     NULL,
+     mnet32_action_eth_defer,
+     MNET32_FSM_KEEP},
+    {FROM_ANY,
+     MNET32_NOTIFICATION_EVENT_ETH_DISCONNECTED,
+     mnet32_guard_medium_ethernet,
+     mnet32_action_eth_failover,
+     MNET32_STATUS_CONNECTING},
+    {FROM_ANY,
+     MNET32_NOTIFICATION_EVENT_ETH_DISCONNECTED,
+     NULL,
+     mnet32_action_eth_link_lost,
+     MNET32_FSM_KEEP},
+    {FROM_ANY,
+     MNET32_NOTIFICATION_EVENT_ETH_HANDOVER_TIMEOUT,
+     mnet32_guard_eth_handover_pending,
+     mnet32_action_eth_handover_failed,
+     MNET32_FSM_KEEP},
+    {FROM_ANY,
+     MNET32_NOTIFICATION_EVENT_ETH_HANDOVER_TIMEOUT,
+     mnet32_guard_medium_unspecified,
+     mnet32_action_eth_no_link,
+     MNET32_FSM_KEEP},
+    {FROM_ANY,
+     MNET32_NOTIFICATION_EVENT_ETH_HANDOVER_TIMEOUT,
+     NULL,
+     NULL,
+     MNET32_FSM_KEEP},
+
+    /* WiFi, access point mode */
+    {FROM_DOWN | FROM_CONNECTING,
+     MNET32_NOTIFICATION_EVENT_WIFI_AP_START,
+     NULL,
+     mnet32_action_wifi_ap_start,
+     MNET32_STATUS_IDLE},
+    {FROM_IDLE,
+     MNET32_NOTIFICATION_EVENT_WIFI_AP_STACONNECTED,
+     NULL,
+     mnet32_action_wifi_ap_timer_stop,
+     MNET32_STATUS_BUSY},
+    {FROM_BUSY,
+     MNET32_NOTIFICATION_EVENT_WIFI_AP_STACONNECTED,
+     NULL,
+     NULL,
+     MNET32_FSM_KEEP},
+    {FROM_BUSY,
+     MNET32_NOTIFICATION_EVENT_WIFI_AP_STADISCONNECTED,
+     mnet32_guard_wifi_ap_no_stations_eth_deferred,
+     mnet32_action_eth_got_ip,
+     MNET32_STATUS_READY},
+    {FROM_IDLE | FROM_BUSY,
+     MNET32_NOTIFICATION_EVENT_WIFI_AP_STADISCONNECTED,
+     mnet32_guard_wifi_ap_no_stations,
+     mnet32_action_wifi_ap_timer_start,
+     MNET32_STATUS_IDLE},
+    {FROM_IDLE | FROM_BUSY,
+     MNET32_NOTIFICATION_EVENT_WIFI_AP_STADISCONNECTED,
+     NULL,
+     NULL,
+     MNET32_FSM_KEEP},
+
+    /* WiFi, station mode */
+    {FROM_DOWN | FROM_CONNECTING,
+     MNET32_NOTIFICATION_EVENT_WIFI_STA_START,
+     NULL,
+     mnet32_action_wifi_sta_connect,
+     MNET32_STATUS_CONNECTING},
+    {FROM_CONNECTING,
+     MNET32_NOTIFICATION_EVENT_WIFI_STA_CONNECTED,
+     NULL,
+     mnet32_action_wifi_sta_connected,
+     MNET32_STATUS_READY},
+    {FROM_CONNECTING | FROM_READY,
+     MNET32_NOTIFICATION_EVENT_WIFI_STA_DISCONNECTED,
+     mnet32_guard_wifi_sta_attempts_exceeded,
+     mnet32_action_wifi_ap_fallback,
+     MNET32_STATUS_CONNECTING},
+    {FROM_CONNECTING | FROM_READY,
+     MNET32_NOTIFICATION_EVENT_WIFI_STA_DISCONNECTED,
+     NULL,
+     mnet32_action_wifi_sta_connect,
+     MNET32_STATUS_CONNECTING},
+
+    /* WiFi, roaming (station mode) */
+    {FROM_READY,
+     MNET32_NOTIFICATION_EVENT_WIFI_STA_RSSI_LOW,
+     NULL,
+     mnet32_action_wifi_roam_scan,
+     MNET32_FSM_KEEP},
+    {FROM_ANY,
+     MNET32_NOTIFICATION_EVENT_WIFI_STA_RSSI_LOW,
+     NULL,
+     NULL,
+     MNET32_FSM_KEEP},
+    {FROM_ANY,
+     MNET32_NOTIFICATION_EVENT_WIFI_SCAN_DONE,
+     NULL,
+     mnet32_action_wifi_roam_evaluate,
+     MNET32_FSM_KEEP},
+};
 
 
 /* ***** FUNCTIONS ********************************************************* */
@@ -137,6 +331,9 @@ static void mnet32_emit_event(int32_t event_id, void* event_data);
  * some external event (in most cases provided by **ESP-IDF**'s internal
  * modules) requires some reaction.
  *
+ * The reaction is specified by ::mnet32_transitions and executed by
+ * ::mnet32_fsm_dispatch .
+ *
  * There is a timeout to this blocking. After this timeout is reached, the
  * function will emit a component-specific event, publishing its internal state
  * to other components.
@@ -159,131 +356,57 @@ static void mnet32_task(void* task_parameters) {
 
     for (;;) {
         /* Block until notification or ``mon_freq`` reached. */
-        notify_result = xTaskNotifyWaitIndexed(MNET32_TASK_NOTIFICATION_INDEX,
-                                               pdFALSE,
-                                               ULONG_MAX,
-                                               &notify_value,
-                                               mon_freq);
+        notify_result = xQueueReceive(mnet32_state_get_queue(),
+                                      &notify_value,
+                                      mon_freq);
 
         /* Notification or monitoring? */
         if (notify_result == pdPASS) {
-            switch (notify_value) {
-            case MNET32_NOTIFICATION_CMD_NETWORKING_STOP:
-                ESP_LOGD(TAG, "CMD: NETWORKING_STOP");
-
-                /* Emit the corresponding event *before* actually shutting down
-                 * the networking. This might give other components some time
-                 * to handle the unavailability of networking.
-                 */
-                mnet32_emit_event(MNET32_EVENT_UNAVAILABLE, NULL);
-                mnet32_deinit();
-                break;
-            case MNET32_NOTIFICATION_CMD_WIFI_START:
-                ESP_LOGD(TAG, "CMD: WIFI_START");
-
-                if (mnet32_wifi_start() != ESP_OK) {
-                    ESP_LOGE(TAG, "Could not start WiFi!");
-                }
-                break;
-            case MNET32_NOTIFICATION_CMD_WIFI_RESTART:
-                ESP_LOGD(TAG, "CMD: WIFI_RESTART");
-
-                /* Emit the corresponding event *before* actually shutting down
-                 * the networking. This might give other components some time
-                 * to handle the unavailability of networking.
-                 */
-                mnet32_emit_event(MNET32_EVENT_UNAVAILABLE, NULL);
-
-                mnet32_wifi_deinit();
-                if (mnet32_wifi_start() != ESP_OK) {
-                    ESP_LOGE(TAG, "Could not restart WiFi!");
-                }
-                break;
-            case MNET32_NOTIFICATION_EVENT_WIFI_AP_START:
-                /* Handle ``WIFI_EVENT_AP_START`` (received from
-                 * ::mnet32_event_handler ).
-                 * The *chain* of ::mnet32_wifi_start, ::mnet32_wifi_init and ::mnet32_wifi_ap_init
-                 * has set ``state->medium`` and ``state->mode``, so with this
-                 * event the access point is assumed to be ready, resulting in
-                 * ``state->status = MNET32_STATUS_IDLE``, because no
-                 * clients have connected yet.
-                 */
-                ESP_LOGD(TAG, "EVENT: WIFI_EVENT_AP_START");
-
-                mnet32_state_set_status_idle();
-                mnet32_wifi_ap_timer_start();
-
-                mnet32_emit_event(MNET32_EVENT_READY, NULL);
-                // TODO(mischback) Should the *status event* be emitted here
-                //                 automatically (#16)?
-                break;
-            case MNET32_NOTIFICATION_EVENT_WIFI_AP_STACONNECTED:
-                /* A client connected to the access point.
-                 * Set the internal state to MNET32_STATUS_BUSY to indicate
-                 * actual usage of the access point. The internal timer to
-                 * shut down the access point has to be stopped, because a
-                 * client *might be* consuming the web interface, so the
-                 * access point has to be kept running.
-                 */
-                ESP_LOGD(TAG, "EVENT: WIFI_EVENT_AP_STACONNECTED");
-
-                mnet32_state_set_status_busy();
-                mnet32_wifi_ap_timer_stop();
-
-                // TODO(mischback) Emit *status event* (#16)!
-                break;
-            case MNET32_NOTIFICATION_EVENT_WIFI_AP_STADISCONNECTED:
-                ESP_LOGD(TAG, "EVENT: WIFI_EVENT_AP_STADISCONNECTED");
-
-                if (mnet32_wifi_ap_get_connected_stations() == 0) {
-                    mnet32_state_set_status_idle();
-
-                    ESP_LOGD(TAG,
-                             "No more stations connected, restarting shutdown "
-                             "timer!");  // NOLINT(whitespace/line_length)
-                    mnet32_wifi_ap_timer_start();
-                }
-
-                // TODO(mischback) Emit *status event* (#16)!
-                break;
-            case MNET32_NOTIFICATION_EVENT_WIFI_STA_START:
-                ESP_LOGD(TAG, "EVENT: WIFI_EVENT_STA_START");
-
-                mnet32_state_set_status_connecting();
-                mnet32_wifi_sta_connect();
-                break;
-            case MNET32_NOTIFICATION_EVENT_WIFI_STA_CONNECTED:
-                ESP_LOGD(TAG, "EVENT: WIFI_EVENT_STA_CONNECTED");
-
-                mnet32_state_set_status_ready();
-                mnet32_wifi_sta_reset_connection_counter();
-                mnet32_emit_event(MNET32_EVENT_READY, NULL);
-                // TODO(mischback) Emit *status event* (#16)!
-                break;
-            case MNET32_NOTIFICATION_EVENT_WIFI_STA_DISCONNECTED:
-                ESP_LOGD(TAG, "EVENT: WIFI_EVENT_STA_DISCONNECTED");
-
-                if (mnet32_wifi_sta_get_num_connection_attempts() >
-                    MNET32_WIFI_STA_MAX_CONNECTION_ATTEMPTS) {
-                    mnet32_wifi_sta_deinit();
-                    if (mnet32_wifi_ap_init() != ESP_OK)
-                        mnet32_notify(MNET32_NOTIFICATION_CMD_NETWORKING_STOP);
-                } else {
-                    ESP_LOGI(TAG,
-                             "Got disconnected, trying to reconnect (%d/%d)",
-                             mnet32_wifi_sta_get_num_connection_attempts(),
-                             MNET32_WIFI_STA_MAX_CONNECTION_ATTEMPTS);
-                    mnet32_wifi_sta_connect();
-                }
-                break;
-            default:
-                ESP_LOGW(TAG, "Got unhandled notification: %d", notify_value);
-                break;
-            }
+            obs32_trace_begin(&mnet32_trace_group,
+                              MNET32_TRACE_DISPATCH,
+                              (uint16_t)notify_value);
+            int64_t start = esp_timer_get_time();
+            mnet32_fsm_dispatch(mnet32_transitions,
+                                sizeof(mnet32_transitions) /
+                                    sizeof(mnet32_transitions[0]),
+                                notify_value);
+            obs32_metrics_inc(&mnet32_metrics_notifications);
+            obs32_metrics_observe(&mnet32_metrics_transition_us,
+                                  (uint32_t)(esp_timer_get_time() - start));
+            obs32_trace_end(&mnet32_trace_group,
+                            MNET32_TRACE_DISPATCH,
+                            (uint16_t)notify_value);
         } else {
             ESP_LOGV(TAG, "'mon_freq' reached...");
+            obs32_trace_instant(&mnet32_trace_group, MNET32_TRACE_MONITOR, 0);
             // TODO(mischback) Emit *status event* (#16)!
 
+            if (mnet32_state_is_medium_wireless() &&
+                mnet32_state_is_mode_sta())
+                mnet32_wifi_sta_monitor();
+
+            if (mnet32_state_get_status() == MNET32_STATUS_READY)
+                mnet32_resolver_prefetch();
+
+            struct mnet32_event_stats event_stats;
+            mnet32_event_get_stats(&event_stats);
+            ESP_LOGV(TAG,
+                     "Events: %d posted, %d dropped, max. latency %dus",
+                     event_stats.posted,
+                     event_stats.dropped,
+                     event_stats.max_dispatch_latency_us);
+            ESP_LOGV(TAG,
+                     "Invalid transitions: %d",
+                     mnet32_fsm_get_invalid_transitions());
+
+            struct mnet32_resolver_stats resolver_stats;
+            mnet32_resolver_get_stats(&resolver_stats);
+            ESP_LOGV(TAG,
+                     "Resolver: %d hits, %d misses, %d prefetches",
+                     resolver_stats.hits,
+                     resolver_stats.misses,
+                     resolver_stats.prefetches);
+
             /* The following statement is just used for development / debugging
              * and logs the (minimum) free stack size of this task in bytes.
              */
@@ -301,6 +424,311 @@ static void mnet32_task(void* task_parameters) {
     vTaskDelete(NULL);
 }
 
+/**
+ * Check if there is a pending handover from Ethernet to WiFi.
+ *
+ * @return bool See ::mnet32_eth_handover_is_pending .
+ */
+static bool mnet32_guard_eth_handover_pending(void) {
+    return mnet32_eth_handover_is_pending();
+}
+
+/**
+ * Check if Ethernet is the active medium.
+ *
+ * @return bool ``true`` if ``state->medium`` is ``MNET32_MEDIUM_ETHERNET``.
+ */
+static bool mnet32_guard_medium_ethernet(void) {
+    return mnet32_state_is_medium_ethernet();
+}
+
+/**
+ * Check if there is no active medium.
+ *
+ * @return bool ``true`` if neither Ethernet nor WiFi is the active medium.
+ */
+static bool mnet32_guard_medium_unspecified(void) {
+    return !mnet32_state_is_medium_ethernet() &&
+           !mnet32_state_is_medium_wireless();
+}
+
+/**
+ * Check if the last station disconnected from the access point.
+ *
+ * @return bool ``true`` if no more stations are connected.
+ */
+static bool mnet32_guard_wifi_ap_no_stations(void) {
+    return mnet32_wifi_ap_get_connected_stations() == 0;
+}
+
+/**
+ * Check if the last station disconnected while the Ethernet is ready.
+ *
+ * @return bool ``true`` if no more stations are connected and the activation
+ *              of the Ethernet was deferred (see ::mnet32_action_eth_defer ).
+ */
+static bool mnet32_guard_wifi_ap_no_stations_eth_deferred(void) {
+    return mnet32_eth_is_deferred() && mnet32_guard_wifi_ap_no_stations();
+}
+
+/**
+ * Check if the maximum number of connection attempts is exceeded.
+ *
+ * @return bool ``true`` if the access point should be started.
+ */
+static bool mnet32_guard_wifi_sta_attempts_exceeded(void) {
+    return mnet32_wifi_sta_get_num_connection_attempts() >
+           MNET32_WIFI_STA_MAX_CONNECTION_ATTEMPTS;
+}
+
+/**
+ * Announce, that the network is available.
+ *
+ * MNET32_EVENT_READY is only emitted, if the network was not available
+ * before. A change of the medium, e.g. the failover from Ethernet to WiFi and
+ * back, keeps the network available, so it is not announced again.
+ *
+ * The resolver's cache is emptied in any case, as cached addresses may not be
+ * valid with the new medium or network. This is done before the event is
+ * posted, so its handlers do not get stale addresses.
+ */
+static void mnet32_network_ready(void) {
+    mnet32_resolver_invalidate();
+    if (mnet32_state_is_available())
+        return;
+
+    mnet32_state_set_available(true);
+    mnet32_emit_event(MNET32_EVENT_READY, NULL, 0);
+}
+
+/**
+ * Announce, that the network is not available (anymore).
+ *
+ * MNET32_EVENT_UNAVAILABLE is only emitted, if the network was announced as
+ * available by ::mnet32_network_ready . The resolver's cache is emptied in
+ * any case.
+ */
+static void mnet32_network_unavailable(void) {
+    mnet32_resolver_invalidate();
+    if (!mnet32_state_is_available())
+        return;
+
+    mnet32_state_set_available(false);
+    mnet32_emit_event(MNET32_EVENT_UNAVAILABLE, NULL, 0);
+}
+
+/**
+ * The Ethernet link is ready, but stations are connected to the access point.
+ *
+ * The access point session is not interrupted. The Ethernet is activated,
+ * when the last station disconnects.
+ */
+static void mnet32_action_eth_defer(void) {
+    ESP_LOGI(TAG, "Access point is in use, deferring Ethernet!");
+    mnet32_eth_set_deferred(true);
+}
+
+/**
+ * The Ethernet link went down.
+ *
+ * Fail over to WiFi. MNET32_EVENT_UNAVAILABLE is only emitted, if the WiFi
+ * can not be started at all or does not become ready within
+ * MNET32_ETH_HANDOVER_TIMEOUT (see ::mnet32_action_eth_handover_failed ).
+ */
+static void mnet32_action_eth_failover(void) {
+    mnet32_eth_deactivate();
+    mnet32_eth_handover_begin();
+    if (mnet32_wifi_start() != ESP_OK) {
+        ESP_LOGE(TAG, "Could not start WiFi!");
+        mnet32_eth_handover_complete();
+        mnet32_network_unavailable();
+    }
+}
+
+/**
+ * The Ethernet link is up and ready to be used.
+ *
+ * If the WiFi is currently used (as fallback), it is shut down without
+ * emitting MNET32_EVENT_UNAVAILABLE, because the Ethernet is already
+ * available.
+ */
+static void mnet32_action_eth_got_ip(void) {
+    mnet32_eth_handover_complete();
+    if (mnet32_state_is_medium_wireless())
+        mnet32_wifi_deinit();
+
+    mnet32_eth_activate();
+    mnet32_network_ready();
+}
+
+/**
+ * The WiFi did not become ready in time after the Ethernet link went down.
+ */
+static void mnet32_action_eth_handover_failed(void) {
+    ESP_LOGW(TAG, "Handover to WiFi timed out!");
+    mnet32_eth_handover_complete();
+    mnet32_network_unavailable();
+}
+
+/**
+ * The Ethernet link went down, while Ethernet was not the active medium.
+ */
+static void mnet32_action_eth_link_lost(void) {
+    mnet32_eth_set_deferred(false);
+}
+
+/**
+ * There was no Ethernet link during startup, fall back to WiFi.
+ */
+static void mnet32_action_eth_no_link(void) {
+    ESP_LOGI(TAG, "No Ethernet link, starting WiFi!");
+    mnet32_action_wifi_start();
+}
+
+/**
+ * Start the Ethernet.
+ *
+ * The Ethernet is preferred, but WiFi is the fallback, if the Ethernet can
+ * not be started or the link does not come up within
+ * MNET32_ETH_HANDOVER_TIMEOUT.
+ */
+static void mnet32_action_eth_start(void) {
+    if (mnet32_eth_start() != ESP_OK) {
+        ESP_LOGE(TAG, "Could not start Ethernet, using WiFi!");
+        mnet32_action_wifi_start();
+        return;
+    }
+    mnet32_eth_link_timer_start();
+}
+
+/**
+ * Stop all networking.
+ *
+ * Emit the corresponding event *before* actually shutting down the
+ * networking. This might give other components some time to handle the
+ * unavailability of networking.
+ *
+ * Please note: ::mnet32_deinit deletes the component's task, so this function
+ * does not return.
+ */
+static void mnet32_action_networking_stop(void) {
+    mnet32_network_unavailable();
+    mnet32_deinit();
+}
+
+/**
+ * The maximum number of connection attempts is exceeded, start the access
+ * point.
+ */
+static void mnet32_action_wifi_ap_fallback(void) {
+    mnet32_wifi_sta_deinit();
+    if (mnet32_wifi_ap_init() != ESP_OK)
+        mnet32_notify(MNET32_NOTIFICATION_CMD_NETWORKING_STOP);
+}
+
+/**
+ * The access point is started.
+ *
+ * The *chain* of ::mnet32_wifi_start, ::mnet32_wifi_init and
+ * ::mnet32_wifi_ap_init has set ``state->medium`` and ``state->mode``, so
+ * with this event the access point is assumed to be ready, resulting in
+ * ``MNET32_STATUS_IDLE``, because no clients have connected yet.
+ */
+static void mnet32_action_wifi_ap_start(void) {
+    mnet32_wifi_ap_timer_start();
+    mnet32_wifi_ap_dns_start();
+
+    mnet32_eth_handover_complete();
+    mnet32_network_ready();
+    // TODO(mischback) Should the *status event* be emitted here
+    //                 automatically (#16)?
+}
+
+/**
+ * The last station disconnected from the access point, restart the shutdown
+ * timer.
+ */
+static void mnet32_action_wifi_ap_timer_start(void) {
+    ESP_LOGD(TAG, "No more stations connected, restarting shutdown timer!");
+    mnet32_wifi_ap_timer_start();
+}
+
+/**
+ * A client connected to the access point.
+ *
+ * The internal timer to shut down the access point has to be stopped, because
+ * a client *might be* consuming the web interface, so the access point has to
+ * be kept running.
+ */
+static void mnet32_action_wifi_ap_timer_stop(void) {
+    mnet32_wifi_ap_timer_stop();
+}
+
+/**
+ * Restart the WiFi, e.g. to apply new credentials.
+ *
+ * Emit the corresponding event *before* actually shutting down the
+ * networking. This might give other components some time to handle the
+ * unavailability of networking.
+ */
+static void mnet32_action_wifi_restart(void) {
+    mnet32_network_unavailable();
+
+    mnet32_wifi_deinit();
+    if (mnet32_wifi_start() != ESP_OK) {
+        ESP_LOGE(TAG, "Could not restart WiFi!");
+    }
+}
+
+/**
+ * The scan for a stronger access point is finished.
+ *
+ * This is executed in any status, as the scan results have to be freed.
+ */
+static void mnet32_action_wifi_roam_evaluate(void) {
+    mnet32_wifi_sta_roam_evaluate();
+}
+
+/**
+ * The signal of the current access point is weak, look for a stronger one.
+ */
+static void mnet32_action_wifi_roam_scan(void) {
+    mnet32_wifi_sta_roam_scan();
+}
+
+/**
+ * Start the WiFi.
+ */
+static void mnet32_action_wifi_start(void) {
+    if (mnet32_wifi_start() != ESP_OK) {
+        ESP_LOGE(TAG, "Could not start WiFi!");
+    }
+}
+
+/**
+ * (Re-) Connect to the configured WiFi network.
+ */
+static void mnet32_action_wifi_sta_connect(void) {
+    if (mnet32_wifi_sta_get_num_connection_attempts() > 0) {
+        ESP_LOGI(TAG,
+                 "Got disconnected, trying to reconnect (%d/%d)",
+                 mnet32_wifi_sta_get_num_connection_attempts(),
+                 MNET32_WIFI_STA_MAX_CONNECTION_ATTEMPTS);
+    }
+    mnet32_wifi_sta_connect();
+}
+
+/**
+ * The connection to the WiFi network is established.
+ */
+static void mnet32_action_wifi_sta_connected(void) {
+    mnet32_wifi_sta_reset_connection_counter();
+    mnet32_wifi_sta_link_up();
+    mnet32_eth_handover_complete();
+    mnet32_network_ready();
+    // TODO(mischback) Emit *status event* (#16)!
+}
+
 void mnet32_event_handler(void* arg,
                           esp_event_base_t event_base,
                           int32_t event_id,
@@ -321,9 +749,13 @@ void mnet32_event_handler(void* arg,
         // case WIFI_EVENT_WIFI_READY:
         //     ESP_LOGV(TAG, "WIFI_EVENT_WIFI_READY");
         //     break;
-        // case WIFI_EVENT_SCAN_DONE:
-        //     ESP_LOGV(TAG, "WIFI_EVENT_SCAN_DONE");
-        //     break;
+        case WIFI_EVENT_SCAN_DONE:
+            /* This event is emitted by ``esp_wifi`` when a scan for a
+             * stronger access point is finished.
+             */
+            ESP_LOGD(TAG, "WIFI_EVENT_SCAN_DONE");
+            mnet32_notify(MNET32_NOTIFICATION_EVENT_WIFI_SCAN_DONE);
+            break;
         case WIFI_EVENT_STA_START:
             /* This event is emitted by ``esp_wifi`` when the interface is
              * successfully started in station mode.
@@ -394,12 +826,46 @@ void mnet32_event_handler(void* arg,
         // case WIFI_EVENT_AP_PROBEREQRECVED:
         //     ESP_LOGV(TAG, "WIFI_EVENT_AP_PROBEREQRECVED");
         //     break;
+        case WIFI_EVENT_STA_BSS_RSSI_LOW:
+            /* This event is emitted by ``esp_wifi`` once, when the RSSI
+             * drops below the threshold set by
+             * ``esp_wifi_set_rssi_threshold()``.
+             */
+            ESP_LOGD(TAG, "WIFI_EVENT_STA_BSS_RSSI_LOW");
+            mnet32_notify(MNET32_NOTIFICATION_EVENT_WIFI_STA_RSSI_LOW);
+            break;
         default:
             ESP_LOGD(TAG, "Got unhandled WIFI_EVENT: '%d'", event_id);
             break;
         }
     }
 
+    if (event_base == ETH_EVENT) {
+        switch (event_id) {
+        // case ETHERNET_EVENT_START:
+        //     ESP_LOGV(TAG, "ETHERNET_EVENT_START");
+        //     break;
+        // case ETHERNET_EVENT_STOP:
+        //     ESP_LOGV(TAG, "ETHERNET_EVENT_STOP");
+        //     break;
+        case ETHERNET_EVENT_CONNECTED:
+            /* This event is emitted by ``esp_eth`` when the link is up.
+             * The Ethernet is not usable before an IP address is received,
+             * so this is just logged (see ``IP_EVENT_ETH_GOT_IP``).
+             */
+            ESP_LOGD(TAG, "ETHERNET_EVENT_CONNECTED");
+            break;
+        case ETHERNET_EVENT_DISCONNECTED:
+            /* This event is emitted by ``esp_eth`` when the link is down. */
+            ESP_LOGD(TAG, "ETHERNET_EVENT_DISCONNECTED");
+            mnet32_notify(MNET32_NOTIFICATION_EVENT_ETH_DISCONNECTED);
+            break;
+        default:
+            ESP_LOGD(TAG, "Got unhandled ETH_EVENT: '%d'", event_id);
+            break;
+        }
+    }
+
     if (event_base == IP_EVENT) {
         switch (event_id) {
         // case IP_EVENT_STA_GOT_IP:
@@ -427,9 +893,13 @@ void mnet32_event_handler(void* arg,
         // case IP_EVENT_GOT_IP6:
         //     ESP_LOGV(TAG, "IP_EVENT_GOT_IP6");
         //     break;
-        // case IP_EVENT_ETH_GOT_IP:
-        //     ESP_LOGV(TAG, "IP_EVENT_ETH_GOT_IP");
-        //     break;
+        case IP_EVENT_ETH_GOT_IP:
+            /* This event is emitted when the Ethernet interface received an
+             * IP address, meaning the Ethernet is ready to be used.
+             */
+            ESP_LOGD(TAG, "IP_EVENT_ETH_GOT_IP");
+            mnet32_notify(MNET32_NOTIFICATION_EVENT_ETH_GOT_IP);
+            break;
         // case IP_EVENT_ETH_LOST_IP:
         //     ESP_LOGV(TAG, "IP_EVENT_ETH_LOST_IP");
         //     break;
@@ -502,9 +972,29 @@ static esp_err_t mnet32_init(void) {
         return esp_ret;
     }
 
+    /* Initialize the event loop for the component's events.
+     * This is a no-op, if handlers were already registered by
+     * ::mnet32_event_handler_register .
+     */
+    esp_ret = mnet32_event_loop_init();
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Could not initialize event loop!");
+        return esp_ret;
+    }
+
     /* Initialize internal state information */
     mnet32_state_init();
 
+    /* Create the queue of the task's notifications.
+     * Event handlers may send notifications as soon as they are registered.
+     */
+    mnet32_state_set_queue(
+        xQueueCreate(MNET32_TASK_QUEUE_LEN, sizeof(uint32_t)));
+    if (mnet32_state_get_queue() == NULL) {
+        ESP_LOGE(TAG, "Could not create notification queue!");
+        return ESP_ERR_NO_MEM;
+    }
+
     /* Register IP_EVENT event handler.
      * These events are required for any *medium*, so the handler can already
      * be registered at this point. The handlers for medium-specific events
@@ -536,8 +1026,13 @@ static esp_err_t mnet32_init(void) {
         return ESP_FAIL;
     }
 
-    /* Place the first command for the dedicated mnet32_task. */
-    mnet32_notify(MNET32_NOTIFICATION_CMD_WIFI_START);
+    /* Place the first command for the dedicated mnet32_task.
+     * If Ethernet is enabled, it is preferred over WiFi.
+     */
+    if (MNET32_ETH_ENABLED)
+        mnet32_notify(MNET32_NOTIFICATION_CMD_ETH_START);
+    else
+        mnet32_notify(MNET32_NOTIFICATION_CMD_WIFI_START);
 
     return ESP_OK;
 }
@@ -568,6 +1063,11 @@ static esp_err_t mnet32_deinit(void) {
     if (mnet32_state_is_medium_wireless())
         mnet32_wifi_deinit();
 
+    /* The Ethernet driver is kept running, even if WiFi is the active
+     * medium, so it has to be deinitialized independently.
+     */
+    mnet32_eth_deinit();
+
     /* Unregister the IP_EVENT event handler. */
     esp_ret = esp_event_handler_instance_unregister(
         IP_EVENT,
@@ -582,6 +1082,12 @@ static esp_err_t mnet32_deinit(void) {
         ESP_LOGW(TAG, "Continuing with de-initialization...");
     }
 
+    /* Remove the queue of the task's notifications.
+     * The event handlers are unregistered, so there are no more senders.
+     */
+    if (mnet32_state_get_queue() != NULL)
+        vQueueDelete(mnet32_state_get_queue());
+
     /* Stop and remove the dedicated networking task */
     if (mnet32_state_get_task_handle() != NULL)
         vTaskDelete(mnet32_state_get_task_handle());
@@ -606,71 +1112,29 @@ static esp_err_t mnet32_deinit(void) {
     return ESP_OK;
 }
 
-/**
- * Emit component-specific events.
- *
- * The events will be queued in the default system event loop. If the event
- * loop is already filled, the function will **not block**, effectively losing
- * the event.
- *
- * @param event_id   The actual events are defined in mnet32.h and may be
- *                   referenced by their human-readable name in the ``enum``.
- * @param event_data Optional pointer to event-specific context data. This
- *                   might be set to ``NULL`` to emit events without contextual
- *                   data.
- *                   The calling function has to allocate (and free) the actual
- *                   memory for the context data. It may be free'd after this
- *                   function returned, because **ESP-IDF**'s event loop will
- *                   manage a copy of this data, once the event is posted to the
- *                   loop.
- */
-static void mnet32_emit_event(int32_t event_id, void* event_data) {
-    ESP_LOGV(TAG, "mnet32_emit_event()");
-
-    esp_err_t esp_ret;
-
-    if (event_data == NULL) {
-        ESP_LOGV(TAG, "Event without context data!");
-        esp_ret =
-            esp_event_post(MNET32_EVENTS, event_id, NULL, 0, (TickType_t)0);
-    } else {
-        ESP_LOGV(TAG, "Event with context data!");
-        esp_ret = esp_event_post(MNET32_EVENTS,
-                                 event_id,
-                                 event_data,
-                                 sizeof(event_data),
-                                 (TickType_t)0);
-    }
-
-    if (esp_ret != ESP_OK) {
-        ESP_LOGW(TAG, "Could not emit event!");
-        ESP_LOGD(TAG,
-                 "esp_event_post() returned %s [%d]",
-                 esp_err_to_name(esp_ret),
-                 esp_ret);
-        ESP_LOGD(TAG, "event_base....... %s", MNET32_EVENTS);
-        ESP_LOGD(TAG, "event_id......... %d", event_id);
-        ESP_LOGD(TAG, "event_data....... %p", event_data);
-        ESP_LOGD(TAG, "event_data_size.. %d", sizeof(event_data));
-    }
-}
-
 void mnet32_notify(uint32_t notification) {
     ESP_LOGV(TAG, "mnet32_notify()");
 
-    xTaskNotifyIndexed(mnet32_state_get_task_handle(),
-                       MNET32_TASK_NOTIFICATION_INDEX,
-                       notification,
-                       eSetValueWithOverwrite);
+    obs32_trace_instant(&mnet32_trace_group,
+                        MNET32_TRACE_NOTIFY,
+                        (uint16_t)notification);
+    if (xQueueSend(mnet32_state_get_queue(), &notification, 0) != pdPASS) {
+        obs32_metrics_inc(&mnet32_metrics_notifications_dropped);
+        ESP_LOGE(TAG, "Dropped notification %d!", notification);
+    }
 }
 
 esp_err_t mnet32_start(void) {
     ESP_LOGV(TAG, "mnet32_start()");
 
+    // The first notifications of the task are traced, too
+    mnet32_trace_register();
+
     if (mnet32_init() != ESP_OK) {
         mnet32_deinit();
         return ESP_FAIL;
     }
+    mnet32_metrics_register();
 
     return ESP_OK;
 }
@@ -682,3 +1146,39 @@ esp_err_t mnet32_stop(void) {
 
     return ESP_OK;
 }
+
+void mnet32_get_status_snapshot(struct mnet32_status_snapshot* snapshot) {
+    ESP_LOGV(TAG, "mnet32_get_status_snapshot()");
+
+    memset(snapshot, 0, sizeof(struct mnet32_status_snapshot));
+    mnet32_wifi_sta_get_snapshot(snapshot);
+}
+
+esp_err_t mnet32_get_address(uint32_t* address) {
+    ESP_LOGV(TAG, "mnet32_get_address()");
+
+    if (!mnet32_state_is_interface_set())
+        return ESP_ERR_INVALID_STATE;
+
+    esp_netif_ip_info_t ip_info;
+    esp_err_t esp_ret =
+        esp_netif_get_ip_info(mnet32_state_get_interface(), &ip_info);
+    if (esp_ret != ESP_OK)
+        return esp_ret;
+
+    *address = ip_info.ip.addr;
+    return ESP_OK;
+}
+
+// The public size of the dump must match the trace ring
+_Static_assert(sizeof(struct mnet32_fsm_trace_header) +
+                       (MNET32_FSM_TRACE_LEN *
+                        sizeof(struct mnet32_fsm_trace_record)) ==
+                   MNET32_TRACE_DUMP_LEN,
+               "MNET32_TRACE_DUMP_LEN does not match the trace ring");
+
+size_t mnet32_trace_dump(uint8_t* buffer, size_t buf_size) {
+    ESP_LOGV(TAG, "mnet32_trace_dump()");
+
+    return mnet32_fsm_trace_dump(buffer, buf_size);
+}
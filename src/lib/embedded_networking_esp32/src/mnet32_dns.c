@@ -0,0 +1,284 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The DNS responder of the ``mnet32`` component's captive portal.
+ *
+ * The response is built in the buffer of the query: the header is modified,
+ * the question is kept and the answer is appended, so the responder works
+ * without any allocation. Names are not decoded, the question is only
+ * validated and copied as is.
+ *
+ * **Resources:**
+ *   - https://www.rfc-editor.org/rfc/rfc1035#section-4.1
+ *
+ * @file   mnet32_dns.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "mnet32_dns.h"
+
+/* C's standard libraries. */
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* The BSD socket API, provided by lwIP on the ESP32. */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The length of the DNS header.
+ */
+#define MNET32_DNS_HEADER_LEN 12
+
+/**
+ * The length of the answer record, using a pointer to the question's name.
+ */
+#define MNET32_DNS_ANSWER_LEN 16
+
+/**
+ * The maximum length of an encoded name.
+ */
+#define MNET32_DNS_NAME_MAX_LEN 255
+
+/* Flags of the DNS header (first byte). */
+#define MNET32_DNS_FLAG_QR 0x80
+#define MNET32_DNS_FLAG_OPCODE 0x78
+#define MNET32_DNS_FLAG_AA 0x04
+#define MNET32_DNS_FLAG_RD 0x01
+
+/* Response codes of the DNS header (second byte). */
+#define MNET32_DNS_RCODE_NOERROR 0
+#define MNET32_DNS_RCODE_NOTIMP 4
+
+/* Types and classes of resource records. */
+#define MNET32_DNS_TYPE_A 1
+#define MNET32_DNS_TYPE_ANY 255
+#define MNET32_DNS_CLASS_IN 1
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static uint16_t mnet32_dns_get16(const uint8_t* ptr);
+static uint8_t* mnet32_dns_put16(uint8_t* ptr, uint16_t value);
+static size_t mnet32_dns_skip_name(const uint8_t* msg, size_t off, size_t len);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Read a 16 bit value in network byte order.
+ *
+ * @param ptr The position of the value.
+ * @return uint16_t The value.
+ */
+static uint16_t mnet32_dns_get16(const uint8_t* ptr) {
+    return (uint16_t)((ptr[0] << 8) | ptr[1]);
+}
+
+/**
+ * Write a 16 bit value in network byte order.
+ *
+ * @param ptr   The position of the value.
+ * @param value The value.
+ * @return uint8_t* The position after the value.
+ */
+static uint8_t* mnet32_dns_put16(uint8_t* ptr, uint16_t value) {
+    ptr[0] = (uint8_t)(value >> 8);
+    ptr[1] = (uint8_t)(value & 0xff);
+    return ptr + 2;
+}
+
+/**
+ * Skip an encoded name.
+ *
+ * Compressed names (pointers) are not accepted, as they must not occur in
+ * the (only) question of a query.
+ *
+ * @param msg The message.
+ * @param off The offset of the name.
+ * @param len The length of the message.
+ * @return size_t The offset after the name, ``0`` if the name is malformed.
+ */
+static size_t mnet32_dns_skip_name(const uint8_t* msg, size_t off, size_t len) {
+    size_t start = off;
+
+    while (off < len) {
+        uint8_t label = msg[off];
+        if (label == 0)
+            return off + 1;
+        if ((label & 0xc0) != 0)
+            return 0;
+
+        off += 1 + label;
+        if (off - start > MNET32_DNS_NAME_MAX_LEN)
+            return 0;
+    }
+
+    return 0;
+}
+
+// Documentation in header file!
+size_t mnet32_dns_answer(uint8_t* msg,
+                         size_t len,
+                         size_t size,
+                         uint32_t address) {
+    if ((len < MNET32_DNS_HEADER_LEN) || (len > size))
+        return 0;
+
+    /* Responses are never answered, so two responders can not loop. */
+    if ((msg[2] & MNET32_DNS_FLAG_QR) != 0)
+        return 0;
+
+    uint8_t opcode = msg[2] & MNET32_DNS_FLAG_OPCODE;
+    uint8_t flags = MNET32_DNS_FLAG_QR | MNET32_DNS_FLAG_AA | opcode |
+                    (msg[2] & MNET32_DNS_FLAG_RD);
+
+    /* Only standard queries are supported, the header is sufficient to tell
+     * the client.
+     */
+    if (opcode != 0) {
+        msg[2] = flags;
+        msg[3] = MNET32_DNS_RCODE_NOTIMP;
+        memset(msg + 4, 0, MNET32_DNS_HEADER_LEN - 4);
+        return MNET32_DNS_HEADER_LEN;
+    }
+
+    if ((mnet32_dns_get16(msg + 4) != 1) || (mnet32_dns_get16(msg + 6) != 0) ||
+        (mnet32_dns_get16(msg + 8) != 0))
+        return 0;
+
+    size_t off = mnet32_dns_skip_name(msg, MNET32_DNS_HEADER_LEN, len);
+    if ((off == 0) || (off + 4 > len))
+        return 0;
+
+    uint16_t qtype = mnet32_dns_get16(msg + off);
+    uint16_t qclass = mnet32_dns_get16(msg + off + 2);
+    off += 4;
+
+    bool answer =
+        (qclass == MNET32_DNS_CLASS_IN) &&
+        ((qtype == MNET32_DNS_TYPE_A) || (qtype == MNET32_DNS_TYPE_ANY));
+    if (answer && (off + MNET32_DNS_ANSWER_LEN > size))
+        return 0;
+
+    msg[2] = flags;
+    msg[3] = MNET32_DNS_RCODE_NOERROR;
+    mnet32_dns_put16(msg + 6, answer ? 1 : 0);  // ANCOUNT
+    mnet32_dns_put16(msg + 10, 0);              // ARCOUNT, strips EDNS
+
+    if (!answer)
+        return off;
+
+    uint8_t* ptr = msg + off;
+    ptr = mnet32_dns_put16(ptr, 0xc000 | MNET32_DNS_HEADER_LEN);
+    ptr = mnet32_dns_put16(ptr, MNET32_DNS_TYPE_A);
+    ptr = mnet32_dns_put16(ptr, MNET32_DNS_CLASS_IN);
+    ptr = mnet32_dns_put16(ptr, 0);
+    ptr = mnet32_dns_put16(ptr, MNET32_DNS_TTL);
+    ptr = mnet32_dns_put16(ptr, sizeof(address));
+    memcpy(ptr, &address, sizeof(address));
+
+    return off + MNET32_DNS_ANSWER_LEN;
+}
+
+// Documentation in header file!
+int mnet32_dns_open(struct mnet32_dns* dns, uint16_t port, uint32_t address) {
+    dns->address = address;
+    dns->answered = 0;
+    dns->dropped = 0;
+
+    dns->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (dns->socket < 0)
+        return -1;
+
+    struct timeval timeout = {
+        .tv_sec = MNET32_DNS_POLL_INTERVAL / 1000,
+        .tv_usec = (MNET32_DNS_POLL_INTERVAL % 1000) * 1000,
+    };
+    struct sockaddr_in local = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+
+    int opt = 1;
+    setsockopt(dns->socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    if ((setsockopt(dns->socket,
+                    SOL_SOCKET,
+                    SO_RCVTIMEO,
+                    &timeout,
+                    sizeof(timeout)) != 0) ||
+        (bind(dns->socket, (struct sockaddr*)&local, sizeof(local)) != 0)) {
+        int saved = errno;
+        close(dns->socket);
+        dns->socket = -1;
+        errno = saved;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Documentation in header file!
+int mnet32_dns_serve(struct mnet32_dns* dns) {
+    struct sockaddr_in peer;
+    socklen_t peer_len = sizeof(peer);
+
+    ssize_t len = recvfrom(dns->socket,
+                           dns->buffer,
+                           sizeof(dns->buffer),
+                           0,
+                           (struct sockaddr*)&peer,
+                           &peer_len);
+    if (len < 0) {
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+            return 0;
+        return -1;
+    }
+
+    size_t response = mnet32_dns_answer(dns->buffer,
+                                        (size_t)len,
+                                        sizeof(dns->buffer),
+                                        dns->address);
+    if (response == 0) {
+        dns->dropped++;
+        return 0;
+    }
+
+    /* A lost response is just retried by the client. */
+    if (sendto(dns->socket,
+               dns->buffer,
+               response,
+               0,
+               (struct sockaddr*)&peer,
+               peer_len) < 0) {
+        dns->dropped++;
+        return 0;
+    }
+
+    dns->answered++;
+    return 1;
+}
+
+// Documentation in header file!
+void mnet32_dns_close(struct mnet32_dns* dns) {
+    if (dns->socket >= 0)
+        close(dns->socket);
+    dns->socket = -1;
+}
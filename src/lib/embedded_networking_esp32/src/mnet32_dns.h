@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The DNS responder of the ``mnet32`` component's captive portal.
+ *
+ * In access point mode, every query for an address (type ``A``) is answered
+ * with the access point's own address, so clients reach the configuration
+ * interface by any name and their operating system detects the captive
+ * portal without waiting for timeouts.
+ *
+ * The responder does not allocate memory and only depends on the BSD socket
+ * API, so it builds with **ESP-IDF** (lwIP) and on a Linux host (see
+ * ``tools/mnet32/dns``).
+ *
+ * Errors are reported as ``-1`` with ``errno`` set, as there is no
+ * ``esp_err_t`` on the host.
+ *
+ * @file   mnet32_dns.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_DNS_H_
+#define SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_DNS_H_
+
+/* C's standard libraries. */
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * The UDP port of the DNS responder.
+ */
+#define MNET32_DNS_PORT 53
+
+/**
+ * The maximum length of a DNS message over UDP (without EDNS).
+ *
+ * Longer queries are dropped.
+ */
+#define MNET32_DNS_MSG_LEN 512
+
+/**
+ * The time to live of the answers, given in seconds.
+ *
+ * The value is short, so clients forget the fake addresses soon after the
+ * device is provisioned.
+ */
+#define MNET32_DNS_TTL 10
+
+/**
+ * The timespan to wait for a query (in milliseconds).
+ *
+ * This determines, how fast the responder's task reacts on a stop request.
+ */
+#define MNET32_DNS_POLL_INTERVAL 250
+
+/**
+ * The DNS responder.
+ *
+ * The members are managed by the responder and must not be modified, except
+ * for ``address``, which may be updated at any time.
+ */
+struct mnet32_dns {
+    int socket;
+    uint32_t address;  // network byte order
+    uint32_t answered;
+    uint32_t dropped;
+    uint8_t buffer[MNET32_DNS_MSG_LEN];
+};
+
+
+/**
+ * Turn a query into its response, in place.
+ *
+ * Queries for addresses (type ``A`` or ``ANY``, class ``IN``) are answered
+ * with ``address``. Other standard queries are answered without an answer
+ * record (so clients fall back to IPv4), other operations with
+ * ``NOTIMP``. Additional records of the query (e.g. EDNS) are stripped.
+ *
+ * @param msg     The query, which is overwritten with the response.
+ * @param len     The length of the query.
+ * @param size    The size of ``msg``.
+ * @param address The address to answer with (network byte order).
+ * @return size_t The length of the response, ``0`` if the query is malformed
+ *                and must be dropped.
+ */
+size_t mnet32_dns_answer(uint8_t* msg,
+                         size_t len,
+                         size_t size,
+                         uint32_t address);
+
+/**
+ * Open the socket of the responder.
+ *
+ * @param dns     The responder to be opened.
+ * @param port    The UDP port to listen on.
+ * @param address The address to answer with (network byte order).
+ * @return int ``0`` on success, ``-1`` on failure (with ``errno`` set).
+ */
+int mnet32_dns_open(struct mnet32_dns* dns, uint16_t port, uint32_t address);
+
+/**
+ * Wait for a query and answer it.
+ *
+ * The function waits for at most ::MNET32_DNS_POLL_INTERVAL milliseconds.
+ *
+ * @param dns The (opened) responder.
+ * @return int ``1`` if a query was answered, ``0`` if no query was received
+ *             or it was dropped and ``-1`` on failure (with ``errno`` set).
+ */
+int mnet32_dns_serve(struct mnet32_dns* dns);
+
+/**
+ * Close the socket of the responder.
+ *
+ * @param dns The responder to be closed.
+ */
+void mnet32_dns_close(struct mnet32_dns* dns);
+
+#endif  // SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_DNS_H_
@@ -0,0 +1,441 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Ethernet-related functions of the ``mnet32`` component.
+ *
+ * The Ethernet is driven by the ESP32's internal EMAC and an external PHY,
+ * which is selected by the component's configuration.
+ *
+ * Other than the WiFi, the Ethernet driver is kept running for the whole
+ * lifetime of the component, because the driver is required to detect the
+ * link. The Ethernet-specific state is kept in a dedicated ``eth_state``, as
+ * the ``medium_state`` is used by the WiFi while acting as fallback.
+ *
+ * **Resources:**
+ *   - https://github.com/espressif/esp-idf/tree/master/examples/ethernet/basic
+ *   - https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/network/esp_eth.html
+ *
+ * @file   mnet32_eth.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header. */
+#include "mnet32_eth.h"
+
+/* Other headers of the component. */
+#include "mnet32/mnet32.h"    // The public header
+#include "mnet32_internal.h"  // The private header
+#include "mnet32_state.h"     // manage the internal state
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* ESP-IDF's Ethernet library. */
+#include "esp_eth.h"
+
+/* This is ESP-IDF's event library. */
+#include "esp_event.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* ESP-IDF's network abstraction layer. */
+#include "esp_netif.h"
+
+/* FreeRTOS headers.
+ * - the ``FreeRTOS.h`` is required
+ * - ``timers.h`` for timers
+ */
+#include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * Ethernet-specific state information.
+ *
+ * Keeps references to the driver's components, the dedicated ``netif`` and
+ * the timer, that is used to control the handover between Ethernet and WiFi.
+ * ``deferred`` is set while the Ethernet link is ready, but the access point
+ * is still in use (see ::mnet32_eth_set_deferred ).
+ */
+struct eth_state {
+    esp_eth_handle_t handle;
+    esp_eth_mac_t* mac;
+    esp_eth_phy_t* phy;
+    esp_eth_netif_glue_handle_t glue;
+    esp_netif_t* interface;
+    TimerHandle_t handover_timer;
+    bool handover_pending;
+    bool deferred;
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "mnet32.eth";
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static esp_err_t mnet32_eth_init(void);
+#if MNET32_ETH_ENABLED
+static void mnet32_eth_handover_timeout(TimerHandle_t timer);
+static esp_eth_phy_t* mnet32_eth_phy_new(const eth_phy_config_t* phy_config);
+#endif
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+#if MNET32_ETH_ENABLED
+/**
+ * Create the PHY driver instance as specified by the configuration.
+ *
+ * @param phy_config The PHY's configuration.
+ * @return esp_eth_phy_t* The PHY instance or ``NULL``, if no PHY is selected.
+ */
+static esp_eth_phy_t* mnet32_eth_phy_new(const eth_phy_config_t* phy_config) {
+#if defined(CONFIG_MNET32_ETH_PHY_IP101)
+    return esp_eth_phy_new_ip101(phy_config);
+#elif defined(CONFIG_MNET32_ETH_PHY_LAN87XX)
+    return esp_eth_phy_new_lan87xx(phy_config);
+#elif defined(CONFIG_MNET32_ETH_PHY_RTL8201)
+    return esp_eth_phy_new_rtl8201(phy_config);
+#elif defined(CONFIG_MNET32_ETH_PHY_DP83848)
+    return esp_eth_phy_new_dp83848(phy_config);
+#else
+    return NULL;
+#endif
+}
+#endif  // MNET32_ETH_ENABLED
+
+/**
+ * Ethernet-specific initialization.
+ *
+ * Installs the driver (MAC and PHY), creates the ``netif``, registers
+ * ::mnet32_event_handler for ``ETH_EVENT`` occurences and finally starts the
+ * driver.
+ *
+ * @return esp_err_t ``ESP_OK`` on success, ``ESP_ERR_NOT_SUPPORTED`` if
+ *                   Ethernet is disabled, ``ESP_FAIL`` or the error code of
+ *                   the failing **ESP-IDF** function otherwise; see the
+ *                   provided log messages (of level ``ERROR`` and ``DEBUG``)
+ *                   for the actual reason of failure.
+ */
+static esp_err_t mnet32_eth_init(void) {
+    ESP_LOGV(TAG, "mnet32_eth_init()");
+
+#if MNET32_ETH_ENABLED
+    if (mnet32_state_is_eth_state_initialized()) {
+        ESP_LOGW(TAG, "Ethernet seems to be already initialized!");
+        return ESP_OK;
+    }
+
+    /* Allocate memory for the specific state information. */
+    if (mnet32_state_eth_state_init(sizeof(struct eth_state)) != ESP_OK) {
+        ESP_LOGE(TAG, "Could not allocate Ethernet state!");
+        return ESP_ERR_NO_MEM;
+    }
+    struct eth_state* eth = mnet32_state_get_eth_state();
+
+    eth->handover_timer =
+        xTimerCreate(NULL,
+                     pdMS_TO_TICKS(MNET32_ETH_HANDOVER_TIMEOUT),
+                     pdFALSE,
+                     (void*)0,
+                     mnet32_eth_handover_timeout);
+    if (eth->handover_timer == NULL) {
+        ESP_LOGE(TAG, "Could not create handover timer!");
+        return ESP_FAIL;
+    }
+
+    /* Create the driver instances (MAC and PHY). */
+    eth_mac_config_t mac_config = ETH_MAC_DEFAULT_CONFIG();
+    mac_config.smi_mdc_gpio_num = MNET32_ETH_MDC_GPIO;
+    mac_config.smi_mdio_gpio_num = MNET32_ETH_MDIO_GPIO;
+    eth->mac = esp_eth_mac_new_esp32(&mac_config);
+
+    eth_phy_config_t phy_config = ETH_PHY_DEFAULT_CONFIG();
+    phy_config.phy_addr = MNET32_ETH_PHY_ADDR;
+    phy_config.reset_gpio_num = MNET32_ETH_PHY_RST_GPIO;
+    eth->phy = mnet32_eth_phy_new(&phy_config);
+
+    if ((eth->mac == NULL) || (eth->phy == NULL)) {
+        ESP_LOGE(TAG, "Could not create Ethernet MAC/PHY instances!");
+        return ESP_FAIL;
+    }
+
+    esp_err_t esp_ret;
+
+    esp_eth_config_t eth_config = ETH_DEFAULT_CONFIG(eth->mac, eth->phy);
+    esp_ret = esp_eth_driver_install(&eth_config, &(eth->handle));
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Could not install Ethernet driver!");
+        ESP_LOGD(TAG,
+                 "'esp_eth_driver_install()' returned %s [%d]",
+                 esp_err_to_name(esp_ret),
+                 esp_ret);
+        return esp_ret;
+    }
+
+    /* Create the network interface and attach it to the driver. */
+    esp_netif_config_t netif_config = ESP_NETIF_DEFAULT_ETH();
+    eth->interface = esp_netif_new(&netif_config);
+    if (eth->interface == NULL) {
+        ESP_LOGE(TAG, "Could not create network interface for Ethernet!");
+        return ESP_FAIL;
+    }
+
+    esp_ret = esp_eth_set_default_handlers(eth->interface);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Could not set default handlers for Ethernet!");
+        ESP_LOGD(TAG,
+                 "'esp_eth_set_default_handlers()' returned %s [%d]",
+                 esp_err_to_name(esp_ret),
+                 esp_ret);
+        return esp_ret;
+    }
+
+    eth->glue = esp_eth_new_netif_glue(eth->handle);
+    esp_ret = esp_netif_attach(eth->interface, eth->glue);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Could not attach Ethernet driver to network interface!");
+        ESP_LOGD(TAG,
+                 "'esp_netif_attach()' returned %s [%d]",
+                 esp_err_to_name(esp_ret),
+                 esp_ret);
+        return esp_ret;
+    }
+
+    /* Register ETH_EVENT event handler. */
+    esp_ret = esp_event_handler_instance_register(
+        ETH_EVENT,
+        ESP_EVENT_ANY_ID,
+        mnet32_event_handler,
+        NULL,
+        (void**)mnet32_state_get_eth_event_handler_ptr());
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Could not attach ETH_EVENT event handler!");
+        ESP_LOGD(TAG,
+                 "'esp_event_handler_instance_register()' returned %s [%d]",
+                 esp_err_to_name(esp_ret),
+                 esp_ret);
+        return esp_ret;
+    }
+
+    esp_ret = esp_eth_start(eth->handle);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Could not start Ethernet!");
+        ESP_LOGD(TAG,
+                 "'esp_eth_start()' returned %s [%d]",
+                 esp_err_to_name(esp_ret),
+                 esp_ret);
+        return esp_ret;
+    }
+
+    /* At this point, the Ethernet driver is started. All further actions
+     * will be triggered by ::mnet32_event_handler
+     */
+    return ESP_OK;
+#else
+    ESP_LOGD(TAG, "Ethernet is disabled by configuration!");
+    return ESP_ERR_NOT_SUPPORTED;
+#endif  // MNET32_ETH_ENABLED
+}
+
+esp_err_t mnet32_eth_deinit(void) {
+    ESP_LOGV(TAG, "mnet32_eth_deinit()");
+
+    if (!mnet32_state_is_eth_state_initialized())
+        return ESP_OK;
+
+    struct eth_state* eth = mnet32_state_get_eth_state();
+
+    if (mnet32_state_is_medium_ethernet())
+        mnet32_eth_deactivate();
+
+    /* Unregister the ETH_EVENT event handler. */
+    esp_err_t esp_ret = esp_event_handler_instance_unregister(
+        ETH_EVENT,
+        ESP_EVENT_ANY_ID,
+        mnet32_state_get_eth_event_handler());
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Could not unregister ETH_EVENT event handler!");
+        ESP_LOGD(TAG,
+                 "'esp_event_handler_instance_unregister()' returned %s [%d]",
+                 esp_err_to_name(esp_ret),
+                 esp_ret);
+        ESP_LOGW(TAG, "Continuing with de-initialization...");
+    }
+
+    if (eth->handover_timer != NULL) {
+        xTimerStop(eth->handover_timer, (TickType_t)0);
+        xTimerDelete(eth->handover_timer, (TickType_t)0);
+    }
+
+    if (eth->handle != NULL) {
+        esp_ret = esp_eth_stop(eth->handle);
+        if (esp_ret != ESP_OK) {
+            ESP_LOGE(TAG, "Could not stop Ethernet!");
+            ESP_LOGD(TAG,
+                     "'esp_eth_stop()' returned %s [%d]",
+                     esp_err_to_name(esp_ret),
+                     esp_ret);
+            ESP_LOGW(TAG, "Continuing with de-initialization...");
+        }
+    }
+
+    if (eth->glue != NULL)
+        esp_eth_del_netif_glue(eth->glue);
+
+    if (eth->interface != NULL) {
+        esp_eth_clear_default_handlers(eth->interface);
+        esp_netif_destroy(eth->interface);
+    }
+
+    if (eth->handle != NULL) {
+        esp_ret = esp_eth_driver_uninstall(eth->handle);
+        if (esp_ret != ESP_OK) {
+            ESP_LOGE(TAG, "Could not uninstall Ethernet driver!");
+            ESP_LOGD(TAG,
+                     "'esp_eth_driver_uninstall()' returned %s [%d]",
+                     esp_err_to_name(esp_ret),
+                     esp_ret);
+        }
+    }
+
+    if (eth->phy != NULL)
+        eth->phy->del(eth->phy);
+
+    if (eth->mac != NULL)
+        eth->mac->del(eth->mac);
+
+    mnet32_state_eth_state_destroy();
+
+    return ESP_OK;
+}
+
+void mnet32_eth_activate(void) {
+    ESP_LOGV(TAG, "mnet32_eth_activate()");
+
+    struct eth_state* eth = mnet32_state_get_eth_state();
+
+    eth->deferred = false;
+    mnet32_state_set_medium_ethernet();
+    mnet32_state_clear_mode();
+    mnet32_state_set_interface(eth->interface);
+}
+
+void mnet32_eth_deactivate(void) {
+    ESP_LOGV(TAG, "mnet32_eth_deactivate()");
+
+    mnet32_state_clear_interface();
+    mnet32_state_clear_medium();
+}
+
+#if MNET32_ETH_ENABLED
+/**
+ * Notify ::mnet32_task that the handover timer expired.
+ *
+ * @param timer The timer object this function is attached to.
+ */
+static void mnet32_eth_handover_timeout(TimerHandle_t timer) {
+    ESP_LOGV(TAG, "mnet32_eth_handover_timeout()");
+
+    mnet32_notify(MNET32_NOTIFICATION_EVENT_ETH_HANDOVER_TIMEOUT);
+}
+#endif  // MNET32_ETH_ENABLED
+
+void mnet32_eth_handover_begin(void) {
+    ESP_LOGV(TAG, "mnet32_eth_handover_begin()");
+
+    struct eth_state* eth = mnet32_state_get_eth_state();
+
+    eth->handover_pending = true;
+    xTimerReset(eth->handover_timer, (TickType_t)0);
+    ESP_LOGD(TAG, "Handover timer started!");
+}
+
+void mnet32_eth_handover_complete(void) {
+    ESP_LOGV(TAG, "mnet32_eth_handover_complete()");
+
+    if (!mnet32_state_is_eth_state_initialized())
+        return;
+
+    struct eth_state* eth = mnet32_state_get_eth_state();
+
+    if (xTimerIsTimerActive(eth->handover_timer) == pdTRUE) {
+        xTimerStop(eth->handover_timer, (TickType_t)0);
+        ESP_LOGD(TAG, "Handover timer stopped!");
+    }
+
+    if (eth->handover_pending) {
+        ESP_LOGI(TAG, "Handover to WiFi completed!");
+        eth->handover_pending = false;
+    }
+}
+
+bool mnet32_eth_handover_is_pending(void) {
+    if (!mnet32_state_is_eth_state_initialized())
+        return false;
+
+    return ((struct eth_state*)mnet32_state_get_eth_state())->handover_pending;
+}
+
+void mnet32_eth_set_deferred(bool deferred) {
+    ESP_LOGV(TAG, "mnet32_eth_set_deferred()");
+
+    if (!mnet32_state_is_eth_state_initialized())
+        return;
+
+    ((struct eth_state*)mnet32_state_get_eth_state())->deferred = deferred;
+}
+
+bool mnet32_eth_is_deferred(void) {
+    if (!mnet32_state_is_eth_state_initialized())
+        return false;
+
+    return ((struct eth_state*)mnet32_state_get_eth_state())->deferred;
+}
+
+void mnet32_eth_link_timer_start(void) {
+    ESP_LOGV(TAG, "mnet32_eth_link_timer_start()");
+
+    struct eth_state* eth = mnet32_state_get_eth_state();
+
+    eth->handover_pending = false;
+    xTimerReset(eth->handover_timer, (TickType_t)0);
+    ESP_LOGD(TAG, "Waiting for Ethernet link...");
+}
+
+esp_err_t mnet32_eth_start(void) {
+    ESP_LOGV(TAG, "mnet32_eth_start()");
+
+    esp_err_t esp_ret = mnet32_eth_init();
+    if (esp_ret != ESP_OK) {
+        mnet32_eth_deinit();
+        return esp_ret;
+    }
+
+    return ESP_OK;
+}
@@ -0,0 +1,116 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+#ifndef SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_ETH_H_
+#define SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_ETH_H_
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+
+/**
+ * Switch the component to Ethernet as the active medium.
+ *
+ * Sets ``state->medium`` to ``MNET32_MEDIUM_ETHERNET``, ``state->mode`` to
+ * ``MNET32_MODE_NOT_APPLICABLE`` and provides a reference to the Ethernet's
+ * ``netif`` in ``state->interface``.
+ *
+ * The calling code is responsible for shutting down the WiFi before calling
+ * this function (see ::mnet32_wifi_deinit ).
+ */
+void mnet32_eth_activate(void);
+
+/**
+ * Release Ethernet as the active medium.
+ *
+ * This resets ``state->medium`` and ``state->interface``, but keeps the
+ * Ethernet driver running, so that the link can be detected again.
+ */
+void mnet32_eth_deactivate(void);
+
+/**
+ * Ethernet-specific deinitialization.
+ *
+ * Stops the Ethernet driver, unregisters ::mnet32_event_handler from
+ * ``ETH_EVENT``, destroys the ``netif`` and frees the Ethernet-specific state.
+ *
+ * @return esp_err_t This function always returns ``ESP_OK``, all potentially
+ *                   failing calls are catched and silenced, though log
+ *                   messages of level ``ERROR`` and ``DEBUG`` are emitted.
+ */
+esp_err_t mnet32_eth_deinit(void);
+
+/**
+ * Finish a pending handover from Ethernet to WiFi.
+ *
+ * This function is meant to be called whenever the WiFi becomes ready. If
+ * there is a pending handover (see ::mnet32_eth_handover_begin ), the handover
+ * timer is stopped.
+ *
+ * It is safe to call this function, if Ethernet is not used at all.
+ */
+void mnet32_eth_handover_complete(void);
+
+/**
+ * Begin the handover from Ethernet to WiFi.
+ *
+ * Marks the handover as pending and starts the handover timer. If WiFi does
+ * not become ready before the timer expires, ::mnet32_task will emit
+ * ``MNET32_EVENT_UNAVAILABLE``.
+ */
+void mnet32_eth_handover_begin(void);
+
+/**
+ * Check if there is a pending handover from Ethernet to WiFi.
+ *
+ * @return bool ``true`` if ::mnet32_eth_handover_begin was called and the
+ *              handover was not yet completed.
+ */
+bool mnet32_eth_handover_is_pending(void);
+
+/**
+ * Mark the Ethernet as ready, but not yet activated.
+ *
+ * The Ethernet link may come up while stations are connected to the access
+ * point. The access point is kept running and the Ethernet is activated
+ * after the last station disconnected (see ::mnet32_eth_is_deferred ).
+ * ::mnet32_eth_activate resets the flag.
+ *
+ * It is safe to call this function, if Ethernet is not used at all.
+ *
+ * @param deferred ``true`` if the activation is deferred, ``false`` if the
+ *                 Ethernet link went down in the meantime.
+ */
+void mnet32_eth_set_deferred(bool deferred);
+
+/**
+ * Check if the activation of the Ethernet is deferred.
+ *
+ * @return bool ``true`` if the Ethernet link is ready and waits for the
+ *              access point to become idle.
+ */
+bool mnet32_eth_is_deferred(void);
+
+/**
+ * Start the handover timer to wait for the Ethernet link.
+ *
+ * This is used during startup. If the timer expires before the Ethernet link
+ * is up, ::mnet32_task starts the WiFi.
+ */
+void mnet32_eth_link_timer_start(void);
+
+/**
+ * Starts the Ethernet.
+ *
+ * Installs the Ethernet driver, attaches it to a dedicated ``netif`` and
+ * starts it. The actual link detection is performed asynchronously, all
+ * further actions are triggered by ::mnet32_event_handler .
+ *
+ * @return esp_err_t ``ESP_OK`` on success, ``ESP_ERR_NOT_SUPPORTED`` if
+ *                   Ethernet is disabled by the component's configuration,
+ *                   ``ESP_FAIL`` on failure.
+ */
+esp_err_t mnet32_eth_start(void);
+
+#endif  // SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_ETH_H_
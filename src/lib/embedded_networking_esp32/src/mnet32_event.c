@@ -0,0 +1,406 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Event delivery of the ``mnet32`` component.
+ *
+ * The component's events (``MNET32_EVENTS``) are either posted to
+ * **ESP-IDF**'s default event loop or to a dedicated event loop with its own
+ * task, queue size and priority (see ::MNET32_EVENT_LOOP_DEDICATED ). The
+ * dedicated loop ensures, that ``MNET32_EVENT_UNAVAILABLE`` is not dropped
+ * while the (shared) default event loop is busy.
+ *
+ * The module keeps track of the number of posted and dropped events and of
+ * the maximum dispatch latency. The latency is measured by an internal
+ * handler, that is registered before any other handler and is therefore the
+ * first handler to be executed for every event.
+ *
+ * @file   mnet32_event.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header. */
+#include "mnet32_event.h"
+
+/* Other headers of the component. */
+#include "mnet32/mnet32.h"  // The public header
+#include "mnet32_trace.h"    // trace the posting and dispatching of events
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* This is ESP-IDF's event library. */
+#include "esp_event.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* ESP-IDF's high resolution timer, used to measure the dispatch latency. */
+#include "esp_timer.h"
+
+/* FreeRTOS headers.
+ * - the ``FreeRTOS.h`` is required
+ */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The number of timestamps to keep for the latency measurement.
+ *
+ * This must be at least the number of events, that might be queued in the
+ * event loop at the same time. If more events are queued, their latency is
+ * not measured.
+ */
+#define MNET32_EVENT_LATENCY_SLOTS 16
+
+
+/* ***** TYPES ************************************************************* */
+
+/* Define the component-specific event base. */
+ESP_EVENT_DEFINE_BASE(MNET32_EVENTS);
+
+/**
+ * The initialization of the event loop, see ::mnet32_event_loop_init .
+ */
+enum mnet32_event_loop_state {
+    MNET32_EVENT_LOOP_UNINITIALIZED,
+    MNET32_EVENT_LOOP_INITIALIZING,
+    MNET32_EVENT_LOOP_INITIALIZED,
+};
+
+/**
+ * Timestamps of posted, but not yet dispatched events.
+ *
+ * Events are dispatched in the order they are posted, so a simple ring buffer
+ * is sufficient to match the dispatch with the corresponding post.
+ */
+struct mnet32_event_latency_ring {
+    int64_t posted_at[MNET32_EVENT_LATENCY_SLOTS];
+    uint8_t head;
+    uint8_t tail;
+    uint8_t count;
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "mnet32.event";
+
+/**
+ * The dedicated event loop.
+ *
+ * This is ``NULL`` if the default event loop is used.
+ */
+static esp_event_loop_handle_t mnet32_event_loop = NULL;
+
+/**
+ * Track, if ::mnet32_event_loop_init was successfully executed.
+ *
+ * This is protected by ::mnet32_event_lock , because handlers may be
+ * registered by other tasks while the component is started.
+ */
+static enum mnet32_event_loop_state mnet32_event_loop_state =
+    MNET32_EVENT_LOOP_UNINITIALIZED;
+
+/**
+ * The delivery statistics, see ::mnet32_event_get_stats .
+ */
+static struct mnet32_event_stats mnet32_event_stats = {0};
+
+/**
+ * Timestamps of pending events.
+ */
+static struct mnet32_event_latency_ring mnet32_event_latency = {0};
+
+/**
+ * Protect ::mnet32_event_latency, ::mnet32_event_stats and
+ * ::mnet32_event_loop_state, as they are accessed from the posting task, the
+ * event loop's task and the tasks registering handlers.
+ */
+static portMUX_TYPE mnet32_event_lock = portMUX_INITIALIZER_UNLOCKED;
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static void mnet32_event_latency_probe(void* arg,
+                                       esp_event_base_t event_base,
+                                       int32_t event_id,
+                                       void* event_data);
+static esp_err_t mnet32_event_register(int32_t event_id,
+                                       esp_event_handler_t handler,
+                                       void* handler_arg,
+                                       esp_event_handler_instance_t* instance);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Measure the dispatch latency of ``MNET32_EVENTS``.
+ *
+ * This handler is registered for all ``MNET32_EVENTS`` before any other
+ * handler, so it is executed first for every event.
+ *
+ * @param arg        Not used.
+ * @param event_base Not used, always ``MNET32_EVENTS``.
+ * @param event_id   The event, the argument of the trace point.
+ * @param event_data Not used.
+ */
+static void mnet32_event_latency_probe(void* arg,
+                                       esp_event_base_t event_base,
+                                       int32_t event_id,
+                                       void* event_data) {
+    int64_t now = esp_timer_get_time();
+
+    obs32_trace_instant(&mnet32_trace_group,
+                        MNET32_TRACE_EVENT_DISPATCH,
+                        (uint16_t)event_id);
+
+    portENTER_CRITICAL(&mnet32_event_lock);
+    if (mnet32_event_latency.count > 0) {
+        int64_t latency =
+            now - mnet32_event_latency.posted_at[mnet32_event_latency.tail];
+        mnet32_event_latency.tail =
+            (mnet32_event_latency.tail + 1) % MNET32_EVENT_LATENCY_SLOTS;
+        mnet32_event_latency.count--;
+
+        if (latency > mnet32_event_stats.max_dispatch_latency_us)
+            mnet32_event_stats.max_dispatch_latency_us = (uint32_t)latency;
+    }
+    portEXIT_CRITICAL(&mnet32_event_lock);
+}
+
+/**
+ * Register a handler for ``MNET32_EVENTS`` with the actual event loop.
+ *
+ * The event loop must be initialized, see ::mnet32_event_handler_register .
+ */
+static esp_err_t mnet32_event_register(int32_t event_id,
+                                       esp_event_handler_t handler,
+                                       void* handler_arg,
+                                       esp_event_handler_instance_t* instance) {
+    if (mnet32_event_loop == NULL) {
+        return esp_event_handler_instance_register(MNET32_EVENTS,
+                                                   event_id,
+                                                   handler,
+                                                   handler_arg,
+                                                   instance);
+    }
+
+    return esp_event_handler_instance_register_with(mnet32_event_loop,
+                                                    MNET32_EVENTS,
+                                                    event_id,
+                                                    handler,
+                                                    handler_arg,
+                                                    instance);
+}
+
+esp_err_t mnet32_event_loop_init(void) {
+    ESP_LOGV(TAG, "mnet32_event_loop_init()");
+
+    /* Exactly one task performs the initialization. The loop can not be
+     * created inside of the critical section, so other tasks wait for it to
+     * finish.
+     */
+    for (;;) {
+        portENTER_CRITICAL(&mnet32_event_lock);
+        enum mnet32_event_loop_state loop_state = mnet32_event_loop_state;
+        if (loop_state == MNET32_EVENT_LOOP_UNINITIALIZED)
+            mnet32_event_loop_state = MNET32_EVENT_LOOP_INITIALIZING;
+        portEXIT_CRITICAL(&mnet32_event_lock);
+
+        if (loop_state == MNET32_EVENT_LOOP_INITIALIZED)
+            return ESP_OK;
+        if (loop_state == MNET32_EVENT_LOOP_UNINITIALIZED)
+            break;
+        vTaskDelay(1);
+    }
+
+    esp_err_t esp_ret;
+
+    if (MNET32_EVENT_LOOP_DEDICATED) {
+        esp_event_loop_args_t loop_args = {
+            .queue_size = MNET32_EVENT_LOOP_QUEUE_SIZE,
+            .task_name = "mnet32_events",
+            .task_priority = MNET32_EVENT_LOOP_TASK_PRIORITY,
+            .task_stack_size = MNET32_EVENT_LOOP_TASK_STACK_SIZE,
+            .task_core_id = tskNO_AFFINITY,
+        };
+
+        esp_ret = esp_event_loop_create(&loop_args, &mnet32_event_loop);
+        if (esp_ret != ESP_OK) {
+            ESP_LOGE(TAG, "Could not create dedicated event loop!");
+            ESP_LOGD(TAG,
+                     "'esp_event_loop_create()' returned %s [%d]",
+                     esp_err_to_name(esp_ret),
+                     esp_ret);
+            portENTER_CRITICAL(&mnet32_event_lock);
+            mnet32_event_loop_state = MNET32_EVENT_LOOP_UNINITIALIZED;
+            portEXIT_CRITICAL(&mnet32_event_lock);
+            return esp_ret;
+        }
+        ESP_LOGD(TAG, "Dedicated event loop created!");
+    }
+
+    /* The probe must be the very first handler. */
+    esp_ret = mnet32_event_register(ESP_EVENT_ANY_ID,
+                                    mnet32_event_latency_probe,
+                                    NULL,
+                                    NULL);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGW(TAG, "Could not attach latency probe!");
+        ESP_LOGD(TAG,
+                 "'mnet32_event_register()' returned %s [%d]",
+                 esp_err_to_name(esp_ret),
+                 esp_ret);
+    }
+
+    portENTER_CRITICAL(&mnet32_event_lock);
+    mnet32_event_loop_state = MNET32_EVENT_LOOP_INITIALIZED;
+    portEXIT_CRITICAL(&mnet32_event_lock);
+
+    return ESP_OK;
+}
+
+void mnet32_emit_event(int32_t event_id,
+                       void* event_data,
+                       size_t event_data_size) {
+    ESP_LOGV(TAG, "mnet32_emit_event()");
+
+    if (mnet32_event_loop_init() != ESP_OK) {
+        portENTER_CRITICAL(&mnet32_event_lock);
+        mnet32_event_stats.dropped++;
+        portEXIT_CRITICAL(&mnet32_event_lock);
+        return;
+    }
+
+    if (event_data == NULL) {
+        ESP_LOGV(TAG, "Event without context data!");
+        event_data_size = 0;
+    } else {
+        ESP_LOGV(TAG, "Event with context data!");
+    }
+
+    /* Claim a timestamp slot *before* posting, because the event might be
+     * dispatched before ``esp_event_post()`` returns.
+     */
+    bool slot_claimed = false;
+    uint8_t slot = 0;
+    portENTER_CRITICAL(&mnet32_event_lock);
+    if (mnet32_event_latency.count < MNET32_EVENT_LATENCY_SLOTS) {
+        slot = mnet32_event_latency.head;
+        mnet32_event_latency.posted_at[slot] = esp_timer_get_time();
+        mnet32_event_latency.head = (slot + 1) % MNET32_EVENT_LATENCY_SLOTS;
+        mnet32_event_latency.count++;
+        slot_claimed = true;
+    }
+    portEXIT_CRITICAL(&mnet32_event_lock);
+
+    obs32_trace_instant(&mnet32_trace_group,
+                        MNET32_TRACE_EVENT_POST,
+                        (uint16_t)event_id);
+
+    esp_err_t esp_ret;
+    if (mnet32_event_loop == NULL) {
+        esp_ret = esp_event_post(MNET32_EVENTS,
+                                 event_id,
+                                 event_data,
+                                 event_data_size,
+                                 pdMS_TO_TICKS(MNET32_EVENT_POST_TIMEOUT));
+    } else {
+        esp_ret = esp_event_post_to(mnet32_event_loop,
+                                    MNET32_EVENTS,
+                                    event_id,
+                                    event_data,
+                                    event_data_size,
+                                    pdMS_TO_TICKS(MNET32_EVENT_POST_TIMEOUT));
+    }
+
+    if (esp_ret == ESP_OK) {
+        portENTER_CRITICAL(&mnet32_event_lock);
+        mnet32_event_stats.posted++;
+        portEXIT_CRITICAL(&mnet32_event_lock);
+        return;
+    }
+
+    /* The event was not queued, so the probe will never consume the slot.
+     * As no later post can be dispatched before this one was released, the
+     * claimed slot is still the most recent one.
+     */
+    portENTER_CRITICAL(&mnet32_event_lock);
+    if (slot_claimed) {
+        mnet32_event_latency.head = slot;
+        mnet32_event_latency.count--;
+    }
+    mnet32_event_stats.dropped++;
+    portEXIT_CRITICAL(&mnet32_event_lock);
+
+    ESP_LOGW(TAG, "Could not emit event!");
+    ESP_LOGD(TAG,
+             "esp_event_post() returned %s [%d]",
+             esp_err_to_name(esp_ret),
+             esp_ret);
+    ESP_LOGD(TAG, "event_base....... %s", MNET32_EVENTS);
+    ESP_LOGD(TAG, "event_id......... %d", event_id);
+    ESP_LOGD(TAG, "event_data....... %p", event_data);
+    ESP_LOGD(TAG, "event_data_size.. %u", (unsigned int)event_data_size);
+}
+
+// This function is part of the component's public interface and documented in
+// ``include/mnet32/mnet32.h``
+esp_err_t mnet32_event_handler_register(
+    int32_t event_id,
+    esp_event_handler_t handler,
+    void* handler_arg,
+    esp_event_handler_instance_t* instance) {
+    esp_err_t esp_ret = mnet32_event_loop_init();
+    if (esp_ret != ESP_OK)
+        return esp_ret;
+
+    return mnet32_event_register(event_id, handler, handler_arg, instance);
+}
+
+// This function is part of the component's public interface and documented in
+// ``include/mnet32/mnet32.h``
+esp_err_t mnet32_event_handler_unregister(
+    int32_t event_id,
+    esp_event_handler_instance_t instance) {
+    if (mnet32_event_loop == NULL) {
+        return esp_event_handler_instance_unregister(MNET32_EVENTS,
+                                                     event_id,
+                                                     instance);
+    }
+
+    return esp_event_handler_instance_unregister_with(mnet32_event_loop,
+                                                      MNET32_EVENTS,
+                                                      event_id,
+                                                      instance);
+}
+
+// This function is part of the component's public interface and documented in
+// ``include/mnet32/mnet32.h``
+void mnet32_event_get_stats(struct mnet32_event_stats* stats) {
+    portENTER_CRITICAL(&mnet32_event_lock);
+    *stats = mnet32_event_stats;
+    portEXIT_CRITICAL(&mnet32_event_lock);
+}
@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+#ifndef SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_EVENT_H_
+#define SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_EVENT_H_
+
+/* C's standard libraries. */
+#include <stddef.h>
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* This is ESP-IDF's event library. */
+#include "esp_event.h"
+
+
+/**
+ * Emit component-specific events.
+ *
+ * The events will be posted to the event loop as specified by the
+ * component's configuration, which is either **ESP-IDF**'s default event loop
+ * or a dedicated event loop (see ::MNET32_EVENT_LOOP_DEDICATED ).
+ *
+ * If the event loop is already filled, the function will block for at most
+ * ::MNET32_EVENT_POST_TIMEOUT. If the event could not be posted, it is lost
+ * and counted as *dropped*.
+ *
+ * @param event_id   The actual events are defined in mnet32.h and may be
+ *                   referenced by their human-readable name in the ``enum``.
+ * @param event_data Optional pointer to event-specific context data. This
+ *                   might be set to ``NULL`` to emit events without contextual
+ *                   data.
+ *                   The calling function has to allocate (and free) the actual
+ *                   memory for the context data. It may be free'd after this
+ *                   function returned, because **ESP-IDF**'s event loop will
+ *                   manage a copy of this data, once the event is posted to the
+ *                   loop.
+ * @param event_data_size The size of the context data in bytes, i.e. the
+ *                        number of bytes to be copied from ``event_data``
+ *                        (**not** the size of the pointer). Ignored, if
+ *                        ``event_data`` is ``NULL``.
+ */
+void mnet32_emit_event(int32_t event_id,
+                       void* event_data,
+                       size_t event_data_size);
+
+/**
+ * Initialize the event loop for ``MNET32_EVENTS``.
+ *
+ * Creates the dedicated event loop (if configured) and registers the internal
+ * handler that measures the dispatch latency. This is done exactly once, all
+ * subsequent calls are no-ops. Concurrent calls wait until the initialization
+ * is finished.
+ *
+ * @return esp_err_t ``ESP_OK`` on success, the error code of
+ *                   ``esp_event_loop_create()`` or
+ *                   ``esp_event_handler_instance_register_with()`` otherwise.
+ */
+esp_err_t mnet32_event_loop_init(void);
+
+#endif  // SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_EVENT_H_
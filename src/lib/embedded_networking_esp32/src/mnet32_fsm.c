@@ -0,0 +1,221 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The state machine engine of the ``mnet32`` component.
+ *
+ * The actual state machine is specified as a table of transitions in
+ * mnet32.c . This module selects and executes the transitions, counts
+ * invalid transitions and keeps a fixed-size binary trace of the most recent
+ * transitions, which may be dumped (see ::mnet32_fsm_trace_dump ) and
+ * decoded / replayed on the host (``tools/mnet32/trace.py``).
+ *
+ * @file   mnet32_fsm.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header. */
+#include "mnet32_fsm.h"
+
+/* C's standard libraries. */
+#include <string.h>
+
+/* Other headers of the component. */
+#include "mnet32_state.h"  // manage the internal state
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* ESP-IDF's high resolution timer, used to timestamp the trace records. */
+#include "esp_timer.h"
+
+/* FreeRTOS headers.
+ * - the ``FreeRTOS.h`` is required
+ */
+#include "freertos/FreeRTOS.h"
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * The trace ring.
+ *
+ * ``next`` is the index of the next record to be written, ``count`` is the
+ * number of valid records (at most ::MNET32_FSM_TRACE_LEN ).
+ */
+struct mnet32_fsm_trace {
+    struct mnet32_fsm_trace_record records[MNET32_FSM_TRACE_LEN];
+    uint16_t next;
+    uint16_t count;
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "mnet32.fsm";
+
+/**
+ * The trace of the most recent transitions.
+ *
+ * This is kept independently from the component's internal state, so the
+ * trace survives a restart of the component.
+ */
+static struct mnet32_fsm_trace mnet32_fsm_trace = {0};
+
+/**
+ * The number of notifications without matching transition.
+ */
+static uint32_t mnet32_fsm_invalid_transitions = 0;
+
+/**
+ * Protect ::mnet32_fsm_trace, as it is written by the component's task and
+ * read by the http server's task.
+ */
+static portMUX_TYPE mnet32_fsm_lock = portMUX_INITIALIZER_UNLOCKED;
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static void mnet32_fsm_trace_record(uint8_t from,
+                                    uint8_t notification,
+                                    uint8_t to);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Add a record to the trace ring, overwriting the oldest record.
+ *
+ * @param from         The status before the transition.
+ * @param notification The processed notification.
+ * @param to           The status after the transition.
+ */
+static void mnet32_fsm_trace_record(uint8_t from,
+                                    uint8_t notification,
+                                    uint8_t to) {
+    struct mnet32_fsm_trace_record record = {
+        .timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000),
+        .from = from,
+        .notification = notification,
+        .to = to,
+        .reserved = 0,
+    };
+
+    portENTER_CRITICAL(&mnet32_fsm_lock);
+    mnet32_fsm_trace.records[mnet32_fsm_trace.next] = record;
+    mnet32_fsm_trace.next = (mnet32_fsm_trace.next + 1) % MNET32_FSM_TRACE_LEN;
+    if (mnet32_fsm_trace.count < MNET32_FSM_TRACE_LEN)
+        mnet32_fsm_trace.count++;
+    portEXIT_CRITICAL(&mnet32_fsm_lock);
+}
+
+void mnet32_fsm_dispatch(const struct mnet32_fsm_transition* table,
+                         size_t table_len,
+                         uint32_t notification) {
+    ESP_LOGV(TAG, "mnet32_fsm_dispatch()");
+
+    uint8_t from = mnet32_state_get_status();
+    const struct mnet32_fsm_transition* transition = NULL;
+
+    for (size_t i = 0; i < table_len; i++) {
+        if (table[i].notification != notification)
+            continue;
+        if ((table[i].from_mask & MNET32_FSM_FROM(from)) == 0)
+            continue;
+        if ((table[i].guard != NULL) && !table[i].guard())
+            continue;
+
+        transition = &table[i];
+        break;
+    }
+
+    if (transition == NULL) {
+        mnet32_fsm_invalid_transitions++;
+        mnet32_fsm_trace_record(from,
+                                (uint8_t)notification,
+                                MNET32_FSM_INVALID);
+        ESP_LOGW(TAG,
+                 "Invalid transition: notification %d in status %d",
+                 notification,
+                 from);
+        return;
+    }
+
+    uint8_t to = (transition->to == MNET32_FSM_KEEP) ? from : transition->to;
+    mnet32_fsm_trace_record(from, (uint8_t)notification, to);
+    ESP_LOGD(TAG, "Transition: %d --(%d)--> %d", from, notification, to);
+
+    /* The status is applied *before* the action, so the events emitted by
+     * the action (e.g. ``MNET32_EVENT_READY``) are consistent with the
+     * status. Besides, the action might destroy the internal state (see
+     * ``MNET32_NOTIFICATION_CMD_NETWORKING_STOP``).
+     */
+    if (transition->to != MNET32_FSM_KEEP)
+        mnet32_state_set_status(transition->to);
+
+    if (transition->action != NULL)
+        transition->action();
+}
+
+uint32_t mnet32_fsm_get_invalid_transitions(void) {
+    return mnet32_fsm_invalid_transitions;
+}
+
+size_t mnet32_fsm_trace_dump(uint8_t* buffer, size_t buf_size) {
+    ESP_LOGV(TAG, "mnet32_fsm_trace_dump()");
+
+    const size_t header_size = sizeof(struct mnet32_fsm_trace_header);
+    const size_t record_size = sizeof(struct mnet32_fsm_trace_record);
+
+    if (buf_size < header_size)
+        return 0;
+
+    size_t max_records = (buf_size - header_size) / record_size;
+    struct mnet32_fsm_trace_header header = {
+        .magic = MNET32_FSM_TRACE_MAGIC,
+        .version = MNET32_FSM_TRACE_VERSION,
+        .record_size = (uint8_t)record_size,
+        .count = 0,
+        .invalid_transitions = mnet32_fsm_invalid_transitions,
+    };
+    uint8_t* out = buffer + header_size;
+
+    portENTER_CRITICAL(&mnet32_fsm_lock);
+    uint16_t count = mnet32_fsm_trace.count;
+    if (count > max_records)
+        count = (uint16_t)max_records;
+
+    /* Index of the oldest record to be included. */
+    uint16_t index =
+        (mnet32_fsm_trace.next + MNET32_FSM_TRACE_LEN - count) %
+        MNET32_FSM_TRACE_LEN;
+    for (uint16_t i = 0; i < count; i++) {
+        memcpy(out, &mnet32_fsm_trace.records[index], record_size);
+        out += record_size;
+        index = (index + 1) % MNET32_FSM_TRACE_LEN;
+    }
+    portEXIT_CRITICAL(&mnet32_fsm_lock);
+
+    header.count = count;
+    memcpy(buffer, &header, header_size);
+
+    return header_size + (count * record_size);
+}
@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+#ifndef SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_FSM_H_
+#define SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_FSM_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * Build the ``from_mask`` of a transition from a single ::mnet32_status.
+ */
+#define MNET32_FSM_FROM(status) ((uint8_t)(1U << (status)))
+
+/**
+ * The ``from_mask`` of a transition that is valid in any status.
+ */
+#define MNET32_FSM_FROM_ANY ((uint8_t)0xFF)
+
+/**
+ * The ``to`` of a transition that does not change the status.
+ */
+#define MNET32_FSM_KEEP ((uint8_t)0xFE)
+
+/**
+ * The ``to`` of a trace record of an invalid transition.
+ */
+#define MNET32_FSM_INVALID ((uint8_t)0xFF)
+
+/**
+ * The number of records in the trace ring.
+ */
+#define MNET32_FSM_TRACE_LEN 64
+
+/**
+ * Magic bytes at the start of a trace dump (``"M32T"``).
+ */
+#define MNET32_FSM_TRACE_MAGIC 0x5432334D
+
+/**
+ * Version of the trace dump format.
+ */
+#define MNET32_FSM_TRACE_VERSION 1
+
+/**
+ * A single transition of the component's state machine.
+ *
+ * The state machine is specified by a table of transitions. For a given
+ * status (see ::mnet32_status ) and notification (see
+ * ::mnet32_task_notification ), the first transition whose ``from_mask``
+ * includes the current status and whose ``guard`` (if any) returns ``true``
+ * is selected. The status is set to ``to`` (unless ``to`` is
+ * ::MNET32_FSM_KEEP), then its ``action`` (if any) is executed.
+ */
+struct mnet32_fsm_transition {
+    uint8_t from_mask;
+    uint8_t notification;
+    bool (*guard)(void);
+    void (*action)(void);
+    uint8_t to;
+};
+
+/**
+ * A single record of the trace ring.
+ *
+ * The records are stored in a compact binary format, which is exactly the
+ * format of a trace dump (little endian).
+ */
+struct __attribute__((packed)) mnet32_fsm_trace_record {
+    uint32_t timestamp_ms;
+    uint8_t from;
+    uint8_t notification;
+    uint8_t to;
+    uint8_t reserved;
+};
+
+/**
+ * The header of a trace dump.
+ *
+ * It is followed by ``count`` records (see ::mnet32_fsm_trace_record ),
+ * oldest first.
+ */
+struct __attribute__((packed)) mnet32_fsm_trace_header {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t record_size;
+    uint16_t count;
+    uint32_t invalid_transitions;
+};
+
+/**
+ * Process a notification with the given transition table.
+ *
+ * The transition is recorded in the trace ring *before* the action is
+ * executed, as the action might not return (e.g. if the component's task is
+ * deleted).
+ *
+ * If there is no matching transition, the notification is counted as an
+ * invalid transition and otherwise ignored.
+ *
+ * @param table        The transition table.
+ * @param table_len    The number of transitions in ``table``.
+ * @param notification The notification to process.
+ */
+void mnet32_fsm_dispatch(const struct mnet32_fsm_transition* table,
+                         size_t table_len,
+                         uint32_t notification);
+
+/**
+ * Get the number of invalid transitions.
+ *
+ * @return uint32_t The number of notifications without matching transition.
+ */
+uint32_t mnet32_fsm_get_invalid_transitions(void);
+
+/**
+ * Dump the trace ring.
+ *
+ * The dump consists of a ::mnet32_fsm_trace_header, followed by the records,
+ * oldest first.
+ *
+ * @param buffer   The buffer to write the dump to.
+ * @param buf_size The size of ``buffer``. If the buffer is too small, only
+ *                 the most recent records are included.
+ * @return size_t  The number of bytes written to ``buffer`` or ``0``, if the
+ *                 buffer can not even hold the header.
+ */
+size_t mnet32_fsm_trace_dump(uint8_t* buffer, size_t buf_size);
+
+#endif  // SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_FSM_H_
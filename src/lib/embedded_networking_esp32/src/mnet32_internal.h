@@ -13,17 +13,23 @@ typedef enum {
     MNET32_NOTIFICATION_CMD_NETWORKING_STOP,
     MNET32_NOTIFICATION_CMD_WIFI_START,
     MNET32_NOTIFICATION_CMD_WIFI_RESTART,
+    MNET32_NOTIFICATION_CMD_ETH_START,
+    MNET32_NOTIFICATION_EVENT_ETH_DISCONNECTED,
+    MNET32_NOTIFICATION_EVENT_ETH_GOT_IP,
+    MNET32_NOTIFICATION_EVENT_ETH_HANDOVER_TIMEOUT,
     MNET32_NOTIFICATION_EVENT_WIFI_AP_START,
     MNET32_NOTIFICATION_EVENT_WIFI_AP_STACONNECTED,
     MNET32_NOTIFICATION_EVENT_WIFI_AP_STADISCONNECTED,
     MNET32_NOTIFICATION_EVENT_WIFI_STA_START,
     MNET32_NOTIFICATION_EVENT_WIFI_STA_CONNECTED,
     MNET32_NOTIFICATION_EVENT_WIFI_STA_DISCONNECTED,
+    MNET32_NOTIFICATION_EVENT_WIFI_STA_RSSI_LOW,
+    MNET32_NOTIFICATION_EVENT_WIFI_SCAN_DONE,
 } mnet32_task_notification;
 
 
 /**
- * Handle ``IP_EVENT`` and ``WIFI_EVENT`` occurences.
+ * Handle ``ETH_EVENT``, ``IP_EVENT`` and ``WIFI_EVENT`` occurences.
  *
  * Main purpose of this event handler is to make the system's events, as
  * provided by **ESP-IDF**'s modules/components, available to this component.
@@ -38,7 +44,8 @@ typedef enum {
  *                   As of now, the function does not use / process this
  *                   argument.
  * @param event_base The base of the actual event. The handler *can handle*
- *                   occurences of ``IP_EVENT`` and ``WIFI_EVENT``.
+ *                   occurences of ``ETH_EVENT``, ``IP_EVENT`` and
+ *                   ``WIFI_EVENT``.
  * @param event_id   The actual event, as specified by its ``base`` and its
  *                   ``id``.
  * @param event_data Additional data of the event, provided as a ``void *``. The
@@ -54,13 +61,12 @@ void mnet32_event_handler(void* arg,
 /**
  * Send a notification to the component's internal ``task``.
  *
- * Technically, this sends a notification to the task as specified by
+ * Technically, this queues the notification for the task as specified by
  * ::mnet32_task , unblocking the task and triggering some action.
  *
- * The function sends a notification on the index specified by
- * ``MNET32_TASK_NOTIFICATION_INDEX`` with ``eAction`` set to
- * ``eSetValueWithOverwrite``, meaning: if the task was already notified, that
- * notification will be overwritten.
+ * The notifications are processed in order. This does not block: if the
+ * queue is full (see ``MNET32_TASK_QUEUE_LEN``), the notification is dropped,
+ * logged and counted.
  *
  * @param notification As specified in ::mnet32_task_notification.
  */
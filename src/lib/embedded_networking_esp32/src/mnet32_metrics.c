@@ -0,0 +1,277 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The metrics of the ``mnet32`` component.
+ *
+ * The metrics are a group of ``obs32``'s registry (see ``obs32_metrics.h``),
+ * so they are provided with the other components' metrics in the Prometheus
+ * text format. The component's task counts its notifications and times the
+ * transitions of the state machine, notifications are counted as dropped, if
+ * the task's queue is full; all other metrics are read from the statistics,
+ * that the modules keep anyway, while the metrics are rendered.
+ *
+ * @file   mnet32_metrics.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header. */
+#include "mnet32_metrics.h"
+
+/* C's standard libraries. */
+#include <stdint.h>
+
+/* Other headers of the component. */
+#include "mnet32/mnet32.h"  // The public header
+#include "mnet32_fsm.h"     // the state machine's invalid transitions
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static int64_t mnet32_metrics_read_invalid(void);
+static int64_t mnet32_metrics_read_posted(void);
+static int64_t mnet32_metrics_read_dropped(void);
+static int64_t mnet32_metrics_read_latency(void);
+static int64_t mnet32_metrics_read_hits(void);
+static int64_t mnet32_metrics_read_misses(void);
+static int64_t mnet32_metrics_read_prefetches(void);
+static int64_t mnet32_metrics_read_invalidations(void);
+static int64_t mnet32_metrics_read_connected(void);
+static int64_t mnet32_metrics_read_rssi(void);
+static int64_t mnet32_metrics_read_roam_scans(void);
+static int64_t mnet32_metrics_read_roams(void);
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * The upper bounds of the transitions' durations, in microseconds.
+ */
+static const uint32_t mnet32_metrics_transition_bounds[] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 50000, 100000};
+
+// Documentation in mnet32_metrics.h!
+struct obs32_metric_counter mnet32_metrics_notifications = {0};
+struct obs32_metric_counter mnet32_metrics_notifications_dropped = {0};
+struct obs32_metric_histogram mnet32_metrics_transition_us =
+    OBS32_METRICS_HISTOGRAM(mnet32_metrics_transition_bounds);
+
+/**
+ * The metrics of the component.
+ */
+static const struct obs32_metric mnet32_metrics_table[] = {
+    {.name = "mnet32_notifications_total",
+     .help = "Notifications, that were processed by the component's task.",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &mnet32_metrics_notifications},
+    {.name = "mnet32_notifications_dropped_total",
+     .help = "Notifications, that were dropped, because the queue was full.",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &mnet32_metrics_notifications_dropped},
+    {.name = "mnet32_transition_duration_us",
+     .help = "The duration of the transitions in microseconds.",
+     .type = OBS32_METRIC_HISTOGRAM,
+     .histogram = &mnet32_metrics_transition_us},
+    {.name = "mnet32_invalid_transitions_total",
+     .help = "Notifications without a matching transition.",
+     .type = OBS32_METRIC_COUNTER,
+     .read = mnet32_metrics_read_invalid},
+    {.name = "mnet32_events_total",
+     .help = "Events of MNET32_EVENTS by their delivery.",
+     .labels = "result=\"posted\"",
+     .type = OBS32_METRIC_COUNTER,
+     .read = mnet32_metrics_read_posted},
+    {.name = "mnet32_events_total",
+     .labels = "result=\"dropped\"",
+     .type = OBS32_METRIC_COUNTER,
+     .read = mnet32_metrics_read_dropped},
+    {.name = "mnet32_event_dispatch_latency_max_us",
+     .help = "The maximum time between posting and dispatching an event.",
+     .type = OBS32_METRIC_GAUGE,
+     .read = mnet32_metrics_read_latency},
+    {.name = "mnet32_resolver_lookups_total",
+     .help = "Lookups of the resolver by the state of the cache.",
+     .labels = "result=\"hit\"",
+     .type = OBS32_METRIC_COUNTER,
+     .read = mnet32_metrics_read_hits},
+    {.name = "mnet32_resolver_lookups_total",
+     .labels = "result=\"miss\"",
+     .type = OBS32_METRIC_COUNTER,
+     .read = mnet32_metrics_read_misses},
+    {.name = "mnet32_resolver_prefetches_total",
+     .help = "Names, that were refreshed ahead of their expiry.",
+     .type = OBS32_METRIC_COUNTER,
+     .read = mnet32_metrics_read_prefetches},
+    {.name = "mnet32_resolver_invalidations_total",
+     .help = "The times the cache was emptied with a change of the network.",
+     .type = OBS32_METRIC_COUNTER,
+     .read = mnet32_metrics_read_invalidations},
+    {.name = "mnet32_wifi_connected",
+     .help = "1 if the component is connected in station mode.",
+     .type = OBS32_METRIC_GAUGE,
+     .read = mnet32_metrics_read_connected},
+    {.name = "mnet32_wifi_rssi_dbm",
+     .help = "The most recent RSSI sample in dBm.",
+     .type = OBS32_METRIC_GAUGE,
+     .read = mnet32_metrics_read_rssi},
+    {.name = "mnet32_wifi_roam_scans_total",
+     .help = "Scans for a stronger access point.",
+     .type = OBS32_METRIC_COUNTER,
+     .read = mnet32_metrics_read_roam_scans},
+    {.name = "mnet32_wifi_roams_total",
+     .help = "Reconnects to a stronger access point.",
+     .type = OBS32_METRIC_COUNTER,
+     .read = mnet32_metrics_read_roams},
+};
+
+/**
+ * The group of ::mnet32_metrics_table .
+ */
+static struct obs32_metrics_group mnet32_metrics_group = {
+    .metrics = mnet32_metrics_table,
+    .count = sizeof(mnet32_metrics_table) / sizeof(mnet32_metrics_table[0]),
+};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Read the number of invalid transitions.
+ *
+ * @return int64_t The number of invalid transitions.
+ */
+static int64_t mnet32_metrics_read_invalid(void) {
+    return mnet32_fsm_get_invalid_transitions();
+}
+
+/**
+ * Read the number of posted events.
+ *
+ * @return int64_t The number of posted events.
+ */
+static int64_t mnet32_metrics_read_posted(void) {
+    struct mnet32_event_stats stats;
+    mnet32_event_get_stats(&stats);
+    return stats.posted;
+}
+
+/**
+ * Read the number of dropped events.
+ *
+ * @return int64_t The number of dropped events.
+ */
+static int64_t mnet32_metrics_read_dropped(void) {
+    struct mnet32_event_stats stats;
+    mnet32_event_get_stats(&stats);
+    return stats.dropped;
+}
+
+/**
+ * Read the maximum dispatch latency of the events.
+ *
+ * @return int64_t The latency in microseconds.
+ */
+static int64_t mnet32_metrics_read_latency(void) {
+    struct mnet32_event_stats stats;
+    mnet32_event_get_stats(&stats);
+    return stats.max_dispatch_latency_us;
+}
+
+/**
+ * Read the number of lookups, that were answered from the cache.
+ *
+ * @return int64_t The number of hits.
+ */
+static int64_t mnet32_metrics_read_hits(void) {
+    struct mnet32_resolver_stats stats;
+    mnet32_resolver_get_stats(&stats);
+    return stats.hits;
+}
+
+/**
+ * Read the number of lookups, that required a query.
+ *
+ * @return int64_t The number of misses.
+ */
+static int64_t mnet32_metrics_read_misses(void) {
+    struct mnet32_resolver_stats stats;
+    mnet32_resolver_get_stats(&stats);
+    return stats.misses;
+}
+
+/**
+ * Read the number of prefetched names.
+ *
+ * @return int64_t The number of prefetches.
+ */
+static int64_t mnet32_metrics_read_prefetches(void) {
+    struct mnet32_resolver_stats stats;
+    mnet32_resolver_get_stats(&stats);
+    return stats.prefetches;
+}
+
+/**
+ * Read the number of times the cache was emptied.
+ *
+ * @return int64_t The number of invalidations.
+ */
+static int64_t mnet32_metrics_read_invalidations(void) {
+    struct mnet32_resolver_stats stats;
+    mnet32_resolver_get_stats(&stats);
+    return stats.invalidations;
+}
+
+/**
+ * Read, if the component is connected in station mode.
+ *
+ * @return int64_t ``1`` if connected, ``0`` otherwise.
+ */
+static int64_t mnet32_metrics_read_connected(void) {
+    struct mnet32_status_snapshot snapshot;
+    mnet32_get_status_snapshot(&snapshot);
+    return snapshot.connected ? 1 : 0;
+}
+
+/**
+ * Read the most recent RSSI sample.
+ *
+ * @return int64_t The RSSI in dBm, ``0`` if not connected.
+ */
+static int64_t mnet32_metrics_read_rssi(void) {
+    struct mnet32_status_snapshot snapshot;
+    mnet32_get_status_snapshot(&snapshot);
+    return snapshot.connected ? snapshot.rssi : 0;
+}
+
+/**
+ * Read the number of scans for a stronger access point.
+ *
+ * @return int64_t The number of scans.
+ */
+static int64_t mnet32_metrics_read_roam_scans(void) {
+    struct mnet32_status_snapshot snapshot;
+    mnet32_get_status_snapshot(&snapshot);
+    return snapshot.roam_scans;
+}
+
+/**
+ * Read the number of reconnects to a stronger access point.
+ *
+ * @return int64_t The number of reconnects.
+ */
+static int64_t mnet32_metrics_read_roams(void) {
+    struct mnet32_status_snapshot snapshot;
+    mnet32_get_status_snapshot(&snapshot);
+    return snapshot.roams;
+}
+
+// Documentation in mnet32_metrics.h!
+void mnet32_metrics_register(void) {
+    obs32_metrics_register(&mnet32_metrics_group);
+}
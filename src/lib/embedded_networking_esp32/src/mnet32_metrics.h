@@ -0,0 +1,38 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+#ifndef SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_METRICS_H_
+#define SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_METRICS_H_
+
+/* The metrics registry of ``obs32``.
+ * - defines ``struct obs32_metric_counter`` and friends
+ */
+#include "obs32/obs32_metrics.h"
+
+
+/**
+ * The notifications, that were processed by the component's task.
+ */
+extern struct obs32_metric_counter mnet32_metrics_notifications;
+
+/**
+ * The notifications, that were dropped, because the task's queue was full.
+ */
+extern struct obs32_metric_counter mnet32_metrics_notifications_dropped;
+
+/**
+ * The durations of the transitions of the state machine, in microseconds.
+ */
+extern struct obs32_metric_histogram mnet32_metrics_transition_us;
+
+/**
+ * Register the component's metrics with ``obs32``'s registry.
+ *
+ * The statistics, that are already kept by the component's modules (events,
+ * state machine, resolver and WiFi link), are read while the metrics are
+ * rendered. This may be called repeatedly, the metrics are registered once.
+ */
+void mnet32_metrics_register(void);
+
+#endif  // SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_METRICS_H_
@@ -95,7 +95,10 @@ esp_err_t mnet32_nvs_get_string(nvs_handle_t handle,
 
     if (req_size > max_buf_size) {
         ESP_LOGE(TAG, "Provided buffer has insufficient size!");
-        ESP_LOGD(TAG, "Required: %d / available: %d", req_size, max_buf_size);
+        ESP_LOGD(TAG,
+                 "Required: %u / available: %u",
+                 (unsigned int)req_size,
+                 (unsigned int)max_buf_size);
         return ESP_FAIL;
     }
 
@@ -0,0 +1,311 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Caching DNS resolver of the ``mnet32`` component.
+ *
+ * Names are resolved with the DNS servers of lwIP (as provided by DHCP) and
+ * cached for their TTL in a cache of ::MNET32_RESOLVER_CACHE_SIZE names, so
+ * (re-)connecting to a stream or API server does not wait for a lookup.
+ * Names, that were looked up since they were stored, are refreshed by the
+ * component's task shortly before they expire. The cache is emptied with
+ * every change of the network.
+ *
+ * The cache and the DNS client are provided by mnet32_resolver_engine.c ,
+ * this module provides locking, time and the DNS servers.
+ *
+ * @file   mnet32_resolver.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header. */
+#include "mnet32_resolver.h"
+
+/* C's standard libraries. */
+#include <errno.h>
+#include <string.h>
+
+/* The BSD socket API, provided by lwIP on the ESP32. */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+/* Other headers of the component. */
+#include "mnet32/mnet32.h"           // The public header
+#include "mnet32_resolver_engine.h"  // cache and DNS client
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* This is ESP-IDF's system library.
+ * - provides the IDs of the queries (``esp_random()``)
+ */
+#include "esp_system.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* ESP-IDF's high resolution timer, provides the time of the cache. */
+#include "esp_timer.h"
+
+/* FreeRTOS headers.
+ * - the ``FreeRTOS.h`` is required
+ */
+#include "freertos/FreeRTOS.h"
+
+/* lwIP's resolver, provides the DNS servers. */
+#include "lwip/dns.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The UDP port of DNS servers.
+ */
+#define MNET32_RESOLVER_SERVER_PORT 53
+
+/**
+ * The timespan before the expiry to refresh a hot name (in milliseconds).
+ *
+ * The response of a prefetch is received with the next monitoring cycle, so
+ * the refresh must start two cycles before the expiry.
+ */
+#define MNET32_RESOLVER_PREFETCH_WINDOW (2 * MNET32_TASK_MONITOR_FREQUENCY)
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "mnet32.resolver";
+
+/**
+ * The storage of ::mnet32_resolver_cache .
+ */
+static struct mnet32_resolver_entry
+    mnet32_resolver_entries[MNET32_RESOLVER_CACHE_SIZE] = {0};
+
+/**
+ * The cache of resolved names.
+ */
+static struct mnet32_resolver_cache mnet32_resolver_cache = {
+    .entries = mnet32_resolver_entries,
+    .size = MNET32_RESOLVER_CACHE_SIZE,
+};
+
+/**
+ * The pending prefetch query, only accessed from the component's task.
+ */
+static struct mnet32_resolver_prefetch mnet32_resolver_prefetch_query = {
+    .socket = -1,
+};
+
+/**
+ * Protect ::mnet32_resolver_cache , as it is accessed from the component's
+ * task and the tasks of the application.
+ */
+static portMUX_TYPE mnet32_resolver_lock = portMUX_INITIALIZER_UNLOCKED;
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static bool mnet32_resolver_get_server(uint8_t index,
+                                       struct sockaddr_in* server);
+static uint16_t mnet32_resolver_next_id(void);
+static int64_t mnet32_resolver_now(void);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get one of lwIP's DNS servers.
+ *
+ * @param index  The index of the server.
+ * @param server The address of the server.
+ * @return bool ``true`` if the server is set (and uses IPv4).
+ */
+static bool mnet32_resolver_get_server(uint8_t index,
+                                       struct sockaddr_in* server) {
+    const ip_addr_t* address = dns_getserver(index);
+    if ((address == NULL) || !IP_IS_V4(address) ||
+        ip4_addr_isany(ip_2_ip4(address)))
+        return false;
+
+    memset(server, 0, sizeof(*server));
+    server->sin_family = AF_INET;
+    server->sin_port = htons(MNET32_RESOLVER_SERVER_PORT);
+    server->sin_addr.s_addr = ip_2_ip4(address)->addr;
+    return true;
+}
+
+/**
+ * Get the ID of the next query.
+ *
+ * The IDs are random, so they can not be predicted to forge a response. ``0``
+ * is skipped, as it marks *no pending query*.
+ *
+ * @return uint16_t The ID.
+ */
+static uint16_t mnet32_resolver_next_id(void) {
+    uint16_t id;
+    do {
+        id = (uint16_t)esp_random();
+    } while (id == 0);
+
+    return id;
+}
+
+/**
+ * Get the time of the cache.
+ *
+ * @return int64_t The time since boot (in milliseconds).
+ */
+static int64_t mnet32_resolver_now(void) {
+    return esp_timer_get_time() / 1000;
+}
+
+// This function is part of the component's public interface and documented in
+// ``include/mnet32/mnet32.h``
+esp_err_t mnet32_resolve(const char* name, uint32_t* address) {
+    ESP_LOGV(TAG, "mnet32_resolve()");
+
+    if ((name == NULL) || (address == NULL))
+        return ESP_ERR_INVALID_ARG;
+
+    /* Addresses are not cached and do not count as lookups. */
+    struct in_addr literal;
+    if (inet_aton(name, &literal) != 0) {
+        *address = literal.s_addr;
+        return ESP_OK;
+    }
+
+    portENTER_CRITICAL(&mnet32_resolver_lock);
+    bool hit = mnet32_resolver_cache_lookup(&mnet32_resolver_cache,
+                                            name,
+                                            mnet32_resolver_now(),
+                                            address);
+    uint32_t generation = mnet32_resolver_cache.generation;
+    portEXIT_CRITICAL(&mnet32_resolver_lock);
+
+    if (hit)
+        return ESP_OK;
+
+    uint16_t id = mnet32_resolver_next_id();
+    uint32_t ttl = 0;
+    int ret = -1;
+    errno = ENETUNREACH;
+    for (uint8_t i = 0; i < DNS_MAX_SERVERS; i++) {
+        struct sockaddr_in server;
+        if (!mnet32_resolver_get_server(i, &server))
+            continue;
+
+        ret = mnet32_resolver_query(&server, id, name, address, &ttl);
+        if ((ret == 0) || (errno == ENOENT))
+            break;
+    }
+
+    if (ret != 0) {
+        int err = errno;
+        ESP_LOGD(TAG, "Could not resolve '%s': %d", name, err);
+        if (err == ENOENT)
+            return ESP_ERR_NOT_FOUND;
+        if (err == ETIMEDOUT)
+            return ESP_ERR_TIMEOUT;
+        if (err == ENETUNREACH)
+            return ESP_ERR_INVALID_STATE;
+        return ESP_FAIL;
+    }
+
+    ESP_LOGD(TAG, "Resolved '%s' (TTL %ds)", name, ttl);
+
+    portENTER_CRITICAL(&mnet32_resolver_lock);
+    mnet32_resolver_cache_store(&mnet32_resolver_cache,
+                                generation,
+                                name,
+                                *address,
+                                ttl,
+                                mnet32_resolver_now());
+    portEXIT_CRITICAL(&mnet32_resolver_lock);
+
+    return ESP_OK;
+}
+
+// This function is part of the component's public interface and documented in
+// ``include/mnet32/mnet32.h``
+void mnet32_resolver_get_stats(struct mnet32_resolver_stats* stats) {
+    portENTER_CRITICAL(&mnet32_resolver_lock);
+    stats->hits = mnet32_resolver_cache.hits;
+    stats->misses = mnet32_resolver_cache.misses;
+    stats->prefetches = mnet32_resolver_cache.prefetches;
+    stats->invalidations = mnet32_resolver_cache.invalidations;
+    portEXIT_CRITICAL(&mnet32_resolver_lock);
+}
+
+// Documentation in header file!
+void mnet32_resolver_invalidate(void) {
+    ESP_LOGV(TAG, "mnet32_resolver_invalidate()");
+
+    portENTER_CRITICAL(&mnet32_resolver_lock);
+    mnet32_resolver_cache_invalidate(&mnet32_resolver_cache);
+    portEXIT_CRITICAL(&mnet32_resolver_lock);
+}
+
+// Documentation in header file!
+void mnet32_resolver_prefetch(void) {
+    ESP_LOGV(TAG, "mnet32_resolver_prefetch()");
+
+    struct mnet32_resolver_prefetch* query = &mnet32_resolver_prefetch_query;
+    uint32_t address;
+    uint32_t ttl;
+
+    if (mnet32_resolver_prefetch_receive(query, &address, &ttl) == 1) {
+        ESP_LOGD(TAG, "Refreshed '%s' (TTL %ds)", query->name, ttl);
+
+        portENTER_CRITICAL(&mnet32_resolver_lock);
+        mnet32_resolver_cache_store(&mnet32_resolver_cache,
+                                    query->generation,
+                                    query->name,
+                                    address,
+                                    ttl,
+                                    mnet32_resolver_now());
+        portEXIT_CRITICAL(&mnet32_resolver_lock);
+    }
+
+    struct sockaddr_in server;
+    if (!mnet32_resolver_get_server(0, &server))
+        return;
+
+    char name[MNET32_RESOLVER_NAME_LEN];
+    portENTER_CRITICAL(&mnet32_resolver_lock);
+    bool found = mnet32_resolver_cache_prefetch(&mnet32_resolver_cache,
+                                                mnet32_resolver_now(),
+                                                MNET32_RESOLVER_PREFETCH_WINDOW,
+                                                name);
+    uint32_t generation = mnet32_resolver_cache.generation;
+    portEXIT_CRITICAL(&mnet32_resolver_lock);
+
+    if (!found)
+        return;
+
+    if (mnet32_resolver_prefetch_send(query,
+                                      &server,
+                                      mnet32_resolver_next_id(),
+                                      generation,
+                                      name) != 0)
+        ESP_LOGD(TAG, "Could not refresh '%s': %d", name, errno);
+}
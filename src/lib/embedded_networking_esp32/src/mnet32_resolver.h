@@ -0,0 +1,27 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+#ifndef SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_RESOLVER_H_
+#define SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_RESOLVER_H_
+
+/**
+ * Remove all names from the resolver's cache.
+ *
+ * This is called whenever ``MNET32_EVENT_READY`` or
+ * ``MNET32_EVENT_UNAVAILABLE`` is emitted, because the cached addresses may
+ * not be valid (or reachable) with the new network.
+ */
+void mnet32_resolver_invalidate(void);
+
+/**
+ * Refresh hot names of the resolver's cache ahead of their expiry.
+ *
+ * This is meant to be called periodically from the component's task (see
+ * ::MNET32_TASK_MONITOR_FREQUENCY ). It does not block: the response of the
+ * query, that was sent with the previous call, is received and a query for
+ * the next name is sent.
+ */
+void mnet32_resolver_prefetch(void);
+
+#endif  // SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_RESOLVER_H_
@@ -0,0 +1,562 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``mnet32`` component's caching DNS resolver.
+ *
+ * The cache is a small array, that is searched linearly. It is meant for the
+ * handful of names, that an application connects to repeatedly (stream
+ * servers, APIs), not as a general purpose cache.
+ *
+ * **Resources:**
+ *   - https://www.rfc-editor.org/rfc/rfc1035#section-4.1
+ *   - https://www.rfc-editor.org/rfc/rfc2181#section-8
+ *
+ * @file   mnet32_resolver_engine.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "mnet32_resolver_engine.h"
+
+/* C's standard libraries. */
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+
+/* The BSD socket API, provided by lwIP on the ESP32. */
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The length of the DNS header.
+ */
+#define MNET32_RESOLVER_HEADER_LEN 12
+
+/**
+ * The maximum length of an encoded name.
+ */
+#define MNET32_RESOLVER_ENCODED_NAME_LEN 255
+
+/* Flags of the DNS header (first byte). */
+#define MNET32_RESOLVER_FLAG_QR 0x80
+#define MNET32_RESOLVER_FLAG_OPCODE 0x78
+#define MNET32_RESOLVER_FLAG_TC 0x02
+#define MNET32_RESOLVER_FLAG_RD 0x01
+
+/* Response codes of the DNS header (second byte). */
+#define MNET32_RESOLVER_RCODE_MASK 0x0f
+#define MNET32_RESOLVER_RCODE_NXDOMAIN 3
+
+/* Types and classes of resource records. */
+#define MNET32_RESOLVER_TYPE_A 1
+#define MNET32_RESOLVER_CLASS_IN 1
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static uint16_t mnet32_resolver_get16(const uint8_t* ptr);
+static uint32_t mnet32_resolver_get32(const uint8_t* ptr);
+static size_t mnet32_resolver_skip_name(const uint8_t* msg,
+                                        size_t off,
+                                        size_t len);
+static size_t mnet32_resolver_match_name(const uint8_t* msg,
+                                         size_t off,
+                                         size_t len,
+                                         const char* name);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Read a 16 bit value in network byte order.
+ *
+ * @param ptr The position of the value.
+ * @return uint16_t The value.
+ */
+static uint16_t mnet32_resolver_get16(const uint8_t* ptr) {
+    return (uint16_t)((ptr[0] << 8) | ptr[1]);
+}
+
+/**
+ * Read a 32 bit value in network byte order.
+ *
+ * @param ptr The position of the value.
+ * @return uint32_t The value.
+ */
+static uint32_t mnet32_resolver_get32(const uint8_t* ptr) {
+    return ((uint32_t)ptr[0] << 24) | ((uint32_t)ptr[1] << 16) |
+           ((uint32_t)ptr[2] << 8) | ptr[3];
+}
+
+/**
+ * Skip an encoded name.
+ *
+ * The name may end with a pointer (compression), which is not followed, as
+ * the name itself is not evaluated.
+ *
+ * @param msg The message.
+ * @param off The offset of the name.
+ * @param len The length of the message.
+ * @return size_t The offset after the name, ``0`` if the name is malformed.
+ */
+static size_t mnet32_resolver_skip_name(const uint8_t* msg,
+                                        size_t off,
+                                        size_t len) {
+    size_t start = off;
+
+    while (off < len) {
+        uint8_t label = msg[off];
+        if (label == 0)
+            return off + 1;
+        if ((label & 0xc0) == 0xc0)
+            return (off + 2 <= len) ? off + 2 : 0;
+        if ((label & 0xc0) != 0)
+            return 0;
+
+        off += 1 + label;
+        if (off - start > MNET32_RESOLVER_ENCODED_NAME_LEN)
+            return 0;
+    }
+
+    return 0;
+}
+
+/**
+ * Compare an encoded name with a name.
+ *
+ * The comparison is case-insensitive. A pointer (compression) does not match,
+ * as the name of a question is not compressed.
+ *
+ * @param msg  The message.
+ * @param off  The offset of the encoded name.
+ * @param len  The length of the message.
+ * @param name The name, e.g. ``example.com``.
+ * @return size_t The offset after the name, ``0`` if the name does not match.
+ */
+static size_t mnet32_resolver_match_name(const uint8_t* msg,
+                                         size_t off,
+                                         size_t len,
+                                         const char* name) {
+    while (*name != '\0') {
+        size_t label = strcspn(name, ".");
+        if ((off + 1 + label > len) || (msg[off] != label) ||
+            (strncasecmp((const char*)msg + off + 1, name, label) != 0))
+            return 0;
+
+        off += 1 + label;
+        name += label;
+        if (*name == '.')
+            name++;
+    }
+
+    return ((off < len) && (msg[off] == 0)) ? off + 1 : 0;
+}
+
+// Documentation in header file!
+void mnet32_resolver_cache_init(struct mnet32_resolver_cache* cache,
+                                struct mnet32_resolver_entry* entries,
+                                size_t size) {
+    memset(cache, 0, sizeof(*cache));
+    memset(entries, 0, size * sizeof(*entries));
+    cache->entries = entries;
+    cache->size = size;
+}
+
+// Documentation in header file!
+bool mnet32_resolver_cache_lookup(struct mnet32_resolver_cache* cache,
+                                  const char* name,
+                                  int64_t now,
+                                  uint32_t* address) {
+    for (size_t i = 0; i < cache->size; i++) {
+        struct mnet32_resolver_entry* entry = &cache->entries[i];
+
+        if ((entry->name[0] == '\0') || (entry->expires <= now) ||
+            (strcasecmp(entry->name, name) != 0))
+            continue;
+
+        entry->used = now;
+        entry->hot = true;
+        *address = entry->address;
+        cache->hits++;
+        return true;
+    }
+
+    cache->misses++;
+    return false;
+}
+
+// Documentation in header file!
+void mnet32_resolver_cache_store(struct mnet32_resolver_cache* cache,
+                                 uint32_t generation,
+                                 const char* name,
+                                 uint32_t address,
+                                 uint32_t ttl,
+                                 int64_t now) {
+    if ((generation != cache->generation) || (ttl == 0) ||
+        (strlen(name) >= MNET32_RESOLVER_NAME_LEN) || (cache->size == 0))
+        return;
+
+    if (ttl > MNET32_RESOLVER_TTL_MAX)
+        ttl = MNET32_RESOLVER_TTL_MAX;
+
+    /* Update the name's entry (a refresh) or replace the least recently used
+     * entry. Expired entries are the least recently used.
+     */
+    struct mnet32_resolver_entry* victim = &cache->entries[0];
+    for (size_t i = 0; i < cache->size; i++) {
+        struct mnet32_resolver_entry* entry = &cache->entries[i];
+
+        if (strcasecmp(entry->name, name) == 0) {
+            victim = entry;
+            break;
+        }
+
+        int64_t used = (entry->expires <= now) ? INT64_MIN : entry->used;
+        int64_t victim_used =
+            (victim->expires <= now) ? INT64_MIN : victim->used;
+        if (used < victim_used)
+            victim = entry;
+    }
+
+    if (strcasecmp(victim->name, name) != 0) {
+        strcpy(victim->name, name);
+        victim->used = now;
+        victim->hot = false;
+    }
+    victim->address = address;
+    victim->expires = now + (int64_t)ttl * 1000;
+}
+
+// Documentation in header file!
+bool mnet32_resolver_cache_prefetch(struct mnet32_resolver_cache* cache,
+                                    int64_t now,
+                                    int64_t window,
+                                    char* name) {
+    for (size_t i = 0; i < cache->size; i++) {
+        struct mnet32_resolver_entry* entry = &cache->entries[i];
+
+        if ((entry->name[0] == '\0') || !entry->hot ||
+            (entry->expires <= now) || (entry->expires - now > window))
+            continue;
+
+        entry->hot = false;
+        strcpy(name, entry->name);
+        cache->prefetches++;
+        return true;
+    }
+
+    return false;
+}
+
+// Documentation in header file!
+void mnet32_resolver_cache_invalidate(struct mnet32_resolver_cache* cache) {
+    memset(cache->entries, 0, cache->size * sizeof(*cache->entries));
+    cache->generation++;
+    cache->invalidations++;
+}
+
+// Documentation in header file!
+size_t mnet32_resolver_build_query(uint8_t* buf,
+                                   uint16_t id,
+                                   const char* name) {
+    size_t name_len = strlen(name);
+    if ((name_len == 0) || (name_len + 2 > MNET32_RESOLVER_ENCODED_NAME_LEN))
+        return 0;
+
+    memset(buf, 0, MNET32_RESOLVER_HEADER_LEN);
+    buf[0] = (uint8_t)(id >> 8);
+    buf[1] = (uint8_t)(id & 0xff);
+    buf[2] = MNET32_RESOLVER_FLAG_RD;
+    buf[5] = 1;  // QDCOUNT
+
+    size_t off = MNET32_RESOLVER_HEADER_LEN;
+    while (*name != '\0') {
+        size_t label = strcspn(name, ".");
+        if ((label == 0) || (label > 63))
+            return 0;
+
+        buf[off++] = (uint8_t)label;
+        memcpy(buf + off, name, label);
+        off += label;
+        name += label;
+        if (*name == '.')
+            name++;
+    }
+    buf[off++] = 0;
+    buf[off++] = 0;
+    buf[off++] = MNET32_RESOLVER_TYPE_A;
+    buf[off++] = 0;
+    buf[off++] = MNET32_RESOLVER_CLASS_IN;
+
+    return off;
+}
+
+// Documentation in header file!
+int mnet32_resolver_parse_response(const uint8_t* msg,
+                                   size_t len,
+                                   uint16_t id,
+                                   const char* name,
+                                   uint32_t* address,
+                                   uint32_t* ttl) {
+    if ((len < MNET32_RESOLVER_HEADER_LEN) ||
+        (mnet32_resolver_get16(msg) != id) ||
+        ((msg[2] & MNET32_RESOLVER_FLAG_QR) == 0) ||
+        ((msg[2] & (MNET32_RESOLVER_FLAG_OPCODE | MNET32_RESOLVER_FLAG_TC)) !=
+         0)) {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    uint8_t rcode = msg[3] & MNET32_RESOLVER_RCODE_MASK;
+    if (rcode != 0) {
+        errno = (rcode == MNET32_RESOLVER_RCODE_NXDOMAIN) ? ENOENT : EIO;
+        return -1;
+    }
+
+    /* The response must repeat the question, an answer of another question
+     * with the same ID is not accepted.
+     */
+    uint16_t qdcount = mnet32_resolver_get16(msg + 4);
+    uint16_t ancount = mnet32_resolver_get16(msg + 6);
+    size_t off =
+        mnet32_resolver_match_name(msg, MNET32_RESOLVER_HEADER_LEN, len, name);
+    if ((qdcount != 1) || (off == 0) || (off + 4 > len) ||
+        (mnet32_resolver_get16(msg + off) != MNET32_RESOLVER_TYPE_A) ||
+        (mnet32_resolver_get16(msg + off + 2) != MNET32_RESOLVER_CLASS_IN)) {
+        errno = EBADMSG;
+        return -1;
+    }
+    off += 4;
+
+    /* The answers are the chain of aliases, followed by the address(es). */
+    uint32_t min_ttl = UINT32_MAX;
+    for (uint16_t i = 0; i < ancount; i++) {
+        off = mnet32_resolver_skip_name(msg, off, len);
+        if ((off == 0) || (off + 10 > len)) {
+            errno = EBADMSG;
+            return -1;
+        }
+
+        uint16_t type = mnet32_resolver_get16(msg + off);
+        uint16_t class = mnet32_resolver_get16(msg + off + 2);
+        uint32_t record_ttl = mnet32_resolver_get32(msg + off + 4);
+        uint16_t rdlength = mnet32_resolver_get16(msg + off + 8);
+        off += 10;
+        if (off + rdlength > len) {
+            errno = EBADMSG;
+            return -1;
+        }
+
+        /* RFC 2181: a TTL with the most significant bit set is zero. */
+        if (record_ttl > INT32_MAX)
+            record_ttl = 0;
+        if (record_ttl < min_ttl)
+            min_ttl = record_ttl;
+
+        if ((type == MNET32_RESOLVER_TYPE_A) &&
+            (class == MNET32_RESOLVER_CLASS_IN) && (rdlength == 4)) {
+            memcpy(address, msg + off, 4);
+            *ttl = min_ttl;
+            return 0;
+        }
+
+        off += rdlength;
+    }
+
+    errno = ENOENT;
+    return -1;
+}
+
+// Documentation in header file!
+int mnet32_resolver_query(const struct sockaddr_in* server,
+                          uint16_t id,
+                          const char* name,
+                          uint32_t* address,
+                          uint32_t* ttl) {
+    uint8_t buf[MNET32_RESOLVER_MSG_LEN];
+
+    size_t query_len = mnet32_resolver_build_query(buf, id, name);
+    if (query_len == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+        return -1;
+
+    struct timeval timeout = {
+        .tv_sec = MNET32_RESOLVER_TIMEOUT / 1000,
+        .tv_usec = (MNET32_RESOLVER_TIMEOUT % 1000) * 1000,
+    };
+    if (setsockopt(sock,
+                   SOL_SOCKET,
+                   SO_RCVTIMEO,
+                   &timeout,
+                   sizeof(timeout)) != 0) {
+        int saved = errno;
+        close(sock);
+        errno = saved;
+        return -1;
+    }
+
+    /* The query is kept in ``buf`` until a response is received, so it can
+     * be sent again.
+     */
+    uint8_t response[MNET32_RESOLVER_MSG_LEN];
+    int ret = -1;
+    errno = ETIMEDOUT;
+    for (int attempt = 0; (attempt < MNET32_RESOLVER_ATTEMPTS) && (ret != 0);
+         attempt++) {
+        if (sendto(sock,
+                   buf,
+                   query_len,
+                   0,
+                   (const struct sockaddr*)server,
+                   sizeof(*server)) < 0)
+            break;
+
+        for (;;) {
+            struct sockaddr_in peer;
+            socklen_t peer_len = sizeof(peer);
+            ssize_t len = recvfrom(sock,
+                                   response,
+                                   sizeof(response),
+                                   0,
+                                   (struct sockaddr*)&peer,
+                                   &peer_len);
+            if (len < 0) {
+                if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                    errno = ETIMEDOUT;
+                break;
+            }
+
+            /* Responses of other servers or queries are ignored. */
+            if ((peer.sin_addr.s_addr != server->sin_addr.s_addr) ||
+                (peer.sin_port != server->sin_port) || (len < 2) ||
+                (mnet32_resolver_get16(response) != id))
+                continue;
+
+            ret = mnet32_resolver_parse_response(response,
+                                                 (size_t)len,
+                                                 id,
+                                                 name,
+                                                 address,
+                                                 ttl);
+            break;
+        }
+
+        /* A definite answer is not retried. */
+        if ((ret != 0) && (errno != ETIMEDOUT))
+            break;
+    }
+
+    int saved = errno;
+    close(sock);
+    errno = saved;
+    return ret;
+}
+
+// Documentation in header file!
+int mnet32_resolver_prefetch_send(struct mnet32_resolver_prefetch* prefetch,
+                                  const struct sockaddr_in* server,
+                                  uint16_t id,
+                                  uint32_t generation,
+                                  const char* name) {
+    uint8_t buf[MNET32_RESOLVER_MSG_LEN];
+
+    prefetch->id = 0;
+    if (strlen(name) >= MNET32_RESOLVER_NAME_LEN) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t query_len = mnet32_resolver_build_query(buf, id, name);
+    if (query_len == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (prefetch->socket < 0) {
+        prefetch->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (prefetch->socket < 0)
+            return -1;
+    }
+
+    if (sendto(prefetch->socket,
+               buf,
+               query_len,
+               0,
+               (const struct sockaddr*)server,
+               sizeof(*server)) < 0)
+        return -1;
+
+    prefetch->server = *server;
+    prefetch->id = id;
+    prefetch->generation = generation;
+    strcpy(prefetch->name, name);
+    return 0;
+}
+
+// Documentation in header file!
+int mnet32_resolver_prefetch_receive(struct mnet32_resolver_prefetch* prefetch,
+                                     uint32_t* address,
+                                     uint32_t* ttl) {
+    uint8_t buf[MNET32_RESOLVER_MSG_LEN];
+
+    if ((prefetch->socket < 0) || (prefetch->id == 0))
+        return 0;
+
+    uint16_t id = prefetch->id;
+    prefetch->id = 0;
+
+    for (;;) {
+        struct sockaddr_in peer;
+        socklen_t peer_len = sizeof(peer);
+        ssize_t len = recvfrom(prefetch->socket,
+                               buf,
+                               sizeof(buf),
+                               MSG_DONTWAIT,
+                               (struct sockaddr*)&peer,
+                               &peer_len);
+        if (len < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                return 0;
+            return -1;
+        }
+
+        /* Responses of other servers or queries are ignored. */
+        if ((peer.sin_addr.s_addr != prefetch->server.sin_addr.s_addr) ||
+            (peer.sin_port != prefetch->server.sin_port) || (len < 2) ||
+            (mnet32_resolver_get16(buf) != id))
+            continue;
+
+        int ret = mnet32_resolver_parse_response(buf,
+                                                 (size_t)len,
+                                                 id,
+                                                 prefetch->name,
+                                                 address,
+                                                 ttl);
+        return (ret == 0) ? 1 : 0;
+    }
+}
+
+// Documentation in header file!
+void mnet32_resolver_prefetch_close(struct mnet32_resolver_prefetch* prefetch) {
+    if (prefetch->socket >= 0)
+        close(prefetch->socket);
+    prefetch->socket = -1;
+    prefetch->id = 0;
+}
@@ -0,0 +1,297 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``mnet32`` component's caching DNS resolver.
+ *
+ * The engine provides the cache of resolved names and a minimal DNS client
+ * (queries for type ``A`` over UDP), which - in contrast to lwIP's resolver -
+ * provides the TTL of the answer. Time is passed in by the caller (in
+ * milliseconds of an arbitrary monotonic clock), so the cache's behaviour is
+ * deterministic.
+ *
+ * The engine does not allocate memory, does not lock and only depends on the
+ * BSD socket API, so it builds with **ESP-IDF** (lwIP) and on a Linux host
+ * (see ``tools/mnet32/resolver``). Locking is the responsibility of the
+ * caller (see mnet32_resolver.c ).
+ *
+ * Errors of the network functions are reported as ``-1`` with ``errno`` set,
+ * as there is no ``esp_err_t`` on the host.
+ *
+ * **Resources:**
+ *   - https://www.rfc-editor.org/rfc/rfc1035#section-4.1
+ *
+ * @file   mnet32_resolver_engine.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_RESOLVER_ENGINE_H_
+#define SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_RESOLVER_ENGINE_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The BSD socket API, provided by lwIP on the ESP32. */
+#include <netinet/in.h>
+
+
+/**
+ * The maximum length of a cached name, including the terminating ``\0``.
+ *
+ * Longer names are resolved, but not cached.
+ */
+#define MNET32_RESOLVER_NAME_LEN 64
+
+/**
+ * The maximum length of a DNS message over UDP (without EDNS).
+ */
+#define MNET32_RESOLVER_MSG_LEN 512
+
+/**
+ * The time to wait for a response (in milliseconds).
+ */
+#define MNET32_RESOLVER_TIMEOUT 1000
+
+/**
+ * The number of queries to send to a server, before giving up.
+ */
+#define MNET32_RESOLVER_ATTEMPTS 2
+
+/**
+ * The maximum time to live of a cached name, given in seconds.
+ *
+ * Longer TTLs are shortened, so a moved host is looked up again at least
+ * once per hour.
+ */
+#define MNET32_RESOLVER_TTL_MAX 3600
+
+/**
+ * A cached name.
+ */
+struct mnet32_resolver_entry {
+    char name[MNET32_RESOLVER_NAME_LEN];  // empty if the entry is unused
+    uint32_t address;                     // network byte order
+    int64_t expires;
+    int64_t used;  // the most recent lookup, to replace the oldest entry
+    bool hot;      // looked up since the entry was stored or prefetched
+};
+
+/**
+ * The cache of resolved names.
+ *
+ * The entries are provided by the caller, see ::mnet32_resolver_cache_init .
+ */
+struct mnet32_resolver_cache {
+    struct mnet32_resolver_entry* entries;
+    size_t size;
+
+    /**
+     * Incremented by ::mnet32_resolver_cache_invalidate ; answers of queries,
+     * that were sent before, are not stored.
+     */
+    uint32_t generation;
+
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t prefetches;
+    uint32_t invalidations;
+};
+
+/**
+ * A prefetch query, that is sent without waiting for the response.
+ */
+struct mnet32_resolver_prefetch {
+    int socket;
+    struct sockaddr_in server;  // responses of other peers are ignored
+    uint16_t id;                // ``0`` if no query is pending
+    uint32_t generation;
+    char name[MNET32_RESOLVER_NAME_LEN];
+};
+
+
+/**
+ * Initialize the cache.
+ *
+ * @param cache   The cache to be initialized.
+ * @param entries The storage of the cache.
+ * @param size    The number of ``entries``.
+ */
+void mnet32_resolver_cache_init(struct mnet32_resolver_cache* cache,
+                                struct mnet32_resolver_entry* entries,
+                                size_t size);
+
+/**
+ * Look up a name in the cache.
+ *
+ * Every lookup is counted as hit or miss. A hit marks the entry as *hot*, so
+ * it is refreshed before it expires (see ::mnet32_resolver_cache_prefetch ).
+ *
+ * @param cache   The cache.
+ * @param name    The name to look up.
+ * @param now     The current time (in milliseconds).
+ * @param address The cached address (network byte order).
+ * @return bool ``true`` if the name is cached and not expired.
+ */
+bool mnet32_resolver_cache_lookup(struct mnet32_resolver_cache* cache,
+                                  const char* name,
+                                  int64_t now,
+                                  uint32_t* address);
+
+/**
+ * Store a resolved name in the cache.
+ *
+ * The least recently used (or an expired) entry is replaced. Answers with a
+ * TTL of ``0``, of names that are too long or of a previous ``generation``
+ * are not stored.
+ *
+ * @param cache      The cache.
+ * @param generation The cache's generation, when the query was sent.
+ * @param name       The resolved name.
+ * @param address    The address (network byte order).
+ * @param ttl        The time to live of the answer, given in seconds.
+ * @param now        The current time (in milliseconds).
+ */
+void mnet32_resolver_cache_store(struct mnet32_resolver_cache* cache,
+                                 uint32_t generation,
+                                 const char* name,
+                                 uint32_t address,
+                                 uint32_t ttl,
+                                 int64_t now);
+
+/**
+ * Select a name to be refreshed ahead of its expiry.
+ *
+ * Only *hot* entries, that expire within ``window``, are refreshed. The
+ * selected entry is no longer hot, so it is not selected again, unless it is
+ * looked up again.
+ *
+ * @param cache  The cache.
+ * @param now    The current time (in milliseconds).
+ * @param window The timespan before the expiry to refresh a name (in
+ *               milliseconds).
+ * @param name   The selected name is copied here, at least
+ *               ::MNET32_RESOLVER_NAME_LEN bytes.
+ * @return bool ``true`` if a name was selected.
+ */
+bool mnet32_resolver_cache_prefetch(struct mnet32_resolver_cache* cache,
+                                    int64_t now,
+                                    int64_t window,
+                                    char* name);
+
+/**
+ * Remove all names from the cache.
+ *
+ * The counters are kept.
+ *
+ * @param cache The cache.
+ */
+void mnet32_resolver_cache_invalidate(struct mnet32_resolver_cache* cache);
+
+/**
+ * Build a recursive query for the address (type ``A``) of a name.
+ *
+ * @param buf  The buffer, at least ::MNET32_RESOLVER_MSG_LEN bytes.
+ * @param id   The query's ID.
+ * @param name The name to query, e.g. ``example.com``.
+ * @return size_t The length of the query, ``0`` if ``name`` is not valid.
+ */
+size_t mnet32_resolver_build_query(uint8_t* buf, uint16_t id, const char* name);
+
+/**
+ * Extract the address of a response.
+ *
+ * Aliases (``CNAME``) are followed implicitly, as the server includes the
+ * records of the target name. The TTL is the minimum TTL of all answers.
+ *
+ * The response must have the query's ID and its question, the name (compared
+ * case-insensitively), type ``A`` and class ``IN``.
+ *
+ * @param msg     The response.
+ * @param len     The length of the response.
+ * @param id      The ID of the query.
+ * @param name    The name of the query.
+ * @param address The address (network byte order).
+ * @param ttl     The time to live, given in seconds.
+ * @return int ``0`` on success, ``-1`` with ``errno`` set to ``ENOENT`` if the
+ *             name has no address, ``EIO`` if the server failed or
+ *             ``EBADMSG`` if the response is malformed or does not match the
+ *             query.
+ */
+int mnet32_resolver_parse_response(const uint8_t* msg,
+                                   size_t len,
+                                   uint16_t id,
+                                   const char* name,
+                                   uint32_t* address,
+                                   uint32_t* ttl);
+
+/**
+ * Resolve a name, waiting for the response.
+ *
+ * The query is sent at most ::MNET32_RESOLVER_ATTEMPTS times, waiting
+ * ::MNET32_RESOLVER_TIMEOUT milliseconds for each response.
+ *
+ * @param server  The address of the DNS server.
+ * @param id      The query's ID.
+ * @param name    The name to resolve.
+ * @param address The address (network byte order).
+ * @param ttl     The time to live, given in seconds.
+ * @return int ``0`` on success, ``-1`` on failure (with ``errno`` set,
+ *             ``ETIMEDOUT`` if there was no response).
+ */
+int mnet32_resolver_query(const struct sockaddr_in* server,
+                          uint16_t id,
+                          const char* name,
+                          uint32_t* address,
+                          uint32_t* ttl);
+
+/**
+ * Send a prefetch query.
+ *
+ * The socket is opened on first use and kept open, so the response may be
+ * received later with ::mnet32_resolver_prefetch_receive . A pending query is
+ * abandoned.
+ *
+ * @param prefetch   The prefetch.
+ * @param server     The address of the DNS server.
+ * @param id         The query's ID, must not be ``0``.
+ * @param generation The cache's generation.
+ * @param name       The name to resolve.
+ * @return int ``0`` on success, ``-1`` on failure (with ``errno`` set).
+ */
+int mnet32_resolver_prefetch_send(struct mnet32_resolver_prefetch* prefetch,
+                                  const struct sockaddr_in* server,
+                                  uint16_t id,
+                                  uint32_t generation,
+                                  const char* name);
+
+/**
+ * Receive the response of the pending prefetch query, without waiting.
+ *
+ * Responses of previous queries and of other peers than the query's server are
+ * discarded. The query is no longer pending afterwards, regardless of the
+ * result.
+ *
+ * @param prefetch The prefetch.
+ * @param address  The address (network byte order).
+ * @param ttl      The time to live, given in seconds.
+ * @return int ``1`` if the response was received, ``0`` if there is no
+ *             (valid) response and ``-1`` on failure (with ``errno`` set).
+ */
+int mnet32_resolver_prefetch_receive(struct mnet32_resolver_prefetch* prefetch,
+                                     uint32_t* address,
+                                     uint32_t* ttl);
+
+/**
+ * Close the socket of the prefetch.
+ *
+ * @param prefetch The prefetch.
+ */
+void mnet32_resolver_prefetch_close(struct mnet32_resolver_prefetch* prefetch);
+
+#endif  // SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_RESOLVER_ENGINE_H_
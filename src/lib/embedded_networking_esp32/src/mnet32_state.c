@@ -17,6 +17,9 @@
 /* This file's header. */
 #include "mnet32_state.h"
 
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
 /* This is ESP-IDF's event library. */
 #include "esp_event.h"
 
@@ -25,9 +28,11 @@
 
 /* FreeRTOS headers.
  * - the ``FreeRTOS.h`` is required
+ * - ``queue.h`` for the notifications of the task
  * - ``task.h`` for task management
  */
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/task.h"
 
 
@@ -63,39 +68,35 @@ typedef enum {
     MNET32_MODE_WIFI_STA,
 } mnet32_mode;
 
-/**
- * Specify the actual status of the connection.
- *
- * The connection status must be evaluated in the context of its ``medium`` -
- * and in case of a wireless connection - its ``mode``.
- *
- * This is tracked in the component's ::state.
- */
-typedef enum {
-    MNET32_STATUS_DOWN,
-    MNET32_STATUS_READY,
-    MNET32_STATUS_CONNECTING,
-    MNET32_STATUS_IDLE,
-    MNET32_STATUS_BUSY,
-} mnet32_status;
-
 /**
  * A component-specific struct to keep track of the internal state.
  *
  * It contains several fields that track the component's internal state aswell
  * as fields to keep track of the actual *interface*
  * (``esp_netif_t *interface``), the dedicated component's *task*
- * (``TaskHandle_t task``) and the required event handler instances.
+ * (``TaskHandle_t task``) with the queue of its notifications
+ * (``QueueHandle_t queue``) and the required event handler instances.
+ *
+ * ``available`` tracks, whether the network was announced as available
+ * (``MNET32_EVENT_READY``), independent of the medium.
+ *
+ * The Ethernet-specific state (``eth_state``) is kept separately from the
+ * ``medium_state``, because the Ethernet driver has to stay installed (to
+ * detect the link) while the WiFi is used as fallback medium.
  */
 struct mnet32_state {
     mnet32_medium medium;
     mnet32_mode mode;
     mnet32_status status;
+    bool available;
     esp_netif_t* interface;
     TaskHandle_t task;
+    QueueHandle_t queue;
     esp_event_handler_t ip_event_handler;
     esp_event_handler_t medium_event_handler;
     void* medium_state;
+    esp_event_handler_t eth_event_handler;
+    void* eth_state;
 };
 
 
@@ -130,6 +131,23 @@ void mnet32_state_medium_state_destroy(void) {
     state->medium_state = NULL;
 }
 
+esp_err_t mnet32_state_eth_state_init(size_t size) {
+    state->eth_state = calloc(1, size);
+    if (state->eth_state == NULL)
+        return ESP_ERR_NO_MEM;
+
+    return ESP_OK;
+}
+
+void mnet32_state_eth_state_destroy(void) {
+    free(state->eth_state);
+    state->eth_state = NULL;
+}
+
+bool mnet32_state_is_available(void) {
+    return state->available;
+}
+
 bool mnet32_state_is_initialized(void) {
     return state != NULL;
 }
@@ -138,10 +156,18 @@ bool mnet32_state_is_medium_state_initialized(void) {
     return state->medium_state != NULL;
 }
 
+bool mnet32_state_is_eth_state_initialized(void) {
+    return state->eth_state != NULL;
+}
+
 bool mnet32_state_is_interface_set(void) {
     return state->interface != NULL;
 }
 
+bool mnet32_state_is_medium_ethernet(void) {
+    return state->medium == MNET32_MEDIUM_ETHERNET;
+}
+
 bool mnet32_state_is_medium_wireless(void) {
     return state->medium == MNET32_MEDIUM_WIRELESS;
 }
@@ -161,6 +187,18 @@ bool mnet32_state_is_status_idle(void) {
     return state->status == MNET32_STATUS_IDLE;
 }
 
+esp_event_handler_t mnet32_state_get_eth_event_handler(void) {
+    return state->eth_event_handler;
+}
+
+esp_event_handler_t* mnet32_state_get_eth_event_handler_ptr(void) {
+    return &(state->eth_event_handler);
+}
+
+void* mnet32_state_get_eth_state(void) {
+    return state->eth_state;
+}
+
 esp_netif_t* mnet32_state_get_interface(void) {
     return state->interface;
 }
@@ -189,6 +227,10 @@ uint8_t mnet32_state_get_mode(void) {
     return (uint8_t)state->mode;
 }
 
+uint8_t mnet32_state_get_status(void) {
+    return (uint8_t)state->status;
+}
+
 TaskHandle_t mnet32_state_get_task_handle(void) {
     return state->task;
 }
@@ -197,6 +239,14 @@ TaskHandle_t* mnet32_state_get_task_handle_ptr(void) {
     return &(state->task);
 }
 
+QueueHandle_t mnet32_state_get_queue(void) {
+    return state->queue;
+}
+
+void mnet32_state_set_available(bool available) {
+    state->available = available;
+}
+
 void mnet32_state_clear_interface(void) {
     state->interface = NULL;
 }
@@ -205,10 +255,18 @@ void mnet32_state_set_interface(esp_netif_t* interface) {
     state->interface = interface;
 }
 
+void mnet32_state_set_queue(QueueHandle_t queue) {
+    state->queue = queue;
+}
+
 void mnet32_state_clear_medium(void) {
     state->medium = MNET32_MEDIUM_UNSPECIFIED;
 }
 
+void mnet32_state_set_medium_ethernet(void) {
+    state->medium = MNET32_MEDIUM_ETHERNET;
+}
+
 void mnet32_state_set_medium_wireless(void) {
     state->medium = MNET32_MEDIUM_WIRELESS;
 }
@@ -225,18 +283,6 @@ void mnet32_state_set_mode_sta(void) {
     state->mode = MNET32_MODE_WIFI_STA;
 }
 
-void mnet32_state_set_status_busy(void) {
-    state->status = MNET32_STATUS_BUSY;
-}
-
-void mnet32_state_set_status_connecting(void) {
-    state->status = MNET32_STATUS_CONNECTING;
-}
-
-void mnet32_state_set_status_idle(void) {
-    state->status = MNET32_STATUS_IDLE;
-}
-
-void mnet32_state_set_status_ready(void) {
-    state->status = MNET32_STATUS_READY;
+void mnet32_state_set_status(uint8_t status) {
+    state->status = (mnet32_status)status;
 }
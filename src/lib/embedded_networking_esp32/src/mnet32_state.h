@@ -5,6 +5,9 @@
 #ifndef SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_STATE_H_
 #define SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_STATE_H_
 
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
 /* This is ESP-IDF's event library. */
 #include "esp_event.h"
 
@@ -13,27 +16,54 @@
 
 /* FreeRTOS headers.
  * - the ``FreeRTOS.h`` is required
+ * - ``queue.h`` for the notifications of the task
  * - ``task.h`` for task management
  */
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/task.h"
 
 
+/**
+ * Specify the actual status of the connection.
+ *
+ * The connection status must be evaluated in the context of its ``medium`` -
+ * and in case of a wireless connection - its ``mode``.
+ *
+ * This is tracked in the component's ::state.
+ */
+typedef enum {
+    MNET32_STATUS_DOWN,
+    MNET32_STATUS_READY,
+    MNET32_STATUS_CONNECTING,
+    MNET32_STATUS_IDLE,
+    MNET32_STATUS_BUSY,
+} mnet32_status;
+
+
 void mnet32_state_init(void);
 void mnet32_state_destroy(void);
 void mnet32_state_medium_state_init(size_t size);
 void mnet32_state_medium_state_destroy(void);
+esp_err_t mnet32_state_eth_state_init(size_t size);
+void mnet32_state_eth_state_destroy(void);
 
+bool mnet32_state_is_available(void);
 bool mnet32_state_is_initialized(void);
 bool mnet32_state_is_medium_state_initialized(void);
+bool mnet32_state_is_eth_state_initialized(void);
 
 bool mnet32_state_is_interface_set(void);
+bool mnet32_state_is_medium_ethernet(void);
 bool mnet32_state_is_medium_wireless(void);
 bool mnet32_state_is_mode_ap(void);
 bool mnet32_state_is_mode_set(void);
 bool mnet32_state_is_mode_sta(void);
 bool mnet32_state_is_status_idle(void);
 
+esp_event_handler_t mnet32_state_get_eth_event_handler(void);
+esp_event_handler_t* mnet32_state_get_eth_event_handler_ptr(void);
+void* mnet32_state_get_eth_state(void);
 esp_netif_t* mnet32_state_get_interface(void);
 esp_event_handler_t mnet32_state_get_ip_event_handler(void);
 esp_event_handler_t* mnet32_state_get_ip_event_handler_ptr(void);
@@ -41,19 +71,21 @@ esp_event_handler_t mnet32_state_get_medium_event_handler(void);
 esp_event_handler_t* mnet32_state_get_medium_event_handler_ptr(void);
 void* mnet32_state_get_medium_state(void);
 uint8_t mnet32_state_get_mode(void);
+uint8_t mnet32_state_get_status(void);
 TaskHandle_t mnet32_state_get_task_handle(void);
 TaskHandle_t* mnet32_state_get_task_handle_ptr(void);
+QueueHandle_t mnet32_state_get_queue(void);
 
+void mnet32_state_set_available(bool available);
 void mnet32_state_clear_interface(void);
 void mnet32_state_set_interface(esp_netif_t* interface);
+void mnet32_state_set_queue(QueueHandle_t queue);
 void mnet32_state_clear_medium(void);
+void mnet32_state_set_medium_ethernet(void);
 void mnet32_state_set_medium_wireless(void);
 void mnet32_state_clear_mode(void);
 void mnet32_state_set_mode_ap(void);
 void mnet32_state_set_mode_sta(void);
-void mnet32_state_set_status_busy(void);
-void mnet32_state_set_status_connecting(void);
-void mnet32_state_set_status_idle(void);
-void mnet32_state_set_status_ready(void);
+void mnet32_state_set_status(uint8_t status);
 
 #endif  // SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_STATE_H_
@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The trace points of the ``mnet32`` component.
+ *
+ * The trace points are a group of ``obs32``'s trace buffers (see
+ * ``obs32_trace.h``), so they are exported with the other components' trace
+ * points as Chrome trace JSON. The timeline shows the notifications of the
+ * component's task, its wakeups and transitions, and the events, that are
+ * posted and dispatched by ``MNET32_EVENTS``'s loop.
+ *
+ * @file   mnet32_trace.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header. */
+#include "mnet32_trace.h"
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * The names of the ::mnet32_trace_point .
+ */
+static const char* const mnet32_trace_names[] = {
+    "notify",
+    "dispatch",
+    "monitor",
+    "event_post",
+    "event_dispatch",
+};
+
+// Documentation in mnet32_trace.h!
+struct obs32_trace_group mnet32_trace_group = {
+    .category = "mnet32",
+    .names = mnet32_trace_names,
+    .count = sizeof(mnet32_trace_names) / sizeof(mnet32_trace_names[0]),
+};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+// Documentation in mnet32_trace.h!
+void mnet32_trace_register(void) {
+    obs32_trace_register(&mnet32_trace_group);
+}
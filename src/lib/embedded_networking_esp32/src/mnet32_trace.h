@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+#ifndef SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_TRACE_H_
+#define SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_TRACE_H_
+
+/* The trace buffers of ``obs32``.
+ * - defines ``struct obs32_trace_group`` and the trace points
+ */
+#include "obs32/obs32_trace.h"
+
+
+/**
+ * The trace points of the component.
+ *
+ * These are the indexes of the names of ::mnet32_trace_group .
+ */
+enum mnet32_trace_point {
+    MNET32_TRACE_NOTIFY = 0,      // a notification is sent, arg: notification
+    MNET32_TRACE_DISPATCH,        // the task's transition, arg: notification
+    MNET32_TRACE_MONITOR,         // the task woke up without notification
+    MNET32_TRACE_EVENT_POST,      // an event is posted, arg: event id
+    MNET32_TRACE_EVENT_DISPATCH,  // an event is dispatched, arg: event id
+};
+
+/**
+ * The group of the component's trace points.
+ */
+extern struct obs32_trace_group mnet32_trace_group;
+
+/**
+ * Register the component's trace points with ``obs32``'s trace buffers.
+ *
+ * The trace points are ignored before. This may be called repeatedly, the
+ * trace points are registered once.
+ */
+void mnet32_trace_register(void);
+
+#endif  // SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_TRACE_H_
@@ -1,8 +0,0 @@
-// SPDX-FileCopyrightText: 2022 Mischback
-// SPDX-License-Identifier: MIT
-// SPDX-FileType: SOURCE
-
-#ifndef SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_WEB_H_
-#define SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_WEB_H_
-
-#endif  // SRC_LIB_EMBEDDED_NETWORKING_ESP32_SRC_MNET32_WEB_H_
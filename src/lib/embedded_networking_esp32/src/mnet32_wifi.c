@@ -18,10 +18,13 @@
 #include "mnet32_wifi.h"
 
 /* C's standard libraries. */
+#include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* Other headers of the component. */
 #include "mnet32/mnet32.h"    // The public header
+#include "mnet32_dns.h"       // the captive portal's DNS responder
 #include "mnet32_internal.h"  // The private header
 #include "mnet32_nvs.h"       // access to non-volatile storage
 #include "mnet32_state.h"     // manage the internal state
@@ -44,14 +47,19 @@
 /* ESP-IDF's network abstraction layer. */
 #include "esp_netif.h"
 
+/* ESP-IDF's high resolution timer, used for the backoff of roaming scans. */
+#include "esp_timer.h"
+
 /* ESP-IDF's wifi library. */
 #include "esp_wifi.h"
 
 /* FreeRTOS headers.
  * - the ``FreeRTOS.h`` is required
+ * - ``task.h`` for the task of the DNS responder
  * - ``timers.h`` for timers
  */
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/timers.h"
 
 /* This is ESP-IDF's library to interface the non-volatile storage (NVS). */
@@ -60,6 +68,12 @@
 
 /* ***** DEFINES *********************************************************** */
 
+/**
+ * The maximum time to wait, while passing the evaluation of the power save
+ * policy to the timer service task.
+ */
+#define MNET32_WIFI_PS_PEND_TIMEOUT pdMS_TO_TICKS(100)
+
 
 /* ***** TYPES ************************************************************* */
 
@@ -83,6 +97,63 @@ struct medium_state_wifi_sta {
     int8_t num_connection_attempts;
 };
 
+/**
+ * State information of the connection in station mode.
+ *
+ * ``connected``, the RSSI samples and the counters are read by other tasks
+ * (see ::mnet32_wifi_sta_get_snapshot ) and are protected by
+ * ::mnet32_wifi_link_lock . All other fields are only accessed by the
+ * component's task.
+ *
+ * Other than ::medium_state_wifi_sta, this is statically allocated, so the
+ * snapshot may be retrieved at any time.
+ */
+struct mnet32_wifi_link {
+    bool connected;
+    uint8_t rssi_head;
+    uint8_t rssi_count;
+    int8_t rssi_history[MNET32_WIFI_RSSI_HISTORY_LEN];
+    uint32_t roam_scans;
+    uint32_t roams;
+    uint8_t bssid[6];
+    bool scanning;
+    bool roam_pending;
+    bool bssid_pinned;
+    int64_t scan_not_before;
+};
+
+/**
+ * State information of the DNS responder in access point mode.
+ *
+ * The responder runs in its own task, which is controlled by the flags. All
+ * fields are protected by ::mnet32_wifi_ap_dns_lock .
+ */
+struct mnet32_wifi_ap_dns {
+    bool running;
+    volatile bool stop;
+    uint32_t address;
+};
+
+/**
+ * State information of the power save policy.
+ *
+ * ``locks`` and the flags are modified by any task and are protected by
+ * ::mnet32_wifi_ps_lock_mux . ``applied`` and ``holdoff_timer`` are only
+ * accessed by the timer service task, which serializes all evaluations of the
+ * policy.
+ *
+ * Other than ::medium_state_wifi_sta, this is not part of the (dynamically
+ * allocated) internal state, as locks may be acquired before the component is
+ * started and are kept while the WiFi is restarted.
+ */
+struct mnet32_wifi_ps {
+    uint16_t locks[MNET32_PS_LOCK_MAX];
+    bool sta_active;
+    bool reapply;
+    wifi_ps_type_t applied;
+    TimerHandle_t holdoff_timer;
+};
+
 
 /* ***** VARIABLES ********************************************************* */
 
@@ -94,14 +165,56 @@ struct medium_state_wifi_sta {
  */
 static const char* TAG = "mnet32.wifi";
 
+/**
+ * The state of the connection in station mode.
+ */
+static struct mnet32_wifi_link mnet32_wifi_link = {0};
+
+/**
+ * Protect the shared fields of ::mnet32_wifi_link .
+ */
+static portMUX_TYPE mnet32_wifi_link_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * The state of the DNS responder.
+ */
+static struct mnet32_wifi_ap_dns mnet32_wifi_ap_dns = {0};
+
+/**
+ * Protect ::mnet32_wifi_ap_dns , as it is accessed from the component's task
+ * and the responder's task.
+ */
+static portMUX_TYPE mnet32_wifi_ap_dns_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * The state of the power save policy.
+ */
+static struct mnet32_wifi_ps mnet32_wifi_ps = {0};
+
+/**
+ * Protect the ``locks`` and flags of ::mnet32_wifi_ps .
+ */
+static portMUX_TYPE mnet32_wifi_ps_lock_mux = portMUX_INITIALIZER_UNLOCKED;
+
 
 /* ***** PROTOTYPES ******************************************************** */
 
 static esp_err_t mnet32_wifi_init(void);
 static esp_err_t mnet32_wifi_ap_deinit(void);
+static void mnet32_wifi_ap_dns_stop(void);
+static void mnet32_wifi_ap_dns_task(void* pvParameters);
 static void mnet32_wifi_ap_timed_shutdown(TimerHandle_t timer);
 static esp_err_t mnet32_wifi_get_config_from_nvs(char** ssid, char** psk);
 static esp_err_t mnet32_wifi_sta_init(char** sta_ssid, char** sta_psk);
+static int8_t mnet32_wifi_link_rssi_avg(void);
+static void mnet32_wifi_link_set_connected(bool connected);
+static void mnet32_wifi_sta_roam_arm(void);
+static void mnet32_wifi_sta_unpin_bssid(void);
+static void mnet32_wifi_ps_apply(wifi_ps_type_t ps_type);
+static void mnet32_wifi_ps_evaluate(void* arg1, uint32_t arg2);
+static void mnet32_wifi_ps_holdoff_expired(TimerHandle_t timer);
+static void mnet32_wifi_ps_schedule(void);
+static void mnet32_wifi_ps_set_sta_active(bool active);
 
 
 /* ***** FUNCTIONS ********************************************************* */
@@ -359,6 +472,8 @@ static esp_err_t mnet32_wifi_ap_deinit(void) {
         ESP_LOGW(TAG, "Continuing with de-initialization...");
     }
 
+    mnet32_wifi_ap_dns_stop();
+
     esp_err_t esp_ret = esp_wifi_stop();
     if (esp_ret != ESP_OK) {
         ESP_LOGE(TAG, "Could not stop WiFi (AP mode)!");
@@ -380,6 +495,115 @@ static esp_err_t mnet32_wifi_ap_deinit(void) {
     return ESP_OK;
 }
 
+void mnet32_wifi_ap_dns_start(void) {
+    ESP_LOGV(TAG, "mnet32_wifi_ap_dns_start()");
+
+    if (!MNET32_WIFI_AP_DNS_ENABLED)
+        return;
+
+    esp_netif_ip_info_t ip_info;
+    if (esp_netif_get_ip_info(mnet32_state_get_interface(), &ip_info) !=
+        ESP_OK) {
+        ESP_LOGE(TAG, "Could not determine the access point's address!");
+        return;
+    }
+
+    bool create;
+
+    portENTER_CRITICAL(&mnet32_wifi_ap_dns_lock);
+    create = !mnet32_wifi_ap_dns.running;
+    mnet32_wifi_ap_dns.running = true;
+    mnet32_wifi_ap_dns.stop = false;
+    mnet32_wifi_ap_dns.address = ip_info.ip.addr;
+    portEXIT_CRITICAL(&mnet32_wifi_ap_dns_lock);
+
+    /* A task, that is still shutting down, just opens its socket again. */
+    if (!create)
+        return;
+
+    if (xTaskCreate(mnet32_wifi_ap_dns_task,
+                    "mnet32_dns",
+                    MNET32_WIFI_AP_DNS_TASK_STACK_SIZE,
+                    NULL,
+                    MNET32_WIFI_AP_DNS_TASK_PRIORITY,
+                    NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Could not create task of the DNS responder!");
+
+        portENTER_CRITICAL(&mnet32_wifi_ap_dns_lock);
+        mnet32_wifi_ap_dns.running = false;
+        portEXIT_CRITICAL(&mnet32_wifi_ap_dns_lock);
+    }
+}
+
+/**
+ * Request the DNS responder to stop.
+ *
+ * The responder's task notices the request within ::MNET32_DNS_POLL_INTERVAL
+ * and terminates itself.
+ */
+static void mnet32_wifi_ap_dns_stop(void) {
+    portENTER_CRITICAL(&mnet32_wifi_ap_dns_lock);
+    if (mnet32_wifi_ap_dns.running)
+        mnet32_wifi_ap_dns.stop = true;
+    portEXIT_CRITICAL(&mnet32_wifi_ap_dns_lock);
+}
+
+/**
+ * The task of the DNS responder.
+ *
+ * The responder (see ::mnet32_dns ) is kept on the task's stack, so its
+ * buffer is only allocated in access point mode.
+ *
+ * If the responder is started again, while the task is shutting down, the
+ * socket is re-opened instead of terminating the task.
+ *
+ * @param pvParameters Not used.
+ */
+static void mnet32_wifi_ap_dns_task(void* pvParameters) {
+    ESP_LOGV(TAG, "mnet32_wifi_ap_dns_task()");
+
+    struct mnet32_dns dns;
+    bool restart;
+
+    do {
+        if (mnet32_dns_open(&dns,
+                            MNET32_DNS_PORT,
+                            mnet32_wifi_ap_dns.address) != 0) {
+            ESP_LOGE(TAG, "Could not open DNS responder (errno %d)!", errno);
+        } else {
+            ESP_LOGI(TAG,
+                     "DNS responder listening on port %d",
+                     MNET32_DNS_PORT);
+        }
+
+        while (!mnet32_wifi_ap_dns.stop) {
+            if (dns.socket < 0) {
+                vTaskDelay(pdMS_TO_TICKS(MNET32_DNS_POLL_INTERVAL));
+                continue;
+            }
+            if (mnet32_dns_serve(&dns) < 0) {
+                ESP_LOGE(TAG, "DNS responder failed (errno %d)!", errno);
+                vTaskDelay(pdMS_TO_TICKS(MNET32_DNS_POLL_INTERVAL));
+            }
+        }
+
+        ESP_LOGD(TAG,
+                 "DNS responder: %u answered, %u dropped",
+                 dns.answered,
+                 dns.dropped);
+        mnet32_dns_close(&dns);
+
+        portENTER_CRITICAL(&mnet32_wifi_ap_dns_lock);
+        restart = !mnet32_wifi_ap_dns.stop;
+        if (!restart)
+            mnet32_wifi_ap_dns.running = false;
+        portEXIT_CRITICAL(&mnet32_wifi_ap_dns_lock);
+    } while (restart);
+
+    ESP_LOGD(TAG, "DNS responder stopped");
+    vTaskDelete(NULL);
+}
+
 /**
  * Stop the networking after a given timespan in access point mode.
  *
@@ -571,6 +795,10 @@ static esp_err_t mnet32_wifi_sta_init(char** sta_ssid, char** sta_psk) {
                  esp_ret);
         return esp_ret;
     }
+
+    /* The driver's power save mode is reset with every initialization. */
+    mnet32_wifi_ps_set_sta_active(true);
+
     esp_ret = esp_wifi_start();
     if (esp_ret != ESP_OK) {
         ESP_LOGE(TAG, "Could not start wifi in station mode!");
@@ -593,6 +821,12 @@ esp_err_t mnet32_wifi_sta_deinit(void) {
         ESP_LOGW(TAG, "Continuing with de-initialization...");
     }
 
+    mnet32_wifi_ps_set_sta_active(false);
+    mnet32_wifi_link_set_connected(false);
+    mnet32_wifi_link.scanning = false;
+    mnet32_wifi_link.roam_pending = false;
+    mnet32_wifi_link.bssid_pinned = false;
+
     esp_err_t esp_ret = esp_wifi_stop();
     if (esp_ret != ESP_OK) {
         ESP_LOGE(TAG, "Could not stop WiFi (station mode)!");
@@ -620,6 +854,16 @@ void mnet32_wifi_sta_connect(void) {
     ((struct medium_state_wifi_sta*)mnet32_state_get_medium_state())
         ->num_connection_attempts++;  // NOLINT(whitespace/line_length)
 
+    mnet32_wifi_link_set_connected(false);
+
+    /* A roam pins the BSSID for exactly one connection attempt, so the
+     * component does not stick to an access point, that became unavailable.
+     */
+    if (mnet32_wifi_link.roam_pending)
+        mnet32_wifi_link.roam_pending = false;
+    else if (mnet32_wifi_link.bssid_pinned)
+        mnet32_wifi_sta_unpin_bssid();
+
     esp_err_t esp_ret = esp_wifi_connect();
     if (esp_ret != ESP_OK) {
         ESP_LOGE(TAG, "Connect command failed!");
@@ -650,3 +894,505 @@ esp_err_t mnet32_wifi_start(void) {
 
     return ESP_OK;
 }
+
+/**
+ * Calculate the rolling average of the RSSI samples.
+ *
+ * The caller must hold ::mnet32_wifi_link_lock .
+ *
+ * @return int8_t The average RSSI or ``0`` if there are no samples.
+ */
+static int8_t mnet32_wifi_link_rssi_avg(void) {
+    if (mnet32_wifi_link.rssi_count == 0)
+        return 0;
+
+    int sum = 0;
+    for (uint8_t i = 0; i < mnet32_wifi_link.rssi_count; i++)
+        sum += mnet32_wifi_link.rssi_history[i];
+
+    return (int8_t)(sum / mnet32_wifi_link.rssi_count);
+}
+
+/**
+ * Track, if the component is connected in station mode.
+ *
+ * The RSSI samples are discarded with every change, as they belong to a
+ * specific access point.
+ *
+ * @param connected ``true`` if a connection is established.
+ */
+static void mnet32_wifi_link_set_connected(bool connected) {
+    portENTER_CRITICAL(&mnet32_wifi_link_lock);
+    mnet32_wifi_link.connected = connected;
+    mnet32_wifi_link.rssi_head = 0;
+    mnet32_wifi_link.rssi_count = 0;
+    portEXIT_CRITICAL(&mnet32_wifi_link_lock);
+}
+
+/**
+ * Arm the driver's RSSI threshold.
+ *
+ * The driver emits ``WIFI_EVENT_STA_BSS_RSSI_LOW`` once, if the signal drops
+ * below ::MNET32_WIFI_ROAM_RSSI_THRESHOLD , so the threshold is armed again
+ * after every scan.
+ */
+static void mnet32_wifi_sta_roam_arm(void) {
+    if (!MNET32_WIFI_ROAM_ENABLED)
+        return;
+
+    esp_err_t esp_ret =
+        esp_wifi_set_rssi_threshold(MNET32_WIFI_ROAM_RSSI_THRESHOLD);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGW(TAG, "Could not set RSSI threshold!");
+        ESP_LOGD(TAG,
+                 "'esp_wifi_set_rssi_threshold()' returned %s [%d]",
+                 esp_err_to_name(esp_ret),
+                 esp_ret);
+    }
+}
+
+/**
+ * Allow the driver to connect to any access point of the network again.
+ */
+static void mnet32_wifi_sta_unpin_bssid(void) {
+    wifi_config_t sta_config;
+
+    mnet32_wifi_link.bssid_pinned = false;
+
+    if (esp_wifi_get_config(WIFI_IF_STA, &sta_config) != ESP_OK)
+        return;
+
+    sta_config.sta.bssid_set = false;
+    if (esp_wifi_set_config(WIFI_IF_STA, &sta_config) != ESP_OK)
+        ESP_LOGW(TAG, "Could not reset BSSID!");
+}
+
+void mnet32_wifi_sta_link_up(void) {
+    ESP_LOGV(TAG, "mnet32_wifi_sta_link_up()");
+
+    wifi_ap_record_t ap_info;
+
+    mnet32_wifi_link_set_connected(true);
+    if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
+        memcpy(mnet32_wifi_link.bssid, ap_info.bssid, 6);
+        ESP_LOGI(TAG,
+                 "Connected to %02x:%02x:%02x:%02x:%02x:%02x (%d dBm)",
+                 ap_info.bssid[0],
+                 ap_info.bssid[1],
+                 ap_info.bssid[2],
+                 ap_info.bssid[3],
+                 ap_info.bssid[4],
+                 ap_info.bssid[5],
+                 ap_info.rssi);
+    }
+
+    mnet32_wifi_sta_roam_arm();
+}
+
+void mnet32_wifi_sta_monitor(void) {
+    ESP_LOGV(TAG, "mnet32_wifi_sta_monitor()");
+
+    if (!mnet32_wifi_link.connected)
+        return;
+
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+        ESP_LOGD(TAG, "Could not sample RSSI!");
+        return;
+    }
+
+    int8_t rssi_avg;
+
+    portENTER_CRITICAL(&mnet32_wifi_link_lock);
+    mnet32_wifi_link.rssi_history[mnet32_wifi_link.rssi_head] = ap_info.rssi;
+    mnet32_wifi_link.rssi_head =
+        (mnet32_wifi_link.rssi_head + 1) % MNET32_WIFI_RSSI_HISTORY_LEN;
+    if (mnet32_wifi_link.rssi_count < MNET32_WIFI_RSSI_HISTORY_LEN)
+        mnet32_wifi_link.rssi_count++;
+    rssi_avg = mnet32_wifi_link_rssi_avg();
+    portEXIT_CRITICAL(&mnet32_wifi_link_lock);
+
+    ESP_LOGD(TAG, "RSSI: %d dBm (average %d dBm)", ap_info.rssi, rssi_avg);
+
+    /* ``WIFI_EVENT_STA_BSS_RSSI_LOW`` is only emitted once, so a weak
+     * average keeps looking for a stronger access point (limited by the
+     * backoff).
+     */
+    if (MNET32_WIFI_ROAM_ENABLED &&
+        (rssi_avg < MNET32_WIFI_ROAM_RSSI_THRESHOLD))
+        mnet32_wifi_sta_roam_scan();
+}
+
+void mnet32_wifi_sta_roam_scan(void) {
+    ESP_LOGV(TAG, "mnet32_wifi_sta_roam_scan()");
+
+    if (!MNET32_WIFI_ROAM_ENABLED || !mnet32_wifi_link.connected ||
+        mnet32_wifi_link.scanning)
+        return;
+
+    if (esp_timer_get_time() < mnet32_wifi_link.scan_not_before) {
+        ESP_LOGD(TAG, "Skipping scan (backoff)");
+        return;
+    }
+
+    wifi_config_t sta_config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &sta_config) != ESP_OK)
+        return;
+
+    /* Only the current network is of interest. */
+    wifi_scan_config_t scan_config = {
+        .ssid = sta_config.sta.ssid,
+        .show_hidden = false,
+    };
+
+    esp_err_t esp_ret = esp_wifi_scan_start(&scan_config, false);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGW(TAG, "Could not start scan!");
+        ESP_LOGD(TAG,
+                 "'esp_wifi_scan_start()' returned %s [%d]",
+                 esp_err_to_name(esp_ret),
+                 esp_ret);
+        return;
+    }
+
+    ESP_LOGI(TAG, "Weak signal, scanning for a stronger access point");
+    mnet32_wifi_link.scanning = true;
+    mnet32_wifi_link.scan_not_before =
+        esp_timer_get_time() + (int64_t)MNET32_WIFI_ROAM_BACKOFF * 1000;
+
+    portENTER_CRITICAL(&mnet32_wifi_link_lock);
+    mnet32_wifi_link.roam_scans++;
+    portEXIT_CRITICAL(&mnet32_wifi_link_lock);
+}
+
+void mnet32_wifi_sta_roam_evaluate(void) {
+    ESP_LOGV(TAG, "mnet32_wifi_sta_roam_evaluate()");
+
+    /* The scan results have to be fetched in any case, otherwise the driver
+     * keeps them allocated.
+     */
+    uint16_t num = MNET32_WIFI_ROAM_SCAN_MAX_RECORDS;
+    wifi_ap_record_t* records = calloc(num, sizeof(wifi_ap_record_t));
+    if (records == NULL) {
+        ESP_LOGE(TAG, "Could not allocate memory for scan results!");
+        num = 0;
+    }
+    if (esp_wifi_scan_get_ap_records(&num, records) != ESP_OK)
+        num = 0;
+
+    bool scanning = mnet32_wifi_link.scanning;
+    mnet32_wifi_link.scanning = false;
+
+    if (!scanning || !mnet32_wifi_link.connected) {
+        free(records);
+        return;
+    }
+
+    int8_t rssi_avg;
+    portENTER_CRITICAL(&mnet32_wifi_link_lock);
+    rssi_avg = mnet32_wifi_link_rssi_avg();
+    portEXIT_CRITICAL(&mnet32_wifi_link_lock);
+
+    /* Find the strongest access point other than the current one. */
+    wifi_ap_record_t* best = NULL;
+    for (uint16_t i = 0; i < num; i++) {
+        if (memcmp(records[i].bssid, mnet32_wifi_link.bssid, 6) == 0)
+            continue;
+        if ((best == NULL) || (records[i].rssi > best->rssi))
+            best = &records[i];
+    }
+
+    wifi_config_t sta_config;
+    if ((best == NULL) ||
+        (best->rssi < rssi_avg + MNET32_WIFI_ROAM_RSSI_MARGIN) ||
+        (esp_wifi_get_config(WIFI_IF_STA, &sta_config) != ESP_OK)) {
+        ESP_LOGD(TAG, "No stronger access point found");
+        free(records);
+        mnet32_wifi_sta_roam_arm();
+        return;
+    }
+
+    ESP_LOGI(TAG,
+             "Roaming to %02x:%02x:%02x:%02x:%02x:%02x (%d dBm, was %d dBm)",
+             best->bssid[0],
+             best->bssid[1],
+             best->bssid[2],
+             best->bssid[3],
+             best->bssid[4],
+             best->bssid[5],
+             best->rssi,
+             rssi_avg);
+
+    /* Pin the BSSID and disconnect. The reconnect is handled like any other
+     * disconnect, see ::mnet32_wifi_sta_connect .
+     */
+    sta_config.sta.bssid_set = true;
+    memcpy(sta_config.sta.bssid, best->bssid, 6);
+    free(records);
+
+    esp_err_t esp_ret = esp_wifi_set_config(WIFI_IF_STA, &sta_config);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Could not set BSSID!");
+        ESP_LOGD(TAG,
+                 "'esp_wifi_set_config()' returned %s [%d]",
+                 esp_err_to_name(esp_ret),
+                 esp_ret);
+        mnet32_wifi_sta_roam_arm();
+        return;
+    }
+    mnet32_wifi_link.bssid_pinned = true;
+    mnet32_wifi_link.roam_pending = true;
+
+    portENTER_CRITICAL(&mnet32_wifi_link_lock);
+    mnet32_wifi_link.roams++;
+    portEXIT_CRITICAL(&mnet32_wifi_link_lock);
+
+    esp_wifi_disconnect();
+}
+
+void mnet32_wifi_sta_get_snapshot(struct mnet32_status_snapshot* snapshot) {
+    portENTER_CRITICAL(&mnet32_wifi_link_lock);
+    snapshot->connected = mnet32_wifi_link.connected;
+    snapshot->rssi_count = mnet32_wifi_link.rssi_count;
+    snapshot->rssi_avg = mnet32_wifi_link_rssi_avg();
+    snapshot->rssi = 0;
+    for (uint8_t i = 0; i < mnet32_wifi_link.rssi_count; i++) {
+        /* The oldest sample is at ``rssi_head`` once the buffer is full. */
+        uint8_t pos = (mnet32_wifi_link.rssi_count <
+                       MNET32_WIFI_RSSI_HISTORY_LEN)
+                          ? i
+                          : (mnet32_wifi_link.rssi_head + i) %
+                                MNET32_WIFI_RSSI_HISTORY_LEN;
+        snapshot->rssi_history[i] = mnet32_wifi_link.rssi_history[pos];
+        snapshot->rssi = snapshot->rssi_history[i];
+    }
+    snapshot->roam_scans = mnet32_wifi_link.roam_scans;
+    snapshot->roams = mnet32_wifi_link.roams;
+    portEXIT_CRITICAL(&mnet32_wifi_link_lock);
+}
+
+/**
+ * Determine the power save mode, that satisfies the current demand.
+ *
+ * @param locks The number of held locks of every ::mnet32_ps_lock .
+ * @return wifi_ps_type_t The required power save mode.
+ */
+static wifi_ps_type_t mnet32_wifi_ps_demand(const uint16_t* locks) {
+    if (locks[MNET32_PS_LOCK_PERFORMANCE] > 0)
+        return WIFI_PS_NONE;
+    if (locks[MNET32_PS_LOCK_INTERACTIVE] > 0)
+        return WIFI_PS_MIN_MODEM;
+    return MNET32_WIFI_PS_IDLE;
+}
+
+/**
+ * Apply a power save mode to the WiFi driver.
+ *
+ * This must only be called from the timer service task.
+ *
+ * @param ps_type The power save mode.
+ */
+static void mnet32_wifi_ps_apply(wifi_ps_type_t ps_type) {
+    ESP_LOGV(TAG, "mnet32_wifi_ps_apply()");
+
+    esp_err_t esp_ret = esp_wifi_set_ps(ps_type);
+    if (esp_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Could not set power save mode!");
+        ESP_LOGD(TAG,
+                 "'esp_wifi_set_ps()' returned %s [%d]",
+                 esp_err_to_name(esp_ret),
+                 esp_ret);
+        return;
+    }
+
+    mnet32_wifi_ps.applied = ps_type;
+    ESP_LOGD(TAG, "Power save mode: %d", ps_type);
+}
+
+/**
+ * Evaluate the power save policy.
+ *
+ * A mode with less power saving (i.e. lower latency) is applied immediately,
+ * while a mode with more power saving is only applied, if the demand stays
+ * low for ::MNET32_WIFI_PS_HOLDOFF (hysteresis). This avoids toggling the
+ * mode, if locks are acquired and released in quick succession (e.g. by
+ * short-lived http sessions).
+ *
+ * The function is executed by the timer service task (see
+ * ::mnet32_wifi_ps_schedule ), so the evaluations are serialized.
+ *
+ * @param arg1 Not used.
+ * @param arg2 Not used.
+ */
+static void mnet32_wifi_ps_evaluate(void* arg1, uint32_t arg2) {
+    ESP_LOGV(TAG, "mnet32_wifi_ps_evaluate()");
+
+    uint16_t locks[MNET32_PS_LOCK_MAX];
+    bool active;
+    bool reapply;
+
+    portENTER_CRITICAL(&mnet32_wifi_ps_lock_mux);
+    memcpy(locks, mnet32_wifi_ps.locks, sizeof(locks));
+    active = mnet32_wifi_ps.sta_active;
+    reapply = mnet32_wifi_ps.reapply;
+    mnet32_wifi_ps.reapply = false;
+    portEXIT_CRITICAL(&mnet32_wifi_ps_lock_mux);
+
+    if (mnet32_wifi_ps.holdoff_timer == NULL) {
+        mnet32_wifi_ps.holdoff_timer =
+            xTimerCreate("mnet32_ps_holdoff",
+                         pdMS_TO_TICKS(MNET32_WIFI_PS_HOLDOFF),
+                         pdFALSE,
+                         NULL,
+                         mnet32_wifi_ps_holdoff_expired);
+    }
+
+    /* Power save only applies to station mode. */
+    if (!active) {
+        if (mnet32_wifi_ps.holdoff_timer != NULL)
+            xTimerStop(mnet32_wifi_ps.holdoff_timer, (TickType_t)0);
+        return;
+    }
+
+    wifi_ps_type_t demand = mnet32_wifi_ps_demand(locks);
+
+    if (reapply || (demand < mnet32_wifi_ps.applied) ||
+        (mnet32_wifi_ps.holdoff_timer == NULL)) {
+        if (mnet32_wifi_ps.holdoff_timer != NULL)
+            xTimerStop(mnet32_wifi_ps.holdoff_timer, (TickType_t)0);
+        mnet32_wifi_ps_apply(demand);
+        return;
+    }
+
+    if (demand == mnet32_wifi_ps.applied) {
+        xTimerStop(mnet32_wifi_ps.holdoff_timer, (TickType_t)0);
+        return;
+    }
+
+    if (xTimerIsTimerActive(mnet32_wifi_ps.holdoff_timer) != pdTRUE)
+        xTimerStart(mnet32_wifi_ps.holdoff_timer, (TickType_t)0);
+}
+
+/**
+ * Apply a mode with more power saving after the hold-off time.
+ *
+ * @param timer The timer object this function is attached to.
+ */
+static void mnet32_wifi_ps_holdoff_expired(TimerHandle_t timer) {
+    ESP_LOGV(TAG, "mnet32_wifi_ps_holdoff_expired()");
+
+    uint16_t locks[MNET32_PS_LOCK_MAX];
+    bool active;
+
+    portENTER_CRITICAL(&mnet32_wifi_ps_lock_mux);
+    memcpy(locks, mnet32_wifi_ps.locks, sizeof(locks));
+    active = mnet32_wifi_ps.sta_active;
+    portEXIT_CRITICAL(&mnet32_wifi_ps_lock_mux);
+
+    wifi_ps_type_t demand = mnet32_wifi_ps_demand(locks);
+    if (active && (demand != mnet32_wifi_ps.applied))
+        mnet32_wifi_ps_apply(demand);
+}
+
+/**
+ * Pass the evaluation of the power save policy to the timer service task.
+ */
+static void mnet32_wifi_ps_schedule(void) {
+    if (xTimerPendFunctionCall(mnet32_wifi_ps_evaluate,
+                               NULL,
+                               0,
+                               MNET32_WIFI_PS_PEND_TIMEOUT) != pdPASS) {
+        ESP_LOGE(TAG, "Could not evaluate power save policy!");
+    }
+}
+
+/**
+ * Track, if the WiFi is initialized in station mode.
+ *
+ * On activation, the power save mode is applied immediately, as the driver
+ * resets it with every initialization.
+ *
+ * @param active ``true`` if the WiFi is initialized in station mode.
+ */
+static void mnet32_wifi_ps_set_sta_active(bool active) {
+    portENTER_CRITICAL(&mnet32_wifi_ps_lock_mux);
+    mnet32_wifi_ps.sta_active = active;
+    mnet32_wifi_ps.reapply = active;
+    portEXIT_CRITICAL(&mnet32_wifi_ps_lock_mux);
+
+    mnet32_wifi_ps_schedule();
+}
+
+// This function is part of the component's public interface and documented in
+// ``include/mnet32/mnet32.h``
+esp_err_t mnet32_ps_lock_acquire(enum mnet32_ps_lock lock) {
+    ESP_LOGV(TAG, "mnet32_ps_lock_acquire()");
+
+    if (lock >= MNET32_PS_LOCK_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    portENTER_CRITICAL(&mnet32_wifi_ps_lock_mux);
+    mnet32_wifi_ps.locks[lock]++;
+    portEXIT_CRITICAL(&mnet32_wifi_ps_lock_mux);
+
+    mnet32_wifi_ps_schedule();
+    return ESP_OK;
+}
+
+// This function is part of the component's public interface and documented in
+// ``include/mnet32/mnet32.h``
+esp_err_t mnet32_ps_lock_release(enum mnet32_ps_lock lock) {
+    ESP_LOGV(TAG, "mnet32_ps_lock_release()");
+
+    if (lock >= MNET32_PS_LOCK_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_err_t ret = ESP_OK;
+
+    portENTER_CRITICAL(&mnet32_wifi_ps_lock_mux);
+    if (mnet32_wifi_ps.locks[lock] == 0)
+        ret = ESP_ERR_INVALID_STATE;
+    else
+        mnet32_wifi_ps.locks[lock]--;
+    portEXIT_CRITICAL(&mnet32_wifi_ps_lock_mux);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Lock %d is not held!", lock);
+        return ret;
+    }
+
+    mnet32_wifi_ps_schedule();
+    return ESP_OK;
+}
+
+// This function is part of the component's public interface and documented in
+// ``include/mnet32/mnet32.h``
+esp_err_t mnet32_set_credentials(const char* ssid, const char* psk) {
+    ESP_LOGV(TAG, "mnet32_set_credentials()");
+
+    if ((ssid == NULL) || (psk == NULL) ||
+        (strlen(ssid) >= MNET32_WIFI_SSID_MAX_LEN) ||
+        (strlen(psk) >= MNET32_WIFI_PSK_MAX_LEN))
+        return ESP_ERR_INVALID_ARG;
+
+    nvs_handle_t handle;
+    esp_err_t esp_ret;
+
+    esp_ret = mnet32_nvs_get_handle(NVS_READWRITE, &handle);
+    if (esp_ret != ESP_OK)
+        return esp_ret;
+    ESP_LOGD(TAG, "Handle '%s' successfully opened!", MNET32_NVS_NAMESPACE);
+
+    esp_ret = mnet32_nvs_write_string(handle, MNET32_WIFI_NVS_SSID, ssid);
+    if (esp_ret != ESP_OK)
+        return esp_ret;
+
+    esp_ret = mnet32_nvs_write_string(handle, MNET32_WIFI_NVS_PSK, psk);
+    if (esp_ret != ESP_OK)
+        return esp_ret;
+
+    // The new credentials are picked up, while the WiFi is restarted
+    mnet32_notify(MNET32_NOTIFICATION_CMD_WIFI_RESTART);
+
+    return ESP_OK;
+}
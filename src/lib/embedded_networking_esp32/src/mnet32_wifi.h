@@ -8,6 +8,9 @@
 /* This is ESP-IDF's error handling library. */
 #include "esp_err.h"
 
+/* The public header, required for ``struct mnet32_status_snapshot``. */
+#include "mnet32/mnet32.h"
+
 
 /**
  * The component-specific key to access the NVS to set/get the stored SSID.
@@ -37,6 +40,15 @@
  */
 #define MNET32_WIFI_PSK_MAX_LEN 64
 
+/**
+ * Start the DNS responder of the captive portal.
+ *
+ * The responder answers every query for an address with the access point's
+ * own address (see ::MNET32_WIFI_AP_DNS_ENABLED ). It runs in its own task
+ * and is stopped with the access point.
+ */
+void mnet32_wifi_ap_dns_start(void);
+
 /**
  * Get the number of connected stations in access point mode.
  *
@@ -132,11 +144,60 @@ esp_err_t mnet32_wifi_sta_deinit(void);
  */
 int8_t mnet32_wifi_sta_get_num_connection_attempts(void);
 
+/**
+ * Get the status of the connection in station mode.
+ *
+ * This may be called from any task.
+ *
+ * @param snapshot The RSSI history and the roaming counters are copied into
+ *                 this struct.
+ */
+void mnet32_wifi_sta_get_snapshot(struct mnet32_status_snapshot* snapshot);
+
+/**
+ * The connection in station mode is established.
+ *
+ * Start a new RSSI history for the access point and arm the RSSI threshold,
+ * if roaming is enabled.
+ */
+void mnet32_wifi_sta_link_up(void);
+
+/**
+ * Sample the RSSI of the current access point.
+ *
+ * This is meant to be called periodically by ::mnet32_task . If the rolling
+ * average is below ::MNET32_WIFI_ROAM_RSSI_THRESHOLD , a scan for a stronger
+ * access point is started (see ::mnet32_wifi_sta_roam_scan ).
+ */
+void mnet32_wifi_sta_monitor(void);
+
 /**
  * Reset the number of failed connection attempts.
  */
 void mnet32_wifi_sta_reset_connection_counter(void);
 
+/**
+ * Evaluate the results of a scan and roam to a stronger access point.
+ *
+ * An access point is only used, if its RSSI exceeds the rolling average of
+ * the current access point by ::MNET32_WIFI_ROAM_RSSI_MARGIN . Its BSSID is
+ * pinned for the next connection attempt and the current connection is
+ * closed; the reconnect is handled like any other disconnect.
+ *
+ * This must be called for every ``WIFI_EVENT_SCAN_DONE``, as it frees the
+ * scan results.
+ */
+void mnet32_wifi_sta_roam_evaluate(void);
+
+/**
+ * Scan for a stronger access point of the current network.
+ *
+ * The scan is skipped, if roaming is disabled, another scan is running or
+ * the last scan was started less than ::MNET32_WIFI_ROAM_BACKOFF milliseconds
+ * ago.
+ */
+void mnet32_wifi_sta_roam_scan(void);
+
 /**
  * Starts a WiFi connection.
  *
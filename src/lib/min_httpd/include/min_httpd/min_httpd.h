@@ -30,6 +30,26 @@
  */
 #include "esp_http_server.h"
 
+/* The tables of packed assets.
+ * - defines ``struct min_httpd_asset_table``
+ */
+#include "min_httpd/min_httpd_assets.h"
+
+/* The per-request arena.
+ * - defines ``struct min_httpd_arena``
+ */
+#include "min_httpd/min_httpd_arena.h"
+
+/* The streaming JSON writer.
+ * - defines ``struct min_httpd_json``
+ */
+#include "min_httpd/min_httpd_json.h"
+
+/* The compiled HTML templates.
+ * - defines ``struct min_httpd_template``
+ */
+#include "min_httpd/min_httpd_template.h"
+
 
 /**
  * The port the server will listen.
@@ -45,13 +65,565 @@
 /**
  * Maximum number of URI handlers for the server.
  *
- * ``8`` is actually the default value as provided by **ESP-IDF**'s
- * ``HTTPD_DEFAULT_CONFIG()``, but it may (and probably must) be overridden
- * with a project-specific value.
+ * ``8`` is the default value as provided by **ESP-IDF**'s
+ * ``HTTPD_DEFAULT_CONFIG()``, but the handlers of this component and of the
+ * other components of the project exceed it.
  *
  * @todo Make this configurable (pre-build with ``sdkconfig``)
  */
-#define MIN_HTTPD_MAX_URI_HANDLERS 8
+#define MIN_HTTPD_MAX_URI_HANDLERS 12
+
+/**
+ * Maximum time to wait while posting ``MIN_HTTPD_SESSIONS_CHANGED``, given in
+ * milliseconds.
+ *
+ * The event is posted from the server's task, so it must not block for long.
+ * If the event is dropped, the next one provides the current number anyway.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_SESSION_EVENT_TIMEOUT 10
+
+/**
+ * Provide a WebSocket push channel (see ::min_httpd_ws_broadcast ).
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MIN_HTTPD_WS_ENABLED
+#define MIN_HTTPD_WS_ENABLED 1
+#else
+#define MIN_HTTPD_WS_ENABLED 0
+#endif
+
+/**
+ * The URI of the WebSocket push channel.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_WS_URI "/ws"
+
+/**
+ * The maximum number of subscribers of the WebSocket push channel.
+ *
+ * Every subscriber keeps one of the server's sessions open (**ESP-IDF**'s
+ * default is ``7``), so there must be sessions left for regular requests.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_WS_MAX_SUBSCRIBERS 5
+
+/**
+ * The maximum length of a message of the WebSocket push channel.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_WS_MAX_MESSAGE_LEN 1024
+
+/**
+ * The maximum number of broadcasts, that wait for the server's task.
+ *
+ * Every pending broadcast holds its frame on the heap, so further broadcasts
+ * are rejected, if the server does not keep up.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_WS_MAX_PENDING 4
+
+/**
+ * Provide a Server-Sent Events stream (see ::min_httpd_sse_publish ).
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MIN_HTTPD_SSE_ENABLED
+#define MIN_HTTPD_SSE_ENABLED 1
+#else
+#define MIN_HTTPD_SSE_ENABLED 0
+#endif
+
+/**
+ * The URI of the Server-Sent Events stream.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_SSE_URI "/events"
+
+/**
+ * The maximum number of clients of the Server-Sent Events stream.
+ *
+ * Just like the subscribers of the WebSocket push channel, every client keeps
+ * one of the server's sessions open.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_SSE_MAX_CLIENTS 3
+
+/**
+ * The maximum length of the data of an event of the Server-Sent Events
+ * stream.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_SSE_MAX_EVENT_LEN 512
+
+/**
+ * The maximum number of events, that wait for the server's task.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_SSE_MAX_PENDING 4
+
+/**
+ * The number of worker tasks, that process requests of offloaded routes (see
+ * ::min_httpd_register_route ).
+ *
+ * With ``0``, offloaded routes are processed by the server's task, just like
+ * inline routes.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MIN_HTTPD_WORKERS CONFIG_MIN_HTTPD_WORKERS
+
+/**
+ * The core, that the worker tasks are pinned to, ``-1`` for no affinity.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MIN_HTTPD_WORKER_CORE CONFIG_MIN_HTTPD_WORKER_CORE
+
+/**
+ * The **freeRTOS**-specific priority of the worker tasks.
+ *
+ * This is below the priority of the server's task (``5``), so requests of
+ * inline routes are processed first.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_WORKER_PRIORITY 4
+
+/**
+ * The stack size of the worker tasks.
+ *
+ * The handlers of offloaded routes are executed in these tasks, so the value
+ * depends on the registered routes (e.g. writing to the NVS).
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_WORKER_STACK_SIZE 4096
+
+/**
+ * The maximum number of requests of offloaded routes, that wait for a worker.
+ *
+ * Further requests are answered with ``503 Service Unavailable``.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_OFFLOAD_QUEUE_LEN 4
+
+/**
+ * The maximum length of the body of a request of an offloaded route.
+ *
+ * The body is received by the server's task before the request is handed to
+ * a worker. Longer requests are answered with ``413 Payload Too Large``. The
+ * body, the URI and the response are allocated from the job's arena, so this
+ * must be well below ::MIN_HTTPD_ARENA_LEN .
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_OFFLOAD_MAX_BODY 512
+
+/**
+ * The budget of a request, in bytes.
+ *
+ * Handlers allocate their temporary memory from the request's arena (see
+ * ::min_httpd_request_arena and ::min_httpd_job ), which is reset after the
+ * response was sent. The arenas are allocated statically: one for the
+ * requests of inline routes and one for every pending job of offloaded
+ * routes.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MIN_HTTPD_ARENA_LEN CONFIG_MIN_HTTPD_ARENA_LEN
+
+/**
+ * The recommended size of the chunks of JSON responses.
+ *
+ * Documents, that fit into a single chunk, are sent with a
+ * ``Content-Length``, longer documents with chunked encoding (see
+ * ::min_httpd_json_response ).
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_JSON_CHUNK_LEN 256
+
+/**
+ * The number of paths of missing resources, that are remembered, so repeated
+ * requests are answered right away and are not logged again.
+ *
+ * Common probes of browsers (e.g. ``/robots.txt``) are remembered in addition
+ * to these. Every entry stores the path, which takes about 56 bytes of RAM.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_MISS_CACHE_SIZE 16
+
+/**
+ * Limit the request rate of every client.
+ *
+ * Every client (by its address) has a token bucket, that is refilled with
+ * ::MIN_HTTPD_LIMIT_RATE tokens per second up to ::MIN_HTTPD_LIMIT_BURST
+ * tokens. A request takes the tokens of its route (see
+ * ::min_httpd_route ), otherwise it is answered with
+ * ``429 Too Many Requests``, before its handler is executed.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MIN_HTTPD_LIMIT_ENABLED
+#define MIN_HTTPD_LIMIT_ENABLED 1
+#else
+#define MIN_HTTPD_LIMIT_ENABLED 0
+#endif
+
+/**
+ * The tokens, that are added to a client's bucket per second.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MIN_HTTPD_LIMIT_RATE
+#define MIN_HTTPD_LIMIT_RATE CONFIG_MIN_HTTPD_LIMIT_RATE
+#else
+#define MIN_HTTPD_LIMIT_RATE 10
+#endif
+
+/**
+ * The tokens of a full bucket, i.e. the requests of a client, that are
+ * admitted at once (e.g. loading a page with its assets).
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MIN_HTTPD_LIMIT_BURST
+#define MIN_HTTPD_LIMIT_BURST CONFIG_MIN_HTTPD_LIMIT_BURST
+#else
+#define MIN_HTTPD_LIMIT_BURST 30
+#endif
+
+/**
+ * The number of clients, whose buckets are remembered.
+ *
+ * If more clients send requests, the bucket of the client, that was seen
+ * least recently, is replaced.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_LIMIT_CLIENTS 8
+
+/**
+ * The tokens of a request of an inline route, the homepage, an asset or a
+ * missing resource.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_LIMIT_COST_INLINE 1
+
+/**
+ * The tokens of a request of an offloaded route, which occupies a worker
+ * and a job's arena.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_LIMIT_COST_OFFLOADED 4
+
+/**
+ * The tokens of the upgrade of a session to the WebSocket push channel or the
+ * Server-Sent Events stream, which keeps the session open, until the client
+ * closes it.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_LIMIT_COST_UPGRADE 4
+
+/**
+ * The tokens of a firmware upload, which occupies the server's task, until
+ * the firmware is written to the OTA partition.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_LIMIT_COST_OTA 8
+
+/**
+ * The minimum free heap to admit requests, in bytes, ``0`` to admit requests
+ * regardless of the heap.
+ *
+ * Below this, requests are answered with ``503 Service Unavailable`` and
+ * their sessions are closed, so the server sheds load, before the network
+ * stack runs out of memory.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MIN_HTTPD_LIMIT_MIN_HEAP CONFIG_MIN_HTTPD_LIMIT_MIN_HEAP
+
+/**
+ * Provide the registered metrics in the Prometheus text format (see
+ * ::MIN_HTTPD_METRICS_URI ).
+ *
+ * Metrics are registered and updated regardless of this setting (see
+ * ``obs32/obs32_metrics.h``).
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MIN_HTTPD_METRICS_ENABLED
+#define MIN_HTTPD_METRICS_ENABLED 1
+#else
+#define MIN_HTTPD_METRICS_ENABLED 0
+#endif
+
+/**
+ * The URI of the metrics.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_METRICS_URI "/metrics"
+
+/**
+ * The share of the time, that rendering the metrics may take, in percent.
+ *
+ * A scrape, that arrives sooner than the rendering time of the previous
+ * scrape allows, is answered with ``429 Too Many Requests``, so a short scrape
+ * interval can not occupy the server's task. The time, that sending the
+ * response waits for the client, is not charged.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MIN_HTTPD_METRICS_CPU_BUDGET
+#define MIN_HTTPD_METRICS_CPU_BUDGET CONFIG_MIN_HTTPD_METRICS_CPU_BUDGET
+#else
+#define MIN_HTTPD_METRICS_CPU_BUDGET 2
+#endif
+
+/**
+ * The size of the chunks of the metrics' response.
+ *
+ * The buffer is located on the stack of the server's task.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_METRICS_CHUNK_LEN 512
+
+/**
+ * The URI of the trace buffers' export (see ``obs32/obs32_trace.h``).
+ *
+ * The *URI handler* is only registered, if the tracing is enabled (see
+ * ::OBS32_TRACE_ENABLED ).
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_TRACE_URI "/trace"
+
+/**
+ * The size of the chunks of the trace buffers' export.
+ *
+ * The buffer is located on the stack of the server's task.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_TRACE_CHUNK_LEN 512
+
+/**
+ * Serve the component's assets from a data partition instead of embedding
+ * them into the application.
+ *
+ * The image of the assets is flashed to the partition
+ * ::MIN_HTTPD_ASSETS_PARTITION_LABEL , which must be provided by the
+ * project's partition table, and is memory-mapped at runtime.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MIN_HTTPD_ASSETS_PARTITION
+#define MIN_HTTPD_ASSETS_PARTITION 1
+#else
+#define MIN_HTTPD_ASSETS_PARTITION 0
+#endif
+
+/**
+ * The label of the asset partition (see ::MIN_HTTPD_ASSETS_PARTITION ).
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MIN_HTTPD_ASSETS_PARTITION_LABEL
+#define MIN_HTTPD_ASSETS_PARTITION_LABEL CONFIG_MIN_HTTPD_ASSETS_PARTITION_LABEL
+#else
+#define MIN_HTTPD_ASSETS_PARTITION_LABEL "www"
+#endif
+
+/**
+ * The maximum number of bytes of an asset, that are passed to the socket at
+ * once.
+ *
+ * The content is sent directly from the blob (embedded or mapped), so this
+ * does not require any memory.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_ASSETS_CHUNK_LEN 4096
+
+/**
+ * Accept firmware uploads (see ::MIN_HTTPD_OTA_URI ).
+ *
+ * The project's partition table must provide two OTA partitions and
+ * ::MIN_HTTPD_OTA_TOKEN must be set.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MIN_HTTPD_OTA_ENABLED
+#define MIN_HTTPD_OTA_ENABLED 1
+#else
+#define MIN_HTTPD_OTA_ENABLED 0
+#endif
+
+/**
+ * The shared token, that authorizes firmware uploads.
+ *
+ * The request provides it with ``Authorization: Bearer <token>``; an upload
+ * without the header is answered with ``401 Unauthorized``, an upload with
+ * another token with ``403 Forbidden``. If ::MIN_HTTPD_OTA_ENABLED is set,
+ * the build fails, unless the token has between ::MIN_HTTPD_OTA_TOKEN_MIN_LEN
+ * and ::MIN_HTTPD_OTA_TOKEN_MAX_LEN characters.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_MIN_HTTPD_OTA_TOKEN
+#define MIN_HTTPD_OTA_TOKEN CONFIG_MIN_HTTPD_OTA_TOKEN
+#else
+#define MIN_HTTPD_OTA_TOKEN ""
+#endif
+
+/**
+ * The minimum length of ::MIN_HTTPD_OTA_TOKEN .
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_OTA_TOKEN_MIN_LEN 16
+
+/**
+ * The maximum length of ::MIN_HTTPD_OTA_TOKEN .
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_OTA_TOKEN_MAX_LEN 64
+
+/**
+ * The URI, that accepts the firmware with ``POST``.
+ *
+ * The request provides the SHA-256 digest of the firmware with the header
+ * ``X-Firmware-SHA256`` and ::MIN_HTTPD_OTA_TOKEN with the header
+ * ``Authorization``.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_OTA_URI "/ota"
+
+/**
+ * The size of the buffers, that pass the firmware from the server's task to
+ * the task, that writes it to flash.
+ *
+ * This matches the size of a flash sector, so every write erases at most one
+ * sector.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_OTA_BUFFER_LEN 4096
+
+/**
+ * The number of buffers between the server's task and the task, that writes
+ * the firmware to flash.
+ *
+ * With ``2``, one buffer is received, while the other one is written.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_OTA_BUFFERS 2
+
+/**
+ * The **freeRTOS**-specific priority of the task, that writes the firmware to
+ * flash.
+ *
+ * This equals the priority of the server's task, so neither side of the
+ * upload waits for the other one to be scheduled.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_OTA_WRITER_PRIORITY 5
+
+/**
+ * The stack size of the task, that writes the firmware to flash.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_OTA_WRITER_STACK_SIZE 3072
+
+/**
+ * The number of bytes of the firmware between ``MIN_HTTPD_OTA_PROGRESS``
+ * events.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_OTA_PROGRESS_STEP (64 * 1024)
+
+/**
+ * The time between the response to a successful upload and the restart into
+ * the new firmware, given in milliseconds.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``min_httpd.h``.
+ */
+#define MIN_HTTPD_OTA_RESTART_DELAY 1000
 
 /**
  * Component-specific event base.
@@ -64,9 +636,340 @@ ESP_EVENT_DECLARE_BASE(MIN_HTTPD_EVENTS);
  * MIN_HTTPD_READY - Emitted at the end of server's startup routine to indicate
  *                   to other components that the server is ready to accept
  *                   further *URI handlers*.
+ *
+ * MIN_HTTPD_SESSIONS_CHANGED - Emitted whenever a session (connection) is
+ *                              opened or closed. The event data is an ``int``
+ *                              with the current number of open sessions.
+ *
+ * MIN_HTTPD_OTA_PROGRESS - Emitted while a firmware is uploaded, every
+ *                          ::MIN_HTTPD_OTA_PROGRESS_STEP bytes and when the
+ *                          upload is complete. The event data is a
+ *                          ::min_httpd_ota_progress .
+ */
+enum {
+    MIN_HTTPD_READY,
+    MIN_HTTPD_SESSIONS_CHANGED,
+    MIN_HTTPD_OTA_PROGRESS
+};
+
+/**
+ * The progress of a firmware upload, see ``MIN_HTTPD_OTA_PROGRESS``.
+ */
+struct min_httpd_ota_progress {
+    uint32_t received;  // bytes received and hashed so far
+    uint32_t total;     // the length of the firmware
+    uint32_t rate;      // bytes per second since the upload started
+};
+
+/**
+ * Where the requests of a route are processed.
+ *
+ * MIN_HTTPD_ROUTE_INLINE    - The handler is a regular *URI handler*, that is
+ *                             executed by the server's task. This suits
+ *                             handlers, that respond quickly.
+ *
+ * MIN_HTTPD_ROUTE_OFFLOADED - The handler is executed by a worker task (see
+ *                             ::MIN_HTTPD_WORKERS ), so it does not stall the
+ *                             requests of other clients. This suits handlers,
+ *                             that block (e.g. writing to the NVS).
+ */
+enum min_httpd_route_mode { MIN_HTTPD_ROUTE_INLINE, MIN_HTTPD_ROUTE_OFFLOADED };
+
+/**
+ * A request of an offloaded route, that is processed by a worker task.
+ *
+ * The request is already received completely, so the handler does not access
+ * the server. It responds with ::min_httpd_job_respond .
+ *
+ * The URI and the body are located in the job's arena. The handler allocates
+ * its temporary memory from the arena as well; it is released with the job.
  */
-enum { MIN_HTTPD_READY };
+struct min_httpd_job {
+    httpd_method_t method;
+    const char* uri;
+    char* body;  // ``\0``-terminated, may be modified by the handler
+    size_t body_len;
+    void* user_ctx;
+    struct min_httpd_arena* arena;
+};
 
+/**
+ * The handler of an offloaded route.
+ *
+ * @param job The request.
+ * @return esp_err_t ``ESP_OK`` if the request was processed. Otherwise, and if
+ *                   the handler did not respond, ``500 Internal Server Error``
+ *                   is sent.
+ */
+typedef esp_err_t (*min_httpd_job_handler_t)(struct min_httpd_job* job);
+
+/**
+ * A route, that declares, where its requests are processed.
+ *
+ * Inline routes provide ``handler``, offloaded routes provide
+ * ``job_handler``. ``cost`` is the number of tokens, that a request takes
+ * from its client's bucket (see ::MIN_HTTPD_LIMIT_ENABLED ), e.g.
+ * ::MIN_HTTPD_LIMIT_COST_INLINE ; it must not be ``0``.
+ *
+ * Inline routes with ``websocket`` are WebSocket endpoints: only the
+ * handshake is admitted, the handler is called for the frames of the session
+ * afterwards, without taking tokens.
+ */
+struct min_httpd_route {
+    const char* uri;
+    httpd_method_t method;
+    enum min_httpd_route_mode mode;
+    esp_err_t (*handler)(httpd_req_t* request);
+    min_httpd_job_handler_t job_handler;
+    void* user_ctx;
+    uint8_t cost;
+    bool websocket;
+};
+
+
+/**
+ * Redirect connectivity checks of operating systems to the given URI.
+ *
+ * Phones and laptops request well-known URIs (e.g. ``/generate_204`` or
+ * ``/hotspot-detect.html``) to check the connectivity of a network. With a
+ * DNS responder, that answers every query with the server's address (a
+ * *captive portal*), these requests reach this server and are redirected to
+ * ``uri``, so the operating system presents the page immediately.
+ *
+ * Redirects are sent from the handler of ``404 Not Found`` errors, so they do
+ * not use any of the server's *URI handlers* (see
+ * ::MIN_HTTPD_MAX_URI_HANDLERS ).
+ *
+ * @param uri The URI (a path on this server) to redirect to, ``NULL`` to
+ *            disable the redirects. The string must stay valid.
+ */
+void min_httpd_captive_portal_set_target(const char* uri);
+
+/**
+ * Send a text message to all subscribers of the WebSocket push channel.
+ *
+ * The frame is built once and sent to all subscribers by the server's task,
+ * so the function does not wait for the subscribers. Subscribers, that can
+ * not take the frame at the moment, miss it; subscribers, that only take a
+ * part of it, are closed (and are expected to reconnect).
+ *
+ * Messages are only built while there are subscribers, so it is cheap to
+ * publish periodically (see ::min_httpd_ws_get_subscribers ).
+ *
+ * @param text The message, e.g. a JSON document. It is copied.
+ * @param len  The length of the message.
+ * @return esp_err_t ``ESP_OK`` if the message was queued (or there are no
+ *                   subscribers), ``ESP_ERR_INVALID_SIZE`` if it exceeds
+ *                   ::MIN_HTTPD_WS_MAX_MESSAGE_LEN , ``ESP_ERR_NO_MEM`` if
+ *                   ::MIN_HTTPD_WS_MAX_PENDING broadcasts are pending or
+ *                   memory is exhausted, ``ESP_ERR_INVALID_STATE`` if the
+ *                   server is not running and ``ESP_ERR_NOT_SUPPORTED`` if
+ *                   the channel is disabled (see ::MIN_HTTPD_WS_ENABLED ).
+ */
+esp_err_t min_httpd_ws_broadcast(const char* text, size_t len);
+
+/**
+ * Get the number of subscribers of the WebSocket push channel.
+ *
+ * @return size_t The number of subscribers.
+ */
+size_t min_httpd_ws_get_subscribers(void);
+
+/**
+ * Publish an event with the Server-Sent Events stream.
+ *
+ * The event is queued for all clients by the server's task, so the function
+ * does not wait for the clients. Every client has a bounded queue: an event
+ * replaces a queued event of the same ``name``, that was not sent yet, so
+ * slow clients receive the most recent state instead of every change. If the
+ * queue is full nonetheless, the client's oldest event is dropped.
+ *
+ * The most recent event of every name (up to four names) is retained and sent
+ * to new clients immediately, so it is recommended to publish states (e.g.
+ * ``status``) rather than changes.
+ *
+ * @param name The event's name, less than 16 characters.
+ * @param data The event's data, e.g. a JSON document. It is copied.
+ * @param len  The length of ``data``.
+ * @return esp_err_t ``ESP_OK`` if the event was queued,
+ *                   ``ESP_ERR_INVALID_SIZE`` if ``data`` exceeds
+ *                   ::MIN_HTTPD_SSE_MAX_EVENT_LEN , ``ESP_ERR_NO_MEM`` if
+ *                   ::MIN_HTTPD_SSE_MAX_PENDING events are pending or memory
+ *                   is exhausted, ``ESP_ERR_INVALID_STATE`` if the server is
+ *                   not running and ``ESP_ERR_NOT_SUPPORTED`` if the stream is
+ *                   disabled (see ::MIN_HTTPD_SSE_ENABLED ).
+ */
+esp_err_t min_httpd_sse_publish(const char* name,
+                                const char* data,
+                                size_t len);
+
+/**
+ * Get the number of clients of the Server-Sent Events stream.
+ *
+ * @return size_t The number of clients.
+ */
+size_t min_httpd_sse_get_clients(void);
+
+/**
+ * Respond with a packed asset.
+ *
+ * The assets are packed at build time with ``pack_assets()`` (see
+ * ``tools/cmake/packer.cmake``). The asset is found in constant time and sent
+ * directly from the table's blob in chunks of ::MIN_HTTPD_ASSETS_CHUNK_LEN ,
+ * as ``gzip`` variant, if the client accepts it. If the client has the asset
+ * already (``If-None-Match`` or ``If-Modified-Since``, compared with the time
+ * of packing), the response is ``304 Not Modified``. A single range of the
+ * asset (``Range``, e.g. to resume a download) is sent as
+ * ``206 Partial Content``.
+ *
+ * The assets of this component are served without *URI handlers*, if no
+ * other *URI handler* matches.
+ *
+ * @param request The request.
+ * @param table   The table of the assets.
+ * @param path    The path of the asset, ``NULL`` for the request's URI.
+ * @return esp_err_t ``ESP_ERR_NOT_FOUND`` if there is no such asset (nothing
+ *                   was sent), ``ESP_OK`` if the response was sent and
+ *                   ``ESP_FAIL`` otherwise.
+ */
+esp_err_t min_httpd_assets_send(httpd_req_t* request,
+                                const struct min_httpd_asset_table* table,
+                                const char* path);
+
+/**
+ * Respond with a compiled HTML template.
+ *
+ * The templates are compiled at build time with ``compile_html_template()``
+ * (see ``tools/cmake/minimizer.cmake``). The template is rendered directly
+ * into the response with ``httpd_resp_send_chunk()``: the static segments
+ * are sent from flash, the values (escaped for HTML) from their strings, so
+ * the page is never built in memory. The response is not cached by the
+ * client.
+ *
+ * @param request The request.
+ * @param tpl     The template.
+ * @param values  The values of the template's placeholders. Placeholders
+ *                without value are rendered empty.
+ * @param count   The number of ``values``.
+ * @return esp_err_t ``ESP_OK`` if the response was sent, ``ESP_FAIL``
+ *                   otherwise, causing the session to be closed.
+ */
+esp_err_t min_httpd_template_send(
+    httpd_req_t* request,
+    const struct min_httpd_template* tpl,
+    const struct min_httpd_template_value* values,
+    size_t count);
+
+/**
+ * Start a JSON response with a streaming writer.
+ *
+ * The response's ``Content-Type`` is set to ``application/json``. The
+ * document is written with the functions of min_httpd_json.h and sent with
+ * ::min_httpd_json_send ; full chunks are sent meanwhile, so the document
+ * is never built completely in memory.
+ *
+ * @param json    The writer.
+ * @param request The request.
+ * @param buf     The buffer of the chunks, e.g. ::MIN_HTTPD_JSON_CHUNK_LEN
+ *                bytes on the handler's stack or from the request's arena.
+ * @param size    The size of ``buf``.
+ */
+void min_httpd_json_response(struct min_httpd_json* json,
+                             httpd_req_t* request,
+                             char* buf,
+                             size_t size);
+
+/**
+ * Complete and send a JSON response.
+ *
+ * A document, that fits into a single chunk, is sent with
+ * ``httpd_resp_send()``. If the writer failed before any chunk was sent, the
+ * response is ``500 Internal Server Error``.
+ *
+ * @param json The writer, started with ::min_httpd_json_response .
+ * @return esp_err_t ``ESP_OK`` if the response was sent, ``ESP_FAIL``
+ *                   otherwise, causing the session to be closed.
+ */
+esp_err_t min_httpd_json_send(struct min_httpd_json* json);
+
+/**
+ * Write the heap telemetry as members of the current object.
+ *
+ * The members are ``heap`` (the free heap) and ``heap_min`` (the minimum of
+ * the free heap since the start), given in bytes.
+ *
+ * @param json The writer.
+ */
+void min_httpd_json_heap(struct min_httpd_json* json);
+
+/**
+ * Get the arena of a request of an inline route.
+ *
+ * The arena is reset after the route's handler returned, so the memory must
+ * not be referenced afterwards. Allocations, that exceed
+ * ::MIN_HTTPD_ARENA_LEN , fail.
+ *
+ * @param request The request.
+ * @return struct min_httpd_arena* The arena, ``NULL`` if the request's
+ *                                 handler was not registered with
+ *                                 ::min_httpd_register_route .
+ */
+struct min_httpd_arena* min_httpd_request_arena(httpd_req_t* request);
+
+/**
+ * Register a route with the server.
+ *
+ * Every request is admitted, before it is processed (see
+ * ::MIN_HTTPD_LIMIT_ENABLED and ::MIN_HTTPD_LIMIT_MIN_HEAP ), so all *URI
+ * handlers* must be registered with this function.
+ *
+ * Inline routes are registered as regular *URI handlers*, that are provided
+ * with an arena (see ::min_httpd_request_arena ). The requests of
+ * offloaded routes are received by the server's task (up to
+ * ::MIN_HTTPD_OFFLOAD_MAX_BODY ) and handed to the worker tasks; the server's
+ * task continues with the requests of other clients meanwhile. The response
+ * of a worker is sent by the server's task. If the client closes the session
+ * before, the response is discarded.
+ *
+ * Every route uses one of the server's *URI handlers* (see
+ * ::MIN_HTTPD_MAX_URI_HANDLERS ).
+ *
+ * @param server The server, as provided by ``MIN_HTTPD_READY``.
+ * @param route  The route. It must stay valid, e.g. ``static const``.
+ * @return esp_err_t ``ESP_OK`` on success, ``ESP_ERR_INVALID_ARG`` if the
+ *                   route's handler or cost is missing or an offloaded route
+ *                   is a WebSocket endpoint, ``ESP_ERR_NOT_SUPPORTED`` if
+ *                   the server does not support WebSockets
+ *                   (``CONFIG_HTTPD_WS_SUPPORT``), the error of
+ *                   ``httpd_register_uri_handler()`` otherwise.
+ */
+esp_err_t min_httpd_register_route(httpd_handle_t server,
+                                   const struct min_httpd_route* route);
+
+/**
+ * Respond to a request of an offloaded route.
+ *
+ * The response is sent by the server's task, after the handler returned. It
+ * closes the session (``Connection: close``), as the server's task continued
+ * with the session meanwhile, and a pipelined request must not be answered
+ * before.
+ *
+ * @param job    The request.
+ * @param status The status, e.g. ``204 No Content``, ``NULL`` for ``200 OK``.
+ * @param type   The ``Content-Type``, ``NULL`` for ``text/html``.
+ * @param body   The body of the response. It is copied into the job's arena
+ *               and may be located in the arena itself.
+ * @param len    The length of ``body``, ``HTTPD_RESP_USE_STRLEN`` to use
+ *               ``strlen()``.
+ * @return esp_err_t ``ESP_OK`` on success, ``ESP_ERR_INVALID_STATE`` if the
+ *                   handler did already respond and ``ESP_ERR_NO_MEM`` if
+ *                   the response exceeds the job's arena.
+ */
+esp_err_t min_httpd_job_respond(struct min_httpd_job* job,
+                                const char* status,
+                                const char* type,
+                                const char* body,
+                                ssize_t len);
 
 /**
  * Handle external events that should cause the HTTP server to start.
@@ -0,0 +1,150 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The per-request arena of the ``min_httpd`` component.
+ *
+ * Handlers allocate their temporary memory (e.g. decoded form values or the
+ * body of a response) from an arena instead of the heap. An arena is a fixed
+ * buffer with a *bump pointer*: allocations just advance the pointer and are
+ * never freed individually, the whole arena is reset after the response was
+ * sent. The buffer is the hard budget of a request; allocations beyond it
+ * fail (``NULL``), they never fall back to the heap.
+ *
+ * The arena does not lock and does not depend on **ESP-IDF**, so it builds on
+ * a Linux host (see ``tools/min_httpd/arena``). An arena is only used by one
+ * task at a time (see ::min_httpd_request_arena and ::min_httpd_job ).
+ *
+ * @file   min_httpd_arena.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_MIN_HTTPD_INCLUDE_MIN_HTTPD_MIN_HTTPD_ARENA_H_
+#define SRC_LIB_MIN_HTTPD_INCLUDE_MIN_HTTPD_MIN_HTTPD_ARENA_H_
+
+/* C's standard libraries. */
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * The alignment of allocations, suitable for any type of the ESP32.
+ */
+#define MIN_HTTPD_ARENA_ALIGN 8
+
+/**
+ * An arena.
+ *
+ * The storage is provided by the caller, see ::min_httpd_arena_init .
+ */
+struct min_httpd_arena {
+    uint8_t* base;
+    size_t size;
+    size_t used;
+
+    size_t peak;        // the maximum of ``used`` since the initialization
+    uint32_t failures;  // allocations, that exceeded the budget
+};
+
+
+/**
+ * Initialize an arena.
+ *
+ * @param arena   The arena.
+ * @param storage The storage of the allocations.
+ * @param size    The size of ``storage``, the budget of the arena.
+ */
+void min_httpd_arena_init(struct min_httpd_arena* arena,
+                          void* storage,
+                          size_t size);
+
+/**
+ * Release all allocations of an arena.
+ *
+ * ``peak`` and ``failures`` are kept.
+ *
+ * @param arena The arena.
+ */
+void min_httpd_arena_reset(struct min_httpd_arena* arena);
+
+/**
+ * Get the number of bytes, that are left in an arena.
+ *
+ * @param arena The arena.
+ * @return size_t The number of bytes (ignoring the alignment).
+ */
+size_t min_httpd_arena_available(const struct min_httpd_arena* arena);
+
+/**
+ * Allocate memory from an arena.
+ *
+ * The memory is aligned to ::MIN_HTTPD_ARENA_ALIGN and is not initialized.
+ *
+ * @param arena The arena.
+ * @param len   The number of bytes.
+ * @return void* The memory, ``NULL`` if the budget is exceeded.
+ */
+void* min_httpd_arena_alloc(struct min_httpd_arena* arena, size_t len);
+
+/**
+ * Allocate zeroed memory for ``count`` elements from an arena.
+ *
+ * @param arena The arena.
+ * @param count The number of elements.
+ * @param size  The size of an element.
+ * @return void* The memory, ``NULL`` if the budget is exceeded.
+ */
+void* min_httpd_arena_calloc(struct min_httpd_arena* arena,
+                             size_t count,
+                             size_t size);
+
+/**
+ * Copy a string into an arena.
+ *
+ * @param arena The arena.
+ * @param str   The string.
+ * @param len   The maximum number of characters to copy.
+ * @return char* The ``\0``-terminated copy, ``NULL`` if the budget is
+ *               exceeded.
+ */
+char* min_httpd_arena_strndup(struct min_httpd_arena* arena,
+                              const char* str,
+                              size_t len);
+
+/**
+ * Format a string into an arena, like ``asprintf()``.
+ *
+ * The string is formatted directly into the free space of the arena, so it
+ * is not formatted twice.
+ *
+ * @param arena  The arena.
+ * @param format The format, as of ``printf()``.
+ * @return char* The string, ``NULL`` if the budget is exceeded (nothing is
+ *               allocated then).
+ */
+char* min_httpd_arena_printf(struct min_httpd_arena* arena,
+                             const char* format,
+                             ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * Get the decoded value of a key of a form-encoded body.
+ *
+ * The body is ``application/x-www-form-urlencoded``, e.g.
+ * ``ssid=My+Network&psk=s%26cret``. The key must match a complete key of the
+ * body. ``%XX`` and ``+`` are decoded, malformed escapes are kept.
+ *
+ * @param arena The arena.
+ * @param body  The ``\0``-terminated body.
+ * @param key   The key.
+ * @return char* The decoded value, ``NULL`` if ``key`` was not found or the
+ *               budget is exceeded.
+ */
+char* min_httpd_arena_form_value(struct min_httpd_arena* arena,
+                                 const char* body,
+                                 const char* key);
+
+#endif  // SRC_LIB_MIN_HTTPD_INCLUDE_MIN_HTTPD_MIN_HTTPD_ARENA_H_
@@ -0,0 +1,57 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The tables of packed web assets of the ``min_httpd`` component.
+ *
+ * The tables are generated by ``tools/packer/assets.py`` (see
+ * ``pack_assets()`` in ``tools/cmake/packer.cmake``), so this header must not
+ * depend on **ESP-IDF**.
+ *
+ * @file   min_httpd_assets.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_MIN_HTTPD_INCLUDE_MIN_HTTPD_MIN_HTTPD_ASSETS_H_
+#define SRC_LIB_MIN_HTTPD_INCLUDE_MIN_HTTPD_MIN_HTTPD_ASSETS_H_
+
+/* C's standard libraries. */
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * A packed asset.
+ *
+ * The content is located in the blob of its table.
+ */
+struct min_httpd_asset {
+    const char* path;      // e.g. ``/index.html``
+    const char* type;      // the MIME type
+    uint32_t hash;         // the hash of the content, used as ``ETag``
+    uint32_t offset;       // the offset of the content
+    uint32_t len;          // the length of the content
+    uint32_t gzip_offset;  // the offset of the ``gzip`` variant
+    uint32_t gzip_len;     // ``0`` if there is no ``gzip`` variant
+};
+
+/**
+ * A table of packed assets.
+ *
+ * The assets are ordered by a minimal perfect hash of their paths, see
+ * ``min_httpd_assets_find()``.
+ */
+struct min_httpd_asset_table {
+    const struct min_httpd_asset* assets;
+    const int32_t* displacements;  // one per asset
+    size_t count;
+    const uint8_t* blob;
+    size_t blob_len;
+    uint32_t timestamp;  // the time of packing, used as ``Last-Modified``
+};
+
+#endif  // SRC_LIB_MIN_HTTPD_INCLUDE_MIN_HTTPD_MIN_HTTPD_ASSETS_H_
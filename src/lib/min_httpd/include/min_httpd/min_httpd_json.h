@@ -0,0 +1,185 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The streaming JSON writer of the ``min_httpd`` component.
+ *
+ * The writer serializes a document directly into a fixed buffer (a *chunk*).
+ * Whenever the chunk is full, it is handed to a *flush* function (e.g.
+ * ``httpd_resp_send_chunk()``, see ::min_httpd_json_response ) and reused,
+ * so documents of any length are written without allocations. Without a
+ * flush function, the document must fit into the buffer (e.g. a message of
+ * the WebSocket push channel).
+ *
+ * Commas and the escaping of strings are handled by the writer. Errors (a
+ * full buffer without flush function, a failed flush or unbalanced
+ * containers) are sticky: further output is discarded and
+ * ::min_httpd_json_finish fails.
+ *
+ * The writer does not lock and does not depend on **ESP-IDF**, so it builds
+ * on a Linux host (see ``tools/min_httpd/json``).
+ *
+ * @file   min_httpd_json.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_MIN_HTTPD_INCLUDE_MIN_HTTPD_MIN_HTTPD_JSON_H_
+#define SRC_LIB_MIN_HTTPD_INCLUDE_MIN_HTTPD_MIN_HTTPD_JSON_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * The maximum nesting of objects and arrays.
+ */
+#define MIN_HTTPD_JSON_MAX_DEPTH 32
+
+/**
+ * Hand a full chunk to its destination.
+ *
+ * @param ctx  The context of the writer.
+ * @param data The chunk.
+ * @param len  The length of ``data``.
+ * @return bool ``true`` if the chunk was taken.
+ */
+typedef bool (*min_httpd_json_flush_t)(void* ctx,
+                                       const char* data,
+                                       size_t len);
+
+/**
+ * A writer.
+ *
+ * The buffer is provided by the caller, see ::min_httpd_json_init .
+ */
+struct min_httpd_json {
+    char* buf;
+    size_t size;
+    size_t len;  // the length of the pending output in ``buf``
+    min_httpd_json_flush_t flush;
+    void* ctx;
+
+    size_t flushed;    // the number of bytes, that were flushed
+    uint32_t members;  // a bit per depth, set if a value was written
+    uint8_t depth;
+    bool key;     // set, if a key waits for its value
+    bool failed;  // sticky, see ::min_httpd_json_finish
+};
+
+
+/**
+ * Initialize a writer.
+ *
+ * @param json  The writer.
+ * @param buf   The buffer of the chunks.
+ * @param size  The size of ``buf``.
+ * @param flush The function to hand full chunks to, ``NULL`` if the document
+ *              must fit into ``buf``.
+ * @param ctx   The context of ``flush``.
+ */
+void min_httpd_json_init(struct min_httpd_json* json,
+                         char* buf,
+                         size_t size,
+                         min_httpd_json_flush_t flush,
+                         void* ctx);
+
+/**
+ * Complete a document.
+ *
+ * The pending output is flushed (if there is a flush function), so the
+ * document is complete. Without flush function, the document is located in
+ * the writer's buffer (``len`` bytes, not ``\0``-terminated).
+ *
+ * @param json The writer.
+ * @return bool ``true`` if the document was written completely and its
+ *              containers are closed.
+ */
+bool min_httpd_json_finish(struct min_httpd_json* json);
+
+/**
+ * Begin an object.
+ *
+ * @param json The writer.
+ */
+void min_httpd_json_object_begin(struct min_httpd_json* json);
+
+/**
+ * End the current object.
+ *
+ * @param json The writer.
+ */
+void min_httpd_json_object_end(struct min_httpd_json* json);
+
+/**
+ * Begin an array.
+ *
+ * @param json The writer.
+ */
+void min_httpd_json_array_begin(struct min_httpd_json* json);
+
+/**
+ * End the current array.
+ *
+ * @param json The writer.
+ */
+void min_httpd_json_array_end(struct min_httpd_json* json);
+
+/**
+ * Write the key of an object's member.
+ *
+ * The member's value is written next.
+ *
+ * @param json The writer.
+ * @param key  The key. It is escaped.
+ */
+void min_httpd_json_key(struct min_httpd_json* json, const char* key);
+
+/**
+ * Write a string.
+ *
+ * Quotes, backslashes and control characters are escaped, other characters
+ * (e.g. UTF-8) are written unmodified.
+ *
+ * @param json  The writer.
+ * @param value The string, ``NULL`` for ``null``.
+ */
+void min_httpd_json_string(struct min_httpd_json* json, const char* value);
+
+/**
+ * Write a signed integer.
+ *
+ * @param json  The writer.
+ * @param value The integer.
+ */
+void min_httpd_json_int(struct min_httpd_json* json, int64_t value);
+
+/**
+ * Write an unsigned integer.
+ *
+ * @param json  The writer.
+ * @param value The integer.
+ */
+void min_httpd_json_uint(struct min_httpd_json* json, uint64_t value);
+
+/**
+ * Write ``true`` or ``false``.
+ *
+ * @param json  The writer.
+ * @param value The value.
+ */
+void min_httpd_json_bool(struct min_httpd_json* json, bool value);
+
+/**
+ * Write ``null``.
+ *
+ * @param json The writer.
+ */
+void min_httpd_json_null(struct min_httpd_json* json);
+
+#endif  // SRC_LIB_MIN_HTTPD_INCLUDE_MIN_HTTPD_MIN_HTTPD_JSON_H_
@@ -0,0 +1,92 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The compiled HTML templates of the ``min_httpd`` component.
+ *
+ * The templates are compiled at build time by ``tools/minimizer/html.py``
+ * (see ``compile_html_template()`` in ``tools/cmake/minimizer.cmake``) into
+ * tables of *segments*: a static text, that is followed by a placeholder.
+ * The static text is sent directly from flash, only the values of the
+ * placeholders are provided at runtime, so pages are not assembled in
+ * memory.
+ *
+ * The tables are generated, so this header must not depend on **ESP-IDF**.
+ *
+ * @file   min_httpd_template.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_MIN_HTTPD_INCLUDE_MIN_HTTPD_MIN_HTTPD_TEMPLATE_H_
+#define SRC_LIB_MIN_HTTPD_INCLUDE_MIN_HTTPD_MIN_HTTPD_TEMPLATE_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/**
+ * A segment of a template.
+ */
+struct min_httpd_template_segment {
+    const char* text;  // the static text, not ``\0``-terminated
+    size_t len;        // the length of ``text``
+    const char* name;  // the following placeholder, ``NULL`` for none
+};
+
+/**
+ * A compiled template.
+ */
+struct min_httpd_template {
+    const struct min_httpd_template_segment* segments;
+    size_t count;
+    size_t len;  // the length of the static text
+};
+
+/**
+ * The value of a placeholder.
+ */
+struct min_httpd_template_value {
+    const char* name;
+    const char* value;  // ``NULL`` is rendered empty
+};
+
+/**
+ * Hand a part of a rendered template to its destination.
+ *
+ * @param ctx  The context of the rendering.
+ * @param data The part.
+ * @param len  The length of ``data``.
+ * @return bool ``true`` if the part was taken.
+ */
+typedef bool (*min_httpd_template_emit_t)(void* ctx,
+                                          const char* data,
+                                          size_t len);
+
+/**
+ * Render a template.
+ *
+ * The static text is emitted as is, without copying it. The values are
+ * escaped for HTML (``&``, ``<``, ``>``, ``"`` and ``'``); runs of
+ * characters, that do not need escaping, are emitted directly from the
+ * value. Placeholders without value are rendered empty.
+ *
+ * @param tpl    The template.
+ * @param values The values of the placeholders.
+ * @param count  The number of ``values``.
+ * @param emit   The function to hand the parts to.
+ * @param ctx    The context of ``emit``.
+ * @return bool ``true`` if all parts were taken, ``false`` if ``emit``
+ *              failed (the rendering is stopped).
+ */
+bool min_httpd_template_render(const struct min_httpd_template* tpl,
+                               const struct min_httpd_template_value* values,
+                               size_t count,
+                               min_httpd_template_emit_t emit,
+                               void* ctx);
+
+#endif  // SRC_LIB_MIN_HTTPD_INCLUDE_MIN_HTTPD_MIN_HTTPD_TEMPLATE_H_
@@ -21,9 +21,20 @@
 /* This file's header */
 #include "min_httpd/min_httpd.h"
 
+/* Other headers of the component. */
+#include "min_httpd_internal.h"     // modules of the component
+#include "min_httpd_miss_engine.h"  // responses to missing resources
+
 /* C-standard for string operations */
 #include <string.h>
 
+/* POSIX API, used to close the sockets of sessions. */
+#include <unistd.h>
+
+/* The BSD socket API, used to determine the server's address. */
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
 /* This is ESP-IDF's error handling library.
  * - defines the type ``esp_err_t``
  * - defines the macro ``ESP_ERROR_CHECK``
@@ -51,6 +62,31 @@
  */
 #include "esp_log.h"
 
+/* FreeRTOS headers.
+ * - the ``FreeRTOS.h`` is required
+ * - ``semphr.h`` provides the mutex, that guards ::min_httpd_work_server
+ */
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The maximum length of the ``Location`` of the captive portal's redirect.
+ */
+#define MIN_HTTPD_CAPTIVE_LOCATION_LEN 96
+
+/**
+ * The maximum length of the server's address in the captive portal's
+ * redirect, an IPv6 address is enclosed in brackets.
+ */
+#if CONFIG_LWIP_IPV6
+#define MIN_HTTPD_CAPTIVE_ADDRESS_LEN (INET6_ADDRSTRLEN + 2)
+#else
+#define MIN_HTTPD_CAPTIVE_ADDRESS_LEN INET_ADDRSTRLEN
+#endif
+
+
 /* ***** VARIABLES ********************************************************* */
 /**
  * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
@@ -69,38 +105,88 @@ static const char* TAG = "krachkiste.httpd";
  */
 static httpd_handle_t min_httpd_server = NULL;
 
+/**
+ * The number of open sessions.
+ *
+ * This is only modified by the server's task (see ::min_httpd_session_open
+ * and ::min_httpd_session_close ) and while the server is not running.
+ */
+static int min_httpd_sessions = 0;
+
+/**
+ * The server, that functions of other tasks are queued with, ``NULL`` while
+ * the server is not running.
+ *
+ * See ::min_httpd_queue_work .
+ */
+static httpd_handle_t min_httpd_work_server = NULL;
 
-/* ***** PROTOTYPES ******************************************************** */
-static esp_err_t min_httpd_server_start(void);
-static esp_err_t min_httpd_server_stop(void);
-static esp_err_t min_httpd_handler_404(httpd_req_t* request,
-                                       httpd_err_code_t error_code);
-static esp_err_t min_httpd_handler_favicon(httpd_req_t* request);
-static esp_err_t min_httpd_handler_home(httpd_req_t* request);
+/**
+ * Guard ::min_httpd_work_server , so the server is not stopped while a
+ * function is queued.
+ *
+ * ``httpd_queue_work()`` may block, so a ``portMUX`` is no option here.
+ */
+static SemaphoreHandle_t min_httpd_work_mutex = NULL;
 
+/**
+ * The URI to redirect connectivity checks to, ``NULL`` to disable.
+ *
+ * See ::min_httpd_captive_portal_set_target .
+ */
+static const char* min_httpd_captive_target = NULL;
 
-/* ***** URI DEFINITIONS ***************************************************
- * (technically, these are ``variables``, but as the handler functions must be
- *  referenced, these must come after the ``prototypes``)
+/**
+ * The negative cache of the paths of missing resources.
+ *
+ * This is only used by the server's task (see ::min_httpd_handler_404 ) and
+ * while the server is not running.
  */
+static struct min_httpd_miss_cache min_httpd_miss;
 
 /**
- * URI definition for the *homepage*, which will be served from ``/``.
+ * The storage of ::min_httpd_miss .
  */
-static const httpd_uri_t min_httpd_uri_home = {
-    .uri = "/",
-    .method = HTTP_GET,
-    .handler = min_httpd_handler_home,
-    .user_ctx = NULL};
+static struct min_httpd_miss_entry
+    min_httpd_miss_learned[MIN_HTTPD_MISS_CACHE_SIZE];
 
 /**
- * URI definition for the *favicon*, which will be served from ``/favicon.ico``.
+ * The URIs, that are requested by operating systems to check the
+ * connectivity of a network.
+ *
+ * These are the paths only, as the DNS responder of the captive portal
+ * directs any host to the server.
  */
-static const httpd_uri_t min_httpd_uri_favicon = {
-    .uri = "/favicon.ico",
-    .method = HTTP_GET,
-    .handler = min_httpd_handler_favicon,
-    .user_ctx = NULL};
+static const char* const min_httpd_captive_uris[] = {
+    "/generate_204",               // Android, Chrome OS
+    "/gen_204",                    // Android
+    "/hotspot-detect.html",        // Apple
+    "/library/test/success.html",  // Apple (legacy)
+    "/connecttest.txt",            // Windows
+    "/ncsi.txt",                   // Windows (legacy)
+    "/redirect",                   // Windows
+    "/canonical.html",             // Firefox
+    "/success.txt",                // Firefox
+};
+
+
+/* ***** PROTOTYPES ******************************************************** */
+static esp_err_t min_httpd_server_start(void);
+static esp_err_t min_httpd_server_stop(void);
+static bool min_httpd_captive_portal_address(int sockfd,
+                                             char* address,
+                                             size_t len);
+static bool min_httpd_captive_portal_redirect(httpd_req_t* request);
+static bool min_httpd_captive_portal_uri(const char* uri);
+static esp_err_t min_httpd_fallback(httpd_req_t* request);
+static esp_err_t min_httpd_handler_404(httpd_req_t* request,
+                                       httpd_err_code_t error_code);
+static esp_err_t min_httpd_miss_send(httpd_req_t* request);
+static bool min_httpd_served(const char* uri);
+static void min_httpd_session_close(httpd_handle_t server, int sockfd);
+static esp_err_t min_httpd_session_open(httpd_handle_t server, int sockfd);
+static void min_httpd_sessions_publish(TickType_t timeout);
+static void min_httpd_work_server_set(httpd_handle_t server);
 
 
 /* ***** FUNCTIONS ********************************************************* */
@@ -137,96 +223,319 @@ void min_httpd_external_event_handler_stop(void* arg,
     }
 }
 
+// Documentation in header file!
+void min_httpd_captive_portal_set_target(const char* uri) {
+    min_httpd_captive_target = uri;
+}
+
+/**
+ * Format the local address of a session as the host of an URI.
+ *
+ * With ``CONFIG_LWIP_IPV6``, ``esp_http_server`` listens on an IPv6 socket,
+ * so IPv4 clients are connected with an IPv4-mapped address
+ * (``::ffff:a.b.c.d``), which is formatted as the plain IPv4 address. Other
+ * IPv6 addresses are enclosed in brackets.
+ *
+ * @param sockfd  The session's socket.
+ * @param address The buffer of the host.
+ * @param len     The length of ``address``, see
+ *                ::MIN_HTTPD_CAPTIVE_ADDRESS_LEN .
+ * @return bool ``true`` if the address was formatted, ``false`` otherwise.
+ */
+static bool min_httpd_captive_portal_address(int sockfd,
+                                             char* address,
+                                             size_t len) {
+    struct sockaddr_storage local;
+    socklen_t local_len = sizeof(local);
+
+    if (getsockname(sockfd, (struct sockaddr*)&local, &local_len) != 0)
+        return false;
+
+    if (local.ss_family == AF_INET) {
+        const struct sockaddr_in* in = (const struct sockaddr_in*)&local;
+        return inet_ntop(AF_INET, &in->sin_addr, address, len) != NULL;
+    }
+#if CONFIG_LWIP_IPV6
+    if (local.ss_family == AF_INET6) {
+        const struct sockaddr_in6* in6 = (const struct sockaddr_in6*)&local;
+        const uint8_t* bytes = (const uint8_t*)&in6->sin6_addr;
+        static const uint8_t mapped[12] =
+            {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+
+        if (memcmp(bytes, mapped, sizeof(mapped)) == 0)
+            return inet_ntop(AF_INET, bytes + 12, address, len) != NULL;
+
+        if ((len < 2) ||
+            (inet_ntop(AF_INET6, &in6->sin6_addr, address + 1, len - 2) ==
+             NULL))
+            return false;
+        address[0] = '[';
+        strcat(address, "]");
+        return true;
+    }
+#endif
+    return false;
+}
+
+/**
+ * Redirect a connectivity check to the captive portal's target.
+ *
+ * The redirect uses the address of the server (as seen by the client), as
+ * the ``Host`` of the request is the operating system's check server.
+ *
+ * @param request The request, which could not be matched to a *URI handler*.
+ * @return bool ``true`` if the request was answered with a redirect,
+ *              ``false`` if it is not a connectivity check.
+ */
+static bool min_httpd_captive_portal_redirect(httpd_req_t* request) {
+    if (min_httpd_captive_target == NULL)
+        return false;
+
+    if (!min_httpd_captive_portal_uri(request->uri))
+        return false;
+
+    char address[MIN_HTTPD_CAPTIVE_ADDRESS_LEN];
+    if (!min_httpd_captive_portal_address(httpd_req_to_sockfd(request),
+                                          address,
+                                          sizeof(address)))
+        return false;
+
+    char location[MIN_HTTPD_CAPTIVE_LOCATION_LEN];
+    snprintf(location,
+             sizeof(location),
+             "http://%s%s",
+             address,
+             min_httpd_captive_target);
+
+    ESP_LOGD(TAG, "Redirecting '%s' to '%s'", request->uri, location);
+
+    httpd_resp_set_status(request, "302 Found");
+    httpd_resp_set_hdr(request, "Location", location);
+    httpd_resp_set_hdr(request, "Cache-Control", "no-store");
+    httpd_resp_send(request, NULL, 0);
+    return true;
+}
+
+/**
+ * Check, if a request is a connectivity check of an operating system.
+ *
+ * @param uri The URI of the request, the query is ignored.
+ * @return bool ``true`` if the path is one of ::min_httpd_captive_uris .
+ */
+static bool min_httpd_captive_portal_uri(const char* uri) {
+    size_t path_len = strcspn(uri, "?");
+
+    for (size_t i = 0; i < sizeof(min_httpd_captive_uris) / sizeof(char*);
+         i++) {
+        if ((strlen(min_httpd_captive_uris[i]) == path_len) &&
+            (strncmp(uri, min_httpd_captive_uris[i], path_len) == 0))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Check, if a path is served by a fallback.
+ *
+ * This is the ::min_httpd_miss_served_t of ::min_httpd_miss , so packed
+ * assets and connectivity checks are never answered from the negative cache.
+ * The connectivity checks are included, even if the captive portal is
+ * disabled, as it may be enabled while the server is running.
+ *
+ * @param uri The URI of a request, the query is ignored.
+ * @return bool ``true`` if the path is served.
+ */
+static bool min_httpd_served(const char* uri) {
+    return min_httpd_assets_exists(uri) || min_httpd_captive_portal_uri(uri);
+}
+
+/**
+ * Send the precomputed ``404 Not Found`` of min_httpd_miss_engine.h .
+ *
+ * @param request The request.
+ * @return ``ESP_OK`` if the response was sent, keeping the session open;
+ *         ``ESP_FAIL`` otherwise, causing the underlying socket to be closed.
+ */
+static esp_err_t min_httpd_miss_send(httpd_req_t* request) {
+    if (httpd_send(request,
+                   min_httpd_miss_response,
+                   min_httpd_miss_response_len) !=
+        (int)min_httpd_miss_response_len)
+        return ESP_FAIL;
+    return ESP_OK;
+}
+
+/**
+ * Send the response of a request, that could not be matched to a *URI
+ * handler*.
+ *
+ * The request must be admitted (see ::min_httpd_offload_admit ). Known missing
+ * resources are looked up first in the negative cache (see ::min_httpd_miss )
+ * and answered right away. Then the component's packed assets are served (see
+ * ::min_httpd_assets_fallback ), and connectivity checks of operating systems
+ * are redirected to the captive portal's target (see
+ * ::min_httpd_captive_portal_redirect ). All other requests are answered
+ * with the precomputed ``404 Not Found`` (see ::min_httpd_miss_send ),
+ * keeping the session alive, and their paths are learned, so only the first
+ * request of a path is logged.
+ *
+ * @param request    The request that causes the execution of the function.
+ * @return           ``ESP_OK`` if the response was sent, keeping the session
+ *                   open; ``ESP_FAIL`` otherwise, causing the underlying
+ *                   socket to be closed.
+ */
+static esp_err_t min_httpd_fallback(httpd_req_t* request) {
+    esp_err_t return_value;
+    if (!min_httpd_offload_admit(request,
+                                 MIN_HTTPD_LIMIT_COST_INLINE,
+                                 &return_value))
+        return return_value;
+
+    if (min_httpd_miss_cache_lookup(&min_httpd_miss, request->uri)) {
+        obs32_metrics_inc(&min_httpd_metrics_misses);
+        ESP_LOGD(TAG, "'%s' - 404 (cached)", request->uri);
+        return min_httpd_miss_send(request);
+    }
+
+    return_value = min_httpd_assets_fallback(request);
+    if (return_value != ESP_ERR_NOT_FOUND) {
+        obs32_metrics_inc(&min_httpd_metrics_assets);
+        return return_value;
+    }
+
+    if (min_httpd_captive_portal_redirect(request)) {
+        obs32_metrics_inc(&min_httpd_metrics_captive);
+        return ESP_OK;
+    }
+
+    obs32_metrics_inc(&min_httpd_metrics_misses);
+    min_httpd_miss_cache_learn(&min_httpd_miss, request->uri);
+    ESP_LOGI(TAG,
+             "%s '%s' - 404",
+             http_method_str(request->method),
+             request->uri);
+    return min_httpd_miss_send(request);
+}
+
 /**
- * Provide helpful error message for missing/unavailable resources.
+ * Respond to requests, that could not be matched to a *URI handler*.
+ *
+ * The response is sent by ::min_httpd_fallback , which is traced as
+ * ``fallback``.
  *
  * @param request    The request that causes the execution of the function.
  * @param error_code The error code that causes the execution of the function.
  *                   As this function is only attached to ``404 Not Found``
  *                   errors, this is pretty much set.
- * @return           Always returns ``ESP_FAIL``, causing the underlying socket
- *                   to be closed.
+ * @return           ``ESP_OK`` if the response was sent, keeping the session
+ *                   open; ``ESP_FAIL`` otherwise, causing the underlying
+ *                   socket to be closed.
  */
 static esp_err_t min_httpd_handler_404(httpd_req_t* request,
                                        httpd_err_code_t error_code) {
-    char* error_message;
-    asprintf(&error_message, "Sorry, '%s' could not be found!", request->uri);
-    httpd_resp_send_err(request, HTTPD_404_NOT_FOUND, error_message);
-    free(error_message);
-    return ESP_FAIL;
+    uint16_t sockfd = (uint16_t)httpd_req_to_sockfd(request);
+
+    obs32_trace_begin(&min_httpd_trace_group,
+                      MIN_HTTPD_TRACE_POINT_FALLBACK,
+                      sockfd);
+    esp_err_t ret = min_httpd_fallback(request);
+    obs32_trace_end(&min_httpd_trace_group,
+                    MIN_HTTPD_TRACE_POINT_FALLBACK,
+                    sockfd);
+    return ret;
 }
 
 /**
- * The handler for the favicon.
+ * Publish the number of open sessions with ``MIN_HTTPD_SESSIONS_CHANGED``
+ * and as metric.
  *
- * The matching *URI definition* is ::min_httpd_uri_favicon.
+ * @param timeout The maximum time to wait for the event loop.
+ */
+static void min_httpd_sessions_publish(TickType_t timeout) {
+    obs32_metrics_set(&min_httpd_metrics_sessions, min_httpd_sessions);
+    if (esp_event_post(MIN_HTTPD_EVENTS,
+                       MIN_HTTPD_SESSIONS_CHANGED,
+                       &min_httpd_sessions,
+                       sizeof(min_httpd_sessions),
+                       timeout) != ESP_OK) {
+        ESP_LOGW(TAG, "Could not publish number of sessions!");
+    }
+}
+
+/**
+ * Count a newly opened session.
+ *
+ * This is the server's ``open_fn``.
  *
- * @param request The request that should be responded to with this function.
- * @return Always returns ``ESP_OK``.
+ * @param server The server's handle.
+ * @param sockfd The session's socket.
+ * @return Always returns ``ESP_OK``, accepting the session.
  */
-static esp_err_t min_httpd_handler_favicon(httpd_req_t* request) {
-    // Access the embedded HTML file.
-    // See this component's ``CMakeLists.txt`` for the actual embedding (in
-    // ``idf_component_register()``) and see **ESP-IDF**'s documentation on how
-    // to access it: https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-guides/build-system.html#embedding-binary-data
-    extern const uint8_t favicon_ico_start[] asm("_binary_favicon_ico_start");
-    extern const uint8_t favicon_ico_end[] asm("_binary_favicon_ico_end");
-    const size_t favicon_ico_size =
-        favicon_ico_end -  // cppcheck-suppress comparePointers
-        favicon_ico_start;
-
-    esp_err_t return_value = httpd_resp_send(request,
-                                             (const char*)favicon_ico_start,
-                                             favicon_ico_size);
-    min_httpd_log_message(request, return_value);
-
-    return return_value;
+static esp_err_t min_httpd_session_open(httpd_handle_t server, int sockfd) {
+    min_httpd_sessions++;
+    min_httpd_sessions_publish(pdMS_TO_TICKS(MIN_HTTPD_SESSION_EVENT_TIMEOUT));
+    return ESP_OK;
 }
 
 /**
- * The handler for the homepage.
+ * Close a session's socket and count the closed session.
+ *
+ * This is the server's ``close_fn``, so it has to close the socket.
  *
- * The matching *URI definition* is ::min_httpd_uri_home.
+ * @param server The server's handle.
+ * @param sockfd The session's socket.
+ */
+static void min_httpd_session_close(httpd_handle_t server, int sockfd) {
+    min_httpd_ws_session_closed(sockfd);
+    min_httpd_sse_session_closed(sockfd);
+    min_httpd_offload_session_closed(sockfd);
+    close(sockfd);
+
+    if (min_httpd_sessions > 0)
+        min_httpd_sessions--;
+    min_httpd_sessions_publish(pdMS_TO_TICKS(MIN_HTTPD_SESSION_EVENT_TIMEOUT));
+}
+
+/**
+ * Set the server, that functions are queued with.
  *
- * @param request The request that should be responded to with this function.
- * @return Always returns ``ESP_OK``.
+ * @param server The server's handle, ``NULL`` to reject functions.
  */
-static esp_err_t min_httpd_handler_home(httpd_req_t* request) {
-    // Access the embedded HTML file.
-    // See this component's ``CMakeLists.txt`` for the actual embedding (in
-    // ``idf_component_register()``) and see **ESP-IDF**'s documentation on how
-    // to access it: https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-guides/build-system.html#embedding-binary-data
-    extern const uint8_t home_html_start[] asm("_binary_home_html_start");
-    extern const uint8_t home_html_end[] asm("_binary_home_html_end");
-    const size_t home_html_length =
-        home_html_end - home_html_start;  // cppcheck-suppress comparePointers
-
-    esp_err_t return_value = httpd_resp_send(request,
-                                             (const char*)home_html_start,
-                                             home_html_length);
-    min_httpd_log_message(request, return_value);
-
-    return return_value;
+static void min_httpd_work_server_set(httpd_handle_t server) {
+    if (min_httpd_work_mutex == NULL) {
+        min_httpd_work_mutex = xSemaphoreCreateMutex();
+        if (min_httpd_work_mutex == NULL) {
+            ESP_LOGE(TAG, "Could not create mutex!");
+            return;
+        }
+    }
+
+    xSemaphoreTake(min_httpd_work_mutex, portMAX_DELAY);
+    min_httpd_work_server = server;
+    xSemaphoreGive(min_httpd_work_mutex);
 }
 
 // Documentation in header file!
-void min_httpd_log_message(httpd_req_t* request, esp_err_t success) {
-    char* log_message;
+esp_err_t min_httpd_queue_work(httpd_work_fn_t work, void* arg) {
+    if (min_httpd_work_mutex == NULL)
+        return ESP_ERR_INVALID_STATE;
 
-    if (success == ESP_OK) {
-        asprintf(&log_message,
-                 "%s '%s' - OK",
-                 http_method_str(request->method),
-                 request->uri);
-    } else {
-        asprintf(&log_message,
-                 "%s '%s' - FAIL",
-                 http_method_str(request->method),
-                 request->uri);
-    }
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(min_httpd_work_mutex, portMAX_DELAY);
+    if (min_httpd_work_server != NULL)
+        ret = httpd_queue_work(min_httpd_work_server, work, arg);
+    xSemaphoreGive(min_httpd_work_mutex);
 
-    ESP_LOGI(TAG, "%s", log_message);
-    free(log_message);
+    return ret;
+}
+
+// Documentation in header file!
+void min_httpd_log_message(httpd_req_t* request, esp_err_t success) {
+    ESP_LOGI(TAG,
+             "%s '%s' - %s",
+             http_method_str(request->method),
+             request->uri,
+             (success == ESP_OK) ? "OK" : "FAIL");
 }
 
 /**
@@ -248,11 +557,23 @@ static esp_err_t min_httpd_server_start(void) {
     config.lru_purge_enable = true;  // from ESP-IDF's example code
     config.server_port = MIN_HTTPD_HTTP_PORT;
     config.max_uri_handlers = MIN_HTTPD_MAX_URI_HANDLERS;
+    config.open_fn = min_httpd_session_open;
+    config.close_fn = min_httpd_session_close;
+    min_httpd_sessions = 0;
 
     ESP_LOGD(TAG, "task_priority: %d", config.task_priority);        // 5
     ESP_LOGD(TAG, "server_port: %d", config.server_port);            // 80
     ESP_LOGD(TAG, "max_open_sockets: %d", config.max_open_sockets);  // 7
-    ESP_LOGD(TAG, "max_uri_handlers: %d", config.max_uri_handlers);  // 8
+    ESP_LOGD(TAG, "max_uri_handlers: %d", config.max_uri_handlers);  // 12
+
+    // Forget the missing resources and the clients of the previous run; the
+    // assets must be mounted first, as they are never cached as missing
+    min_httpd_assets_mount();
+    min_httpd_miss_cache_init(&min_httpd_miss,
+                              min_httpd_miss_learned,
+                              MIN_HTTPD_MISS_CACHE_SIZE,
+                              min_httpd_served);
+    min_httpd_limit_reset();
 
     // Start the server
     if (httpd_start(&min_httpd_server, &config) == ESP_OK) {
@@ -264,8 +585,16 @@ static esp_err_t min_httpd_server_start(void) {
         httpd_register_err_handler(min_httpd_server,
                                    HTTPD_404_NOT_FOUND,
                                    min_httpd_handler_404);
-        httpd_register_uri_handler(min_httpd_server, &min_httpd_uri_home);
-        httpd_register_uri_handler(min_httpd_server, &min_httpd_uri_favicon);
+        min_httpd_ws_attach(min_httpd_server);
+        min_httpd_sse_attach(min_httpd_server);
+        min_httpd_offload_attach(min_httpd_server);
+        min_httpd_ota_attach(min_httpd_server);
+        min_httpd_template_attach(min_httpd_server);
+        min_httpd_metrics_attach(min_httpd_server);
+        min_httpd_trace_attach(min_httpd_server);
+        min_httpd_work_server_set(min_httpd_server);
+        min_httpd_sessions_publish(
+            pdMS_TO_TICKS(MIN_HTTPD_SESSION_EVENT_TIMEOUT));
 
         // Emit an event
         ESP_ERROR_CHECK_WITHOUT_ABORT(esp_event_post(MIN_HTTPD_EVENTS,
@@ -295,13 +624,27 @@ static esp_err_t min_httpd_server_start(void) {
 static esp_err_t min_httpd_server_stop(void) {
     ESP_LOGV(TAG, "Entering min_httpd_server_stop()");
 
-    // Nothing fancy, just stop the server
+    // Functions, that are already queued, run before the server stops
+    min_httpd_work_server_set(NULL);
     if (httpd_stop(min_httpd_server) == ESP_OK) {
         ESP_LOGI(TAG, "Server successfully stopped!");
         min_httpd_server = NULL;
+        min_httpd_ws_detach();
+        min_httpd_sse_detach();
+        min_httpd_offload_detach();
+
+        // All sessions are gone with the server. The server is stopped from
+        // a handler of the default event loop, so waiting for the loop's
+        // queue would block forever. If the event is dropped, the number is
+        // published again, when the server is started.
+        if (min_httpd_sessions > 0) {
+            min_httpd_sessions = 0;
+            min_httpd_sessions_publish(0);
+        }
         return ESP_OK;
     }
 
     ESP_LOGE(TAG, "Failed to stop the server!");
+    min_httpd_work_server_set(min_httpd_server);
     return ESP_FAIL;
 }
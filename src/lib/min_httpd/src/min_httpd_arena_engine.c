@@ -0,0 +1,208 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's per-request arena.
+ *
+ * The functions are documented in min_httpd_arena.h , as the arena is part
+ * of the component's public interface.
+ *
+ * @file   min_httpd_arena_engine.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* The public header of the arena. */
+#include "min_httpd/min_httpd_arena.h"
+
+/* C's standard libraries. */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static size_t min_httpd_arena_padding(const struct min_httpd_arena* arena);
+static int min_httpd_arena_hex(char c);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get the number of bytes, that align the next allocation.
+ *
+ * The storage is aligned by its address, as the caller's storage might not
+ * be aligned itself.
+ *
+ * @param arena The arena.
+ * @return size_t The number of bytes.
+ */
+static size_t min_httpd_arena_padding(const struct min_httpd_arena* arena) {
+    uintptr_t next = (uintptr_t)(arena->base + arena->used);
+    return (MIN_HTTPD_ARENA_ALIGN - (next % MIN_HTTPD_ARENA_ALIGN)) %
+           MIN_HTTPD_ARENA_ALIGN;
+}
+
+/**
+ * Get the value of a hexadecimal digit.
+ *
+ * @param c The digit.
+ * @return int The value, ``-1`` if ``c`` is no hexadecimal digit.
+ */
+static int min_httpd_arena_hex(char c) {
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    if ((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+    if ((c >= 'A') && (c <= 'F'))
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Documentation in header file!
+void min_httpd_arena_init(struct min_httpd_arena* arena,
+                          void* storage,
+                          size_t size) {
+    arena->base = storage;
+    arena->size = size;
+    arena->used = 0;
+    arena->peak = 0;
+    arena->failures = 0;
+}
+
+// Documentation in header file!
+void min_httpd_arena_reset(struct min_httpd_arena* arena) {
+    arena->used = 0;
+}
+
+// Documentation in header file!
+size_t min_httpd_arena_available(const struct min_httpd_arena* arena) {
+    return arena->size - arena->used;
+}
+
+// Documentation in header file!
+void* min_httpd_arena_alloc(struct min_httpd_arena* arena, size_t len) {
+    size_t padding = min_httpd_arena_padding(arena);
+
+    if ((padding > arena->size - arena->used) ||
+        (len > arena->size - arena->used - padding)) {
+        arena->failures++;
+        return NULL;
+    }
+
+    void* ptr = arena->base + arena->used + padding;
+    arena->used += padding + len;
+    if (arena->used > arena->peak)
+        arena->peak = arena->used;
+    return ptr;
+}
+
+// Documentation in header file!
+void* min_httpd_arena_calloc(struct min_httpd_arena* arena,
+                             size_t count,
+                             size_t size) {
+    if ((size != 0) && (count > SIZE_MAX / size)) {
+        arena->failures++;
+        return NULL;
+    }
+
+    void* ptr = min_httpd_arena_alloc(arena, count * size);
+    if (ptr != NULL)
+        memset(ptr, 0, count * size);
+    return ptr;
+}
+
+// Documentation in header file!
+char* min_httpd_arena_strndup(struct min_httpd_arena* arena,
+                              const char* str,
+                              size_t len) {
+    len = strnlen(str, len);
+
+    // Strings are not aligned
+    if (len >= arena->size - arena->used) {
+        arena->failures++;
+        return NULL;
+    }
+
+    char* copy = (char*)arena->base + arena->used;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    arena->used += len + 1;
+    if (arena->used > arena->peak)
+        arena->peak = arena->used;
+    return copy;
+}
+
+// Documentation in header file!
+char* min_httpd_arena_printf(struct min_httpd_arena* arena,
+                             const char* format,
+                             ...) {
+    char* str = (char*)arena->base + arena->used;
+    size_t available = arena->size - arena->used;
+
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(str, available, format, args);
+    va_end(args);
+
+    if ((len < 0) || ((size_t)len >= available)) {
+        arena->failures++;
+        return NULL;
+    }
+
+    arena->used += len + 1;
+    if (arena->used > arena->peak)
+        arena->peak = arena->used;
+    return str;
+}
+
+// Documentation in header file!
+char* min_httpd_arena_form_value(struct min_httpd_arena* arena,
+                                 const char* body,
+                                 const char* key) {
+    size_t key_len = strlen(key);
+
+    /* Find the pair, whose key matches completely */
+    const char* pair = body;
+    while ((strncmp(pair, key, key_len) != 0) || (pair[key_len] != '=')) {
+        pair = strchr(pair, '&');
+        if (pair == NULL)
+            return NULL;
+        pair++;
+    }
+
+    const char* value = pair + key_len + 1;
+    size_t len = strcspn(value, "&");
+
+    /* The decoded value is never longer */
+    char* decoded = min_httpd_arena_strndup(arena, value, len);
+    if (decoded == NULL)
+        return NULL;
+
+    size_t out = 0;
+    for (size_t in = 0; in < len; in++) {
+        char c = decoded[in];
+        if (c == '+') {
+            c = ' ';
+        } else if ((c == '%') && (in + 2 < len)) {
+            int high = min_httpd_arena_hex(decoded[in + 1]);
+            int low = (high < 0) ? -1 : min_httpd_arena_hex(decoded[in + 2]);
+            if (low >= 0) {
+                c = (char)((high << 4) | low);
+                in += 2;
+            }
+        }
+        decoded[out++] = c;
+    }
+    decoded[out] = '\0';
+
+    // Return the bytes of the escapes
+    arena->used -= len - out;
+    return decoded;
+}
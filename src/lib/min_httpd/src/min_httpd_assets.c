@@ -0,0 +1,292 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Packed web assets of the ``min_httpd`` component.
+ *
+ * The assets of the component's ``www`` directory are packed at build time
+ * (see ``pack_assets()`` in the component's ``CMakeLists.txt``) into the table
+ * ::min_httpd_www . They are served, if a ``GET`` request can not be matched
+ * to a *URI handler* (see ::min_httpd_assets_fallback ), so they do not use
+ * any of the server's *URI handlers*.
+ *
+ * Other components pack their own assets and serve them with
+ * ::min_httpd_assets_send from their *URI handlers*.
+ *
+ * With ::MIN_HTTPD_ASSETS_PARTITION , the component's assets are not embedded
+ * into the application. Instead, their image is flashed to a data partition,
+ * that is memory-mapped with ``esp_partition_mmap()`` (see
+ * ::min_httpd_assets_mount ). Only the table (the fixed-size fields of the
+ * assets) is restored in RAM, so the assets may be updated without
+ * rebuilding the application.
+ *
+ * The content is sent directly from the blob, either embedded into the
+ * application or mapped from the partition, without copying it.
+ *
+ * @file   min_httpd_assets.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* Other headers of the component. */
+#include "min_httpd/min_httpd.h"      // The public header
+#include "min_httpd_assets_engine.h"  // lookups and headers
+#include "min_httpd_internal.h"       // modules of the component
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* This is EPS-IDF's http server library. */
+#include "esp_http_server.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* This is ESP-IDF's partition API, that maps the asset partition. */
+#include "esp_partition.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The maximum length of the request's headers, that are evaluated
+ * (``Accept-Encoding``, ``If-None-Match``, ``If-Modified-Since``, ``Range``
+ * and ``If-Range``).
+ *
+ * Longer headers are ignored.
+ */
+#define MIN_HTTPD_ASSETS_HEADER_LEN 64
+
+/**
+ * The maximum length of the head of a response.
+ */
+#define MIN_HTTPD_ASSETS_HEAD_LEN 384
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "krachkiste.httpd.assets";
+
+#if MIN_HTTPD_ASSETS_PARTITION
+/**
+ * The table of the component's assets, restored from the asset partition.
+ */
+static struct min_httpd_asset_table min_httpd_assets_partition;
+
+/**
+ * The table of the component's assets.
+ *
+ * This is ``NULL`` until the asset partition is mapped successfully.
+ */
+static const struct min_httpd_asset_table* min_httpd_assets_www = NULL;
+#else
+/**
+ * The table of the component's assets.
+ *
+ * This is generated by ``pack_assets()`` (see the component's
+ * ``CMakeLists.txt``).
+ */
+extern const struct min_httpd_asset_table min_httpd_www;
+
+/**
+ * The table of the component's assets.
+ */
+static const struct min_httpd_asset_table* const min_httpd_assets_www =
+    &min_httpd_www;
+#endif
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static const char* min_httpd_assets_header(httpd_req_t* request,
+                                           const char* field,
+                                           char* buf);
+static esp_err_t min_httpd_assets_send_chunks(httpd_req_t* request,
+                                              const char* data,
+                                              size_t len);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get a header of the request.
+ *
+ * @param request The request.
+ * @param field   The name of the header.
+ * @param buf     The buffer of ::MIN_HTTPD_ASSETS_HEADER_LEN bytes.
+ * @return const char* ``buf``, ``NULL`` if the header is missing or longer
+ *                     than the buffer.
+ */
+static const char* min_httpd_assets_header(httpd_req_t* request,
+                                           const char* field,
+                                           char* buf) {
+    return (httpd_req_get_hdr_value_str(request,
+                                        field,
+                                        buf,
+                                        MIN_HTTPD_ASSETS_HEADER_LEN) == ESP_OK)
+               ? buf
+               : NULL;
+}
+
+/**
+ * Send data in chunks of ::MIN_HTTPD_ASSETS_CHUNK_LEN bytes.
+ *
+ * The chunks are passed to the socket directly from ``data``.
+ *
+ * @param request The request.
+ * @param data    The data.
+ * @param len     The length of ``data``.
+ * @return esp_err_t ``ESP_OK`` if all data was sent, ``ESP_FAIL`` otherwise.
+ */
+static esp_err_t min_httpd_assets_send_chunks(httpd_req_t* request,
+                                              const char* data,
+                                              size_t len) {
+    while (len > 0) {
+        int sent = httpd_send(request,
+                              data,
+                              (len < MIN_HTTPD_ASSETS_CHUNK_LEN)
+                                  ? len
+                                  : MIN_HTTPD_ASSETS_CHUNK_LEN);
+        if (sent <= 0)
+            return ESP_FAIL;
+        data += sent;
+        len -= sent;
+    }
+    return ESP_OK;
+}
+
+// Documentation in header file!
+esp_err_t min_httpd_assets_send(httpd_req_t* request,
+                                const struct min_httpd_asset_table* table,
+                                const char* path) {
+    const struct min_httpd_asset* asset =
+        min_httpd_assets_find(table, (path != NULL) ? path : request->uri);
+    if (asset == NULL)
+        return ESP_ERR_NOT_FOUND;
+
+    char values[5][MIN_HTTPD_ASSETS_HEADER_LEN];
+    const struct min_httpd_assets_request headers = {
+        .accept_encoding =
+            min_httpd_assets_header(request, "Accept-Encoding", values[0]),
+        .if_none_match =
+            min_httpd_assets_header(request, "If-None-Match", values[1]),
+        .if_modified_since =
+            min_httpd_assets_header(request, "If-Modified-Since", values[2]),
+        .range = min_httpd_assets_header(request, "Range", values[3]),
+        .if_range = min_httpd_assets_header(request, "If-Range", values[4]),
+    };
+    struct min_httpd_assets_response response;
+    min_httpd_assets_evaluate(table, asset, &headers, &response);
+
+    // The head is sent separately, so the content is not copied
+    char head[MIN_HTTPD_ASSETS_HEAD_LEN];
+    size_t head_len =
+        min_httpd_assets_response_head(head, sizeof(head), asset, &response);
+    esp_err_t return_value =
+        (head_len > 0) ? min_httpd_assets_send_chunks(request, head, head_len)
+                       : ESP_FAIL;
+    if (return_value == ESP_OK) {
+        return_value = min_httpd_assets_send_chunks(
+            request,
+            (const char*)table->blob + response.offset,
+            response.len);
+    }
+    min_httpd_log_message(request, return_value);
+
+    return return_value;
+}
+
+// Documentation in header file!
+esp_err_t min_httpd_assets_fallback(httpd_req_t* request) {
+    if (request->method != HTTP_GET)
+        return ESP_ERR_NOT_FOUND;
+
+    return min_httpd_assets_send(request, min_httpd_assets_www, NULL);
+}
+
+// Documentation in header file!
+bool min_httpd_assets_exists(const char* uri) {
+    return min_httpd_assets_find(min_httpd_assets_www, uri) != NULL;
+}
+
+// Documentation in header file!
+void min_httpd_assets_mount(void) {
+#if MIN_HTTPD_ASSETS_PARTITION
+    // The partition remains mapped, if the server is restarted
+    if (min_httpd_assets_www != NULL)
+        return;
+
+    const esp_partition_t* partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                 ESP_PARTITION_SUBTYPE_ANY,
+                                 MIN_HTTPD_ASSETS_PARTITION_LABEL);
+    if (partition == NULL) {
+        ESP_LOGE(TAG,
+                 "No asset partition '%s'!",
+                 MIN_HTTPD_ASSETS_PARTITION_LABEL);
+        return;
+    }
+
+    // Only the range of the image is mapped
+    struct min_httpd_assets_image_header header;
+    size_t len = 0;
+    if (esp_partition_read(partition, 0, &header, sizeof(header)) == ESP_OK)
+        len = min_httpd_assets_image_len(&header);
+    if ((len == 0) || (len > partition->size)) {
+        ESP_LOGE(TAG, "No assets in partition '%s'!", partition->label);
+        return;
+    }
+
+    const void* image;
+    spi_flash_mmap_handle_t handle;
+    if (esp_partition_mmap(partition,
+                           0,
+                           len,
+                           SPI_FLASH_MMAP_DATA,
+                           &image,
+                           &handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Could not map partition '%s'!", partition->label);
+        return;
+    }
+
+    size_t count = min_httpd_assets_image_check(image, len);
+    struct min_httpd_asset* assets =
+        (count > 0) ? malloc(count * sizeof(*assets)) : NULL;
+    if (assets == NULL) {
+        ESP_LOGE(TAG,
+                 "Could not restore the assets of partition '%s'!",
+                 partition->label);
+        spi_flash_munmap(handle);
+        return;
+    }
+
+    min_httpd_assets_image_open(image, assets, &min_httpd_assets_partition);
+    min_httpd_assets_www = &min_httpd_assets_partition;
+    ESP_LOGI(TAG,
+             "Mapped %u assets (%u bytes) of partition '%s'",
+             (unsigned int)count,
+             (unsigned int)len,
+             partition->label);
+#endif
+}
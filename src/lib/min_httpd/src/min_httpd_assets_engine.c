@@ -0,0 +1,513 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's packed web assets.
+ *
+ * The displacement of a path's first hash is either the index of its asset
+ * (negative, ``-index - 1``) or the seed of the second hash, that selects the
+ * asset. Paths, that are not packed, select any asset, so the path of the
+ * asset is compared in any case.
+ *
+ * Dates are converted with the algorithms of Howard Hinnant, as ``timegm()``
+ * is not available with **ESP-IDF**'s ``newlib``.
+ *
+ * An image is read with ``memcpy()``, as its header and entries are not
+ * necessarily aligned in the memory of a host.
+ *
+ * @file   min_httpd_assets_engine.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "min_httpd_assets_engine.h"
+
+/* C's standard libraries. */
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+// Documentation in header file!
+uint32_t min_httpd_assets_hash(const char* key, size_t len, uint32_t seed) {
+    // FNV-1a, starting with the seed
+    uint32_t hash = 2166136261u ^ seed;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)key[i];
+        hash *= 16777619u;
+    }
+
+    // The finalizer of MurmurHash3, as the lower bits select the asset
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+// Documentation in header file!
+const struct min_httpd_asset* min_httpd_assets_find(
+    const struct min_httpd_asset_table* table,
+    const char* uri) {
+    if ((table == NULL) || (table->count == 0))
+        return NULL;
+
+    size_t len = strcspn(uri, "?");
+    int32_t displacement =
+        table->displacements[min_httpd_assets_hash(uri, len, 0) %
+                             table->count];
+    size_t index = (displacement < 0)
+                       ? (size_t)(-displacement - 1)
+                       : min_httpd_assets_hash(uri, len, displacement) %
+                             table->count;
+    if (index >= table->count)
+        return NULL;
+
+    const struct min_httpd_asset* asset = &table->assets[index];
+    if ((strncmp(asset->path, uri, len) != 0) || (asset->path[len] != '\0'))
+        return NULL;
+    return asset;
+}
+
+// Documentation in header file!
+bool min_httpd_assets_accepts_gzip(const char* accept_encoding) {
+    const char* token = accept_encoding;
+
+    while ((token != NULL) && (*token != '\0')) {
+        while ((*token == ' ') || (*token == ','))
+            token++;
+        size_t len = strcspn(token, ",");
+
+        // ``gzip``, optionally with a quality, that is not ``0``
+        if ((len >= 4) && (strncasecmp(token, "gzip", 4) == 0) &&
+            ((len == 4) || (token[4] == ';') || (token[4] == ' '))) {
+            const char* quality = strstr(token, "q=");
+            return (quality == NULL) || (quality >= token + len) ||
+                   (strtod(quality + 2, NULL) > 0);
+        }
+        token += len;
+    }
+    return false;
+}
+
+// Documentation in header file!
+void min_httpd_assets_etag(const struct min_httpd_asset* asset,
+                           bool gzip,
+                           char* buf) {
+    snprintf(buf,
+             MIN_HTTPD_ASSETS_ETAG_LEN,
+             "\"%08x%s\"",
+             (unsigned int)asset->hash,
+             gzip ? "-gz" : "");
+}
+
+// Documentation in header file!
+bool min_httpd_assets_not_modified(const char* etag,
+                                   const char* if_none_match) {
+    if (if_none_match == NULL)
+        return false;
+
+    // Either any ``ETag`` or a list of them
+    return (strcmp(if_none_match, "*") == 0) ||
+           (strstr(if_none_match, etag) != NULL);
+}
+
+/**
+ * Get the number of days since the epoch of a date.
+ *
+ * See http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+ *
+ * @param year  The year, ``1970`` or later.
+ * @param month The month, ``1`` to ``12``.
+ * @param day   The day of the month.
+ * @return uint32_t The number of days.
+ */
+static uint32_t min_httpd_assets_days(uint32_t year,
+                                      uint32_t month,
+                                      uint32_t day) {
+    year -= (month <= 2) ? 1 : 0;
+    uint32_t era = year / 400;
+    uint32_t yoe = year - era * 400;
+    uint32_t doy = (153 * ((month > 2) ? month - 3 : month + 9) + 2) / 5 +
+                   day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// Documentation in header file!
+void min_httpd_assets_http_date(uint32_t timestamp, char* buf) {
+    static const char* const weekdays[] = {
+        "Thu", "Fri", "Sat", "Sun", "Mon", "Tue", "Wed"};
+    static const char* const months[] = {"Jan",
+                                         "Feb",
+                                         "Mar",
+                                         "Apr",
+                                         "May",
+                                         "Jun",
+                                         "Jul",
+                                         "Aug",
+                                         "Sep",
+                                         "Oct",
+                                         "Nov",
+                                         "Dec"};
+
+    // See http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+    uint32_t days = timestamp / 86400;
+    uint32_t seconds = timestamp % 86400;
+    uint32_t z = days + 719468;
+    uint32_t era = z / 146097;
+    uint32_t doe = z - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint32_t day = doy - (153 * mp + 2) / 5 + 1;
+    uint32_t month = (mp < 10) ? mp + 3 : mp - 9;
+    uint32_t year = yoe + era * 400 + ((month <= 2) ? 1 : 0);
+
+    snprintf(buf,
+             MIN_HTTPD_ASSETS_DATE_LEN,
+             "%s, %02u %s %04u %02u:%02u:%02u GMT",
+             weekdays[days % 7],
+             (unsigned int)day,
+             months[month - 1],
+             (unsigned int)year,
+             (unsigned int)(seconds / 3600),
+             (unsigned int)(seconds / 60 % 60),
+             (unsigned int)(seconds % 60));
+}
+
+// Documentation in header file!
+bool min_httpd_assets_parse_date(const char* date, uint32_t* timestamp) {
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char month[4];
+    unsigned int day, year, hour, minute, second;
+    int len = 0;
+
+    if ((sscanf(date,
+                "%*3[A-Za-z], %2u %3[A-Za-z] %4u %2u:%2u:%2u GMT%n",
+                &day,
+                month,
+                &year,
+                &hour,
+                &minute,
+                &second,
+                &len) != 6) ||
+        (len == 0) || (date[len] != '\0'))
+        return false;
+
+    const char* found = strstr(months, month);
+    if ((found == NULL) || ((found - months) % 3 != 0) || (day < 1) ||
+        (day > 31) || (year < 1970) || (year > 2105) || (hour > 23) ||
+        (minute > 59) || (second > 60))
+        return false;
+
+    uint64_t value =
+        (uint64_t)min_httpd_assets_days(year, (found - months) / 3 + 1, day) *
+            86400 +
+        hour * 3600 + minute * 60 + second;
+    if (value > UINT32_MAX)
+        return false;
+    *timestamp = (uint32_t)value;
+    return true;
+}
+
+/**
+ * Parse the ``Range`` of a request.
+ *
+ * Only a single range of bytes is supported (``first-last``, ``first-`` or
+ * ``-suffix``), anything else is ignored.
+ *
+ * @param range The ``Range`` of the request.
+ * @param total The length of the variant.
+ * @param first The offset of the range.
+ * @param len   The length of the range.
+ * @return enum min_httpd_assets_status ``MIN_HTTPD_ASSETS_PARTIAL`` for a
+ *                                      valid range,
+ *                                      ``MIN_HTTPD_ASSETS_UNSATISFIABLE`` if
+ *                                      it is outside of the variant,
+ *                                      ``MIN_HTTPD_ASSETS_OK`` if it is
+ *                                      ignored.
+ */
+static enum min_httpd_assets_status min_httpd_assets_range(const char* range,
+                                                           uint32_t total,
+                                                           uint32_t* first,
+                                                           uint32_t* len) {
+    if ((strncmp(range, "bytes=", 6) != 0) || (strchr(range, ',') != NULL))
+        return MIN_HTTPD_ASSETS_OK;
+
+    const char* spec = range + 6;
+    char* end;
+    if (spec[0] == '-') {
+        if (!isdigit((unsigned char)spec[1]))
+            return MIN_HTTPD_ASSETS_OK;
+        unsigned long suffix = strtoul(spec + 1, &end, 10);
+        if (*end != '\0')
+            return MIN_HTTPD_ASSETS_OK;
+        if ((suffix == 0) || (total == 0))
+            return MIN_HTTPD_ASSETS_UNSATISFIABLE;
+
+        *len = (suffix < total) ? (uint32_t)suffix : total;
+        *first = total - *len;
+        return MIN_HTTPD_ASSETS_PARTIAL;
+    }
+
+    if (!isdigit((unsigned char)spec[0]))
+        return MIN_HTTPD_ASSETS_OK;
+    unsigned long from = strtoul(spec, &end, 10);
+    if (*end != '-')
+        return MIN_HTTPD_ASSETS_OK;
+    unsigned long to = ULONG_MAX;
+    if (end[1] != '\0') {
+        if (!isdigit((unsigned char)end[1]))
+            return MIN_HTTPD_ASSETS_OK;
+        to = strtoul(end + 1, &end, 10);
+        if ((*end != '\0') || (to < from))
+            return MIN_HTTPD_ASSETS_OK;
+    }
+    if (from >= total)
+        return MIN_HTTPD_ASSETS_UNSATISFIABLE;
+
+    *first = (uint32_t)from;
+    *len = (uint32_t)(((to < total) ? to + 1 : total) - from);
+    return MIN_HTTPD_ASSETS_PARTIAL;
+}
+
+// Documentation in header file!
+void min_httpd_assets_evaluate(const struct min_httpd_asset_table* table,
+                               const struct min_httpd_asset* asset,
+                               const struct min_httpd_assets_request* request,
+                               struct min_httpd_assets_response* response) {
+    response->gzip = (asset->gzip_len > 0) &&
+                     (request->accept_encoding != NULL) &&
+                     min_httpd_assets_accepts_gzip(request->accept_encoding);
+    min_httpd_assets_etag(asset, response->gzip, response->etag);
+    response->timestamp = table->timestamp;
+    response->offset = response->gzip ? asset->gzip_offset : asset->offset;
+    response->total = response->gzip ? asset->gzip_len : asset->len;
+    response->first = 0;
+    response->len = response->total;
+    response->status = MIN_HTTPD_ASSETS_OK;
+
+    // ``If-Modified-Since`` is ignored, if ``If-None-Match`` is provided
+    uint32_t since;
+    if ((request->if_none_match != NULL)
+            ? min_httpd_assets_not_modified(response->etag,
+                                            request->if_none_match)
+            : ((request->if_modified_since != NULL) &&
+               min_httpd_assets_parse_date(request->if_modified_since,
+                                           &since) &&
+               (table->timestamp <= since))) {
+        response->status = MIN_HTTPD_ASSETS_NOT_MODIFIED;
+        response->len = 0;
+        return;
+    }
+
+    // A range of another variant (``If-Range``) is not sent
+    uint32_t date;
+    if ((request->range == NULL) ||
+        ((request->if_range != NULL) &&
+         ((request->if_range[0] == '"')
+              ? (strcmp(request->if_range, response->etag) != 0)
+              : (!min_httpd_assets_parse_date(request->if_range, &date) ||
+                 (date != table->timestamp)))))
+        return;
+
+    uint32_t first;
+    uint32_t len;
+    response->status =
+        min_httpd_assets_range(request->range, response->total, &first, &len);
+    if (response->status == MIN_HTTPD_ASSETS_PARTIAL) {
+        response->first = first;
+        response->offset += first;
+        response->len = len;
+    } else if (response->status == MIN_HTTPD_ASSETS_UNSATISFIABLE) {
+        response->len = 0;
+    }
+}
+
+// Documentation in header file!
+size_t min_httpd_assets_response_head(
+    char* buf,
+    size_t size,
+    const struct min_httpd_asset* asset,
+    const struct min_httpd_assets_response* response) {
+    const char* vary =
+        (asset->gzip_len > 0) ? "Vary: Accept-Encoding\r\n" : "";
+    char date[MIN_HTTPD_ASSETS_DATE_LEN];
+    int ret;
+
+    min_httpd_assets_http_date(response->timestamp, date);
+    switch (response->status) {
+        case MIN_HTTPD_ASSETS_NOT_MODIFIED:
+            ret = snprintf(buf,
+                           size,
+                           "HTTP/1.1 304 Not Modified\r\n"
+                           "ETag: %s\r\n"
+                           "Last-Modified: %s\r\n"
+                           "%s"
+                           "\r\n",
+                           response->etag,
+                           date,
+                           vary);
+            break;
+        case MIN_HTTPD_ASSETS_UNSATISFIABLE:
+            ret = snprintf(buf,
+                           size,
+                           "HTTP/1.1 416 Range Not Satisfiable\r\n"
+                           "Content-Length: 0\r\n"
+                           "Content-Range: bytes */%u\r\n"
+                           "\r\n",
+                           (unsigned int)response->total);
+            break;
+        default:
+            ret = snprintf(buf,
+                           size,
+                           "HTTP/1.1 %s\r\n"
+                           "Content-Type: %s\r\n"
+                           "Content-Length: %u\r\n",
+                           (response->status == MIN_HTTPD_ASSETS_PARTIAL)
+                               ? "206 Partial Content"
+                               : "200 OK",
+                           asset->type,
+                           (unsigned int)response->len);
+            if ((ret >= 0) && ((size_t)ret < size) &&
+                (response->status == MIN_HTTPD_ASSETS_PARTIAL)) {
+                ret += snprintf(buf + ret,
+                                size - ret,
+                                "Content-Range: bytes %u-%u/%u\r\n",
+                                (unsigned int)response->first,
+                                (unsigned int)(response->first +
+                                               response->len - 1),
+                                (unsigned int)response->total);
+            }
+            if ((ret >= 0) && ((size_t)ret < size)) {
+                ret += snprintf(buf + ret,
+                                size - ret,
+                                "Accept-Ranges: bytes\r\n"
+                                "ETag: %s\r\n"
+                                "Last-Modified: %s\r\n"
+                                "%s"
+                                "%s"
+                                "\r\n",
+                                response->etag,
+                                date,
+                                response->gzip ? "Content-Encoding: gzip\r\n"
+                                               : "",
+                                vary);
+            }
+            break;
+    }
+    if ((ret < 0) || ((size_t)ret >= size))
+        return 0;
+    return (size_t)ret;
+}
+
+// Documentation in header file!
+size_t min_httpd_assets_image_len(
+    const struct min_httpd_assets_image_header* header) {
+    if ((header->magic != MIN_HTTPD_ASSETS_IMAGE_MAGIC) ||
+        (header->version != MIN_HTTPD_ASSETS_IMAGE_VERSION) ||
+        (header->len < sizeof(*header)))
+        return 0;
+    return header->len;
+}
+
+/**
+ * Determine, if an image contains a string at an offset.
+ *
+ * @param image  The image.
+ * @param len    The length of ``image``.
+ * @param offset The offset of the string.
+ * @return bool ``true`` if the string is terminated within the image.
+ */
+static bool min_httpd_assets_image_string(const uint8_t* image,
+                                          size_t len,
+                                          uint32_t offset) {
+    return (offset < len) &&
+           (memchr(image + offset, '\0', len - offset) != NULL);
+}
+
+// Documentation in header file!
+size_t min_httpd_assets_image_check(const uint8_t* image, size_t size) {
+    struct min_httpd_assets_image_header header;
+
+    if (size < sizeof(header))
+        return 0;
+    memcpy(&header, image, sizeof(header));
+
+    // 64 bit, so the offsets of a corrupted header do not overflow
+    uint64_t len = min_httpd_assets_image_len(&header);
+    uint64_t entries = (uint64_t)header.count *
+                       sizeof(struct min_httpd_assets_image_entry);
+    uint64_t displacements = (uint64_t)header.count * sizeof(int32_t);
+    if ((len == 0) || (len > size) || (header.count == 0) ||
+        (header.entries < sizeof(header)) ||
+        (header.entries + entries > header.displacements) ||
+        (header.displacements % sizeof(int32_t) != 0) ||
+        (header.displacements + displacements > header.blob) ||
+        ((uint64_t)header.blob + header.blob_len > len))
+        return 0;
+
+    for (uint32_t i = 0; i < header.count; i++) {
+        struct min_httpd_assets_image_entry entry;
+        memcpy(&entry,
+               image + header.entries + i * sizeof(entry),
+               sizeof(entry));
+
+        if (!min_httpd_assets_image_string(image, len, entry.path) ||
+            !min_httpd_assets_image_string(image, len, entry.type) ||
+            ((uint64_t)entry.offset + entry.len > header.blob_len) ||
+            ((uint64_t)entry.gzip_offset + entry.gzip_len > header.blob_len))
+            return 0;
+    }
+
+    // Last, as this reads the whole image
+    if (min_httpd_assets_hash((const char*)image + sizeof(header),
+                              len - sizeof(header),
+                              0) != header.checksum)
+        return 0;
+    return header.count;
+}
+
+// Documentation in header file!
+void min_httpd_assets_image_open(const uint8_t* image,
+                                 struct min_httpd_asset* assets,
+                                 struct min_httpd_asset_table* table) {
+    struct min_httpd_assets_image_header header;
+    memcpy(&header, image, sizeof(header));
+
+    for (uint32_t i = 0; i < header.count; i++) {
+        struct min_httpd_assets_image_entry entry;
+        memcpy(&entry,
+               image + header.entries + i * sizeof(entry),
+               sizeof(entry));
+
+        assets[i].path = (const char*)image + entry.path;
+        assets[i].type = (const char*)image + entry.type;
+        assets[i].hash = entry.hash;
+        assets[i].offset = entry.offset;
+        assets[i].len = entry.len;
+        assets[i].gzip_offset = entry.gzip_offset;
+        assets[i].gzip_len = entry.gzip_len;
+    }
+
+    table->assets = assets;
+    table->displacements = (const int32_t*)(image + header.displacements);
+    table->count = header.count;
+    table->blob = image + header.blob;
+    table->blob_len = header.blob_len;
+    table->timestamp = header.timestamp;
+}
@@ -0,0 +1,295 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's packed web assets.
+ *
+ * The assets are packed at build time (see ``tools/packer/assets.py``) into a
+ * single blob and a table, that is ordered by a minimal perfect hash of the
+ * paths. A lookup hashes the path twice at most and compares a single path,
+ * regardless of the number of assets.
+ *
+ * Alternatively, the table and the blob are packed into an *image*, that is
+ * flashed to a data partition and memory-mapped. The table is restored from
+ * the image, while its paths, MIME types, displacements and the blob remain
+ * in the mapped image.
+ *
+ * The engine does not depend on **ESP-IDF**, so it builds on a Linux host
+ * (see ``tools/min_httpd/assets`` and ``tools/min_httpd/partition``).
+ *
+ * @file   min_httpd_assets_engine.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_ASSETS_ENGINE_H_
+#define SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_ASSETS_ENGINE_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The tables of packed assets. */
+#include "min_httpd/min_httpd_assets.h"
+
+
+/**
+ * The length of an ``ETag``, including the terminating ``\0``.
+ */
+#define MIN_HTTPD_ASSETS_ETAG_LEN 16
+
+/**
+ * The length of an HTTP date (``IMF-fixdate``), including the terminating
+ * ``\0``.
+ */
+#define MIN_HTTPD_ASSETS_DATE_LEN 30
+
+/**
+ * The magic number of an image (``MHAP``).
+ */
+#define MIN_HTTPD_ASSETS_IMAGE_MAGIC 0x5041484du
+
+/**
+ * The version of the image's format.
+ *
+ * This MUST be kept in sync with ``IMAGE_VERSION`` of
+ * ``tools/packer/assets.py``.
+ */
+#define MIN_HTTPD_ASSETS_IMAGE_VERSION 2u
+
+
+/**
+ * The header of an image.
+ *
+ * The image is written by ``tools/packer/assets.py`` (see its description of
+ * the format). All values are little-endian, just like the ESP32's.
+ */
+struct min_httpd_assets_image_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;          // the number of assets
+    uint32_t entries;        // the offset of the entries
+    uint32_t displacements;  // the offset of the displacements
+    uint32_t blob;           // the offset of the blob
+    uint32_t blob_len;
+    uint32_t len;        // the length of the image, including the header
+    uint32_t timestamp;  // the time of packing
+    uint32_t checksum;   // the hash of the image after the header
+};
+
+/**
+ * An asset of an image.
+ *
+ * This is a ``struct min_httpd_asset`` with the offsets of its strings.
+ */
+struct min_httpd_assets_image_entry {
+    uint32_t path;  // the offset of the path in the image
+    uint32_t type;  // the offset of the MIME type in the image
+    uint32_t hash;
+    uint32_t offset;
+    uint32_t len;
+    uint32_t gzip_offset;
+    uint32_t gzip_len;
+};
+
+
+/**
+ * The status of a response with an asset.
+ *
+ * MIN_HTTPD_ASSETS_OK            - ``200 OK`` with the whole variant.
+ * MIN_HTTPD_ASSETS_PARTIAL       - ``206 Partial Content`` with a single
+ *                                  range of the variant.
+ * MIN_HTTPD_ASSETS_NOT_MODIFIED  - ``304 Not Modified`` without content.
+ * MIN_HTTPD_ASSETS_UNSATISFIABLE - ``416 Range Not Satisfiable`` without
+ *                                  content.
+ */
+enum min_httpd_assets_status {
+    MIN_HTTPD_ASSETS_OK,
+    MIN_HTTPD_ASSETS_PARTIAL,
+    MIN_HTTPD_ASSETS_NOT_MODIFIED,
+    MIN_HTTPD_ASSETS_UNSATISFIABLE
+};
+
+/**
+ * The headers of a request, that are evaluated, ``NULL`` if missing.
+ */
+struct min_httpd_assets_request {
+    const char* accept_encoding;
+    const char* if_none_match;
+    const char* if_modified_since;
+    const char* range;
+    const char* if_range;
+};
+
+/**
+ * The response with an asset.
+ */
+struct min_httpd_assets_response {
+    enum min_httpd_assets_status status;
+    bool gzip;  // ``true`` for the ``gzip`` variant
+    char etag[MIN_HTTPD_ASSETS_ETAG_LEN];
+    uint32_t timestamp;  // ``Last-Modified``
+    uint32_t offset;     // the offset of the content in the blob
+    uint32_t len;        // the length of the content
+    uint32_t first;      // the offset of the content in the variant
+    uint32_t total;      // the length of the variant
+};
+
+/**
+ * Hash a path.
+ *
+ * This MUST be kept in sync with ``asset_hash()`` of
+ * ``tools/packer/assets.py``.
+ *
+ * @param key  The path.
+ * @param len  The length of ``key``.
+ * @param seed The seed.
+ * @return uint32_t The hash.
+ */
+uint32_t min_httpd_assets_hash(const char* key, size_t len, uint32_t seed);
+
+/**
+ * Find the asset of a request.
+ *
+ * The query is ignored.
+ *
+ * @param table The table.
+ * @param uri   The URI of the request.
+ * @return const struct min_httpd_asset* The asset, ``NULL`` if there is none.
+ */
+const struct min_httpd_asset* min_httpd_assets_find(
+    const struct min_httpd_asset_table* table,
+    const char* uri);
+
+/**
+ * Determine, if a client accepts ``gzip`` compressed content.
+ *
+ * @param accept_encoding The ``Accept-Encoding`` of the request.
+ * @return bool ``true`` if ``gzip`` is accepted.
+ */
+bool min_httpd_assets_accepts_gzip(const char* accept_encoding);
+
+/**
+ * Write the ``ETag`` of an asset.
+ *
+ * The variants of an asset have distinct ``ETag`` s.
+ *
+ * @param asset The asset.
+ * @param gzip  ``true`` for the ``gzip`` variant.
+ * @param buf   The buffer of ::MIN_HTTPD_ASSETS_ETAG_LEN bytes.
+ */
+void min_httpd_assets_etag(const struct min_httpd_asset* asset,
+                           bool gzip,
+                           char* buf);
+
+/**
+ * Determine, if the client has the current variant of an asset already.
+ *
+ * @param etag          The ``ETag`` of the variant.
+ * @param if_none_match The ``If-None-Match`` of the request.
+ * @return bool ``true`` if the response is ``304 Not Modified``.
+ */
+bool min_httpd_assets_not_modified(const char* etag,
+                                   const char* if_none_match);
+
+/**
+ * Write an HTTP date (``IMF-fixdate``), e.g.
+ * ``Sun, 06 Nov 1994 08:49:37 GMT``.
+ *
+ * @param timestamp The time, in seconds since the epoch.
+ * @param buf       The buffer of ::MIN_HTTPD_ASSETS_DATE_LEN bytes.
+ */
+void min_httpd_assets_http_date(uint32_t timestamp, char* buf);
+
+/**
+ * Parse an HTTP date.
+ *
+ * Only ``IMF-fixdate`` is supported; a date in an obsolete format is invalid,
+ * so its condition is ignored.
+ *
+ * @param date      The date.
+ * @param timestamp The time, in seconds since the epoch.
+ * @return bool ``true`` if the date is valid.
+ */
+bool min_httpd_assets_parse_date(const char* date, uint32_t* timestamp);
+
+/**
+ * Evaluate a request of an asset.
+ *
+ * The variant is selected by ``Accept-Encoding``. ``If-None-Match`` takes
+ * precedence over ``If-Modified-Since``, which is compared with the time of
+ * packing. A single range of the variant (``Range: bytes=``) is sent, unless
+ * ``If-Range`` does not match the variant; multiple ranges and other units
+ * are ignored.
+ *
+ * @param table    The table of the asset.
+ * @param asset    The asset.
+ * @param request  The headers of the request.
+ * @param response The response.
+ */
+void min_httpd_assets_evaluate(const struct min_httpd_asset_table* table,
+                               const struct min_httpd_asset* asset,
+                               const struct min_httpd_assets_request* request,
+                               struct min_httpd_assets_response* response);
+
+/**
+ * Write the head of a response with an asset.
+ *
+ * The content of the response is sent after the head.
+ *
+ * @param buf      The buffer.
+ * @param size     The size of ``buf``.
+ * @param asset    The asset.
+ * @param response The response, see ::min_httpd_assets_evaluate .
+ * @return size_t The length of the head, ``0`` if ``buf`` is too small.
+ */
+size_t min_httpd_assets_response_head(
+    char* buf,
+    size_t size,
+    const struct min_httpd_asset* asset,
+    const struct min_httpd_assets_response* response);
+
+/**
+ * Get the length of an image from its header.
+ *
+ * This determines the range of the partition, that is mapped.
+ *
+ * @param header The header.
+ * @return size_t The length of the image, ``0`` if this is not an image of a
+ *                supported version (e.g. an erased partition).
+ */
+size_t min_httpd_assets_image_len(
+    const struct min_httpd_assets_image_header* header);
+
+/**
+ * Verify an image.
+ *
+ * All offsets of the image are verified, so the restored table does not
+ * reference anything outside of the image, and the checksum is verified, so
+ * an incompletely flashed image is detected.
+ *
+ * @param image The image.
+ * @param size  The size of ``image``, e.g. the size of the mapped range.
+ * @return size_t The number of assets, ``0`` if the image is invalid.
+ */
+size_t min_httpd_assets_image_check(const uint8_t* image, size_t size);
+
+/**
+ * Restore the table of a verified image.
+ *
+ * The paths, MIME types, displacements and the blob are referenced in the
+ * image, so it must remain accessible as long as the table is used.
+ *
+ * @param image  The image, verified by ::min_httpd_assets_image_check .
+ * @param assets The storage of the assets, one per asset of the image.
+ * @param table  The table.
+ */
+void min_httpd_assets_image_open(const uint8_t* image,
+                                 struct min_httpd_asset* assets,
+                                 struct min_httpd_asset_table* table);
+
+#endif  // SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_ASSETS_ENGINE_H_
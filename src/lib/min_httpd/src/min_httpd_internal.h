@@ -0,0 +1,321 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+#ifndef SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_INTERNAL_H_
+#define SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_INTERNAL_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* This is ESP-IDF's http server library.
+ * - defines ``httpd_handle_t`` and ``httpd_work_fn_t``
+ */
+#include "esp_http_server.h"
+
+/* The metrics registry.
+ * - defines the storage of the component's metrics
+ */
+#include "obs32/obs32_metrics.h"
+
+/* The trace buffers.
+ * - defines the group of the component's trace points
+ */
+#include "obs32/obs32_trace.h"
+
+
+/**
+ * Queue a function with the server's task.
+ *
+ * This may be called from any task. The server is not stopped, while a
+ * function is queued: functions, that are queued, run before the server
+ * stops.
+ *
+ * @param work The function.
+ * @param arg  The argument of ``work``.
+ * @return esp_err_t ``ESP_OK`` if the function was queued,
+ *                   ``ESP_ERR_INVALID_STATE`` if the server is not running,
+ *                   the error of ``httpd_queue_work()`` otherwise.
+ */
+esp_err_t min_httpd_queue_work(httpd_work_fn_t work, void* arg);
+
+/**
+ * Serve a request, that could not be matched to a *URI handler*, from the
+ * component's packed assets.
+ *
+ * Only ``GET`` requests are served.
+ *
+ * @param request The request.
+ * @return esp_err_t ``ESP_ERR_NOT_FOUND`` if there is no asset (nothing was
+ *                   sent), the return value of ::min_httpd_assets_send
+ *                   otherwise.
+ */
+esp_err_t min_httpd_assets_fallback(httpd_req_t* request);
+
+/**
+ * Check, if a path is one of the component's packed assets.
+ *
+ * @param uri The URI of a request, the query is ignored.
+ * @return bool ``true`` if the asset exists.
+ */
+bool min_httpd_assets_exists(const char* uri);
+
+/**
+ * Map the component's asset partition.
+ *
+ * The partition is mapped once and remains mapped, if the server is
+ * restarted. If it does not contain a valid image, the component's assets
+ * are not served. This is a no-op, if the assets are embedded into the
+ * application (see ::MIN_HTTPD_ASSETS_PARTITION ).
+ */
+void min_httpd_assets_mount(void);
+
+/**
+ * Provide the WebSocket push channel with a (newly started) server.
+ *
+ * Registers the channel's *URI handler* (see ::MIN_HTTPD_WS_URI ). This is a
+ * no-op, if the channel is disabled (see ::MIN_HTTPD_WS_ENABLED ).
+ *
+ * @param server The server's handle.
+ */
+void min_httpd_ws_attach(httpd_handle_t server);
+
+/**
+ * Detach the WebSocket push channel from the stopped server.
+ */
+void min_httpd_ws_detach(void);
+
+/**
+ * Remove a closed session from the subscribers of the WebSocket push channel.
+ *
+ * This is called from the server's ``close_fn`` for every session.
+ *
+ * @param sockfd The session's socket.
+ */
+void min_httpd_ws_session_closed(int sockfd);
+
+/**
+ * Provide the Server-Sent Events stream with a (newly started) server.
+ *
+ * Registers the stream's *URI handler* (see ::MIN_HTTPD_SSE_URI ). This is a
+ * no-op, if the stream is disabled (see ::MIN_HTTPD_SSE_ENABLED ).
+ *
+ * @param server The server's handle.
+ */
+void min_httpd_sse_attach(httpd_handle_t server);
+
+/**
+ * Detach the Server-Sent Events stream from the stopped server.
+ *
+ * Releases the queued and retained events.
+ */
+void min_httpd_sse_detach(void);
+
+/**
+ * Remove a closed session from the clients of the Server-Sent Events stream.
+ *
+ * This is called from the server's ``close_fn`` for every session.
+ *
+ * @param sockfd The session's socket.
+ */
+void min_httpd_sse_session_closed(int sockfd);
+
+/**
+ * Provide the offloaded routes with a (newly started) server.
+ *
+ * The worker tasks are created with the first server (see
+ * ::MIN_HTTPD_WORKERS ).
+ *
+ * @param server The server's handle.
+ */
+void min_httpd_offload_attach(httpd_handle_t server);
+
+/**
+ * Detach the offloaded routes from the stopped server.
+ *
+ * The responses of pending jobs are discarded.
+ */
+void min_httpd_offload_detach(void);
+
+/**
+ * Orphan the pending jobs of a closed session, so their responses are
+ * discarded.
+ *
+ * This is called from the server's ``close_fn`` for every session.
+ *
+ * @param sockfd The session's socket.
+ */
+void min_httpd_offload_session_closed(int sockfd);
+
+/**
+ * Admit a request, before it is dispatched to its route or to the handler of
+ * missing resources.
+ *
+ * Every request passes this function: if it is pipelined behind an offloaded
+ * request, whose response is pending, it is refused, closing the session
+ * without a response, so the responses are not reordered (see
+ * min_httpd_offload.c ). Otherwise it is admitted by
+ * ::min_httpd_limit_admit .
+ *
+ * This must be called from the server's task.
+ *
+ * @param request The request.
+ * @param cost    The tokens of the request, e.g.
+ *                ::MIN_HTTPD_LIMIT_COST_INLINE .
+ * @param ret     The return value of the handler, if the request is refused.
+ * @return bool ``true`` if the request is admitted, ``false`` if it was
+ *              refused.
+ */
+bool min_httpd_offload_admit(httpd_req_t* request,
+                             uint32_t cost,
+                             esp_err_t* ret);
+
+/**
+ * Register the firmware upload with the server.
+ *
+ * This is called from the server's startup routine. It does nothing, if
+ * uploads are disabled (see ::MIN_HTTPD_OTA_ENABLED ).
+ *
+ * @param server The server.
+ */
+void min_httpd_ota_attach(httpd_handle_t server);
+
+/**
+ * Register the component's homepage with the server.
+ *
+ * This is called from the server's startup routine. The homepage is a
+ * compiled template (see min_httpd_template.h ).
+ *
+ * @param server The server.
+ */
+void min_httpd_template_attach(httpd_handle_t server);
+
+/**
+ * Admit a request by the free heap and its client's rate.
+ *
+ * The request is refused, if the free heap is below
+ * ::MIN_HTTPD_LIMIT_MIN_HEAP (``503 Service Unavailable``, closing the
+ * session) or if its client exceeds its rate (``429 Too Many Requests``, see
+ * ::MIN_HTTPD_LIMIT_RATE ). The response of a refused request is sent
+ * already.
+ *
+ * This is only called by ::min_httpd_offload_admit , from the server's
+ * task.
+ *
+ * @param request The request.
+ * @param cost    The tokens of the request, e.g.
+ *                ::MIN_HTTPD_LIMIT_COST_INLINE .
+ * @param ret     The return value of the handler, if the request is refused.
+ * @return bool ``true`` if the request is admitted, ``false`` if it was
+ *              refused.
+ */
+bool min_httpd_limit_admit(httpd_req_t* request,
+                           uint32_t cost,
+                           esp_err_t* ret);
+
+/**
+ * Forget the clients of the rate limiting.
+ *
+ * This is called from the server's startup routine.
+ */
+void min_httpd_limit_reset(void);
+
+/**
+ * The requests of inline routes, that were admitted.
+ */
+extern struct obs32_metric_counter min_httpd_metrics_inline;
+
+/**
+ * The requests of offloaded routes, that were admitted.
+ */
+extern struct obs32_metric_counter min_httpd_metrics_offloaded;
+
+/**
+ * The requests, that were answered with a packed asset.
+ */
+extern struct obs32_metric_counter min_httpd_metrics_assets;
+
+/**
+ * The connectivity checks, that were redirected to the captive portal.
+ */
+extern struct obs32_metric_counter min_httpd_metrics_captive;
+
+/**
+ * The requests, that were answered with ``404 Not Found``.
+ */
+extern struct obs32_metric_counter min_httpd_metrics_misses;
+
+/**
+ * The requests, that exceeded their client's rate.
+ */
+extern struct obs32_metric_counter min_httpd_metrics_limited;
+
+/**
+ * The requests, that were shed for the lack of free heap.
+ */
+extern struct obs32_metric_counter min_httpd_metrics_shed;
+
+/**
+ * The number of open sessions.
+ */
+extern struct obs32_metric_gauge min_httpd_metrics_sessions;
+
+/**
+ * The durations of the handlers of inline routes, in microseconds.
+ */
+extern struct obs32_metric_histogram min_httpd_metrics_inline_us;
+
+/**
+ * The durations of the handlers of offloaded routes, in microseconds.
+ */
+extern struct obs32_metric_histogram min_httpd_metrics_offloaded_us;
+
+/**
+ * Register the component's metrics and provide them with the server.
+ *
+ * This is called from the server's startup routine. The metrics' *URI
+ * handler* (see ::MIN_HTTPD_METRICS_URI ) is only registered, if the
+ * endpoint is enabled (see ::MIN_HTTPD_METRICS_ENABLED ).
+ *
+ * @param server The server.
+ */
+void min_httpd_metrics_attach(httpd_handle_t server);
+
+/**
+ * The trace points of the component.
+ *
+ * These are the indexes of the names of ::min_httpd_trace_group . The
+ * argument of the handlers' spans is the session's socket, the argument of
+ * the stages of an offloaded job is its slot.
+ */
+enum min_httpd_trace_point {
+    MIN_HTTPD_TRACE_POINT_INLINE = 0,
+    MIN_HTTPD_TRACE_POINT_FALLBACK,
+    MIN_HTTPD_TRACE_POINT_OFFLOAD_QUEUED,
+    MIN_HTTPD_TRACE_POINT_OFFLOAD_RUN,
+    MIN_HTTPD_TRACE_POINT_OFFLOAD_COMPLETE,
+    MIN_HTTPD_TRACE_POINT_METRICS,
+};
+
+/**
+ * The group of the component's trace points.
+ */
+extern struct obs32_trace_group min_httpd_trace_group;
+
+/**
+ * Register the component's trace points and provide their export with the
+ * server.
+ *
+ * This is called from the server's startup routine. The export's *URI
+ * handler* (see ::MIN_HTTPD_TRACE_URI ) is only registered, if the tracing
+ * is enabled (see ::OBS32_TRACE_ENABLED ).
+ *
+ * @param server The server.
+ */
+void min_httpd_trace_attach(httpd_handle_t server);
+
+#endif  // SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_INTERNAL_H_
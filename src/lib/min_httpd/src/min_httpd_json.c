@@ -0,0 +1,93 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * JSON responses of the ``min_httpd`` component.
+ *
+ * The streaming JSON writer (see min_httpd_json.h ) is connected to a
+ * request: full chunks are sent with ``httpd_resp_send_chunk()``. A document,
+ * that fits into a single chunk, is sent with ``httpd_resp_send()`` instead,
+ * so small responses have a ``Content-Length`` and no chunked encoding.
+ *
+ * @file   min_httpd_json.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* Other headers of the component. */
+#include "min_httpd/min_httpd.h"       // The public header
+#include "min_httpd/min_httpd_json.h"  // the streaming JSON writer
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* This is EPS-IDF's http server library. */
+#include "esp_http_server.h"
+
+/* This is ESP-IDF's system library.
+ * - provides the free heap (``esp_get_free_heap_size()``)
+ */
+#include "esp_system.h"
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static bool min_httpd_json_send_chunk(void* ctx, const char* data, size_t len);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Send a full chunk of a response.
+ *
+ * This is the writer's flush function.
+ *
+ * @param ctx  The request (``httpd_req_t``).
+ * @param data The chunk.
+ * @param len  The length of ``data``.
+ * @return bool ``true`` if the chunk was sent.
+ */
+static bool min_httpd_json_send_chunk(void* ctx, const char* data, size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t*)ctx, data, len) == ESP_OK;
+}
+
+// Documentation in header file!
+void min_httpd_json_response(struct min_httpd_json* json,
+                             httpd_req_t* request,
+                             char* buf,
+                             size_t size) {
+    httpd_resp_set_type(request, "application/json");
+    min_httpd_json_init(json, buf, size, min_httpd_json_send_chunk, request);
+}
+
+// Documentation in header file!
+esp_err_t min_httpd_json_send(struct min_httpd_json* json) {
+    httpd_req_t* request = json->ctx;
+
+    // Nothing was sent yet, so the response is still an error
+    if ((json->flushed == 0) && (json->failed || (json->depth != 0))) {
+        httpd_resp_send_500(request);
+        return ESP_FAIL;
+    }
+
+    if (json->flushed == 0)
+        return httpd_resp_send(request, json->buf, json->len);
+
+    // The response is incomplete, so the session must be closed
+    if (!min_httpd_json_finish(json))
+        return ESP_FAIL;
+    return httpd_resp_send_chunk(request, NULL, 0);
+}
+
+// Documentation in header file!
+void min_httpd_json_heap(struct min_httpd_json* json) {
+    min_httpd_json_key(json, "heap");
+    min_httpd_json_uint(json, esp_get_free_heap_size());
+    min_httpd_json_key(json, "heap_min");
+    min_httpd_json_uint(json, esp_get_minimum_free_heap_size());
+}
@@ -0,0 +1,338 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's streaming JSON writer.
+ *
+ * The functions are documented in min_httpd_json.h , as the writer is part of
+ * the component's public interface.
+ *
+ * Strings are copied in runs of characters, that do not need escaping, and
+ * integers are formatted without ``printf()``.
+ *
+ * @file   min_httpd_json_engine.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* The public header of the writer. */
+#include "min_httpd/min_httpd_json.h"
+
+/* C's standard libraries. */
+#include <string.h>
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The maximum length of a formatted integer (``-9223372036854775808``).
+ */
+#define MIN_HTTPD_JSON_INT_LEN 20
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static void min_httpd_json_put(struct min_httpd_json* json,
+                               const char* data,
+                               size_t len);
+static inline void min_httpd_json_putc(struct min_httpd_json* json, char c);
+static void min_httpd_json_value(struct min_httpd_json* json);
+static void min_httpd_json_begin(struct min_httpd_json* json, char c);
+static void min_httpd_json_end(struct min_httpd_json* json, char c);
+static void min_httpd_json_escaped(struct min_httpd_json* json,
+                                   const char* str);
+static void min_httpd_json_digits(struct min_httpd_json* json,
+                                  bool negative,
+                                  uint64_t value);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Append output to the buffer, flushing full chunks.
+ *
+ * @param json The writer.
+ * @param data The output.
+ * @param len  The length of ``data``.
+ */
+static void min_httpd_json_put(struct min_httpd_json* json,
+                               const char* data,
+                               size_t len) {
+    // Most output fits into the chunk
+    if ((len <= json->size - json->len) && !json->failed) {
+        memcpy(json->buf + json->len, data, len);
+        json->len += len;
+        return;
+    }
+
+    while ((len > 0) && !json->failed) {
+        if (json->len == json->size) {
+            if ((json->flush == NULL) ||
+                !json->flush(json->ctx, json->buf, json->len)) {
+                json->failed = true;
+                return;
+            }
+            json->flushed += json->len;
+            json->len = 0;
+        }
+
+        size_t part = json->size - json->len;
+        if (part > len)
+            part = len;
+        memcpy(json->buf + json->len, data, part);
+        json->len += part;
+        data += part;
+        len -= part;
+    }
+}
+
+/**
+ * Append a single character to the buffer.
+ *
+ * This is the fast path of ::min_httpd_json_put for the punctuation.
+ *
+ * @param json The writer.
+ * @param c    The character.
+ */
+static inline void min_httpd_json_putc(struct min_httpd_json* json, char c) {
+    if ((json->len < json->size) && !json->failed)
+        json->buf[json->len++] = c;
+    else
+        min_httpd_json_put(json, &c, 1);
+}
+
+/**
+ * Prepare the output of a value (or a key), writing the comma, if the
+ * container has a value already.
+ *
+ * @param json The writer.
+ */
+static void min_httpd_json_value(struct min_httpd_json* json) {
+    if (json->key) {
+        json->key = false;
+        return;
+    }
+
+    uint32_t bit = (uint32_t)1 << json->depth;
+    if (json->members & bit)
+        min_httpd_json_putc(json, ',');
+    json->members |= bit;
+}
+
+/**
+ * Begin a container.
+ *
+ * @param json The writer.
+ * @param c    ``{`` or ``[``.
+ */
+static void min_httpd_json_begin(struct min_httpd_json* json, char c) {
+    min_httpd_json_value(json);
+    if (json->depth + 1 >= MIN_HTTPD_JSON_MAX_DEPTH) {
+        json->failed = true;
+        return;
+    }
+
+    json->depth++;
+    json->members &= ~((uint32_t)1 << json->depth);
+    min_httpd_json_putc(json, c);
+}
+
+/**
+ * End a container.
+ *
+ * @param json The writer.
+ * @param c    ``}`` or ``]``.
+ */
+static void min_httpd_json_end(struct min_httpd_json* json, char c) {
+    if ((json->depth == 0) || json->key) {
+        json->failed = true;
+        return;
+    }
+
+    json->depth--;
+    min_httpd_json_putc(json, c);
+}
+
+/**
+ * Write an escaped string, including its quotes.
+ *
+ * @param json The writer.
+ * @param str  The string.
+ */
+static void min_httpd_json_escaped(struct min_httpd_json* json,
+                                   const char* str) {
+    static const char hex[] = "0123456789abcdef";
+
+    min_httpd_json_putc(json, '"');
+    for (;;) {
+        size_t run = 0;
+        while (((unsigned char)str[run] >= 0x20) && (str[run] != '"') &&
+               (str[run] != '\\'))
+            run++;
+        min_httpd_json_put(json, str, run);
+        str += run;
+        if (*str == '\0')
+            break;
+
+        char escape[6] = {'\\', *str, 0, 0, 0, 0};
+        size_t len = 2;
+        switch (*str) {
+            case '"':
+            case '\\':
+                break;
+            case '\n':
+                escape[1] = 'n';
+                break;
+            case '\r':
+                escape[1] = 'r';
+                break;
+            case '\t':
+                escape[1] = 't';
+                break;
+            default:
+                escape[1] = 'u';
+                escape[2] = '0';
+                escape[3] = '0';
+                escape[4] = hex[(unsigned char)*str >> 4];
+                escape[5] = hex[*str & 0x0F];
+                len = 6;
+                break;
+        }
+        min_httpd_json_put(json, escape, len);
+        str++;
+    }
+    min_httpd_json_putc(json, '"');
+}
+
+/**
+ * Write the digits of an integer.
+ *
+ * @param json     The writer.
+ * @param negative Flag to write a minus sign.
+ * @param value    The absolute value.
+ */
+static void min_httpd_json_digits(struct min_httpd_json* json,
+                                  bool negative,
+                                  uint64_t value) {
+    char digits[MIN_HTTPD_JSON_INT_LEN];
+    size_t pos = sizeof(digits);
+
+    do {
+        digits[--pos] = (char)('0' + (value % 10));
+        value /= 10;
+    } while (value > 0);
+    if (negative)
+        digits[--pos] = '-';
+
+    min_httpd_json_value(json);
+    min_httpd_json_put(json, digits + pos, sizeof(digits) - pos);
+}
+
+// Documentation in header file!
+void min_httpd_json_init(struct min_httpd_json* json,
+                         char* buf,
+                         size_t size,
+                         min_httpd_json_flush_t flush,
+                         void* ctx) {
+    memset(json, 0, sizeof(*json));
+    json->buf = buf;
+    json->size = size;
+    json->flush = flush;
+    json->ctx = ctx;
+    json->failed = (size == 0);
+}
+
+// Documentation in header file!
+bool min_httpd_json_finish(struct min_httpd_json* json) {
+    if ((json->depth != 0) || json->key)
+        json->failed = true;
+    if (json->failed)
+        return false;
+
+    if ((json->flush != NULL) && (json->len > 0)) {
+        if (!json->flush(json->ctx, json->buf, json->len)) {
+            json->failed = true;
+            return false;
+        }
+        json->flushed += json->len;
+        json->len = 0;
+    }
+    return true;
+}
+
+// Documentation in header file!
+void min_httpd_json_object_begin(struct min_httpd_json* json) {
+    min_httpd_json_begin(json, '{');
+}
+
+// Documentation in header file!
+void min_httpd_json_object_end(struct min_httpd_json* json) {
+    min_httpd_json_end(json, '}');
+}
+
+// Documentation in header file!
+void min_httpd_json_array_begin(struct min_httpd_json* json) {
+    min_httpd_json_begin(json, '[');
+}
+
+// Documentation in header file!
+void min_httpd_json_array_end(struct min_httpd_json* json) {
+    min_httpd_json_end(json, ']');
+}
+
+// Documentation in header file!
+void min_httpd_json_key(struct min_httpd_json* json, const char* key) {
+    if (json->key || (json->depth == 0)) {
+        json->failed = true;
+        return;
+    }
+
+    min_httpd_json_value(json);
+    min_httpd_json_escaped(json, key);
+    min_httpd_json_putc(json, ':');
+    json->key = true;
+}
+
+// Documentation in header file!
+void min_httpd_json_string(struct min_httpd_json* json, const char* value) {
+    if (value == NULL) {
+        min_httpd_json_null(json);
+        return;
+    }
+
+    min_httpd_json_value(json);
+    min_httpd_json_escaped(json, value);
+}
+
+// Documentation in header file!
+void min_httpd_json_int(struct min_httpd_json* json, int64_t value) {
+    // The absolute value of ``INT64_MIN`` is not an ``int64_t``
+    uint64_t magnitude =
+        (value < 0) ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+    min_httpd_json_digits(json, value < 0, magnitude);
+}
+
+// Documentation in header file!
+void min_httpd_json_uint(struct min_httpd_json* json, uint64_t value) {
+    min_httpd_json_digits(json, false, value);
+}
+
+// Documentation in header file!
+void min_httpd_json_bool(struct min_httpd_json* json, bool value) {
+    min_httpd_json_value(json);
+    if (value)
+        min_httpd_json_put(json, "true", 4);
+    else
+        min_httpd_json_put(json, "false", 5);
+}
+
+// Documentation in header file!
+void min_httpd_json_null(struct min_httpd_json* json) {
+    min_httpd_json_value(json);
+    min_httpd_json_put(json, "null", 4);
+}
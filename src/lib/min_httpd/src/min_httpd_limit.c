@@ -0,0 +1,201 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Rate limiting and admission control of the ``min_httpd`` component.
+ *
+ * ``esp_http_server`` processes all requests with a single task and a few
+ * sessions, so a single client (e.g. a browser tab, that polls in a loop)
+ * may occupy the server, while the configuration form on the access point
+ * does not respond. Requests are admitted before their handler is executed
+ * (see ::min_httpd_limit_admit ), after ::min_httpd_offload_admit refused
+ * requests, that are pipelined behind an offloaded request:
+ *
+ *   1. if the free heap is below ::MIN_HTTPD_LIMIT_MIN_HEAP , the request is
+ *      answered with ``503 Service Unavailable`` and its session is closed,
+ *      so the server sheds load, before the network stack runs out of
+ *      memory;
+ *   2. the request takes its route's tokens from its client's bucket (see
+ *      min_httpd_limit_engine.h ), otherwise it is answered with
+ *      ``429 Too Many Requests``, keeping the session alive.
+ *
+ * The responses are precomputed and sent with ``httpd_send()``, so refusing
+ * a request is cheap. The buckets are only used by the server's task, so
+ * they are not locked.
+ *
+ * @file   min_httpd_limit.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Other headers of the component. */
+#include "min_httpd/min_httpd.h"     // The public header
+#include "min_httpd_internal.h"      // modules of the component
+#include "min_httpd_limit_engine.h"  // the token buckets
+
+/* The BSD socket API, used to determine the client's address. */
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* This is EPS-IDF's http server library. */
+#include "esp_http_server.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* This is ESP-IDF's system library.
+ * - provides the free heap (``esp_get_free_heap_size()``)
+ */
+#include "esp_system.h"
+
+/* This is ESP-IDF's high resolution timer library.
+ * - provides the time of the requests (``esp_timer_get_time()``)
+ */
+#include "esp_timer.h"
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "krachkiste.httpd.limit";
+
+/**
+ * The buckets of the clients, only accessed from the server's task.
+ */
+static struct min_httpd_limit min_httpd_limit;
+
+/**
+ * The storage of ::min_httpd_limit .
+ */
+static struct min_httpd_limit_bucket
+    min_httpd_limit_buckets[MIN_HTTPD_LIMIT_CLIENTS];
+
+/**
+ * The number of requests, that were shed for the lack of free heap.
+ */
+static uint32_t min_httpd_limit_shed = 0;
+
+/**
+ * Whether the most recent request was shed, so only the first one of a
+ * series is logged.
+ */
+static bool min_httpd_limit_shedding = false;
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static uint32_t min_httpd_limit_client(httpd_req_t* request);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Determine the key of a request's client.
+ *
+ * @param request The request.
+ * @return uint32_t The key (see ::min_httpd_limit_key ), ``0`` if the
+ *                  address is not available.
+ */
+static uint32_t min_httpd_limit_client(httpd_req_t* request) {
+    struct sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
+
+    if (getpeername(httpd_req_to_sockfd(request),
+                    (struct sockaddr*)&peer,
+                    &peer_len) != 0)
+        return 0;
+
+    // Only the address is used, the port changes with every connection
+    if (peer.ss_family == AF_INET) {
+        const struct sockaddr_in* in = (const struct sockaddr_in*)&peer;
+        return min_httpd_limit_key(&in->sin_addr, sizeof(in->sin_addr));
+    }
+#if CONFIG_LWIP_IPV6
+    if (peer.ss_family == AF_INET6) {
+        const struct sockaddr_in6* in6 = (const struct sockaddr_in6*)&peer;
+        return min_httpd_limit_key(&in6->sin6_addr, sizeof(in6->sin6_addr));
+    }
+#endif
+    return 0;
+}
+
+// Documentation in header file!
+bool min_httpd_limit_admit(httpd_req_t* request,
+                           uint32_t cost,
+                           esp_err_t* ret) {
+    if ((MIN_HTTPD_LIMIT_MIN_HEAP > 0) &&
+        (esp_get_free_heap_size() < MIN_HTTPD_LIMIT_MIN_HEAP)) {
+        min_httpd_limit_shed++;
+        obs32_metrics_inc(&min_httpd_metrics_shed);
+        if (!min_httpd_limit_shedding)
+            ESP_LOGW(TAG,
+                     "Free heap below %d bytes, shedding requests!",
+                     MIN_HTTPD_LIMIT_MIN_HEAP);
+        min_httpd_limit_shedding = true;
+
+        httpd_send(request,
+                   min_httpd_limit_response_503,
+                   min_httpd_limit_response_503_len);
+        *ret = ESP_FAIL;
+        return false;
+    }
+    if (min_httpd_limit_shedding)
+        ESP_LOGI(TAG,
+                 "Free heap recovered, %u requests were shed so far",
+                 (unsigned int)min_httpd_limit_shed);
+    min_httpd_limit_shedding = false;
+
+    if (!MIN_HTTPD_LIMIT_ENABLED)
+        return true;
+
+    uint32_t key = min_httpd_limit_client(request);
+    if ((key == 0) ||
+        min_httpd_limit_take(&min_httpd_limit,
+                             key,
+                             cost,
+                             (uint32_t)(esp_timer_get_time() / 1000)))
+        return true;
+
+    ESP_LOGD(TAG, "'%s' - 429", request->uri);
+    obs32_metrics_inc(&min_httpd_metrics_limited);
+    *ret = ESP_OK;
+    if (httpd_send(request,
+                   min_httpd_limit_response_429,
+                   min_httpd_limit_response_429_len) !=
+        (int)min_httpd_limit_response_429_len)
+        *ret = ESP_FAIL;
+    return false;
+}
+
+// Documentation in header file!
+void min_httpd_limit_reset(void) {
+    min_httpd_limit_init(&min_httpd_limit,
+                         min_httpd_limit_buckets,
+                         MIN_HTTPD_LIMIT_CLIENTS,
+                         MIN_HTTPD_LIMIT_RATE,
+                         MIN_HTTPD_LIMIT_BURST);
+    min_httpd_limit_shedding = false;
+}
@@ -0,0 +1,135 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's rate limiting.
+ *
+ * The buckets are an open-addressed hash table with linear probing. Buckets
+ * are replaced, but never removed, so a lookup stops at the first unused
+ * bucket.
+ *
+ * @file   min_httpd_limit_engine.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "min_httpd_limit_engine.h"
+
+/* C's standard libraries. */
+#include <string.h>
+
+
+/* ***** VARIABLES ********************************************************* */
+
+// Documentation in header file!
+const char min_httpd_limit_response_429[] =
+    "HTTP/1.1 429 Too Many Requests\r\n"
+    "Content-Type: text/plain\r\n"
+    "Content-Length: 0\r\n"
+    "Retry-After: 1\r\n"
+    "\r\n";
+
+// Documentation in header file!
+const size_t min_httpd_limit_response_429_len =
+    sizeof(min_httpd_limit_response_429) - 1;
+
+// Documentation in header file!
+const char min_httpd_limit_response_503[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Content-Type: text/plain\r\n"
+    "Content-Length: 0\r\n"
+    "Retry-After: 5\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+// Documentation in header file!
+const size_t min_httpd_limit_response_503_len =
+    sizeof(min_httpd_limit_response_503) - 1;
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+// Documentation in header file!
+uint32_t min_httpd_limit_key(const void* address, size_t len) {
+    // FNV-1a
+    const uint8_t* bytes = address;
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return (hash == 0) ? 1 : hash;
+}
+
+// Documentation in header file!
+void min_httpd_limit_init(struct min_httpd_limit* limit,
+                          struct min_httpd_limit_bucket* storage,
+                          size_t size,
+                          uint32_t rate,
+                          uint32_t burst) {
+    memset(limit, 0, sizeof(*limit));
+    limit->buckets = storage;
+    limit->size = size;
+    limit->rate = rate;
+    limit->burst = burst;
+    memset(storage, 0, size * sizeof(*storage));
+}
+
+// Documentation in header file!
+bool min_httpd_limit_take(struct min_httpd_limit* limit,
+                          uint32_t key,
+                          uint32_t cost,
+                          uint32_t now) {
+    const uint32_t full = limit->burst * MIN_HTTPD_LIMIT_SCALE;
+    struct min_httpd_limit_bucket* bucket = NULL;
+    struct min_httpd_limit_bucket* oldest = NULL;
+
+    if (limit->size == 0)
+        return true;
+
+    for (size_t i = 0; i < limit->size; i++) {
+        struct min_httpd_limit_bucket* candidate =
+            &limit->buckets[(key + i) % limit->size];
+
+        if ((candidate->key == key) || (candidate->key == 0)) {
+            bucket = candidate;
+            break;
+        }
+        if ((oldest == NULL) ||
+            ((uint32_t)(now - candidate->seen) >
+             (uint32_t)(now - oldest->seen)))
+            oldest = candidate;
+    }
+
+    if (bucket == NULL) {
+        bucket = oldest;
+        bucket->key = 0;
+        limit->evicted++;
+    }
+    if (bucket->key == 0) {
+        bucket->key = key;
+        bucket->tokens = full;
+    } else {
+        // The rate is given per second, the tokens in thousandths
+        uint64_t tokens = bucket->tokens +
+                          (uint64_t)(uint32_t)(now - bucket->seen) *
+                              limit->rate * MIN_HTTPD_LIMIT_SCALE / 1000;
+        bucket->tokens = (tokens < full) ? (uint32_t)tokens : full;
+    }
+    bucket->seen = now;
+
+    if (bucket->tokens < cost * MIN_HTTPD_LIMIT_SCALE) {
+        limit->limited++;
+        return false;
+    }
+    bucket->tokens -= cost * MIN_HTTPD_LIMIT_SCALE;
+    limit->admitted++;
+    return true;
+}
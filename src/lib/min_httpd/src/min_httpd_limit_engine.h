@@ -0,0 +1,145 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's rate limiting.
+ *
+ * Every client (by its address) has a *token bucket*: a request takes the
+ * tokens of its route (its *cost*) from the bucket, which is refilled
+ * continuously at a fixed rate up to its *burst*. If the bucket does not
+ * hold enough tokens, the request is refused with a precomputed
+ * ``429 Too Many Requests``, before its handler is executed. The response
+ * has a ``Content-Length``, so the session is kept alive, and refused
+ * requests do not take tokens, so a client is admitted again, as soon as it
+ * slows down.
+ *
+ * The buckets are a small hash table with a fixed number of entries, that
+ * is provided by the caller. If the table is full, the bucket of the client,
+ * that was seen least recently, is replaced; an idle client's bucket is full
+ * anyway. Only a hash of the address is stored, so colliding clients share a
+ * bucket.
+ *
+ * The tokens are stored in thousandths, so the refill does not lose the time
+ * between requests.
+ *
+ * The engine does not lock and does not depend on **ESP-IDF**, so it builds
+ * on a Linux host (see ``tools/min_httpd/limit``). The time is provided by
+ * the caller. The buckets are only used by the server's task (see
+ * min_httpd_limit.c ).
+ *
+ * @file   min_httpd_limit_engine.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_LIMIT_ENGINE_H_
+#define SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_LIMIT_ENGINE_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * The fraction of a token, that is stored in a bucket.
+ */
+#define MIN_HTTPD_LIMIT_SCALE 1000
+
+/**
+ * The precomputed response to requests, that exceed their client's rate.
+ */
+extern const char min_httpd_limit_response_429[];
+
+/**
+ * The length of ::min_httpd_limit_response_429 .
+ */
+extern const size_t min_httpd_limit_response_429_len;
+
+/**
+ * The precomputed response to requests, that are shed for the lack of free
+ * heap.
+ *
+ * The session is closed, so its buffers are released.
+ */
+extern const char min_httpd_limit_response_503[];
+
+/**
+ * The length of ::min_httpd_limit_response_503 .
+ */
+extern const size_t min_httpd_limit_response_503_len;
+
+/**
+ * The bucket of a client.
+ */
+struct min_httpd_limit_bucket {
+    uint32_t key;     // the hash of the address, ``0`` marks an unused bucket
+    uint32_t tokens;  // given in ::MIN_HTTPD_LIMIT_SCALE of a token
+    uint32_t seen;    // the time of the most recent request, in milliseconds
+};
+
+/**
+ * The buckets of all clients.
+ *
+ * The storage of the buckets is provided by the caller, see
+ * ::min_httpd_limit_init .
+ */
+struct min_httpd_limit {
+    struct min_httpd_limit_bucket* buckets;
+    size_t size;
+    uint32_t rate;   // tokens per second
+    uint32_t burst;  // tokens of a full bucket
+
+    uint32_t admitted;  // requests, that took their tokens
+    uint32_t limited;   // requests, that were refused
+    uint32_t evicted;   // buckets, that were replaced by another client's
+};
+
+
+/**
+ * Hash the address of a client.
+ *
+ * @param address The address (e.g. the four bytes of an IPv4 address).
+ * @param len     The length of ``address``.
+ * @return uint32_t The hash, never ``0``.
+ */
+uint32_t min_httpd_limit_key(const void* address, size_t len);
+
+/**
+ * Initialize the buckets.
+ *
+ * This forgets all clients.
+ *
+ * @param limit   The buckets to be initialized.
+ * @param storage The storage of the buckets.
+ * @param size    The number of entries of ``storage``.
+ * @param rate    The tokens, that are added to a bucket per second.
+ * @param burst   The tokens of a full bucket.
+ */
+void min_httpd_limit_init(struct min_httpd_limit* limit,
+                          struct min_httpd_limit_bucket* storage,
+                          size_t size,
+                          uint32_t rate,
+                          uint32_t burst);
+
+/**
+ * Take the tokens of a request from its client's bucket.
+ *
+ * A client, that is not known yet, starts with a full bucket.
+ *
+ * @param limit The buckets.
+ * @param key   The client's key (see ::min_httpd_limit_key ).
+ * @param cost  The tokens of the request.
+ * @param now   The current time, in milliseconds. It may wrap around.
+ * @return bool ``true`` if the request is admitted, ``false`` if the bucket
+ *              does not hold ``cost`` tokens (the tokens are not taken).
+ */
+bool min_httpd_limit_take(struct min_httpd_limit* limit,
+                          uint32_t key,
+                          uint32_t cost,
+                          uint32_t now);
+
+#endif  // SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_LIMIT_ENGINE_H_
@@ -0,0 +1,360 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The metrics of the ``min_httpd`` component and their endpoint.
+ *
+ * The component's own metrics (requests, handler durations, refused
+ * requests, sessions and the subscribers of the push channels) are a group of
+ * the metrics registry of ``obs32`` (see ``obs32/obs32_metrics.h``), that is
+ * registered with the first server. The storage of the values is provided to
+ * the component's modules with min_httpd_internal.h .
+ *
+ * All registered groups are provided at ::MIN_HTTPD_METRICS_URI in the
+ * Prometheus text format. The response is rendered into a buffer of
+ * ::MIN_HTTPD_METRICS_CHUNK_LEN bytes, which is sent with
+ * ``httpd_resp_send_chunk()`` whenever it is full. Every scrape is timed; a
+ * scrape, that arrives before the previous one is paid off by
+ * ::MIN_HTTPD_METRICS_CPU_BUDGET , is answered with a precomputed
+ * ``429 Too Many Requests``. Only the rendering is charged to the budget: the
+ * time, that ``httpd_resp_send_chunk()`` blocks on a slow client, is
+ * subtracted, as the server's task does not use the CPU meanwhile.
+ *
+ * @file   min_httpd_metrics.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Other headers of the component. */
+#include "min_httpd/min_httpd.h"     // The public header
+#include "min_httpd_internal.h"      // modules of the component
+#include "min_httpd_limit_engine.h"  // the precomputed 429
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* This is EPS-IDF's http server library. */
+#include "esp_http_server.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* This is ESP-IDF's high resolution timer library.
+ * - provides the time of the scrapes (``esp_timer_get_time()``)
+ */
+#include "esp_timer.h"
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A scrape, that is passed to ::min_httpd_metrics_send_chunk .
+ */
+struct min_httpd_metrics_scrape {
+    httpd_req_t* request;
+    int64_t send_us;  // the time spent in ``httpd_resp_send_chunk()``
+};
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static bool min_httpd_metrics_send_chunk(void* ctx,
+                                         const char* data,
+                                         size_t len);
+static esp_err_t min_httpd_metrics_handler(httpd_req_t* request);
+static int64_t min_httpd_metrics_read_ws(void);
+static int64_t min_httpd_metrics_read_sse(void);
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "krachkiste.httpd.metrics";
+
+/**
+ * The upper bounds of the handlers' durations, in microseconds.
+ */
+static const uint32_t min_httpd_metrics_handler_bounds[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000,
+    1000000};
+
+/**
+ * The upper bounds of the scrapes' durations, in microseconds.
+ */
+static const uint32_t min_httpd_metrics_scrape_bounds[] = {
+    250, 500, 1000, 2500, 5000, 10000, 25000, 50000};
+
+// Documentation in min_httpd_internal.h!
+struct obs32_metric_counter min_httpd_metrics_inline = {0};
+struct obs32_metric_counter min_httpd_metrics_offloaded = {0};
+struct obs32_metric_counter min_httpd_metrics_assets = {0};
+struct obs32_metric_counter min_httpd_metrics_captive = {0};
+struct obs32_metric_counter min_httpd_metrics_misses = {0};
+struct obs32_metric_counter min_httpd_metrics_limited = {0};
+struct obs32_metric_counter min_httpd_metrics_shed = {0};
+struct obs32_metric_gauge min_httpd_metrics_sessions = {0};
+struct obs32_metric_histogram min_httpd_metrics_inline_us =
+    OBS32_METRICS_HISTOGRAM(min_httpd_metrics_handler_bounds);
+struct obs32_metric_histogram min_httpd_metrics_offloaded_us =
+    OBS32_METRICS_HISTOGRAM(min_httpd_metrics_handler_bounds);
+
+/**
+ * The number of scrapes, that were served.
+ */
+static struct obs32_metric_counter min_httpd_metrics_served = {0};
+
+/**
+ * The number of scrapes, that were refused to keep the CPU budget.
+ */
+static struct obs32_metric_counter min_httpd_metrics_refused = {0};
+
+/**
+ * The rendering times of the scrapes, without sending the chunks.
+ */
+static struct obs32_metric_histogram min_httpd_metrics_scrape_us =
+    OBS32_METRICS_HISTOGRAM(min_httpd_metrics_scrape_bounds);
+
+/**
+ * The start of the previous scrape, in microseconds.
+ *
+ * This and ::min_httpd_metrics_last_us are only accessed from the server's
+ * task.
+ */
+static int64_t min_httpd_metrics_last_start = 0;
+
+/**
+ * The time, that the previous scrape spent rendering, in microseconds.
+ *
+ * This excludes sending the chunks and is charged to
+ * ::MIN_HTTPD_METRICS_CPU_BUDGET .
+ */
+static int64_t min_httpd_metrics_last_us = 0;
+
+/**
+ * The metrics of the component.
+ */
+static const struct obs32_metric min_httpd_metrics_table[] = {
+    {.name = "min_httpd_requests_total",
+     .help = "Requests, that were admitted, by their route.",
+     .labels = "route=\"inline\"",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &min_httpd_metrics_inline},
+    {.name = "min_httpd_requests_total",
+     .labels = "route=\"offloaded\"",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &min_httpd_metrics_offloaded},
+    {.name = "min_httpd_requests_total",
+     .labels = "route=\"asset\"",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &min_httpd_metrics_assets},
+    {.name = "min_httpd_requests_total",
+     .labels = "route=\"captive\"",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &min_httpd_metrics_captive},
+    {.name = "min_httpd_requests_total",
+     .labels = "route=\"miss\"",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &min_httpd_metrics_misses},
+    {.name = "min_httpd_handler_duration_us",
+     .help = "The duration of the routes' handlers in microseconds.",
+     .labels = "route=\"inline\"",
+     .type = OBS32_METRIC_HISTOGRAM,
+     .histogram = &min_httpd_metrics_inline_us},
+    {.name = "min_httpd_handler_duration_us",
+     .labels = "route=\"offloaded\"",
+     .type = OBS32_METRIC_HISTOGRAM,
+     .histogram = &min_httpd_metrics_offloaded_us},
+    {.name = "min_httpd_rejected_total",
+     .help = "Requests, that were refused before their handler.",
+     .labels = "reason=\"rate\"",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &min_httpd_metrics_limited},
+    {.name = "min_httpd_rejected_total",
+     .labels = "reason=\"heap\"",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &min_httpd_metrics_shed},
+    {.name = "min_httpd_sessions",
+     .help = "Open sessions.",
+     .type = OBS32_METRIC_GAUGE,
+     .gauge = &min_httpd_metrics_sessions},
+    {.name = "min_httpd_ws_subscribers",
+     .help = "Subscribers of the WebSocket push channel.",
+     .type = OBS32_METRIC_GAUGE,
+     .read = min_httpd_metrics_read_ws},
+    {.name = "min_httpd_sse_clients",
+     .help = "Clients of the Server-Sent Events stream.",
+     .type = OBS32_METRIC_GAUGE,
+     .read = min_httpd_metrics_read_sse},
+    {.name = "min_httpd_metrics_scrapes_total",
+     .help = "Scrapes of the metrics.",
+     .labels = "result=\"served\"",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &min_httpd_metrics_served},
+    {.name = "min_httpd_metrics_scrapes_total",
+     .labels = "result=\"refused\"",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &min_httpd_metrics_refused},
+    {.name = "min_httpd_metrics_scrape_duration_us",
+     .help = "The rendering time of the scrapes in microseconds.",
+     .type = OBS32_METRIC_HISTOGRAM,
+     .histogram = &min_httpd_metrics_scrape_us},
+};
+
+/**
+ * The group of ::min_httpd_metrics_table .
+ */
+static struct obs32_metrics_group min_httpd_metrics_group = {
+    .metrics = min_httpd_metrics_table,
+    .count = sizeof(min_httpd_metrics_table) /
+             sizeof(min_httpd_metrics_table[0]),
+};
+
+
+/* ***** URI DEFINITIONS *************************************************** */
+
+/**
+ * Route definition for the metrics.
+ */
+static const struct min_httpd_route min_httpd_metrics_route = {
+    .uri = MIN_HTTPD_METRICS_URI,
+    .method = HTTP_GET,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = min_httpd_metrics_handler,
+    .user_ctx = NULL,
+    .cost = MIN_HTTPD_LIMIT_COST_INLINE};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Read the number of subscribers of the WebSocket push channel.
+ *
+ * @return int64_t The number of subscribers.
+ */
+static int64_t min_httpd_metrics_read_ws(void) {
+    return (int64_t)min_httpd_ws_get_subscribers();
+}
+
+/**
+ * Read the number of clients of the Server-Sent Events stream.
+ *
+ * @return int64_t The number of clients.
+ */
+static int64_t min_httpd_metrics_read_sse(void) {
+    return (int64_t)min_httpd_sse_get_clients();
+}
+
+/**
+ * Send a full chunk of the metrics.
+ *
+ * This is the registry's emit function. The time of sending is accounted to
+ * the scrape, so it is not charged to ::MIN_HTTPD_METRICS_CPU_BUDGET .
+ *
+ * @param ctx  The scrape (::min_httpd_metrics_scrape ).
+ * @param data The chunk.
+ * @param len  The length of ``data``.
+ * @return bool ``true`` if the chunk was sent.
+ */
+static bool min_httpd_metrics_send_chunk(void* ctx,
+                                         const char* data,
+                                         size_t len) {
+    struct min_httpd_metrics_scrape* scrape = ctx;
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = httpd_resp_send_chunk(scrape->request, data, len);
+    scrape->send_us += esp_timer_get_time() - start;
+    return ret == ESP_OK;
+}
+
+/**
+ * Provide the registered metrics.
+ *
+ * The matching *route definition* is ::min_httpd_metrics_route .
+ *
+ * The rendering of the previous scrape must be paid off by
+ * ::MIN_HTTPD_METRICS_CPU_BUDGET , otherwise the request is answered with
+ * ``429 Too Many Requests``.
+ *
+ * @param request The request that should be responded to with this function.
+ * @return esp_err_t ``ESP_OK`` if the response was sent, ``ESP_FAIL``
+ *                   otherwise, causing the session to be closed.
+ */
+static esp_err_t min_httpd_metrics_handler(httpd_req_t* request) {
+    int64_t start = esp_timer_get_time();
+    if ((min_httpd_metrics_last_us > 0) &&
+        ((start - min_httpd_metrics_last_start) <
+         (min_httpd_metrics_last_us * 100 / MIN_HTTPD_METRICS_CPU_BUDGET))) {
+        ESP_LOGD(TAG,
+                 "Scrape refused, the previous one rendered for %" PRId64 "us",
+                 min_httpd_metrics_last_us);
+        obs32_metrics_inc(&min_httpd_metrics_refused);
+        if (httpd_send(request,
+                       min_httpd_limit_response_429,
+                       min_httpd_limit_response_429_len) !=
+            (int)min_httpd_limit_response_429_len)
+            return ESP_FAIL;
+        return ESP_OK;
+    }
+
+    uint16_t sockfd = (uint16_t)httpd_req_to_sockfd(request);
+    obs32_trace_begin(&min_httpd_trace_group,
+                      MIN_HTTPD_TRACE_POINT_METRICS,
+                      sockfd);
+
+    char chunk[MIN_HTTPD_METRICS_CHUNK_LEN];
+    struct min_httpd_metrics_scrape scrape = {.request = request};
+    httpd_resp_set_type(request, "text/plain; version=0.0.4; charset=utf-8");
+    httpd_resp_set_hdr(request, "Cache-Control", "no-store");
+
+    // The response is incomplete, so the session must be closed
+    esp_err_t ret = ESP_FAIL;
+    if (obs32_metrics_render(chunk,
+                             sizeof(chunk),
+                             min_httpd_metrics_send_chunk,
+                             &scrape) &&
+        min_httpd_metrics_send_chunk(&scrape, NULL, 0))
+        ret = ESP_OK;
+
+    min_httpd_metrics_last_start = start;
+    min_httpd_metrics_last_us =
+        esp_timer_get_time() - start - scrape.send_us;
+    obs32_metrics_inc(&min_httpd_metrics_served);
+    obs32_metrics_observe(&min_httpd_metrics_scrape_us,
+                          (uint32_t)min_httpd_metrics_last_us);
+    obs32_trace_end(&min_httpd_trace_group,
+                    MIN_HTTPD_TRACE_POINT_METRICS,
+                    sockfd);
+    return ret;
+}
+
+// Documentation in min_httpd_internal.h!
+void min_httpd_metrics_attach(httpd_handle_t server) {
+    obs32_metrics_register(&min_httpd_metrics_group);
+
+    if (!MIN_HTTPD_METRICS_ENABLED)
+        return;
+
+    if (min_httpd_register_route(server, &min_httpd_metrics_route) != ESP_OK)
+        ESP_LOGE(TAG, "Could not register the metrics!");
+}
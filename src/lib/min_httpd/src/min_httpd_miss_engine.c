@@ -0,0 +1,151 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's responses to missing resources.
+ *
+ * The cache is small, so it is searched linearly. The hashes are compared
+ * first, the paths only on a match. The learned paths are replaced in the
+ * order, in which they were learned.
+ *
+ * @file   min_httpd_miss_engine.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "min_httpd_miss_engine.h"
+
+/* C's standard libraries. */
+#include <string.h>
+
+
+/* ***** VARIABLES ********************************************************* */
+
+// Documentation in header file!
+// The ``Content-Length`` must match the body (``Not Found``).
+const char min_httpd_miss_response[] =
+    "HTTP/1.1 404 Not Found\r\n"
+    "Content-Type: text/plain\r\n"
+    "Content-Length: 9\r\n"
+    "\r\n"
+    "Not Found";
+
+// Documentation in header file!
+const size_t min_httpd_miss_response_len = sizeof(min_httpd_miss_response) - 1;
+
+/**
+ * The paths, that are requested by browsers without a reference in the
+ * served documents.
+ */
+static const char* const min_httpd_miss_probes[MIN_HTTPD_MISS_PROBES] = {
+    "/apple-touch-icon.png",              // Safari
+    "/apple-touch-icon-precomposed.png",  // Safari (legacy)
+    "/robots.txt",                        // crawlers
+    "/favicon.png",                       // several browsers
+    "/manifest.json",                     // progressive web apps
+    "/browserconfig.xml",                 // Edge (legacy)
+    "/sitemap.xml",                       // crawlers
+    "/.well-known/security.txt",          // scanners
+};
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static bool min_httpd_miss_path_equal(const char* path,
+                                      const char* uri,
+                                      size_t len);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Compare a path to the path of a request.
+ *
+ * @param path The path.
+ * @param uri  The URI of the request.
+ * @param len  The length of the path of ``uri`` (without the query).
+ * @return bool ``true`` if the paths are equal.
+ */
+static bool min_httpd_miss_path_equal(const char* path,
+                                      const char* uri,
+                                      size_t len) {
+    return (strncmp(path, uri, len) == 0) && (path[len] == '\0');
+}
+
+// Documentation in header file!
+uint32_t min_httpd_miss_hash(const char* uri) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+
+    for (; (*uri != '\0') && (*uri != '?'); uri++) {
+        hash ^= (uint8_t)*uri;
+        hash *= 16777619u;
+    }
+    return (hash == 0) ? 1 : hash;
+}
+
+// Documentation in header file!
+void min_httpd_miss_cache_init(struct min_httpd_miss_cache* cache,
+                               struct min_httpd_miss_entry* storage,
+                               size_t size,
+                               min_httpd_miss_served_t served) {
+    memset(cache, 0, sizeof(*cache));
+    cache->learned = storage;
+    cache->size = size;
+    cache->served = served;
+    memset(storage, 0, size * sizeof(*storage));
+
+    for (size_t i = 0; i < MIN_HTTPD_MISS_PROBES; i++) {
+        if ((served == NULL) || !served(min_httpd_miss_probes[i]))
+            cache->probes[i] = min_httpd_miss_hash(min_httpd_miss_probes[i]);
+    }
+}
+
+// Documentation in header file!
+bool min_httpd_miss_cache_lookup(struct min_httpd_miss_cache* cache,
+                                 const char* uri) {
+    uint32_t hash = min_httpd_miss_hash(uri);
+    size_t len = strcspn(uri, "?");
+
+    for (size_t i = 0; i < MIN_HTTPD_MISS_PROBES; i++) {
+        if ((cache->probes[i] == hash) &&
+            min_httpd_miss_path_equal(min_httpd_miss_probes[i], uri, len)) {
+            cache->hits++;
+            return true;
+        }
+    }
+
+    for (size_t i = 0; i < cache->size; i++) {
+        if ((cache->learned[i].hash == hash) &&
+            min_httpd_miss_path_equal(cache->learned[i].path, uri, len)) {
+            cache->hits++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Documentation in header file!
+void min_httpd_miss_cache_learn(struct min_httpd_miss_cache* cache,
+                                const char* uri) {
+    size_t len = strcspn(uri, "?");
+
+    cache->misses++;
+    if ((cache->size == 0) || (len > MIN_HTTPD_MISS_PATH_LEN))
+        return;
+    if ((cache->served != NULL) && cache->served(uri))
+        return;
+
+    struct min_httpd_miss_entry* entry = &cache->learned[cache->next];
+    entry->hash = min_httpd_miss_hash(uri);
+    memcpy(entry->path, uri, len);
+    entry->path[len] = '\0';
+    cache->next = (cache->next + 1) % cache->size;
+}
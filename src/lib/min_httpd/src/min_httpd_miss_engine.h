@@ -0,0 +1,153 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's responses to missing resources.
+ *
+ * Requests, that can not be matched to a *URI handler*, are answered with a
+ * precomputed ``404 Not Found``. The response has a ``Content-Length``, so
+ * the session is kept alive: browsers probe for several resources (e.g.
+ * ``/apple-touch-icon.png`` or ``/robots.txt``), and closing the session
+ * after every probe forces a new TCP handshake on the access point's link.
+ *
+ * The paths of missing resources are remembered in a *negative cache*. It is
+ * looked up before the packed assets and the captive portal, so a repeated
+ * probe is answered right away and is not logged again. Logging is slow (the
+ * log is written to the UART by the server's task), while the response is
+ * the same anyway. Common probes are known in advance and never evicted.
+ *
+ * A hit short-circuits the other fallbacks, so it must never shadow a path,
+ * that is served:
+ *   - the paths are stored (not just their hashes), so a hit is exact; longer
+ *     paths than ::MIN_HTTPD_MISS_PATH_LEN are not learned;
+ *   - paths, that are served (see ::min_httpd_miss_served_t ), are neither
+ *     learned nor answered as common probes, as they may still miss (e.g. a
+ *     ``POST`` of an asset), which must not shadow their ``GET``.
+ *
+ * The engine does not lock and does not depend on **ESP-IDF**, so it builds
+ * on a Linux host (see ``tools/min_httpd/miss``). The cache is only used by
+ * the server's task (see min_httpd.c ).
+ *
+ * @file   min_httpd_miss_engine.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_MISS_ENGINE_H_
+#define SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_MISS_ENGINE_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * The number of common probes, that are known in advance.
+ */
+#define MIN_HTTPD_MISS_PROBES 8
+
+/**
+ * The maximum length of a learned path (without the query).
+ */
+#define MIN_HTTPD_MISS_PATH_LEN 48
+
+/**
+ * The precomputed response to requests of missing resources.
+ */
+extern const char min_httpd_miss_response[];
+
+/**
+ * The length of ::min_httpd_miss_response .
+ */
+extern const size_t min_httpd_miss_response_len;
+
+/**
+ * Check, if a path is served by the server.
+ *
+ * @param uri The URI of a request, the query is ignored.
+ * @return bool ``true`` if the path must never be answered from the cache.
+ */
+typedef bool (*min_httpd_miss_served_t)(const char* uri);
+
+/**
+ * A learned path.
+ */
+struct min_httpd_miss_entry {
+    uint32_t hash;  // ``0`` marks an unused entry
+    char path[MIN_HTTPD_MISS_PATH_LEN + 1];
+};
+
+/**
+ * The negative cache.
+ *
+ * The storage of the learned paths is provided by the caller, see
+ * ::min_httpd_miss_cache_init .
+ */
+struct min_httpd_miss_cache {
+    uint32_t probes[MIN_HTTPD_MISS_PROBES];  // ``0`` marks a served probe
+    struct min_httpd_miss_entry* learned;
+    size_t size;
+    size_t next;                             // the oldest learned path
+    min_httpd_miss_served_t served;
+
+    uint32_t hits;    // requests, that were answered from the cache
+    uint32_t misses;  // requests, that were learned
+};
+
+/**
+ * Hash the path of a request.
+ *
+ * The query is ignored.
+ *
+ * @param uri The URI of the request.
+ * @return uint32_t The hash, never ``0``.
+ */
+uint32_t min_httpd_miss_hash(const char* uri);
+
+/**
+ * Initialize the negative cache.
+ *
+ * This drops all learned paths. Common probes, that are served, are dropped
+ * as well.
+ *
+ * @param cache   The cache to be initialized.
+ * @param storage The storage of the learned paths.
+ * @param size    The number of entries of ``storage``.
+ * @param served  The check of the served paths, may be ``NULL``.
+ */
+void min_httpd_miss_cache_init(struct min_httpd_miss_cache* cache,
+                               struct min_httpd_miss_entry* storage,
+                               size_t size,
+                               min_httpd_miss_served_t served);
+
+/**
+ * Look up the path of a request.
+ *
+ * This is done before any other fallback, so a hit is answered with
+ * ::min_httpd_miss_response right away.
+ *
+ * @param cache The cache.
+ * @param uri   The URI of the request.
+ * @return bool ``true`` if the path is a known missing resource.
+ */
+bool min_httpd_miss_cache_lookup(struct min_httpd_miss_cache* cache,
+                                 const char* uri);
+
+/**
+ * Learn the path of a request of a missing resource.
+ *
+ * This is done after all other fallbacks missed. The oldest learned path is
+ * replaced, if the cache is full. Paths, that are served or too long, are not
+ * learned.
+ *
+ * @param cache The cache.
+ * @param uri   The URI of the request.
+ */
+void min_httpd_miss_cache_learn(struct min_httpd_miss_cache* cache,
+                                const char* uri);
+
+#endif  // SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_MISS_ENGINE_H_
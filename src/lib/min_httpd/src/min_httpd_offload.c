@@ -0,0 +1,671 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Routes of the ``min_httpd`` component, that are processed inline or
+ * offloaded to worker tasks.
+ *
+ * All *URI handlers* of the server are registered as routes (see
+ * ::min_httpd_register_route ), so every request is admitted by
+ * ::min_httpd_offload_admit , before the route's handler is executed. The
+ * handler of missing resources uses it as well.
+ *
+ * ``esp_http_server`` processes all requests with a single task, so a
+ * handler, that blocks (e.g. writing to the NVS), stalls the requests of all
+ * other clients. Offloaded routes are processed like this:
+ *
+ *   1. the server's task receives the request's body into a *job* and hands
+ *      it to the workers' queue, then it continues with other requests; the
+ *      session stays open without a response;
+ *   2. a worker task executes the route's handler, which responds with
+ *      ::min_httpd_job_respond ;
+ *   3. the response is sent by the server's task (queued with
+ *      ::min_httpd_queue_work ), so the session's socket is never used by two
+ *      tasks at a time; then the session is closed.
+ *
+ * The session is not held while the job is pending, so the server's task
+ * would answer a pipelined request before. Instead, the response closes the
+ * session (``Connection: close``), and further requests of the session are
+ * refused by ::min_httpd_offload_admit , whatever their route (closing the
+ * session and discarding the pending response), so a client never receives
+ * the responses out of order.
+ * Browsers do not pipeline, and the routes are mostly non-idempotent forms,
+ * that clients must not pipeline anyway (RFC 9112, section 9.3.2).
+ *
+ * If the session is closed meanwhile, the job is orphaned and its response is
+ * discarded (see min_httpd_offload_engine.c ).
+ *
+ * The pending jobs are only accessed from the server's task, so they are not
+ * locked.
+ *
+ * Requests do not allocate from the heap. Every job is a statically allocated
+ * slot with an arena (see min_httpd_arena.h ), that holds the URI, the body
+ * and the response. The slots are released by the server's task or by a
+ * worker, so they are guarded by ::min_httpd_offload_lock . The requests of
+ * inline routes share a single arena, as the server's task processes one
+ * request at a time; it is reset, after the route's handler returned.
+ *
+ * @file   min_httpd_offload.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Other headers of the component. */
+#include "min_httpd/min_httpd.h"       // The public header
+#include "min_httpd_internal.h"        // modules of the component
+#include "min_httpd_offload_engine.h"  // pending jobs and responses
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* This is EPS-IDF's http server library. */
+#include "esp_http_server.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* This is ESP-IDF's high resolution timer library.
+ * - provides the durations of the handlers (``esp_timer_get_time()``)
+ */
+#include "esp_timer.h"
+
+/* FreeRTOS headers.
+ * - the ``FreeRTOS.h`` is required
+ * - ``queue.h`` provides the workers' queue
+ * - ``task.h`` provides the worker tasks
+ */
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The maximum number of pending jobs.
+ *
+ * Every worker processes one job, further jobs wait in the queue.
+ */
+#define MIN_HTTPD_OFFLOAD_MAX_JOBS \
+    (MIN_HTTPD_WORKERS + MIN_HTTPD_OFFLOAD_QUEUE_LEN)
+
+/**
+ * The maximum length of the head of a response.
+ */
+#define MIN_HTTPD_OFFLOAD_HEAD_LEN 160
+
+/**
+ * The core of the worker tasks, as expected by ``xTaskCreatePinnedToCore()``.
+ */
+#if MIN_HTTPD_WORKER_CORE < 0
+#define MIN_HTTPD_OFFLOAD_CORE tskNO_AFFINITY
+#else
+#define MIN_HTTPD_OFFLOAD_CORE MIN_HTTPD_WORKER_CORE
+#endif
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A job, that is processed by a worker task.
+ *
+ * The request's URI, body and response are allocated from ``arena``. The
+ * members besides ``used`` are only accessed by the server's task and the
+ * worker, that owns the job at a time.
+ */
+struct min_httpd_offload_job {
+    struct min_httpd_job job;  // must be the first member
+    const struct min_httpd_route* route;
+    const char* response;
+    size_t response_len;
+    bool used;  // guarded by ::min_httpd_offload_lock
+    struct min_httpd_arena arena;
+    uint8_t storage[MIN_HTTPD_ARENA_LEN];
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "krachkiste.httpd.offload";
+
+/**
+ * The response of jobs, whose handler failed or did not respond.
+ *
+ * This is not allocated from the job's arena, as the handler might have
+ * exhausted it.
+ */
+static const char min_httpd_offload_response_500[] =
+    "HTTP/1.1 500 Internal Server Error\r\n"
+    "Content-Type: text/plain\r\n"
+    "Content-Length: 0\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+/**
+ * The slots of the jobs.
+ */
+static struct min_httpd_offload_job
+    min_httpd_offload_jobs[MIN_HTTPD_OFFLOAD_MAX_JOBS];
+
+/**
+ * Guard the ``used`` flags of ::min_httpd_offload_jobs .
+ */
+static portMUX_TYPE min_httpd_offload_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * The arena of the requests of inline routes, only accessed from the
+ * server's task.
+ */
+static struct min_httpd_arena min_httpd_offload_arena;
+
+/**
+ * The storage of ::min_httpd_offload_arena .
+ */
+static uint8_t min_httpd_offload_arena_storage[MIN_HTTPD_ARENA_LEN];
+
+/**
+ * The request, that ::min_httpd_offload_arena is provided to, ``NULL``
+ * between requests.
+ */
+static httpd_req_t* min_httpd_offload_arena_request = NULL;
+
+/**
+ * The storage of ::min_httpd_offload_pending_jobs .
+ */
+static struct min_httpd_offload_entry
+    min_httpd_offload_storage[MIN_HTTPD_OFFLOAD_MAX_JOBS];
+
+/**
+ * The pending jobs, only accessed from the server's task.
+ */
+static struct min_httpd_offload_pending min_httpd_offload_pending_jobs = {0};
+
+/**
+ * The queue of the worker tasks.
+ *
+ * The queue and the workers are created with the first server and persist,
+ * so jobs of a stopped server are finished (and discarded) by the workers.
+ */
+static QueueHandle_t min_httpd_offload_queue = NULL;
+
+/**
+ * The server, only accessed from the server's task.
+ */
+static httpd_handle_t min_httpd_offload_server = NULL;
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static void min_httpd_offload_complete(void* arg);
+static esp_err_t min_httpd_offload_handler(httpd_req_t* request);
+static esp_err_t min_httpd_offload_inline_handler(httpd_req_t* request);
+static struct min_httpd_offload_job* min_httpd_offload_job_acquire(void);
+static void min_httpd_offload_job_release(struct min_httpd_offload_job* job);
+static void min_httpd_offload_run(struct min_httpd_offload_job* job);
+static void min_httpd_offload_worker(void* arg);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Take an unused job slot.
+ *
+ * The slot's arena is reset.
+ *
+ * @return struct min_httpd_offload_job* The job, ``NULL`` if all slots are
+ *                                       used.
+ */
+static struct min_httpd_offload_job* min_httpd_offload_job_acquire(void) {
+    struct min_httpd_offload_job* job = NULL;
+
+    portENTER_CRITICAL(&min_httpd_offload_lock);
+    for (size_t i = 0; i < MIN_HTTPD_OFFLOAD_MAX_JOBS; i++) {
+        if (!min_httpd_offload_jobs[i].used) {
+            job = &min_httpd_offload_jobs[i];
+            job->used = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&min_httpd_offload_lock);
+
+    if (job == NULL)
+        return NULL;
+
+    min_httpd_arena_init(&job->arena, job->storage, sizeof(job->storage));
+    memset(&job->job, 0, sizeof(job->job));
+    job->job.arena = &job->arena;
+    job->response = NULL;
+    job->response_len = 0;
+    return job;
+}
+
+/**
+ * Return a job's slot.
+ *
+ * This may be called from the server's task and from the workers.
+ *
+ * @param job The job.
+ */
+static void min_httpd_offload_job_release(struct min_httpd_offload_job* job) {
+    portENTER_CRITICAL(&min_httpd_offload_lock);
+    job->used = false;
+    portEXIT_CRITICAL(&min_httpd_offload_lock);
+}
+
+/**
+ * Execute the handler of a job's route.
+ *
+ * If the handler fails or does not respond, ``500 Internal Server Error`` is
+ * sent.
+ *
+ * @param job The job.
+ */
+static void min_httpd_offload_run(struct min_httpd_offload_job* job) {
+    uint16_t slot = (uint16_t)(job - min_httpd_offload_jobs);
+
+    obs32_trace_begin(&min_httpd_trace_group,
+                      MIN_HTTPD_TRACE_POINT_OFFLOAD_RUN,
+                      slot);
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = job->route->job_handler(&job->job);
+    obs32_metrics_observe(&min_httpd_metrics_offloaded_us,
+                          (uint32_t)(esp_timer_get_time() - start));
+    obs32_trace_end(&min_httpd_trace_group,
+                    MIN_HTTPD_TRACE_POINT_OFFLOAD_RUN,
+                    slot);
+
+    if (job->arena.failures > 0)
+        ESP_LOGW(TAG,
+                 "'%s' exceeded the budget of %d bytes",
+                 job->job.uri,
+                 MIN_HTTPD_ARENA_LEN);
+
+    if ((ret != ESP_OK) || (job->response == NULL)) {
+        job->response = min_httpd_offload_response_500;
+        job->response_len = sizeof(min_httpd_offload_response_500) - 1;
+    }
+}
+
+/**
+ * Send the response of a finished job and release the job.
+ *
+ * This is queued with ::min_httpd_queue_work and runs in the server's task.
+ * The session is closed afterwards, as announced by the response's
+ * ``Connection: close``.
+ *
+ * @param arg The job (::min_httpd_offload_job ).
+ */
+static void min_httpd_offload_complete(void* arg) {
+    struct min_httpd_offload_job* job = arg;
+    uint16_t slot = (uint16_t)(job - min_httpd_offload_jobs);
+
+    obs32_trace_begin(&min_httpd_trace_group,
+                      MIN_HTTPD_TRACE_POINT_OFFLOAD_COMPLETE,
+                      slot);
+
+    int sockfd =
+        min_httpd_offload_pending_remove(&min_httpd_offload_pending_jobs, job);
+    if ((sockfd >= 0) && (job->response != NULL)) {
+        size_t off = 0;
+        while (off < job->response_len) {
+            int ret = httpd_socket_send(min_httpd_offload_server,
+                                        sockfd,
+                                        job->response + off,
+                                        job->response_len - off,
+                                        0);
+            if (ret <= 0)
+                break;
+            off += ret;
+        }
+        ESP_LOGD(TAG, "Closing session %d", sockfd);
+        httpd_sess_trigger_close(min_httpd_offload_server, sockfd);
+    } else {
+        ESP_LOGD(TAG, "Discarding response of '%s'", job->job.uri);
+    }
+
+    min_httpd_offload_job_release(job);
+    obs32_trace_end(&min_httpd_trace_group,
+                    MIN_HTTPD_TRACE_POINT_OFFLOAD_COMPLETE,
+                    slot);
+}
+
+/**
+ * The task of a worker.
+ *
+ * @param arg Unused.
+ */
+static void min_httpd_offload_worker(void* arg) {
+    struct min_httpd_offload_job* job;
+
+    for (;;) {
+        if (xQueueReceive(min_httpd_offload_queue, &job, portMAX_DELAY) !=
+            pdTRUE)
+            continue;
+
+        min_httpd_offload_run(job);
+
+        // The server might be stopped meanwhile
+        if (min_httpd_queue_work(min_httpd_offload_complete, job) != ESP_OK)
+            min_httpd_offload_job_release(job);
+    }
+}
+
+/**
+ * The handler of all offloaded routes.
+ *
+ * The request is admitted (see ::min_httpd_offload_admit ), received
+ * completely and handed to the workers as a job. The handler returns
+ * without a response, so the session stays open.
+ *
+ * @param request The request. ``user_ctx`` is the route.
+ * @return ``ESP_OK`` to keep the session open, ``ESP_FAIL`` to close it.
+ */
+static esp_err_t min_httpd_offload_handler(httpd_req_t* request) {
+    const struct min_httpd_route* route = request->user_ctx;
+
+    esp_err_t ret;
+    if (!min_httpd_offload_admit(request, route->cost, &ret))
+        return ret;
+    obs32_metrics_inc(&min_httpd_metrics_offloaded);
+
+    if (request->content_len > MIN_HTTPD_OFFLOAD_MAX_BODY) {
+        httpd_resp_set_status(request, "413 Payload Too Large");
+        httpd_resp_send(request, NULL, 0);
+        min_httpd_log_message(request, ESP_FAIL);
+        return ESP_FAIL;
+    }
+    if (min_httpd_offload_pending_jobs.count >= MIN_HTTPD_OFFLOAD_MAX_JOBS) {
+        httpd_resp_set_status(request, "503 Service Unavailable");
+        httpd_resp_send(request, NULL, 0);
+        min_httpd_log_message(request, ESP_FAIL);
+        return ESP_OK;
+    }
+
+    // Jobs of a stopped server may still occupy the slots
+    struct min_httpd_offload_job* job = min_httpd_offload_job_acquire();
+    if (job == NULL) {
+        httpd_resp_set_status(request, "503 Service Unavailable");
+        httpd_resp_send(request, NULL, 0);
+        min_httpd_log_message(request, ESP_FAIL);
+        return ESP_OK;
+    }
+
+    job->job.method = request->method;
+    job->job.uri =
+        min_httpd_arena_strndup(&job->arena, request->uri, SIZE_MAX);
+    job->job.body = min_httpd_arena_calloc(&job->arena,
+                                           request->content_len + 1,
+                                           sizeof(char));
+    job->job.body_len = request->content_len;
+    job->job.user_ctx = route->user_ctx;
+    job->route = route;
+    if ((job->job.uri == NULL) || (job->job.body == NULL)) {
+        min_httpd_offload_job_release(job);
+        httpd_resp_set_status(request, "413 Payload Too Large");
+        httpd_resp_send(request, NULL, 0);
+        min_httpd_log_message(request, ESP_FAIL);
+        return ESP_FAIL;
+    }
+
+    /* Receive the body */
+    size_t off = 0;
+    while (off < request->content_len) {
+        int ret = httpd_req_recv(request,
+                                 job->job.body + off,
+                                 request->content_len - off);
+        if (ret <= 0) {
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT)
+                httpd_resp_send_408(request);
+            min_httpd_offload_job_release(job);
+            return ESP_FAIL;
+        }
+        off += ret;
+    }
+
+    min_httpd_offload_pending_add(&min_httpd_offload_pending_jobs,
+                                  job,
+                                  httpd_req_to_sockfd(request));
+    obs32_trace_instant(&min_httpd_trace_group,
+                        MIN_HTTPD_TRACE_POINT_OFFLOAD_QUEUED,
+                        (uint16_t)(job - min_httpd_offload_jobs));
+
+    if (min_httpd_offload_queue == NULL) {
+        min_httpd_offload_run(job);
+        min_httpd_offload_complete(job);
+        min_httpd_log_message(request, ESP_OK);
+        return ESP_OK;
+    }
+
+    // Jobs of a stopped server may still occupy the queue
+    if (xQueueSend(min_httpd_offload_queue, &job, 0) != pdTRUE) {
+        min_httpd_offload_pending_remove(&min_httpd_offload_pending_jobs, job);
+        min_httpd_offload_job_release(job);
+        httpd_resp_set_status(request, "503 Service Unavailable");
+        httpd_resp_send(request, NULL, 0);
+        min_httpd_log_message(request, ESP_FAIL);
+        return ESP_OK;
+    }
+
+    min_httpd_log_message(request, ESP_OK);
+    return ESP_OK;
+}
+
+/**
+ * The handler of all inline routes.
+ *
+ * If the request is admitted (see ::min_httpd_offload_admit ), the route's
+ * handler is provided with the arena of inline routes (see
+ * ::min_httpd_request_arena ), which is reset, after the handler returned.
+ *
+ * The frames of a WebSocket session are passed to the route's handler
+ * directly, as the session was admitted with its handshake. The server
+ * responds to the handshake before the handler is executed, so the session of
+ * a refused handshake is closed (the response of the refusal fails the
+ * WebSocket at the client).
+ *
+ * @param request The request. ``user_ctx`` is the route, it is replaced with
+ *                the route's ``user_ctx``.
+ * @return The return value of the route's handler, or of
+ *         ::min_httpd_offload_admit , if the request is refused.
+ */
+static esp_err_t min_httpd_offload_inline_handler(httpd_req_t* request) {
+    const struct min_httpd_route* route = request->user_ctx;
+    uint32_t failures = min_httpd_offload_arena.failures;
+
+    if (route->websocket && (request->method != HTTP_GET)) {
+        request->user_ctx = route->user_ctx;
+        return route->handler(request);
+    }
+
+    esp_err_t ret;
+    if (!min_httpd_offload_admit(request, route->cost, &ret))
+        return route->websocket ? ESP_FAIL : ret;
+
+    obs32_metrics_inc(&min_httpd_metrics_inline);
+
+    uint16_t sockfd = (uint16_t)httpd_req_to_sockfd(request);
+    request->user_ctx = route->user_ctx;
+    min_httpd_offload_arena_request = request;
+    obs32_trace_begin(&min_httpd_trace_group,
+                      MIN_HTTPD_TRACE_POINT_INLINE,
+                      sockfd);
+    int64_t start = esp_timer_get_time();
+    ret = route->handler(request);
+    obs32_metrics_observe(&min_httpd_metrics_inline_us,
+                          (uint32_t)(esp_timer_get_time() - start));
+    obs32_trace_end(&min_httpd_trace_group,
+                    MIN_HTTPD_TRACE_POINT_INLINE,
+                    sockfd);
+    min_httpd_offload_arena_request = NULL;
+
+    if (min_httpd_offload_arena.failures != failures)
+        ESP_LOGW(TAG,
+                 "'%s' exceeded the budget of %d bytes",
+                 request->uri,
+                 MIN_HTTPD_ARENA_LEN);
+    min_httpd_arena_reset(&min_httpd_offload_arena);
+    return ret;
+}
+
+// Documentation in header file!
+struct min_httpd_arena* min_httpd_request_arena(httpd_req_t* request) {
+    if ((request == NULL) || (request != min_httpd_offload_arena_request))
+        return NULL;
+    return &min_httpd_offload_arena;
+}
+
+// Documentation in header file!
+void min_httpd_offload_attach(httpd_handle_t server) {
+    ESP_LOGV(TAG, "min_httpd_offload_attach()");
+
+    min_httpd_offload_server = server;
+    min_httpd_arena_init(&min_httpd_offload_arena,
+                         min_httpd_offload_arena_storage,
+                         sizeof(min_httpd_offload_arena_storage));
+    min_httpd_offload_pending_init(&min_httpd_offload_pending_jobs,
+                                   min_httpd_offload_storage,
+                                   MIN_HTTPD_OFFLOAD_MAX_JOBS);
+
+    if ((MIN_HTTPD_WORKERS == 0) || (min_httpd_offload_queue != NULL))
+        return;
+
+    min_httpd_offload_queue = xQueueCreate(
+        MIN_HTTPD_OFFLOAD_MAX_JOBS,
+        sizeof(struct min_httpd_offload_job*));
+    if (min_httpd_offload_queue == NULL) {
+        ESP_LOGE(TAG, "Could not create queue, offloaded routes run inline!");
+        return;
+    }
+
+    for (int i = 0; i < MIN_HTTPD_WORKERS; i++) {
+        if (xTaskCreatePinnedToCore(min_httpd_offload_worker,
+                                    "httpd_worker",
+                                    MIN_HTTPD_WORKER_STACK_SIZE,
+                                    NULL,
+                                    MIN_HTTPD_WORKER_PRIORITY,
+                                    NULL,
+                                    MIN_HTTPD_OFFLOAD_CORE) != pdPASS)
+            ESP_LOGE(TAG, "Could not create worker %d!", i);
+    }
+}
+
+// Documentation in header file!
+void min_httpd_offload_detach(void) {
+    ESP_LOGV(TAG, "min_httpd_offload_detach()");
+
+    // Jobs, that are finished afterwards, are discarded
+    min_httpd_offload_pending_init(&min_httpd_offload_pending_jobs,
+                                   min_httpd_offload_storage,
+                                   MIN_HTTPD_OFFLOAD_MAX_JOBS);
+    min_httpd_offload_server = NULL;
+}
+
+// Documentation in header file!
+void min_httpd_offload_session_closed(int sockfd) {
+    if (min_httpd_offload_pending_orphan(&min_httpd_offload_pending_jobs,
+                                         sockfd) > 0)
+        ESP_LOGD(TAG, "Session %d closed with pending jobs", sockfd);
+}
+
+// Documentation in header file!
+bool min_httpd_offload_admit(httpd_req_t* request,
+                             uint32_t cost,
+                             esp_err_t* ret) {
+    // Answering it would overtake the pending response
+    if (min_httpd_offload_pending_busy(&min_httpd_offload_pending_jobs,
+                                       httpd_req_to_sockfd(request))) {
+        ESP_LOGD(TAG, "'%s' - pipelined behind an offloaded job", request->uri);
+        *ret = ESP_FAIL;
+        return false;
+    }
+
+    return min_httpd_limit_admit(request, cost, ret);
+}
+
+// Documentation in header file!
+esp_err_t min_httpd_register_route(httpd_handle_t server,
+                                   const struct min_httpd_route* route) {
+    httpd_uri_t uri = {
+        .uri = route->uri,
+        .method = route->method,
+        .handler = min_httpd_offload_inline_handler,
+        .user_ctx = (void*)route};
+
+    if (route->cost == 0)
+        return ESP_ERR_INVALID_ARG;
+    if (route->mode == MIN_HTTPD_ROUTE_OFFLOADED) {
+        if ((route->job_handler == NULL) || route->websocket)
+            return ESP_ERR_INVALID_ARG;
+        uri.handler = min_httpd_offload_handler;
+    } else if (route->handler == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // ``httpd_uri_t`` provides ``is_websocket`` only with WebSocket support
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    uri.is_websocket = route->websocket;
+#else
+    if (route->websocket)
+        return ESP_ERR_NOT_SUPPORTED;
+#endif
+
+    return httpd_register_uri_handler(server, &uri);
+}
+
+// Documentation in header file!
+esp_err_t min_httpd_job_respond(struct min_httpd_job* job,
+                                const char* status,
+                                const char* type,
+                                const char* body,
+                                ssize_t len) {
+    struct min_httpd_offload_job* offload_job =
+        (struct min_httpd_offload_job*)job;
+
+    if (offload_job->response != NULL)
+        return ESP_ERR_INVALID_STATE;
+    if (len == HTTPD_RESP_USE_STRLEN)
+        len = (body != NULL) ? strlen(body) : 0;
+
+    char head[MIN_HTTPD_OFFLOAD_HEAD_LEN];
+    size_t head_len =
+        min_httpd_offload_response_head(head,
+                                        sizeof(head),
+                                        (status != NULL) ? status : "200 OK",
+                                        (type != NULL) ? type : "text/html",
+                                        len);
+    if (head_len == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    char* response = min_httpd_arena_alloc(job->arena, head_len + len);
+    if (response == NULL)
+        return ESP_ERR_NO_MEM;
+
+    memcpy(response, head, head_len);
+    if (len > 0)
+        memcpy(response + head_len, body, len);
+    offload_job->response = response;
+    offload_job->response_len = head_len + len;
+    return ESP_OK;
+}
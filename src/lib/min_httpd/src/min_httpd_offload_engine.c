@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's offloaded routes.
+ *
+ * The table of pending jobs is small (the number of workers plus the length
+ * of their queue), so it is searched linearly.
+ *
+ * @file   min_httpd_offload_engine.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "min_httpd_offload_engine.h"
+
+/* C's standard libraries. */
+#include <stdio.h>
+#include <string.h>
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+// Documentation in header file!
+void min_httpd_offload_pending_init(struct min_httpd_offload_pending* pending,
+                                    struct min_httpd_offload_entry* storage,
+                                    size_t size) {
+    memset(pending, 0, sizeof(*pending));
+    pending->entries = storage;
+    pending->size = size;
+
+    for (size_t i = 0; i < size; i++) {
+        storage[i].job = NULL;
+        storage[i].socket = -1;
+    }
+}
+
+// Documentation in header file!
+bool min_httpd_offload_pending_add(struct min_httpd_offload_pending* pending,
+                                   const void* job,
+                                   int socket) {
+    for (size_t i = 0; i < pending->size; i++) {
+        if (pending->entries[i].job == NULL) {
+            pending->entries[i].job = job;
+            pending->entries[i].socket = socket;
+            pending->count++;
+            pending->jobs++;
+            return true;
+        }
+    }
+
+    pending->rejected++;
+    return false;
+}
+
+// Documentation in header file!
+int min_httpd_offload_pending_remove(struct min_httpd_offload_pending* pending,
+                                     const void* job) {
+    for (size_t i = 0; i < pending->size; i++) {
+        if (pending->entries[i].job == job) {
+            int socket = pending->entries[i].socket;
+            pending->entries[i].job = NULL;
+            pending->entries[i].socket = -1;
+            pending->count--;
+            return socket;
+        }
+    }
+    return -1;
+}
+
+// Documentation in header file!
+size_t min_httpd_offload_pending_orphan(
+    struct min_httpd_offload_pending* pending,
+    int socket) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < pending->size; i++) {
+        if ((pending->entries[i].job != NULL) &&
+            (pending->entries[i].socket == socket)) {
+            pending->entries[i].socket = -1;
+            pending->orphaned++;
+            count++;
+        }
+    }
+    return count;
+}
+
+// Documentation in header file!
+bool min_httpd_offload_pending_busy(
+    const struct min_httpd_offload_pending* pending,
+    int socket) {
+    for (size_t i = 0; i < pending->size; i++) {
+        if ((pending->entries[i].job != NULL) &&
+            (pending->entries[i].socket == socket))
+            return true;
+    }
+    return false;
+}
+
+// Documentation in header file!
+size_t min_httpd_offload_response_head(char* buf,
+                                       size_t size,
+                                       const char* status,
+                                       const char* type,
+                                       size_t len) {
+    int ret = snprintf(buf,
+                       size,
+                       "HTTP/1.1 %s\r\n"
+                       "Content-Type: %s\r\n"
+                       "Content-Length: %u\r\n"
+                       "Connection: close\r\n"
+                       "\r\n",
+                       status,
+                       type,
+                       (unsigned int)len);
+    if ((ret < 0) || ((size_t)ret >= size))
+        return 0;
+    return (size_t)ret;
+}
@@ -0,0 +1,148 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's offloaded routes.
+ *
+ * Requests of offloaded routes are processed by worker tasks, while the
+ * server's task continues with other requests. The server's task keeps track
+ * of these *jobs* in a bounded table of pending jobs, that maps every job to
+ * the socket of its session:
+ *
+ *   - a job is added, when the request is handed to the workers;
+ *   - if the session is closed before the job is finished, the job is
+ *     *orphaned*, so its response is discarded, even if the socket is reused
+ *     by another session meanwhile;
+ *   - a job is removed, when its response is sent.
+ *
+ * The response is sent as a whole by the server's task, so the engine
+ * provides its head. The server's task continues with the session's next
+ * request meanwhile, so a pipelined request could be answered before. The
+ * head closes the session (``Connection: close``) and further requests of a
+ * session with a pending job are refused (see
+ * ::min_httpd_offload_pending_busy ), so responses are never reordered.
+ *
+ * The engine does not lock and does not depend on **ESP-IDF**, so it builds
+ * on a Linux host (see ``tools/min_httpd/offload``). Locking is the
+ * responsibility of the caller (see min_httpd_offload.c ).
+ *
+ * @file   min_httpd_offload_engine.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_OFFLOAD_ENGINE_H_
+#define SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_OFFLOAD_ENGINE_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * An entry of the table of pending jobs.
+ */
+struct min_httpd_offload_entry {
+    const void* job;  // ``NULL`` marks an unused entry
+    int socket;       // ``-1`` if the session was closed
+};
+
+/**
+ * The table of pending jobs.
+ *
+ * The storage is provided by the caller, see ::min_httpd_offload_pending_init .
+ */
+struct min_httpd_offload_pending {
+    struct min_httpd_offload_entry* entries;
+    size_t size;
+    size_t count;
+
+    uint32_t jobs;      // jobs added to the table
+    uint32_t rejected;  // jobs rejected, as the table was full
+    uint32_t orphaned;  // jobs, whose session was closed before
+};
+
+
+/**
+ * Initialize the table of pending jobs.
+ *
+ * This drops all entries, so jobs, that are finished afterwards, are not
+ * found (and their responses are discarded).
+ *
+ * @param pending The table to be initialized.
+ * @param storage The storage of the entries.
+ * @param size    The number of entries of ``storage``.
+ */
+void min_httpd_offload_pending_init(struct min_httpd_offload_pending* pending,
+                                    struct min_httpd_offload_entry* storage,
+                                    size_t size);
+
+/**
+ * Add a job to the table of pending jobs.
+ *
+ * @param pending The table.
+ * @param job     The job.
+ * @param socket  The socket of the job's session.
+ * @return bool ``true`` if the job was added, ``false`` if the table is full.
+ */
+bool min_httpd_offload_pending_add(struct min_httpd_offload_pending* pending,
+                                   const void* job,
+                                   int socket);
+
+/**
+ * Remove a finished job from the table of pending jobs.
+ *
+ * @param pending The table.
+ * @param job     The job.
+ * @return int The socket of the job's session, ``-1`` if the session was
+ *             closed or the job is unknown.
+ */
+int min_httpd_offload_pending_remove(struct min_httpd_offload_pending* pending,
+                                     const void* job);
+
+/**
+ * Orphan the pending jobs of a closed session.
+ *
+ * @param pending The table.
+ * @param socket  The socket of the closed session.
+ * @return size_t The number of orphaned jobs.
+ */
+size_t min_httpd_offload_pending_orphan(
+    struct min_httpd_offload_pending* pending,
+    int socket);
+
+/**
+ * Check, if a session has a pending job.
+ *
+ * @param pending The table.
+ * @param socket  The socket of the session.
+ * @return bool ``true`` if a job of the session is pending.
+ */
+bool min_httpd_offload_pending_busy(
+    const struct min_httpd_offload_pending* pending,
+    int socket);
+
+/**
+ * Write the head of a response.
+ *
+ * The response has a ``Content-Length``, but closes the session
+ * (``Connection: close``), as it is sent after the request was handed over.
+ *
+ * @param buf    The buffer.
+ * @param size   The size of ``buf``.
+ * @param status The status, e.g. ``200 OK``.
+ * @param type   The ``Content-Type``, e.g. ``text/html``.
+ * @param len    The length of the response's body.
+ * @return size_t The length of the head, ``0`` if ``buf`` is too small.
+ */
+size_t min_httpd_offload_response_head(char* buf,
+                                       size_t size,
+                                       const char* status,
+                                       const char* type,
+                                       size_t len);
+
+#endif  // SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_OFFLOAD_ENGINE_H_
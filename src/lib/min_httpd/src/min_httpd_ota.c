@@ -0,0 +1,681 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Firmware upload of the ``min_httpd`` component.
+ *
+ * The firmware is sent with ``POST`` to ::MIN_HTTPD_OTA_URI , e.g.
+ * ``curl --data-binary @firmware.bin -H "X-Firmware-SHA256: ..." -H
+ * "Authorization: Bearer ..."``. Uploads without ::MIN_HTTPD_OTA_TOKEN are
+ * rejected, before anything is received. The request's body is either the
+ * plain firmware or a *payload*, that is compressed and/or a delta against
+ * the running firmware (see min_httpd_ota_engine.h ). It is streamed into the
+ * next OTA partition, without holding the firmware in memory:
+ *
+ *   - the server's task receives the body in chunks of
+ *     ::MIN_HTTPD_OTA_INPUT_LEN bytes, decodes them into one of
+ *     ::MIN_HTTPD_OTA_BUFFERS buffers and hashes the firmware (see
+ *     min_httpd_ota_engine.c );
+ *   - a separate task (the *writer*) writes the buffers with
+ *     ``esp_ota_write()``, which erases the flash sector by sector, while
+ *     the server's task receives the next buffer.
+ *
+ * The buffers are passed between the tasks with two queues: ``free`` buffers
+ * are taken by the server's task, ``full`` buffers by the writer. The time,
+ * that the server's task waits for a free buffer, is reported as *stall*, so
+ * it shows, whether the network or the flash limits the throughput.
+ *
+ * The base of a delta is read from the running partition. A delta, that was
+ * generated against another firmware, is rejected before anything is
+ * written.
+ *
+ * The firmware is activated, if its digest matches ``X-Firmware-SHA256`` and
+ * ``esp_ota_end()`` validates the image. The response reports the achieved
+ * throughput, then the device restarts after ::MIN_HTTPD_OTA_RESTART_DELAY .
+ *
+ * The upload occupies the server's task, so requests of other clients wait
+ * until it is finished.
+ *
+ * @file   min_httpd_ota.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Other headers of the component. */
+#include "min_httpd/min_httpd.h"   // The public header
+#include "min_httpd_internal.h"    // modules of the component
+#include "min_httpd_ota_engine.h"  // hashing and results
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* This is EPS-IDF's http server library. */
+#include "esp_http_server.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* This is ESP-IDF's OTA library, that writes the OTA partitions. */
+#include "esp_ota_ops.h"
+
+/* This is ESP-IDF's system library.
+ * - ``esp_restart()``
+ */
+#include "esp_system.h"
+
+/* This is ESP-IDF's high resolution timer library.
+ * - ``esp_timer_get_time()``
+ */
+#include "esp_timer.h"
+
+/* FreeRTOS headers.
+ * - the ``FreeRTOS.h`` is required
+ * - ``queue.h`` passes the buffers between the tasks
+ * - ``semphr.h`` signals the end of the writer
+ * - ``task.h`` runs the writer
+ * - ``timers.h`` delays the restart
+ */
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The header, that provides the SHA-256 digest of the firmware.
+ */
+#define MIN_HTTPD_OTA_DIGEST_HEADER "X-Firmware-SHA256"
+
+/**
+ * The header, that provides ::MIN_HTTPD_OTA_TOKEN .
+ */
+#define MIN_HTTPD_OTA_TOKEN_HEADER "Authorization"
+
+/**
+ * The maximum length of the value of ::MIN_HTTPD_OTA_TOKEN_HEADER , including
+ * the scheme and the terminating ``\0``.
+ */
+#define MIN_HTTPD_OTA_TOKEN_HEADER_LEN \
+    (sizeof("Bearer ") + MIN_HTTPD_OTA_TOKEN_MAX_LEN)
+
+/**
+ * The maximum number of consecutive timeouts, while the body is received.
+ */
+#define MIN_HTTPD_OTA_RECV_RETRIES 3
+
+/**
+ * The maximum length of the body of the response to a successful upload.
+ */
+#define MIN_HTTPD_OTA_RESULT_LEN 112
+
+/**
+ * The length of the chunks of the request's body, that are decoded.
+ */
+#define MIN_HTTPD_OTA_INPUT_LEN 1024
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A buffer between the server's task and the writer.
+ */
+struct min_httpd_ota_buffer {
+    size_t len;
+    uint8_t data[MIN_HTTPD_OTA_BUFFER_LEN];
+};
+
+/**
+ * The receiving side of an upload.
+ */
+struct min_httpd_ota_input {
+    struct min_httpd_ota_decoder decoder;
+    uint8_t data[MIN_HTTPD_OTA_INPUT_LEN];
+};
+
+/**
+ * The state of an upload, that is shared by the server's task and the
+ * writer.
+ */
+struct min_httpd_ota_upload {
+    esp_ota_handle_t handle;
+    struct min_httpd_ota_input* input;  // only used by the server's task
+    struct min_httpd_ota_buffer* buffers;
+    QueueHandle_t free;  // buffers, that may be received
+    QueueHandle_t full;  // buffers, that are written; ``NULL`` ends the writer
+    SemaphoreHandle_t done;
+    volatile esp_err_t error;  // the first error of ``esp_ota_write()``
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "krachkiste.httpd.ota";
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static esp_err_t min_httpd_ota_handler(httpd_req_t* request);
+static bool min_httpd_ota_read_running(void* ctx,
+                                       size_t offset,
+                                       void* data,
+                                       size_t len);
+static void min_httpd_ota_publish(const struct min_httpd_ota_transfer* transfer,
+                                  int64_t started);
+static esp_err_t min_httpd_ota_receive(httpd_req_t* request,
+                                       const esp_partition_t* partition,
+                                       struct min_httpd_ota_upload* upload,
+                                       struct min_httpd_ota_transfer* transfer,
+                                       const uint8_t* expected,
+                                       int64_t* stall_us);
+static esp_err_t min_httpd_ota_reject(httpd_req_t* request,
+                                      const char* status,
+                                      const char* message);
+static void min_httpd_ota_restart(TimerHandle_t timer);
+static bool min_httpd_ota_upload_create(struct min_httpd_ota_upload* upload);
+static void min_httpd_ota_upload_destroy(struct min_httpd_ota_upload* upload);
+static void min_httpd_ota_writer(void* arg);
+
+
+/* ***** URI DEFINITIONS ***************************************************
+ * (technically, these are ``variables``, but as the handler functions must be
+ *  referenced, these must come after the ``prototypes``)
+ */
+
+/**
+ * Route definition of the firmware upload.
+ *
+ * The body is streamed to the writer, so the route is not offloaded; it
+ * exceeds ::MIN_HTTPD_OFFLOAD_MAX_BODY anyway.
+ */
+static const struct min_httpd_route min_httpd_ota_route = {
+    .uri = MIN_HTTPD_OTA_URI,
+    .method = HTTP_POST,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = min_httpd_ota_handler,
+    .user_ctx = NULL,
+    .cost = MIN_HTTPD_LIMIT_COST_OTA};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Allocate the buffers and the queues of an upload.
+ *
+ * All buffers are queued as ``free``.
+ *
+ * @param upload The upload.
+ * @return bool ``true`` on success, ``false`` if memory is exhausted.
+ */
+static bool min_httpd_ota_upload_create(struct min_httpd_ota_upload* upload) {
+    memset(upload, 0, sizeof(*upload));
+    upload->error = ESP_OK;
+
+    upload->input = malloc(sizeof(struct min_httpd_ota_input));
+    upload->buffers =
+        malloc(MIN_HTTPD_OTA_BUFFERS * sizeof(struct min_httpd_ota_buffer));
+    upload->free = xQueueCreate(MIN_HTTPD_OTA_BUFFERS,
+                                sizeof(struct min_httpd_ota_buffer*));
+    upload->full = xQueueCreate(MIN_HTTPD_OTA_BUFFERS + 1,
+                                sizeof(struct min_httpd_ota_buffer*));
+    upload->done = xSemaphoreCreateBinary();
+    if ((upload->input == NULL) || (upload->buffers == NULL) ||
+        (upload->free == NULL) ||
+        (upload->full == NULL) || (upload->done == NULL)) {
+        min_httpd_ota_upload_destroy(upload);
+        return false;
+    }
+
+    for (size_t i = 0; i < MIN_HTTPD_OTA_BUFFERS; i++) {
+        struct min_httpd_ota_buffer* buffer = &upload->buffers[i];
+        xQueueSend(upload->free, &buffer, 0);
+    }
+    return true;
+}
+
+/**
+ * Release the buffers and the queues of an upload.
+ *
+ * The writer must be finished.
+ *
+ * @param upload The upload.
+ */
+static void min_httpd_ota_upload_destroy(struct min_httpd_ota_upload* upload) {
+    if (upload->done != NULL)
+        vSemaphoreDelete(upload->done);
+    if (upload->full != NULL)
+        vQueueDelete(upload->full);
+    if (upload->free != NULL)
+        vQueueDelete(upload->free);
+    free(upload->buffers);
+    free(upload->input);
+}
+
+/**
+ * Write the ``full`` buffers to flash and return them as ``free``.
+ *
+ * This is the writer's task. It ends with a ``NULL`` buffer. After an error,
+ * the buffers are returned without writing them, so the server's task is
+ * not blocked.
+ *
+ * @param arg The upload (::min_httpd_ota_upload ).
+ */
+static void min_httpd_ota_writer(void* arg) {
+    struct min_httpd_ota_upload* upload = arg;
+    struct min_httpd_ota_buffer* buffer;
+
+    while ((xQueueReceive(upload->full, &buffer, portMAX_DELAY) == pdTRUE) &&
+           (buffer != NULL)) {
+        if (upload->error == ESP_OK) {
+            upload->error =
+                esp_ota_write(upload->handle, buffer->data, buffer->len);
+        }
+        xQueueSend(upload->free, &buffer, portMAX_DELAY);
+    }
+
+    xSemaphoreGive(upload->done);
+    vTaskDelete(NULL);
+}
+
+/**
+ * Publish the progress of an upload with ``MIN_HTTPD_OTA_PROGRESS``.
+ *
+ * @param transfer The transfer.
+ * @param started  The start of the upload, see ``esp_timer_get_time()``.
+ */
+static void min_httpd_ota_publish(const struct min_httpd_ota_transfer* transfer,
+                                  int64_t started) {
+    struct min_httpd_ota_progress progress = {
+        .received = transfer->received,
+        .total = transfer->total,
+        .rate = min_httpd_ota_rate(transfer->received,
+                                   esp_timer_get_time() - started),
+    };
+
+    if (esp_event_post(MIN_HTTPD_EVENTS,
+                       MIN_HTTPD_OTA_PROGRESS,
+                       &progress,
+                       sizeof(progress),
+                       pdMS_TO_TICKS(MIN_HTTPD_SESSION_EVENT_TIMEOUT)) !=
+        ESP_OK) {
+        ESP_LOGD(TAG, "Could not publish progress!");
+    }
+}
+
+/**
+ * Read the base of a delta from the running partition.
+ *
+ * This is the callback of the decoder.
+ *
+ * @param ctx    The running partition (``esp_partition_t``).
+ * @param offset The offset in the partition.
+ * @param data   The buffer.
+ * @param len    The number of bytes to read.
+ * @return bool ``true`` on success.
+ */
+static bool min_httpd_ota_read_running(void* ctx,
+                                       size_t offset,
+                                       void* data,
+                                       size_t len) {
+    return esp_partition_read(ctx, offset, data, len) == ESP_OK;
+}
+
+/**
+ * Receive the payload, decode the firmware and pass it to the writer.
+ *
+ * Every buffer is filled completely (except the last one), so the writes are
+ * aligned with the flash sectors. The transfer is initialized, as soon as the
+ * decoder provides the length of the firmware.
+ *
+ * @param request   The request.
+ * @param partition The partition, that is written.
+ * @param upload    The upload.
+ * @param transfer  The transfer, that hashes the firmware.
+ * @param expected  The announced digest of the firmware.
+ * @param stall_us  The time, that was spent waiting for free buffers.
+ * @return esp_err_t ``ESP_OK`` if the firmware was received completely,
+ *                   ``ESP_ERR_INVALID_SIZE`` if it exceeds ``partition``,
+ *                   ``ESP_ERR_INVALID_ARG`` if the payload could not be
+ *                   decoded (see the decoder's status), ``ESP_FAIL`` if the
+ *                   session failed and the error of the writer otherwise.
+ */
+static esp_err_t min_httpd_ota_receive(httpd_req_t* request,
+                                       const esp_partition_t* partition,
+                                       struct min_httpd_ota_upload* upload,
+                                       struct min_httpd_ota_transfer* transfer,
+                                       const uint8_t* expected,
+                                       int64_t* stall_us) {
+    struct min_httpd_ota_decoder* decoder = &upload->input->decoder;
+    struct min_httpd_ota_buffer* buffer = NULL;
+    const uint8_t* in = NULL;
+    size_t in_len = 0;
+    int64_t started = esp_timer_get_time();
+    size_t remaining = request->content_len;
+    bool initialized = false;
+
+    min_httpd_ota_decoder_init(decoder,
+                               request->content_len,
+                               min_httpd_ota_read_running,
+                               (void*)esp_ota_get_running_partition());
+
+    while (decoder->status != MIN_HTTPD_OTA_DECODER_DONE) {
+        if ((in_len == 0) && (remaining > 0)) {
+            size_t len = sizeof(upload->input->data);
+            int retries = 0;
+            int received;
+            do {
+                received = httpd_req_recv(request,
+                                          (char*)upload->input->data,
+                                          (len < remaining) ? len : remaining);
+            } while ((received == HTTPD_SOCK_ERR_TIMEOUT) &&
+                     (retries++ < MIN_HTTPD_OTA_RECV_RETRIES));
+            if (received <= 0)
+                return ESP_FAIL;
+
+            in = upload->input->data;
+            in_len = received;
+            remaining -= received;
+        }
+
+        if (buffer == NULL) {
+            int64_t waiting = esp_timer_get_time();
+            xQueueReceive(upload->free, &buffer, portMAX_DELAY);
+            *stall_us += esp_timer_get_time() - waiting;
+            if (upload->error != ESP_OK)
+                return upload->error;
+            buffer->len = 0;
+        }
+
+        buffer->len += min_httpd_ota_decoder_run(decoder,
+                                                 &in,
+                                                 &in_len,
+                                                 buffer->data + buffer->len,
+                                                 sizeof(buffer->data) -
+                                                     buffer->len);
+        if (decoder->status >= MIN_HTTPD_OTA_DECODER_INVALID)
+            return ESP_ERR_INVALID_ARG;
+
+        if (!initialized && (decoder->status != MIN_HTTPD_OTA_DECODER_HEADER)) {
+            if (decoder->len > partition->size)
+                return ESP_ERR_INVALID_SIZE;
+            min_httpd_ota_transfer_init(
+                transfer, decoder->len, expected, MIN_HTTPD_OTA_PROGRESS_STEP);
+            initialized = true;
+        }
+
+        if ((buffer->len == sizeof(buffer->data)) ||
+            ((decoder->status == MIN_HTTPD_OTA_DECODER_DONE) &&
+             (buffer->len > 0))) {
+            if (min_httpd_ota_transfer_update(
+                    transfer, buffer->data, buffer->len))
+                min_httpd_ota_publish(transfer, started);
+            xQueueSend(upload->full, &buffer, portMAX_DELAY);
+            buffer = NULL;
+        }
+    }
+
+    // The buffer, that was taken last, is returned
+    if (buffer != NULL)
+        xQueueSend(upload->free, &buffer, portMAX_DELAY);
+    return ESP_OK;
+}
+
+/**
+ * Reject an upload.
+ *
+ * The rest of the body is not received, so the session is closed.
+ *
+ * @param request The request.
+ * @param status  The status of the response.
+ * @param message The body of the response.
+ * @return esp_err_t Always ``ESP_FAIL``.
+ */
+static esp_err_t min_httpd_ota_reject(httpd_req_t* request,
+                                      const char* status,
+                                      const char* message) {
+    ESP_LOGW(TAG, "Rejecting firmware: %s", message);
+
+    httpd_resp_set_status(request, status);
+    httpd_resp_set_type(request, "text/plain");
+    httpd_resp_send(request, message, HTTPD_RESP_USE_STRLEN);
+    min_httpd_log_message(request, ESP_FAIL);
+    return ESP_FAIL;
+}
+
+/**
+ * Restart into the new firmware.
+ *
+ * This is the callback of the timer, that is started after the response to
+ * a successful upload.
+ *
+ * @param timer The timer.
+ */
+static void min_httpd_ota_restart(TimerHandle_t timer) {
+    ESP_LOGI(TAG, "Restarting into the new firmware...");
+    esp_restart();
+}
+
+/**
+ * The handler of the firmware upload.
+ *
+ * The matching *route definition* is ::min_httpd_ota_route .
+ *
+ * @param request The request that should be responded to with this function.
+ * @return ``ESP_OK`` if the firmware was activated, ``ESP_FAIL`` to close the
+ *         session otherwise.
+ */
+static esp_err_t min_httpd_ota_handler(httpd_req_t* request) {
+    char authorization[MIN_HTTPD_OTA_TOKEN_HEADER_LEN];
+    esp_err_t found = httpd_req_get_hdr_value_str(request,
+                                                  MIN_HTTPD_OTA_TOKEN_HEADER,
+                                                  authorization,
+                                                  sizeof(authorization));
+    if (found == ESP_ERR_NOT_FOUND) {
+        httpd_resp_set_hdr(request, "WWW-Authenticate", "Bearer");
+        return min_httpd_ota_reject(request,
+                                    "401 Unauthorized",
+                                    "Missing " MIN_HTTPD_OTA_TOKEN_HEADER);
+    }
+    if ((found != ESP_OK) ||
+        !min_httpd_ota_token_match(authorization, MIN_HTTPD_OTA_TOKEN)) {
+        return min_httpd_ota_reject(request, "403 Forbidden", "Invalid token");
+    }
+
+    char value[MIN_HTTPD_OTA_DIGEST_LEN * 2 + 1];
+    uint8_t expected[MIN_HTTPD_OTA_DIGEST_LEN];
+    if ((httpd_req_get_hdr_value_str(request,
+                                     MIN_HTTPD_OTA_DIGEST_HEADER,
+                                     value,
+                                     sizeof(value)) != ESP_OK) ||
+        !min_httpd_ota_digest_parse(value, expected)) {
+        return min_httpd_ota_reject(
+            request,
+            "400 Bad Request",
+            "Missing or invalid " MIN_HTTPD_OTA_DIGEST_HEADER);
+    }
+
+    const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+    if (partition == NULL) {
+        return min_httpd_ota_reject(request,
+                                    "503 Service Unavailable",
+                                    "No OTA partition");
+    }
+    if ((request->content_len == 0) ||
+        (request->content_len > partition->size)) {
+        return min_httpd_ota_reject(request,
+                                    "413 Payload Too Large",
+                                    "Firmware exceeds the OTA partition");
+    }
+
+    struct min_httpd_ota_upload upload;
+    if (!min_httpd_ota_upload_create(&upload)) {
+        return min_httpd_ota_reject(request,
+                                    "503 Service Unavailable",
+                                    "Out of memory");
+    }
+
+    // The flash is erased sector by sector by the writer, while receiving
+    if (esp_ota_begin(partition, OTA_WITH_SEQUENTIAL_WRITES, &upload.handle) !=
+        ESP_OK) {
+        min_httpd_ota_upload_destroy(&upload);
+        return min_httpd_ota_reject(request,
+                                    "500 Internal Server Error",
+                                    "Could not begin the update");
+    }
+    if (xTaskCreate(min_httpd_ota_writer,
+                    "min_httpd_ota",
+                    MIN_HTTPD_OTA_WRITER_STACK_SIZE,
+                    &upload,
+                    MIN_HTTPD_OTA_WRITER_PRIORITY,
+                    NULL) != pdPASS) {
+        esp_ota_abort(upload.handle);
+        min_httpd_ota_upload_destroy(&upload);
+        return min_httpd_ota_reject(request,
+                                    "503 Service Unavailable",
+                                    "Could not start the writer");
+    }
+
+    ESP_LOGI(TAG,
+             "Receiving %u bytes of payload into partition '%s'",
+             (unsigned int)request->content_len,
+             partition->label);
+
+    struct min_httpd_ota_transfer transfer = {0};
+    struct min_httpd_ota_result result = {.payload = request->content_len};
+    int64_t started = esp_timer_get_time();
+
+    // Wait for the writer, even if the transfer failed
+    esp_err_t received = min_httpd_ota_receive(request,
+                                               partition,
+                                               &upload,
+                                               &transfer,
+                                               expected,
+                                               &result.stall_us);
+    struct min_httpd_ota_buffer* end = NULL;
+    xQueueSend(upload.full, &end, portMAX_DELAY);
+    xSemaphoreTake(upload.done, portMAX_DELAY);
+    result.elapsed_us = esp_timer_get_time() - started;
+    result.len = transfer.received;
+    bool verified = min_httpd_ota_transfer_verify(&transfer);
+    esp_err_t written = upload.error;
+    enum min_httpd_ota_decoder_status decoded = upload.input->decoder.status;
+    min_httpd_ota_upload_destroy(&upload);
+
+    if (written != ESP_OK) {
+        esp_ota_abort(upload.handle);
+        ESP_LOGE(TAG, "Could not write: %s", esp_err_to_name(written));
+        return min_httpd_ota_reject(request,
+                                    "500 Internal Server Error",
+                                    "Could not write the firmware");
+    }
+    if (received == ESP_ERR_INVALID_SIZE) {
+        esp_ota_abort(upload.handle);
+        return min_httpd_ota_reject(request,
+                                    "413 Payload Too Large",
+                                    "Firmware exceeds the OTA partition");
+    }
+    if (received == ESP_ERR_INVALID_ARG) {
+        esp_ota_abort(upload.handle);
+        if (decoded == MIN_HTTPD_OTA_DECODER_MISMATCH) {
+            return min_httpd_ota_reject(
+                request,
+                "409 Conflict",
+                "Delta does not match the running firmware");
+        }
+        return min_httpd_ota_reject(request,
+                                    "422 Unprocessable Entity",
+                                    "Invalid payload");
+    }
+    if (received != ESP_OK) {
+        esp_ota_abort(upload.handle);
+        ESP_LOGW(TAG, "Firmware was not received completely!");
+        min_httpd_log_message(request, ESP_FAIL);
+        return ESP_FAIL;
+    }
+    if (!verified) {
+        esp_ota_abort(upload.handle);
+        return min_httpd_ota_reject(request,
+                                    "422 Unprocessable Entity",
+                                    "SHA-256 mismatch");
+    }
+    if (esp_ota_end(upload.handle) != ESP_OK) {
+        return min_httpd_ota_reject(request,
+                                    "422 Unprocessable Entity",
+                                    "Invalid firmware image");
+    }
+    if (esp_ota_set_boot_partition(partition) != ESP_OK) {
+        return min_httpd_ota_reject(request,
+                                    "500 Internal Server Error",
+                                    "Could not activate the firmware");
+    }
+
+    char body[MIN_HTTPD_OTA_RESULT_LEN];
+    size_t body_len = min_httpd_ota_result_json(body, sizeof(body), &result);
+    ESP_LOGI(TAG,
+             "Firmware (%u bytes, payload %u bytes) written in %u ms "
+             "(%u bytes/s, stalled %u ms)",
+             (unsigned int)result.len,
+             (unsigned int)result.payload,
+             (unsigned int)(result.elapsed_us / 1000),
+             (unsigned int)min_httpd_ota_rate(result.len, result.elapsed_us),
+             (unsigned int)(result.stall_us / 1000));
+
+    httpd_resp_set_type(request, HTTPD_TYPE_JSON);
+    httpd_resp_set_hdr(request, "Connection", "close");
+    esp_err_t return_value = httpd_resp_send(request, body, body_len);
+    min_httpd_log_message(request, return_value);
+
+    TimerHandle_t timer =
+        xTimerCreate("min_httpd_ota",
+                     pdMS_TO_TICKS(MIN_HTTPD_OTA_RESTART_DELAY),
+                     pdFALSE,
+                     NULL,
+                     min_httpd_ota_restart);
+    if ((timer == NULL) || (xTimerStart(timer, 0) != pdPASS))
+        esp_restart();
+
+    return return_value;
+}
+
+// Uploads must not be accepted without a token
+_Static_assert(!MIN_HTTPD_OTA_ENABLED ||
+                   ((sizeof(MIN_HTTPD_OTA_TOKEN) >
+                     MIN_HTTPD_OTA_TOKEN_MIN_LEN) &&
+                    (sizeof(MIN_HTTPD_OTA_TOKEN) <=
+                     MIN_HTTPD_OTA_TOKEN_MAX_LEN + 1)),
+               "CONFIG_MIN_HTTPD_OTA_TOKEN must have 16 to 64 characters");
+
+// Documentation in header file!
+void min_httpd_ota_attach(httpd_handle_t server) {
+    ESP_LOGV(TAG, "min_httpd_ota_attach()");
+
+    if (!MIN_HTTPD_OTA_ENABLED)
+        return;
+
+    if (min_httpd_register_route(server, &min_httpd_ota_route) != ESP_OK)
+        ESP_LOGE(TAG, "Could not register '%s'!", MIN_HTTPD_OTA_URI);
+}
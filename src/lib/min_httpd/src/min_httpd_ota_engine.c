@@ -0,0 +1,632 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's firmware upload.
+ *
+ * The decoder is a pipeline of two stages, that are pulled byte by byte: the
+ * decompression provides the (decompressed) payload, the delta consumes it
+ * and provides the firmware. Both stages may produce bytes without consuming
+ * input (a back-reference of the decompression, a ``COPY`` of the delta), so
+ * their state is kept in the decoder until the next call.
+ *
+ * @file   min_httpd_ota_engine.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "min_httpd_ota_engine.h"
+
+/* C's standard libraries. */
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The minimum window of the compression, given as its logarithm.
+ */
+#define MIN_HTTPD_OTA_WINDOW_BITS_MIN 4
+
+/**
+ * The minimum lookahead of the compression, given as its logarithm.
+ */
+#define MIN_HTTPD_OTA_LOOKAHEAD_BITS_MIN 3
+
+/**
+ * The maximum number of bits of a varint.
+ */
+#define MIN_HTTPD_OTA_VARINT_BITS 32
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * The states of the decompression.
+ */
+enum min_httpd_ota_lz_state {
+    MIN_HTTPD_OTA_LZ_TAG,      // a literal or a back-reference follows
+    MIN_HTTPD_OTA_LZ_LITERAL,  // 8 bits
+    MIN_HTTPD_OTA_LZ_INDEX,    // ``window_bits`` bits
+    MIN_HTTPD_OTA_LZ_COUNT,    // ``lookahead_bits`` bits
+};
+
+/**
+ * The states of the delta.
+ */
+enum min_httpd_ota_delta_state {
+    MIN_HTTPD_OTA_DELTA_OP,        // the code of the instruction
+    MIN_HTTPD_OTA_DELTA_POSITION,  // the position in the base
+    MIN_HTTPD_OTA_DELTA_LENGTH,    // the length
+    MIN_HTTPD_OTA_DELTA_DATA,      // the bytes
+};
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static int min_httpd_ota_hex(char digit);
+static bool min_httpd_ota_decoder_header(struct min_httpd_ota_decoder* decoder,
+                                         const uint8_t** in,
+                                         size_t* in_len);
+static bool min_httpd_ota_decoder_verify(struct min_httpd_ota_decoder* decoder);
+static int min_httpd_ota_decoder_bits(struct min_httpd_ota_decoder* decoder,
+                                      const uint8_t** in,
+                                      size_t* in_len,
+                                      uint8_t count);
+static int min_httpd_ota_decoder_stream(struct min_httpd_ota_decoder* decoder,
+                                        const uint8_t** in,
+                                        size_t* in_len);
+static int min_httpd_ota_decoder_base(struct min_httpd_ota_decoder* decoder);
+static size_t min_httpd_ota_decoder_step(struct min_httpd_ota_decoder* decoder,
+                                         const uint8_t** in,
+                                         size_t* in_len,
+                                         uint8_t* out,
+                                         size_t out_size);
+static bool min_httpd_ota_decoder_field(struct min_httpd_ota_decoder* decoder);
+static uint32_t min_httpd_ota_le32(const uint8_t* data);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get the value of a hexadecimal digit.
+ *
+ * @param digit The digit.
+ * @return int The value, ``-1`` if ``digit`` is no hexadecimal digit.
+ */
+static int min_httpd_ota_hex(char digit) {
+    if ((digit >= '0') && (digit <= '9'))
+        return digit - '0';
+    if ((digit >= 'a') && (digit <= 'f'))
+        return digit - 'a' + 10;
+    if ((digit >= 'A') && (digit <= 'F'))
+        return digit - 'A' + 10;
+    return -1;
+}
+
+// Documentation in header file!
+bool min_httpd_ota_digest_parse(const char* hex,
+                                uint8_t digest[MIN_HTTPD_OTA_DIGEST_LEN]) {
+    if (strlen(hex) != MIN_HTTPD_OTA_DIGEST_LEN * 2)
+        return false;
+
+    for (size_t i = 0; i < MIN_HTTPD_OTA_DIGEST_LEN; i++) {
+        int high = min_httpd_ota_hex(hex[i * 2]);
+        int low = min_httpd_ota_hex(hex[i * 2 + 1]);
+        if ((high < 0) || (low < 0))
+            return false;
+        digest[i] = (uint8_t)((high << 4) | low);
+    }
+    return true;
+}
+
+// Documentation in header file!
+bool min_httpd_ota_token_match(const char* authorization, const char* token) {
+    static const char scheme[] = "Bearer ";
+    const size_t scheme_len = sizeof(scheme) - 1;
+    size_t len = strlen(token);
+
+    if ((len == 0) || (strncasecmp(authorization, scheme, scheme_len) != 0) ||
+        (strlen(authorization + scheme_len) != len))
+        return false;
+
+    const char* given = authorization + scheme_len;
+    uint8_t difference = 0;
+    for (size_t i = 0; i < len; i++)
+        difference |= (uint8_t)(given[i] ^ token[i]);
+    return difference == 0;
+}
+
+// Documentation in header file!
+void min_httpd_ota_transfer_init(
+    struct min_httpd_ota_transfer* transfer,
+    size_t total,
+    const uint8_t expected[MIN_HTTPD_OTA_DIGEST_LEN],
+    size_t step) {
+    min_httpd_ota_sha256_init(&transfer->sha256);
+    memcpy(transfer->expected, expected, MIN_HTTPD_OTA_DIGEST_LEN);
+    transfer->total = total;
+    transfer->received = 0;
+    transfer->reported = 0;
+    transfer->step = step;
+}
+
+// Documentation in header file!
+bool min_httpd_ota_transfer_update(struct min_httpd_ota_transfer* transfer,
+                                   const void* data,
+                                   size_t len) {
+    min_httpd_ota_sha256_update(&transfer->sha256, data, len);
+    transfer->received += len;
+
+    if ((transfer->received >= transfer->total) ||
+        ((transfer->step > 0) &&
+         (transfer->received - transfer->reported >= transfer->step))) {
+        transfer->reported = transfer->received;
+        return true;
+    }
+    return false;
+}
+
+// Documentation in header file!
+bool min_httpd_ota_transfer_verify(struct min_httpd_ota_transfer* transfer) {
+    uint8_t digest[MIN_HTTPD_OTA_DIGEST_LEN];
+    min_httpd_ota_sha256_finish(&transfer->sha256, digest);
+
+    if (transfer->received != transfer->total)
+        return false;
+    return memcmp(digest, transfer->expected, sizeof(digest)) == 0;
+}
+
+/**
+ * Read a little-endian ``uint32_t``.
+ *
+ * @param data The bytes.
+ * @return uint32_t The value.
+ */
+static uint32_t min_httpd_ota_le32(const uint8_t* data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+           ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+// Documentation in header file!
+void min_httpd_ota_decoder_init(struct min_httpd_ota_decoder* decoder,
+                                size_t payload_len,
+                                min_httpd_ota_read_base read_base,
+                                void* ctx) {
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->status = MIN_HTTPD_OTA_DECODER_HEADER;
+    decoder->payload_len = payload_len;
+    decoder->read_base = read_base;
+    decoder->ctx = ctx;
+    decoder->lz_state = MIN_HTTPD_OTA_LZ_TAG;
+    decoder->delta_state = MIN_HTTPD_OTA_DELTA_OP;
+}
+
+/**
+ * Consume the header of the payload.
+ *
+ * A payload, that does not start with the magic number, is the plain
+ * firmware.
+ *
+ * @param decoder The decoder.
+ * @param in      The payload.
+ * @param in_len  The length of ``in``.
+ * @return bool ``true`` if the header is complete.
+ */
+static bool min_httpd_ota_decoder_header(struct min_httpd_ota_decoder* decoder,
+                                         const uint8_t** in,
+                                         size_t* in_len) {
+    static const uint8_t magic[] = {'M', 'O', 'T', 'A'};
+
+    if ((decoder->header_len == 0) && (*in_len > 0) && (**in != magic[0])) {
+        decoder->len = decoder->payload_len;
+        decoder->stream_len = decoder->payload_len;
+        return true;
+    }
+
+    size_t missing = sizeof(decoder->header) - decoder->header_len;
+    size_t len = (*in_len < missing) ? *in_len : missing;
+    memcpy(decoder->header + decoder->header_len, *in, len);
+    decoder->header_len += len;
+    *in += len;
+    *in_len -= len;
+    if (decoder->header_len < sizeof(decoder->header))
+        return false;
+
+    const uint8_t* header = decoder->header;
+    decoder->flags = header[5];
+    decoder->window_bits = header[6];
+    decoder->lookahead_bits = header[7];
+    decoder->len = min_httpd_ota_le32(header + 8);
+    decoder->stream_len = min_httpd_ota_le32(header + 12);
+    decoder->base_len = min_httpd_ota_le32(header + 16);
+
+    if ((min_httpd_ota_le32(header) != MIN_HTTPD_OTA_PAYLOAD_MAGIC) ||
+        (header[4] != MIN_HTTPD_OTA_PAYLOAD_VERSION) ||
+        ((decoder->flags & ~(MIN_HTTPD_OTA_PAYLOAD_COMPRESSED |
+                             MIN_HTTPD_OTA_PAYLOAD_DELTA)) != 0) ||
+        (decoder->len == 0)) {
+        decoder->status = MIN_HTTPD_OTA_DECODER_INVALID;
+        return false;
+    }
+    if ((decoder->flags & MIN_HTTPD_OTA_PAYLOAD_COMPRESSED) &&
+        ((decoder->window_bits < MIN_HTTPD_OTA_WINDOW_BITS_MIN) ||
+         (decoder->window_bits > MIN_HTTPD_OTA_WINDOW_BITS) ||
+         (decoder->lookahead_bits < MIN_HTTPD_OTA_LOOKAHEAD_BITS_MIN) ||
+         (decoder->lookahead_bits >= decoder->window_bits))) {
+        decoder->status = MIN_HTTPD_OTA_DECODER_INVALID;
+        return false;
+    }
+    if (!(decoder->flags & MIN_HTTPD_OTA_PAYLOAD_DELTA) &&
+        (decoder->stream_len != decoder->len)) {
+        decoder->status = MIN_HTTPD_OTA_DECODER_INVALID;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Verify the base of a delta by its SHA-256 digest.
+ *
+ * @param decoder The decoder, with a complete header.
+ * @return bool ``true`` if the base matches the header.
+ */
+static bool min_httpd_ota_decoder_verify(struct min_httpd_ota_decoder* decoder) {
+    struct min_httpd_ota_sha256 sha256;
+    uint8_t digest[MIN_HTTPD_OTA_DIGEST_LEN];
+
+    if ((decoder->base_len == 0) || (decoder->read_base == NULL))
+        return false;
+
+    min_httpd_ota_sha256_init(&sha256);
+    for (size_t offset = 0; offset < decoder->base_len;
+         offset += sizeof(decoder->cache)) {
+        size_t len = decoder->base_len - offset;
+        if (len > sizeof(decoder->cache))
+            len = sizeof(decoder->cache);
+        if (!decoder->read_base(decoder->ctx, offset, decoder->cache, len))
+            return false;
+        min_httpd_ota_sha256_update(&sha256, decoder->cache, len);
+    }
+    min_httpd_ota_sha256_finish(&sha256, digest);
+
+    // The cache is invalid
+    decoder->cache_len = 0;
+    return memcmp(digest, decoder->header + 20, sizeof(digest)) == 0;
+}
+
+/**
+ * Read bits of the compressed payload, most significant first.
+ *
+ * @param decoder The decoder.
+ * @param in      The payload.
+ * @param in_len  The length of ``in``.
+ * @param count   The number of bits.
+ * @return int The bits, ``-1`` if the payload is exhausted. The bytes, that
+ *             were consumed, are kept in the decoder then.
+ */
+static int min_httpd_ota_decoder_bits(struct min_httpd_ota_decoder* decoder,
+                                      const uint8_t** in,
+                                      size_t* in_len,
+                                      uint8_t count) {
+    while (decoder->bit_count < count) {
+        if (*in_len == 0)
+            return -1;
+        decoder->bits = (decoder->bits << 8) | *(*in)++;
+        decoder->bit_count += 8;
+        (*in_len)--;
+    }
+    decoder->bit_count -= count;
+    return (int)((decoder->bits >> decoder->bit_count) & ((1u << count) - 1));
+}
+
+/**
+ * Get the next byte of the decompressed payload.
+ *
+ * @param decoder The decoder.
+ * @param in      The payload.
+ * @param in_len  The length of ``in``.
+ * @return int The byte, ``-1`` if the payload is exhausted.
+ */
+static int min_httpd_ota_decoder_stream(struct min_httpd_ota_decoder* decoder,
+                                        const uint8_t** in,
+                                        size_t* in_len) {
+    if (decoder->stream_pos >= decoder->stream_len)
+        return -1;
+
+    if (!(decoder->flags & MIN_HTTPD_OTA_PAYLOAD_COMPRESSED)) {
+        if (*in_len == 0)
+            return -1;
+        (*in_len)--;
+        decoder->stream_pos++;
+        return *(*in)++;
+    }
+
+    uint32_t mask = (1u << decoder->window_bits) - 1;
+    for (;;) {
+        int value;
+
+        if (decoder->copy_count > 0) {
+            uint8_t byte =
+                decoder->window[(decoder->head - decoder->copy_index) & mask];
+            decoder->window[decoder->head++ & mask] = byte;
+            decoder->copy_count--;
+            decoder->stream_pos++;
+            return byte;
+        }
+
+        switch (decoder->lz_state) {
+            case MIN_HTTPD_OTA_LZ_TAG:
+                value = min_httpd_ota_decoder_bits(decoder, in, in_len, 1);
+                if (value < 0)
+                    return -1;
+                decoder->lz_state =
+                    value ? MIN_HTTPD_OTA_LZ_LITERAL : MIN_HTTPD_OTA_LZ_INDEX;
+                break;
+            case MIN_HTTPD_OTA_LZ_LITERAL:
+                value = min_httpd_ota_decoder_bits(decoder, in, in_len, 8);
+                if (value < 0)
+                    return -1;
+                decoder->window[decoder->head++ & mask] = (uint8_t)value;
+                decoder->lz_state = MIN_HTTPD_OTA_LZ_TAG;
+                decoder->stream_pos++;
+                return value;
+            case MIN_HTTPD_OTA_LZ_INDEX:
+                value = min_httpd_ota_decoder_bits(
+                    decoder, in, in_len, decoder->window_bits);
+                if (value < 0)
+                    return -1;
+                decoder->copy_index = (uint32_t)value + 1;
+                decoder->lz_state = MIN_HTTPD_OTA_LZ_COUNT;
+                break;
+            default:
+                value = min_httpd_ota_decoder_bits(
+                    decoder, in, in_len, decoder->lookahead_bits);
+                if (value < 0)
+                    return -1;
+                decoder->copy_count = (uint32_t)value + 1;
+                decoder->lz_state = MIN_HTTPD_OTA_LZ_TAG;
+                break;
+        }
+    }
+}
+
+/**
+ * Get the next byte of the base and advance the position.
+ *
+ * @param decoder The decoder.
+ * @return int The byte, ``-1`` if the base could not be read.
+ */
+static int min_httpd_ota_decoder_base(struct min_httpd_ota_decoder* decoder) {
+    size_t pos = decoder->base_pos++;
+
+    if ((pos < decoder->cache_offset) ||
+        (pos >= decoder->cache_offset + decoder->cache_len)) {
+        size_t len = decoder->base_len - pos;
+        if (len > sizeof(decoder->cache))
+            len = sizeof(decoder->cache);
+        if (!decoder->read_base(decoder->ctx, pos, decoder->cache, len))
+            return -1;
+        decoder->cache_offset = pos;
+        decoder->cache_len = len;
+    }
+    return decoder->cache[pos - decoder->cache_offset];
+}
+
+/**
+ * Apply a complete varint of the delta.
+ *
+ * @param decoder The decoder.
+ * @return bool ``true`` if the value is valid.
+ */
+static bool min_httpd_ota_decoder_field(struct min_httpd_ota_decoder* decoder) {
+    uint32_t value = decoder->varint;
+
+    decoder->varint = 0;
+    decoder->shift = 0;
+
+    if (decoder->delta_state == MIN_HTTPD_OTA_DELTA_POSITION) {
+        // zigzag: 0, -1, 1, -2, ...
+        if (value & 1) {
+            size_t back = (size_t)(value >> 1) + 1;
+            if (back > decoder->base_pos)
+                return false;
+            decoder->base_pos -= back;
+        } else {
+            decoder->base_pos += value >> 1;
+        }
+        decoder->delta_state = MIN_HTTPD_OTA_DELTA_LENGTH;
+        return true;
+    }
+
+    decoder->count = value;
+    if (decoder->count > decoder->len - decoder->produced)
+        return false;
+    if ((decoder->op != MIN_HTTPD_OTA_DELTA_INSERT) &&
+        ((decoder->base_pos > decoder->base_len) ||
+         (decoder->count > decoder->base_len - decoder->base_pos)))
+        return false;
+    decoder->delta_state = (decoder->count > 0) ? MIN_HTTPD_OTA_DELTA_DATA
+                                                : MIN_HTTPD_OTA_DELTA_OP;
+    return true;
+}
+
+/**
+ * Decode a chunk of the payload, see min_httpd_ota_decoder_run() .
+ *
+ * @param decoder  The decoder.
+ * @param in       The payload.
+ * @param in_len   The length of ``in``.
+ * @param out      The buffer of the firmware.
+ * @param out_size The size of ``out``.
+ * @return size_t The number of bytes of the firmware.
+ */
+static size_t min_httpd_ota_decoder_step(struct min_httpd_ota_decoder* decoder,
+                                         const uint8_t** in,
+                                         size_t* in_len,
+                                         uint8_t* out,
+                                         size_t out_size) {
+    size_t produced = 0;
+
+    if (decoder->status == MIN_HTTPD_OTA_DECODER_HEADER) {
+        if (!min_httpd_ota_decoder_header(decoder, in, in_len))
+            return 0;
+        if ((decoder->flags & MIN_HTTPD_OTA_PAYLOAD_DELTA) &&
+            !min_httpd_ota_decoder_verify(decoder)) {
+            decoder->status = MIN_HTTPD_OTA_DECODER_MISMATCH;
+            return 0;
+        }
+        decoder->status = MIN_HTTPD_OTA_DECODER_FIRMWARE;
+    }
+
+    if (decoder->status != MIN_HTTPD_OTA_DECODER_FIRMWARE)
+        return 0;
+
+    // A plain stream is just copied
+    if (!(decoder->flags & (MIN_HTTPD_OTA_PAYLOAD_COMPRESSED |
+                            MIN_HTTPD_OTA_PAYLOAD_DELTA))) {
+        produced = decoder->len - decoder->produced;
+        if (produced > out_size)
+            produced = out_size;
+        if (produced > *in_len)
+            produced = *in_len;
+        memcpy(out, *in, produced);
+        *in += produced;
+        *in_len -= produced;
+        decoder->stream_pos += produced;
+    }
+
+    while ((produced < out_size) &&
+           (decoder->produced + produced < decoder->len)) {
+        int value;
+
+        if (!(decoder->flags & MIN_HTTPD_OTA_PAYLOAD_DELTA)) {
+            value = min_httpd_ota_decoder_stream(decoder, in, in_len);
+            if (value < 0)
+                break;
+            out[produced++] = (uint8_t)value;
+            continue;
+        }
+
+        // A ``COPY`` does not consume the payload
+        if ((decoder->delta_state == MIN_HTTPD_OTA_DELTA_DATA) &&
+            (decoder->op == MIN_HTTPD_OTA_DELTA_COPY)) {
+            value = min_httpd_ota_decoder_base(decoder);
+            if (value < 0) {
+                decoder->status = MIN_HTTPD_OTA_DECODER_MISMATCH;
+                return produced;
+            }
+            out[produced++] = (uint8_t)value;
+            if (--decoder->count == 0)
+                decoder->delta_state = MIN_HTTPD_OTA_DELTA_OP;
+            continue;
+        }
+
+        value = min_httpd_ota_decoder_stream(decoder, in, in_len);
+        if (value < 0)
+            break;
+
+        switch (decoder->delta_state) {
+            case MIN_HTTPD_OTA_DELTA_OP:
+                if (value > MIN_HTTPD_OTA_DELTA_ADD) {
+                    decoder->status = MIN_HTTPD_OTA_DECODER_INVALID;
+                    return produced;
+                }
+                decoder->op = (uint8_t)value;
+                decoder->delta_state = (value == MIN_HTTPD_OTA_DELTA_INSERT)
+                                           ? MIN_HTTPD_OTA_DELTA_LENGTH
+                                           : MIN_HTTPD_OTA_DELTA_POSITION;
+                break;
+            case MIN_HTTPD_OTA_DELTA_POSITION:
+            case MIN_HTTPD_OTA_DELTA_LENGTH:
+                if (decoder->shift >= MIN_HTTPD_OTA_VARINT_BITS) {
+                    decoder->status = MIN_HTTPD_OTA_DECODER_INVALID;
+                    return produced;
+                }
+                decoder->varint |= (uint32_t)(value & 0x7F) << decoder->shift;
+                decoder->shift += 7;
+                if ((value & 0x80) == 0 &&
+                    !min_httpd_ota_decoder_field(decoder)) {
+                    decoder->status = MIN_HTTPD_OTA_DECODER_INVALID;
+                    return produced;
+                }
+                break;
+            default:
+                if (decoder->op == MIN_HTTPD_OTA_DELTA_ADD) {
+                    int base = min_httpd_ota_decoder_base(decoder);
+                    if (base < 0) {
+                        decoder->status = MIN_HTTPD_OTA_DECODER_MISMATCH;
+                        return produced;
+                    }
+                    value += base;
+                }
+                out[produced++] = (uint8_t)value;
+                if (--decoder->count == 0)
+                    decoder->delta_state = MIN_HTTPD_OTA_DELTA_OP;
+                break;
+        }
+    }
+
+    decoder->produced += produced;
+    if (decoder->produced == decoder->len)
+        decoder->status = MIN_HTTPD_OTA_DECODER_DONE;
+    return produced;
+}
+
+// Documentation in header file!
+size_t min_httpd_ota_decoder_run(struct min_httpd_ota_decoder* decoder,
+                                 const uint8_t** in,
+                                 size_t* in_len,
+                                 uint8_t* out,
+                                 size_t out_size) {
+    size_t available = *in_len;
+    size_t produced =
+        min_httpd_ota_decoder_step(decoder, in, in_len, out, out_size);
+    decoder->consumed += available - *in_len;
+
+    if (decoder->status == MIN_HTTPD_OTA_DECODER_DONE) {
+        // Trailing bytes
+        if ((*in_len > 0) || (decoder->consumed != decoder->payload_len))
+            decoder->status = MIN_HTTPD_OTA_DECODER_INVALID;
+    } else if (decoder->status < MIN_HTTPD_OTA_DECODER_DONE) {
+        // The payload ends before the firmware
+        if ((decoder->consumed == decoder->payload_len) &&
+            (produced < out_size))
+            decoder->status = MIN_HTTPD_OTA_DECODER_INVALID;
+    }
+    return produced;
+}
+
+// Documentation in header file!
+uint32_t min_httpd_ota_rate(size_t len, int64_t elapsed_us) {
+    if (elapsed_us <= 0)
+        return 0;
+    return (uint32_t)(((uint64_t)len * 1000000) / (uint64_t)elapsed_us);
+}
+
+// Documentation in header file!
+size_t min_httpd_ota_result_json(char* buf,
+                                 size_t size,
+                                 const struct min_httpd_ota_result* result) {
+    int len = snprintf(buf,
+                       size,
+                       "{\"len\":%u,\"payload\":%u,\"ms\":%" PRId64
+                       ",\"rate\":%" PRIu32 ",\"stall_ms\":%" PRId64 "}",
+                       (unsigned int)result->len,
+                       (unsigned int)result->payload,
+                       result->elapsed_us / 1000,
+                       min_httpd_ota_rate(result->len, result->elapsed_us),
+                       result->stall_us / 1000);
+    if ((len < 0) || ((size_t)len >= size))
+        return 0;
+    return (size_t)len;
+}
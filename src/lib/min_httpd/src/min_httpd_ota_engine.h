@@ -0,0 +1,346 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's firmware upload.
+ *
+ * The firmware is received in chunks, that are written to flash by another
+ * task (see min_httpd_ota.c ). The engine keeps track of the *transfer* on
+ * the receiving side:
+ *
+ *   - every chunk is hashed with SHA-256 as soon as it is received, so the
+ *     digest is available right after the last chunk;
+ *   - the progress is reported in steps of a fixed number of bytes;
+ *   - the digest is compared with the digest, that was announced by the
+ *     client, before the firmware is activated.
+ *
+ * The firmware may be sent as a *payload*, that reduces the number of bytes
+ * to be transferred (see ``tools/packer/firmware.py``). The *decoder*
+ * reconstructs the firmware from the payload as a stream, using a fixed
+ * amount of memory:
+ *
+ *   - the payload starts with a header (::MIN_HTTPD_OTA_PAYLOAD_MAGIC ),
+ *     otherwise it is the plain firmware (an image of **ESP-IDF** starts with
+ *     ``0xE9``);
+ *   - the payload may be compressed in the format of
+ *     [heatshrink](https://github.com/atomicobject/heatshrink), with a window
+ *     of up to ``2 ^ MIN_HTTPD_OTA_WINDOW_BITS`` bytes;
+ *   - the (decompressed) payload may be a *delta* against a base firmware,
+ *     i.e. the firmware, that is running. The delta is a sequence of
+ *     instructions, that insert bytes of the payload, copy bytes of the base
+ *     or add bytes of the payload to bytes of the base (see
+ *     ::min_httpd_ota_delta_op ). The base is read with a callback and
+ *     verified by its SHA-256 digest, before it is used.
+ *
+ * The engine provides the body of the response, that reports the achieved
+ * throughput.
+ *
+ * The engine does not lock and does not depend on **ESP-IDF**, so it builds
+ * on a Linux host (see ``tools/min_httpd/ota``). SHA-256 is provided by
+ * **mbedtls** (see min_httpd_ota_hash.h ).
+ *
+ * @file   min_httpd_ota_engine.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_OTA_ENGINE_H_
+#define SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_OTA_ENGINE_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The hash of the firmware. */
+#include "min_httpd_ota_hash.h"
+
+/**
+ * The magic number of a payload's header ("MOTA", little-endian).
+ */
+#define MIN_HTTPD_OTA_PAYLOAD_MAGIC 0x41544F4D
+
+/**
+ * The version of the payload's header.
+ */
+#define MIN_HTTPD_OTA_PAYLOAD_VERSION 1
+
+/**
+ * The length of the payload's header.
+ *
+ * All values are little-endian:
+ *
+ *   - ``uint32_t`` magic (::MIN_HTTPD_OTA_PAYLOAD_MAGIC );
+ *   - ``uint8_t`` version (::MIN_HTTPD_OTA_PAYLOAD_VERSION );
+ *   - ``uint8_t`` flags (::MIN_HTTPD_OTA_PAYLOAD_COMPRESSED ,
+ *     ::MIN_HTTPD_OTA_PAYLOAD_DELTA );
+ *   - ``uint8_t`` window bits and ``uint8_t`` lookahead bits of the
+ *     compression;
+ *   - ``uint32_t`` length of the firmware;
+ *   - ``uint32_t`` length of the decompressed payload;
+ *   - ``uint32_t`` length of the base;
+ *   - SHA-256 digest of the base.
+ */
+#define MIN_HTTPD_OTA_PAYLOAD_HEADER_LEN 52
+
+/**
+ * The payload is compressed.
+ */
+#define MIN_HTTPD_OTA_PAYLOAD_COMPRESSED 0x01
+
+/**
+ * The payload is a delta against the base.
+ */
+#define MIN_HTTPD_OTA_PAYLOAD_DELTA 0x02
+
+/**
+ * The maximum window of the compression, given as its logarithm.
+ *
+ * The window is part of ::min_httpd_ota_decoder .
+ */
+#define MIN_HTTPD_OTA_WINDOW_BITS 11
+
+/**
+ * The number of bytes of the base, that are read at once.
+ */
+#define MIN_HTTPD_OTA_BASE_CACHE_LEN 256
+
+/**
+ * The receiving side of a firmware upload.
+ */
+struct min_httpd_ota_transfer {
+    struct min_httpd_ota_sha256 sha256;
+    uint8_t expected[MIN_HTTPD_OTA_DIGEST_LEN];
+    size_t total;     // the announced length of the firmware
+    size_t received;  // bytes received (and hashed) so far
+    size_t reported;  // bytes received at the last progress
+    size_t step;      // bytes between progress
+};
+
+/**
+ * The result of a firmware upload.
+ */
+struct min_httpd_ota_result {
+    size_t len;          // bytes written to flash
+    size_t payload;      // bytes received
+    int64_t elapsed_us;  // from the first to the last byte written
+    int64_t stall_us;    // the receiving side waited for the flash
+};
+
+/**
+ * The instructions of a delta.
+ *
+ * Every instruction starts with its code. Lengths are unsigned *varints*
+ * (7 bits per byte, least significant first, the high bit continues), the
+ * positions in the base are relative to the end of the previous ``COPY`` or
+ * ``ADD`` as *zigzag* encoded varints.
+ */
+enum min_httpd_ota_delta_op {
+    MIN_HTTPD_OTA_DELTA_INSERT,  // length, bytes
+    MIN_HTTPD_OTA_DELTA_COPY,    // position, length
+    MIN_HTTPD_OTA_DELTA_ADD,     // position, length, bytes (modulo 256)
+};
+
+/**
+ * The status of a decoder.
+ */
+enum min_httpd_ota_decoder_status {
+    MIN_HTTPD_OTA_DECODER_HEADER,    // the header is incomplete
+    MIN_HTTPD_OTA_DECODER_FIRMWARE,  // the firmware's length is known
+    MIN_HTTPD_OTA_DECODER_DONE,      // the firmware is complete
+    MIN_HTTPD_OTA_DECODER_INVALID,   // the payload is invalid
+    MIN_HTTPD_OTA_DECODER_MISMATCH,  // the base does not match the delta
+};
+
+/**
+ * Read from the base of a delta.
+ *
+ * @param ctx    The context of the decoder.
+ * @param offset The offset in the base.
+ * @param data   The buffer.
+ * @param len    The number of bytes to read.
+ * @return bool ``true`` on success.
+ */
+typedef bool (*min_httpd_ota_read_base)(void* ctx,
+                                        size_t offset,
+                                        void* data,
+                                        size_t len);
+
+/**
+ * The decoder of a payload.
+ *
+ * Only ``status`` and ``len`` are meant to be read, everything else is the
+ * decoder's internal state.
+ */
+struct min_httpd_ota_decoder {
+    enum min_httpd_ota_decoder_status status;
+    size_t len;          // the length of the firmware (after the header)
+    size_t produced;     // bytes of the firmware so far
+    size_t payload_len;  // the length of the payload
+    size_t consumed;     // bytes of the payload so far
+    min_httpd_ota_read_base read_base;
+    void* ctx;
+
+    // the header
+    uint8_t header[MIN_HTTPD_OTA_PAYLOAD_HEADER_LEN];
+    size_t header_len;
+    uint8_t flags;
+    size_t stream_len;  // the length of the decompressed payload
+    size_t stream_pos;
+
+    // the decompression
+    uint8_t window_bits;
+    uint8_t lookahead_bits;
+    uint8_t lz_state;
+    uint8_t bit_count;
+    uint32_t bits;
+    uint32_t head;
+    uint32_t copy_index;
+    uint32_t copy_count;
+    uint8_t window[1 << MIN_HTTPD_OTA_WINDOW_BITS];
+
+    // the delta
+    uint8_t delta_state;
+    uint8_t op;
+    uint8_t shift;
+    uint32_t varint;
+    size_t count;
+    size_t base_len;
+    size_t base_pos;
+    size_t cache_offset;
+    size_t cache_len;
+    uint8_t cache[MIN_HTTPD_OTA_BASE_CACHE_LEN];
+};
+
+
+/**
+ * Parse a SHA-256 digest, given as 64 hexadecimal digits.
+ *
+ * @param hex    The digits, ``\0``-terminated (upper or lower case).
+ * @param digest The digest.
+ * @return bool ``true`` on success, ``false`` if ``hex`` is no digest.
+ */
+bool min_httpd_ota_digest_parse(const char* hex,
+                                uint8_t digest[MIN_HTTPD_OTA_DIGEST_LEN]);
+
+/**
+ * Check the ``Authorization`` header of an upload.
+ *
+ * The header must provide ``token`` with the scheme ``Bearer``. All
+ * characters of the token are compared, so the time does not reveal how many
+ * of them match.
+ *
+ * @param authorization The value of the header, ``\0``-terminated.
+ * @param token         The shared token, ``\0``-terminated.
+ * @return bool ``true`` if the header provides the token, ``false`` if it
+ *              does not or the token is empty.
+ */
+bool min_httpd_ota_token_match(const char* authorization, const char* token);
+
+/**
+ * Initialize a transfer.
+ *
+ * @param transfer The transfer.
+ * @param total    The announced length of the firmware.
+ * @param expected The announced digest of the firmware.
+ * @param step     The number of bytes between progress, ``0`` to only
+ *                 report the completion.
+ */
+void min_httpd_ota_transfer_init(
+    struct min_httpd_ota_transfer* transfer,
+    size_t total,
+    const uint8_t expected[MIN_HTTPD_OTA_DIGEST_LEN],
+    size_t step);
+
+/**
+ * Account a received chunk of the firmware.
+ *
+ * @param transfer The transfer.
+ * @param data     The chunk.
+ * @param len      The length of ``data``.
+ * @return bool ``true`` if the progress should be reported, i.e. a step was
+ *              completed or the transfer is complete.
+ */
+bool min_httpd_ota_transfer_update(struct min_httpd_ota_transfer* transfer,
+                                   const void* data,
+                                   size_t len);
+
+/**
+ * Verify a complete transfer.
+ *
+ * The hash is finished in any case, so this must be called exactly once for
+ * every transfer, even if the transfer failed, to release the hash. A
+ * transfer, that was zero-initialized and not yet initialized, may be passed.
+ *
+ * @param transfer The transfer, that is finished.
+ * @return bool ``true`` if the announced length was received and its digest
+ *              matches the announced digest.
+ */
+bool min_httpd_ota_transfer_verify(struct min_httpd_ota_transfer* transfer);
+
+/**
+ * Initialize a decoder.
+ *
+ * @param decoder     The decoder.
+ * @param payload_len The length of the payload.
+ * @param read_base   The callback, that reads the base of a delta.
+ * @param ctx         The context of ``read_base``.
+ */
+void min_httpd_ota_decoder_init(struct min_httpd_ota_decoder* decoder,
+                                size_t payload_len,
+                                min_httpd_ota_read_base read_base,
+                                void* ctx);
+
+/**
+ * Decode a chunk of the payload.
+ *
+ * The decoder consumes the payload until ``out`` is full, the payload is
+ * exhausted or the firmware is complete, so it must be called again with
+ * the remaining payload, if ``out`` is full. A payload, that ends before the
+ * firmware is complete or continues after it, is invalid.
+ *
+ * The base of a delta is verified, as soon as the header is complete, which
+ * reads all of the base.
+ *
+ * @param decoder  The decoder.
+ * @param in       The payload, that is advanced by the consumed bytes.
+ * @param in_len   The length of ``in``, that is reduced accordingly.
+ * @param out      The buffer of the firmware.
+ * @param out_size The size of ``out``.
+ * @return size_t The number of bytes of the firmware, that were written to
+ *                ``out``. See ``status`` for errors and completion.
+ */
+size_t min_httpd_ota_decoder_run(struct min_httpd_ota_decoder* decoder,
+                                 const uint8_t** in,
+                                 size_t* in_len,
+                                 uint8_t* out,
+                                 size_t out_size);
+
+/**
+ * Calculate a throughput.
+ *
+ * @param len        The number of bytes.
+ * @param elapsed_us The time, given in microseconds.
+ * @return uint32_t The throughput, given in bytes per second.
+ */
+uint32_t min_httpd_ota_rate(size_t len, int64_t elapsed_us);
+
+/**
+ * Write the body of the response to a successful upload.
+ *
+ * The body is a JSON document, e.g.
+ * ``{"len":917504,"payload":412380,"ms":2210,"rate":415160,"stall_ms":1630}``.
+ *
+ * @param buf    The buffer.
+ * @param size   The size of ``buf``.
+ * @param result The result of the upload.
+ * @return size_t The length of the body, ``0`` if ``buf`` is too small.
+ */
+size_t min_httpd_ota_result_json(char* buf,
+                                 size_t size,
+                                 const struct min_httpd_ota_result* result);
+
+#endif  // SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_OTA_ENGINE_H_
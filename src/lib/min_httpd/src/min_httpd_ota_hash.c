@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * SHA-256 of the ``min_httpd`` component's firmware upload.
+ *
+ * The functions of **mbedtls** 2.x (as shipped with **ESP-IDF** v4.4) return
+ * an error code, that is only set if the hardware accelerator fails. It is
+ * ignored: a failure results in a wrong digest, which rejects the firmware
+ * anyway.
+ *
+ * @file   min_httpd_ota_hash.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "min_httpd_ota_hash.h"
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+// Documentation in header file!
+void min_httpd_ota_sha256_init(struct min_httpd_ota_sha256* sha256) {
+    mbedtls_sha256_init(&sha256->context);
+    mbedtls_sha256_starts_ret(&sha256->context, 0);  // 0: SHA-256, not SHA-224
+}
+
+// Documentation in header file!
+void min_httpd_ota_sha256_update(struct min_httpd_ota_sha256* sha256,
+                                 const void* data,
+                                 size_t len) {
+    mbedtls_sha256_update_ret(&sha256->context, data, len);
+}
+
+// Documentation in header file!
+void min_httpd_ota_sha256_finish(struct min_httpd_ota_sha256* sha256,
+                                 uint8_t digest[MIN_HTTPD_OTA_DIGEST_LEN]) {
+    mbedtls_sha256_finish_ret(&sha256->context, digest);
+    mbedtls_sha256_free(&sha256->context);
+}
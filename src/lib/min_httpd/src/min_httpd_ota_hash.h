@@ -0,0 +1,77 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The hash of the ``min_httpd`` component's firmware upload.
+ *
+ * This is a thin interface to SHA-256 of **mbedtls**, which uses the
+ * **ESP32**'s hardware acceleration, if it is available. The engine (see
+ * min_httpd_ota_engine.h ) only uses these functions, so the host build may
+ * provide its own ``mbedtls/sha256.h`` (see ``tools/min_httpd/ota``).
+ *
+ * @file   min_httpd_ota_hash.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_OTA_HASH_H_
+#define SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_OTA_HASH_H_
+
+/* C's standard libraries. */
+#include <stddef.h>
+#include <stdint.h>
+
+/* SHA-256 of mbedtls. */
+#include "mbedtls/sha256.h"
+
+
+/**
+ * The length of a SHA-256 digest.
+ */
+#define MIN_HTTPD_OTA_DIGEST_LEN 32
+
+/**
+ * The state of a SHA-256 computation.
+ *
+ * A zero-initialized state is equivalent to a state, that was initialized
+ * with ::min_httpd_ota_sha256_init , but hashed nothing.
+ */
+struct min_httpd_ota_sha256 {
+    mbedtls_sha256_context context;
+};
+
+
+/**
+ * Initialize a SHA-256 computation.
+ *
+ * @param sha256 The state.
+ */
+void min_httpd_ota_sha256_init(struct min_httpd_ota_sha256* sha256);
+
+/**
+ * Hash data.
+ *
+ * @param sha256 The state.
+ * @param data   The data.
+ * @param len    The length of ``data``.
+ */
+void min_httpd_ota_sha256_update(struct min_httpd_ota_sha256* sha256,
+                                 const void* data,
+                                 size_t len);
+
+/**
+ * Finish a SHA-256 computation.
+ *
+ * The state is released (the hardware accelerator may be locked until
+ * then), so it must be initialized again to be reused.
+ *
+ * @param sha256 The state.
+ * @param digest The digest.
+ */
+void min_httpd_ota_sha256_finish(struct min_httpd_ota_sha256* sha256,
+                                 uint8_t digest[MIN_HTTPD_OTA_DIGEST_LEN]);
+
+#endif  // SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_OTA_HASH_H_
@@ -0,0 +1,295 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Server-Sent Events stream of the ``min_httpd`` component.
+ *
+ * Clients request ::MIN_HTTPD_SSE_URI (e.g. with ``curl -N`` or a browser's
+ * ``EventSource``). The handler answers with the head of a
+ * ``text/event-stream`` response and returns immediately, keeping the
+ * session open, so the server's task is not pinned by the stream. Events are
+ * sent to the session's socket afterwards, by functions, that are queued with
+ * the server's task (see ::min_httpd_queue_work ).
+ *
+ * Other components publish events with ::min_httpd_sse_publish . The event is
+ * built once and shared by the clients' bounded queues, which coalesce events
+ * of the same name and drop the oldest event, if they are full (see
+ * min_httpd_sse_engine.c ).
+ *
+ * The clients are only accessed from the server's task, so they are not
+ * locked.
+ *
+ * @file   min_httpd_sse.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <string.h>
+
+/* Other headers of the component. */
+#include "min_httpd/min_httpd.h"   // The public header
+#include "min_httpd_internal.h"    // modules of the component
+#include "min_httpd_sse_engine.h"  // events and clients
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* This is EPS-IDF's http server library. */
+#include "esp_http_server.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* FreeRTOS headers.
+ * - the ``FreeRTOS.h`` is required
+ */
+#include "freertos/FreeRTOS.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The head of the stream's response.
+ *
+ * There is neither a ``Content-Length`` nor ``chunked`` encoding, the stream
+ * ends with the session. ``retry`` lets clients reconnect after 5 seconds.
+ */
+#define MIN_HTTPD_SSE_RESPONSE_HEAD       \
+    "HTTP/1.1 200 OK\r\n"                 \
+    "Content-Type: text/event-stream\r\n" \
+    "Cache-Control: no-store\r\n"         \
+    "\r\n"                                \
+    "retry: 5000\n\n"
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "krachkiste.httpd.sse";
+
+/**
+ * The storage of ::min_httpd_sse_clients_set .
+ */
+static struct min_httpd_sse_client
+    min_httpd_sse_storage[MIN_HTTPD_SSE_MAX_CLIENTS];
+
+/**
+ * The clients, only accessed from the server's task.
+ */
+static struct min_httpd_sse_clients min_httpd_sse_clients_set = {0};
+
+/**
+ * The number of clients, as seen by other tasks.
+ */
+static volatile size_t min_httpd_sse_client_count = 0;
+
+/**
+ * The number of events, that are queued with the server's task.
+ */
+static size_t min_httpd_sse_pending = 0;
+
+/**
+ * Protect ::min_httpd_sse_pending .
+ */
+static portMUX_TYPE min_httpd_sse_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * The server, only accessed from the server's task.
+ */
+static httpd_handle_t min_httpd_sse_server = NULL;
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static void min_httpd_sse_flush(void);
+static esp_err_t min_httpd_sse_handler(httpd_req_t* request);
+static void min_httpd_sse_publish_work(void* arg);
+
+
+/* ***** URI DEFINITIONS ***************************************************
+ * (technically, these are ``variables``, but as the handler functions must be
+ *  referenced, these must come after the ``prototypes``)
+ */
+
+/**
+ * Route definition of the Server-Sent Events stream.
+ */
+static const struct min_httpd_route min_httpd_sse_route = {
+    .uri = MIN_HTTPD_SSE_URI,
+    .method = HTTP_GET,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = min_httpd_sse_handler,
+    .user_ctx = NULL,
+    .cost = MIN_HTTPD_LIMIT_COST_UPGRADE};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Send the queued events of all clients and close failed sessions.
+ *
+ * This runs in the server's task.
+ */
+static void min_httpd_sse_flush(void) {
+    int closed[MIN_HTTPD_SSE_MAX_CLIENTS];
+
+    size_t count = min_httpd_sse_clients_flush(&min_httpd_sse_clients_set,
+                                               closed);
+    min_httpd_sse_client_count = min_httpd_sse_clients_set.count;
+
+    for (size_t i = 0; i < count; i++) {
+        ESP_LOGD(TAG, "Closing client %d", closed[i]);
+        httpd_sess_trigger_close(min_httpd_sse_server, closed[i]);
+    }
+}
+
+/**
+ * Queue an event for all clients and send it.
+ *
+ * This is queued with ::min_httpd_queue_work and runs in the server's task.
+ * Events, that a client could not take before, are sent first.
+ *
+ * @param arg The event (::min_httpd_sse_event ), whose reference is released.
+ */
+static void min_httpd_sse_publish_work(void* arg) {
+    struct min_httpd_sse_event* event = arg;
+
+    min_httpd_sse_clients_publish(&min_httpd_sse_clients_set, event);
+    min_httpd_sse_event_release(event);
+    min_httpd_sse_flush();
+
+    portENTER_CRITICAL(&min_httpd_sse_lock);
+    min_httpd_sse_pending--;
+    portEXIT_CRITICAL(&min_httpd_sse_lock);
+}
+
+/**
+ * The handler of the Server-Sent Events stream.
+ *
+ * The head of the response is sent directly, the response is never finished
+ * with ``esp_http_server``'s functions. The session stays open and is added
+ * to the clients, which receive the retained events immediately.
+ *
+ * The matching *route definition* is ::min_httpd_sse_route .
+ *
+ * @param request The request that should be responded to with this function.
+ * @return ``ESP_OK`` to keep the session open, ``ESP_FAIL`` to close it.
+ */
+static esp_err_t min_httpd_sse_handler(httpd_req_t* request) {
+    if (min_httpd_sse_clients_set.count >= MIN_HTTPD_SSE_MAX_CLIENTS) {
+        ESP_LOGW(TAG, "Rejecting client, limit reached!");
+        httpd_resp_set_status(request, "503 Service Unavailable");
+        httpd_resp_send(request, NULL, 0);
+        min_httpd_log_message(request, ESP_FAIL);
+        return ESP_FAIL;
+    }
+
+    const size_t head_len = sizeof(MIN_HTTPD_SSE_RESPONSE_HEAD) - 1;
+    if (httpd_send(request, MIN_HTTPD_SSE_RESPONSE_HEAD, head_len) !=
+        (int)head_len) {
+        min_httpd_log_message(request, ESP_FAIL);
+        return ESP_FAIL;
+    }
+
+    min_httpd_sse_clients_add(&min_httpd_sse_clients_set,
+                              httpd_req_to_sockfd(request));
+    min_httpd_sse_flush();
+
+    min_httpd_log_message(request, ESP_OK);
+    return ESP_OK;
+}
+
+// Documentation in header file!
+void min_httpd_sse_attach(httpd_handle_t server) {
+    ESP_LOGV(TAG, "min_httpd_sse_attach()");
+
+    if (!MIN_HTTPD_SSE_ENABLED)
+        return;
+
+    min_httpd_sse_server = server;
+    min_httpd_sse_clients_init(&min_httpd_sse_clients_set,
+                               min_httpd_sse_storage,
+                               MIN_HTTPD_SSE_MAX_CLIENTS);
+    min_httpd_sse_client_count = 0;
+
+    if (min_httpd_register_route(server, &min_httpd_sse_route) != ESP_OK)
+        ESP_LOGE(TAG, "Could not register '%s'!", MIN_HTTPD_SSE_URI);
+}
+
+// Documentation in header file!
+void min_httpd_sse_detach(void) {
+    ESP_LOGV(TAG, "min_httpd_sse_detach()");
+
+    if (!MIN_HTTPD_SSE_ENABLED)
+        return;
+
+    min_httpd_sse_clients_clear(&min_httpd_sse_clients_set);
+    min_httpd_sse_server = NULL;
+    min_httpd_sse_client_count = 0;
+}
+
+// Documentation in header file!
+void min_httpd_sse_session_closed(int sockfd) {
+    if (min_httpd_sse_clients_remove(&min_httpd_sse_clients_set, sockfd))
+        min_httpd_sse_client_count = min_httpd_sse_clients_set.count;
+}
+
+// Documentation in header file!
+esp_err_t min_httpd_sse_publish(const char* name,
+                                const char* data,
+                                size_t len) {
+    ESP_LOGV(TAG, "min_httpd_sse_publish()");
+
+    if (!MIN_HTTPD_SSE_ENABLED)
+        return ESP_ERR_NOT_SUPPORTED;
+    if ((name == NULL) || ((data == NULL) && (len > 0)))
+        return ESP_ERR_INVALID_ARG;
+    if (strlen(name) >= MIN_HTTPD_SSE_NAME_LEN)
+        return ESP_ERR_INVALID_ARG;
+    if (len > MIN_HTTPD_SSE_MAX_EVENT_LEN)
+        return ESP_ERR_INVALID_SIZE;
+
+    portENTER_CRITICAL(&min_httpd_sse_lock);
+    bool accepted = min_httpd_sse_pending < MIN_HTTPD_SSE_MAX_PENDING;
+    if (accepted)
+        min_httpd_sse_pending++;
+    portEXIT_CRITICAL(&min_httpd_sse_lock);
+    if (!accepted)
+        return ESP_ERR_NO_MEM;
+
+    struct min_httpd_sse_event* event =
+        min_httpd_sse_event_create(name, data, len);
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    if (event != NULL)
+        ret = min_httpd_queue_work(min_httpd_sse_publish_work, event);
+
+    if (ret != ESP_OK) {
+        min_httpd_sse_event_release(event);
+        portENTER_CRITICAL(&min_httpd_sse_lock);
+        min_httpd_sse_pending--;
+        portEXIT_CRITICAL(&min_httpd_sse_lock);
+    }
+    return ret;
+}
+
+// Documentation in header file!
+size_t min_httpd_sse_get_clients(void) {
+    return min_httpd_sse_client_count;
+}
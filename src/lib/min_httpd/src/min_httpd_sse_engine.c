@@ -0,0 +1,333 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's Server-Sent Events stream.
+ *
+ * The queue of a client is a ring of references. The head of the queue may be
+ * sent partially, so it is never coalesced or dropped.
+ *
+ * **Resources:**
+ *   - https://html.spec.whatwg.org/multipage/server-sent-events.html
+ *
+ * @file   min_httpd_sse_engine.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "min_httpd_sse_engine.h"
+
+/* C's standard libraries. */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The BSD socket API, provided by lwIP on the ESP32. */
+#include <sys/socket.h>
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * Flags of ``send()``.
+ *
+ * ``MSG_NOSIGNAL`` keeps a closed client from raising ``SIGPIPE`` on the
+ * host; lwIP ignores it.
+ */
+#ifdef MSG_NOSIGNAL
+#define MIN_HTTPD_SSE_SEND_FLAGS (MSG_DONTWAIT | MSG_NOSIGNAL)
+#else
+#define MIN_HTTPD_SSE_SEND_FLAGS MSG_DONTWAIT
+#endif
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static void min_httpd_sse_client_push(struct min_httpd_sse_clients* clients,
+                                      struct min_httpd_sse_client* client,
+                                      struct min_httpd_sse_event* event);
+static int min_httpd_sse_client_flush(struct min_httpd_sse_clients* clients,
+                                      struct min_httpd_sse_client* client);
+static void min_httpd_sse_client_release(struct min_httpd_sse_client* client);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+// Documentation in header file!
+struct min_httpd_sse_event* min_httpd_sse_event_create(const char* name,
+                                                       const char* data,
+                                                       size_t len) {
+    size_t name_len = strlen(name);
+    if (name_len >= MIN_HTTPD_SSE_NAME_LEN)
+        return NULL;
+
+    size_t lines = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == '\n')
+            lines++;
+    }
+
+    /* "event: " name "\n", "data: " line "\n" per line, "\n" */
+    size_t text_len = 7 + name_len + 1 + lines * 7 + (len - (lines - 1)) + 1;
+    struct min_httpd_sse_event* event = malloc(sizeof(*event) + text_len);
+    if (event == NULL)
+        return NULL;
+
+    event->refs = 1;
+    memcpy(event->name, name, name_len + 1);
+
+    char* ptr = event->text;
+    memcpy(ptr, "event: ", 7);
+    ptr += 7;
+    memcpy(ptr, name, name_len);
+    ptr += name_len;
+    *ptr++ = '\n';
+
+    const char* line = data;
+    const char* end = data + len;
+    for (;;) {
+        const char* next =
+            (line < end) ? memchr(line, '\n', (size_t)(end - line)) : NULL;
+        size_t line_len = (next != NULL) ? (size_t)(next - line)
+                                         : (size_t)(end - line);
+        memcpy(ptr, "data: ", 6);
+        ptr += 6;
+        memcpy(ptr, line, line_len);
+        ptr += line_len;
+        *ptr++ = '\n';
+        if (next == NULL)
+            break;
+        line = next + 1;
+    }
+    *ptr++ = '\n';
+
+    event->len = (size_t)(ptr - event->text);
+    return event;
+}
+
+// Documentation in header file!
+void min_httpd_sse_event_release(struct min_httpd_sse_event* event) {
+    if ((event != NULL) && (--event->refs == 0))
+        free(event);
+}
+
+// Documentation in header file!
+void min_httpd_sse_clients_init(struct min_httpd_sse_clients* clients,
+                                struct min_httpd_sse_client* storage,
+                                size_t size) {
+    memset(clients, 0, sizeof(*clients));
+    clients->clients = storage;
+    clients->size = size;
+
+    memset(storage, 0, size * sizeof(*storage));
+    for (size_t i = 0; i < size; i++)
+        storage[i].socket = -1;
+}
+
+// Documentation in header file!
+void min_httpd_sse_clients_clear(struct min_httpd_sse_clients* clients) {
+    for (size_t i = 0; i < clients->size; i++) {
+        if (clients->clients[i].socket >= 0)
+            min_httpd_sse_client_release(&clients->clients[i]);
+    }
+    clients->count = 0;
+
+    for (size_t i = 0; i < MIN_HTTPD_SSE_RETAINED; i++) {
+        min_httpd_sse_event_release(clients->retained[i]);
+        clients->retained[i] = NULL;
+    }
+}
+
+// Documentation in header file!
+bool min_httpd_sse_clients_add(struct min_httpd_sse_clients* clients,
+                               int socket) {
+    struct min_httpd_sse_client* client = NULL;
+    for (size_t i = 0; i < clients->size; i++) {
+        if (clients->clients[i].socket < 0) {
+            client = &clients->clients[i];
+            break;
+        }
+    }
+    if (client == NULL)
+        return false;
+
+    client->socket = socket;
+    client->head = 0;
+    client->count = 0;
+    client->offset = 0;
+    clients->count++;
+
+    for (size_t i = 0; i < MIN_HTTPD_SSE_RETAINED; i++) {
+        if (clients->retained[i] != NULL)
+            min_httpd_sse_client_push(clients, client, clients->retained[i]);
+    }
+    return true;
+}
+
+// Documentation in header file!
+bool min_httpd_sse_clients_remove(struct min_httpd_sse_clients* clients,
+                                  int socket) {
+    for (size_t i = 0; i < clients->size; i++) {
+        if (clients->clients[i].socket == socket) {
+            min_httpd_sse_client_release(&clients->clients[i]);
+            clients->count--;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Release the queue of a client and mark its slot as unused.
+ *
+ * @param client The client.
+ */
+static void min_httpd_sse_client_release(struct min_httpd_sse_client* client) {
+    for (size_t i = 0; i < client->count; i++) {
+        size_t index = (client->head + i) % MIN_HTTPD_SSE_QUEUE_LEN;
+        min_httpd_sse_event_release(client->queue[index]);
+        client->queue[index] = NULL;
+    }
+    client->socket = -1;
+    client->count = 0;
+    client->offset = 0;
+}
+
+/**
+ * Queue an event for a client.
+ *
+ * The event replaces a queued event of the same name, unless that event is
+ * being sent. If the queue is full, the oldest event, that is not being sent,
+ * is dropped.
+ *
+ * @param clients The clients, providing the counters.
+ * @param client  The client.
+ * @param event   The event, which is referenced by the queue.
+ */
+static void min_httpd_sse_client_push(struct min_httpd_sse_clients* clients,
+                                      struct min_httpd_sse_client* client,
+                                      struct min_httpd_sse_event* event) {
+    size_t first = (client->offset > 0) ? 1 : 0;
+
+    for (size_t i = first; i < client->count; i++) {
+        size_t index = (client->head + i) % MIN_HTTPD_SSE_QUEUE_LEN;
+        if (strcmp(client->queue[index]->name, event->name) == 0) {
+            min_httpd_sse_event_release(client->queue[index]);
+            event->refs++;
+            client->queue[index] = event;
+            clients->coalesced++;
+            return;
+        }
+    }
+
+    if (client->count == MIN_HTTPD_SSE_QUEUE_LEN) {
+        size_t index = (client->head + first) % MIN_HTTPD_SSE_QUEUE_LEN;
+        min_httpd_sse_event_release(client->queue[index]);
+
+        /* Keep the head (being sent) in front of the remaining events. */
+        if (first == 1)
+            client->queue[index] = client->queue[client->head];
+        client->head = (client->head + 1) % MIN_HTTPD_SSE_QUEUE_LEN;
+        client->count--;
+        clients->dropped++;
+    }
+
+    event->refs++;
+    client->queue[(client->head + client->count) % MIN_HTTPD_SSE_QUEUE_LEN] =
+        event;
+    client->count++;
+}
+
+// Documentation in header file!
+void min_httpd_sse_clients_publish(struct min_httpd_sse_clients* clients,
+                                   struct min_httpd_sse_event* event) {
+    clients->events++;
+
+    /* Retain the event, replacing the previous event of the same name. */
+    struct min_httpd_sse_event** slot = NULL;
+    for (size_t i = 0; i < MIN_HTTPD_SSE_RETAINED; i++) {
+        struct min_httpd_sse_event* retained = clients->retained[i];
+        if ((retained != NULL) && (strcmp(retained->name, event->name) == 0)) {
+            slot = &clients->retained[i];
+            break;
+        }
+        if ((retained == NULL) && (slot == NULL))
+            slot = &clients->retained[i];
+    }
+    if (slot != NULL) {
+        min_httpd_sse_event_release(*slot);
+        event->refs++;
+        *slot = event;
+    }
+
+    for (size_t i = 0; i < clients->size; i++) {
+        if (clients->clients[i].socket >= 0)
+            min_httpd_sse_client_push(clients, &clients->clients[i], event);
+    }
+}
+
+/**
+ * Send the queued events of a client, without blocking.
+ *
+ * @param clients The clients, providing the counters.
+ * @param client  The client.
+ * @return int ``1`` if the queue is empty, ``0`` if the client can not take
+ *             more data and ``-1`` on failure (with ``errno`` set).
+ */
+static int min_httpd_sse_client_flush(struct min_httpd_sse_clients* clients,
+                                      struct min_httpd_sse_client* client) {
+    while (client->count > 0) {
+        struct min_httpd_sse_event* event = client->queue[client->head];
+
+        ssize_t ret = send(client->socket,
+                           event->text + client->offset,
+                           event->len - client->offset,
+                           MIN_HTTPD_SSE_SEND_FLAGS);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                return 0;
+            return -1;
+        }
+
+        client->offset += (size_t)ret;
+        if (client->offset < event->len)
+            continue;
+
+        min_httpd_sse_event_release(event);
+        client->queue[client->head] = NULL;
+        client->head = (client->head + 1) % MIN_HTTPD_SSE_QUEUE_LEN;
+        client->count--;
+        client->offset = 0;
+        clients->sent++;
+    }
+    return 1;
+}
+
+// Documentation in header file!
+size_t min_httpd_sse_clients_flush(struct min_httpd_sse_clients* clients,
+                                   int* closed) {
+    size_t removed = 0;
+
+    for (size_t i = 0; i < clients->size; i++) {
+        struct min_httpd_sse_client* client = &clients->clients[i];
+        if ((client->socket < 0) || (client->count == 0))
+            continue;
+
+        if (min_httpd_sse_client_flush(clients, client) < 0) {
+            closed[removed++] = client->socket;
+            min_httpd_sse_client_release(client);
+            clients->count--;
+            clients->closed++;
+        }
+    }
+
+    return removed;
+}
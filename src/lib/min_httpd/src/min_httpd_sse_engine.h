@@ -0,0 +1,195 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's Server-Sent Events stream.
+ *
+ * An event is built once into its wire format and shared by all clients,
+ * which hold a reference to it in their queue. The queues are bounded:
+ *
+ *   - an event replaces a queued event of the same name, that was not sent
+ *     yet (*coalescing*), so a client always receives the most recent state;
+ *   - if the queue is full nonetheless, the oldest event is dropped.
+ *
+ * Events are sent without blocking. An event, that is sent partially, is
+ * continued with the next flush, so the stream stays intact.
+ *
+ * The most recent event of every name is retained, so a new client receives
+ * the current state immediately.
+ *
+ * The engine does not lock and only depends on the BSD socket API, so it
+ * builds with **ESP-IDF** (lwIP) and on a Linux host (see
+ * ``tools/min_httpd/sse``). Locking is the responsibility of the caller (see
+ * min_httpd_sse.c ).
+ *
+ * **Resources:**
+ *   - https://html.spec.whatwg.org/multipage/server-sent-events.html
+ *
+ * @file   min_httpd_sse_engine.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_SSE_ENGINE_H_
+#define SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_SSE_ENGINE_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * The maximum length of an event's name, including the terminating ``\0``.
+ */
+#define MIN_HTTPD_SSE_NAME_LEN 16
+
+/**
+ * The maximum number of events, that are queued for a client.
+ */
+#define MIN_HTTPD_SSE_QUEUE_LEN 8
+
+/**
+ * The maximum number of retained events (names).
+ */
+#define MIN_HTTPD_SSE_RETAINED 4
+
+/**
+ * An event in its wire format, shared by reference.
+ */
+struct min_httpd_sse_event {
+    uint32_t refs;
+    char name[MIN_HTTPD_SSE_NAME_LEN];
+    size_t len;
+    char text[];  // ``event: <name>\n``, ``data: <line>\n`` per line, ``\n``
+};
+
+/**
+ * A client of the stream.
+ *
+ * The members are managed by the engine and must not be modified.
+ */
+struct min_httpd_sse_client {
+    int socket;  // ``-1`` marks an unused slot
+    struct min_httpd_sse_event* queue[MIN_HTTPD_SSE_QUEUE_LEN];
+    size_t head;
+    size_t count;
+    size_t offset;  // the bytes of the head of the queue, that were sent
+};
+
+/**
+ * The clients of the stream.
+ *
+ * The storage is provided by the caller, see ::min_httpd_sse_clients_init .
+ */
+struct min_httpd_sse_clients {
+    struct min_httpd_sse_client* clients;
+    size_t size;
+    size_t count;
+    struct min_httpd_sse_event* retained[MIN_HTTPD_SSE_RETAINED];
+
+    uint32_t events;     // events passed to ::min_httpd_sse_clients_publish
+    uint32_t sent;       // events sent to a client
+    uint32_t coalesced;  // queued events replaced by a newer one
+    uint32_t dropped;    // queued events dropped, as a queue was full
+    uint32_t closed;     // clients removed, as sending failed
+};
+
+
+/**
+ * Build an event.
+ *
+ * ``data`` may span several lines, every line is sent as a ``data:`` field.
+ *
+ * @param name The event's name (``event:`` field), e.g. ``status``.
+ * @param data The event's data, e.g. a JSON document.
+ * @param len  The length of ``data``.
+ * @return struct min_httpd_sse_event* The event with a single reference,
+ *         ``NULL`` if the name is too long or memory is exhausted.
+ */
+struct min_httpd_sse_event* min_httpd_sse_event_create(const char* name,
+                                                       const char* data,
+                                                       size_t len);
+
+/**
+ * Release a reference to an event.
+ *
+ * The event is freed with its last reference.
+ *
+ * @param event The event, may be ``NULL``.
+ */
+void min_httpd_sse_event_release(struct min_httpd_sse_event* event);
+
+/**
+ * Initialize the clients of a stream.
+ *
+ * @param clients The clients to be initialized.
+ * @param storage The storage of the clients.
+ * @param size    The number of entries of ``storage``.
+ */
+void min_httpd_sse_clients_init(struct min_httpd_sse_clients* clients,
+                                struct min_httpd_sse_client* storage,
+                                size_t size);
+
+/**
+ * Release all clients and retained events.
+ *
+ * The sockets are not closed.
+ *
+ * @param clients The clients.
+ */
+void min_httpd_sse_clients_clear(struct min_httpd_sse_clients* clients);
+
+/**
+ * Add a client.
+ *
+ * The retained events are queued for the client, they are sent with the
+ * next flush.
+ *
+ * @param clients The clients.
+ * @param socket  The client's socket.
+ * @return bool ``true`` if the client was added, ``false`` if the clients
+ *              are full.
+ */
+bool min_httpd_sse_clients_add(struct min_httpd_sse_clients* clients,
+                               int socket);
+
+/**
+ * Remove a client and release its queue.
+ *
+ * @param clients The clients.
+ * @param socket  The client's socket.
+ * @return bool ``true`` if the client was found.
+ */
+bool min_httpd_sse_clients_remove(struct min_httpd_sse_clients* clients,
+                                  int socket);
+
+/**
+ * Queue an event for all clients and retain it.
+ *
+ * The caller keeps its reference to the event.
+ *
+ * @param clients The clients.
+ * @param event   The event.
+ */
+void min_httpd_sse_clients_publish(struct min_httpd_sse_clients* clients,
+                                   struct min_httpd_sse_event* event);
+
+/**
+ * Send the queued events of all clients, without blocking.
+ *
+ * Clients, that fail, are removed and reported in ``closed``, so their
+ * sessions can be closed.
+ *
+ * @param clients The clients.
+ * @param closed  The sockets of removed clients, at least ``size`` of the
+ *                clients.
+ * @return size_t The number of removed clients.
+ */
+size_t min_httpd_sse_clients_flush(struct min_httpd_sse_clients* clients,
+                                   int* closed);
+
+#endif  // SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_SSE_ENGINE_H_
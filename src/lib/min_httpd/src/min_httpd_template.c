@@ -0,0 +1,159 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Compiled HTML templates of the ``min_httpd`` component.
+ *
+ * A template (see min_httpd_template.h ) is rendered directly into the
+ * response: every static segment and every run of a value is sent with
+ * ``httpd_resp_send_chunk()``, so there is no intermediate buffer.
+ *
+ * The component's homepage is the template ``templates/index.tpl.html``
+ * (see ::min_httpd_tpl_index ), that shows the application's description.
+ *
+ * @file   min_httpd_template.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* Other headers of the component. */
+#include "min_httpd/min_httpd.h"           // The public header
+#include "min_httpd/min_httpd_template.h"  // the compiled templates
+#include "min_httpd_internal.h"            // modules of the component
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* This is EPS-IDF's http server library. */
+#include "esp_http_server.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* This is ESP-IDF's OTA library.
+ * - provides the application's description
+ *   (``esp_ota_get_app_description()``)
+ */
+#include "esp_ota_ops.h"
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "krachkiste.httpd.template";
+
+/**
+ * The template of the component's homepage.
+ *
+ * This is generated by ``compile_html_template()`` (see the component's
+ * ``CMakeLists.txt``) from ``templates/index.tpl.html``.
+ */
+extern const struct min_httpd_template min_httpd_tpl_index;
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static bool min_httpd_template_send_chunk(void* ctx,
+                                          const char* data,
+                                          size_t len);
+static esp_err_t min_httpd_template_handler_index(httpd_req_t* request);
+
+
+/* ***** URI DEFINITIONS *************************************************** */
+
+/**
+ * Route definition for the component's homepage.
+ */
+static const struct min_httpd_route min_httpd_template_route_index = {
+    .uri = "/",
+    .method = HTTP_GET,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = min_httpd_template_handler_index,
+    .user_ctx = NULL,
+    .cost = MIN_HTTPD_LIMIT_COST_INLINE};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Send a part of a rendered template.
+ *
+ * This is the template's emit function.
+ *
+ * @param ctx  The request (``httpd_req_t``).
+ * @param data The part.
+ * @param len  The length of ``data``.
+ * @return bool ``true`` if the part was sent.
+ */
+static bool min_httpd_template_send_chunk(void* ctx,
+                                          const char* data,
+                                          size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t*)ctx, data, len) == ESP_OK;
+}
+
+/**
+ * Show the component's homepage.
+ *
+ * The matching *route definition* is ::min_httpd_template_route_index.
+ *
+ * @param request The request that should be responded to with this function.
+ * @return esp_err_t The return value of ::min_httpd_template_send .
+ */
+static esp_err_t min_httpd_template_handler_index(httpd_req_t* request) {
+    const esp_app_desc_t* app = esp_ota_get_app_description();
+    const struct min_httpd_template_value values[] = {
+        {"project", app->project_name},
+        {"version", app->version},
+        {"idf", app->idf_ver},
+    };
+
+    return min_httpd_template_send(request,
+                                   &min_httpd_tpl_index,
+                                   values,
+                                   sizeof(values) / sizeof(values[0]));
+}
+
+// Documentation in header file!
+esp_err_t min_httpd_template_send(
+    httpd_req_t* request,
+    const struct min_httpd_template* tpl,
+    const struct min_httpd_template_value* values,
+    size_t count) {
+    httpd_resp_set_type(request, "text/html");
+    httpd_resp_set_hdr(request, "Cache-Control", "no-store");
+
+    // The response is incomplete, so the session must be closed
+    esp_err_t return_value = ESP_FAIL;
+    if (min_httpd_template_render(tpl,
+                                  values,
+                                  count,
+                                  min_httpd_template_send_chunk,
+                                  request))
+        return_value = httpd_resp_send_chunk(request, NULL, 0);
+    min_httpd_log_message(request, return_value);
+
+    return return_value;
+}
+
+// Documentation in header file!
+void min_httpd_template_attach(httpd_handle_t server) {
+    if (min_httpd_register_route(server, &min_httpd_template_route_index) !=
+        ESP_OK)
+        ESP_LOGE(TAG, "Could not register the homepage!");
+}
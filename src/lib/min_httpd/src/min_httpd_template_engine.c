@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's compiled HTML templates.
+ *
+ * The functions are documented in min_httpd_template.h , as the templates
+ * are part of the component's public interface.
+ *
+ * @file   min_httpd_template_engine.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* The public header of the templates. */
+#include "min_httpd/min_httpd_template.h"
+
+/* C's standard libraries. */
+#include <string.h>
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static const char* min_httpd_template_value(
+    const struct min_httpd_template_value* values,
+    size_t count,
+    const char* name);
+static bool min_httpd_template_escaped(const char* value,
+                                       min_httpd_template_emit_t emit,
+                                       void* ctx);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Find the value of a placeholder.
+ *
+ * There are only a few values per page, so they are searched linearly.
+ *
+ * @param values The values.
+ * @param count  The number of ``values``.
+ * @param name   The name of the placeholder.
+ * @return const char* The value, ``NULL`` if there is none.
+ */
+static const char* min_httpd_template_value(
+    const struct min_httpd_template_value* values,
+    size_t count,
+    const char* name) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(values[i].name, name) == 0)
+            return values[i].value;
+    }
+    return NULL;
+}
+
+/**
+ * Emit a value, escaped for HTML.
+ *
+ * @param value The value.
+ * @param emit  The function to hand the parts to.
+ * @param ctx   The context of ``emit``.
+ * @return bool ``true`` if all parts were taken.
+ */
+static bool min_httpd_template_escaped(const char* value,
+                                       min_httpd_template_emit_t emit,
+                                       void* ctx) {
+    for (;;) {
+        size_t run = strcspn(value, "&<>\"'");
+        if ((run > 0) && !emit(ctx, value, run))
+            return false;
+        value += run;
+        if (*value == '\0')
+            return true;
+
+        const char* entity;
+        switch (*value) {
+            case '&':
+                entity = "&amp;";
+                break;
+            case '<':
+                entity = "&lt;";
+                break;
+            case '>':
+                entity = "&gt;";
+                break;
+            case '"':
+                entity = "&quot;";
+                break;
+            default:
+                entity = "&#39;";
+                break;
+        }
+        if (!emit(ctx, entity, strlen(entity)))
+            return false;
+        value++;
+    }
+}
+
+// Documentation in header file!
+bool min_httpd_template_render(const struct min_httpd_template* tpl,
+                               const struct min_httpd_template_value* values,
+                               size_t count,
+                               min_httpd_template_emit_t emit,
+                               void* ctx) {
+    for (size_t i = 0; i < tpl->count; i++) {
+        const struct min_httpd_template_segment* segment = &tpl->segments[i];
+
+        if ((segment->len > 0) && !emit(ctx, segment->text, segment->len))
+            return false;
+        if (segment->name == NULL)
+            continue;
+
+        const char* value =
+            min_httpd_template_value(values, count, segment->name);
+        if ((value != NULL) && !min_httpd_template_escaped(value, emit, ctx))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The trace points of the ``min_httpd`` component and the export.
+ *
+ * The component's trace points (inline routes, the fallback of assets and
+ * missing resources, the stages of offloaded jobs and the metrics) are a
+ * group of the trace buffers of ``obs32`` (see ``obs32/obs32_trace.h``), that
+ * is registered with the first server. The group is provided to the
+ * component's modules with min_httpd_internal.h .
+ *
+ * If the tracing is enabled, the rings of all registered groups are exported
+ * at ::MIN_HTTPD_TRACE_URI as Chrome trace JSON with the streaming JSON
+ * writer (see min_httpd_trace_engine.h ), in chunks of
+ * ::MIN_HTTPD_TRACE_CHUNK_LEN bytes.
+ *
+ * @file   min_httpd_trace.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <stdbool.h>
+
+/* Other headers of the component. */
+#include "min_httpd/min_httpd.h"     // The public header
+#include "min_httpd_internal.h"      // modules of the component
+#include "min_httpd_trace_engine.h"  // the export
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* This is EPS-IDF's http server library. */
+#include "esp_http_server.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static esp_err_t min_httpd_trace_handler(httpd_req_t* request);
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "krachkiste.httpd.trace";
+
+/**
+ * The names of the ::min_httpd_trace_point .
+ */
+static const char* const min_httpd_trace_names[] = {
+    "inline",
+    "fallback",
+    "offload_queued",
+    "offload_run",
+    "offload_complete",
+    "metrics",
+};
+
+// Documentation in min_httpd_internal.h!
+struct obs32_trace_group min_httpd_trace_group = {
+    .category = "min_httpd",
+    .names = min_httpd_trace_names,
+    .count = sizeof(min_httpd_trace_names) / sizeof(min_httpd_trace_names[0]),
+};
+
+
+/* ***** URI DEFINITIONS *************************************************** */
+
+/**
+ * Route definition for the export of the trace buffers.
+ */
+static const struct min_httpd_route min_httpd_trace_route = {
+    .uri = MIN_HTTPD_TRACE_URI,
+    .method = HTTP_GET,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = min_httpd_trace_handler,
+    .user_ctx = NULL,
+    .cost = MIN_HTTPD_LIMIT_COST_INLINE};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Provide the trace buffers as Chrome trace JSON.
+ *
+ * The matching *route definition* is ::min_httpd_trace_route .
+ *
+ * The trace points are ignored, while the rings are exported (see
+ * ::min_httpd_trace_export ).
+ *
+ * @param request The request that should be responded to with this function.
+ * @return esp_err_t ``ESP_OK`` if the response was sent, ``ESP_FAIL``
+ *                   otherwise, causing the session to be closed.
+ */
+static esp_err_t min_httpd_trace_handler(httpd_req_t* request) {
+    char chunk[MIN_HTTPD_TRACE_CHUNK_LEN];
+    struct min_httpd_json json;
+
+    min_httpd_json_response(&json, request, chunk, sizeof(chunk));
+    httpd_resp_set_hdr(request, "Cache-Control", "no-store");
+    min_httpd_trace_export(&json);
+    return min_httpd_json_send(&json);
+}
+
+// Documentation in min_httpd_internal.h!
+void min_httpd_trace_attach(httpd_handle_t server) {
+    obs32_trace_register(&min_httpd_trace_group);
+
+    if (!OBS32_TRACE_ENABLED)
+        return;
+
+    if (min_httpd_register_route(server, &min_httpd_trace_route) != ESP_OK)
+        ESP_LOGE(TAG, "Could not register the trace!");
+}
@@ -0,0 +1,215 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The export of the trace buffers of ``obs32``.
+ *
+ * The export walks the rings of the cores, oldest record first, and writes
+ * them with the streaming JSON writer.
+ *
+ * @file   min_httpd_trace_engine.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "min_httpd_trace_engine.h"
+
+
+/* ***** VARIABLES ********************************************************* */
+
+#if OBS32_TRACE_ENABLED
+/**
+ * The values of ``ph`` of the ::obs32_trace_phase .
+ */
+static const char* const min_httpd_trace_phases[] = {
+    NULL,
+    "B",
+    "E",
+    "i",
+};
+#endif
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+#if OBS32_TRACE_ENABLED
+static void min_httpd_trace_metadata(struct min_httpd_json* json,
+                                     const char* name,
+                                     unsigned int pid,
+                                     int tid,
+                                     const char* value);
+static void min_httpd_trace_metadata_thread(struct min_httpd_json* json,
+                                            unsigned int pid,
+                                            const struct obs32_trace_group*
+                                                group,
+                                            uint16_t point);
+#endif
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+#if OBS32_TRACE_ENABLED
+/**
+ * Write a metadata event, that names a process or a thread.
+ *
+ * @param json  The writer.
+ * @param name  The kind of the event, ``process_name`` or ``thread_name``.
+ * @param pid   The process.
+ * @param tid   The thread, ``-1`` to name the process.
+ * @param value The name.
+ */
+static void min_httpd_trace_metadata(struct min_httpd_json* json,
+                                     const char* name,
+                                     unsigned int pid,
+                                     int tid,
+                                     const char* value) {
+    min_httpd_json_object_begin(json);
+    min_httpd_json_key(json, "name");
+    min_httpd_json_string(json, name);
+    min_httpd_json_key(json, "ph");
+    min_httpd_json_string(json, "M");
+    min_httpd_json_key(json, "pid");
+    min_httpd_json_uint(json, pid);
+    if (tid >= 0) {
+        min_httpd_json_key(json, "tid");
+        min_httpd_json_uint(json, (uint64_t)tid);
+    }
+    min_httpd_json_key(json, "args");
+    min_httpd_json_object_begin(json);
+    min_httpd_json_key(json, "name");
+    min_httpd_json_string(json, value);
+    min_httpd_json_object_end(json);
+    min_httpd_json_object_end(json);
+}
+
+/**
+ * Write the metadata event, that names the thread of a trace point.
+ *
+ * The name is the group's category and the point's name, e.g.
+ * ``mnet32.dispatch``.
+ *
+ * @param json  The writer.
+ * @param pid   The process.
+ * @param group The group.
+ * @param point The index of the trace point in the group.
+ */
+static void min_httpd_trace_metadata_thread(struct min_httpd_json* json,
+                                            unsigned int pid,
+                                            const struct obs32_trace_group*
+                                                group,
+                                            uint16_t point) {
+    char name[48];
+    size_t len = 0;
+
+    for (const char* c = group->category; (*c != '\0') && (len < 31); c++)
+        name[len++] = *c;
+    name[len++] = '.';
+    for (const char* c = group->names[point];
+         (*c != '\0') && (len < sizeof(name) - 1);
+         c++)
+        name[len++] = *c;
+    name[len] = '\0';
+
+    min_httpd_trace_metadata(json,
+                             "thread_name",
+                             pid,
+                             group->base + point,
+                             name);
+}
+#endif  // OBS32_TRACE_ENABLED
+
+// Documentation in header file!
+void min_httpd_trace_export(struct min_httpd_json* json) {
+    min_httpd_json_object_begin(json);
+    min_httpd_json_key(json, "displayTimeUnit");
+    min_httpd_json_string(json, "ms");
+    min_httpd_json_key(json, "traceEvents");
+    min_httpd_json_array_begin(json);
+
+#if OBS32_TRACE_ENABLED
+    __atomic_store_n(&obs32_trace_paused, true, __ATOMIC_SEQ_CST);
+
+    uint32_t now = OBS32_TRACE_TIMESTAMP();
+    uint32_t heads[OBS32_TRACE_CORES];
+    uint32_t oldest = 0;
+
+    // The age of the oldest record is the origin of the timestamps
+    for (unsigned int core = 0; core < OBS32_TRACE_CORES; core++) {
+        const struct obs32_trace_ring* ring = &obs32_trace_rings[core];
+
+        heads[core] = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        for (uint32_t i = 0; i < OBS32_TRACE_LEN; i++) {
+            const struct obs32_trace_record* record = &ring->records[i];
+            uint32_t age = now - record->timestamp;
+            if ((record->id != 0) && (age > oldest))
+                oldest = age;
+        }
+    }
+
+    for (unsigned int core = 0; core < OBS32_TRACE_CORES; core++) {
+        const struct obs32_trace_ring* ring = &obs32_trace_rings[core];
+        char process[8] = "core 0";
+        process[5] = (char)('0' + core);
+
+        // Process 0 is reserved by some viewers
+        min_httpd_trace_metadata(json, "process_name", core + 1, -1, process);
+        for (const struct obs32_trace_group* group = obs32_trace_get_groups();
+             group != NULL;
+             group = group->next) {
+            if (__atomic_load_n(&group->base, __ATOMIC_ACQUIRE) == 0)
+                continue;
+            for (uint16_t point = 0; point < group->count; point++)
+                min_httpd_trace_metadata_thread(json, core + 1, group, point);
+        }
+
+        uint32_t count = (heads[core] < OBS32_TRACE_LEN)
+                             ? heads[core]
+                             : OBS32_TRACE_LEN;
+        for (uint32_t i = heads[core] - count; i != heads[core]; i++) {
+            const struct obs32_trace_record* record =
+                &ring->records[i & (OBS32_TRACE_LEN - 1)];
+            unsigned int phase = record->id >> OBS32_TRACE_POINT_BITS;
+            uint16_t point = record->id & ((1U << OBS32_TRACE_POINT_BITS) - 1);
+            const struct obs32_trace_group* group = obs32_trace_lookup(point);
+
+            if ((phase == 0) || (group == NULL))
+                continue;
+
+            min_httpd_json_object_begin(json);
+            min_httpd_json_key(json, "name");
+            min_httpd_json_string(json, group->names[point - group->base]);
+            min_httpd_json_key(json, "cat");
+            min_httpd_json_string(json, group->category);
+            min_httpd_json_key(json, "ph");
+            min_httpd_json_string(json, min_httpd_trace_phases[phase]);
+            if (phase == OBS32_TRACE_INSTANT) {
+                min_httpd_json_key(json, "s");
+                min_httpd_json_string(json, "t");
+            }
+            min_httpd_json_key(json, "ts");
+            min_httpd_json_uint(json, oldest - (now - record->timestamp));
+            min_httpd_json_key(json, "pid");
+            min_httpd_json_uint(json, core + 1);
+            min_httpd_json_key(json, "tid");
+            min_httpd_json_uint(json, point);
+            min_httpd_json_key(json, "args");
+            min_httpd_json_object_begin(json);
+            min_httpd_json_key(json, "arg");
+            min_httpd_json_uint(json, record->arg);
+            min_httpd_json_object_end(json);
+            min_httpd_json_object_end(json);
+        }
+    }
+
+    __atomic_store_n(&obs32_trace_paused, false, __ATOMIC_SEQ_CST);
+#endif
+
+    min_httpd_json_array_end(json);
+    min_httpd_json_object_end(json);
+}
@@ -0,0 +1,49 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's trace export.
+ *
+ * The trace buffers are provided by the ``obs32`` component (see
+ * ``obs32/obs32_trace.h``). The engine converts its rings to Chrome trace
+ * JSON, which is displayed by ``chrome://tracing`` and the Perfetto UI: every
+ * core is a process, every trace point is a thread of its core.
+ *
+ * The engine does not depend on **ESP-IDF**, so it builds on a Linux host
+ * (see ``tools/obs32/trace``).
+ *
+ * @file   min_httpd_trace_engine.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_TRACE_ENGINE_H_
+#define SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_TRACE_ENGINE_H_
+
+/* The streaming JSON writer.
+ * - the rings are exported with it
+ */
+#include "min_httpd/min_httpd_json.h"
+
+/* The trace buffers. */
+#include "obs32/obs32_trace.h"
+
+
+/**
+ * Export the rings as Chrome trace JSON.
+ *
+ * The document is an object with the member ``traceEvents``. The timestamps
+ * are relative to the oldest record. The trace points are ignored, while the
+ * rings are exported (see ::obs32_trace_paused ), so the export is consistent.
+ * Without tracing, ``traceEvents`` is empty.
+ *
+ * The document is written, but not finished (see ::min_httpd_json_finish ).
+ *
+ * @param json The writer.
+ */
+void min_httpd_trace_export(struct min_httpd_json* json);
+
+#endif  // SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_TRACE_ENGINE_H_
@@ -0,0 +1,316 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * WebSocket push channel of the ``min_httpd`` component.
+ *
+ * Clients subscribe by opening a WebSocket on ::MIN_HTTPD_WS_URI , the
+ * handshake is performed by ``esp_http_server``. Other components publish
+ * messages with ::min_httpd_ws_broadcast , which builds the frame once and
+ * queues it with the server's task. The server's task sends the very same
+ * frame to all subscribers (see min_httpd_ws_engine.c ), so there is no copy
+ * per subscriber and a slow subscriber does not block the publisher.
+ *
+ * The subscribers are only accessed from the server's task (the *URI handler*,
+ * the ``close_fn`` and the queued work, see ::min_httpd_queue_work ), so they
+ * are not locked.
+ *
+ * @file   min_httpd_ws.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <stdlib.h>
+#include <string.h>
+
+/* Other headers of the component. */
+#include "min_httpd/min_httpd.h"  // The public header
+#include "min_httpd_internal.h"   // modules of the component
+#include "min_httpd_ws_engine.h"  // frames and subscribers
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+/* This is EPS-IDF's http server library. */
+#include "esp_http_server.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* FreeRTOS headers.
+ * - the ``FreeRTOS.h`` is required
+ */
+#include "freertos/FreeRTOS.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The maximum length of a frame, that is received from a subscriber.
+ *
+ * The channel is used to push messages to the subscribers, so received
+ * frames are discarded. Subscribers, that send longer frames, are closed.
+ */
+#define MIN_HTTPD_WS_RECV_LEN 128
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A broadcast, that is queued with the server's task.
+ *
+ * The frame is built in ``buf`` and sent to all subscribers from there.
+ */
+struct min_httpd_ws_message {
+    const uint8_t* frame;
+    size_t len;
+    uint8_t buf[];
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "krachkiste.httpd.ws";
+
+/**
+ * The storage of ::min_httpd_ws_subscribers_set .
+ */
+static int min_httpd_ws_sockets[MIN_HTTPD_WS_MAX_SUBSCRIBERS];
+
+/**
+ * The subscribers, only accessed from the server's task.
+ */
+static struct min_httpd_ws_subscribers min_httpd_ws_subscribers_set = {
+    .sockets = min_httpd_ws_sockets,
+    .size = MIN_HTTPD_WS_MAX_SUBSCRIBERS,
+};
+
+/**
+ * The number of subscribers, as seen by other tasks.
+ *
+ * This is updated by the server's task, so broadcasts without subscribers
+ * are skipped without allocating a frame.
+ */
+static volatile size_t min_httpd_ws_subscriber_count = 0;
+
+/**
+ * The number of broadcasts, that are queued with the server's task.
+ */
+static size_t min_httpd_ws_pending = 0;
+
+/**
+ * Protect ::min_httpd_ws_pending .
+ */
+static portMUX_TYPE min_httpd_ws_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * The server, only accessed from the server's task.
+ */
+static httpd_handle_t min_httpd_ws_server = NULL;
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static void min_httpd_ws_fanout_work(void* arg);
+#if MIN_HTTPD_WS_ENABLED
+static esp_err_t min_httpd_ws_handler(httpd_req_t* request);
+#endif
+
+
+/* ***** URI DEFINITIONS ***************************************************
+ * (technically, these are ``variables``, but as the handler functions must be
+ *  referenced, these must come after the ``prototypes``)
+ */
+
+#if MIN_HTTPD_WS_ENABLED
+/**
+ * Route definition of the WebSocket push channel.
+ *
+ * Only the handshake takes tokens, the frames of the session do not.
+ */
+static const struct min_httpd_route min_httpd_ws_route = {
+    .uri = MIN_HTTPD_WS_URI,
+    .method = HTTP_GET,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = min_httpd_ws_handler,
+    .user_ctx = NULL,
+    .cost = MIN_HTTPD_LIMIT_COST_UPGRADE,
+    .websocket = true};
+#endif
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Send a broadcast to all subscribers.
+ *
+ * This is queued with ::min_httpd_queue_work and runs in the server's task.
+ * Subscribers, that can not keep up, are closed.
+ *
+ * @param arg The broadcast (::min_httpd_ws_message ), which is released.
+ */
+static void min_httpd_ws_fanout_work(void* arg) {
+    struct min_httpd_ws_message* message = arg;
+    int dropped[MIN_HTTPD_WS_MAX_SUBSCRIBERS];
+
+    size_t count = min_httpd_ws_fanout(&min_httpd_ws_subscribers_set,
+                                       message->frame,
+                                       message->len,
+                                       dropped);
+    min_httpd_ws_subscriber_count = min_httpd_ws_subscribers_set.count;
+
+    for (size_t i = 0; i < count; i++) {
+        ESP_LOGD(TAG, "Closing subscriber %d", dropped[i]);
+        httpd_sess_trigger_close(min_httpd_ws_server, dropped[i]);
+    }
+
+    free(message);
+
+    portENTER_CRITICAL(&min_httpd_ws_lock);
+    min_httpd_ws_pending--;
+    portEXIT_CRITICAL(&min_httpd_ws_lock);
+}
+
+#if MIN_HTTPD_WS_ENABLED
+/**
+ * The handler of the WebSocket push channel.
+ *
+ * The handler is called with ``HTTP_GET`` once the handshake is finished and
+ * for every data frame of the session afterwards.
+ *
+ * The matching *route definition* is ::min_httpd_ws_route .
+ *
+ * @param request The request that should be responded to with this function.
+ * @return ``ESP_OK`` to keep the session open, ``ESP_FAIL`` to close it.
+ */
+static esp_err_t min_httpd_ws_handler(httpd_req_t* request) {
+    if (request->method == HTTP_GET) {
+        bool added =
+            min_httpd_ws_subscribers_add(&min_httpd_ws_subscribers_set,
+                                         httpd_req_to_sockfd(request));
+        min_httpd_ws_subscriber_count = min_httpd_ws_subscribers_set.count;
+
+        if (!added) {
+            ESP_LOGW(TAG, "Rejecting subscriber, limit reached!");
+            min_httpd_log_message(request, ESP_FAIL);
+            return ESP_FAIL;
+        }
+        min_httpd_log_message(request, ESP_OK);
+        return ESP_OK;
+    }
+
+    /* Control frames are handled by the server, data frames are discarded. */
+    httpd_ws_frame_t frame = {0};
+    uint8_t payload[MIN_HTTPD_WS_RECV_LEN];
+    if (httpd_ws_recv_frame(request, &frame, 0) != ESP_OK)
+        return ESP_FAIL;
+    if (frame.len == 0)
+        return ESP_OK;
+    if (frame.len > sizeof(payload))
+        return ESP_FAIL;
+
+    frame.payload = payload;
+    return httpd_ws_recv_frame(request, &frame, frame.len);
+}
+#endif
+
+// Documentation in header file!
+void min_httpd_ws_attach(httpd_handle_t server) {
+    ESP_LOGV(TAG, "min_httpd_ws_attach()");
+
+    if (!MIN_HTTPD_WS_ENABLED)
+        return;
+
+    min_httpd_ws_server = server;
+    min_httpd_ws_subscribers_init(&min_httpd_ws_subscribers_set,
+                                  min_httpd_ws_sockets,
+                                  MIN_HTTPD_WS_MAX_SUBSCRIBERS);
+    min_httpd_ws_subscriber_count = 0;
+
+#if MIN_HTTPD_WS_ENABLED
+    if (min_httpd_register_route(server, &min_httpd_ws_route) != ESP_OK)
+        ESP_LOGE(TAG, "Could not register '%s'!", MIN_HTTPD_WS_URI);
+#endif
+}
+
+// Documentation in header file!
+void min_httpd_ws_detach(void) {
+    ESP_LOGV(TAG, "min_httpd_ws_detach()");
+
+    min_httpd_ws_server = NULL;
+    min_httpd_ws_subscriber_count = 0;
+}
+
+// Documentation in header file!
+void min_httpd_ws_session_closed(int sockfd) {
+    if (min_httpd_ws_subscribers_remove(&min_httpd_ws_subscribers_set, sockfd))
+        min_httpd_ws_subscriber_count = min_httpd_ws_subscribers_set.count;
+}
+
+// Documentation in header file!
+esp_err_t min_httpd_ws_broadcast(const char* text, size_t len) {
+    ESP_LOGV(TAG, "min_httpd_ws_broadcast()");
+
+    if (!MIN_HTTPD_WS_ENABLED)
+        return ESP_ERR_NOT_SUPPORTED;
+    if ((text == NULL) && (len > 0))
+        return ESP_ERR_INVALID_ARG;
+    if (len > MIN_HTTPD_WS_MAX_MESSAGE_LEN)
+        return ESP_ERR_INVALID_SIZE;
+    if (min_httpd_ws_subscriber_count == 0)
+        return ESP_OK;
+
+    portENTER_CRITICAL(&min_httpd_ws_lock);
+    bool accepted = min_httpd_ws_pending < MIN_HTTPD_WS_MAX_PENDING;
+    if (accepted)
+        min_httpd_ws_pending++;
+    portEXIT_CRITICAL(&min_httpd_ws_lock);
+    if (!accepted)
+        return ESP_ERR_NO_MEM;
+
+    /* The frame is built once, directly behind the header's headroom. */
+    struct min_httpd_ws_message* message =
+        malloc(sizeof(*message) + MIN_HTTPD_WS_HEADROOM + len);
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    if (message != NULL) {
+        if (len > 0)
+            memcpy(message->buf + MIN_HTTPD_WS_HEADROOM, text, len);
+        message->len = min_httpd_ws_frame_finish(message->buf,
+                                                 len,
+                                                 MIN_HTTPD_WS_OPCODE_TEXT,
+                                                 &message->frame);
+
+        ret = min_httpd_queue_work(min_httpd_ws_fanout_work, message);
+    }
+
+    if (ret != ESP_OK) {
+        free(message);
+        portENTER_CRITICAL(&min_httpd_ws_lock);
+        min_httpd_ws_pending--;
+        portEXIT_CRITICAL(&min_httpd_ws_lock);
+    }
+    return ret;
+}
+
+// Documentation in header file!
+size_t min_httpd_ws_get_subscribers(void) {
+    return min_httpd_ws_subscriber_count;
+}
@@ -0,0 +1,190 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's WebSocket push channel.
+ *
+ * The set of subscribers is a small array, that is searched linearly, as
+ * there are only a few sessions of the server.
+ *
+ * **Resources:**
+ *   - https://www.rfc-editor.org/rfc/rfc6455#section-5.2
+ *
+ * @file   min_httpd_ws_engine.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "min_httpd_ws_engine.h"
+
+/* C's standard libraries. */
+#include <errno.h>
+
+/* The BSD socket API, provided by lwIP on the ESP32. */
+#include <sys/socket.h>
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The ``FIN`` bit of the first byte, frames are never fragmented.
+ */
+#define MIN_HTTPD_WS_FLAG_FIN 0x80
+
+/**
+ * The maximum payload length, that is encoded in the second byte.
+ */
+#define MIN_HTTPD_WS_LEN_SHORT 125
+
+/* Markers of extended payload lengths (second byte). */
+#define MIN_HTTPD_WS_LEN_16 126
+#define MIN_HTTPD_WS_LEN_64 127
+
+/**
+ * Flags of ``send()``.
+ *
+ * ``MSG_NOSIGNAL`` keeps a closed subscriber from raising ``SIGPIPE`` on the
+ * host; lwIP ignores it.
+ */
+#ifdef MSG_NOSIGNAL
+#define MIN_HTTPD_WS_SEND_FLAGS (MSG_DONTWAIT | MSG_NOSIGNAL)
+#else
+#define MIN_HTTPD_WS_SEND_FLAGS MSG_DONTWAIT
+#endif
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+// Documentation in header file!
+void min_httpd_ws_subscribers_init(struct min_httpd_ws_subscribers* subscribers,
+                                   int* sockets,
+                                   size_t size) {
+    subscribers->sockets = sockets;
+    subscribers->size = size;
+    subscribers->count = 0;
+    subscribers->frames = 0;
+    subscribers->sent = 0;
+    subscribers->skipped = 0;
+    subscribers->dropped = 0;
+
+    for (size_t i = 0; i < size; i++)
+        sockets[i] = -1;
+}
+
+// Documentation in header file!
+bool min_httpd_ws_subscribers_add(struct min_httpd_ws_subscribers* subscribers,
+                                  int socket) {
+    int* slot = NULL;
+    for (size_t i = 0; i < subscribers->size; i++) {
+        if (subscribers->sockets[i] == socket)
+            return true;
+        if ((slot == NULL) && (subscribers->sockets[i] < 0))
+            slot = &subscribers->sockets[i];
+    }
+
+    if (slot == NULL)
+        return false;
+
+    *slot = socket;
+    subscribers->count++;
+    return true;
+}
+
+// Documentation in header file!
+bool min_httpd_ws_subscribers_remove(
+    struct min_httpd_ws_subscribers* subscribers,
+    int socket) {
+    for (size_t i = 0; i < subscribers->size; i++) {
+        if (subscribers->sockets[i] == socket) {
+            subscribers->sockets[i] = -1;
+            subscribers->count--;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Documentation in header file!
+size_t min_httpd_ws_frame_finish(uint8_t* buf,
+                                 size_t len,
+                                 uint8_t opcode,
+                                 const uint8_t** frame) {
+    uint8_t* header;
+
+    if (len <= MIN_HTTPD_WS_LEN_SHORT) {
+        header = buf + MIN_HTTPD_WS_HEADROOM - 2;
+        header[1] = (uint8_t)len;
+    } else if (len <= UINT16_MAX) {
+        header = buf + MIN_HTTPD_WS_HEADROOM - 4;
+        header[1] = MIN_HTTPD_WS_LEN_16;
+        header[2] = (uint8_t)(len >> 8);
+        header[3] = (uint8_t)len;
+    } else {
+        header = buf;
+        header[1] = MIN_HTTPD_WS_LEN_64;
+        uint64_t len64 = len;
+        for (int i = 9; i >= 2; i--) {
+            header[i] = (uint8_t)len64;
+            len64 >>= 8;
+        }
+    }
+    header[0] = MIN_HTTPD_WS_FLAG_FIN | (opcode & 0x0f);
+
+    *frame = header;
+    return (size_t)(buf + MIN_HTTPD_WS_HEADROOM - header) + len;
+}
+
+// Documentation in header file!
+int min_httpd_ws_frame_send(int socket, const uint8_t* frame, size_t len) {
+    ssize_t ret;
+    do {
+        ret = send(socket, frame, len, MIN_HTTPD_WS_SEND_FLAGS);
+    } while ((ret < 0) && (errno == EINTR));
+
+    if (ret < 0) {
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            return 0;
+        return -1;
+    }
+
+    if ((size_t)ret != len) {
+        errno = EPIPE;
+        return -1;
+    }
+    return 1;
+}
+
+// Documentation in header file!
+size_t min_httpd_ws_fanout(struct min_httpd_ws_subscribers* subscribers,
+                           const uint8_t* frame,
+                           size_t len,
+                           int* dropped) {
+    size_t removed = 0;
+
+    subscribers->frames++;
+    for (size_t i = 0; i < subscribers->size; i++) {
+        int socket = subscribers->sockets[i];
+        if (socket < 0)
+            continue;
+
+        int ret = min_httpd_ws_frame_send(socket, frame, len);
+        if (ret == 1) {
+            subscribers->sent++;
+        } else if (ret == 0) {
+            subscribers->skipped++;
+        } else {
+            subscribers->sockets[i] = -1;
+            subscribers->count--;
+            subscribers->dropped++;
+            dropped[removed++] = socket;
+        }
+    }
+
+    return removed;
+}
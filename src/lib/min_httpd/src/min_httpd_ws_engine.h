@@ -0,0 +1,158 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The engine of the ``min_httpd`` component's WebSocket push channel.
+ *
+ * The engine builds WebSocket frames and sends them to a set of subscribers.
+ * A frame is built *once* in a buffer, that provides ::MIN_HTTPD_WS_HEADROOM
+ * bytes in front of the payload, so the header is written directly in front
+ * of the payload without copying it. The same frame is then sent to all
+ * subscribers.
+ *
+ * Frames are sent without blocking. A subscriber, that can not take a frame
+ * at all, misses it; a subscriber, that only takes a part of a frame, is
+ * removed, as its stream of frames is broken.
+ *
+ * The handshake is not part of the engine, it is performed by **ESP-IDF**'s
+ * ``esp_http_server``.
+ *
+ * The engine does not allocate memory, does not lock and only depends on the
+ * BSD socket API, so it builds with **ESP-IDF** (lwIP) and on a Linux host
+ * (see ``tools/min_httpd/ws``). Locking is the responsibility of the caller
+ * (see min_httpd_ws.c ).
+ *
+ * **Resources:**
+ *   - https://www.rfc-editor.org/rfc/rfc6455#section-5.2
+ *
+ * @file   min_httpd_ws_engine.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_WS_ENGINE_H_
+#define SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_WS_ENGINE_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * The maximum length of the header of a frame, sent by a server.
+ *
+ * Frames of a server are not masked, so this is the first two bytes and the
+ * 64 bit extended payload length.
+ */
+#define MIN_HTTPD_WS_HEADROOM 10
+
+/**
+ * The opcode of a text frame.
+ */
+#define MIN_HTTPD_WS_OPCODE_TEXT 0x1
+
+/**
+ * The opcode of a binary frame.
+ */
+#define MIN_HTTPD_WS_OPCODE_BINARY 0x2
+
+/**
+ * A set of subscribers, identified by their sockets.
+ *
+ * The storage is provided by the caller, see ::min_httpd_ws_subscribers_init .
+ */
+struct min_httpd_ws_subscribers {
+    int* sockets;  // ``-1`` marks an unused slot
+    size_t size;
+    size_t count;
+
+    uint32_t frames;   // frames passed to ::min_httpd_ws_fanout
+    uint32_t sent;     // frames sent to a subscriber
+    uint32_t skipped;  // frames missed by a subscriber, as it was busy
+    uint32_t dropped;  // subscribers removed, as a frame could not be sent
+};
+
+
+/**
+ * Initialize a set of subscribers.
+ *
+ * @param subscribers The set to be initialized.
+ * @param sockets     The storage of the set.
+ * @param size        The number of ``sockets``.
+ */
+void min_httpd_ws_subscribers_init(struct min_httpd_ws_subscribers* subscribers,
+                                   int* sockets,
+                                   size_t size);
+
+/**
+ * Add a subscriber.
+ *
+ * @param subscribers The set.
+ * @param socket      The subscriber's socket.
+ * @return bool ``true`` if the subscriber was added (or is already part of
+ *              the set), ``false`` if the set is full.
+ */
+bool min_httpd_ws_subscribers_add(struct min_httpd_ws_subscribers* subscribers,
+                                  int socket);
+
+/**
+ * Remove a subscriber.
+ *
+ * @param subscribers The set.
+ * @param socket      The subscriber's socket.
+ * @return bool ``true`` if the subscriber was part of the set.
+ */
+bool min_httpd_ws_subscribers_remove(
+    struct min_httpd_ws_subscribers* subscribers,
+    int socket);
+
+/**
+ * Finish a frame by writing its header in front of the payload.
+ *
+ * @param buf    The buffer, holding the payload at offset
+ *               ::MIN_HTTPD_WS_HEADROOM .
+ * @param len    The length of the payload.
+ * @param opcode The frame's opcode, e.g. ::MIN_HTTPD_WS_OPCODE_TEXT .
+ * @param frame  The start of the frame (within ``buf``).
+ * @return size_t The length of the frame.
+ */
+size_t min_httpd_ws_frame_finish(uint8_t* buf,
+                                 size_t len,
+                                 uint8_t opcode,
+                                 const uint8_t** frame);
+
+/**
+ * Send a frame to a single subscriber, without blocking.
+ *
+ * @param socket The subscriber's socket.
+ * @param frame  The frame.
+ * @param len    The length of the frame.
+ * @return int ``1`` if the frame was sent, ``0`` if the subscriber could not
+ *             take any part of the frame and ``-1`` if the frame was sent
+ *             partially or on failure (with ``errno`` set).
+ */
+int min_httpd_ws_frame_send(int socket, const uint8_t* frame, size_t len);
+
+/**
+ * Send a frame to all subscribers.
+ *
+ * Subscribers, that fail (see ::min_httpd_ws_frame_send ), are removed from
+ * the set and reported in ``dropped``, so their sessions can be closed.
+ *
+ * @param subscribers The set.
+ * @param frame       The frame.
+ * @param len         The length of the frame.
+ * @param dropped     The sockets of removed subscribers, at least ``size``
+ *                    of the set.
+ * @return size_t The number of removed subscribers.
+ */
+size_t min_httpd_ws_fanout(struct min_httpd_ws_subscribers* subscribers,
+                           const uint8_t* frame,
+                           size_t len,
+                           int* dropped);
+
+#endif  // SRC_LIB_MIN_HTTPD_SRC_MIN_HTTPD_WS_ENGINE_H_
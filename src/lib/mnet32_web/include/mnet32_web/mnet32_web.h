@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Provide the web interface of the ``mnet32`` component.
+ *
+ * The interface is served by ``min_httpd``: the WiFi configuration form, a
+ * snapshot of the status as JSON and the binary trace of the state machine.
+ * It only uses the public interface of ``mnet32``, so ``mnet32`` does not
+ * depend on the web server.
+ *
+ * @file   mnet32_web.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_MNET32_WEB_INCLUDE_MNET32_WEB_MNET32_WEB_H_
+#define SRC_LIB_MNET32_WEB_INCLUDE_MNET32_WEB_MNET32_WEB_H_
+
+/* This is ESP-IDF's event library.
+ * - defines ``esp_event_base_t``
+ */
+#include "esp_event.h"
+
+/* The streaming JSON writer of ``min_httpd``.
+ * - defines ``struct min_httpd_json``
+ */
+#include "min_httpd/min_httpd_json.h"
+
+/* The public header of ``mnet32``.
+ * - defines ``struct mnet32_status_snapshot``
+ */
+#include "mnet32/mnet32.h"
+
+
+/**
+ * The URI to serve the configuration interface from.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_WEB_URL_CONFIG CONFIG_MNET32_WEB_URL_CONFIG
+
+/**
+ * The URI to serve the binary trace of ``mnet32``'s state machine from.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_WEB_URL_TRACE CONFIG_MNET32_WEB_URL_TRACE
+
+/**
+ * The URI to serve the snapshot of ``mnet32``'s status from, as JSON.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define MNET32_WEB_URL_STATUS CONFIG_MNET32_WEB_URL_STATUS
+
+
+/**
+ * Write a snapshot of ``mnet32``'s status as JSON object.
+ *
+ * The object is e.g. ``{"connected":true,"rssi":-61,"rssi_avg":-63,
+ * "rssi_history":[-64,-62,-61],"roam_scans":2,"roams":0}``, the RSSI history
+ * contains the valid samples only.
+ *
+ * @param json     The writer (see ``min_httpd_json.h``).
+ * @param snapshot The snapshot, see ``mnet32_get_status_snapshot()``.
+ */
+void mnet32_status_snapshot_json(struct min_httpd_json* json,
+                                 const struct mnet32_status_snapshot* snapshot);
+
+/**
+ * Handle the event, that the http server is ready to accept further
+ * *URI handlers*.
+ *
+ * This is a specific handler, that does not actually parse or verify the
+ * event, that triggered its execution.
+ *
+ * This requires the *calling code*, or more specifically, the code that
+ * connects this handler with events, to specifically select the events, that
+ * should make this component register its specific *URI handlers*.
+ *
+ * @param arg        Generic arguments.
+ * @param event_base ``esp_event``'s ``EVENT_BASE``. Every event is specified
+ *                   by the ``EVENT_BASE`` and its ``EVENT_ID``.
+ * @param event_id   ``esp_event``'s ``EVENT_ID``. Every event is specified by
+ *                   the ``EVENT_BASE`` and its ``EVENT_ID``.
+ * @param event_data Events might provide a pointer to additional,
+ *                   event-related data. This handler assumes, that the
+ *                   provided ``arg`` is an actual ``http_handle_t*`` to the
+ *                   http server instance.
+ */
+void mnet32_web_attach_handlers(void* arg,
+                                esp_event_base_t event_base,
+                                int32_t event_id,
+                                void* event_data);
+
+#endif  // SRC_LIB_MNET32_WEB_INCLUDE_MNET32_WEB_MNET32_WEB_H_
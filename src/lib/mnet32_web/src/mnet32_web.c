@@ -0,0 +1,327 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The web interface of the ``mnet32`` component.
+ *
+ * Basically this includes **route definitions** (see ``min_httpd``) and the
+ * respective **URI handler** implementations. They only use ``mnet32``'s public
+ * interface.
+ *
+ * @file   mnet32_web.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* This files header */
+#include "mnet32_web/mnet32_web.h"
+
+/* C's standard libraries. */
+#include <stdio.h>
+#include <string.h>
+
+/* The public header of ``mnet32``, the component, that is served. */
+#include "mnet32/mnet32.h"
+
+/* This is ESP-IDF's error handling library.
+ * - defines the type ``esp_err_t``
+ * - defines the macro ``ESP_ERROR_CHECK``
+ * - defines the return values ``ESP_OK`` (0) and ``ESP_FAIL`` (-1)
+ */
+#include "esp_err.h"
+
+/* This is ESP-IDF's event library.
+ * - defines ``esp_event_base_t``
+ */
+#include "esp_event.h"
+
+/* This is EPS-IDF's http server library.
+ * This header file also includes "http_parser.h", which provides the function
+ * ``http_method_str``.
+ */
+#include "esp_http_server.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* This is ESP-IDF's network interface library.
+ * - formats the address of the interface (``IPSTR``)
+ */
+#include "esp_netif.h"
+
+/* This is ESP-IDF's WiFi library.
+ * - provides the configured network (``esp_wifi_get_config()``)
+ */
+#include "esp_wifi.h"
+
+/* The project's web server, which offloads blocking handlers and renders the
+ * compiled templates.
+ */
+#include "min_httpd/min_httpd.h"
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "mnet32.web";
+
+/**
+ * The template of the configuration form.
+ *
+ * This is generated by ``compile_html_template()`` (see the component's
+ * ``CMakeLists.txt``) from ``templates/wifi_config.tpl.html``.
+ */
+extern const struct min_httpd_template mnet32_web_tpl_config;
+
+
+/* ***** PROTOTYPES ******************************************************** */
+static esp_err_t mnet32_web_handler_config_get(httpd_req_t* request);
+static esp_err_t mnet32_web_handler_config_post(struct min_httpd_job* job);
+static esp_err_t mnet32_web_handler_status_get(httpd_req_t* request);
+static esp_err_t mnet32_web_handler_trace_get(httpd_req_t* request);
+
+
+/* ***** URI DEFINITIONS ***************************************************
+ * (technically, these are ``variables``, but as the handler functions must be
+ *  referenced, these must come after the ``prototypes``)
+ */
+
+/**
+ * Route definition for the configuration page, serving the actual form.
+ */
+static const struct min_httpd_route mnet32_web_route_config_get = {
+    .uri = MNET32_WEB_URL_CONFIG,
+    .method = HTTP_GET,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = mnet32_web_handler_config_get,
+    .user_ctx = NULL,
+    .cost = MIN_HTTPD_LIMIT_COST_INLINE};
+
+/**
+ * Route definition for the configuration page, processing the actual form.
+ *
+ * Writing to the NVS blocks, so the route is offloaded to ``min_httpd``'s
+ * workers and does not stall the requests of other clients.
+ */
+static const struct min_httpd_route mnet32_web_route_config_post = {
+    .uri = MNET32_WEB_URL_CONFIG,
+    .method = HTTP_POST,
+    .mode = MIN_HTTPD_ROUTE_OFFLOADED,
+    .job_handler = mnet32_web_handler_config_post,
+    .user_ctx = NULL,
+    .cost = MIN_HTTPD_LIMIT_COST_OFFLOADED};
+
+/**
+ * Route definition for the snapshot of the component's status.
+ */
+static const struct min_httpd_route mnet32_web_route_status_get = {
+    .uri = MNET32_WEB_URL_STATUS,
+    .method = HTTP_GET,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = mnet32_web_handler_status_get,
+    .user_ctx = NULL,
+    .cost = MIN_HTTPD_LIMIT_COST_INLINE};
+
+/**
+ * Route definition for the binary trace of the component's state machine.
+ */
+static const struct min_httpd_route mnet32_web_route_trace_get = {
+    .uri = MNET32_WEB_URL_TRACE,
+    .method = HTTP_GET,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = mnet32_web_handler_trace_get,
+    .user_ctx = NULL,
+    .cost = MIN_HTTPD_LIMIT_COST_INLINE};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+// This function is part of the component's public interface and documented in
+// ``include/mnet32_web/mnet32_web.h``
+void mnet32_web_attach_handlers(void* arg,
+                                esp_event_base_t event_base,
+                                int32_t event_id,
+                                void* event_data) {
+    // Get the server from ``event_data``
+    httpd_handle_t server = *((httpd_handle_t*)event_data);
+
+    // Register this component's *URI handlers* with the server instance.
+    min_httpd_register_route(server, &mnet32_web_route_config_get);
+    min_httpd_register_route(server, &mnet32_web_route_config_post);
+    min_httpd_register_route(server, &mnet32_web_route_trace_get);
+    min_httpd_register_route(server, &mnet32_web_route_status_get);
+}
+
+// This function is part of the component's public interface and documented in
+// ``include/mnet32_web/mnet32_web.h``
+void mnet32_status_snapshot_json(
+    struct min_httpd_json* json,
+    const struct mnet32_status_snapshot* snapshot) {
+    min_httpd_json_object_begin(json);
+    min_httpd_json_key(json, "connected");
+    min_httpd_json_bool(json, snapshot->connected);
+    min_httpd_json_key(json, "rssi");
+    min_httpd_json_int(json, snapshot->rssi);
+    min_httpd_json_key(json, "rssi_avg");
+    min_httpd_json_int(json, snapshot->rssi_avg);
+    min_httpd_json_key(json, "rssi_history");
+    min_httpd_json_array_begin(json);
+    for (uint8_t i = 0; i < snapshot->rssi_count; i++)
+        min_httpd_json_int(json, snapshot->rssi_history[i]);
+    min_httpd_json_array_end(json);
+    min_httpd_json_key(json, "roam_scans");
+    min_httpd_json_uint(json, snapshot->roam_scans);
+    min_httpd_json_key(json, "roams");
+    min_httpd_json_uint(json, snapshot->roams);
+    min_httpd_json_object_end(json);
+}
+
+/**
+ * Provide the binary trace of the component's state machine.
+ *
+ * The matching *route definition* is ::mnet32_web_route_trace_get.
+ *
+ * The dump is generated by ``mnet32_trace_dump()`` and may be decoded with
+ * ``tools/mnet32/trace.py``.
+ *
+ * @param request The request that should be responded to with this function.
+ * @return esp_err_t The return value of ``httpd_resp_send()``.
+ */
+static esp_err_t mnet32_web_handler_trace_get(httpd_req_t* request) {
+    static uint8_t buf[MNET32_TRACE_DUMP_LEN];
+
+    size_t len = mnet32_trace_dump(buf, sizeof(buf));
+
+    httpd_resp_set_type(request, "application/octet-stream");
+    return httpd_resp_send(request, (const char*)buf, len);
+}
+
+/**
+ * Provide a snapshot of the component's status as JSON.
+ *
+ * The matching route definition is ::mnet32_web_route_status_get.
+ *
+ * The document is written by ::mnet32_status_snapshot_json with
+ * ``min_httpd``'s streaming JSON writer, so it is not allocated.
+ *
+ * @param request The request that should be responded to with this function.
+ * @return esp_err_t The return value of ``min_httpd_json_send()``.
+ */
+static esp_err_t mnet32_web_handler_status_get(httpd_req_t* request) {
+    struct mnet32_status_snapshot snapshot;
+    mnet32_get_status_snapshot(&snapshot);
+
+    char chunk[MIN_HTTPD_JSON_CHUNK_LEN];
+    struct min_httpd_json json;
+    min_httpd_json_response(&json, request, chunk, sizeof(chunk));
+    mnet32_status_snapshot_json(&json, &snapshot);
+    return min_httpd_json_send(&json);
+}
+
+/**
+ * Show the WiFi configuration form.
+ *
+ * The matching *route definition* is ::mnet32_web_route_config_get.
+ *
+ * The configuration form is the compiled template ::mnet32_web_tpl_config ,
+ * that shows the configured network (``ssid``) and the address of the
+ * current interface (``ip``). Both are empty, if they are not available.
+ *
+ * @param request The request that should be responded to with this function.
+ * @return esp_err_t The return value of ``min_httpd_template_send()``.
+ */
+static esp_err_t mnet32_web_handler_config_get(httpd_req_t* request) {
+    wifi_config_t sta_config;
+    char ssid[sizeof(sta_config.sta.ssid) + 1] = "";
+    char ip[16] = "";
+
+    // The SSID is not ``\0``-terminated, if it has the maximum length
+    if (esp_wifi_get_config(WIFI_IF_STA, &sta_config) == ESP_OK)
+        memcpy(ssid, sta_config.sta.ssid, sizeof(sta_config.sta.ssid));
+
+    esp_ip4_addr_t address;
+    if (mnet32_get_address(&address.addr) == ESP_OK)
+        snprintf(ip, sizeof(ip), IPSTR, IP2STR(&address));
+
+    const struct min_httpd_template_value values[] = {
+        {"ssid", ssid},
+        {"ip", ip},
+    };
+    return min_httpd_template_send(request,
+                                   &mnet32_web_tpl_config,
+                                   values,
+                                   sizeof(values) / sizeof(values[0]));
+}
+
+/**
+ * Process the WiFi configuration form.
+ *
+ * The matching route definition is ::mnet32_web_route_config_post.
+ *
+ * This request handler processes the form POST body to retrieve the provided
+ * WiFi credentials and passes them to ``mnet32_set_credentials()``, which
+ * stores them to the non-volatile storage and restarts the WiFi connection.
+ * During this restart, the new credentials are picked up and used to
+ * establish a WiFi connection to the specified access point.
+ *
+ * The handler is executed by a worker task of ``min_httpd``, which has
+ * received the POST body already. The decoded values are allocated from the
+ * job's arena, so the handler does not use the heap.
+ *
+ * Technically this provides a HTTP 204 on success, but as the WiFi connection
+ * will get reset during the operation, this response will never be received by
+ * the client.
+ *
+ * If the credentials are missing or too long, a HTTP 400 is returned. If
+ * there is an error, a HTTP 500 is returned.
+ *
+ * @param job The request that should be responded to with this function.
+ * @return esp_err_t
+ */
+static esp_err_t mnet32_web_handler_config_post(struct min_httpd_job* job) {
+    ESP_LOGV(TAG, "mnet32_web_handler_config_post()");
+    ESP_LOGV(TAG, "received [%s]", job->body);
+
+    /* Parse POST body */
+    char* ssid = min_httpd_arena_form_value(job->arena, job->body, "ssid");
+    char* psk = min_httpd_arena_form_value(job->arena, job->body, "psk");
+
+    /* Write new credentials to NVS and trigger restart of WiFi */
+    esp_err_t esp_ret = mnet32_set_credentials(ssid, psk);
+    if (esp_ret == ESP_ERR_INVALID_ARG) {
+        ESP_LOGE(TAG, "Invalid credentials!");
+        return min_httpd_job_respond(job,
+                                     "400 Bad Request",
+                                     "text/plain",
+                                     "Invalid credentials",
+                                     HTTPD_RESP_USE_STRLEN);
+    }
+    if (esp_ret != ESP_OK) {
+        return min_httpd_job_respond(job,
+                                     "500 Internal Server Error",
+                                     "text/plain",
+                                     "Could not write to storage",
+                                     HTTPD_RESP_USE_STRLEN);
+    }
+
+    ESP_LOGD(TAG, "Stored credentials of POST body:");
+    ESP_LOGD(TAG, "SSID: %s", ssid);
+    ESP_LOGD(TAG, "PSK:  %s", psk);
+
+    /* Provide a HTTP response */
+    return min_httpd_job_respond(job, "204 No Response", NULL, "", 0);
+}
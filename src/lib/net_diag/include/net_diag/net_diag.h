@@ -0,0 +1,207 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Provide throughput tests to measure the network link in the field.
+ *
+ * The component provides a sink for **iperf** (version 2) compatible TCP and
+ * UDP tests and runs tests as source on request. The results are provided by
+ * a web interface.
+ *
+ * @file   net_diag.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_NET_DIAG_INCLUDE_NET_DIAG_NET_DIAG_H_
+#define SRC_LIB_NET_DIAG_INCLUDE_NET_DIAG_NET_DIAG_H_
+
+/* This is ESP-IDF's event library.
+ * - defines ``esp_event_base_t``
+ */
+#include "esp_event.h"
+
+
+/**
+ * Flag to indicate if the component is enabled.
+ *
+ * The component is meant for diagnostics and should not be enabled in
+ * production builds.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_NET_DIAG_ENABLED
+#define NET_DIAG_ENABLED 1
+#else
+#define NET_DIAG_ENABLED 0
+#endif
+
+#if NET_DIAG_ENABLED
+/**
+ * The TCP and UDP port of the sink.
+ *
+ * ``5001`` is **iperf**'s default port.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define NET_DIAG_PORT CONFIG_NET_DIAG_PORT
+
+/**
+ * The length of a single read / write, which is also the length of UDP
+ * datagrams.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define NET_DIAG_BUFFER_LENGTH CONFIG_NET_DIAG_BUFFER_LENGTH
+
+/**
+ * The socket's receive buffer (``SO_RCVBUF``) of the sink.
+ *
+ * ``0`` keeps lwIP's default. lwIP only applies this value, if
+ * ``CONFIG_LWIP_SO_RCVBUF`` is enabled.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define NET_DIAG_SOCKET_RCVBUF CONFIG_NET_DIAG_SOCKET_RCVBUF
+
+/**
+ * The socket's send buffer (``SO_SNDBUF``) of a source.
+ *
+ * ``0`` keeps the default. lwIP does not support this option, its TCP send
+ * buffer is set by ``CONFIG_LWIP_TCP_SND_BUF_DEFAULT``.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define NET_DIAG_SOCKET_SNDBUF CONFIG_NET_DIAG_SOCKET_SNDBUF
+
+/**
+ * The **freeRTOS**-specific priority for the component's task.
+ *
+ * The priority should be lower than lwIP's task
+ * (``CONFIG_LWIP_TCPIP_TASK_PRIO``), otherwise the measurement starves the
+ * network stack.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define NET_DIAG_TASK_PRIORITY CONFIG_NET_DIAG_TASK_PRIORITY
+
+/**
+ * The URL to provide the results and to request a test as source.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#define NET_DIAG_WEB_URL CONFIG_NET_DIAG_WEB_URL
+#else
+#define NET_DIAG_PORT 0
+#define NET_DIAG_BUFFER_LENGTH 0
+#define NET_DIAG_SOCKET_RCVBUF 0
+#define NET_DIAG_SOCKET_SNDBUF 0
+#define NET_DIAG_TASK_PRIORITY 0
+#define NET_DIAG_WEB_URL ""
+#endif  // NET_DIAG_ENABLED
+
+/**
+ * The stack size of the component's task.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``net_diag.h``.
+ */
+#define NET_DIAG_TASK_STACK_SIZE 3072
+
+/**
+ * The maximum duration of a test as source, given in seconds.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``net_diag.h``.
+ */
+#define NET_DIAG_SOURCE_MAX_DURATION 60
+
+/**
+ * The maximum bandwidth of a UDP test as source, given in kbit/s.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``net_diag.h``.
+ */
+#define NET_DIAG_SOURCE_MAX_BANDWIDTH 100000
+
+
+/**
+ * Handle external events that should cause the component to start.
+ *
+ * The sink is started, tests as source may be requested afterwards. The
+ * component is meant to be started with ``MNET32_EVENT_READY``, just like
+ * ``min_httpd``.
+ *
+ * This is a specific handler, that does not actually parse or verify the
+ * event, that triggered its execution.
+ *
+ * @param arg        Generic arguments.
+ * @param event_base ``esp_event``'s ``EVENT_BASE``. Every event is specified
+ *                   by the ``EVENT_BASE`` and its ``EVENT_ID``.
+ * @param event_id   `esp_event``'s ``EVENT_ID``. Every event is specified by
+ *                   the ``EVENT_BASE`` and its ``EVENT_ID``.
+ * @param event_data Events might provide a pointer to additional,
+ *                   event-related data.
+ */
+void net_diag_external_event_handler_start(void* arg,
+                                           esp_event_base_t event_base,
+                                           int32_t event_id,
+                                           void* event_data);
+
+/**
+ * Handle external events that should cause the component to stop.
+ *
+ * A running test is aborted, its (partial) result is kept.
+ *
+ * This is a specific handler, that does not actually parse or verify the
+ * event, that triggered its execution.
+ *
+ * @param arg        Generic arguments.
+ * @param event_base ``esp_event``'s ``EVENT_BASE``. Every event is specified
+ *                   by the ``EVENT_BASE`` and its ``EVENT_ID``.
+ * @param event_id   `esp_event``'s ``EVENT_ID``. Every event is specified by
+ *                   the ``EVENT_BASE`` and its ``EVENT_ID``.
+ * @param event_data Events might provide a pointer to additional,
+ *                   event-related data.
+ */
+void net_diag_external_event_handler_stop(void* arg,
+                                          esp_event_base_t event_base,
+                                          int32_t event_id,
+                                          void* event_data);
+
+/**
+ * Attach the component's *URI handlers* to a running HTTP server.
+ *
+ * The handlers are provided under ::NET_DIAG_WEB_URL :
+ *   - ``GET`` provides the results of the most recent tests as JSON;
+ *   - ``POST`` requests a test as source, the (form-encoded) body provides
+ *     ``protocol`` (``tcp`` or ``udp``), ``host``, ``port``, ``time`` (in
+ *     seconds) and ``bandwidth`` (in kbit/s, ``udp`` only, up to
+ *     ::NET_DIAG_SOURCE_MAX_BANDWIDTH ).
+ *
+ * The function is meant to be registered for ``MIN_HTTPD_READY``.
+ *
+ * @param arg        Generic arguments.
+ * @param event_base ``esp_event``'s ``EVENT_BASE``. Every event is specified
+ *                   by the ``EVENT_BASE`` and its ``EVENT_ID``.
+ * @param event_id   `esp_event``'s ``EVENT_ID``. Every event is specified by
+ *                   the ``EVENT_BASE`` and its ``EVENT_ID``.
+ * @param event_data Events might provide a pointer to additional,
+ *                   event-related data; this must be the ``httpd_handle_t``.
+ */
+void net_diag_web_attach_handlers(void* arg,
+                                  esp_event_base_t event_base,
+                                  int32_t event_id,
+                                  void* event_data);
+
+#endif  // SRC_LIB_NET_DIAG_INCLUDE_NET_DIAG_NET_DIAG_H_
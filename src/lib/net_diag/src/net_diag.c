@@ -0,0 +1,313 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Provide throughput tests to measure the network link in the field.
+ *
+ * The component runs a dedicated task, which serves tests of remote sources
+ * (the sink, see net_diag_engine.c) and runs tests as source on request. The
+ * most recent result of each direction is kept and provided by the web
+ * interface (see net_diag_web.c).
+ *
+ * The task is started and stopped by external events, usually
+ * ``MNET32_EVENT_READY`` and ``MNET32_EVENT_UNAVAILABLE``.
+ *
+ * @file   net_diag.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "net_diag/net_diag.h"
+
+/* C's standard libraries. */
+#include <errno.h>
+#include <string.h>
+
+/* Other headers of the component. */
+#include "net_diag_engine.h"
+#include "net_diag_internal.h"
+
+/* This is ESP-IDF's error handling library.
+ * - defines the type ``esp_err_t``
+ * - defines the return values ``ESP_OK`` (0) and ``ESP_FAIL`` (-1)
+ */
+#include "esp_err.h"
+
+/* This is ESP-IDF's event library.
+ * - defines ``esp_event_base_t``
+ */
+#include "esp_event.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* FreeRTOS headers.
+ * - the ``FreeRTOS.h`` is required
+ * - ``task.h`` for the component's task
+ */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* The BSD socket API, used to format addresses. */
+#include <arpa/inet.h>
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * The component's internal state.
+ */
+struct net_diag_state {
+    bool running;
+    volatile bool stop;
+    bool rx_valid;
+    struct net_diag_result rx;
+    bool tx_pending;
+    bool tx_busy;
+    bool tx_valid;
+    struct net_diag_result tx;
+    struct net_diag_source_config tx_config;
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "net_diag";
+
+/**
+ * The component's internal state.
+ *
+ * The state is statically allocated, as the results should be available even
+ * after the component was stopped.
+ */
+static struct net_diag_state net_diag_state = {0};
+
+/**
+ * Protect ::net_diag_state, as it is accessed from the component's task, the
+ * event handlers and the web interface.
+ */
+static portMUX_TYPE net_diag_lock = portMUX_INITIALIZER_UNLOCKED;
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static void net_diag_log_result(const char* prefix,
+                                const struct net_diag_result* result);
+static void net_diag_task(void* pvParameters);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Log the result of a test.
+ *
+ * @param prefix A short description of the test.
+ * @param result The result of the test.
+ */
+static void net_diag_log_result(const char* prefix,
+                                const struct net_diag_result* result) {
+    struct in_addr peer = {.s_addr = result->peer_address};
+
+    ESP_LOGI(TAG,
+             "%s %s %s:%d: %u kbit/s (%u ms, %u lost, jitter %u us, errno %d)",
+             prefix,
+             (result->protocol == NET_DIAG_PROTOCOL_TCP) ? "TCP" : "UDP",
+             inet_ntoa(peer),
+             result->peer_port,
+             net_diag_result_kbps(result),
+             result->duration_ms,
+             result->lost,
+             result->jitter_us,
+             result->error);
+}
+
+/**
+ * The component's task.
+ *
+ * The task serves the sink and runs requested tests as source in between, so
+ * only one test is running at any time.
+ *
+ * If the component is started again, while the task is shutting down, the
+ * sink is re-opened instead of terminating the task.
+ *
+ * @param pvParameters Not used.
+ */
+static void net_diag_task(void* pvParameters) {
+    ESP_LOGV(TAG, "net_diag_task()");
+
+    struct net_diag_sink sink;
+    struct net_diag_result result;
+    bool restart;
+
+    do {
+        if (net_diag_sink_open(&sink,
+                               NET_DIAG_PORT,
+                               NET_DIAG_BUFFER_LENGTH,
+                               NET_DIAG_SOCKET_RCVBUF) != 0) {
+            ESP_LOGE(TAG, "Could not open sink (errno %d)!", errno);
+        } else {
+            ESP_LOGI(TAG, "Sink listening on port %d (TCP/UDP)", NET_DIAG_PORT);
+        }
+
+        while (!net_diag_state.stop) {
+            bool tx = false;
+            struct net_diag_source_config config;
+
+            portENTER_CRITICAL(&net_diag_lock);
+            if (net_diag_state.tx_pending) {
+                config = net_diag_state.tx_config;
+                net_diag_state.tx_pending = false;
+                net_diag_state.tx_busy = true;
+                tx = true;
+            }
+            portEXIT_CRITICAL(&net_diag_lock);
+
+            if (tx) {
+                net_diag_source_run(&config, &net_diag_state.stop, &result);
+                net_diag_log_result("Source", &result);
+
+                portENTER_CRITICAL(&net_diag_lock);
+                net_diag_state.tx = result;
+                net_diag_state.tx_valid = true;
+                net_diag_state.tx_busy = false;
+                portEXIT_CRITICAL(&net_diag_lock);
+                continue;
+            }
+
+            // Without a sink, just wait for requested tests as source.
+            if (sink.tcp_socket < 0) {
+                vTaskDelay(pdMS_TO_TICKS(NET_DIAG_ENGINE_POLL_INTERVAL));
+                continue;
+            }
+
+            int ret = net_diag_sink_serve(&sink,
+                                          NET_DIAG_ENGINE_POLL_INTERVAL,
+                                          &net_diag_state.stop,
+                                          &result);
+            if (ret > 0) {
+                net_diag_log_result("Sink", &result);
+
+                portENTER_CRITICAL(&net_diag_lock);
+                net_diag_state.rx = result;
+                net_diag_state.rx_valid = true;
+                portEXIT_CRITICAL(&net_diag_lock);
+            } else if (ret < 0) {
+                ESP_LOGE(TAG, "Sink failed (errno %d)!", errno);
+                vTaskDelay(pdMS_TO_TICKS(NET_DIAG_ENGINE_POLL_INTERVAL));
+            }
+        }
+
+        net_diag_sink_close(&sink);
+
+        portENTER_CRITICAL(&net_diag_lock);
+        restart = !net_diag_state.stop;
+        if (!restart)
+            net_diag_state.running = false;
+        portEXIT_CRITICAL(&net_diag_lock);
+    } while (restart);
+
+    ESP_LOGI(TAG, "Stopped");
+    vTaskDelete(NULL);
+}
+
+// This function is part of the component's public interface and documented in
+// ``include/net_diag/net_diag.h``
+void net_diag_external_event_handler_start(void* arg,
+                                           esp_event_base_t event_base,
+                                           int32_t event_id,
+                                           void* event_data) {
+    ESP_LOGV(TAG, "net_diag_external_event_handler_start()");
+
+    bool create;
+
+    portENTER_CRITICAL(&net_diag_lock);
+    create = !net_diag_state.running;
+    net_diag_state.running = true;
+    net_diag_state.stop = false;
+    portEXIT_CRITICAL(&net_diag_lock);
+
+    if (!create) {
+        ESP_LOGD(TAG, "Task is already running!");
+        return;
+    }
+
+    if (xTaskCreate(net_diag_task,
+                    "net_diag_task",
+                    NET_DIAG_TASK_STACK_SIZE,
+                    NULL,
+                    NET_DIAG_TASK_PRIORITY,
+                    NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Could not create task!");
+
+        portENTER_CRITICAL(&net_diag_lock);
+        net_diag_state.running = false;
+        portEXIT_CRITICAL(&net_diag_lock);
+    }
+}
+
+// This function is part of the component's public interface and documented in
+// ``include/net_diag/net_diag.h``
+void net_diag_external_event_handler_stop(void* arg,
+                                          esp_event_base_t event_base,
+                                          int32_t event_id,
+                                          void* event_data) {
+    ESP_LOGV(TAG, "net_diag_external_event_handler_stop()");
+
+    portENTER_CRITICAL(&net_diag_lock);
+    if (net_diag_state.running)
+        net_diag_state.stop = true;
+    net_diag_state.tx_pending = false;
+    portEXIT_CRITICAL(&net_diag_lock);
+}
+
+// Documentation in header file!
+void net_diag_get_status(struct net_diag_status* status) {
+    portENTER_CRITICAL(&net_diag_lock);
+    status->running = net_diag_state.running && !net_diag_state.stop;
+    status->rx_valid = net_diag_state.rx_valid;
+    status->rx = net_diag_state.rx;
+    status->tx_busy = net_diag_state.tx_pending || net_diag_state.tx_busy;
+    status->tx_valid = net_diag_state.tx_valid;
+    status->tx = net_diag_state.tx;
+    portEXIT_CRITICAL(&net_diag_lock);
+}
+
+// Documentation in header file!
+esp_err_t net_diag_request_source(struct net_diag_source_config* config) {
+    ESP_LOGV(TAG, "net_diag_request_source()");
+
+    config->length = NET_DIAG_BUFFER_LENGTH;
+    config->sndbuf = NET_DIAG_SOCKET_SNDBUF;
+
+    esp_err_t ret = ESP_OK;
+
+    portENTER_CRITICAL(&net_diag_lock);
+    if (!net_diag_state.running || net_diag_state.stop ||
+        net_diag_state.tx_pending || net_diag_state.tx_busy) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        net_diag_state.tx_config = *config;
+        net_diag_state.tx_pending = true;
+    }
+    portEXIT_CRITICAL(&net_diag_lock);
+
+    return ret;
+}
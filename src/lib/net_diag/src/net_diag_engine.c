@@ -0,0 +1,790 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The measurement engine of the ``net_diag`` component.
+ *
+ * The wire format follows **iperf** (version 2):
+ *   - a TCP test is just a stream of bytes, that is finished by closing the
+ *     connection;
+ *   - every datagram of a UDP test starts with a header of a sequence number
+ *     and the time of sending. A negative sequence number marks the final
+ *     datagram, which is answered by the sink with a report of the received
+ *     datagrams (including lost datagrams and the jitter).
+ *
+ * **Resources:**
+ *   - https://sourceforge.net/projects/iperf2/
+ *   - https://www.rfc-editor.org/rfc/rfc3550#appendix-A.8 (jitter)
+ *
+ * @file   net_diag_engine.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "net_diag_engine.h"
+
+/* C's standard libraries. */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The BSD socket API, provided by lwIP on the ESP32. */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * Flag of **iperf**'s UDP report, indicating that the report is valid.
+ */
+#define NET_DIAG_ENGINE_REPORT_VERSION1 0x80000000
+
+/**
+ * The number of attempts to get the report of a UDP sink.
+ */
+#define NET_DIAG_ENGINE_REPORT_ATTEMPTS 10
+
+/**
+ * A UDP source only sleeps, if it is ahead of its schedule by more than this
+ * timespan (in microseconds).
+ *
+ * Shorter sleeps would be implemented as busy waiting on the ESP32, so the
+ * datagrams are sent in short bursts instead.
+ */
+#define NET_DIAG_ENGINE_UDP_PACING_SLACK 10000
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * **iperf**'s header of a UDP datagram (network byte order).
+ */
+struct net_diag_engine_udp_header {
+    int32_t id;
+    uint32_t tv_sec;
+    uint32_t tv_usec;
+};
+
+/**
+ * **iperf**'s report of a UDP sink (network byte order).
+ *
+ * The report directly follows the ::net_diag_engine_udp_header of the final
+ * datagram.
+ */
+struct net_diag_engine_udp_report {
+    int32_t flags;
+    int32_t total_len1;
+    int32_t total_len2;
+    int32_t stop_sec;
+    int32_t stop_usec;
+    int32_t error_cnt;
+    int32_t outorder_cnt;
+    int32_t datagrams;
+    int32_t jitter1;
+    int32_t jitter2;
+};
+
+/**
+ * The progress of a UDP test, as seen by the sink.
+ */
+struct net_diag_engine_udp_stats {
+    int32_t expected;
+    int64_t last_transit;
+    double jitter;
+};
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static int64_t net_diag_engine_now_us(void);
+static int net_diag_engine_set_timeout(int sock, int option, uint32_t ms);
+static void net_diag_engine_set_buffer(int sock, int option, int size);
+static void net_diag_engine_close(int sock);
+static void net_diag_engine_result_init(struct net_diag_result* result,
+                                        net_diag_protocol protocol,
+                                        net_diag_direction direction,
+                                        const struct sockaddr_in* peer);
+static void net_diag_engine_udp_account(
+    struct net_diag_engine_udp_stats* stats,
+    struct net_diag_result* result,
+    const uint8_t* datagram,
+    int64_t arrival);
+static void net_diag_engine_udp_report(
+    struct net_diag_sink* sink,
+    const struct net_diag_result* result,
+    const struct net_diag_engine_udp_stats* stats);
+static int net_diag_engine_serve_tcp(struct net_diag_sink* sink,
+                                     const volatile bool* stop,
+                                     struct net_diag_result* result);
+static int net_diag_engine_serve_udp(struct net_diag_sink* sink,
+                                     const volatile bool* stop,
+                                     struct net_diag_result* result);
+static int net_diag_engine_source_tcp(
+    int sock,
+    uint8_t* buffer,
+    const struct net_diag_source_config* config,
+    const volatile bool* stop,
+    struct net_diag_result* result);
+static int net_diag_engine_source_udp(
+    int sock,
+    uint8_t* buffer,
+    const struct net_diag_source_config* config,
+    const volatile bool* stop,
+    struct net_diag_result* result);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get the current time.
+ *
+ * ``gettimeofday()`` is used, as **iperf** transmits its timestamps in this
+ * format.
+ *
+ * @return int64_t The current time in microseconds.
+ */
+static int64_t net_diag_engine_now_us(void) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return ((int64_t)now.tv_sec * 1000000) + now.tv_usec;
+}
+
+/**
+ * Set ``SO_RCVTIMEO`` or ``SO_SNDTIMEO`` of a socket.
+ *
+ * @param sock   The socket.
+ * @param option ``SO_RCVTIMEO`` or ``SO_SNDTIMEO``.
+ * @param ms     The timeout in milliseconds.
+ * @return int The return value of ``setsockopt()``.
+ */
+static int net_diag_engine_set_timeout(int sock, int option, uint32_t ms) {
+    struct timeval timeout = {
+        .tv_sec = ms / 1000,
+        .tv_usec = (ms % 1000) * 1000,
+    };
+    return setsockopt(sock, SOL_SOCKET, option, &timeout, sizeof(timeout));
+}
+
+/**
+ * Set ``SO_RCVBUF`` or ``SO_SNDBUF`` of a socket.
+ *
+ * Failures are ignored, as lwIP does not support ``SO_SNDBUF`` at all and
+ * ``SO_RCVBUF`` only with ``CONFIG_LWIP_SO_RCVBUF``. The test is run with
+ * the default buffer then.
+ *
+ * @param sock   The socket.
+ * @param option ``SO_RCVBUF`` or ``SO_SNDBUF``.
+ * @param size   The size in bytes, ``0`` keeps the system's default.
+ */
+static void net_diag_engine_set_buffer(int sock, int option, int size) {
+    if (size > 0)
+        setsockopt(sock, SOL_SOCKET, option, &size, sizeof(size));
+}
+
+/**
+ * Close a socket, preserving ``errno``.
+ *
+ * @param sock The socket, may be ``-1``.
+ */
+static void net_diag_engine_close(int sock) {
+    int saved = errno;
+    if (sock >= 0)
+        close(sock);
+    errno = saved;
+}
+
+/**
+ * Reset a result at the start of a test.
+ *
+ * @param result    The result.
+ * @param protocol  The protocol of the test.
+ * @param direction The direction of the test.
+ * @param peer      The remote end of the test.
+ */
+static void net_diag_engine_result_init(struct net_diag_result* result,
+                                        net_diag_protocol protocol,
+                                        net_diag_direction direction,
+                                        const struct sockaddr_in* peer) {
+    memset(result, 0x00, sizeof(struct net_diag_result));
+    result->protocol = protocol;
+    result->direction = direction;
+    result->peer_address = peer->sin_addr.s_addr;
+    result->peer_port = ntohs(peer->sin_port);
+}
+
+/**
+ * Account a received UDP datagram.
+ *
+ * Lost and out-of-order datagrams are detected by the sequence number, like
+ * **iperf** does. The jitter is estimated as specified by RFC 3550.
+ *
+ * @param stats    The progress of the test.
+ * @param result   The result of the test.
+ * @param datagram The received datagram, starting with
+ *                 ::net_diag_engine_udp_header .
+ * @param arrival  The time of arrival in microseconds.
+ */
+static void net_diag_engine_udp_account(
+    struct net_diag_engine_udp_stats* stats,
+    struct net_diag_result* result,
+    const uint8_t* datagram,
+    int64_t arrival) {
+    struct net_diag_engine_udp_header header;
+    memcpy(&header, datagram, sizeof(header));
+
+    int32_t id = (int32_t)ntohl((uint32_t)header.id);
+    bool final = (id < 0);
+    if (final)
+        id = -id;
+
+    if (id >= stats->expected) {
+        result->lost += (uint32_t)(id - stats->expected);
+        // The final datagram carries the next sequence number, but is not
+        // part of the test's datagrams.
+        stats->expected = final ? id : (id + 1);
+    } else {
+        result->out_of_order++;
+        if (result->lost > 0)
+            result->lost--;
+    }
+
+    int64_t sent = ((int64_t)ntohl(header.tv_sec) * 1000000) +
+                   ntohl(header.tv_usec);
+    int64_t transit = arrival - sent;
+    if (result->datagrams > 0) {
+        int64_t delta = transit - stats->last_transit;
+        if (delta < 0)
+            delta = -delta;
+        stats->jitter += ((double)delta - stats->jitter) / 16.0;
+    }
+    stats->last_transit = transit;
+    result->jitter_us = (uint32_t)stats->jitter;
+
+    if (!final)
+        result->datagrams++;
+}
+
+/**
+ * Build the report of a UDP sink and send it to the source.
+ *
+ * The report is kept in the sink, because the source repeats its final
+ * datagram, until the report is received.
+ *
+ * @param sink   The sink, holding the final datagram in its buffer.
+ * @param result The result of the test.
+ * @param stats  The progress of the test.
+ */
+static void net_diag_engine_udp_report(
+    struct net_diag_sink* sink,
+    const struct net_diag_result* result,
+    const struct net_diag_engine_udp_stats* stats) {
+    struct net_diag_engine_udp_report report = {
+        .flags = (int32_t)htonl(NET_DIAG_ENGINE_REPORT_VERSION1),
+        .total_len1 = (int32_t)htonl((uint32_t)(result->bytes >> 32)),
+        .total_len2 = (int32_t)htonl((uint32_t)result->bytes),
+        .stop_sec = (int32_t)htonl(result->duration_ms / 1000),
+        .stop_usec = (int32_t)htonl((result->duration_ms % 1000) * 1000),
+        .error_cnt = (int32_t)htonl(result->lost),
+        .outorder_cnt = (int32_t)htonl(result->out_of_order),
+        .datagrams = (int32_t)htonl((uint32_t)stats->expected),
+        .jitter1 = (int32_t)htonl(result->jitter_us / 1000000),
+        .jitter2 = (int32_t)htonl(result->jitter_us % 1000000),
+    };
+
+    memcpy(sink->report, sink->buffer, NET_DIAG_ENGINE_UDP_HEADER_LEN);
+    memcpy(sink->report + NET_DIAG_ENGINE_UDP_HEADER_LEN,
+           &report,
+           sizeof(report));
+    sink->report_valid = true;
+
+    struct sockaddr_in peer = {
+        .sin_family = AF_INET,
+        .sin_port = htons(result->peer_port),
+        .sin_addr.s_addr = result->peer_address,
+    };
+    sendto(sink->udp_socket,
+           sink->report,
+           sizeof(sink->report),
+           0,
+           (struct sockaddr*)&peer,
+           sizeof(peer));
+}
+
+// Documentation in header file!
+int net_diag_sink_open(struct net_diag_sink* sink,
+                       uint16_t port,
+                       size_t length,
+                       int rcvbuf) {
+    memset(sink, 0x00, sizeof(struct net_diag_sink));
+    sink->tcp_socket = -1;
+    sink->udp_socket = -1;
+
+    if (length < NET_DIAG_ENGINE_UDP_HEADER_LEN) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    sink->buffer = malloc(length);
+    if (sink->buffer == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    sink->length = length;
+
+    struct sockaddr_in local = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    int reuse = 1;
+
+    sink->tcp_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sink->tcp_socket < 0) {
+        net_diag_sink_close(sink);
+        return -1;
+    }
+    // ``SO_RCVBUF`` is set before ``listen()``, so accepted connections
+    // inherit it.
+    net_diag_engine_set_buffer(sink->tcp_socket, SO_RCVBUF, rcvbuf);
+    if ((setsockopt(sink->tcp_socket,
+                    SOL_SOCKET,
+                    SO_REUSEADDR,
+                    &reuse,
+                    sizeof(reuse)) != 0) ||
+        (bind(sink->tcp_socket, (struct sockaddr*)&local, sizeof(local)) !=
+         0) ||
+        (listen(sink->tcp_socket, 1) != 0)) {
+        net_diag_sink_close(sink);
+        return -1;
+    }
+
+    sink->udp_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sink->udp_socket < 0) {
+        net_diag_sink_close(sink);
+        return -1;
+    }
+    net_diag_engine_set_buffer(sink->udp_socket, SO_RCVBUF, rcvbuf);
+    if ((net_diag_engine_set_timeout(sink->udp_socket,
+                                     SO_RCVTIMEO,
+                                     NET_DIAG_ENGINE_POLL_INTERVAL) != 0) ||
+        (bind(sink->udp_socket, (struct sockaddr*)&local, sizeof(local)) !=
+         0)) {
+        net_diag_sink_close(sink);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Documentation in header file!
+int net_diag_sink_serve(struct net_diag_sink* sink,
+                        uint32_t wait_ms,
+                        const volatile bool* stop,
+                        struct net_diag_result* result) {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(sink->tcp_socket, &readable);
+    FD_SET(sink->udp_socket, &readable);
+
+    struct timeval timeout = {
+        .tv_sec = wait_ms / 1000,
+        .tv_usec = (wait_ms % 1000) * 1000,
+    };
+    int max_socket = (sink->tcp_socket > sink->udp_socket) ? sink->tcp_socket
+                                                           : sink->udp_socket;
+
+    int ret = select(max_socket + 1, &readable, NULL, NULL, &timeout);
+    if (ret < 0)
+        return (errno == EINTR) ? 0 : -1;
+    if (ret == 0)
+        return 0;
+
+    if (FD_ISSET(sink->tcp_socket, &readable))
+        return net_diag_engine_serve_tcp(sink, stop, result);
+
+    return net_diag_engine_serve_udp(sink, stop, result);
+}
+
+/**
+ * Serve a TCP test.
+ *
+ * The test is finished, when the source closes the connection.
+ *
+ * @param sink   The sink, with a pending connection.
+ * @param stop   A flag to abort the test.
+ * @param result The result of the test.
+ * @return int ``1`` if a test was served, ``-1`` on failure.
+ */
+static int net_diag_engine_serve_tcp(struct net_diag_sink* sink,
+                                     const volatile bool* stop,
+                                     struct net_diag_result* result) {
+    struct sockaddr_in peer;
+    socklen_t peer_len = sizeof(peer);
+
+    int sock = accept(sink->tcp_socket, (struct sockaddr*)&peer, &peer_len);
+    if (sock < 0)
+        return -1;
+
+    net_diag_engine_result_init(result,
+                                NET_DIAG_PROTOCOL_TCP,
+                                NET_DIAG_DIRECTION_RX,
+                                &peer);
+    net_diag_engine_set_timeout(sock,
+                                SO_RCVTIMEO,
+                                NET_DIAG_ENGINE_POLL_INTERVAL);
+
+    int64_t start = net_diag_engine_now_us();
+    int64_t last = start;
+
+    while (!*stop) {
+        ssize_t received = recv(sock, sink->buffer, sink->length, 0);
+        if (received > 0) {
+            result->bytes += (uint64_t)received;
+            last = net_diag_engine_now_us();
+        } else if (received == 0) {
+            break;
+        } else if ((errno != EAGAIN) && (errno != EWOULDBLOCK) &&
+                   (errno != EINTR)) {
+            result->error = errno;
+            break;
+        }
+    }
+
+    result->duration_ms = (uint32_t)((last - start) / 1000);
+    net_diag_engine_close(sock);
+    return 1;
+}
+
+/**
+ * Serve a UDP test.
+ *
+ * The test is finished by the source's final datagram or if no datagram is
+ * received for ::NET_DIAG_ENGINE_UDP_IDLE_TIMEOUT .
+ *
+ * Final datagrams, that arrive after the test is finished, are answered with
+ * the most recent report, but do not start a new test.
+ *
+ * @param sink   The sink, with a pending datagram.
+ * @param stop   A flag to abort the test.
+ * @param result The result of the test.
+ * @return int ``1`` if a test was served, ``0`` if no test was started and
+ *             ``-1`` on failure.
+ */
+static int net_diag_engine_serve_udp(struct net_diag_sink* sink,
+                                     const volatile bool* stop,
+                                     struct net_diag_result* result) {
+    struct sockaddr_in peer;
+    socklen_t peer_len = sizeof(peer);
+
+    ssize_t received = recvfrom(sink->udp_socket,
+                                sink->buffer,
+                                sink->length,
+                                0,
+                                (struct sockaddr*)&peer,
+                                &peer_len);
+    if (received < 0)
+        return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? 0 : -1;
+    if (received < NET_DIAG_ENGINE_UDP_HEADER_LEN)
+        return 0;
+
+    struct net_diag_engine_udp_header header;
+    memcpy(&header, sink->buffer, sizeof(header));
+    if ((int32_t)ntohl((uint32_t)header.id) < 0) {
+        if (sink->report_valid) {
+            sendto(sink->udp_socket,
+                   sink->report,
+                   sizeof(sink->report),
+                   0,
+                   (struct sockaddr*)&peer,
+                   peer_len);
+        }
+        return 0;
+    }
+
+    net_diag_engine_result_init(result,
+                                NET_DIAG_PROTOCOL_UDP,
+                                NET_DIAG_DIRECTION_RX,
+                                &peer);
+    struct net_diag_engine_udp_stats stats = {0};
+    sink->report_valid = false;
+
+    int64_t start = net_diag_engine_now_us();
+    int64_t last = start;
+    result->bytes += (uint64_t)received;
+    net_diag_engine_udp_account(&stats, result, sink->buffer, start);
+
+    while (!*stop) {
+        struct sockaddr_in sender;
+        socklen_t sender_len = sizeof(sender);
+
+        received = recvfrom(sink->udp_socket,
+                            sink->buffer,
+                            sink->length,
+                            0,
+                            (struct sockaddr*)&sender,
+                            &sender_len);
+        int64_t now = net_diag_engine_now_us();
+
+        if (received < 0) {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK) &&
+                (errno != EINTR)) {
+                result->error = errno;
+                break;
+            }
+            if ((now - last) > (NET_DIAG_ENGINE_UDP_IDLE_TIMEOUT * 1000))
+                break;
+            continue;
+        }
+
+        // Datagrams of other sources are dropped.
+        if ((received < NET_DIAG_ENGINE_UDP_HEADER_LEN) ||
+            (sender.sin_addr.s_addr != peer.sin_addr.s_addr) ||
+            (sender.sin_port != peer.sin_port))
+            continue;
+
+        last = now;
+        result->bytes += (uint64_t)received;
+        net_diag_engine_udp_account(&stats, result, sink->buffer, now);
+
+        memcpy(&header, sink->buffer, sizeof(header));
+        if ((int32_t)ntohl((uint32_t)header.id) < 0) {
+            result->duration_ms = (uint32_t)((last - start) / 1000);
+            net_diag_engine_udp_report(sink, result, &stats);
+            return 1;
+        }
+    }
+
+    result->duration_ms = (uint32_t)((last - start) / 1000);
+    return 1;
+}
+
+// Documentation in header file!
+void net_diag_sink_close(struct net_diag_sink* sink) {
+    net_diag_engine_close(sink->tcp_socket);
+    net_diag_engine_close(sink->udp_socket);
+    sink->tcp_socket = -1;
+    sink->udp_socket = -1;
+
+    free(sink->buffer);
+    sink->buffer = NULL;
+}
+
+// Documentation in header file!
+int net_diag_source_run(const struct net_diag_source_config* config,
+                        const volatile bool* stop,
+                        struct net_diag_result* result) {
+    struct sockaddr_in peer = {
+        .sin_family = AF_INET,
+        .sin_port = htons(config->port),
+        .sin_addr.s_addr = config->address,
+    };
+    net_diag_engine_result_init(result,
+                                config->protocol,
+                                NET_DIAG_DIRECTION_TX,
+                                &peer);
+
+    if ((config->length == 0) ||
+        ((config->protocol == NET_DIAG_PROTOCOL_UDP) &&
+         (config->length < NET_DIAG_ENGINE_UDP_HEADER_LEN))) {
+        result->error = EINVAL;
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint8_t* buffer = calloc(1, config->length);
+    if (buffer == NULL) {
+        result->error = ENOMEM;
+        errno = ENOMEM;
+        return -1;
+    }
+
+    int sock = (config->protocol == NET_DIAG_PROTOCOL_TCP)
+                   ? socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)
+                   : socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock >= 0)
+        net_diag_engine_set_buffer(sock, SO_SNDBUF, config->sndbuf);
+    if ((sock < 0) ||
+        (net_diag_engine_set_timeout(sock,
+                                     SO_SNDTIMEO,
+                                     NET_DIAG_ENGINE_POLL_INTERVAL) != 0) ||
+        (net_diag_engine_set_timeout(sock,
+                                     SO_RCVTIMEO,
+                                     NET_DIAG_ENGINE_POLL_INTERVAL) != 0) ||
+        (connect(sock, (struct sockaddr*)&peer, sizeof(peer)) != 0)) {
+        result->error = errno;
+        net_diag_engine_close(sock);
+        free(buffer);
+        return -1;
+    }
+
+    int ret;
+    if (config->protocol == NET_DIAG_PROTOCOL_TCP) {
+        ret = net_diag_engine_source_tcp(sock, buffer, config, stop, result);
+    } else {
+        ret = net_diag_engine_source_udp(sock, buffer, config, stop, result);
+    }
+
+    net_diag_engine_close(sock);
+    free(buffer);
+    return ret;
+}
+
+/**
+ * Send a TCP test.
+ *
+ * @param sock   The connected socket.
+ * @param buffer The payload of a single write.
+ * @param config The configuration of the test.
+ * @param stop   A flag to abort the test.
+ * @param result The result of the test.
+ * @return int ``0`` on success, ``-1`` on failure.
+ */
+static int net_diag_engine_source_tcp(
+    int sock,
+    uint8_t* buffer,
+    const struct net_diag_source_config* config,
+    const volatile bool* stop,
+    struct net_diag_result* result) {
+    int64_t start = net_diag_engine_now_us();
+    int64_t end = start + ((int64_t)config->duration_ms * 1000);
+    int64_t now = start;
+
+    while (!*stop && (now < end)) {
+        ssize_t sent = send(sock, buffer, config->length, 0);
+        if (sent > 0) {
+            result->bytes += (uint64_t)sent;
+        } else if ((errno != EAGAIN) && (errno != EWOULDBLOCK) &&
+                   (errno != EINTR)) {
+            result->error = errno;
+            break;
+        }
+        now = net_diag_engine_now_us();
+    }
+
+    result->duration_ms = (uint32_t)((now - start) / 1000);
+    return (result->error == 0) ? 0 : -1;
+}
+
+/**
+ * Send a UDP test.
+ *
+ * The datagrams are paced to match the configured bandwidth. A bandwidth of
+ * ``0`` sends as fast as possible.
+ *
+ * Finally, the report of the sink is requested, providing the number of lost
+ * datagrams and the jitter.
+ *
+ * @param sock   The connected socket.
+ * @param buffer The buffer for a single datagram.
+ * @param config The configuration of the test.
+ * @param stop   A flag to abort the test.
+ * @param result The result of the test.
+ * @return int ``0`` on success, ``-1`` on failure.
+ */
+static int net_diag_engine_source_udp(
+    int sock,
+    uint8_t* buffer,
+    const struct net_diag_source_config* config,
+    const volatile bool* stop,
+    struct net_diag_result* result) {
+    int64_t interval = 0;
+    if (config->bandwidth > 0) {
+        interval =
+            ((int64_t)config->length * 8 * 1000000) / config->bandwidth;
+    }
+
+    struct net_diag_engine_udp_header header;
+    int32_t id = 0;
+    int64_t start = net_diag_engine_now_us();
+    int64_t end = start + ((int64_t)config->duration_ms * 1000);
+    int64_t next = start;
+    int64_t now = start;
+
+    while (!*stop && (now < end)) {
+        if ((next - now) > NET_DIAG_ENGINE_UDP_PACING_SLACK) {
+            usleep((useconds_t)(next - now));
+            now = net_diag_engine_now_us();
+            continue;
+        }
+
+        header.id = (int32_t)htonl((uint32_t)id);
+        header.tv_sec = htonl((uint32_t)(now / 1000000));
+        header.tv_usec = htonl((uint32_t)(now % 1000000));
+        memcpy(buffer, &header, sizeof(header));
+
+        ssize_t sent = send(sock, buffer, config->length, 0);
+        if (sent > 0) {
+            result->bytes += (uint64_t)sent;
+            result->datagrams++;
+            id++;
+            next += interval;
+        } else if ((errno == ENOBUFS) || (errno == ENOMEM)) {
+            // lwIP runs out of buffers, if datagrams are sent faster than
+            // the link can transmit them.
+            usleep(NET_DIAG_ENGINE_UDP_PACING_SLACK);
+        } else if ((errno != EAGAIN) && (errno != EWOULDBLOCK) &&
+                   (errno != EINTR)) {
+            result->error = errno;
+            break;
+        }
+        now = net_diag_engine_now_us();
+    }
+    result->duration_ms = (uint32_t)((now - start) / 1000);
+
+    if (result->error != 0)
+        return -1;
+
+    // Request the sink's report with the final datagram.
+    for (int attempt = 0; attempt < NET_DIAG_ENGINE_REPORT_ATTEMPTS;
+         attempt++) {
+        now = net_diag_engine_now_us();
+        header.id = (int32_t)htonl((uint32_t)-id);
+        header.tv_sec = htonl((uint32_t)(now / 1000000));
+        header.tv_usec = htonl((uint32_t)(now % 1000000));
+        memcpy(buffer, &header, sizeof(header));
+
+        if (send(sock, buffer, config->length, 0) < 0)
+            continue;
+
+        uint8_t reply[NET_DIAG_ENGINE_UDP_HEADER_LEN +
+                      sizeof(struct net_diag_engine_udp_report)];
+        if (recv(sock, reply, sizeof(reply), 0) < (ssize_t)sizeof(reply))
+            continue;
+
+        struct net_diag_engine_udp_report report;
+        memcpy(&report,
+               reply + NET_DIAG_ENGINE_UDP_HEADER_LEN,
+               sizeof(report));
+        if ((ntohl((uint32_t)report.flags) &
+             NET_DIAG_ENGINE_REPORT_VERSION1) == 0)
+            continue;
+
+        result->lost = ntohl((uint32_t)report.error_cnt);
+        result->out_of_order = ntohl((uint32_t)report.outorder_cnt);
+        result->jitter_us = (ntohl((uint32_t)report.jitter1) * 1000000) +
+                            ntohl((uint32_t)report.jitter2);
+        break;
+    }
+
+    return 0;
+}
+
+// Documentation in header file!
+uint32_t net_diag_result_kbps(const struct net_diag_result* result) {
+    if (result->duration_ms == 0)
+        return 0;
+
+    // bits per millisecond equals kbit/s
+    return (uint32_t)((result->bytes * 8) / result->duration_ms);
+}
@@ -0,0 +1,185 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The measurement engine of the ``net_diag`` component.
+ *
+ * The engine implements sinks and sources for throughput tests, that are
+ * compatible with **iperf** (version 2). It only depends on the BSD socket
+ * API, so it builds with **ESP-IDF** (lwIP) and on a Linux host (see
+ * ``tools/net_diag``).
+ *
+ * Errors are reported as ``-1`` with ``errno`` set, as there is no
+ * ``esp_err_t`` on the host.
+ *
+ * @file   net_diag_engine.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_NET_DIAG_SRC_NET_DIAG_ENGINE_H_
+#define SRC_LIB_NET_DIAG_SRC_NET_DIAG_ENGINE_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * The size of **iperf**'s UDP datagram header.
+ *
+ * Datagrams of a UDP test must at least be able to hold this header.
+ */
+#define NET_DIAG_ENGINE_UDP_HEADER_LEN 12
+
+/**
+ * The timespan to wait while polling sockets (in milliseconds).
+ *
+ * This determines, how fast the engine reacts on a stop request.
+ */
+#define NET_DIAG_ENGINE_POLL_INTERVAL 250
+
+/**
+ * A UDP test is considered finished, if no datagram is received for this
+ * timespan (in milliseconds).
+ *
+ * Usually, the test is finished by the source's final datagram.
+ */
+#define NET_DIAG_ENGINE_UDP_IDLE_TIMEOUT 2000
+
+/**
+ * The protocol of a throughput test.
+ */
+typedef enum {
+    NET_DIAG_PROTOCOL_TCP,
+    NET_DIAG_PROTOCOL_UDP,
+} net_diag_protocol;
+
+/**
+ * The direction of a throughput test, as seen from the local device.
+ */
+typedef enum {
+    NET_DIAG_DIRECTION_RX,
+    NET_DIAG_DIRECTION_TX,
+} net_diag_direction;
+
+/**
+ * The result of a single throughput test.
+ *
+ * ``datagrams``, ``lost``, ``out_of_order`` and ``jitter_us`` are only
+ * provided for UDP tests. For UDP sources, they are taken from the report of
+ * the remote sink (if received).
+ */
+struct net_diag_result {
+    net_diag_protocol protocol;
+    net_diag_direction direction;
+    uint32_t peer_address;  // network byte order
+    uint16_t peer_port;
+    uint64_t bytes;
+    uint32_t duration_ms;
+    uint32_t datagrams;
+    uint32_t lost;
+    uint32_t out_of_order;
+    uint32_t jitter_us;
+    int error;  // ``errno`` of a failed test, ``0`` otherwise
+};
+
+/**
+ * The configuration of a source (the local device sends).
+ */
+struct net_diag_source_config {
+    net_diag_protocol protocol;
+    uint32_t address;  // network byte order
+    uint16_t port;
+    uint32_t duration_ms;
+    uint32_t bandwidth;  // bits per second, UDP only
+    size_t length;       // length of a single write / datagram
+    int sndbuf;          // ``SO_SNDBUF``, ``0`` keeps the default
+};
+
+/**
+ * A sink (the local device receives), accepting TCP and UDP tests on the same
+ * port.
+ *
+ * The members are managed by the engine and must not be modified.
+ */
+struct net_diag_sink {
+    int tcp_socket;
+    int udp_socket;
+    uint8_t* buffer;
+    size_t length;
+    uint8_t report[NET_DIAG_ENGINE_UDP_HEADER_LEN + 40];
+    bool report_valid;
+};
+
+
+/**
+ * Open the sockets of a sink.
+ *
+ * @param sink   The sink to be opened.
+ * @param port   The TCP and UDP port to listen on.
+ * @param length The length of the receive buffer, which limits the size of
+ *               UDP datagrams.
+ * @param rcvbuf The value for ``SO_RCVBUF``, ``0`` keeps the system's
+ *               default.
+ * @return int ``0`` on success, ``-1`` on failure (with ``errno`` set).
+ */
+int net_diag_sink_open(struct net_diag_sink* sink,
+                       uint16_t port,
+                       size_t length,
+                       int rcvbuf);
+
+/**
+ * Wait for a test and serve it.
+ *
+ * The function waits for an incoming TCP connection or UDP datagram for at
+ * most ``wait_ms`` milliseconds. If a test is started, it is served until it
+ * is finished by the source or ``stop`` is set.
+ *
+ * @param sink    The (opened) sink.
+ * @param wait_ms The timespan to wait for a test (in milliseconds).
+ * @param stop    A flag to abort a running test.
+ * @param result  The result of the served test.
+ * @return int ``1`` if a test was served, ``0`` if no test was started within
+ *             ``wait_ms`` and ``-1`` on failure (with ``errno`` set).
+ */
+int net_diag_sink_serve(struct net_diag_sink* sink,
+                        uint32_t wait_ms,
+                        const volatile bool* stop,
+                        struct net_diag_result* result);
+
+/**
+ * Close the sockets of a sink and release its buffer.
+ *
+ * @param sink The sink to be closed.
+ */
+void net_diag_sink_close(struct net_diag_sink* sink);
+
+/**
+ * Run a test as source.
+ *
+ * The function blocks until the test's duration has elapsed or ``stop`` is
+ * set.
+ *
+ * @param config The configuration of the test.
+ * @param stop   A flag to abort the test.
+ * @param result The result of the test.
+ * @return int ``0`` on success, ``-1`` on failure (with ``errno`` set).
+ */
+int net_diag_source_run(const struct net_diag_source_config* config,
+                        const volatile bool* stop,
+                        struct net_diag_result* result);
+
+/**
+ * Calculate the throughput of a test.
+ *
+ * @param result The result of the test.
+ * @return uint32_t The throughput in kbit/s.
+ */
+uint32_t net_diag_result_kbps(const struct net_diag_result* result);
+
+#endif  // SRC_LIB_NET_DIAG_SRC_NET_DIAG_ENGINE_H_
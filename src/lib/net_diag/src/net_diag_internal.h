@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+#ifndef SRC_LIB_NET_DIAG_SRC_NET_DIAG_INTERNAL_H_
+#define SRC_LIB_NET_DIAG_SRC_NET_DIAG_INTERNAL_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+
+/* Other headers of the component. */
+#include "net_diag_engine.h"
+
+/* This is ESP-IDF's error handling library. */
+#include "esp_err.h"
+
+
+/**
+ * A snapshot of the component's status and its most recent results.
+ */
+struct net_diag_status {
+    bool running;
+    bool rx_valid;
+    struct net_diag_result rx;
+    bool tx_busy;
+    bool tx_valid;
+    struct net_diag_result tx;
+};
+
+
+/**
+ * Get a snapshot of the component's status.
+ *
+ * @param status The snapshot.
+ */
+void net_diag_get_status(struct net_diag_status* status);
+
+/**
+ * Request a test as source.
+ *
+ * The test is run by the component's task, as soon as the sink is idle.
+ *
+ * @param config The configuration of the test. ``length`` and ``sndbuf`` are
+ *               set by the component.
+ * @return esp_err_t ``ESP_OK`` if the test was scheduled,
+ *                   ``ESP_ERR_INVALID_STATE`` if the component is not running
+ *                   or another test as source is pending.
+ */
+esp_err_t net_diag_request_source(struct net_diag_source_config* config);
+
+#endif  // SRC_LIB_NET_DIAG_SRC_NET_DIAG_INTERNAL_H_
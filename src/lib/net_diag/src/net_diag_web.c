@@ -0,0 +1,335 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The web interface of the ``net_diag`` component.
+ *
+ * Basically this includes **route definitions** (see ``min_httpd``) and the
+ * respective **URI handler** implementations.
+ *
+ * @file   net_diag_web.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Other headers of the component */
+#include "net_diag/net_diag.h"  // The public header
+#include "net_diag_engine.h"
+#include "net_diag_internal.h"
+
+/* This is ESP-IDF's error handling library.
+ * - defines the type ``esp_err_t``
+ * - defines the return values ``ESP_OK`` (0) and ``ESP_FAIL`` (-1)
+ */
+#include "esp_err.h"
+
+/* This is ESP-IDF's event library.
+ * - defines ``esp_event_base_t``
+ */
+#include "esp_event.h"
+
+/* This is EPS-IDF's http server library. */
+#include "esp_http_server.h"
+
+/* This is ESP-IDF's logging library.
+ * - ESP_LOGE(TAG, "Error");
+ * - ESP_LOGW(TAG, "Warning");
+ * - ESP_LOGI(TAG, "Info");
+ * - ESP_LOGD(TAG, "Debug");
+ * - ESP_LOGV(TAG, "Verbose");
+ */
+#include "esp_log.h"
+
+/* The BSD socket API, used to parse and format addresses. */
+#include <arpa/inet.h>
+
+/* The project's web server, which admits the requests of the routes. */
+#include "min_httpd/min_httpd.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The maximum length of the POST body to request a test as source.
+ */
+#define NET_DIAG_WEB_POST_MAX_LEN 128
+
+/**
+ * The length of the JSON representation of the component's status.
+ */
+#define NET_DIAG_WEB_JSON_LEN 640
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ *
+ * See
+ * [its API documentation](https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/log.html#how-to-use-this-library).
+ */
+static const char* TAG = "net_diag.web";
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static esp_err_t net_diag_web_handler_get(httpd_req_t* request);
+static esp_err_t net_diag_web_handler_post(httpd_req_t* request);
+static int net_diag_web_result_json(char* buf,
+                                    size_t size,
+                                    bool valid,
+                                    const struct net_diag_result* result);
+static uint32_t net_diag_web_get_uint(const char* body,
+                                      const char* key,
+                                      uint32_t fallback);
+
+
+/* ***** URI DEFINITIONS ***************************************************
+ * (technically, these are ``variables``, but as the handler functions must be
+ *  referenced, these must come after the ``prototypes``)
+ */
+
+/**
+ * Route definition for the results.
+ */
+static const struct min_httpd_route net_diag_web_route_get = {
+    .uri = NET_DIAG_WEB_URL,
+    .method = HTTP_GET,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = net_diag_web_handler_get,
+    .user_ctx = NULL,
+    .cost = MIN_HTTPD_LIMIT_COST_INLINE};
+
+/**
+ * Route definition to request a test as source.
+ *
+ * The test is run by the component's task, so the route is not offloaded.
+ */
+static const struct min_httpd_route net_diag_web_route_post = {
+    .uri = NET_DIAG_WEB_URL,
+    .method = HTTP_POST,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = net_diag_web_handler_post,
+    .user_ctx = NULL,
+    .cost = MIN_HTTPD_LIMIT_COST_INLINE};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+// This function is part of the component's public interface and documented in
+// ``include/net_diag/net_diag.h``
+void net_diag_web_attach_handlers(void* arg,
+                                  esp_event_base_t event_base,
+                                  int32_t event_id,
+                                  void* event_data) {
+    // Get the server from ``event_data``
+    httpd_handle_t server = *((httpd_handle_t*)event_data);
+
+    // Register this component's *URI handlers* with the server instance.
+    min_httpd_register_route(server, &net_diag_web_route_get);
+    min_httpd_register_route(server, &net_diag_web_route_post);
+}
+
+/**
+ * Write the JSON representation of a result.
+ *
+ * @param buf    The buffer to write to.
+ * @param size   The size of the buffer.
+ * @param valid  Flag to indicate if there is a result at all.
+ * @param result The result.
+ * @return int The return value of ``snprintf()``.
+ */
+static int net_diag_web_result_json(char* buf,
+                                    size_t size,
+                                    bool valid,
+                                    const struct net_diag_result* result) {
+    if (!valid)
+        return snprintf(buf, size, "null");
+
+    struct in_addr peer = {.s_addr = result->peer_address};
+
+    return snprintf(buf,
+                    size,
+                    "{\"protocol\":\"%s\",\"peer\":\"%s:%d\","
+                    "\"bytes\":%" PRIu64 ",\"duration_ms\":%" PRIu32
+                    ",\"kbps\":%" PRIu32 ",\"datagrams\":%" PRIu32
+                    ",\"lost\":%" PRIu32 ",\"out_of_order\":%" PRIu32
+                    ",\"jitter_us\":%" PRIu32 ",\"error\":%d}",
+                    (result->protocol == NET_DIAG_PROTOCOL_TCP) ? "tcp"
+                                                                : "udp",
+                    inet_ntoa(peer),
+                    result->peer_port,
+                    result->bytes,
+                    result->duration_ms,
+                    net_diag_result_kbps(result),
+                    result->datagrams,
+                    result->lost,
+                    result->out_of_order,
+                    result->jitter_us,
+                    result->error);
+}
+
+/**
+ * Provide the component's status and the most recent results as JSON.
+ *
+ * The matching *route definition* is ::net_diag_web_route_get.
+ *
+ * ``rx`` is the result of the most recent test served by the sink, ``tx``
+ * the result of the most recent test as source.
+ *
+ * @param request The request that should be responded to with this function.
+ * @return esp_err_t The return value of ``httpd_resp_send()``.
+ */
+static esp_err_t net_diag_web_handler_get(httpd_req_t* request) {
+    ESP_LOGV(TAG, "net_diag_web_handler_get()");
+
+    struct net_diag_status status;
+    net_diag_get_status(&status);
+
+    char* buf = malloc(NET_DIAG_WEB_JSON_LEN);
+    if (buf == NULL) {
+        httpd_resp_send_500(request);
+        return ESP_FAIL;
+    }
+
+    int off = snprintf(buf,
+                       NET_DIAG_WEB_JSON_LEN,
+                       "{\"running\":%s,\"port\":%d,\"tx_busy\":%s,\"rx\":",
+                       status.running ? "true" : "false",
+                       NET_DIAG_PORT,
+                       status.tx_busy ? "true" : "false");
+    off += net_diag_web_result_json(buf + off,
+                                    NET_DIAG_WEB_JSON_LEN - off,
+                                    status.rx_valid,
+                                    &status.rx);
+    off += snprintf(buf + off, NET_DIAG_WEB_JSON_LEN - off, ",\"tx\":");
+    off += net_diag_web_result_json(buf + off,
+                                    NET_DIAG_WEB_JSON_LEN - off,
+                                    status.tx_valid,
+                                    &status.tx);
+    snprintf(buf + off, NET_DIAG_WEB_JSON_LEN - off, "}");
+
+    httpd_resp_set_type(request, "application/json");
+    esp_err_t ret = httpd_resp_send(request, buf, HTTPD_RESP_USE_STRLEN);
+    free(buf);
+    return ret;
+}
+
+/**
+ * Get an unsigned integer from a form-encoded body.
+ *
+ * @param body     The form-encoded body.
+ * @param key      The key to be searched for.
+ * @param fallback The value to be returned, if ``key`` is not found.
+ * @return uint32_t The value of ``key`` or ``fallback``.
+ */
+static uint32_t net_diag_web_get_uint(const char* body,
+                                      const char* key,
+                                      uint32_t fallback) {
+    char value[12];
+
+    if (httpd_query_key_value(body, key, value, sizeof(value)) != ESP_OK)
+        return fallback;
+
+    return (uint32_t)strtoul(value, NULL, 10);
+}
+
+/**
+ * Request a test as source.
+ *
+ * The matching *route definition* is ::net_diag_web_route_post.
+ *
+ * The request is answered with HTTP 202, as the test is run asynchronously.
+ * Its result is provided by ::net_diag_web_handler_get. If the parameters are
+ * invalid, HTTP 400 is returned; HTTP 409 if the component is not running or
+ * busy with another test as source.
+ *
+ * @param request The request that should be responded to with this function.
+ * @return esp_err_t
+ */
+static esp_err_t net_diag_web_handler_post(httpd_req_t* request) {
+    ESP_LOGV(TAG, "net_diag_web_handler_post()");
+
+    /* Receive POST body */
+    char body[NET_DIAG_WEB_POST_MAX_LEN + 1];
+    if (request->content_len > NET_DIAG_WEB_POST_MAX_LEN) {
+        httpd_resp_send_err(request, HTTPD_400_BAD_REQUEST, "Body too long");
+        return ESP_FAIL;
+    }
+
+    size_t off = 0;
+    while (off < request->content_len) {
+        int ret =
+            httpd_req_recv(request, body + off, request->content_len - off);
+        if (ret <= 0) {
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+                httpd_resp_send_408(request);
+            }
+            return ESP_FAIL;
+        }
+        off += ret;
+    }
+    body[off] = '\0';
+    ESP_LOGV(TAG, "received [%s]", body);
+
+    /* Parse POST body */
+    struct net_diag_source_config config = {0};
+    char value[16];
+
+    if ((httpd_query_key_value(body, "protocol", value, sizeof(value)) ==
+         ESP_OK) &&
+        (strcmp(value, "udp") == 0)) {
+        config.protocol = NET_DIAG_PROTOCOL_UDP;
+    } else {
+        config.protocol = NET_DIAG_PROTOCOL_TCP;
+    }
+
+    struct in_addr address;
+    if ((httpd_query_key_value(body, "host", value, sizeof(value)) !=
+         ESP_OK) ||
+        (inet_aton(value, &address) == 0)) {
+        httpd_resp_send_err(request, HTTPD_400_BAD_REQUEST, "Invalid host");
+        return ESP_FAIL;
+    }
+    config.address = address.s_addr;
+
+    uint32_t port = net_diag_web_get_uint(body, "port", NET_DIAG_PORT);
+    uint32_t duration = net_diag_web_get_uint(body, "time", 10);
+    if ((port == 0) || (port > UINT16_MAX) || (duration == 0) ||
+        (duration > NET_DIAG_SOURCE_MAX_DURATION)) {
+        httpd_resp_send_err(request,
+                            HTTPD_400_BAD_REQUEST,
+                            "Invalid port or time");
+        return ESP_FAIL;
+    }
+    config.port = (uint16_t)port;
+    config.duration_ms = duration * 1000;
+
+    uint32_t bandwidth = net_diag_web_get_uint(body, "bandwidth", 1000);
+    if ((bandwidth == 0) || (bandwidth > NET_DIAG_SOURCE_MAX_BANDWIDTH)) {
+        httpd_resp_send_err(request,
+                            HTTPD_400_BAD_REQUEST,
+                            "Invalid bandwidth");
+        return ESP_FAIL;
+    }
+    config.bandwidth = bandwidth * 1000;
+
+    if (net_diag_request_source(&config) != ESP_OK) {
+        httpd_resp_set_status(request, "409 Conflict");
+        return httpd_resp_send(request, "Busy", HTTPD_RESP_USE_STRLEN);
+    }
+
+    httpd_resp_set_status(request, "202 Accepted");
+    return httpd_resp_send(request, "", HTTPD_RESP_USE_STRLEN);
+}
@@ -0,0 +1,265 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The metrics registry of the ``obs32`` component.
+ *
+ * Components declare their metrics at compile time: the storage of the
+ * values is static and the descriptions (name, help, labels and type) are a
+ * ``static const`` table, that is registered as a *group* once at startup
+ * (see ::obs32_metrics_register ). The registry is a lock-free list of the
+ * groups, which is rendered in the Prometheus text format on request (see
+ * ::obs32_metrics_render ), e.g. by ``min_httpd``'s ``/metrics``.
+ *
+ * The values are updated without locks:
+ *   - a *counter* has a 32 bit slot per core, that is incremented atomically
+ *     by the tasks of that core, so the cores never write the same slot;
+ *   - a *gauge* is a single value, that is set atomically;
+ *   - a *histogram* has fixed upper bounds (at most
+ *     ::OBS32_METRICS_MAX_BOUNDS ) and a counter per bucket and for the sum
+ *     of the observed values.
+ *
+ * The slots wrap around. Every rendering folds the change since the previous
+ * rendering into a 64 bit total, so the exported counters do not wrap, as
+ * long as less than 2^32 is added to a value between two renderings.
+ *
+ * Counters and gauges, that are already maintained by their component (e.g.
+ * statistics structs), are provided with a ``read`` function instead of
+ * storage, so they are not counted twice.
+ *
+ * The registry does not depend on **ESP-IDF**, so it builds on a Linux host
+ * (see ``tools/obs32/metrics``). Only the core of the calling task is
+ * determined with FreeRTOS, if available.
+ *
+ * @file   obs32_metrics.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_OBS32_INCLUDE_OBS32_OBS32_METRICS_H_
+#define SRC_LIB_OBS32_INCLUDE_OBS32_OBS32_METRICS_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef OBS32_METRICS_CORE_ID
+#ifdef ESP_PLATFORM
+/* FreeRTOS headers.
+ * - provides the core of the calling task (``xPortGetCoreID()``)
+ */
+#include "freertos/FreeRTOS.h"
+
+/**
+ * Determine the core of the calling task, which selects its slots.
+ */
+#define OBS32_METRICS_CORE_ID() ((unsigned int)xPortGetCoreID())
+#else
+#define OBS32_METRICS_CORE_ID() 0u
+#endif
+#endif
+
+
+/**
+ * The number of slots of every counter.
+ */
+#define OBS32_METRICS_CORES 2
+
+/**
+ * The maximum number of upper bounds of a histogram.
+ */
+#define OBS32_METRICS_MAX_BOUNDS 12
+
+/**
+ * Initialize a histogram with its upper bounds.
+ *
+ * @param b The upper bounds, an array of ascending ``uint32_t``.
+ */
+#define OBS32_METRICS_HISTOGRAM(b) \
+    { .bounds = (b), .count = sizeof(b) / sizeof((b)[0]) }
+
+/**
+ * The kinds of metrics.
+ */
+enum obs32_metric_type {
+    OBS32_METRIC_COUNTER,
+    OBS32_METRIC_GAUGE,
+    OBS32_METRIC_HISTOGRAM
+};
+
+/**
+ * The storage of a counter.
+ */
+struct obs32_metric_counter {
+    uint32_t cores[OBS32_METRICS_CORES];
+    uint32_t seen;   // the sum of ``cores`` at the previous rendering
+    uint64_t total;  // the folded value
+};
+
+/**
+ * The storage of a gauge.
+ */
+struct obs32_metric_gauge {
+    int32_t value;
+};
+
+/**
+ * The storage of a histogram.
+ *
+ * Initialize it with ::OBS32_METRICS_HISTOGRAM . The slot after the bounds'
+ * slots counts the values above all bounds, the last slot is the sum.
+ */
+struct obs32_metric_histogram {
+    const uint32_t* bounds;
+    size_t count;  // the number of ``bounds``
+    uint32_t cores[OBS32_METRICS_CORES][OBS32_METRICS_MAX_BOUNDS + 2];
+    uint32_t seen[OBS32_METRICS_MAX_BOUNDS + 2];
+    uint64_t total[OBS32_METRICS_MAX_BOUNDS + 2];
+};
+
+/**
+ * Read the value of a counter or gauge, that is maintained elsewhere.
+ *
+ * This is called while the metrics are rendered, so it must not block.
+ *
+ * @return int64_t The current value.
+ */
+typedef int64_t (*obs32_metric_read_t)(void);
+
+/**
+ * The description of a metric.
+ *
+ * Metrics of the same ``name`` (with different ``labels``) must be adjacent
+ * in their group; ``help`` and ``type`` are taken from the first of them.
+ * Counters provide ``counter`` or ``read``, gauges ``gauge`` or ``read`` and
+ * histograms ``histogram``.
+ */
+struct obs32_metric {
+    const char* name;
+    const char* help;
+    const char* labels;  // e.g. ``mode="inline"``, ``NULL`` without labels
+    enum obs32_metric_type type;
+    struct obs32_metric_counter* counter;
+    struct obs32_metric_gauge* gauge;
+    struct obs32_metric_histogram* histogram;
+    obs32_metric_read_t read;
+};
+
+/**
+ * The metrics of a component.
+ */
+struct obs32_metrics_group {
+    const struct obs32_metric* metrics;
+    size_t count;  // the number of ``metrics``
+    struct obs32_metrics_group* next;  // set by the registry
+};
+
+/**
+ * Hand a full chunk of rendered metrics to its destination.
+ *
+ * @param ctx  The context of the rendering.
+ * @param data The chunk.
+ * @param len  The length of ``data``.
+ * @return bool ``true`` if the chunk was taken.
+ */
+typedef bool (*obs32_metrics_emit_t)(void* ctx, const char* data, size_t len);
+
+
+/**
+ * Add to a counter.
+ *
+ * This may be called from any task and from interrupts.
+ *
+ * @param counter The counter.
+ * @param n       The increment.
+ */
+static inline void obs32_metrics_add(struct obs32_metric_counter* counter,
+                                     uint32_t n) {
+    __atomic_fetch_add(
+        &counter->cores[OBS32_METRICS_CORE_ID() % OBS32_METRICS_CORES],
+        n,
+        __ATOMIC_RELAXED);
+}
+
+/**
+ * Increment a counter.
+ *
+ * @param counter The counter.
+ */
+static inline void obs32_metrics_inc(struct obs32_metric_counter* counter) {
+    obs32_metrics_add(counter, 1);
+}
+
+/**
+ * Set a gauge.
+ *
+ * @param gauge The gauge.
+ * @param value The value.
+ */
+static inline void obs32_metrics_set(struct obs32_metric_gauge* gauge,
+                                     int32_t value) {
+    __atomic_store_n(&gauge->value, value, __ATOMIC_RELAXED);
+}
+
+/**
+ * Observe a value with a histogram.
+ *
+ * @param histogram The histogram.
+ * @param value     The value, e.g. a duration in microseconds.
+ */
+static inline void obs32_metrics_observe(
+    struct obs32_metric_histogram* histogram,
+    uint32_t value) {
+    size_t count = (histogram->count < OBS32_METRICS_MAX_BOUNDS)
+                       ? histogram->count
+                       : OBS32_METRICS_MAX_BOUNDS;
+    uint32_t* slots =
+        histogram->cores[OBS32_METRICS_CORE_ID() % OBS32_METRICS_CORES];
+
+    size_t bucket = 0;
+    while ((bucket < count) && (value > histogram->bounds[bucket]))
+        bucket++;
+    __atomic_fetch_add(&slots[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&slots[OBS32_METRICS_MAX_BOUNDS + 1],
+                       value,
+                       __ATOMIC_RELAXED);
+}
+
+/**
+ * Register the metrics of a component.
+ *
+ * This may be called from any task. A group, that is registered already, is
+ * not registered again.
+ *
+ * @param group The group. It must stay valid and is never removed.
+ * @return bool ``true`` if the group was registered, ``false`` if it was
+ *              registered already.
+ */
+bool obs32_metrics_register(struct obs32_metrics_group* group);
+
+/**
+ * Render all registered metrics in the Prometheus text format.
+ *
+ * The metrics are written into ``buf``, which is handed to ``emit`` whenever
+ * it is full and at the end, so the output is never built completely in
+ * memory. Numbers are formatted without ``printf()``.
+ *
+ * The counters and histograms are folded (see obs32_metrics.h ), so this must
+ * not be called concurrently.
+ *
+ * @param buf  The buffer of the chunks.
+ * @param size The size of ``buf``.
+ * @param emit The destination of the chunks.
+ * @param ctx  The context of ``emit``.
+ * @return bool ``true`` if all chunks were taken.
+ */
+bool obs32_metrics_render(char* buf,
+                          size_t size,
+                          obs32_metrics_emit_t emit,
+                          void* ctx);
+
+#endif  // SRC_LIB_OBS32_INCLUDE_OBS32_OBS32_METRICS_H_
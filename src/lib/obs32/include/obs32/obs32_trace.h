@@ -0,0 +1,296 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The trace buffers of the ``obs32`` component.
+ *
+ * Trace points record the timeline of the tasks' work (e.g. the wakeups of a
+ * task or the runs of a handler) as *spans*, which begin and end, or as
+ * *instants*. A record is 8 bytes (see ::obs32_trace_record ): a timestamp in
+ * microseconds, the trace point and an argument, e.g. a socket or a
+ * notification.
+ *
+ * Every core has its own ring of ::OBS32_TRACE_LEN records. A trace point
+ * claims its slot with a single atomic increment of the ring's head and
+ * overwrites the oldest record, so it does not lock and does not wait, even
+ * if a task of the same core is preempted while recording.
+ *
+ * Components declare the names of their trace points at compile time: the
+ * names are a ``static const`` table, that is registered as a *group* once at
+ * startup (see ::obs32_trace_register ), which provides the base of the
+ * points' ids. Trace points of a group, that is not registered, are ignored.
+ *
+ * The rings are read by their exporter with ::obs32_trace_get_groups and
+ * ::obs32_trace_lookup , e.g. ``min_httpd`` provides them as Chrome trace JSON
+ * at ``/trace``.
+ *
+ * Trace points compile to nothing, unless the tracing is enabled (see
+ * ::OBS32_TRACE_ENABLED ). The buffers do not depend on **ESP-IDF**, so they
+ * build on a Linux host (see ``tools/obs32/trace``).
+ *
+ * @file   obs32_trace.h
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+#ifndef SRC_LIB_OBS32_INCLUDE_OBS32_OBS32_TRACE_H_
+#define SRC_LIB_OBS32_INCLUDE_OBS32_OBS32_TRACE_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The metrics registry.
+ * - determines the core of the calling task (``OBS32_METRICS_CORE_ID()``)
+ */
+#include "obs32/obs32_metrics.h"
+
+#ifdef ESP_PLATFORM
+/* The project's configuration. */
+#include "sdkconfig.h"
+#endif
+
+#ifndef OBS32_TRACE_TIMESTAMP
+#ifdef ESP_PLATFORM
+/* This is ESP-IDF's high resolution timer library.
+ * - provides the timestamps (``esp_timer_get_time()``)
+ */
+#include "esp_timer.h"
+
+/**
+ * Determine the timestamp of a record, in microseconds.
+ *
+ * The timer is shared by the cores, so the timestamps of both rings are
+ * comparable (unlike the cores' cycle counters).
+ */
+#define OBS32_TRACE_TIMESTAMP() ((uint32_t)esp_timer_get_time())
+#else
+/* C's standard libraries. */
+#include <time.h>
+
+/**
+ * Determine the timestamp of a record on the host, in microseconds.
+ *
+ * @return uint32_t The monotonic time, wrapping around.
+ */
+static inline uint32_t obs32_trace_host_timestamp(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000);
+}
+
+#define OBS32_TRACE_TIMESTAMP() obs32_trace_host_timestamp()
+#endif
+#endif
+
+
+/**
+ * Record the trace points.
+ *
+ * Without tracing, the trace points compile to nothing and the rings do not
+ * occupy any RAM.
+ *
+ * This is part of the component's configuration and can be adjusted using
+ * **ESP-IDF**'s ``menuconfig`` or editing the ``sdkconfig`` file.
+ */
+#ifdef CONFIG_OBS32_TRACE_ENABLED
+#define OBS32_TRACE_ENABLED 1
+#else
+#define OBS32_TRACE_ENABLED 0
+#endif
+
+/**
+ * The number of records of every core's ring.
+ *
+ * This must be a power of two. The rings occupy ``8 * OBS32_TRACE_LEN`` bytes
+ * per core.
+ *
+ * This is part of the component's configuration, but can only be adjusted by
+ * modifying the actual header file ``obs32_trace.h``.
+ */
+#define OBS32_TRACE_LEN 256
+
+/**
+ * The number of rings.
+ */
+#define OBS32_TRACE_CORES OBS32_METRICS_CORES
+
+/**
+ * The number of bits of a record's ``id``, that select the trace point.
+ *
+ * The remaining bits are the ::obs32_trace_phase .
+ */
+#define OBS32_TRACE_POINT_BITS 14
+
+/**
+ * The kind of a record.
+ */
+enum obs32_trace_phase {
+    OBS32_TRACE_BEGIN = 1,
+    OBS32_TRACE_END,
+    OBS32_TRACE_INSTANT,
+};
+
+/**
+ * A record of a ring.
+ *
+ * A record, that was never written, has an ``id`` of ``0``.
+ */
+struct obs32_trace_record {
+    uint32_t timestamp;  // in microseconds, wrapping around
+    uint16_t id;         // the phase (upper bits) and the trace point
+    uint16_t arg;
+};
+
+/**
+ * The ring of a core.
+ */
+struct obs32_trace_ring {
+    uint32_t head;  // the number of claimed slots, wrapping around
+    struct obs32_trace_record records[OBS32_TRACE_LEN];
+};
+
+/**
+ * The trace points of a component.
+ *
+ * The group is defined statically and registered once with
+ * ::obs32_trace_register . A trace point is the index of its name.
+ */
+struct obs32_trace_group {
+    const char* category;      // e.g. the component's name
+    const char* const* names;  // the names of the trace points
+    uint16_t count;            // the number of ``names``
+    uint16_t base;  // the id of the first trace point, set by the registry
+    struct obs32_trace_group* next;  // managed by the registry
+};
+
+/**
+ * The rings of the cores.
+ *
+ * Only provided, if the tracing is enabled (see ::OBS32_TRACE_ENABLED ).
+ */
+extern struct obs32_trace_ring obs32_trace_rings[OBS32_TRACE_CORES];
+
+/**
+ * Ignore the trace points, while the rings are exported.
+ */
+extern bool obs32_trace_paused;
+
+
+/**
+ * Record a trace point.
+ *
+ * This may be called from any task and from interrupts. It does not lock and
+ * does not wait.
+ *
+ * @param group The group of the trace point.
+ * @param point The trace point, an index of the group's ``names``.
+ * @param phase The kind of the record.
+ * @param arg   The argument, e.g. a socket.
+ */
+static inline void obs32_trace(struct obs32_trace_group* group,
+                               uint16_t point,
+                               enum obs32_trace_phase phase,
+                               uint16_t arg) {
+#if OBS32_TRACE_ENABLED
+    uint16_t base = __atomic_load_n(&group->base, __ATOMIC_RELAXED);
+    if ((base == 0) || __atomic_load_n(&obs32_trace_paused, __ATOMIC_RELAXED))
+        return;
+
+    uint32_t timestamp = OBS32_TRACE_TIMESTAMP();
+    struct obs32_trace_ring* ring =
+        &obs32_trace_rings[OBS32_METRICS_CORE_ID() % OBS32_TRACE_CORES];
+    uint32_t slot = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED) &
+                    (OBS32_TRACE_LEN - 1);
+
+    ring->records[slot].timestamp = timestamp;
+    ring->records[slot].id =
+        (uint16_t)(((unsigned int)phase << OBS32_TRACE_POINT_BITS) |
+                   (unsigned int)(base + point));
+    ring->records[slot].arg = arg;
+#else
+    (void)group;
+    (void)point;
+    (void)phase;
+    (void)arg;
+#endif
+}
+
+/**
+ * Record the begin of a span.
+ *
+ * @param group The group of the trace point.
+ * @param point The trace point.
+ * @param arg   The argument.
+ */
+static inline void obs32_trace_begin(struct obs32_trace_group* group,
+                                     uint16_t point,
+                                     uint16_t arg) {
+    obs32_trace(group, point, OBS32_TRACE_BEGIN, arg);
+}
+
+/**
+ * Record the end of a span.
+ *
+ * @param group The group of the trace point.
+ * @param point The trace point.
+ * @param arg   The argument.
+ */
+static inline void obs32_trace_end(struct obs32_trace_group* group,
+                                   uint16_t point,
+                                   uint16_t arg) {
+    obs32_trace(group, point, OBS32_TRACE_END, arg);
+}
+
+/**
+ * Record an instant.
+ *
+ * @param group The group of the trace point.
+ * @param point The trace point.
+ * @param arg   The argument.
+ */
+static inline void obs32_trace_instant(struct obs32_trace_group* group,
+                                       uint16_t point,
+                                       uint16_t arg) {
+    obs32_trace(group, point, OBS32_TRACE_INSTANT, arg);
+}
+
+/**
+ * Register the trace points of a component.
+ *
+ * This may be called from any task. A group, that is registered already, is
+ * not registered again. The group must stay valid.
+ *
+ * @param group The group.
+ * @return bool ``true`` if the group was registered, ``false`` if it was
+ *              registered already or its ids are exhausted.
+ */
+bool obs32_trace_register(struct obs32_trace_group* group);
+
+/**
+ * Get the registered groups.
+ *
+ * The groups are linked by their ``next``, most recently registered first.
+ * Groups are only ever prepended, so the list may be walked, while further
+ * groups are registered.
+ *
+ * @return const struct obs32_trace_group* The most recently registered
+ *                                         group, ``NULL`` without groups.
+ */
+const struct obs32_trace_group* obs32_trace_get_groups(void);
+
+/**
+ * Find the group of a trace point.
+ *
+ * @param point The trace point's id, i.e. a record's ``id`` without the
+ *              phase.
+ * @return const struct obs32_trace_group* The group, ``NULL`` if the id is
+ *                                         not registered.
+ */
+const struct obs32_trace_group* obs32_trace_lookup(uint16_t point);
+
+#endif  // SRC_LIB_OBS32_INCLUDE_OBS32_OBS32_TRACE_H_
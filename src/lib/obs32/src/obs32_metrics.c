@@ -0,0 +1,366 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The metrics registry of the ``obs32`` component.
+ *
+ * The groups are a singly linked list, that is only ever prepended to, so
+ * registering is a single compare-and-swap and rendering walks the list
+ * without a lock. The rendering is written into a fixed buffer, that is
+ * handed to the destination whenever it is full.
+ *
+ * @file   obs32_metrics.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "obs32/obs32_metrics.h"
+
+/* C's standard libraries. */
+#include <string.h>
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * The state of a rendering.
+ */
+struct obs32_metrics_out {
+    char* buf;
+    size_t size;
+    size_t len;
+    obs32_metrics_emit_t emit;
+    void* ctx;
+    bool failed;
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * The registered groups, most recently registered first.
+ */
+static struct obs32_metrics_group* obs32_metrics_groups = NULL;
+
+/**
+ * The names of the ::obs32_metric_type , as given by ``# TYPE``.
+ */
+static const char* const obs32_metrics_types[] = {
+    "counter",
+    "gauge",
+    "histogram",
+};
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static void obs32_metrics_put(struct obs32_metrics_out* out,
+                              const char* data,
+                              size_t len);
+static void obs32_metrics_str(struct obs32_metrics_out* out, const char* str);
+static void obs32_metrics_u64(struct obs32_metrics_out* out, uint64_t value);
+static void obs32_metrics_i64(struct obs32_metrics_out* out, int64_t value);
+static void obs32_metrics_sample(struct obs32_metrics_out* out,
+                                 const struct obs32_metric* metric,
+                                 const char* suffix,
+                                 const char* le,
+                                 uint64_t le_value);
+static uint64_t obs32_metrics_fold(const uint32_t* slots,
+                                   size_t stride,
+                                   uint32_t* seen,
+                                   uint64_t* total);
+static void obs32_metrics_render_metric(struct obs32_metrics_out* out,
+                                        const struct obs32_metric* metric);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Append data to the rendering, handing full chunks to the destination.
+ *
+ * @param out  The rendering.
+ * @param data The data.
+ * @param len  The length of ``data``.
+ */
+static void obs32_metrics_put(struct obs32_metrics_out* out,
+                              const char* data,
+                              size_t len) {
+    while ((len > 0) && !out->failed) {
+        size_t n = out->size - out->len;
+        if (n > len)
+            n = len;
+        memcpy(out->buf + out->len, data, n);
+        out->len += n;
+        data += n;
+        len -= n;
+
+        if (out->len == out->size) {
+            if (!out->emit(out->ctx, out->buf, out->len))
+                out->failed = true;
+            out->len = 0;
+        }
+    }
+}
+
+/**
+ * Append a string to the rendering.
+ *
+ * @param out The rendering.
+ * @param str The string.
+ */
+static void obs32_metrics_str(struct obs32_metrics_out* out, const char* str) {
+    obs32_metrics_put(out, str, strlen(str));
+}
+
+/**
+ * Append an unsigned number to the rendering.
+ *
+ * @param out   The rendering.
+ * @param value The number.
+ */
+static void obs32_metrics_u64(struct obs32_metrics_out* out, uint64_t value) {
+    char digits[20];
+    size_t pos = sizeof(digits);
+
+    do {
+        digits[--pos] = (char)('0' + (value % 10));
+        value /= 10;
+    } while (value > 0);
+    obs32_metrics_put(out, digits + pos, sizeof(digits) - pos);
+}
+
+/**
+ * Append a signed number to the rendering.
+ *
+ * @param out   The rendering.
+ * @param value The number.
+ */
+static void obs32_metrics_i64(struct obs32_metrics_out* out, int64_t value) {
+    if (value < 0) {
+        obs32_metrics_put(out, "-", 1);
+        obs32_metrics_u64(out, (uint64_t)0 - (uint64_t)value);
+        return;
+    }
+    obs32_metrics_u64(out, (uint64_t)value);
+}
+
+/**
+ * Append the name and the labels of a sample to the rendering.
+ *
+ * The value is appended by the caller.
+ *
+ * @param out      The rendering.
+ * @param metric   The metric.
+ * @param suffix   The suffix of the name, e.g. ``_bucket``, or ``NULL``.
+ * @param le       The label ``le`` of a bucket, ``NULL`` to use
+ *                 ``le_value``, ``""`` without ``le``.
+ * @param le_value The upper bound of a bucket.
+ */
+static void obs32_metrics_sample(struct obs32_metrics_out* out,
+                                 const struct obs32_metric* metric,
+                                 const char* suffix,
+                                 const char* le,
+                                 uint64_t le_value) {
+    bool labels = (metric->labels != NULL) && (metric->labels[0] != '\0');
+    bool bucket = (le == NULL) || (le[0] != '\0');
+
+    obs32_metrics_str(out, metric->name);
+    if (suffix != NULL)
+        obs32_metrics_str(out, suffix);
+
+    if (labels || bucket) {
+        obs32_metrics_put(out, "{", 1);
+        if (labels)
+            obs32_metrics_str(out, metric->labels);
+        if (labels && bucket)
+            obs32_metrics_put(out, ",", 1);
+        if (bucket) {
+            obs32_metrics_str(out, "le=\"");
+            if (le == NULL)
+                obs32_metrics_u64(out, le_value);
+            else
+                obs32_metrics_str(out, le);
+            obs32_metrics_put(out, "\"", 1);
+        }
+        obs32_metrics_put(out, "}", 1);
+    }
+    obs32_metrics_put(out, " ", 1);
+}
+
+/**
+ * Fold the per-core slots of a value into its total.
+ *
+ * The slots are summed modulo 2^32, so the difference to the previous sum is
+ * correct, even if a slot wrapped around meanwhile.
+ *
+ * @param slots  The slot of the first core.
+ * @param stride The distance between the slots of two cores.
+ * @param seen   The sum of the slots at the previous rendering.
+ * @param total  The total.
+ * @return uint64_t The updated total.
+ */
+static uint64_t obs32_metrics_fold(const uint32_t* slots,
+                                   size_t stride,
+                                   uint32_t* seen,
+                                   uint64_t* total) {
+    uint32_t sum = 0;
+
+    for (size_t core = 0; core < OBS32_METRICS_CORES; core++)
+        sum += __atomic_load_n(&slots[core * stride], __ATOMIC_RELAXED);
+    *total += (uint32_t)(sum - *seen);
+    *seen = sum;
+    return *total;
+}
+
+/**
+ * Append the samples of a metric to the rendering.
+ *
+ * @param out    The rendering.
+ * @param metric The metric.
+ */
+static void obs32_metrics_render_metric(struct obs32_metrics_out* out,
+                                        const struct obs32_metric* metric) {
+    struct obs32_metric_counter* counter = metric->counter;
+    struct obs32_metric_histogram* histogram = metric->histogram;
+
+    switch (metric->type) {
+    case OBS32_METRIC_COUNTER:
+        obs32_metrics_sample(out, metric, NULL, "", 0);
+        if (metric->read != NULL)
+            obs32_metrics_i64(out, metric->read());
+        else if (counter != NULL)
+            obs32_metrics_u64(out,
+                              obs32_metrics_fold(counter->cores,
+                                                 1,
+                                                 &counter->seen,
+                                                 &counter->total));
+        else
+            obs32_metrics_put(out, "0", 1);
+        break;
+
+    case OBS32_METRIC_GAUGE:
+        obs32_metrics_sample(out, metric, NULL, "", 0);
+        if (metric->read != NULL)
+            obs32_metrics_i64(out, metric->read());
+        else if (metric->gauge != NULL)
+            obs32_metrics_i64(
+                out,
+                __atomic_load_n(&metric->gauge->value, __ATOMIC_RELAXED));
+        else
+            obs32_metrics_put(out, "0", 1);
+        break;
+
+    case OBS32_METRIC_HISTOGRAM: {
+        if (histogram == NULL)
+            return;
+
+        size_t count = (histogram->count < OBS32_METRICS_MAX_BOUNDS)
+                           ? histogram->count
+                           : OBS32_METRICS_MAX_BOUNDS;
+        const size_t stride = OBS32_METRICS_MAX_BOUNDS + 2;
+        uint64_t cumulative = 0;
+
+        for (size_t bucket = 0; bucket <= count; bucket++) {
+            cumulative += obs32_metrics_fold(&histogram->cores[0][bucket],
+                                             stride,
+                                             &histogram->seen[bucket],
+                                             &histogram->total[bucket]);
+            obs32_metrics_sample(out,
+                                 metric,
+                                 "_bucket",
+                                 (bucket < count) ? NULL : "+Inf",
+                                 (bucket < count)
+                                     ? histogram->bounds[bucket]
+                                     : 0);
+            obs32_metrics_u64(out, cumulative);
+            obs32_metrics_put(out, "\n", 1);
+        }
+
+        // The slots between the buckets and the sum are never used
+        size_t sum = OBS32_METRICS_MAX_BOUNDS + 1;
+        obs32_metrics_sample(out, metric, "_sum", "", 0);
+        obs32_metrics_u64(out,
+                          obs32_metrics_fold(&histogram->cores[0][sum],
+                                             stride,
+                                             &histogram->seen[sum],
+                                             &histogram->total[sum]));
+        obs32_metrics_put(out, "\n", 1);
+        obs32_metrics_sample(out, metric, "_count", "", 0);
+        obs32_metrics_u64(out, cumulative);
+        break;
+    }
+
+    default:
+        return;
+    }
+    obs32_metrics_put(out, "\n", 1);
+}
+
+// Documentation in header file!
+bool obs32_metrics_register(struct obs32_metrics_group* group) {
+    struct obs32_metrics_group* head =
+        __atomic_load_n(&obs32_metrics_groups, __ATOMIC_ACQUIRE);
+
+    do {
+        for (struct obs32_metrics_group* it = head; it != NULL;
+             it = it->next) {
+            if (it == group)
+                return false;
+        }
+        group->next = head;
+    } while (!__atomic_compare_exchange_n(&obs32_metrics_groups,
+                                          &head,
+                                          group,
+                                          false,
+                                          __ATOMIC_RELEASE,
+                                          __ATOMIC_ACQUIRE));
+    return true;
+}
+
+// Documentation in header file!
+bool obs32_metrics_render(char* buf,
+                          size_t size,
+                          obs32_metrics_emit_t emit,
+                          void* ctx) {
+    struct obs32_metrics_out out = {
+        .buf = buf,
+        .size = size,
+        .len = 0,
+        .emit = emit,
+        .ctx = ctx,
+        .failed = (size == 0),
+    };
+
+    for (struct obs32_metrics_group* group =
+             __atomic_load_n(&obs32_metrics_groups, __ATOMIC_ACQUIRE);
+         group != NULL;
+         group = group->next) {
+        for (size_t i = 0; i < group->count; i++) {
+            const struct obs32_metric* metric = &group->metrics[i];
+
+            if ((i == 0) ||
+                (strcmp(metric->name, group->metrics[i - 1].name) != 0)) {
+                obs32_metrics_str(&out, "# HELP ");
+                obs32_metrics_str(&out, metric->name);
+                obs32_metrics_put(&out, " ", 1);
+                obs32_metrics_str(&out, metric->help);
+                obs32_metrics_str(&out, "\n# TYPE ");
+                obs32_metrics_str(&out, metric->name);
+                obs32_metrics_put(&out, " ", 1);
+                obs32_metrics_str(&out, obs32_metrics_types[metric->type]);
+                obs32_metrics_put(&out, "\n", 1);
+            }
+            obs32_metrics_render_metric(&out, metric);
+        }
+    }
+
+    if (!out.failed && (out.len > 0) && !emit(ctx, buf, out.len))
+        out.failed = true;
+    return !out.failed;
+}
@@ -0,0 +1,88 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The trace buffers of the ``obs32`` component.
+ *
+ * The groups are a singly linked list, that is only ever prepended to, so
+ * registering is a single compare-and-swap. The ids of a group follow the
+ * ids of the groups, that were registered before.
+ *
+ * @file   obs32_trace.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* This file's header */
+#include "obs32/obs32_trace.h"
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * The registered groups, most recently registered first.
+ */
+static struct obs32_trace_group* obs32_trace_groups = NULL;
+
+// Documentation in header file!
+bool obs32_trace_paused = false;
+
+#if OBS32_TRACE_ENABLED
+// Documentation in header file!
+struct obs32_trace_ring obs32_trace_rings[OBS32_TRACE_CORES];
+#endif
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+// Documentation in header file!
+bool obs32_trace_register(struct obs32_trace_group* group) {
+    struct obs32_trace_group* head =
+        __atomic_load_n(&obs32_trace_groups, __ATOMIC_ACQUIRE);
+    uint32_t base;
+
+    do {
+        // The id 0 marks records, that were never written
+        base = 1;
+        for (struct obs32_trace_group* it = head; it != NULL; it = it->next) {
+            if (it == group)
+                return false;
+            base += it->count;
+        }
+
+        if (base + group->count > (1U << OBS32_TRACE_POINT_BITS))
+            return false;
+        group->next = head;
+    } while (!__atomic_compare_exchange_n(&obs32_trace_groups,
+                                          &head,
+                                          group,
+                                          false,
+                                          __ATOMIC_RELEASE,
+                                          __ATOMIC_ACQUIRE));
+
+    // Trace points of the group are recorded from now on
+    __atomic_store_n(&group->base, (uint16_t)base, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Documentation in header file!
+const struct obs32_trace_group* obs32_trace_get_groups(void) {
+    return __atomic_load_n(&obs32_trace_groups, __ATOMIC_ACQUIRE);
+}
+
+// Documentation in header file!
+const struct obs32_trace_group* obs32_trace_lookup(uint16_t point) {
+    for (const struct obs32_trace_group* group = obs32_trace_get_groups();
+         group != NULL;
+         group = group->next) {
+        uint16_t base = __atomic_load_n(&group->base, __ATOMIC_ACQUIRE);
+        if ((base != 0) && (point >= base) && (point < base + group->count))
+            return group;
+    }
+    return NULL;
+}
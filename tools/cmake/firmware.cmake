@@ -0,0 +1,66 @@
+# SPDX-FileCopyrightText: 2022 Mischback
+# SPDX-License-Identifier: MIT
+# SPDX-FileType: SOURCE
+
+set(FIRMWARE_PACKER_SCRIPT ${PROJECT_DIR}/tools/packer/firmware.py)
+
+# Pack the application's firmware into payloads for ``min_httpd``'s firmware
+# upload.
+#
+# Basically this is a wrapper around CMake's ``add_custom_command``, calling
+# the project's custom ``tools/packer/firmware.py`` script, after the
+# application's binary (``${PROJECT_NAME}.bin``) was generated. The results
+# are located in the build directory:
+#
+#   - ``${PROJECT_NAME}.ota``: the compressed firmware;
+#   - ``${PROJECT_NAME}.delta.ota``: the delta against the firmware
+#     ``OTA_BASE_IMAGE``, if that is provided as CMake variable (e.g.
+#     ``idf.py -DOTA_BASE_IMAGE=old/KrachkisteESP32.bin build``) or
+#     environment variable. This must be the firmware, that is running on the
+#     device, so keep a copy of the binary of every release.
+#
+# The payloads are uploaded like the binary, with the digest of the binary.
+#
+# The script is run with **ESP-IDF**'s Python, as it only requires Python's
+# standard library.
+function(pack_firmware)
+  if(NOT TARGET gen_project_binary)
+    return()
+  endif()
+
+  idf_build_get_property(FIRMWARE_BUILD_DIR BUILD_DIR)
+  idf_build_get_property(FIRMWARE_PYTHON PYTHON)
+  set(FIRMWARE_BINARY ${FIRMWARE_BUILD_DIR}/${PROJECT_NAME}.bin)
+  set(FIRMWARE_OUTPUT ${FIRMWARE_BUILD_DIR}/${PROJECT_NAME})
+
+  if(NOT OTA_BASE_IMAGE AND DEFINED ENV{OTA_BASE_IMAGE})
+    set(OTA_BASE_IMAGE $ENV{OTA_BASE_IMAGE})
+  endif()
+
+  # The binary is generated by ``gen_project_binary``, see ESP-IDF's
+  # ``esptool_py`` component
+  set(FIRMWARE_COMMANDS
+    COMMAND ${FIRMWARE_PYTHON} ${FIRMWARE_PACKER_SCRIPT} ${FIRMWARE_BINARY} ${FIRMWARE_OUTPUT}.ota
+  )
+  set(FIRMWARE_OUTPUTS ${FIRMWARE_OUTPUT}.ota)
+  set(FIRMWARE_DEPENDS ${FIRMWARE_PACKER_SCRIPT} ${FIRMWARE_BUILD_DIR}/.bin_timestamp)
+  if(OTA_BASE_IMAGE)
+    get_filename_component(OTA_BASE_IMAGE ${OTA_BASE_IMAGE} ABSOLUTE)
+    if(NOT EXISTS ${OTA_BASE_IMAGE})
+      message(FATAL_ERROR "No base image '${OTA_BASE_IMAGE}' for the delta!")
+    endif()
+    list(APPEND FIRMWARE_COMMANDS
+      COMMAND ${FIRMWARE_PYTHON} ${FIRMWARE_PACKER_SCRIPT} --base ${OTA_BASE_IMAGE} ${FIRMWARE_BINARY} ${FIRMWARE_OUTPUT}.delta.ota
+    )
+    list(APPEND FIRMWARE_OUTPUTS ${FIRMWARE_OUTPUT}.delta.ota)
+    list(APPEND FIRMWARE_DEPENDS ${OTA_BASE_IMAGE})
+  endif()
+
+  add_custom_command(
+    OUTPUT ${FIRMWARE_OUTPUTS}
+    ${FIRMWARE_COMMANDS}
+    DEPENDS ${FIRMWARE_DEPENDS}
+  )
+  add_custom_target(firmware_payloads ALL DEPENDS ${FIRMWARE_OUTPUTS})
+  add_dependencies(firmware_payloads gen_project_binary)
+endfunction()
@@ -37,6 +37,32 @@ function(minimize_html MIN_SOURCE MIN_DESTINATION)
   endif()
 endfunction()
 
+# Compile a HTML template into a table of segments.
+#
+# Basically this is a wrapper around CMake's ``add_custom_command``, calling
+# ``tools/minimizer/html.py`` with ``--template``. The template is minimized
+# and split at its placeholders (``{{ name }}``) into static segments.
+#
+# The result is ``${TPL_NAME}.c``, which provides the table
+# (``const struct min_httpd_template ${TPL_NAME}``, see
+# ``min_httpd_template.h``) and must be added to the component's ``SRCS``. It
+# is located in the component's build directory. The component must depend
+# on ``min_httpd``, which renders the template with
+# ``min_httpd_template_send()``.
+#
+# @param TPL_SOURCE The filename of the template (HTML) file
+# @param TPL_NAME   The name of the table
+function(compile_html_template TPL_SOURCE TPL_NAME)
+  # See ``minimize_html()`` for this guard.
+  if(NOT CMAKE_BUILD_EARLY_EXPANSION)
+    add_custom_command(
+      OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/${TPL_NAME}.c
+      COMMAND ${MINIMIZER_PYTHON} ${MINIMIZER_SCRIPT_HTML} --template ${TPL_NAME} ${CMAKE_CURRENT_SOURCE_DIR}/${TPL_SOURCE} ${CMAKE_CURRENT_BINARY_DIR}/${TPL_NAME}.c
+      DEPENDS ${MINIMIZER_STAMP} ${CMAKE_CURRENT_SOURCE_DIR}/${TPL_SOURCE}
+    )
+  endif()
+endfunction()
+
 # The following block is used to create and populate the required Python
 # virtual environment.
 #
@@ -0,0 +1,103 @@
+# SPDX-FileCopyrightText: 2022 Mischback
+# SPDX-License-Identifier: MIT
+# SPDX-FileType: SOURCE
+
+set(PACKER_SCRIPT ${PROJECT_DIR}/tools/packer/assets.py)
+
+# HTML sources are minimized before they are packed
+include(${PROJECT_DIR}/tools/cmake/minimizer.cmake)
+
+# Pack a directory of web assets into a blob and a table with a perfect hash.
+#
+# Basically this is a wrapper around CMake's ``add_custom_command``, calling
+# the project's custom ``tools/packer/assets.py`` script. The assets are
+# staged in the component's build directory first: HTML sources
+# (``*.src.html``) are minimized (see ``minimize_html()``), all other files
+# are copied.
+#
+# The results are ``${PACK_NAME}.c``, which provides the table
+# (``const struct min_httpd_asset_table ${PACK_NAME}``) and must be added to
+# the component's ``SRCS``, and ``${PACK_NAME}.bin``, which must be added to
+# the component's ``EMBED_FILES``. Both are located in the component's build
+# directory.
+#
+# If a partition is provided, ``${PACK_NAME}.img`` is generated, too. This
+# image is flashed to the partition with ``idf.py flash`` (or just the image
+# with ``idf.py <partition>-flash``), so ``${PACK_NAME}.c`` and
+# ``${PACK_NAME}.bin`` may be omitted from the component. The build fails, if
+# the image exceeds the partition. The partition must be provided by the
+# project's partition table.
+#
+# The script is run with **ESP-IDF**'s Python, as it only requires Python's
+# standard library.
+#
+# @param PACK_SOURCE_DIR The directory of the assets
+# @param PACK_NAME       The name of the table
+# @param ARGV2           The label of a data partition (optional)
+function(pack_assets PACK_SOURCE_DIR PACK_NAME)
+  # See ``minimize_html()`` for this guard.
+  if(NOT CMAKE_BUILD_EARLY_EXPANSION)
+    set(PACK_STAGE_DIR ${CMAKE_CURRENT_BINARY_DIR}/${PACK_NAME})
+    set(PACK_OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/${PACK_NAME})
+
+    # Files, that were removed from the assets, must not be packed
+    file(REMOVE_RECURSE ${PACK_STAGE_DIR})
+
+    file(
+      GLOB_RECURSE PACK_FILES
+      RELATIVE ${CMAKE_CURRENT_SOURCE_DIR}/${PACK_SOURCE_DIR}
+      CONFIGURE_DEPENDS
+      ${CMAKE_CURRENT_SOURCE_DIR}/${PACK_SOURCE_DIR}/*
+    )
+
+    set(PACK_STAGED_FILES "")
+    foreach(PACK_FILE ${PACK_FILES})
+      get_filename_component(PACK_FILE_DIR ${PACK_FILE} DIRECTORY)
+      file(MAKE_DIRECTORY ${PACK_STAGE_DIR}/${PACK_FILE_DIR})
+
+      if(PACK_FILE MATCHES "\\.src\\.html$")
+        string(REGEX REPLACE "\\.src\\.html$" ".html" PACK_STAGED ${PACK_FILE})
+        minimize_html(${PACK_SOURCE_DIR}/${PACK_FILE} ${PACK_NAME}/${PACK_STAGED})
+      else()
+        set(PACK_STAGED ${PACK_FILE})
+        add_custom_command(
+          OUTPUT ${PACK_STAGE_DIR}/${PACK_STAGED}
+          COMMAND ${CMAKE_COMMAND} -E copy ${CMAKE_CURRENT_SOURCE_DIR}/${PACK_SOURCE_DIR}/${PACK_FILE} ${PACK_STAGE_DIR}/${PACK_STAGED}
+          DEPENDS ${CMAKE_CURRENT_SOURCE_DIR}/${PACK_SOURCE_DIR}/${PACK_FILE}
+        )
+      endif()
+
+      list(APPEND PACK_STAGED_FILES ${PACK_STAGE_DIR}/${PACK_STAGED})
+    endforeach()
+
+    set(PACK_OUTPUTS ${PACK_OUTPUT}.c ${PACK_OUTPUT}.bin)
+    set(PACK_ARGS "")
+    if(ARGC GREATER 2)
+      set(PACK_PARTITION ${ARGV2})
+      partition_table_get_partition_info(PACK_SIZE "--partition-name ${PACK_PARTITION}" "size")
+      if("${PACK_SIZE}" STREQUAL "")
+        message(FATAL_ERROR "No partition '${PACK_PARTITION}' for the assets '${PACK_NAME}'!")
+      endif()
+      list(APPEND PACK_OUTPUTS ${PACK_OUTPUT}.img)
+      set(PACK_ARGS --image ${PACK_SIZE})
+    endif()
+
+    idf_build_get_property(PACK_PYTHON PYTHON)
+    add_custom_command(
+      OUTPUT ${PACK_OUTPUTS}
+      COMMAND ${PACK_PYTHON} ${PACKER_SCRIPT} ${PACK_ARGS} ${PACK_NAME} ${PACK_STAGE_DIR} ${PACK_OUTPUT}
+      DEPENDS ${PACKER_SCRIPT} ${PACK_STAGED_FILES}
+    )
+
+    if(DEFINED PACK_PARTITION)
+      # Like ``spiffs_create_partition_image(... FLASH_IN_PROJECT)``
+      add_custom_target(${PACK_NAME}_img ALL DEPENDS ${PACK_OUTPUT}.img)
+      esptool_py_flash_to_partition(flash ${PACK_PARTITION} ${PACK_OUTPUT}.img)
+      add_dependencies(flash ${PACK_NAME}_img)
+
+      # Like ``app-flash``, to update the assets only
+      esptool_py_custom_target(${PACK_PARTITION}-flash ${PACK_PARTITION} ${PACK_NAME}_img)
+      esptool_py_flash_to_partition(${PACK_PARTITION}-flash ${PACK_PARTITION} ${PACK_OUTPUT}.img)
+    endif()
+  endif()
+endfunction()
@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * The checks of the host tools.
+ *
+ * Every check prints one line (``ok`` or ``FAIL``, followed by its name), the
+ * summary prints ``OK`` or ``FAIL`` and provides the exit code, which is
+ * evaluated by ``ctest`` (see ``tools/CMakeLists.txt``).
+ *
+ * @file   host_check.h
+ */
+
+#ifndef TOOLS_COMMON_HOST_CHECK_H_
+#define TOOLS_COMMON_HOST_CHECK_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * Verify a condition of a host tool.
+ *
+ * @param failures The number of failures, incremented if ``ok`` is not set.
+ * @param ok       The condition.
+ * @param name     The name of the check.
+ */
+static inline void host_check(int* failures, bool ok, const char* name) {
+    printf("%-4s %s\n", ok ? "ok" : "FAIL", name);
+    if (!ok)
+        (*failures)++;
+}
+
+/**
+ * Print the summary of the checks.
+ *
+ * @param failures The number of failures.
+ * @return int The exit code, ``0`` if all checks passed.
+ */
+static inline int host_check_summary(int failures) {
+    printf("%s\n", (failures == 0) ? "OK" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
+
+#endif  // TOOLS_COMMON_HOST_CHECK_H_
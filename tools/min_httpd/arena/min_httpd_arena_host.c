@@ -0,0 +1,438 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Verify and benchmark the per-request arena of the ``min_httpd`` component
+ * on a Linux host.
+ *
+ * The arena is compiled unmodified. The heap functions (``malloc()``,
+ * ``calloc()``, ``realloc()`` and ``free()``) are wrapped by the linker (see
+ * ``CMakeLists.txt``), so every call of the arena and of the simulated
+ * handlers is counted:
+ *
+ *   - ``min_httpd_arena_host bench [REQUESTS]`` processes ``REQUESTS``
+ *     requests like the WiFi configuration form of ``mnet32``: the URI and
+ *     the body are copied, the values of the form are decoded, a log message
+ *     and the response are formatted. This runs with the heap (like the
+ *     former handlers, with ``calloc()`` and ``asprintf()``) and with an
+ *     arena, which is reset after every request. The benchmark verifies, that
+ *     the requests with the arena do not call the heap at all, and reports
+ *     the time per request.
+ *
+ * @file   min_httpd_arena_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+/* The per-request arena. */
+#include "min_httpd/min_httpd_arena.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The default number of requests.
+ */
+#define MIN_HTTPD_ARENA_HOST_REQUESTS 200000
+
+/**
+ * The budget of a request, just like ``CONFIG_MIN_HTTPD_ARENA_LEN``.
+ */
+#define MIN_HTTPD_ARENA_HOST_LEN 1536
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * The calls of the heap functions.
+ */
+struct min_httpd_arena_host_heap {
+    uint32_t malloc;
+    uint32_t calloc;
+    uint32_t realloc;
+    uint32_t free;
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * The calls of the heap functions, counted while ::min_httpd_arena_host_count
+ * is set.
+ */
+static struct min_httpd_arena_host_heap min_httpd_arena_host_calls;
+
+/**
+ * Count the calls of the heap functions.
+ *
+ * The output of ``printf()`` allocates a buffer, so the calls are only
+ * counted while the requests are processed.
+ */
+static bool min_httpd_arena_host_count = false;
+
+/**
+ * The URI of the simulated requests.
+ */
+static const char min_httpd_arena_host_uri[] = "/config/wifi";
+
+/**
+ * The body of the simulated requests.
+ */
+static const char min_httpd_arena_host_body[] =
+    "ssid=Krachkiste+Home%21&psk=s%26cret%20p%C3%A4ss";
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+void* __wrap_malloc(size_t size);
+void* __wrap_calloc(size_t count, size_t size);
+void* __wrap_realloc(void* ptr, size_t size);
+void __wrap_free(void* ptr);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+void* __wrap_malloc(size_t size) {
+    if (min_httpd_arena_host_count)
+        min_httpd_arena_host_calls.malloc++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    if (min_httpd_arena_host_count)
+        min_httpd_arena_host_calls.calloc++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    if (min_httpd_arena_host_count)
+        min_httpd_arena_host_calls.realloc++;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr) {
+    if (min_httpd_arena_host_count)
+        min_httpd_arena_host_calls.free++;
+    __real_free(ptr);
+}
+
+/**
+ * Get the current time.
+ *
+ * @return double The time in seconds.
+ */
+static double min_httpd_arena_host_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Get the total number of calls of the heap functions.
+ *
+ * @return uint32_t The number of calls.
+ */
+static uint32_t min_httpd_arena_host_heap_calls(void) {
+    return min_httpd_arena_host_calls.malloc +
+           min_httpd_arena_host_calls.calloc +
+           min_httpd_arena_host_calls.realloc + min_httpd_arena_host_calls.free;
+}
+
+/**
+ * Get a decoded value of a form like the former handler of ``mnet32``.
+ *
+ * @param body The body.
+ * @param key  The key.
+ * @return char* The value, allocated from the heap.
+ */
+static char* min_httpd_arena_host_heap_value(const char* body,
+                                             const char* key) {
+    const char* begin = strstr(body, key);
+    if (begin == NULL)
+        return NULL;
+    begin += strlen(key) + 1;
+    size_t len = strcspn(begin, "&");
+
+    char* value = calloc(len + 1, sizeof(char));
+    if (value == NULL)
+        return NULL;
+    size_t out = 0;
+    for (size_t in = 0; in < len; in++) {
+        unsigned int c;
+        if ((begin[in] == '%') && (in + 2 < len) &&
+            (sscanf(begin + in + 1, "%2x", &c) == 1)) {
+            value[out++] = (char)c;
+            in += 2;
+        } else {
+            value[out++] = (begin[in] == '+') ? ' ' : begin[in];
+        }
+    }
+    return value;
+}
+
+/**
+ * Process a request with the heap, like the former handlers.
+ *
+ * @return size_t The length of the response, ``0`` on failure.
+ */
+static size_t min_httpd_arena_host_request_heap(void) {
+    size_t uri_len = strlen(min_httpd_arena_host_uri);
+    size_t body_len = strlen(min_httpd_arena_host_body);
+    char* job = calloc(1, uri_len + 1 + body_len + 1);
+    if (job == NULL)
+        return 0;
+    memcpy(job, min_httpd_arena_host_uri, uri_len);
+    memcpy(job + uri_len + 1, min_httpd_arena_host_body, body_len);
+
+    char* log_message;
+    if (asprintf(&log_message, "%s '%s' - %s", "POST", job, "OK") < 0)
+        log_message = NULL;
+
+    char* ssid = min_httpd_arena_host_heap_value(job + uri_len + 1, "ssid");
+    char* psk = min_httpd_arena_host_heap_value(job + uri_len + 1, "psk");
+    char* response = NULL;
+    if ((ssid != NULL) && (psk != NULL) &&
+        (asprintf(&response,
+                  "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n"
+                  "{\"ssid\":\"%s\",\"psk_len\":%u}",
+                  ssid,
+                  (unsigned int)strlen(psk)) < 0))
+        response = NULL;
+
+    size_t len = (response != NULL) ? strlen(response) : 0;
+    free(response);
+    free(psk);
+    free(ssid);
+    free(log_message);
+    free(job);
+    return len;
+}
+
+/**
+ * Process a request with an arena, like the handlers with
+ * ``min_httpd_request_arena()``.
+ *
+ * @param arena The arena, which is reset after the request.
+ * @return size_t The length of the response, ``0`` on failure.
+ */
+static size_t min_httpd_arena_host_request_arena(
+    struct min_httpd_arena* arena) {
+    char* uri = min_httpd_arena_strndup(arena,
+                                        min_httpd_arena_host_uri,
+                                        SIZE_MAX);
+    char* body = min_httpd_arena_strndup(arena,
+                                         min_httpd_arena_host_body,
+                                         SIZE_MAX);
+    size_t len = 0;
+    if ((uri != NULL) && (body != NULL) &&
+        (min_httpd_arena_printf(arena, "%s '%s' - %s", "POST", uri, "OK") !=
+         NULL)) {
+        char* ssid = min_httpd_arena_form_value(arena, body, "ssid");
+        char* psk = min_httpd_arena_form_value(arena, body, "psk");
+        char* response = NULL;
+        if ((ssid != NULL) && (psk != NULL))
+            response = min_httpd_arena_printf(
+                arena,
+                "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n"
+                "{\"ssid\":\"%s\",\"psk_len\":%u}",
+                ssid,
+                (unsigned int)strlen(psk));
+        len = (response != NULL) ? strlen(response) : 0;
+    }
+
+    min_httpd_arena_reset(arena);
+    return len;
+}
+
+/**
+ * Verify the alignment, the budget and the reset of an arena.
+ *
+ * @param failures The number of failures.
+ */
+static void min_httpd_arena_host_verify_budget(int* failures) {
+    static uint8_t storage[64 + 1];
+    struct min_httpd_arena arena;
+
+    // Start with an unaligned storage
+    min_httpd_arena_init(&arena, storage + 1, 64);
+
+    bool aligned = true;
+    char* str = min_httpd_arena_strndup(&arena, "abc", SIZE_MAX);
+    for (int i = 0; i < 3; i++) {
+        void* ptr = min_httpd_arena_alloc(&arena, 3);
+        aligned = aligned && (ptr != NULL) &&
+                  ((uintptr_t)ptr % MIN_HTTPD_ARENA_ALIGN == 0);
+    }
+    host_check(failures,
+               aligned && (str != NULL) && (strcmp(str, "abc") == 0),
+               "Allocations are aligned");
+
+    size_t used = arena.used;
+    bool exceeded = (min_httpd_arena_alloc(&arena, 64) == NULL) &&
+                    (min_httpd_arena_calloc(&arena, SIZE_MAX / 2, 4) == NULL) &&
+                    (min_httpd_arena_printf(&arena, "%064d", 1) == NULL) &&
+                    (min_httpd_arena_strndup(&arena, "x", 1) != NULL);
+    host_check(failures,
+               exceeded && (arena.failures == 3) && (arena.used == used + 2),
+               "Allocations beyond the budget fail");
+
+    size_t available = min_httpd_arena_available(&arena);
+    char* fit = min_httpd_arena_printf(&arena, "%0*d", (int)available - 1, 0);
+    host_check(failures,
+               (fit != NULL) && (arena.used == arena.size),
+               "The budget is used completely");
+
+    size_t peak = arena.peak;
+    min_httpd_arena_reset(&arena);
+    void* again = min_httpd_arena_alloc(&arena, 64 - 7);
+    host_check(failures,
+               (again != NULL) && (peak == arena.size),
+               "The reset releases all allocations");
+}
+
+/**
+ * Verify the decoding of form values.
+ *
+ * @param failures The number of failures.
+ */
+static void min_httpd_arena_host_verify_form(int* failures) {
+    static uint8_t storage[256];
+    struct min_httpd_arena arena;
+    min_httpd_arena_init(&arena, storage, sizeof(storage));
+
+    static const struct {
+        const char* body;
+        const char* key;
+        const char* value;  // ``NULL`` if the key is not found
+    } cases[] = {
+        {"ssid=My+Net%21&psk=s%26cret", "ssid", "My Net!"},
+        {"ssid=My+Net%21&psk=s%26cret", "psk", "s&cret"},
+        {"xpsk=wrong&psk=right", "psk", "right"},
+        {"ssid=a&psk=b", "sid", NULL},
+        {"ssid", "ssid", NULL},
+        {"psk=&ssid=x", "psk", ""},
+        {"psk=100%25%2", "psk", "100%%2"},
+        {"psk=%G1%4", "psk", "%G1%4"},
+        {"psk=%c3%A4", "psk", "\xc3\xa4"},
+    };
+
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        size_t used = arena.used;
+        char* value =
+            min_httpd_arena_form_value(&arena, cases[i].body, cases[i].key);
+        bool match = (cases[i].value == NULL)
+                         ? ((value == NULL) && (arena.used == used))
+                         : ((value != NULL) &&
+                            (strcmp(value, cases[i].value) == 0) &&
+                            (arena.used == used + strlen(value) + 1));
+        if (!match) {
+            printf("     '%s' [%s]: '%s'\n",
+                   cases[i].body,
+                   cases[i].key,
+                   (value != NULL) ? value : "(null)");
+            ok = false;
+        }
+    }
+    host_check(failures, ok, "Form values are decoded");
+}
+
+/**
+ * Run the benchmark.
+ *
+ * @param requests The number of requests.
+ * @return int ``0`` if all checks passed.
+ */
+static int min_httpd_arena_host_bench(uint32_t requests) {
+    static uint8_t storage[MIN_HTTPD_ARENA_HOST_LEN];
+    struct min_httpd_arena arena;
+    int failures = 0;
+
+    if (requests == 0) {
+        fprintf(stderr, "REQUESTS must be above 0!\n");
+        return 1;
+    }
+
+    min_httpd_arena_host_verify_budget(&failures);
+    min_httpd_arena_host_verify_form(&failures);
+
+    /* The former handlers */
+    size_t heap_len = 0;
+    memset(&min_httpd_arena_host_calls, 0, sizeof(min_httpd_arena_host_calls));
+    min_httpd_arena_host_count = true;
+    double start = min_httpd_arena_host_now();
+    for (uint32_t i = 0; i < requests; i++)
+        heap_len += min_httpd_arena_host_request_heap();
+    double heap_us = (min_httpd_arena_host_now() - start) * 1e6 / requests;
+    min_httpd_arena_host_count = false;
+    uint32_t heap_calls = min_httpd_arena_host_heap_calls();
+
+    printf("     heap:  %.3f us per request, %.1f heap calls per request\n",
+           heap_us,
+           (double)heap_calls / requests);
+
+    /* The arena */
+    size_t arena_len = 0;
+    min_httpd_arena_init(&arena, storage, sizeof(storage));
+    memset(&min_httpd_arena_host_calls, 0, sizeof(min_httpd_arena_host_calls));
+    min_httpd_arena_host_count = true;
+    start = min_httpd_arena_host_now();
+    for (uint32_t i = 0; i < requests; i++)
+        arena_len += min_httpd_arena_host_request_arena(&arena);
+    double arena_us = (min_httpd_arena_host_now() - start) * 1e6 / requests;
+    min_httpd_arena_host_count = false;
+    uint32_t arena_calls = min_httpd_arena_host_heap_calls();
+
+    printf("     arena: %.3f us per request, %.1f heap calls per request, "
+           "peak %u of %u bytes\n",
+           arena_us,
+           (double)arena_calls / requests,
+           (unsigned int)arena.peak,
+           (unsigned int)arena.size);
+
+    host_check(&failures,
+               (heap_len > 0) && (arena_len == heap_len),
+               "Responses are identical");
+    host_check(&failures, heap_calls > 0, "Calls of the heap are counted");
+    host_check(&failures,
+               (arena_calls == 0) && (arena.failures == 0),
+               "Requests do not call the heap");
+
+    return host_check_summary(failures);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s bench [REQUESTS]\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "bench") == 0) {
+        return min_httpd_arena_host_bench(
+            (argc > 2) ? (uint32_t)atoi(argv[2])
+                       : MIN_HTTPD_ARENA_HOST_REQUESTS);
+    }
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
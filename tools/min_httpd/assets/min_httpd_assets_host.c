@@ -0,0 +1,495 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Verify and benchmark the packed web assets of the ``min_httpd`` component
+ * on a Linux host.
+ *
+ * The engine and the tables, that are generated by ``tools/packer/assets.py``,
+ * are compiled unmodified:
+ *
+ *   - ``min_httpd_assets_host bench [LOOKUPS]`` verifies, that every asset of
+ *     the component's ``www`` directory and of the synthetic table is found
+ *     with its content, that other paths are not found, that
+ *     ``Accept-Encoding``, ``If-None-Match``, ``If-Modified-Since``,
+ *     ``Range`` and ``If-Range`` are evaluated. Then it
+ *     compares ``LOOKUPS`` lookups of the synthetic table's paths with the
+ *     perfect hash and with a linear search. The timings are not checked,
+ *     as they depend on the host.
+ *
+ * @file   min_httpd_assets_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+/* The engine of the packed assets. */
+#include "min_httpd_assets_engine.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The default number of lookups.
+ */
+#define MIN_HTTPD_ASSETS_HOST_LOOKUPS 1000000
+
+/**
+ * The maximum length of a path.
+ */
+#define MIN_HTTPD_ASSETS_HOST_BUF_LEN 256
+
+/**
+ * The maximum length of the content of an asset.
+ */
+#define MIN_HTTPD_ASSETS_HOST_CONTENT_LEN 65536
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * The table of the component's assets (generated).
+ */
+extern const struct min_httpd_asset_table min_httpd_www;
+
+/**
+ * The table of the synthetic assets (generated).
+ */
+extern const struct min_httpd_asset_table min_httpd_assets_synthetic;
+
+/**
+ * Prevent the compiler from removing the lookups.
+ */
+static volatile uintptr_t min_httpd_assets_host_sink;
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get the current time.
+ *
+ * @return double The time in seconds.
+ */
+static double min_httpd_assets_host_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Determine, if an asset is found by its path with the expected content.
+ *
+ * @param table   The table.
+ * @param uri     The URI of the request.
+ * @param content The expected content.
+ * @param len     The length of ``content``.
+ * @return bool ``true`` if the asset is found.
+ */
+static bool min_httpd_assets_host_found(
+    const struct min_httpd_asset_table* table,
+    const char* uri,
+    const char* content,
+    size_t len) {
+    const struct min_httpd_asset* asset = min_httpd_assets_find(table, uri);
+
+    return (asset != NULL) && (asset->len == len) &&
+           (asset->offset + asset->len <= table->blob_len) &&
+           (asset->gzip_offset + asset->gzip_len <= table->blob_len) &&
+           (memcmp(table->blob + asset->offset, content, len) == 0);
+}
+
+/**
+ * Verify the assets of the component's ``www`` directory.
+ *
+ * @return bool ``true`` if all files of the directory are found.
+ */
+static bool min_httpd_assets_host_check_www(void) {
+    DIR* dir = opendir(MIN_HTTPD_ASSETS_HOST_WWW);
+    struct dirent* entry;
+    size_t files = 0;
+    bool ok = (dir != NULL);
+
+    while (ok && ((entry = readdir(dir)) != NULL)) {
+        if (entry->d_name[0] == '.')
+            continue;
+
+        static char content[MIN_HTTPD_ASSETS_HOST_CONTENT_LEN];
+        char file_name[MIN_HTTPD_ASSETS_HOST_BUF_LEN * 2];
+        char uri[MIN_HTTPD_ASSETS_HOST_BUF_LEN * 2];
+        snprintf(file_name,
+                 sizeof(file_name),
+                 "%s/%s",
+                 MIN_HTTPD_ASSETS_HOST_WWW,
+                 entry->d_name);
+        snprintf(uri, sizeof(uri), "/%s", entry->d_name);
+
+        FILE* file = fopen(file_name, "rb");
+        if (file == NULL)
+            return false;
+        size_t len = fread(content, 1, sizeof(content), file);
+        fclose(file);
+
+        ok = min_httpd_assets_host_found(&min_httpd_www, uri, content, len);
+        if (ok && (strcmp(entry->d_name, "index.html") == 0))
+            ok = min_httpd_assets_host_found(&min_httpd_www, "/", content, len);
+        files++;
+    }
+    if (dir != NULL)
+        closedir(dir);
+
+    return ok && (files > 0);
+}
+
+/**
+ * Verify the synthetic assets.
+ *
+ * @return bool ``true`` if all assets are found by their paths (with and
+ *              without a query) and other paths are not found.
+ */
+static bool min_httpd_assets_host_check_synthetic(void) {
+    char uri[MIN_HTTPD_ASSETS_HOST_BUF_LEN];
+    char content[MIN_HTTPD_ASSETS_HOST_BUF_LEN];
+    const struct min_httpd_asset_table* table = &min_httpd_assets_synthetic;
+
+    // Every directory has its ``index.html``
+    if (table->count != 2 * MIN_HTTPD_ASSETS_HOST_SYNTHETIC)
+        return false;
+
+    for (int i = 1; i <= MIN_HTTPD_ASSETS_HOST_SYNTHETIC; i++) {
+        size_t len =
+            snprintf(content, sizeof(content), "<h1>Station %d</h1>\n", i);
+        const char* const formats[] = {
+            "/station/%d/index.html",
+            "/station/%d/",
+            "/station/%d/index.html?v=2",
+        };
+        for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+            snprintf(uri, sizeof(uri), formats[f], i);
+            if (!min_httpd_assets_host_found(table, uri, content, len))
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Determine, if paths, that are not packed, are not found.
+ *
+ * @return bool ``true`` if none of the paths is found.
+ */
+static bool min_httpd_assets_host_check_unknown(void) {
+    const char* const uris[] = {
+        "",
+        "/",
+        "/station/0/",
+        "/station/1",
+        "/station/1/index.htm",
+        "/station/1/index.html/",
+        "/robots.txt",
+    };
+
+    for (size_t i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        if (min_httpd_assets_find(&min_httpd_assets_synthetic, uris[i]) !=
+            NULL)
+            return false;
+    }
+    return min_httpd_assets_find(&min_httpd_www, "/nope.html") == NULL;
+}
+
+/**
+ * Verify the evaluation of ``Accept-Encoding`` and ``If-None-Match``.
+ *
+ * @return bool ``true`` if all headers are evaluated as expected.
+ */
+static bool min_httpd_assets_host_check_headers(void) {
+    const struct {
+        const char* accept_encoding;
+        bool gzip;
+    } cases[] = {
+        {"gzip", true},
+        {"gzip, deflate, br", true},
+        {"deflate, GZIP;q=0.5", true},
+        {"br, gzip;q=0", false},
+        {"x-gzip-not", false},
+        {"identity", false},
+        {"", false},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (min_httpd_assets_accepts_gzip(cases[i].accept_encoding) !=
+            cases[i].gzip)
+            return false;
+    }
+
+    const struct min_httpd_asset asset = {.hash = 0x1234abcd};
+    char etag[MIN_HTTPD_ASSETS_ETAG_LEN];
+    char etag_gzip[MIN_HTTPD_ASSETS_ETAG_LEN];
+    min_httpd_assets_etag(&asset, false, etag);
+    min_httpd_assets_etag(&asset, true, etag_gzip);
+
+    return (strcmp(etag, "\"1234abcd\"") == 0) &&
+           (strcmp(etag_gzip, "\"1234abcd-gz\"") == 0) &&
+           min_httpd_assets_not_modified(etag, "\"1234abcd\"") &&
+           min_httpd_assets_not_modified(etag, "\"0\", \"1234abcd\"") &&
+           min_httpd_assets_not_modified(etag, "*") &&
+           !min_httpd_assets_not_modified(etag, "\"1234abcd-gz\"") &&
+           !min_httpd_assets_not_modified(etag, NULL);
+}
+
+/**
+ * Verify the evaluation of conditions and ranges and the heads of the
+ * responses.
+ *
+ * @return bool ``true`` if all requests are evaluated as expected.
+ */
+static bool min_httpd_assets_host_check_conditions(void) {
+    const struct min_httpd_asset asset = {
+        .type = "text/html",
+        .hash = 0x1234abcd,
+        .len = 100,
+        .gzip_offset = 100,
+        .gzip_len = 60,
+    };
+    // Sun, 06 Nov 1994 08:49:37 GMT
+    const struct min_httpd_asset_table table = {.timestamp = 784111777};
+    const char* const date = "Sun, 06 Nov 1994 08:49:37 GMT";
+    const struct {
+        struct min_httpd_assets_request request;
+        enum min_httpd_assets_status status;
+        uint32_t offset;
+        uint32_t len;
+        const char* line;  // a line of the head
+    } cases[] = {
+        {{.range = NULL},
+         MIN_HTTPD_ASSETS_OK,
+         0,
+         100,
+         "Last-Modified: Sun, 06 Nov 1994 08:49:37 GMT\r\n"},
+        {{.accept_encoding = "gzip"},
+         MIN_HTTPD_ASSETS_OK,
+         100,
+         60,
+         "Content-Encoding: gzip\r\n"},
+        {{.if_modified_since = date},
+         MIN_HTTPD_ASSETS_NOT_MODIFIED,
+         0,
+         0,
+         "HTTP/1.1 304 Not Modified\r\n"},
+        {{.if_modified_since = "Sun, 06 Nov 1994 08:49:36 GMT"},
+         MIN_HTTPD_ASSETS_OK,
+         0,
+         100,
+         "HTTP/1.1 200 OK\r\n"},
+        {{.if_modified_since = "Sunday, 06-Nov-94 08:49:37 GMT"},
+         MIN_HTTPD_ASSETS_OK,
+         0,
+         100,
+         "Accept-Ranges: bytes\r\n"},
+        {{.if_none_match = "\"0\"", .if_modified_since = date},
+         MIN_HTTPD_ASSETS_OK,
+         0,
+         100,
+         "ETag: \"1234abcd\"\r\n"},
+        {{.range = "bytes=10-19"},
+         MIN_HTTPD_ASSETS_PARTIAL,
+         10,
+         10,
+         "Content-Range: bytes 10-19/100\r\n"},
+        {{.range = "bytes=90-"},
+         MIN_HTTPD_ASSETS_PARTIAL,
+         90,
+         10,
+         "Content-Length: 10\r\n"},
+        {{.range = "bytes=-30"},
+         MIN_HTTPD_ASSETS_PARTIAL,
+         70,
+         30,
+         "Content-Range: bytes 70-99/100\r\n"},
+        {{.range = "bytes=50-500"},
+         MIN_HTTPD_ASSETS_PARTIAL,
+         50,
+         50,
+         "HTTP/1.1 206 Partial Content\r\n"},
+        {{.accept_encoding = "gzip", .range = "bytes=0-9"},
+         MIN_HTTPD_ASSETS_PARTIAL,
+         100,
+         10,
+         "Content-Range: bytes 0-9/60\r\n"},
+        {{.range = "bytes=100-"},
+         MIN_HTTPD_ASSETS_UNSATISFIABLE,
+         0,
+         0,
+         "Content-Range: bytes */100\r\n"},
+        {{.range = "bytes=0-1,5-6"},
+         MIN_HTTPD_ASSETS_OK,
+         0,
+         100,
+         "Content-Length: 100\r\n"},
+        {{.range = "items=0-1"}, MIN_HTTPD_ASSETS_OK, 0, 100, NULL},
+        {{.range = "bytes=9-1"}, MIN_HTTPD_ASSETS_OK, 0, 100, NULL},
+        {{.range = "bytes=10-", .if_range = "\"1234abcd\""},
+         MIN_HTTPD_ASSETS_PARTIAL,
+         10,
+         90,
+         NULL},
+        {{.range = "bytes=10-", .if_range = "\"1234abcd-gz\""},
+         MIN_HTTPD_ASSETS_OK,
+         0,
+         100,
+         NULL},
+        {{.range = "bytes=10-", .if_range = date},
+         MIN_HTTPD_ASSETS_PARTIAL,
+         10,
+         90,
+         NULL},
+        {{.range = "bytes=10-", .if_range = "Sun, 06 Nov 1994 08:49:38 GMT"},
+         MIN_HTTPD_ASSETS_OK,
+         0,
+         100,
+         NULL},
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        struct min_httpd_assets_response response;
+        char head[MIN_HTTPD_ASSETS_HOST_BUF_LEN * 2];
+        min_httpd_assets_evaluate(&table, &asset, &cases[i].request, &response);
+        size_t head_len = min_httpd_assets_response_head(
+            head, sizeof(head), &asset, &response);
+
+        if ((response.status != cases[i].status) ||
+            (response.offset != cases[i].offset) ||
+            (response.len != cases[i].len) || (head_len == 0) ||
+            ((cases[i].line != NULL) && (strstr(head, cases[i].line) == NULL)))
+            return false;
+        if (min_httpd_assets_response_head(head, 32, &asset, &response) != 0)
+            return false;
+    }
+
+    // The dates are converted in both directions
+    const uint32_t timestamps[] = {0, 784111777, 951825600, 4102444799u};
+    for (size_t i = 0; i < sizeof(timestamps) / sizeof(timestamps[0]); i++) {
+        char buf[MIN_HTTPD_ASSETS_DATE_LEN];
+        uint32_t parsed;
+        min_httpd_assets_http_date(timestamps[i], buf);
+        if (!min_httpd_assets_parse_date(buf, &parsed) ||
+            (parsed != timestamps[i]))
+            return false;
+    }
+    char buf[MIN_HTTPD_ASSETS_DATE_LEN];
+    min_httpd_assets_http_date(951825600, buf);
+    return strcmp(buf, "Tue, 29 Feb 2000 12:00:00 GMT") == 0;
+}
+
+/**
+ * Find an asset with a linear search, as the reference of the benchmark.
+ *
+ * @param table The table.
+ * @param uri   The URI of the request.
+ * @return const struct min_httpd_asset* The asset, ``NULL`` if there is none.
+ */
+static const struct min_httpd_asset* min_httpd_assets_host_linear(
+    const struct min_httpd_asset_table* table,
+    const char* uri) {
+    size_t len = strcspn(uri, "?");
+
+    for (size_t i = 0; i < table->count; i++) {
+        if ((strncmp(table->assets[i].path, uri, len) == 0) &&
+            (table->assets[i].path[len] == '\0'))
+            return &table->assets[i];
+    }
+    return NULL;
+}
+
+/**
+ * Time lookups of the synthetic table's paths.
+ *
+ * @param lookups The number of lookups.
+ * @param linear  ``true`` to use the linear search.
+ * @return double The time per lookup in nanoseconds.
+ */
+static double min_httpd_assets_host_time(uint32_t lookups, bool linear) {
+    const struct min_httpd_asset_table* table = &min_httpd_assets_synthetic;
+    double start = min_httpd_assets_host_now();
+
+    for (uint32_t i = 0; i < lookups; i++) {
+        const char* uri = table->assets[(i * 7919u) % table->count].path;
+        min_httpd_assets_host_sink +=
+            (uintptr_t)(linear ? min_httpd_assets_host_linear(table, uri)
+                               : min_httpd_assets_find(table, uri));
+    }
+    return (min_httpd_assets_host_now() - start) * 1e9 / lookups;
+}
+
+/**
+ * Run the benchmark.
+ *
+ * @param lookups The number of lookups.
+ * @return int ``0`` if all checks passed.
+ */
+static int min_httpd_assets_host_bench(uint32_t lookups) {
+    int failures = 0;
+
+    if (lookups == 0) {
+        fprintf(stderr, "LOOKUPS must be above 0!\n");
+        return 1;
+    }
+
+    host_check(&failures,
+               min_httpd_assets_host_check_www(),
+               "Assets of the component are packed");
+    host_check(&failures,
+               min_httpd_assets_host_check_synthetic(),
+               "Synthetic assets are found");
+    host_check(&failures,
+               min_httpd_assets_host_check_unknown(),
+               "Other paths are not found");
+    host_check(&failures,
+               min_httpd_assets_host_check_headers(),
+               "Headers are evaluated");
+    host_check(&failures,
+               min_httpd_assets_host_check_conditions(),
+               "Conditions and ranges are evaluated");
+
+    /* The timings depend on the host's load and on the size of the table, so
+     * they are reported but not checked.
+     */
+    double perfect = min_httpd_assets_host_time(lookups, false);
+    double linear = min_httpd_assets_host_time(lookups, true);
+    printf("     %zu assets: perfect hash %.1f ns, linear search %.1f ns "
+           "per lookup\n",
+           min_httpd_assets_synthetic.count,
+           perfect,
+           linear);
+
+    return host_check_summary(failures);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s bench [LOOKUPS]\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "bench") == 0) {
+        return min_httpd_assets_host_bench(
+            (argc > 2) ? (uint32_t)atoi(argv[2])
+                       : MIN_HTTPD_ASSETS_HOST_LOOKUPS);
+    }
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,544 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Verify and benchmark the streaming JSON writer of the ``min_httpd``
+ * component on a Linux host.
+ *
+ * The writer is compiled unmodified. The heap functions are wrapped by the
+ * linker (see ``CMakeLists.txt``), so their calls are counted:
+ *
+ *   - ``min_httpd_json_host bench [DOCUMENTS]`` writes ``DOCUMENTS`` status
+ *     documents (``mnet32``'s status snapshot, the heap telemetry and the
+ *     results of a WiFi scan), that are longer than a chunk. The documents
+ *     are written with a ``snprintf()``-based baseline, that builds the whole
+ *     document in an allocated buffer (like ``net_diag``'s handler), and with
+ *     the writer, flushing chunks of ``MIN_HTTPD_JSON_CHUNK_LEN`` bytes. Both
+ *     are sent to a sink, that verifies the output. The benchmark reports
+ *     the time per document and the memory, that is used to build it. The
+ *     times depend on the host and the build type, so only the output and
+ *     the calls of the heap functions are checked.
+ *
+ * @file   min_httpd_json_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+/* The streaming JSON writer. */
+#include "min_httpd/min_httpd_json.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The default number of documents.
+ */
+#define MIN_HTTPD_JSON_HOST_DOCUMENTS 100000
+
+/**
+ * The size of the chunks, just like ``MIN_HTTPD_JSON_CHUNK_LEN``.
+ */
+#define MIN_HTTPD_JSON_HOST_CHUNK_LEN 256
+
+/**
+ * The size of the buffer of the baseline, that must fit any document.
+ */
+#define MIN_HTTPD_JSON_HOST_BASELINE_LEN 2048
+
+/**
+ * The number of access points of the simulated scan.
+ */
+#define MIN_HTTPD_JSON_HOST_APS 16
+
+/**
+ * The number of RSSI samples, just like ``MNET32_WIFI_RSSI_HISTORY_LEN``.
+ */
+#define MIN_HTTPD_JSON_HOST_HISTORY 12
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * An access point of the simulated scan.
+ */
+struct min_httpd_json_host_ap {
+    char ssid[33];
+    int8_t rssi;
+    uint8_t channel;
+    const char* auth;
+};
+
+/**
+ * The data of a status document.
+ */
+struct min_httpd_json_host_status {
+    uint32_t heap;
+    uint32_t heap_min;
+    bool connected;
+    int8_t rssi;
+    int8_t rssi_avg;
+    uint8_t rssi_count;
+    int8_t rssi_history[MIN_HTTPD_JSON_HOST_HISTORY];
+    uint32_t roam_scans;
+    uint32_t roams;
+    struct min_httpd_json_host_ap aps[MIN_HTTPD_JSON_HOST_APS];
+};
+
+/**
+ * The destination of the documents, like the session of a client.
+ */
+struct min_httpd_json_host_sink {
+    char data[MIN_HTTPD_JSON_HOST_BASELINE_LEN];
+    size_t len;
+    uint32_t chunks;
+    uint32_t fail_after;  // fail the flush after this many chunks
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * The number of calls of the heap functions, counted while
+ * ::min_httpd_json_host_count is set.
+ */
+static uint32_t min_httpd_json_host_calls = 0;
+
+/**
+ * Count the calls of the heap functions.
+ */
+static bool min_httpd_json_host_count = false;
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+void* __wrap_malloc(size_t size);
+void* __wrap_calloc(size_t count, size_t size);
+void* __wrap_realloc(void* ptr, size_t size);
+void __wrap_free(void* ptr);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+void* __wrap_malloc(size_t size) {
+    if (min_httpd_json_host_count)
+        min_httpd_json_host_calls++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    if (min_httpd_json_host_count)
+        min_httpd_json_host_calls++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    if (min_httpd_json_host_count)
+        min_httpd_json_host_calls++;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr) {
+    if (min_httpd_json_host_count)
+        min_httpd_json_host_calls++;
+    __real_free(ptr);
+}
+
+/**
+ * Get the current time.
+ *
+ * @return double The time in seconds.
+ */
+static double min_httpd_json_host_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Take a chunk, like ``httpd_resp_send_chunk()``.
+ *
+ * @param ctx  The sink (::min_httpd_json_host_sink ).
+ * @param data The chunk.
+ * @param len  The length of ``data``.
+ * @return bool ``false`` if the sink fails or is full.
+ */
+static bool min_httpd_json_host_flush(void* ctx, const char* data, size_t len) {
+    struct min_httpd_json_host_sink* sink = ctx;
+
+    if ((sink->chunks == sink->fail_after) ||
+        (sink->len + len > sizeof(sink->data)))
+        return false;
+    memcpy(sink->data + sink->len, data, len);
+    sink->len += len;
+    sink->chunks++;
+    return true;
+}
+
+/**
+ * Generate the data of a status document.
+ *
+ * @param status The data.
+ */
+static void min_httpd_json_host_status_init(
+    struct min_httpd_json_host_status* status) {
+    static const char* const auth[] = {"open", "wpa2", "wpa3"};
+
+    memset(status, 0, sizeof(*status));
+    status->heap = 151204;
+    status->heap_min = 140112;
+    status->connected = true;
+    status->rssi = -61;
+    status->rssi_avg = -63;
+    status->rssi_count = MIN_HTTPD_JSON_HOST_HISTORY;
+    for (int i = 0; i < MIN_HTTPD_JSON_HOST_HISTORY; i++)
+        status->rssi_history[i] = (int8_t)(-58 - (i * 7) % 11);
+    status->roam_scans = 2;
+    status->roams = 1;
+    for (int i = 0; i < MIN_HTTPD_JSON_HOST_APS; i++) {
+        snprintf(status->aps[i].ssid,
+                 sizeof(status->aps[i].ssid),
+                 "Krachkiste Network %02d",
+                 i);
+        status->aps[i].rssi = (int8_t)(-40 - i * 3);
+        status->aps[i].channel = (uint8_t)(1 + (i * 5) % 13);
+        status->aps[i].auth = auth[i % 3];
+    }
+}
+
+/**
+ * Write a status document with ``snprintf()`` into an allocated buffer and
+ * send it.
+ *
+ * @param status The data.
+ * @param sink   The sink.
+ * @return bool ``true`` on success.
+ */
+static bool min_httpd_json_host_baseline(
+    const struct min_httpd_json_host_status* status,
+    struct min_httpd_json_host_sink* sink) {
+    const size_t size = MIN_HTTPD_JSON_HOST_BASELINE_LEN;
+    char* buf = malloc(size);
+    if (buf == NULL)
+        return false;
+
+    int off = snprintf(buf,
+                       size,
+                       "{\"heap\":%" PRIu32 ",\"heap_min\":%" PRIu32
+                       ",\"net\":{\"connected\":%s,\"rssi\":%d"
+                       ",\"rssi_avg\":%d,\"rssi_history\":[",
+                       status->heap,
+                       status->heap_min,
+                       status->connected ? "true" : "false",
+                       status->rssi,
+                       status->rssi_avg);
+    for (int i = 0; i < status->rssi_count; i++)
+        off += snprintf(buf + off,
+                        size - off,
+                        "%s%d",
+                        (i > 0) ? "," : "",
+                        status->rssi_history[i]);
+    off += snprintf(buf + off,
+                    size - off,
+                    "],\"roam_scans\":%" PRIu32 ",\"roams\":%" PRIu32
+                    "},\"aps\":[",
+                    status->roam_scans,
+                    status->roams);
+    for (int i = 0; i < MIN_HTTPD_JSON_HOST_APS; i++)
+        off += snprintf(buf + off,
+                        size - off,
+                        "%s{\"ssid\":\"%s\",\"rssi\":%d,\"channel\":%u"
+                        ",\"auth\":\"%s\"}",
+                        (i > 0) ? "," : "",
+                        status->aps[i].ssid,
+                        status->aps[i].rssi,
+                        (unsigned int)status->aps[i].channel,
+                        status->aps[i].auth);
+    off += snprintf(buf + off, size - off, "]}");
+
+    bool ok = ((size_t)off < size) && min_httpd_json_host_flush(sink, buf, off);
+    free(buf);
+    return ok;
+}
+
+/**
+ * Write a status document with the writer, like ``mnet32``'s
+ * ``mnet32_status_snapshot_json()`` and ``min_httpd_json_heap()``.
+ *
+ * @param status The data.
+ * @param sink   The sink.
+ * @param chunk  The size of the chunks.
+ * @return bool ``true`` on success.
+ */
+static bool min_httpd_json_host_writer(
+    const struct min_httpd_json_host_status* status,
+    struct min_httpd_json_host_sink* sink,
+    size_t chunk) {
+    char buf[MIN_HTTPD_JSON_HOST_BASELINE_LEN];
+    struct min_httpd_json json;
+    min_httpd_json_init(&json, buf, chunk, min_httpd_json_host_flush, sink);
+
+    min_httpd_json_object_begin(&json);
+    min_httpd_json_key(&json, "heap");
+    min_httpd_json_uint(&json, status->heap);
+    min_httpd_json_key(&json, "heap_min");
+    min_httpd_json_uint(&json, status->heap_min);
+    min_httpd_json_key(&json, "net");
+    min_httpd_json_object_begin(&json);
+    min_httpd_json_key(&json, "connected");
+    min_httpd_json_bool(&json, status->connected);
+    min_httpd_json_key(&json, "rssi");
+    min_httpd_json_int(&json, status->rssi);
+    min_httpd_json_key(&json, "rssi_avg");
+    min_httpd_json_int(&json, status->rssi_avg);
+    min_httpd_json_key(&json, "rssi_history");
+    min_httpd_json_array_begin(&json);
+    for (int i = 0; i < status->rssi_count; i++)
+        min_httpd_json_int(&json, status->rssi_history[i]);
+    min_httpd_json_array_end(&json);
+    min_httpd_json_key(&json, "roam_scans");
+    min_httpd_json_uint(&json, status->roam_scans);
+    min_httpd_json_key(&json, "roams");
+    min_httpd_json_uint(&json, status->roams);
+    min_httpd_json_object_end(&json);
+    min_httpd_json_key(&json, "aps");
+    min_httpd_json_array_begin(&json);
+    for (int i = 0; i < MIN_HTTPD_JSON_HOST_APS; i++) {
+        min_httpd_json_object_begin(&json);
+        min_httpd_json_key(&json, "ssid");
+        min_httpd_json_string(&json, status->aps[i].ssid);
+        min_httpd_json_key(&json, "rssi");
+        min_httpd_json_int(&json, status->aps[i].rssi);
+        min_httpd_json_key(&json, "channel");
+        min_httpd_json_uint(&json, status->aps[i].channel);
+        min_httpd_json_key(&json, "auth");
+        min_httpd_json_string(&json, status->aps[i].auth);
+        min_httpd_json_object_end(&json);
+    }
+    min_httpd_json_array_end(&json);
+    min_httpd_json_object_end(&json);
+
+    return min_httpd_json_finish(&json);
+}
+
+/**
+ * Write a document of single values into a fixed buffer.
+ *
+ * @param buf      The buffer, ``\0``-terminated on success.
+ * @param size     The size of ``buf``.
+ * @param strings  The strings to be written as array.
+ * @param count    The number of ``strings``.
+ * @return bool ``true`` on success.
+ */
+static bool min_httpd_json_host_strings(char* buf,
+                                        size_t size,
+                                        const char* const* strings,
+                                        size_t count) {
+    struct min_httpd_json json;
+    min_httpd_json_init(&json, buf, size - 1, NULL, NULL);
+    min_httpd_json_array_begin(&json);
+    for (size_t i = 0; i < count; i++)
+        min_httpd_json_string(&json, strings[i]);
+    min_httpd_json_array_end(&json);
+    if (!min_httpd_json_finish(&json))
+        return false;
+    buf[json.len] = '\0';
+    return true;
+}
+
+/**
+ * Verify the escaping, the integers and the errors of the writer.
+ *
+ * @param failures The number of failures.
+ */
+static void min_httpd_json_host_verify(int* failures) {
+    char buf[128];
+    struct min_httpd_json json;
+
+    static const char* const strings[] = {
+        "plain", "a\"b\\c", "line\r\n\ttab", "\x01\x1f", "K\xc3\xa4se", NULL};
+    host_check(
+        failures,
+        min_httpd_json_host_strings(buf, sizeof(buf), strings, 6) &&
+            (strcmp(buf,
+                    "[\"plain\",\"a\\\"b\\\\c\",\"line\\r\\n\\ttab\","
+                    "\"\\u0001\\u001f\",\"K\xc3\xa4se\",null]") == 0),
+        "Strings are escaped");
+
+    min_httpd_json_init(&json, buf, sizeof(buf) - 1, NULL, NULL);
+    min_httpd_json_array_begin(&json);
+    min_httpd_json_int(&json, INT64_MIN);
+    min_httpd_json_int(&json, -1);
+    min_httpd_json_int(&json, 0);
+    min_httpd_json_uint(&json, UINT64_MAX);
+    min_httpd_json_bool(&json, false);
+    min_httpd_json_array_begin(&json);
+    min_httpd_json_array_end(&json);
+    min_httpd_json_object_begin(&json);
+    min_httpd_json_object_end(&json);
+    min_httpd_json_array_end(&json);
+    bool ok = min_httpd_json_finish(&json);
+    buf[json.len] = '\0';
+    host_check(
+        failures,
+        ok && (strcmp(buf,
+                      "[-9223372036854775808,-1,0,18446744073709551615,"
+                      "false,[],{}]") == 0),
+        "Integers and containers are written");
+
+    /* The errors */
+    bool sticky = true;
+
+    min_httpd_json_init(&json, buf, 8, NULL, NULL);
+    min_httpd_json_string(&json, "longer than the buffer");
+    sticky = sticky && !min_httpd_json_finish(&json) && (json.len == 8);
+
+    min_httpd_json_init(&json, buf, sizeof(buf), NULL, NULL);
+    min_httpd_json_object_begin(&json);
+    min_httpd_json_key(&json, "open");
+    sticky = sticky && !min_httpd_json_finish(&json);
+
+    min_httpd_json_init(&json, buf, sizeof(buf), NULL, NULL);
+    min_httpd_json_key(&json, "outside");
+    min_httpd_json_array_end(&json);
+    sticky = sticky && !min_httpd_json_finish(&json);
+
+    min_httpd_json_init(&json, buf, sizeof(buf), NULL, NULL);
+    for (int i = 0; i < MIN_HTTPD_JSON_MAX_DEPTH; i++)
+        min_httpd_json_array_begin(&json);
+    sticky = sticky && json.failed;
+
+    struct min_httpd_json_host_sink sink = {.fail_after = 2};
+    struct min_httpd_json_host_status status;
+    min_httpd_json_host_status_init(&status);
+    sticky = sticky && !min_httpd_json_host_writer(&status, &sink, 64) &&
+             (sink.chunks == 2);
+
+    host_check(failures, sticky, "Errors are sticky");
+}
+
+/**
+ * Run the benchmark.
+ *
+ * @param documents The number of documents.
+ * @return int ``0`` if all checks passed.
+ */
+static int min_httpd_json_host_bench(uint32_t documents) {
+    static struct min_httpd_json_host_sink expected;
+    static struct min_httpd_json_host_sink sink;
+    struct min_httpd_json_host_status status;
+    int failures = 0;
+
+    if (documents == 0) {
+        fprintf(stderr, "DOCUMENTS must be above 0!\n");
+        return 1;
+    }
+
+    min_httpd_json_host_verify(&failures);
+
+    /* The documents are identical with any size of the chunks */
+    min_httpd_json_host_status_init(&status);
+    expected.fail_after = UINT32_MAX;
+    bool identical = min_httpd_json_host_baseline(&status, &expected);
+    static const size_t chunks[] = {1,
+                                    7,
+                                    64,
+                                    MIN_HTTPD_JSON_HOST_CHUNK_LEN,
+                                    MIN_HTTPD_JSON_HOST_BASELINE_LEN};
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        memset(&sink, 0, sizeof(sink));
+        sink.fail_after = UINT32_MAX;
+        identical = identical &&
+                    min_httpd_json_host_writer(&status, &sink, chunks[i]) &&
+                    (sink.len == expected.len) &&
+                    (memcmp(sink.data, expected.data, sink.len) == 0) &&
+                    (sink.chunks == (expected.len + chunks[i] - 1) / chunks[i]);
+    }
+    host_check(&failures, identical, "Documents are identical to the baseline");
+
+    /* The baseline */
+    uint32_t errors = 0;
+    min_httpd_json_host_calls = 0;
+    min_httpd_json_host_count = true;
+    double start = min_httpd_json_host_now();
+    for (uint32_t i = 0; i < documents; i++) {
+        sink.len = 0;
+        status.heap = i;
+        if (!min_httpd_json_host_baseline(&status, &sink))
+            errors++;
+    }
+    double baseline_us = (min_httpd_json_host_now() - start) * 1e6 / documents;
+    min_httpd_json_host_count = false;
+    uint32_t baseline_calls = min_httpd_json_host_calls;
+
+    /* The writer */
+    min_httpd_json_host_calls = 0;
+    min_httpd_json_host_count = true;
+    start = min_httpd_json_host_now();
+    for (uint32_t i = 0; i < documents; i++) {
+        sink.len = 0;
+        sink.chunks = 0;
+        status.heap = i;
+        if (!min_httpd_json_host_writer(&status,
+                                        &sink,
+                                        MIN_HTTPD_JSON_HOST_CHUNK_LEN))
+            errors++;
+    }
+    double writer_us = (min_httpd_json_host_now() - start) * 1e6 / documents;
+    min_httpd_json_host_count = false;
+    uint32_t writer_calls = min_httpd_json_host_calls;
+
+    printf("     document: %u bytes\n", (unsigned int)expected.len);
+    printf("     snprintf: %.3f us per document, %u bytes allocated\n",
+           baseline_us,
+           (unsigned int)MIN_HTTPD_JSON_HOST_BASELINE_LEN);
+    printf("     writer:   %.3f us per document, %u bytes chunk, "
+           "%u chunks\n",
+           writer_us,
+           (unsigned int)MIN_HTTPD_JSON_HOST_CHUNK_LEN,
+           (unsigned int)sink.chunks);
+
+    host_check(&failures,
+               (errors == 0) && (baseline_calls > 0),
+               "Documents are written");
+    host_check(
+        &failures, writer_calls == 0, "The writer does not call the heap");
+
+    return host_check_summary(failures);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s bench [DOCUMENTS]\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "bench") == 0) {
+        return min_httpd_json_host_bench(
+            (argc > 2) ? (uint32_t)atoi(argv[2])
+                       : MIN_HTTPD_JSON_HOST_DOCUMENTS);
+    }
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
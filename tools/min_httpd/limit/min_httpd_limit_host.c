@@ -0,0 +1,381 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Verify and benchmark the rate limiting of the ``min_httpd`` component on a
+ * Linux host.
+ *
+ * The engine is compiled unmodified and runs in virtual time, given in
+ * milliseconds:
+ *
+ *   - ``min_httpd_limit_host bench [SECONDS]`` verifies the buckets (burst,
+ *     refill, costs, replacement of buckets and the wrap-around of the time)
+ *     and simulates ``SECONDS`` of a browser tab, that polls in a loop,
+ *     while the configuration form is loaded on another client and phones
+ *     request the status. The simulation verifies, that only the polling
+ *     client is limited, to its rate, and reports the admitted requests per
+ *     client and the time per decision.
+ *
+ * @file   min_httpd_limit_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+/* The engine of the rate limiting. */
+#include "min_httpd_limit_engine.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The default duration of the simulation, given in seconds.
+ */
+#define MIN_HTTPD_LIMIT_HOST_SECONDS 60
+
+/**
+ * The number of buckets, just like ``MIN_HTTPD_LIMIT_CLIENTS``.
+ */
+#define MIN_HTTPD_LIMIT_HOST_CLIENTS 8
+
+/**
+ * The tokens per second, just like ``CONFIG_MIN_HTTPD_LIMIT_RATE``.
+ */
+#define MIN_HTTPD_LIMIT_HOST_RATE 10
+
+/**
+ * The tokens of a full bucket, just like ``CONFIG_MIN_HTTPD_LIMIT_BURST``.
+ */
+#define MIN_HTTPD_LIMIT_HOST_BURST 30
+
+/**
+ * The tokens of a request of an offloaded route, just like
+ * ``MIN_HTTPD_LIMIT_COST_OFFLOADED``.
+ */
+#define MIN_HTTPD_LIMIT_HOST_COST_OFFLOADED 4
+
+/**
+ * The number of decisions, that are timed.
+ */
+#define MIN_HTTPD_LIMIT_HOST_DECISIONS 10000000
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A simulated client.
+ */
+struct min_httpd_limit_host_client {
+    const char* name;
+    uint8_t address[4];
+    uint32_t period;    // the time between the client's bursts, in ms
+    uint32_t requests;  // the requests of a burst
+    uint32_t cost;      // the tokens of a request
+
+    uint32_t admitted;
+    uint32_t limited;
+};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get the current time.
+ *
+ * @return double The time in seconds.
+ */
+static double min_httpd_limit_host_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Determine the key of a simulated IPv4 address.
+ *
+ * @param last The last byte of the address (``192.168.4.x``).
+ * @return uint32_t The key.
+ */
+static uint32_t min_httpd_limit_host_key(uint8_t last) {
+    const uint8_t address[4] = {192, 168, 4, last};
+    return min_httpd_limit_key(address, sizeof(address));
+}
+
+/**
+ * Send requests of a client at once.
+ *
+ * @param limit    The buckets.
+ * @param key      The client's key.
+ * @param requests The number of requests.
+ * @param cost     The tokens of a request.
+ * @param now      The time of the requests.
+ * @return uint32_t The number of admitted requests.
+ */
+static uint32_t min_httpd_limit_host_burst(struct min_httpd_limit* limit,
+                                           uint32_t key,
+                                           uint32_t requests,
+                                           uint32_t cost,
+                                           uint32_t now) {
+    uint32_t admitted = 0;
+
+    for (uint32_t i = 0; i < requests; i++) {
+        if (min_httpd_limit_take(limit, key, cost, now))
+            admitted++;
+    }
+    return admitted;
+}
+
+/**
+ * Verify the buckets of single clients.
+ *
+ * @param failures The number of failures.
+ */
+static void min_httpd_limit_host_verify_buckets(int* failures) {
+    struct min_httpd_limit_bucket storage[MIN_HTTPD_LIMIT_HOST_CLIENTS];
+    struct min_httpd_limit limit;
+    uint32_t key = min_httpd_limit_host_key(10);
+
+    min_httpd_limit_init(&limit,
+                         storage,
+                         MIN_HTTPD_LIMIT_HOST_CLIENTS,
+                         MIN_HTTPD_LIMIT_HOST_RATE,
+                         MIN_HTTPD_LIMIT_HOST_BURST);
+    host_check(
+        failures,
+        (min_httpd_limit_host_burst(&limit,
+                                    key,
+                                    MIN_HTTPD_LIMIT_HOST_BURST + 5,
+                                    1,
+                                    1000) == MIN_HTTPD_LIMIT_HOST_BURST) &&
+            (limit.limited == 5),
+        "A new client is admitted up to the burst");
+
+    // After 250 ms, the bucket holds 2.5 tokens
+    host_check(failures,
+               min_httpd_limit_host_burst(&limit, key, 5, 1, 1250) == 2,
+               "The bucket is refilled at the rate");
+    host_check(failures,
+               min_httpd_limit_host_burst(&limit, key, 1, 1, 1300) == 1,
+               "Fractions of tokens are kept");
+
+    // 3 tokens after 300 ms, an offloaded request takes 4
+    host_check(failures,
+               (min_httpd_limit_host_burst(&limit,
+                                           key,
+                                           1,
+                                           MIN_HTTPD_LIMIT_HOST_COST_OFFLOADED,
+                                           1600) == 0) &&
+                   (min_httpd_limit_host_burst(&limit, key, 3, 1, 1600) == 3),
+               "Refused requests do not take tokens");
+    host_check(failures,
+               min_httpd_limit_host_burst(&limit, key, 100, 1, 600000) ==
+                   MIN_HTTPD_LIMIT_HOST_BURST,
+               "An idle client's bucket is full");
+
+    // The time wraps around between the requests
+    min_httpd_limit_init(&limit,
+                         storage,
+                         MIN_HTTPD_LIMIT_HOST_CLIENTS,
+                         MIN_HTTPD_LIMIT_HOST_RATE,
+                         MIN_HTTPD_LIMIT_HOST_BURST);
+    min_httpd_limit_host_burst(&limit,
+                               key,
+                               MIN_HTTPD_LIMIT_HOST_BURST,
+                               1,
+                               UINT32_MAX - 499);
+    host_check(failures,
+               min_httpd_limit_host_burst(&limit, key, 20, 1, 500) == 10,
+               "The refill survives the wrap-around of the time");
+}
+
+/**
+ * Verify the replacement of buckets.
+ *
+ * @param failures The number of failures.
+ */
+static void min_httpd_limit_host_verify_table(int* failures) {
+    struct min_httpd_limit_bucket storage[MIN_HTTPD_LIMIT_HOST_CLIENTS];
+    struct min_httpd_limit limit;
+    uint32_t drained = min_httpd_limit_host_key(200);
+    uint32_t now = 0;
+
+    min_httpd_limit_init(&limit,
+                         storage,
+                         MIN_HTTPD_LIMIT_HOST_CLIENTS,
+                         MIN_HTTPD_LIMIT_HOST_RATE,
+                         MIN_HTTPD_LIMIT_HOST_BURST);
+
+    // A client, that drains its bucket, and as many others as fit
+    min_httpd_limit_host_burst(&limit,
+                               drained,
+                               MIN_HTTPD_LIMIT_HOST_BURST,
+                               1,
+                               now);
+    for (uint8_t i = 1; i < MIN_HTTPD_LIMIT_HOST_CLIENTS; i++)
+        min_httpd_limit_host_burst(&limit,
+                                   min_httpd_limit_host_key(i),
+                                   1,
+                                   1,
+                                   ++now);
+    host_check(failures,
+               (limit.evicted == 0) &&
+                   !min_httpd_limit_take(&limit, drained, 1, now),
+               "Buckets are kept, while the clients fit into the table");
+
+    // More clients replace the buckets, that were seen least recently
+    for (uint8_t i = 1; i < 2 * MIN_HTTPD_LIMIT_HOST_CLIENTS; i++)
+        min_httpd_limit_host_burst(&limit,
+                                   min_httpd_limit_host_key(100 + i),
+                                   1,
+                                   1,
+                                   ++now);
+    // Every client but the drained one was admitted with a new bucket
+    uint32_t admitted =
+        MIN_HTTPD_LIMIT_HOST_BURST + 3 * MIN_HTTPD_LIMIT_HOST_CLIENTS - 2;
+    host_check(failures,
+               (limit.evicted > 0) && (limit.admitted == admitted),
+               "Further clients replace the least recent buckets");
+}
+
+/**
+ * Simulate the clients of the access point.
+ *
+ * @param seconds The duration of the simulation.
+ * @param clients The clients.
+ * @param count   The number of ``clients``.
+ */
+static void min_httpd_limit_host_simulate(
+    uint32_t seconds,
+    struct min_httpd_limit_host_client* clients,
+    size_t count) {
+    struct min_httpd_limit_bucket storage[MIN_HTTPD_LIMIT_HOST_CLIENTS];
+    struct min_httpd_limit limit;
+
+    min_httpd_limit_init(&limit,
+                         storage,
+                         MIN_HTTPD_LIMIT_HOST_CLIENTS,
+                         MIN_HTTPD_LIMIT_HOST_RATE,
+                         MIN_HTTPD_LIMIT_HOST_BURST);
+
+    for (uint32_t now = 0; now < seconds * 1000; now++) {
+        for (size_t i = 0; i < count; i++) {
+            struct min_httpd_limit_host_client* client = &clients[i];
+            if ((now % client->period) != 0)
+                continue;
+
+            uint32_t key = min_httpd_limit_key(client->address,
+                                               sizeof(client->address));
+            uint32_t admitted = min_httpd_limit_host_burst(&limit,
+                                                           key,
+                                                           client->requests,
+                                                           client->cost,
+                                                           now);
+            client->admitted += admitted;
+            client->limited += client->requests - admitted;
+        }
+    }
+}
+
+/**
+ * Verify the buckets and simulate the clients of the access point.
+ *
+ * @param seconds The duration of the simulation.
+ * @return int ``0`` if all checks passed.
+ */
+static int min_httpd_limit_host_bench(uint32_t seconds) {
+    struct min_httpd_limit_host_client clients[] = {
+        {"polling tab", {192, 168, 4, 2}, 5, 1, 1, 0, 0},
+        {"page load", {192, 168, 4, 3}, 2000, 6, 1, 0, 0},
+        {"form submit", {192, 168, 4, 3}, 10000, 1, 4, 0, 0},
+        {"phone", {192, 168, 4, 4}, 1000, 1, 1, 0, 0},
+        {"phone", {192, 168, 4, 5}, 1000, 1, 1, 0, 0},
+    };
+    const size_t count = sizeof(clients) / sizeof(clients[0]);
+    int failures = 0;
+
+    if (seconds == 0) {
+        fprintf(stderr, "SECONDS must be above 0!\n");
+        return 1;
+    }
+
+    min_httpd_limit_host_verify_buckets(&failures);
+    min_httpd_limit_host_verify_table(&failures);
+
+    min_httpd_limit_host_simulate(seconds, clients, count);
+    printf("\n%-12s %10s %10s\n", "client", "admitted", "limited");
+    for (size_t i = 0; i < count; i++)
+        printf("%-12s %10u %10u\n",
+               clients[i].name,
+               clients[i].admitted,
+               clients[i].limited);
+    printf("\n");
+
+    bool others = true;
+    for (size_t i = 1; i < count; i++)
+        others = others && (clients[i].limited == 0);
+    uint32_t allowance =
+        MIN_HTTPD_LIMIT_HOST_BURST + MIN_HTTPD_LIMIT_HOST_RATE * seconds;
+    host_check(&failures, others, "Other clients are never limited");
+    host_check(&failures,
+               (clients[0].limited > 0) &&
+                   (clients[0].admitted <= allowance) &&
+                   (clients[0].admitted + 1 >= allowance),
+               "The polling tab is limited to its rate");
+
+    /* Time the decisions of requests of several clients. */
+    struct min_httpd_limit_bucket storage[MIN_HTTPD_LIMIT_HOST_CLIENTS];
+    struct min_httpd_limit limit;
+    uint32_t keys[MIN_HTTPD_LIMIT_HOST_CLIENTS];
+    min_httpd_limit_init(&limit,
+                         storage,
+                         MIN_HTTPD_LIMIT_HOST_CLIENTS,
+                         MIN_HTTPD_LIMIT_HOST_RATE,
+                         MIN_HTTPD_LIMIT_HOST_BURST);
+    for (uint8_t i = 0; i < MIN_HTTPD_LIMIT_HOST_CLIENTS; i++)
+        keys[i] = min_httpd_limit_host_key(i + 2);
+
+    double start = min_httpd_limit_host_now();
+    for (uint32_t i = 0; i < MIN_HTTPD_LIMIT_HOST_DECISIONS; i++)
+        min_httpd_limit_take(&limit,
+                             keys[i % MIN_HTTPD_LIMIT_HOST_CLIENTS],
+                             1,
+                             i / 1000);
+    double elapsed = min_httpd_limit_host_now() - start;
+    printf("%.1f ns per decision (%u admitted, %u limited)\n",
+           elapsed * 1e9 / MIN_HTTPD_LIMIT_HOST_DECISIONS,
+           limit.admitted,
+           limit.limited);
+
+    return host_check_summary(failures);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s bench [SECONDS]\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "bench") == 0) {
+        return min_httpd_limit_host_bench(
+            (argc > 2) ? (uint32_t)atoi(argv[2])
+                       : MIN_HTTPD_LIMIT_HOST_SECONDS);
+    }
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
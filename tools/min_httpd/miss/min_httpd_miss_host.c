@@ -0,0 +1,459 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Benchmark the responses to missing resources of the ``min_httpd``
+ * component on a Linux host.
+ *
+ * The engine is compiled unmodified. A single thread serves the requests,
+ * just like ``esp_http_server``'s task, and answers every request with the
+ * precomputed ``404 Not Found``:
+ *
+ *   - ``min_httpd_miss_host bench [REQUESTS]`` lets a client request
+ *     ``REQUESTS`` missing resources, mostly common probes of browsers. The
+ *     client reuses its session, unless the server closes it. The benchmark
+ *     runs with the sessions closed after every response (like the former
+ *     ``ESP_FAIL`` of the handler) and kept alive, and reports the number of
+ *     connections and the time per request. Finally, it verifies, that the
+ *     negative cache never shadows a served path.
+ *
+ * Every connection is a TCP handshake, that costs at least one round trip on
+ * the access point's link; on the loopback interface, the difference of the
+ * time is just the overhead of the sockets.
+ *
+ * @file   min_httpd_miss_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* The engine of the responses to missing resources. */
+#include "min_httpd_miss_engine.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The default number of requests.
+ */
+#define MIN_HTTPD_MISS_HOST_REQUESTS 2000
+
+/**
+ * The number of learned paths, just like ``MIN_HTTPD_MISS_CACHE_SIZE``.
+ */
+#define MIN_HTTPD_MISS_HOST_CACHE_SIZE 16
+
+/**
+ * The maximum length of a request or response.
+ */
+#define MIN_HTTPD_MISS_HOST_BUF_LEN 512
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * The server.
+ */
+struct min_httpd_miss_host_server {
+    int listener;
+    bool keep_alive;  // ``false`` to close the session after every response
+    uint32_t connections;
+
+    struct min_httpd_miss_entry learned[MIN_HTTPD_MISS_HOST_CACHE_SIZE];
+    struct min_httpd_miss_cache cache;
+};
+
+/**
+ * The results of a run.
+ */
+struct min_httpd_miss_host_result {
+    uint32_t connections;  // accepted by the server
+    uint32_t reconnects;   // of the client, as the server closed the session
+    uint32_t invalid;
+    uint32_t hits;
+    uint32_t misses;
+    double us_per_request;
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * The paths, that are requested by the client in turn.
+ *
+ * These are mostly common probes of browsers, but some paths are learned by
+ * the negative cache.
+ */
+static const char* const min_httpd_miss_host_paths[] = {
+    "/apple-touch-icon.png",
+    "/apple-touch-icon-precomposed.png",
+    "/robots.txt",
+    "/favicon.png",
+    "/manifest.json",
+    "/wp-login.php",
+    "/.env",
+    "/static/app.js.map?v=2",
+};
+
+/**
+ * The number of paths of ::min_httpd_miss_host_paths , that are not common
+ * probes.
+ */
+static const uint32_t min_httpd_miss_host_unknown = 3;
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get the current time.
+ *
+ * @return double The time in seconds.
+ */
+static double min_httpd_miss_host_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Serve a session until it is closed.
+ *
+ * @param server The server.
+ * @param socket The session's socket.
+ */
+static void min_httpd_miss_host_session(
+    struct min_httpd_miss_host_server* server,
+    int socket) {
+    char buf[MIN_HTTPD_MISS_HOST_BUF_LEN];
+    size_t len = 0;
+
+    for (;;) {
+        ssize_t ret = recv(socket, buf + len, sizeof(buf) - 1 - len, 0);
+        if (ret <= 0)
+            return;
+        len += (size_t)ret;
+        buf[len] = '\0';
+
+        char* end;
+        while ((end = strstr(buf, "\r\n\r\n")) != NULL) {
+            char uri[MIN_HTTPD_MISS_HOST_BUF_LEN];
+            if (sscanf(buf, "GET %511s HTTP/1.1", uri) != 1)
+                return;
+
+            if (!min_httpd_miss_cache_lookup(&server->cache, uri))
+                min_httpd_miss_cache_learn(&server->cache, uri);
+            if (send(socket,
+                     min_httpd_miss_response,
+                     min_httpd_miss_response_len,
+                     MSG_NOSIGNAL) != (ssize_t)min_httpd_miss_response_len)
+                return;
+            if (!server->keep_alive)
+                return;
+
+            len -= (size_t)(end + 4 - buf);
+            memmove(buf, end + 4, len + 1);
+        }
+    }
+}
+
+/**
+ * The thread of the server, serving one session after another.
+ *
+ * @param arg The server (::min_httpd_miss_host_server ).
+ * @return void* Always ``NULL``.
+ */
+static void* min_httpd_miss_host_serve(void* arg) {
+    struct min_httpd_miss_host_server* server = arg;
+
+    for (;;) {
+        int socket = accept(server->listener, NULL, NULL);
+        if (socket < 0)
+            return NULL;
+
+        int flag = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+        server->connections++;
+        min_httpd_miss_host_session(server, socket);
+        close(socket);
+    }
+}
+
+/**
+ * Connect to the server.
+ *
+ * @param address The address of the server.
+ * @return int The socket, ``-1`` on failure.
+ */
+static int min_httpd_miss_host_connect(const struct sockaddr_in* address) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    int flag = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    if (connect(sock, (const struct sockaddr*)address, sizeof(*address)) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/**
+ * Send a request and receive its response.
+ *
+ * @param sock The socket.
+ * @param path The path.
+ * @return int The status of the response, ``0`` if the session was closed
+ *             before any response was received, ``-1`` if the response is
+ *             invalid.
+ */
+static int min_httpd_miss_host_request(int sock, const char* path) {
+    char buf[MIN_HTTPD_MISS_HOST_BUF_LEN];
+    int len = snprintf(buf, sizeof(buf), "GET %s HTTP/1.1\r\n\r\n", path);
+    if (send(sock, buf, (size_t)len, MSG_NOSIGNAL) != len)
+        return 0;
+
+    size_t got = 0;
+    char* end = NULL;
+    while (end == NULL) {
+        ssize_t ret = recv(sock, buf + got, sizeof(buf) - 1 - got, 0);
+        if (ret <= 0)
+            return (got == 0) ? 0 : -1;
+        got += (size_t)ret;
+        buf[got] = '\0';
+        end = strstr(buf, "\r\n\r\n");
+    }
+
+    int status = 0;
+    unsigned int content_len = 0;
+    char* field = strstr(buf, "Content-Length: ");
+    if ((sscanf(buf, "HTTP/1.1 %d", &status) != 1) || (field == NULL) ||
+        (sscanf(field, "Content-Length: %u", &content_len) != 1))
+        return -1;
+
+    size_t head = (size_t)(end + 4 - buf);
+    if (head + content_len >= sizeof(buf))
+        return -1;
+    while (got < head + content_len) {
+        ssize_t ret = recv(sock, buf + got, head + content_len - got, 0);
+        if (ret <= 0)
+            return -1;
+        got += (size_t)ret;
+    }
+    buf[got] = '\0';
+    if ((got != head + content_len) || (strcmp(buf + head, "Not Found") != 0))
+        return -1;
+    return status;
+}
+
+/**
+ * Run the benchmark with the sessions closed or kept alive.
+ *
+ * @param keep_alive ``true`` to keep the sessions alive.
+ * @param requests   The number of requests.
+ * @param result     The results.
+ * @return bool ``false`` if the server could not be set up.
+ */
+static bool min_httpd_miss_host_run(bool keep_alive,
+                                    uint32_t requests,
+                                    struct min_httpd_miss_host_result* result) {
+    struct min_httpd_miss_host_server server;
+    memset(&server, 0, sizeof(server));
+    memset(result, 0, sizeof(*result));
+    server.keep_alive = keep_alive;
+    min_httpd_miss_cache_init(&server.cache,
+                              server.learned,
+                              MIN_HTTPD_MISS_HOST_CACHE_SIZE,
+                              NULL);
+
+    server.listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len = sizeof(address);
+    if ((bind(server.listener, (struct sockaddr*)&address, sizeof(address)) !=
+         0) ||
+        (listen(server.listener, 8) != 0) ||
+        (getsockname(server.listener,
+                     (struct sockaddr*)&address,
+                     &address_len) != 0)) {
+        perror("listen");
+        return false;
+    }
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, min_httpd_miss_host_serve, &server);
+
+    const size_t paths =
+        sizeof(min_httpd_miss_host_paths) / sizeof(min_httpd_miss_host_paths[0]);
+    double start = min_httpd_miss_host_now();
+    int sock = min_httpd_miss_host_connect(&address);
+
+    for (uint32_t i = 0; (i < requests) && (sock >= 0); i++) {
+        const char* path = min_httpd_miss_host_paths[i % paths];
+        int status = min_httpd_miss_host_request(sock, path);
+        if (status == 0) {
+            /* The session was closed by the server, like a browser does. */
+            close(sock);
+            result->reconnects++;
+            sock = min_httpd_miss_host_connect(&address);
+            if (sock < 0)
+                break;
+            status = min_httpd_miss_host_request(sock, path);
+        }
+        if (status != 404)
+            result->invalid++;
+    }
+    result->us_per_request =
+        (min_httpd_miss_host_now() - start) * 1e6 / requests;
+    if (sock >= 0)
+        close(sock);
+    else
+        result->invalid++;
+
+    /* Stop the server. */
+    shutdown(server.listener, SHUT_RDWR);
+    pthread_join(thread, NULL);
+    close(server.listener);
+
+    result->connections = server.connections;
+    result->hits = server.cache.hits;
+    result->misses = server.cache.misses;
+
+    printf("     %s: %u connections, %.1f us per request; "
+           "cache: %u hits, %u misses\n",
+           keep_alive ? "kept alive" : "closed    ",
+           (unsigned int)result->connections,
+           result->us_per_request,
+           (unsigned int)result->hits,
+           (unsigned int)result->misses);
+    return true;
+}
+
+/**
+ * Check, if a path is served, like the packed assets of the server.
+ *
+ * @param uri The URI of a request, the query is ignored.
+ * @return bool ``true`` for ``/robots.txt`` and ``/index.html``.
+ */
+static bool min_httpd_miss_host_served(const char* uri) {
+    size_t len = strcspn(uri, "?");
+    return ((len == strlen("/robots.txt")) &&
+            (strncmp(uri, "/robots.txt", len) == 0)) ||
+           ((len == strlen("/index.html")) &&
+            (strncmp(uri, "/index.html", len) == 0));
+}
+
+/**
+ * Verify, that the cache never shadows a served path.
+ *
+ * ``/robots.txt`` is a common probe, ``/index.html`` misses with another
+ * method than ``GET``; neither may be answered from the cache. Paths, that
+ * share a hash, must not be confused either.
+ *
+ * @return bool ``true`` if no served path was shadowed.
+ */
+static bool min_httpd_miss_host_shadow(void) {
+    struct min_httpd_miss_entry learned[MIN_HTTPD_MISS_HOST_CACHE_SIZE];
+    struct min_httpd_miss_cache cache;
+    char longest[MIN_HTTPD_MISS_PATH_LEN + 2];
+    bool ok = true;
+
+    min_httpd_miss_cache_init(&cache,
+                              learned,
+                              MIN_HTTPD_MISS_HOST_CACHE_SIZE,
+                              min_httpd_miss_host_served);
+
+    ok = ok && !min_httpd_miss_cache_lookup(&cache, "/robots.txt");
+    min_httpd_miss_cache_learn(&cache, "/index.html?v=1");
+    ok = ok && !min_httpd_miss_cache_lookup(&cache, "/index.html");
+
+    min_httpd_miss_cache_learn(&cache, "/.env");
+    ok = ok && min_httpd_miss_cache_lookup(&cache, "/.env?v=1");
+    ok = ok && !min_httpd_miss_cache_lookup(&cache, "/.envx");
+
+    /* A learned entry with the hash of a served path, but another path. */
+    learned[0].hash = min_httpd_miss_hash("/index.html");
+    ok = ok && !min_httpd_miss_cache_lookup(&cache, "/index.html");
+
+    /* Longer paths are not learned. */
+    memset(longest, 'a', sizeof(longest) - 1);
+    longest[0] = '/';
+    longest[sizeof(longest) - 1] = '\0';
+    min_httpd_miss_cache_learn(&cache, longest);
+    ok = ok && !min_httpd_miss_cache_lookup(&cache, longest);
+
+    return ok;
+}
+
+/**
+ * Run the benchmark.
+ *
+ * @param requests The number of requests.
+ * @return int ``0`` if all checks passed.
+ */
+static int min_httpd_miss_host_bench(uint32_t requests) {
+    struct min_httpd_miss_host_result closed;
+    struct min_httpd_miss_host_result kept;
+    int failures = 0;
+
+    if (requests == 0) {
+        fprintf(stderr, "REQUESTS must be above 0!\n");
+        return 1;
+    }
+
+    if (!min_httpd_miss_host_run(false, requests, &closed) ||
+        !min_httpd_miss_host_run(true, requests, &kept))
+        return 1;
+
+    host_check(&failures,
+               (closed.invalid == 0) && (kept.invalid == 0),
+               "Responses are intact");
+    host_check(&failures,
+               (kept.connections == 1) &&
+                   (kept.reconnects == 0) &&
+                   (closed.connections == requests),
+               "Sessions are kept alive");
+    host_check(&failures,
+               (kept.misses == min_httpd_miss_host_unknown) &&
+                   (kept.hits + kept.misses == requests),
+               "Missing resources are cached");
+    host_check(&failures,
+               min_httpd_miss_host_shadow(),
+               "Served paths are never shadowed");
+
+    return host_check_summary(failures);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s bench [REQUESTS]\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "bench") == 0) {
+        return min_httpd_miss_host_bench(
+            (argc > 2) ? (uint32_t)atoi(argv[2])
+                       : MIN_HTTPD_MISS_HOST_REQUESTS);
+    }
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,861 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Benchmark the offloaded routes of the ``min_httpd`` component on a Linux
+ * host.
+ *
+ * The engine is compiled unmodified. A single thread serves the requests,
+ * just like ``esp_http_server``'s task, and hands the requests of offloaded
+ * routes to a pool of worker threads. Responses of the workers are sent by
+ * the server's thread, just like ``min_httpd_queue_work()``:
+ *
+ *   - ``min_httpd_offload_host bench [WORKERS [REQUESTS]]`` serves fast
+ *     requests (``/fast``) of several clients, while other clients request a
+ *     slow route (``/slow``, sleeping like a write to the NVS). Every fast
+ *     client sends ``REQUESTS`` requests. The benchmark runs with the slow
+ *     route inline and offloaded to ``WORKERS`` workers and reports the
+ *     p50/p99 latency of both routes. The latencies are not checked, as they
+ *     depend on the host; only the integrity of the responses is.
+ *
+ * Meanwhile, another client closes its sessions before the slow responses
+ * are sent, so their sockets are reused by new sessions; these must not
+ * receive the responses of the closed sessions. Finally, a client pipelines a
+ * fast request behind a slow one, which must not be answered before.
+ *
+ * @file   min_httpd_offload_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* The engine of the offloaded routes. */
+#include "min_httpd_offload_engine.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The default number of workers.
+ */
+#define MIN_HTTPD_OFFLOAD_HOST_WORKERS 2
+
+/**
+ * The default number of requests of every fast client.
+ */
+#define MIN_HTTPD_OFFLOAD_HOST_REQUESTS 500
+
+/**
+ * The number of requests of every fast client, that are not measured, while
+ * the other clients connect.
+ */
+#define MIN_HTTPD_OFFLOAD_HOST_WARMUP 20
+
+/**
+ * The maximum number of workers.
+ */
+#define MIN_HTTPD_OFFLOAD_HOST_MAX_WORKERS 8
+
+/**
+ * The number of clients of the fast route.
+ */
+#define MIN_HTTPD_OFFLOAD_HOST_FAST_CLIENTS 4
+
+/**
+ * The number of clients of the slow route.
+ */
+#define MIN_HTTPD_OFFLOAD_HOST_SLOW_CLIENTS 2
+
+/**
+ * The maximum number of sessions, just like ``max_open_sockets``.
+ */
+#define MIN_HTTPD_OFFLOAD_HOST_SESSIONS 8
+
+/**
+ * The time, that the fast route takes, given in microseconds.
+ */
+#define MIN_HTTPD_OFFLOAD_HOST_FAST_US 50
+
+/**
+ * The time, that the slow route takes, given in microseconds.
+ */
+#define MIN_HTTPD_OFFLOAD_HOST_SLOW_US 5000
+
+/**
+ * The length of the workers' queue, just like
+ * ``MIN_HTTPD_OFFLOAD_QUEUE_LEN``.
+ */
+#define MIN_HTTPD_OFFLOAD_HOST_QUEUE_LEN 4
+
+/**
+ * The maximum length of a request or response.
+ */
+#define MIN_HTTPD_OFFLOAD_HOST_BUF_LEN 512
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A job of the slow route.
+ */
+struct min_httpd_offload_host_job {
+    struct min_httpd_offload_host_job* next;
+    char response[MIN_HTTPD_OFFLOAD_HOST_BUF_LEN];
+    size_t len;
+};
+
+/**
+ * The server, its sessions and its workers.
+ */
+struct min_httpd_offload_host_server {
+    int listener;
+    int completed[2];  // pipe of finished jobs, like ``httpd_queue_work()``
+    volatile bool stop;
+    size_t workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct min_httpd_offload_host_job* head;  // the workers' queue
+    struct min_httpd_offload_host_job* tail;
+
+    struct min_httpd_offload_entry entries[MIN_HTTPD_OFFLOAD_HOST_MAX_WORKERS +
+                                           MIN_HTTPD_OFFLOAD_HOST_QUEUE_LEN];
+    struct min_httpd_offload_pending pending;
+};
+
+/**
+ * A client, measuring the latency of its requests.
+ */
+struct min_httpd_offload_host_client {
+    const struct sockaddr_in* address;
+    const char* path;  // ``/fast`` or ``/slow``
+    uint32_t requests;  // ``0`` to send requests until ``stop`` is set
+    bool churn;  // close every session before the slow response
+    volatile bool* stop;
+    pthread_t thread;
+
+    double* latencies;
+    uint32_t capacity;  // the number of entries of ``latencies``
+    uint32_t count;
+    uint32_t invalid;
+    uint32_t rejected;
+};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get the current time.
+ *
+ * @return double The time in seconds.
+ */
+static double min_httpd_offload_host_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Build a response.
+ *
+ * Responses of the workers close the session, like ``min_httpd_job_respond()``,
+ * all others keep it alive, like ``httpd_resp_send()``.
+ *
+ * @param buf       The buffer of ::MIN_HTTPD_OFFLOAD_HOST_BUF_LEN bytes.
+ * @param status    The status.
+ * @param body      The body.
+ * @param offloaded ``true`` for a response of a worker.
+ * @return size_t The length of the response.
+ */
+static size_t min_httpd_offload_host_response(char* buf,
+                                              const char* status,
+                                              const char* body,
+                                              bool offloaded) {
+    size_t len = strlen(body);
+    size_t head;
+    if (offloaded) {
+        head = min_httpd_offload_response_head(buf,
+                                               MIN_HTTPD_OFFLOAD_HOST_BUF_LEN,
+                                               status,
+                                               "text/plain",
+                                               len);
+    } else {
+        head = (size_t)snprintf(buf,
+                                MIN_HTTPD_OFFLOAD_HOST_BUF_LEN,
+                                "HTTP/1.1 %s\r\n"
+                                "Content-Type: text/plain\r\n"
+                                "Content-Length: %u\r\n"
+                                "\r\n",
+                                status,
+                                (unsigned int)len);
+    }
+    memcpy(buf + head, body, len);
+    return head + len;
+}
+
+/**
+ * Send a response completely, like ``httpd_socket_send()``.
+ *
+ * @param socket The socket.
+ * @param buf    The response.
+ * @param len    The length of the response.
+ */
+static void min_httpd_offload_host_send(int socket,
+                                        const char* buf,
+                                        size_t len) {
+    while (len > 0) {
+        ssize_t ret = send(socket, buf, len, MSG_NOSIGNAL);
+        if (ret <= 0)
+            return;
+        buf += ret;
+        len -= (size_t)ret;
+    }
+}
+
+/**
+ * The thread of a worker, executing the slow route.
+ *
+ * @param arg The server (::min_httpd_offload_host_server ).
+ * @return void* Always ``NULL``.
+ */
+static void* min_httpd_offload_host_worker(void* arg) {
+    struct min_httpd_offload_host_server* server = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&server->lock);
+        while ((server->head == NULL) && !server->stop)
+            pthread_cond_wait(&server->cond, &server->lock);
+        struct min_httpd_offload_host_job* job = server->head;
+        if (job != NULL) {
+            server->head = job->next;
+            if (server->head == NULL)
+                server->tail = NULL;
+        }
+        pthread_mutex_unlock(&server->lock);
+        if (job == NULL)
+            return NULL;
+
+        usleep(MIN_HTTPD_OFFLOAD_HOST_SLOW_US);
+        job->len = min_httpd_offload_host_response(job->response,
+                                                   "200 OK",
+                                                   "slow",
+                                                   true);
+        if (write(server->completed[1], &job, sizeof(job)) != sizeof(job))
+            free(job);
+    }
+}
+
+/**
+ * Process a request of a session.
+ *
+ * Requests of a session with a pending job are refused, like
+ * ``min_httpd_offload_admit()``.
+ *
+ * @param server The server.
+ * @param socket The session's socket.
+ * @param path   The requested path.
+ * @return bool ``false`` if the session must be closed.
+ */
+static bool min_httpd_offload_host_dispatch(
+    struct min_httpd_offload_host_server* server,
+    int socket,
+    const char* path) {
+    char buf[MIN_HTTPD_OFFLOAD_HOST_BUF_LEN];
+
+    if (min_httpd_offload_pending_busy(&server->pending, socket))
+        return false;
+
+    if (strncmp(path, "/fast ", 6) == 0) {
+        double end = min_httpd_offload_host_now() +
+                     MIN_HTTPD_OFFLOAD_HOST_FAST_US / 1e6;
+        while (min_httpd_offload_host_now() < end) {
+        }
+        size_t len =
+            min_httpd_offload_host_response(buf, "200 OK", "fast", false);
+        min_httpd_offload_host_send(socket, buf, len);
+        return true;
+    }
+
+    if (server->workers == 0) {
+        usleep(MIN_HTTPD_OFFLOAD_HOST_SLOW_US);
+        size_t len =
+            min_httpd_offload_host_response(buf, "200 OK", "slow", false);
+        min_httpd_offload_host_send(socket, buf, len);
+        return true;
+    }
+
+    struct min_httpd_offload_host_job* job = calloc(1, sizeof(*job));
+    if (!min_httpd_offload_pending_add(&server->pending, job, socket)) {
+        free(job);
+        size_t len = min_httpd_offload_host_response(buf,
+                                                     "503 Service Unavailable",
+                                                     "",
+                                                     false);
+        min_httpd_offload_host_send(socket, buf, len);
+        return true;
+    }
+
+    pthread_mutex_lock(&server->lock);
+    if (server->tail != NULL)
+        server->tail->next = job;
+    else
+        server->head = job;
+    server->tail = job;
+    pthread_cond_signal(&server->cond);
+    pthread_mutex_unlock(&server->lock);
+    return true;
+}
+
+/**
+ * The thread of the server, serving all sessions.
+ *
+ * @param arg The server (::min_httpd_offload_host_server ).
+ * @return void* Always ``NULL``.
+ */
+static void* min_httpd_offload_host_serve(void* arg) {
+    struct min_httpd_offload_host_server* server = arg;
+    int sessions[MIN_HTTPD_OFFLOAD_HOST_SESSIONS];
+    char bufs[MIN_HTTPD_OFFLOAD_HOST_SESSIONS][MIN_HTTPD_OFFLOAD_HOST_BUF_LEN];
+    size_t lens[MIN_HTTPD_OFFLOAD_HOST_SESSIONS];
+    struct pollfd fds[MIN_HTTPD_OFFLOAD_HOST_SESSIONS + 2];
+
+    for (size_t i = 0; i < MIN_HTTPD_OFFLOAD_HOST_SESSIONS; i++)
+        sessions[i] = -1;
+
+    while (!server->stop) {
+        fds[0].fd = server->listener;
+        fds[0].events = POLLIN;
+        fds[1].fd = server->completed[0];
+        fds[1].events = POLLIN;
+        for (size_t i = 0; i < MIN_HTTPD_OFFLOAD_HOST_SESSIONS; i++) {
+            fds[i + 2].fd = sessions[i];
+            fds[i + 2].events = POLLIN;
+        }
+        if (poll(fds, MIN_HTTPD_OFFLOAD_HOST_SESSIONS + 2, 100) <= 0)
+            continue;
+
+        /* Finished jobs, like the work queued with the server's task. */
+        if (fds[1].revents & POLLIN) {
+            struct min_httpd_offload_host_job* job;
+            if (read(server->completed[0], &job, sizeof(job)) ==
+                sizeof(job)) {
+                int socket =
+                    min_httpd_offload_pending_remove(&server->pending, job);
+                /* The response closes the session. */
+                for (size_t i = 0;
+                     (socket >= 0) && (i < MIN_HTTPD_OFFLOAD_HOST_SESSIONS);
+                     i++) {
+                    if (sessions[i] != socket)
+                        continue;
+                    min_httpd_offload_host_send(socket,
+                                                job->response,
+                                                job->len);
+                    close(socket);
+                    sessions[i] = -1;
+                }
+                free(job);
+            }
+        }
+
+        for (size_t i = 0; i < MIN_HTTPD_OFFLOAD_HOST_SESSIONS; i++) {
+            if ((sessions[i] < 0) || !(fds[i + 2].revents & (POLLIN | POLLHUP)))
+                continue;
+
+            ssize_t ret = recv(sessions[i],
+                               bufs[i] + lens[i],
+                               MIN_HTTPD_OFFLOAD_HOST_BUF_LEN - 1 - lens[i],
+                               0);
+            if (ret <= 0) {
+                min_httpd_offload_pending_orphan(&server->pending, sessions[i]);
+                close(sessions[i]);
+                sessions[i] = -1;
+                continue;
+            }
+            lens[i] += (size_t)ret;
+            bufs[i][lens[i]] = '\0';
+
+            /* Pipelined requests are processed right away, like
+             * ``esp_http_server`` does, as the socket remains readable.
+             */
+            char* end;
+            while ((sessions[i] >= 0) &&
+                   ((end = strstr(bufs[i], "\r\n\r\n")) != NULL)) {
+                if (!min_httpd_offload_host_dispatch(server,
+                                                     sessions[i],
+                                                     bufs[i] + 4)) {
+                    min_httpd_offload_pending_orphan(&server->pending,
+                                                     sessions[i]);
+                    close(sessions[i]);
+                    sessions[i] = -1;
+                    break;
+                }
+                lens[i] -= (size_t)(end + 4 - bufs[i]);
+                memmove(bufs[i], end + 4, lens[i] + 1);
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int socket = accept(server->listener, NULL, NULL);
+            size_t i = 0;
+            while ((i < MIN_HTTPD_OFFLOAD_HOST_SESSIONS) && (sessions[i] >= 0))
+                i++;
+            if (i == MIN_HTTPD_OFFLOAD_HOST_SESSIONS) {
+                close(socket);
+            } else if (socket >= 0) {
+                int flag = 1;
+                setsockopt(socket,
+                           IPPROTO_TCP,
+                           TCP_NODELAY,
+                           &flag,
+                           sizeof(flag));
+                sessions[i] = socket;
+                lens[i] = 0;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < MIN_HTTPD_OFFLOAD_HOST_SESSIONS; i++) {
+        if (sessions[i] >= 0)
+            close(sessions[i]);
+    }
+    return NULL;
+}
+
+/**
+ * Connect to the server.
+ *
+ * @param address The address of the server.
+ * @return int The socket, ``-1`` on failure.
+ */
+static int min_httpd_offload_host_connect(const struct sockaddr_in* address) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    int flag = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    if (connect(sock, (const struct sockaddr*)address, sizeof(*address)) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/**
+ * Send a request and receive its response.
+ *
+ * @param sock   The socket.
+ * @param path   The path.
+ * @param body   The body of the response, of
+ *               ::MIN_HTTPD_OFFLOAD_HOST_BUF_LEN bytes.
+ * @param closed Set, if the response closes the session.
+ * @return int The status of the response, ``-1`` on failure.
+ */
+static int min_httpd_offload_host_request(int sock,
+                                          const char* path,
+                                          char* body,
+                                          bool* closed) {
+    char buf[MIN_HTTPD_OFFLOAD_HOST_BUF_LEN];
+    int len = snprintf(buf, sizeof(buf), "GET %s HTTP/1.1\r\n\r\n", path);
+    if (send(sock, buf, (size_t)len, MSG_NOSIGNAL) != len)
+        return -1;
+
+    size_t got = 0;
+    char* end = NULL;
+    while (end == NULL) {
+        ssize_t ret = recv(sock, buf + got, sizeof(buf) - 1 - got, 0);
+        if (ret <= 0)
+            return -1;
+        got += (size_t)ret;
+        buf[got] = '\0';
+        end = strstr(buf, "\r\n\r\n");
+    }
+
+    int status = 0;
+    unsigned int content_len = 0;
+    char* field = strstr(buf, "Content-Length: ");
+    if ((sscanf(buf, "HTTP/1.1 %d", &status) != 1) || (field == NULL) ||
+        (sscanf(field, "Content-Length: %u", &content_len) != 1))
+        return -1;
+
+    size_t head = (size_t)(end + 4 - buf);
+    if (head + content_len >= sizeof(buf))
+        return -1;
+    while (got < head + content_len) {
+        ssize_t ret = recv(sock, buf + got, head + content_len - got, 0);
+        if (ret <= 0)
+            return -1;
+        got += (size_t)ret;
+    }
+    // A response of another session would follow
+    if (got != head + content_len)
+        return -1;
+
+    memcpy(body, buf + head, content_len);
+    body[content_len] = '\0';
+    buf[head] = '\0';
+    *closed = strstr(buf, "Connection: close\r\n") != NULL;
+    return status;
+}
+
+/**
+ * The thread of a client.
+ *
+ * @param arg The client (::min_httpd_offload_host_client ).
+ * @return void* Always ``NULL``.
+ */
+static void* min_httpd_offload_host_client_run(void* arg) {
+    struct min_httpd_offload_host_client* client = arg;
+    char body[MIN_HTTPD_OFFLOAD_HOST_BUF_LEN];
+    const char* expected = client->path + 1;
+    uint32_t warmup =
+        (client->requests > 0) ? MIN_HTTPD_OFFLOAD_HOST_WARMUP : 0;
+    int sock = -1;
+
+    while ((client->count < client->capacity) &&
+           ((client->requests > 0) || !*client->stop)) {
+        if (client->churn) {
+            /* The slow response arrives after the session is closed. */
+            int gone = min_httpd_offload_host_connect(client->address);
+            const char* request = "GET /slow HTTP/1.1\r\n\r\n";
+            send(gone, request, strlen(request), MSG_NOSIGNAL);
+            usleep(1000);
+            close(gone);
+        }
+        if (sock < 0)
+            sock = min_httpd_offload_host_connect(client->address);
+
+        double start = min_httpd_offload_host_now();
+        bool closed = false;
+        int status =
+            min_httpd_offload_host_request(sock, client->path, body, &closed);
+        double latency = min_httpd_offload_host_now() - start;
+
+        if (status == 503) {
+            client->rejected++;
+        } else if ((status != 200) || (strcmp(body, expected) != 0)) {
+            client->invalid++;
+            close(sock);
+            sock = -1;
+        } else if (warmup > 0) {
+            warmup--;
+        } else {
+            client->latencies[client->count++] = latency;
+        }
+
+        if ((client->churn || closed) && (sock >= 0)) {
+            close(sock);
+            sock = -1;
+        }
+    }
+
+    if (sock >= 0)
+        close(sock);
+    return NULL;
+}
+
+/**
+ * Pipeline a fast request behind a slow one and receive the responses, until
+ * the server closes the session or does not respond anymore.
+ *
+ * @param address The address of the server.
+ * @return bool ``true`` if the fast response did not overtake the slow one.
+ */
+static bool min_httpd_offload_host_pipeline(const struct sockaddr_in* address) {
+    int sock = min_httpd_offload_host_connect(address);
+    if (sock < 0)
+        return false;
+
+    struct timeval timeout = {.tv_sec = 0, .tv_usec = 200000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    const char* requests =
+        "GET /slow HTTP/1.1\r\n\r\n"
+        "GET /fast HTTP/1.1\r\n\r\n";
+    send(sock, requests, strlen(requests), MSG_NOSIGNAL);
+
+    char buf[MIN_HTTPD_OFFLOAD_HOST_BUF_LEN];
+    size_t got = 0;
+    for (;;) {
+        ssize_t ret = recv(sock, buf + got, sizeof(buf) - 1 - got, 0);
+        if (ret <= 0)
+            break;
+        got += (size_t)ret;
+    }
+    buf[got] = '\0';
+    close(sock);
+
+    const char* fast = strstr(buf, "\r\n\r\nfast");
+    const char* slow = strstr(buf, "\r\n\r\nslow");
+    return (fast == NULL) || ((slow != NULL) && (slow < fast));
+}
+
+/**
+ * Compare latencies for ``qsort()``.
+ */
+static int min_httpd_offload_host_compare(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Get a percentile of sorted latencies.
+ *
+ * @param latencies The sorted latencies.
+ * @param count     The number of latencies.
+ * @param p         The percentile, e.g. ``0.99``.
+ * @return double The latency in milliseconds.
+ */
+static double min_httpd_offload_host_percentile(const double* latencies,
+                                                size_t count,
+                                                double p) {
+    if (count == 0)
+        return 0.0;
+    size_t index = (size_t)(p * (count - 1) + 0.5);
+    return latencies[index] * 1e3;
+}
+
+/**
+ * The results of a run.
+ */
+struct min_httpd_offload_host_result {
+    double fast_p50;
+    double fast_p99;
+    double slow_p50;
+    double slow_p99;
+    uint32_t invalid;
+    uint32_t orphaned;
+    uint32_t churned;
+    bool reordered;
+};
+
+/**
+ * Run the benchmark with the slow route inline or offloaded.
+ *
+ * @param workers  The number of workers, ``0`` to run the slow route inline.
+ * @param requests The number of requests of every fast client.
+ * @param result   The results.
+ * @return bool ``false`` if the server could not be set up.
+ */
+static bool min_httpd_offload_host_run(
+    size_t workers,
+    uint32_t requests,
+    struct min_httpd_offload_host_result* result) {
+    struct min_httpd_offload_host_server server;
+    memset(&server, 0, sizeof(server));
+    memset(result, 0, sizeof(*result));
+    server.workers = workers;
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.cond, NULL);
+    min_httpd_offload_pending_init(&server.pending,
+                                   server.entries,
+                                   workers + MIN_HTTPD_OFFLOAD_HOST_QUEUE_LEN);
+
+    server.listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len = sizeof(address);
+    if ((bind(server.listener, (struct sockaddr*)&address, sizeof(address)) !=
+         0) ||
+        (listen(server.listener, MIN_HTTPD_OFFLOAD_HOST_SESSIONS) != 0) ||
+        (getsockname(server.listener,
+                     (struct sockaddr*)&address,
+                     &address_len) != 0) ||
+        (pipe(server.completed) != 0)) {
+        perror("listen");
+        return false;
+    }
+
+    pthread_t threads[MIN_HTTPD_OFFLOAD_HOST_MAX_WORKERS + 1];
+    pthread_create(&threads[0], NULL, min_httpd_offload_host_serve, &server);
+    for (size_t i = 0; i < workers; i++) {
+        pthread_create(&threads[i + 1],
+                       NULL,
+                       min_httpd_offload_host_worker,
+                       &server);
+    }
+
+    /* Fast clients, slow clients and the churning client. */
+    enum { CLIENTS = MIN_HTTPD_OFFLOAD_HOST_FAST_CLIENTS +
+                     MIN_HTTPD_OFFLOAD_HOST_SLOW_CLIENTS + 1 };
+    struct min_httpd_offload_host_client clients[CLIENTS];
+    volatile bool stop = false;
+    const uint32_t slow_max = 100000;
+    memset(clients, 0, sizeof(clients));
+
+    for (size_t i = 0; i < CLIENTS; i++) {
+        bool fast = i < MIN_HTTPD_OFFLOAD_HOST_FAST_CLIENTS;
+        clients[i].address = &address;
+        clients[i].path = fast ? "/fast" : "/slow";
+        clients[i].requests = fast ? requests : 0;
+        clients[i].churn = i == CLIENTS - 1;
+        clients[i].stop = &stop;
+        if (clients[i].churn)
+            clients[i].path = "/fast";
+        clients[i].capacity = fast ? requests : slow_max;
+        clients[i].latencies = malloc(clients[i].capacity * sizeof(double));
+    }
+    for (size_t i = 0; i < CLIENTS; i++) {
+        pthread_create(&clients[i].thread,
+                       NULL,
+                       min_httpd_offload_host_client_run,
+                       &clients[i]);
+    }
+
+    for (size_t i = 0; i < MIN_HTTPD_OFFLOAD_HOST_FAST_CLIENTS; i++)
+        pthread_join(clients[i].thread, NULL);
+    stop = true;
+    for (size_t i = MIN_HTTPD_OFFLOAD_HOST_FAST_CLIENTS; i < CLIENTS; i++)
+        pthread_join(clients[i].thread, NULL);
+    result->reordered = !min_httpd_offload_host_pipeline(&address);
+
+    /* Stop the workers, then the server, which discards remaining jobs. */
+    pthread_mutex_lock(&server.lock);
+    server.stop = true;
+    pthread_cond_broadcast(&server.cond);
+    pthread_mutex_unlock(&server.lock);
+    for (size_t i = 0; i < workers; i++)
+        pthread_join(threads[i + 1], NULL);
+    pthread_join(threads[0], NULL);
+
+    /* Evaluate the latencies. */
+    size_t fast_count = 0;
+    size_t slow_count = 0;
+    double* fast = malloc(MIN_HTTPD_OFFLOAD_HOST_FAST_CLIENTS * requests *
+                          sizeof(double));
+    double* slow = malloc((size_t)MIN_HTTPD_OFFLOAD_HOST_SLOW_CLIENTS *
+                          slow_max * sizeof(double));
+    for (size_t i = 0; i < CLIENTS; i++) {
+        result->invalid += clients[i].invalid;
+        if (clients[i].churn) {
+            result->churned = clients[i].count;
+        } else if (i < MIN_HTTPD_OFFLOAD_HOST_FAST_CLIENTS) {
+            memcpy(fast + fast_count,
+                   clients[i].latencies,
+                   clients[i].count * sizeof(double));
+            fast_count += clients[i].count;
+        } else {
+            memcpy(slow + slow_count,
+                   clients[i].latencies,
+                   clients[i].count * sizeof(double));
+            slow_count += clients[i].count;
+        }
+        free(clients[i].latencies);
+    }
+    qsort(fast, fast_count, sizeof(double), min_httpd_offload_host_compare);
+    qsort(slow, slow_count, sizeof(double), min_httpd_offload_host_compare);
+
+    result->fast_p50 =
+        min_httpd_offload_host_percentile(fast, fast_count, 0.5);
+    result->fast_p99 =
+        min_httpd_offload_host_percentile(fast, fast_count, 0.99);
+    result->slow_p50 =
+        min_httpd_offload_host_percentile(slow, slow_count, 0.5);
+    result->slow_p99 =
+        min_httpd_offload_host_percentile(slow, slow_count, 0.99);
+    result->orphaned = server.pending.orphaned;
+    if (fast_count != MIN_HTTPD_OFFLOAD_HOST_FAST_CLIENTS * requests)
+        result->invalid++;
+
+    printf("     %s: fast p50 %.2f ms, p99 %.2f ms (%zu); "
+           "slow p50 %.2f ms, p99 %.2f ms (%zu)\n",
+           (workers == 0) ? "inline   " : "offloaded",
+           result->fast_p50,
+           result->fast_p99,
+           fast_count,
+           result->slow_p50,
+           result->slow_p99,
+           slow_count);
+
+    free(fast);
+    free(slow);
+    close(server.completed[0]);
+    close(server.completed[1]);
+    close(server.listener);
+    pthread_mutex_destroy(&server.lock);
+    pthread_cond_destroy(&server.cond);
+    return true;
+}
+
+/**
+ * Run the benchmark.
+ *
+ * @param workers  The number of workers of the offloaded run.
+ * @param requests The number of requests of every fast client.
+ * @return int ``0`` if all checks passed.
+ */
+static int min_httpd_offload_host_bench(size_t workers, uint32_t requests) {
+    struct min_httpd_offload_host_result inline_result;
+    struct min_httpd_offload_host_result offloaded;
+    int failures = 0;
+
+    if ((workers == 0) || (workers > MIN_HTTPD_OFFLOAD_HOST_MAX_WORKERS) ||
+        (requests == 0)) {
+        fprintf(stderr,
+                "WORKERS must be between 1 and %d, REQUESTS above 0!\n",
+                MIN_HTTPD_OFFLOAD_HOST_MAX_WORKERS);
+        return 1;
+    }
+
+    if (!min_httpd_offload_host_run(0, requests, &inline_result) ||
+        !min_httpd_offload_host_run(workers, requests, &offloaded))
+        return 1;
+
+    /* The latencies depend on the host's scheduler, so they are reported but
+     * not checked.
+     */
+    printf("     fast p99 inline / offloaded: %.1fx\n",
+           (offloaded.fast_p99 > 0)
+               ? inline_result.fast_p99 / offloaded.fast_p99
+               : 0.0);
+
+    host_check(&failures,
+               (inline_result.invalid == 0) && (offloaded.invalid == 0),
+               "Responses are intact");
+    host_check(&failures,
+               (offloaded.orphaned > 0) && (offloaded.churned > 0),
+               "Responses of closed sessions are discarded");
+    host_check(&failures,
+               !inline_result.reordered && !offloaded.reordered,
+               "Pipelined requests are not reordered");
+
+    return host_check_summary(failures);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s bench [WORKERS [REQUESTS]]\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "bench") == 0) {
+        return min_httpd_offload_host_bench(
+            (argc > 2) ? (size_t)atoi(argv[2])
+                       : MIN_HTTPD_OFFLOAD_HOST_WORKERS,
+            (argc > 3) ? (uint32_t)atoi(argv[3])
+                       : MIN_HTTPD_OFFLOAD_HOST_REQUESTS);
+    }
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
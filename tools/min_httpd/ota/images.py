@@ -0,0 +1,117 @@
+# SPDX-FileCopyrightText: 2022 Mischback
+# SPDX-License-Identifier: MIT
+# SPDX-FileType: SOURCE
+"""Generate two synthetic firmware images, the second one an update of the first.
+
+The images resemble an application: functions of 24 bit instructions, each
+with a literal pool of absolute addresses of other functions, followed by
+strings. The update inserts functions and modifies others, so every address
+after the first insertion is shifted, like after a rebuild with a small
+change.
+
+The images are deterministic and start with ``0xE9``, like the images of
+**ESP-IDF**.
+"""
+
+# Python imports
+import random
+import struct
+import sys
+
+# The address of the first function.
+TEXT_ADDRESS = 0x400D0020
+
+# The number of functions and their number of instructions.
+FUNCTIONS = 2600
+INSTRUCTIONS = (40, 160)
+
+# The number of addresses in a function's literal pool.
+LITERALS = 4
+
+WORDS = (
+    "wifi",
+    "connect",
+    "failed",
+    "httpd",
+    "session",
+    "partition",
+    "update",
+    "stream",
+    "buffer",
+    "timeout",
+    "error",
+    "state",
+)
+
+
+def function(rng, vocabulary):
+    """Generate the body of a function, as a list of instructions."""
+    count = rng.randint(*INSTRUCTIONS)
+    return [rng.choice(vocabulary) for _ in range(count)]
+
+
+def link(functions, strings):
+    """Link the functions and strings into an image."""
+    addresses = []
+    address = TEXT_ADDRESS
+    for _, body in functions:
+        addresses.append(address)
+        address += 4 * LITERALS + 3 * len(body)
+
+    image = bytearray(b"\xe9\x04\x02\x20")
+    image += struct.pack("<I", TEXT_ADDRESS)
+    image += bytes(24)
+    for callees, body in functions:
+        for callee in callees:
+            image += struct.pack("<I", addresses[callee % len(addresses)])
+        for instruction in body:
+            image += instruction
+    image += strings
+    image += bytes(-len(image) % 16)
+    return bytes(image)
+
+
+def generate():
+    """Generate the base and the update."""
+    rng = random.Random(42)
+    vocabulary = [bytes(rng.randrange(256) for _ in range(3)) for _ in range(96)]
+
+    def new_function():
+        callees = [rng.randrange(1 << 16) for _ in range(LITERALS)]
+        return (callees, function(rng, vocabulary))
+
+    functions = [new_function() for _ in range(FUNCTIONS)]
+    strings = "\0".join(
+        " ".join(rng.choice(WORDS) for _ in range(rng.randint(2, 6)))
+        for _ in range(3000)
+    ).encode()
+    base = link(functions, strings)
+
+    # The update: inserted functions, modified functions and strings
+    updated = list(functions)
+    for position in (FUNCTIONS // 3, FUNCTIONS // 2, FUNCTIONS * 4 // 5):
+        updated.insert(position, new_function())
+    for index in rng.sample(range(len(updated)), 30):
+        callees, body = updated[index]
+        body = list(body)
+        for _ in range(3):
+            body[rng.randrange(len(body))] = rng.choice(vocabulary)
+        updated[index] = (callees, body)
+    update = link(updated, strings.replace(b"failed", b"FAILED"))
+
+    return base, update
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3:
+        print("Usage: images.py BASE UPDATE")
+        sys.exit(1)
+
+    base, update = generate()
+    with open(sys.argv[1], "wb") as f_out:
+        f_out.write(base)
+    with open(sys.argv[2], "wb") as f_out:
+        f_out.write(update)
+
+    # return "0" = SUCCESS
+    sys.exit(0)
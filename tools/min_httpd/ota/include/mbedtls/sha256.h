@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Host replacement of **mbedtls**' ``mbedtls/sha256.h`` for the firmware
+ * upload.
+ *
+ * Only the functions of **mbedtls** 2.x, that are used by
+ * ``min_httpd_ota_hash.c``, are provided. They are implemented with
+ * **OpenSSL**'s ``libcrypto``, so the digests are still computed by a library,
+ * that is independent of the engine.
+ *
+ * @file   sha256.h
+ */
+
+#ifndef TOOLS_MIN_HTTPD_OTA_INCLUDE_MBEDTLS_SHA256_H_
+#define TOOLS_MIN_HTTPD_OTA_INCLUDE_MBEDTLS_SHA256_H_
+
+/* C's standard libraries. */
+#include <stddef.h>
+#include <string.h>
+
+/* OpenSSL's SHA-256 (see ``OPENSSL_API_COMPAT`` in ``CMakeLists.txt``). */
+#include <openssl/sha.h>
+
+typedef SHA256_CTX mbedtls_sha256_context;
+
+static inline void mbedtls_sha256_init(mbedtls_sha256_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+static inline void mbedtls_sha256_free(mbedtls_sha256_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+static inline int mbedtls_sha256_starts_ret(mbedtls_sha256_context* ctx,
+                                            int is224) {
+    return (is224 == 0) && (SHA256_Init(ctx) == 1) ? 0 : -1;
+}
+
+static inline int mbedtls_sha256_update_ret(mbedtls_sha256_context* ctx,
+                                            const unsigned char* input,
+                                            size_t ilen) {
+    return (SHA256_Update(ctx, input, ilen) == 1) ? 0 : -1;
+}
+
+static inline int mbedtls_sha256_finish_ret(mbedtls_sha256_context* ctx,
+                                            unsigned char output[32]) {
+    return (SHA256_Final(output, ctx) == 1) ? 0 : -1;
+}
+
+#endif  // TOOLS_MIN_HTTPD_OTA_INCLUDE_MBEDTLS_SHA256_H_
@@ -0,0 +1,1119 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Verify and benchmark the firmware upload of the ``min_httpd`` component on
+ * a Linux host.
+ *
+ * The engine is compiled unmodified. The upload is modelled after
+ * min_httpd_ota.c : the receiving thread (like the server's task) receives
+ * the payload from a TCP session, decodes the firmware into buffers and
+ * hashes it, a writer thread writes the buffers to a file, that stands in for
+ * the OTA partition. The buffers are passed with two queues of ``free`` and
+ * ``full`` buffers.
+ *
+ *   - ``min_httpd_ota_host bench [NET_KBS [FLASH_KBS]]`` verifies SHA-256
+ *     with the test vectors of FIPS 180-2, the parsing of digests and the
+ *     check of the shared token. Then a firmware is uploaded with a client,
+ *     that is limited to ``NET_KBS`` kB/s (like the Wi-Fi link), to a
+ *     partition, that erases every sector before it is written and writes
+ *     ``FLASH_KBS`` kB/s (like ``esp_ota_write()``). The upload is run with one buffer (receiving and
+ *     writing alternate) and with more buffers (receiving and writing
+ *     overlap), and the achieved throughput is reported. The overlap is
+ *     checked by counting the buffers, that are filled while the writer
+ *     writes another one; with one buffer, there must be none. Last, a
+ *     firmware, that does not match its digest, must be rejected.
+ *
+ *     The payloads, that were generated by ``tools/packer/firmware.py`` from
+ *     two synthetic images (see ``images.py``), must be decoded in chunks of
+ *     any size, invalid payloads and a delta against another base must be
+ *     rejected. The update is uploaded as plain firmware, compressed and as
+ *     delta with a slower client (::MIN_HTTPD_OTA_HOST_SLOW_KBS ), and the
+ *     achieved time is reported. The times depend on the host, so only the
+ *     length of the payloads is checked.
+ *   - ``min_httpd_ota_host verify PAYLOAD FIRMWARE [BASE]`` decodes a
+ *     payload, e.g. of a real firmware, and compares it with the firmware.
+ *
+ * @file   min_httpd_ota_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* The engine of the firmware upload. */
+#include "min_httpd_ota_engine.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The default throughput of the client, given in kB/s.
+ */
+#define MIN_HTTPD_OTA_HOST_NET_KBS 400
+
+/**
+ * The throughput of the client, that uploads the payloads, given in kB/s.
+ *
+ * This is a slow Wi-Fi link, where the payloads make a difference; with
+ * ``MIN_HTTPD_OTA_HOST_NET_KBS``, writing the flash limits the throughput.
+ */
+#define MIN_HTTPD_OTA_HOST_SLOW_KBS 150
+
+/**
+ * The default throughput of writing the partition, given in kB/s.
+ */
+#define MIN_HTTPD_OTA_HOST_FLASH_KBS 800
+
+/**
+ * The time to erase a sector of the partition, given in microseconds.
+ */
+#define MIN_HTTPD_OTA_HOST_ERASE_US 8000
+
+/**
+ * The size of a sector of the partition.
+ */
+#define MIN_HTTPD_OTA_HOST_SECTOR_LEN 4096
+
+/**
+ * The length of the firmware, not a multiple of the buffers.
+ */
+#define MIN_HTTPD_OTA_HOST_FIRMWARE_LEN (512 * 1024 + 1234)
+
+/**
+ * The length of a buffer, just like ``MIN_HTTPD_OTA_BUFFER_LEN``.
+ */
+#define MIN_HTTPD_OTA_HOST_BUFFER_LEN 4096
+
+/**
+ * The maximum number of buffers, that is benchmarked.
+ */
+#define MIN_HTTPD_OTA_HOST_MAX_BUFFERS 3
+
+/**
+ * The bytes between progress, just like ``MIN_HTTPD_OTA_PROGRESS_STEP``.
+ */
+#define MIN_HTTPD_OTA_HOST_PROGRESS_STEP (64 * 1024)
+
+/**
+ * The requested size of the buffers of the session.
+ *
+ * Linux raises this to its minimum of a few KiB, which is comparable to
+ * lwIP's default TCP window (5744 bytes).
+ */
+#define MIN_HTTPD_OTA_HOST_WINDOW_LEN 1
+
+/**
+ * The length of a segment, that is sent by the client.
+ */
+#define MIN_HTTPD_OTA_HOST_SEGMENT_LEN 1460
+
+/**
+ * The length of the chunks of the payload, just like
+ * ``MIN_HTTPD_OTA_INPUT_LEN``.
+ */
+#define MIN_HTTPD_OTA_HOST_INPUT_LEN 1024
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * The contents of a file.
+ */
+struct min_httpd_ota_host_file {
+    uint8_t* data;
+    size_t len;
+};
+
+/**
+ * A bounded, blocking queue of buffers.
+ */
+struct min_httpd_ota_host_queue {
+    void* items[MIN_HTTPD_OTA_HOST_MAX_BUFFERS + 1];
+    size_t head;
+    size_t count;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+};
+
+/**
+ * A buffer between the receiving thread and the writer.
+ */
+struct min_httpd_ota_host_buffer {
+    size_t len;
+    uint8_t data[MIN_HTTPD_OTA_HOST_BUFFER_LEN];
+};
+
+/**
+ * The stand-in of the OTA partition.
+ */
+struct min_httpd_ota_host_partition {
+    FILE* file;
+    size_t offset;  // the next byte to be written
+    size_t erased;  // the bytes, that are erased
+    uint32_t flash_kbs;
+};
+
+/**
+ * The state of an upload, that is shared by the receiving thread and the
+ * writer.
+ */
+struct min_httpd_ota_host_upload {
+    struct min_httpd_ota_host_buffer buffers[MIN_HTTPD_OTA_HOST_MAX_BUFFERS];
+    struct min_httpd_ota_host_queue free;
+    struct min_httpd_ota_host_queue full;  // ``NULL`` ends the writer
+    struct min_httpd_ota_host_partition partition;
+    bool writing;  // the writer writes a buffer (accessed atomically)
+};
+
+/**
+ * The client, that sends the firmware.
+ */
+struct min_httpd_ota_host_client {
+    int socket;
+    const uint8_t* payload;
+    size_t len;
+    uint32_t net_kbs;
+};
+
+/**
+ * The parameters and the outcome of an upload.
+ */
+struct min_httpd_ota_host_run {
+    size_t buffers;
+    uint32_t net_kbs;
+    uint32_t flash_kbs;
+    const struct min_httpd_ota_host_file* base;  // of a delta
+    struct min_httpd_ota_result result;
+    size_t progress;    // the number of reported progress
+    size_t overlapped;  // buffers, that were filled while another was written
+    bool verified;      // the digest matched
+    bool intact;      // the partition holds the firmware
+};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get the current time.
+ *
+ * @return int64_t The time in microseconds.
+ */
+static int64_t min_httpd_ota_host_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/**
+ * Wait until the given time.
+ *
+ * @param until The time in microseconds, see ::min_httpd_ota_host_now .
+ */
+static void min_httpd_ota_host_wait(int64_t until) {
+    int64_t now = min_httpd_ota_host_now();
+    if (until > now)
+        usleep((useconds_t)(until - now));
+}
+
+/**
+ * Initialize a queue.
+ *
+ * @param queue The queue.
+ */
+static void min_httpd_ota_host_queue_init(
+    struct min_httpd_ota_host_queue* queue) {
+    queue->head = 0;
+    queue->count = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->changed, NULL);
+}
+
+/**
+ * Release a queue.
+ *
+ * @param queue The queue.
+ */
+static void min_httpd_ota_host_queue_destroy(
+    struct min_httpd_ota_host_queue* queue) {
+    pthread_cond_destroy(&queue->changed);
+    pthread_mutex_destroy(&queue->lock);
+}
+
+/**
+ * Append an item to a queue, like ``xQueueSend()``.
+ *
+ * The queues are never full, as there are only as many items as buffers (and
+ * the ``NULL``, that ends the writer).
+ *
+ * @param queue The queue.
+ * @param item  The item.
+ */
+static void min_httpd_ota_host_queue_send(
+    struct min_httpd_ota_host_queue* queue,
+    void* item) {
+    const size_t size = sizeof(queue->items) / sizeof(queue->items[0]);
+
+    pthread_mutex_lock(&queue->lock);
+    queue->items[(queue->head + queue->count) % size] = item;
+    queue->count++;
+    pthread_cond_signal(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * Take the first item of a queue, like ``xQueueReceive()``.
+ *
+ * @param queue The queue.
+ * @return void* The item.
+ */
+static void* min_httpd_ota_host_queue_receive(
+    struct min_httpd_ota_host_queue* queue) {
+    const size_t size = sizeof(queue->items) / sizeof(queue->items[0]);
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0)
+        pthread_cond_wait(&queue->changed, &queue->lock);
+    void* item = queue->items[queue->head];
+    queue->head = (queue->head + 1) % size;
+    queue->count--;
+    pthread_mutex_unlock(&queue->lock);
+    return item;
+}
+
+/**
+ * Write to the partition, like ``esp_ota_write()``.
+ *
+ * Sectors are erased, before they are written.
+ *
+ * @param partition The partition.
+ * @param data      The data.
+ * @param len       The length of ``data``.
+ * @return bool ``true`` on success.
+ */
+static bool min_httpd_ota_host_partition_write(
+    struct min_httpd_ota_host_partition* partition,
+    const uint8_t* data,
+    size_t len) {
+    int64_t until = min_httpd_ota_host_now();
+    while (partition->erased < partition->offset + len) {
+        until += MIN_HTTPD_OTA_HOST_ERASE_US;
+        partition->erased += MIN_HTTPD_OTA_HOST_SECTOR_LEN;
+    }
+    if (partition->flash_kbs > 0)
+        until += (int64_t)len * 1000000 / (partition->flash_kbs * 1024);
+
+    if ((fseek(partition->file, (long)partition->offset, SEEK_SET) != 0) ||
+        (fwrite(data, 1, len, partition->file) != len))
+        return false;
+    partition->offset += len;
+
+    min_httpd_ota_host_wait(until);
+    return true;
+}
+
+/**
+ * Write the ``full`` buffers and return them as ``free``.
+ *
+ * This is the writer's thread, like ``min_httpd_ota_writer()``.
+ *
+ * @param arg The upload.
+ * @return void* ``NULL`` on success.
+ */
+static void* min_httpd_ota_host_writer(void* arg) {
+    struct min_httpd_ota_host_upload* upload = arg;
+    struct min_httpd_ota_host_buffer* buffer;
+    bool ok = true;
+
+    while ((buffer = min_httpd_ota_host_queue_receive(&upload->full)) !=
+           NULL) {
+        if (ok) {
+            __atomic_store_n(&upload->writing, true, __ATOMIC_RELEASE);
+            ok = min_httpd_ota_host_partition_write(
+                &upload->partition, buffer->data, buffer->len);
+            __atomic_store_n(&upload->writing, false, __ATOMIC_RELEASE);
+        }
+        min_httpd_ota_host_queue_send(&upload->free, buffer);
+    }
+    return ok ? NULL : upload;
+}
+
+/**
+ * Send the firmware, limited to the client's throughput.
+ *
+ * This is the client's thread.
+ *
+ * @param arg The client.
+ * @return void* Always ``NULL``.
+ */
+static void* min_httpd_ota_host_send(void* arg) {
+    struct min_httpd_ota_host_client* client = arg;
+    int64_t next = min_httpd_ota_host_now();
+    size_t sent = 0;
+
+    while (sent < client->len) {
+        size_t len = client->len - sent;
+        if (len > MIN_HTTPD_OTA_HOST_SEGMENT_LEN)
+            len = MIN_HTTPD_OTA_HOST_SEGMENT_LEN;
+        ssize_t written = send(client->socket, client->payload + sent, len, 0);
+        if (written <= 0)
+            break;
+        sent += (size_t)written;
+
+        // The time, that the client was blocked, is lost for the link
+        if (client->net_kbs > 0) {
+            int64_t now = min_httpd_ota_host_now();
+            next = ((next > now) ? next : now) +
+                   (int64_t)written * 1000000 / (client->net_kbs * 1024);
+            min_httpd_ota_host_wait(next);
+        }
+    }
+    shutdown(client->socket, SHUT_WR);
+    return NULL;
+}
+
+/**
+ * Read the base of a delta, like ``min_httpd_ota_read_running()``.
+ *
+ * @param ctx    The base (::min_httpd_ota_host_file ).
+ * @param offset The offset in the base.
+ * @param data   The buffer.
+ * @param len    The number of bytes to read.
+ * @return bool ``true`` on success.
+ */
+static bool min_httpd_ota_host_read_base(void* ctx,
+                                         size_t offset,
+                                         void* data,
+                                         size_t len) {
+    const struct min_httpd_ota_host_file* base = ctx;
+
+    if ((base == NULL) || (offset > base->len) || (len > base->len - offset))
+        return false;
+    memcpy(data, base->data + offset, len);
+    return true;
+}
+
+/**
+ * Receive the payload, decode the firmware and pass it to the writer.
+ *
+ * This is modelled after ``min_httpd_ota_receive()``.
+ *
+ * @param socket   The session.
+ * @param len      The announced length of the payload.
+ * @param upload   The upload.
+ * @param transfer The transfer, that hashes the firmware.
+ * @param digest   The announced digest of the firmware.
+ * @param run      The run, that counts progress, the stall and the buffers,
+ *                 that were filled while the writer was busy.
+ * @return bool ``true`` if the firmware was received completely.
+ */
+static bool min_httpd_ota_host_receive(
+    int socket,
+    size_t len,
+    struct min_httpd_ota_host_upload* upload,
+    struct min_httpd_ota_transfer* transfer,
+    const uint8_t digest[MIN_HTTPD_OTA_DIGEST_LEN],
+    struct min_httpd_ota_host_run* run) {
+    struct min_httpd_ota_decoder decoder;
+    struct min_httpd_ota_host_buffer* buffer = NULL;
+    uint8_t input[MIN_HTTPD_OTA_HOST_INPUT_LEN];
+    const uint8_t* in = NULL;
+    size_t in_len = 0;
+    size_t remaining = len;
+    bool initialized = false;
+    bool overlapped = false;
+
+    min_httpd_ota_decoder_init(
+        &decoder, len, min_httpd_ota_host_read_base, (void*)run->base);
+
+    while (decoder.status != MIN_HTTPD_OTA_DECODER_DONE) {
+        if ((in_len == 0) && (remaining > 0)) {
+            ssize_t received =
+                recv(socket,
+                     input,
+                     (sizeof(input) < remaining) ? sizeof(input) : remaining,
+                     0);
+            if (received <= 0)
+                break;
+            in = input;
+            in_len = (size_t)received;
+            remaining -= (size_t)received;
+        }
+
+        if (buffer == NULL) {
+            int64_t waiting = min_httpd_ota_host_now();
+            buffer = min_httpd_ota_host_queue_receive(&upload->free);
+            run->result.stall_us += min_httpd_ota_host_now() - waiting;
+            buffer->len = 0;
+        }
+
+        buffer->len += min_httpd_ota_decoder_run(&decoder,
+                                                 &in,
+                                                 &in_len,
+                                                 buffer->data + buffer->len,
+                                                 sizeof(buffer->data) -
+                                                     buffer->len);
+        if (decoder.status >= MIN_HTTPD_OTA_DECODER_INVALID)
+            break;
+        if (__atomic_load_n(&upload->writing, __ATOMIC_ACQUIRE))
+            overlapped = true;
+
+        if (!initialized && (decoder.status != MIN_HTTPD_OTA_DECODER_HEADER)) {
+            min_httpd_ota_transfer_init(transfer,
+                                        decoder.len,
+                                        digest,
+                                        MIN_HTTPD_OTA_HOST_PROGRESS_STEP);
+            initialized = true;
+        }
+
+        if ((buffer->len == sizeof(buffer->data)) ||
+            ((decoder.status == MIN_HTTPD_OTA_DECODER_DONE) &&
+             (buffer->len > 0))) {
+            if (min_httpd_ota_transfer_update(
+                    transfer, buffer->data, buffer->len))
+                run->progress++;
+            if (overlapped)
+                run->overlapped++;
+            min_httpd_ota_host_queue_send(&upload->full, buffer);
+            buffer = NULL;
+            overlapped = false;
+        }
+    }
+
+    if (buffer != NULL)
+        min_httpd_ota_host_queue_send(&upload->free, buffer);
+    return decoder.status == MIN_HTTPD_OTA_DECODER_DONE;
+}
+
+/**
+ * Connect a loopback TCP session.
+ *
+ * The buffers of the session are as small as possible, like lwIP's TCP
+ * window, so the client is blocked, while the firmware is not received.
+ *
+ * @param sockets The receiving and the sending socket.
+ * @return bool ``true`` on success.
+ */
+static bool min_httpd_ota_host_connect(int sockets[2]) {
+    int window = MIN_HTTPD_OTA_HOST_WINDOW_LEN;
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t address_len = sizeof(address);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockets[1] = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(listener, SOL_SOCKET, SO_RCVBUF, &window, sizeof(window));
+    setsockopt(sockets[1], SOL_SOCKET, SO_SNDBUF, &window, sizeof(window));
+    bool ok = (listener >= 0) && (sockets[1] >= 0) &&
+              (bind(listener, (struct sockaddr*)&address, address_len) == 0) &&
+              (listen(listener, 1) == 0) &&
+              (getsockname(listener,
+                           (struct sockaddr*)&address,
+                           &address_len) == 0) &&
+              (connect(sockets[1],
+                       (struct sockaddr*)&address,
+                       address_len) == 0);
+    sockets[0] = ok ? accept(listener, NULL, NULL) : -1;
+    if (listener >= 0)
+        close(listener);
+
+    if (sockets[0] < 0) {
+        perror("loopback");
+        if (sockets[1] >= 0)
+            close(sockets[1]);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Upload a firmware over a loopback session.
+ *
+ * @param payload     The payload, that is sent.
+ * @param payload_len The length of ``payload``.
+ * @param firmware    The firmware, that must be written.
+ * @param len         The length of ``firmware``.
+ * @param digest      The announced digest.
+ * @param run         The parameters and the outcome of the upload.
+ * @return bool ``true`` if the upload could be run.
+ */
+static bool min_httpd_ota_host_upload(
+    const uint8_t* payload,
+    size_t payload_len,
+    const uint8_t* firmware,
+    size_t len,
+    const uint8_t digest[MIN_HTTPD_OTA_DIGEST_LEN],
+    struct min_httpd_ota_host_run* run) {
+    int sockets[2];
+    if (!min_httpd_ota_host_connect(sockets))
+        return false;
+
+    struct min_httpd_ota_host_upload* upload = malloc(sizeof(*upload));
+    if (upload == NULL) {
+        close(sockets[0]);
+        close(sockets[1]);
+        return false;
+    }
+    min_httpd_ota_host_queue_init(&upload->free);
+    min_httpd_ota_host_queue_init(&upload->full);
+    for (size_t i = 0; i < run->buffers; i++)
+        min_httpd_ota_host_queue_send(&upload->free, &upload->buffers[i]);
+    upload->partition = (struct min_httpd_ota_host_partition){
+        .file = tmpfile(),
+        .flash_kbs = run->flash_kbs,
+    };
+    upload->writing = false;
+
+    struct min_httpd_ota_host_client client = {
+        .socket = sockets[1],
+        .payload = payload,
+        .len = payload_len,
+        .net_kbs = run->net_kbs,
+    };
+    struct min_httpd_ota_transfer transfer = {0};
+    run->result = (struct min_httpd_ota_result){.payload = payload_len};
+    run->progress = 0;
+    run->overlapped = 0;
+
+    pthread_t sender;
+    pthread_t writer;
+    pthread_create(&writer, NULL, min_httpd_ota_host_writer, upload);
+    int64_t started = min_httpd_ota_host_now();
+    pthread_create(&sender, NULL, min_httpd_ota_host_send, &client);
+
+    // Wait for the writer, even if the transfer failed
+    bool received = min_httpd_ota_host_receive(
+        sockets[0], payload_len, upload, &transfer, digest, run);
+    min_httpd_ota_host_queue_send(&upload->full, NULL);
+    void* failed;
+    pthread_join(writer, &failed);
+    run->result.elapsed_us = min_httpd_ota_host_now() - started;
+    run->result.len = transfer.received;
+    // The rest of the payload is not received after an error
+    close(sockets[0]);
+    pthread_join(sender, NULL);
+
+    run->verified = received && (failed == NULL) &&
+                    min_httpd_ota_transfer_verify(&transfer);
+
+    // Read back the partition
+    uint8_t* written = malloc(len);
+    run->intact = (written != NULL) && (upload->partition.file != NULL) &&
+                  (fseek(upload->partition.file, 0, SEEK_SET) == 0) &&
+                  (fread(written, 1, len, upload->partition.file) == len) &&
+                  (memcmp(written, firmware, len) == 0);
+    free(written);
+
+    if (upload->partition.file != NULL)
+        fclose(upload->partition.file);
+    min_httpd_ota_host_queue_destroy(&upload->full);
+    min_httpd_ota_host_queue_destroy(&upload->free);
+    free(upload);
+    close(sockets[1]);
+    return true;
+}
+
+/**
+ * Verify SHA-256 with the test vectors of FIPS 180-2.
+ *
+ * @return bool ``true`` if all digests match.
+ */
+static bool min_httpd_ota_host_check_vectors(void) {
+    static const char* const messages[] = {
+        "",
+        "abc",
+        "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+    };
+    static const char* const digests[] = {
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+        "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+    };
+    uint8_t expected[MIN_HTTPD_OTA_DIGEST_LEN];
+    uint8_t digest[MIN_HTTPD_OTA_DIGEST_LEN];
+    struct min_httpd_ota_sha256 sha256;
+    bool ok = true;
+
+    for (size_t i = 0; i < sizeof(messages) / sizeof(messages[0]); i++) {
+        min_httpd_ota_sha256_init(&sha256);
+        min_httpd_ota_sha256_update(&sha256, messages[i], strlen(messages[i]));
+        min_httpd_ota_sha256_finish(&sha256, digest);
+        ok = min_httpd_ota_digest_parse(digests[i], expected) &&
+             (memcmp(digest, expected, sizeof(digest)) == 0) && ok;
+    }
+
+    // One million times 'a', hashed in odd chunks
+    char chunk[1000];
+    memset(chunk, 'a', sizeof(chunk));
+    min_httpd_ota_sha256_init(&sha256);
+    for (size_t hashed = 0; hashed < 1000000;) {
+        size_t len = 1 + (hashed * 7) % sizeof(chunk);
+        if (len > 1000000 - hashed)
+            len = 1000000 - hashed;
+        min_httpd_ota_sha256_update(&sha256, chunk, len);
+        hashed += len;
+    }
+    min_httpd_ota_sha256_finish(&sha256, digest);
+    ok = min_httpd_ota_digest_parse(digests[3], expected) &&
+         (memcmp(digest, expected, sizeof(digest)) == 0) && ok;
+
+    return ok;
+}
+
+/**
+ * Verify the parsing of digests.
+ *
+ * @return bool ``true`` if valid digests are parsed and invalid digests are
+ *              rejected.
+ */
+static bool min_httpd_ota_host_check_parse(void) {
+    uint8_t lower[MIN_HTTPD_OTA_DIGEST_LEN];
+    uint8_t upper[MIN_HTTPD_OTA_DIGEST_LEN];
+
+    return min_httpd_ota_digest_parse(
+               "00ff10aa2b3c4d5e6f708192a3b4c5d6e7f8091a2b3c4d5e6f70819203ab"
+               "cdef",
+               lower) &&
+           min_httpd_ota_digest_parse(
+               "00FF10AA2B3C4D5E6F708192A3B4C5D6E7F8091A2B3C4D5E6F70819203AB"
+               "CDEF",
+               upper) &&
+           (memcmp(lower, upper, sizeof(lower)) == 0) && (lower[1] == 0xff) &&
+           !min_httpd_ota_digest_parse("00ff", lower) &&
+           !min_httpd_ota_digest_parse(
+               "00ff10aa2b3c4d5e6f708192a3b4c5d6e7f8091a2b3c4d5e6f70819203ab"
+               "cdeg",
+               lower);
+}
+
+/**
+ * Verify the check of the upload's token.
+ *
+ * @return bool ``true`` if only the shared token with the scheme ``Bearer``
+ *              is accepted.
+ */
+static bool min_httpd_ota_host_check_token(void) {
+    const char* token = "0123456789abcdef";
+
+    return min_httpd_ota_token_match("Bearer 0123456789abcdef", token) &&
+           min_httpd_ota_token_match("bearer 0123456789abcdef", token) &&
+           !min_httpd_ota_token_match("Bearer 0123456789abcdeg", token) &&
+           !min_httpd_ota_token_match("Bearer 0123456789abcde", token) &&
+           !min_httpd_ota_token_match("Bearer 0123456789abcdef0", token) &&
+           !min_httpd_ota_token_match("Basic 0123456789abcdef", token) &&
+           !min_httpd_ota_token_match("0123456789abcdef", token) &&
+           !min_httpd_ota_token_match("Bearer ", "");
+}
+
+/**
+ * Read a file.
+ *
+ * @param name The name of the file.
+ * @param file The contents, that must be released with ``free()``.
+ * @return bool ``true`` on success.
+ */
+static bool min_httpd_ota_host_load(const char* name,
+                                    struct min_httpd_ota_host_file* file) {
+    FILE* f = fopen(name, "rb");
+    long len = -1;
+
+    file->data = NULL;
+    file->len = 0;
+    if ((f != NULL) && (fseek(f, 0, SEEK_END) == 0))
+        len = ftell(f);
+    if ((len > 0) && (fseek(f, 0, SEEK_SET) == 0))
+        file->data = malloc((size_t)len);
+    if ((file->data != NULL) && (fread(file->data, 1, len, f) == (size_t)len))
+        file->len = (size_t)len;
+    if (f != NULL)
+        fclose(f);
+
+    if (file->len == 0) {
+        fprintf(stderr, "Could not read '%s'!\n", name);
+        free(file->data);
+        file->data = NULL;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Calculate the SHA-256 digest of a file.
+ *
+ * @param file   The file.
+ * @param digest The digest.
+ */
+static void min_httpd_ota_host_digest(
+    const struct min_httpd_ota_host_file* file,
+    uint8_t digest[MIN_HTTPD_OTA_DIGEST_LEN]) {
+    struct min_httpd_ota_sha256 sha256;
+
+    min_httpd_ota_sha256_init(&sha256);
+    min_httpd_ota_sha256_update(&sha256, file->data, file->len);
+    min_httpd_ota_sha256_finish(&sha256, digest);
+}
+
+/**
+ * Decode a payload in memory.
+ *
+ * The payload is passed in chunks of ``chunk`` bytes, the firmware is
+ * decoded into a buffer of ``out_size`` bytes, so the decoder is suspended
+ * at arbitrary positions.
+ *
+ * @param payload  The payload.
+ * @param base     The base of a delta, may be ``NULL``.
+ * @param firmware The expected firmware, may be ``NULL``.
+ * @param chunk    The length of the chunks of the payload.
+ * @param out_size The size of the buffer of the firmware.
+ * @return enum min_httpd_ota_decoder_status The status of the decoder, that
+ *         is ``MIN_HTTPD_OTA_DECODER_INVALID``, if the firmware differs.
+ */
+static enum min_httpd_ota_decoder_status min_httpd_ota_host_decode(
+    const struct min_httpd_ota_host_file* payload,
+    const struct min_httpd_ota_host_file* base,
+    const struct min_httpd_ota_host_file* firmware,
+    size_t chunk,
+    size_t out_size) {
+    struct min_httpd_ota_decoder* decoder = malloc(sizeof(*decoder));
+    uint8_t out[MIN_HTTPD_OTA_HOST_BUFFER_LEN];
+    const uint8_t* in = payload->data;
+    size_t in_len = 0;
+    size_t remaining = payload->len;
+    size_t offset = 0;
+    bool matches = true;
+
+    if (decoder == NULL)
+        return MIN_HTTPD_OTA_DECODER_INVALID;
+    min_httpd_ota_decoder_init(
+        decoder, payload->len, min_httpd_ota_host_read_base, (void*)base);
+
+    while (decoder->status < MIN_HTTPD_OTA_DECODER_DONE) {
+        if ((in_len == 0) && (remaining > 0)) {
+            in_len = (chunk < remaining) ? chunk : remaining;
+            remaining -= in_len;
+        }
+
+        size_t len =
+            min_httpd_ota_decoder_run(decoder, &in, &in_len, out, out_size);
+        if ((firmware != NULL) &&
+            ((offset + len > firmware->len) ||
+             (memcmp(firmware->data + offset, out, len) != 0)))
+            matches = false;
+        offset += len;
+    }
+
+    enum min_httpd_ota_decoder_status status = decoder->status;
+    if ((firmware != NULL) && (status == MIN_HTTPD_OTA_DECODER_DONE) &&
+        (!matches || (offset != firmware->len)))
+        status = MIN_HTTPD_OTA_DECODER_INVALID;
+    free(decoder);
+    return status;
+}
+
+/**
+ * Verify and benchmark the payloads, that were generated from the synthetic
+ * images.
+ *
+ * @param failures  The number of failures.
+ * @param flash_kbs The throughput of writing the partition, given in kB/s.
+ */
+static void min_httpd_ota_host_bench_payloads(int* failures,
+                                              uint32_t flash_kbs) {
+    static const char* const names[] = {"plain", "compressed", "delta"};
+    struct min_httpd_ota_host_file base;
+    struct min_httpd_ota_host_file update;
+    struct min_httpd_ota_host_file payloads[3];
+
+    if (!min_httpd_ota_host_load(MIN_HTTPD_OTA_HOST_BASE, &base) ||
+        !min_httpd_ota_host_load(MIN_HTTPD_OTA_HOST_UPDATE, &update) ||
+        !min_httpd_ota_host_load(MIN_HTTPD_OTA_HOST_COMPRESSED,
+                                 &payloads[1]) ||
+        !min_httpd_ota_host_load(MIN_HTTPD_OTA_HOST_DELTA, &payloads[2])) {
+        (*failures)++;
+        return;
+    }
+    payloads[0] = update;
+
+    // Suspend the decoder everywhere: tiny, odd and large chunks
+    static const size_t chunks[] = {1, 7, 1000, 1 << 20};
+    bool decoded = true;
+    for (size_t i = 0; i < 3; i++) {
+        for (size_t j = 0; j < sizeof(chunks) / sizeof(chunks[0]); j++) {
+            decoded = (min_httpd_ota_host_decode(&payloads[i],
+                                                 &base,
+                                                 &update,
+                                                 chunks[j],
+                                                 (j & 1) ? 13 : 4096) ==
+                       MIN_HTTPD_OTA_DECODER_DONE) &&
+                      decoded;
+        }
+    }
+    host_check(failures, decoded, "Payloads are decoded");
+
+    // Truncated, extended and corrupted payloads
+    bool rejected = true;
+    for (size_t i = 1; i < 3; i++) {
+        struct min_httpd_ota_host_file invalid = payloads[i];
+        invalid.len--;
+        rejected = (min_httpd_ota_host_decode(
+                        &invalid, &base, NULL, 1000, 4096) ==
+                    MIN_HTTPD_OTA_DECODER_INVALID) &&
+                   rejected;
+        invalid.len = MIN_HTTPD_OTA_PAYLOAD_HEADER_LEN - 1;
+        rejected = (min_httpd_ota_host_decode(
+                        &invalid, &base, NULL, 1000, 4096) ==
+                    MIN_HTTPD_OTA_DECODER_INVALID) &&
+                   rejected;
+
+        invalid.data = malloc(payloads[i].len + 1);
+        if (invalid.data == NULL) {
+            rejected = false;
+            continue;
+        }
+        memcpy(invalid.data, payloads[i].data, payloads[i].len);
+        invalid.data[payloads[i].len] = 0;
+        invalid.len = payloads[i].len + 1;
+        rejected = (min_httpd_ota_host_decode(
+                        &invalid, &base, NULL, 1000, 4096) ==
+                    MIN_HTTPD_OTA_DECODER_INVALID) &&
+                   rejected;
+        invalid.len--;
+        invalid.data[4] ^= 0xFF;  // the version
+        rejected = (min_httpd_ota_host_decode(
+                        &invalid, &base, NULL, 1000, 4096) ==
+                    MIN_HTTPD_OTA_DECODER_INVALID) &&
+                   rejected;
+        free(invalid.data);
+    }
+    host_check(failures, rejected, "Invalid payloads are rejected");
+    host_check(
+        failures,
+        min_httpd_ota_host_decode(&payloads[2], &update, NULL, 1000, 4096) ==
+            MIN_HTTPD_OTA_DECODER_MISMATCH,
+        "Delta against another base is rejected");
+
+    // Upload the update
+    uint8_t digest[MIN_HTTPD_OTA_DIGEST_LEN];
+    min_httpd_ota_host_digest(&update, digest);
+    printf("     update %zu bytes, base %zu bytes, client %u kB/s\n",
+           update.len,
+           base.len,
+           (unsigned int)MIN_HTTPD_OTA_HOST_SLOW_KBS);
+
+    struct min_httpd_ota_host_run runs[3];
+    bool ok = true;
+    for (size_t i = 0; i < 3; i++) {
+        runs[i] = (struct min_httpd_ota_host_run){
+            .buffers = 2,
+            .net_kbs = MIN_HTTPD_OTA_HOST_SLOW_KBS,
+            .flash_kbs = flash_kbs,
+            .base = &base,
+        };
+        ok = min_httpd_ota_host_upload(payloads[i].data,
+                                       payloads[i].len,
+                                       update.data,
+                                       update.len,
+                                       digest,
+                                       &runs[i]) &&
+             runs[i].verified && runs[i].intact && ok;
+
+        char body[112];
+        min_httpd_ota_result_json(body, sizeof(body), &runs[i].result);
+        printf("     %-10s %7zu bytes (%5.1f%%) %s\n",
+               names[i],
+               payloads[i].len,
+               100.0 * payloads[i].len / update.len,
+               body);
+    }
+    host_check(failures, ok, "Payloads are written and verified");
+    host_check(failures,
+               (payloads[2].len < payloads[1].len) &&
+                   (payloads[1].len < payloads[0].len),
+               "Payloads reduce the bytes of the upload");
+
+    free(base.data);
+    free(update.data);
+    free(payloads[1].data);
+    free(payloads[2].data);
+}
+
+/**
+ * Decode a payload and compare it with a firmware.
+ *
+ * @param payload_name  The name of the payload's file.
+ * @param firmware_name The name of the firmware's file.
+ * @param base_name     The name of the base's file, may be ``NULL``.
+ * @return int ``0`` if the firmware is reconstructed.
+ */
+static int min_httpd_ota_host_verify(const char* payload_name,
+                                     const char* firmware_name,
+                                     const char* base_name) {
+    struct min_httpd_ota_host_file payload;
+    struct min_httpd_ota_host_file firmware;
+    struct min_httpd_ota_host_file base = {0};
+
+    if (!min_httpd_ota_host_load(payload_name, &payload) ||
+        !min_httpd_ota_host_load(firmware_name, &firmware) ||
+        ((base_name != NULL) && !min_httpd_ota_host_load(base_name, &base)))
+        return 1;
+
+    int64_t started = min_httpd_ota_host_now();
+    enum min_httpd_ota_decoder_status status =
+        min_httpd_ota_host_decode(&payload,
+                                  (base_name != NULL) ? &base : NULL,
+                                  &firmware,
+                                  MIN_HTTPD_OTA_HOST_INPUT_LEN,
+                                  MIN_HTTPD_OTA_HOST_BUFFER_LEN);
+    int64_t elapsed_us = min_httpd_ota_host_now() - started;
+
+    printf("     payload %zu bytes (%.1f%%), firmware %zu bytes, decoded in "
+           "%u ms\n",
+           payload.len,
+           100.0 * payload.len / firmware.len,
+           firmware.len,
+           (unsigned int)(elapsed_us / 1000));
+    printf("%s\n",
+           (status == MIN_HTTPD_OTA_DECODER_DONE)       ? "OK"
+           : (status == MIN_HTTPD_OTA_DECODER_MISMATCH) ? "FAIL (base)"
+                                                        : "FAIL");
+
+    free(payload.data);
+    free(firmware.data);
+    free(base.data);
+    return (status == MIN_HTTPD_OTA_DECODER_DONE) ? 0 : 1;
+}
+
+/**
+ * Run the benchmark.
+ *
+ * @param net_kbs   The throughput of the client, given in kB/s.
+ * @param flash_kbs The throughput of writing the partition, given in kB/s.
+ * @return int ``0`` if all checks passed.
+ */
+static int min_httpd_ota_host_bench(uint32_t net_kbs, uint32_t flash_kbs) {
+    int failures = 0;
+
+    host_check(&failures,
+               min_httpd_ota_host_check_vectors(),
+               "SHA-256 matches the test vectors");
+    host_check(
+        &failures, min_httpd_ota_host_check_parse(), "Digests are parsed");
+    host_check(&failures,
+               min_httpd_ota_host_check_token(),
+               "Only the shared token is accepted");
+
+    // The firmware is not compressible, like a real one
+    const size_t len = MIN_HTTPD_OTA_HOST_FIRMWARE_LEN;
+    uint8_t* firmware = malloc(len);
+    if (firmware == NULL)
+        return 1;
+    for (size_t i = 0; i < len; i++)
+        firmware[i] = (uint8_t)((i * 2654435761u) >> 13);
+    uint8_t digest[MIN_HTTPD_OTA_DIGEST_LEN];
+    struct min_httpd_ota_sha256 sha256;
+    min_httpd_ota_sha256_init(&sha256);
+    min_httpd_ota_sha256_update(&sha256, firmware, len);
+    min_httpd_ota_sha256_finish(&sha256, digest);
+
+    printf("     firmware %zu bytes, client %u kB/s, flash %u kB/s + %u us "
+           "erase per sector\n",
+           len,
+           (unsigned int)net_kbs,
+           (unsigned int)flash_kbs,
+           (unsigned int)MIN_HTTPD_OTA_HOST_ERASE_US);
+
+    struct min_httpd_ota_host_run runs[MIN_HTTPD_OTA_HOST_MAX_BUFFERS];
+    bool ok = true;
+    bool reported = true;
+    for (size_t i = 0; i < MIN_HTTPD_OTA_HOST_MAX_BUFFERS; i++) {
+        runs[i] = (struct min_httpd_ota_host_run){
+            .buffers = i + 1,
+            .net_kbs = net_kbs,
+            .flash_kbs = flash_kbs,
+        };
+        ok = min_httpd_ota_host_upload(
+                 firmware, len, firmware, len, digest, &runs[i]) &&
+             runs[i].verified && runs[i].intact && ok;
+        reported = (runs[i].progress ==
+                    (len + MIN_HTTPD_OTA_HOST_PROGRESS_STEP - 1) /
+                        MIN_HTTPD_OTA_HOST_PROGRESS_STEP) &&
+                   reported;
+
+        char body[112];
+        min_httpd_ota_result_json(body, sizeof(body), &runs[i].result);
+        printf("     %zu buffer(s): %.1f kB/s, %zu filled while writing %s\n",
+               runs[i].buffers,
+               min_httpd_ota_rate(len, runs[i].result.elapsed_us) / 1024.0,
+               runs[i].overlapped,
+               body);
+    }
+    host_check(&failures, ok, "Firmware is written and verified");
+    host_check(&failures, reported, "Progress is reported");
+    host_check(&failures,
+               runs[0].overlapped == 0,
+               "One buffer alternates receiving and writing");
+    host_check(&failures,
+               (runs[1].overlapped > 0) && (runs[2].overlapped > 0),
+               "More buffers overlap receiving and writing");
+
+    // Corrupt the announced digest, without limiting the throughput
+    struct min_httpd_ota_host_run corrupted = {.buffers = 2};
+    digest[0] ^= 0x01;
+    host_check(&failures,
+               min_httpd_ota_host_upload(
+                   firmware, len, firmware, len, digest, &corrupted) &&
+                   !corrupted.verified && corrupted.intact,
+               "Mismatching firmware is rejected");
+
+    free(firmware);
+
+    min_httpd_ota_host_bench_payloads(&failures, flash_kbs);
+
+    return host_check_summary(failures);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr,
+                "Usage: %s bench [NET_KBS [FLASH_KBS]]\n"
+                "       %s verify PAYLOAD FIRMWARE [BASE]\n",
+                argv[0],
+                argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "bench") == 0) {
+        return min_httpd_ota_host_bench(
+            (argc > 2) ? (uint32_t)atoi(argv[2]) : MIN_HTTPD_OTA_HOST_NET_KBS,
+            (argc > 3) ? (uint32_t)atoi(argv[3])
+                       : MIN_HTTPD_OTA_HOST_FLASH_KBS);
+    }
+
+    if ((strcmp(argv[1], "verify") == 0) && (argc > 3))
+        return min_httpd_ota_host_verify(
+            argv[2], argv[3], (argc > 4) ? argv[4] : NULL);
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
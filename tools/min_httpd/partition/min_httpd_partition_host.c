@@ -0,0 +1,628 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Verify and benchmark the asset partition of the ``min_httpd`` component on
+ * a Linux host.
+ *
+ * The engine is compiled unmodified. The image, that is generated by
+ * ``tools/packer/assets.py`` with ``--image``, is memory-mapped from its file,
+ * just like the partition is mapped with ``esp_partition_mmap()``:
+ *
+ *   - ``min_httpd_partition_host bench [ROUNDS]`` verifies, that the image is
+ *     valid, that every asset is found with its content and that corrupted
+ *     images are rejected. Then a single thread serves ``ROUNDS`` downloads
+ *     of the large assets on one session, just like ``esp_http_server``'s
+ *     task, and reports the throughput. The content is either sent from the
+ *     mapped image in chunks (like ``min_httpd_assets_send()``) or read into
+ *     a buffer first (like copying it from the partition with
+ *     ``esp_partition_read()``). Last, every download is resumed from the
+ *     middle of the asset (``Range`` with ``If-Range``).
+ *
+ * @file   min_httpd_partition_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* The engine of the packed assets. */
+#include "min_httpd_assets_engine.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The default number of downloads of every large asset.
+ */
+#define MIN_HTTPD_PARTITION_HOST_ROUNDS 50
+
+/**
+ * The length of a chunk, just like ``MIN_HTTPD_ASSETS_CHUNK_LEN``.
+ */
+#define MIN_HTTPD_PARTITION_HOST_CHUNK_LEN 4096
+
+/**
+ * The maximum length of a request or of the head of a response.
+ */
+#define MIN_HTTPD_PARTITION_HOST_BUF_LEN 512
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * The server.
+ */
+struct min_httpd_partition_host_server {
+    int listener;
+    bool mapped;  // ``false`` to read the content into a buffer first
+    int fd;       // the image's file
+    const uint8_t* image;
+    const struct min_httpd_asset_table* table;
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * The large assets, that are downloaded.
+ */
+static const char* const min_httpd_partition_host_large[] = {
+    "/media/clip.bin",
+    "/app.js",
+};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get the current time.
+ *
+ * @return double The time in seconds.
+ */
+static double min_httpd_partition_host_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Read a staged asset.
+ *
+ * @param path The path of the asset.
+ * @param len  The length of the content.
+ * @return uint8_t* The content, ``NULL`` on failure. It must be freed.
+ */
+static uint8_t* min_httpd_partition_host_read(const char* path, size_t* len) {
+    char file_name[MIN_HTTPD_PARTITION_HOST_BUF_LEN];
+    snprintf(file_name,
+             sizeof(file_name),
+             "%s%s",
+             MIN_HTTPD_PARTITION_HOST_WWW,
+             path);
+
+    FILE* file = fopen(file_name, "rb");
+    if (file == NULL)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    *len = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* content = malloc(*len + 1);
+    if ((content != NULL) && (fread(content, 1, *len, file) != *len)) {
+        free(content);
+        content = NULL;
+    }
+    fclose(file);
+    return content;
+}
+
+/**
+ * Verify the assets of the image.
+ *
+ * @param table The table of the image.
+ * @return bool ``true`` if the assets are found with their content.
+ */
+static bool min_httpd_partition_host_check_assets(
+    const struct min_httpd_asset_table* table) {
+    const char* const paths[] = {
+        "/index.html",
+        "/favicon.ico",
+        "/media/clip.bin",
+        "/app.js",
+    };
+
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+        size_t len;
+        uint8_t* content = min_httpd_partition_host_read(paths[i], &len);
+        const struct min_httpd_asset* asset =
+            min_httpd_assets_find(table, paths[i]);
+        bool ok = (content != NULL) && (asset != NULL) && (asset->len == len) &&
+                  (memcmp(table->blob + asset->offset, content, len) == 0);
+        free(content);
+        if (!ok)
+            return false;
+    }
+
+    // Only the compressible asset has a ``gzip`` variant
+    const struct min_httpd_asset* app = min_httpd_assets_find(table, "/app.js");
+    const struct min_httpd_asset* clip =
+        min_httpd_assets_find(table, "/media/clip.bin");
+    return (app->gzip_len > 0) && (clip->gzip_len == 0) &&
+           (min_httpd_assets_find(table, "/") != NULL) &&
+           (min_httpd_assets_find(table, "/nope.html") == NULL);
+}
+
+/**
+ * Determine, if corrupted images are rejected.
+ *
+ * @param image The valid image.
+ * @param len   The length of ``image``.
+ * @return bool ``true`` if all corrupted images are rejected.
+ */
+static bool min_httpd_partition_host_check_corrupted(const uint8_t* image,
+                                                     size_t len) {
+    uint8_t* copy = malloc(len);
+    if (copy == NULL)
+        return false;
+
+    // An erased partition
+    memset(copy, 0xff, len);
+    bool ok = (min_httpd_assets_image_check(copy, len) == 0);
+
+    // An incompletely flashed image
+    memcpy(copy, image, len);
+    memset(copy + len / 2, 0xff, len - len / 2);
+    ok = ok && (min_httpd_assets_image_check(copy, len) == 0);
+
+    // A single flipped bit in the content
+    memcpy(copy, image, len);
+    copy[len - 1] ^= 0x01;
+    ok = ok && (min_httpd_assets_image_check(copy, len) == 0);
+
+    // A truncated range
+    memcpy(copy, image, len);
+    ok = ok && (min_httpd_assets_image_check(copy, len - 1) == 0) &&
+         (min_httpd_assets_image_check(copy, len) > 0);
+
+    free(copy);
+    return ok;
+}
+
+/**
+ * Send data completely.
+ *
+ * @param socket The socket.
+ * @param data   The data.
+ * @param len    The length of ``data``.
+ * @return bool ``true`` if all data was sent.
+ */
+static bool min_httpd_partition_host_send(int socket,
+                                          const uint8_t* data,
+                                          size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(socket, data, len, MSG_NOSIGNAL);
+        if (sent <= 0)
+            return false;
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return true;
+}
+
+/**
+ * Get a header of a request.
+ *
+ * @param head  The head of the request.
+ * @param field The name of the header, e.g. ``\r\nRange: ``.
+ * @param buf   The buffer of ::MIN_HTTPD_PARTITION_HOST_BUF_LEN bytes.
+ * @return const char* ``buf``, ``NULL`` if the header is missing.
+ */
+static const char* min_httpd_partition_host_header(const char* head,
+                                                   const char* field,
+                                                   char* buf) {
+    const char* value = strstr(head, field);
+    if (value == NULL)
+        return NULL;
+    value += strlen(field);
+    size_t len = strcspn(value, "\r");
+    if (len >= MIN_HTTPD_PARTITION_HOST_BUF_LEN)
+        return NULL;
+    memcpy(buf, value, len);
+    buf[len] = '\0';
+    return buf;
+}
+
+/**
+ * Respond with an asset.
+ *
+ * @param server The server.
+ * @param socket The session's socket.
+ * @param uri    The URI of the request.
+ * @param head   The head of the request.
+ * @return bool ``true`` if the response was sent.
+ */
+static bool min_httpd_partition_host_respond(
+    const struct min_httpd_partition_host_server* server,
+    int socket,
+    const char* uri,
+    const char* head) {
+    const struct min_httpd_asset* asset =
+        min_httpd_assets_find(server->table, uri);
+    if (asset == NULL)
+        return false;
+
+    char values[2][MIN_HTTPD_PARTITION_HOST_BUF_LEN];
+    const struct min_httpd_assets_request headers = {
+        .range = min_httpd_partition_host_header(head, "\r\nRange: ", values[0]),
+        .if_range =
+            min_httpd_partition_host_header(head, "\r\nIf-Range: ", values[1]),
+    };
+    struct min_httpd_assets_response response;
+    min_httpd_assets_evaluate(server->table, asset, &headers, &response);
+
+    char response_head[MIN_HTTPD_PARTITION_HOST_BUF_LEN];
+    size_t head_len = min_httpd_assets_response_head(
+        response_head, sizeof(response_head), asset, &response);
+    if ((head_len == 0) ||
+        !min_httpd_partition_host_send(socket,
+                                       (uint8_t*)response_head,
+                                       head_len))
+        return false;
+
+    const uint8_t* content = server->table->blob + response.offset;
+    static uint8_t buf[MIN_HTTPD_PARTITION_HOST_CHUNK_LEN];
+    for (size_t sent = 0; sent < response.len;) {
+        size_t len = response.len - sent;
+        if (len > MIN_HTTPD_PARTITION_HOST_CHUNK_LEN)
+            len = MIN_HTTPD_PARTITION_HOST_CHUNK_LEN;
+
+        const uint8_t* chunk = content + sent;
+        if (!server->mapped) {
+            // The offset in the image is the offset in its file
+            if (pread(server->fd, buf, len, (off_t)(chunk - server->image)) !=
+                (ssize_t)len)
+                return false;
+            chunk = buf;
+        }
+        if (!min_httpd_partition_host_send(socket, chunk, len))
+            return false;
+        sent += len;
+    }
+    return true;
+}
+
+/**
+ * The thread of the server, serving a single session.
+ *
+ * @param arg The server (::min_httpd_partition_host_server ).
+ * @return void* Always ``NULL``.
+ */
+static void* min_httpd_partition_host_serve(void* arg) {
+    const struct min_httpd_partition_host_server* server = arg;
+    char buf[MIN_HTTPD_PARTITION_HOST_BUF_LEN];
+    size_t len = 0;
+
+    int socket = accept(server->listener, NULL, NULL);
+    if (socket < 0)
+        return NULL;
+
+    for (;;) {
+        ssize_t ret = recv(socket, buf + len, sizeof(buf) - 1 - len, 0);
+        if (ret <= 0)
+            break;
+        len += (size_t)ret;
+        buf[len] = '\0';
+
+        char* end;
+        while ((end = strstr(buf, "\r\n\r\n")) != NULL) {
+            char uri[MIN_HTTPD_PARTITION_HOST_BUF_LEN];
+            end[2] = '\0';
+            if ((sscanf(buf, "GET %511s HTTP/1.1", uri) != 1) ||
+                !min_httpd_partition_host_respond(server, socket, uri, buf)) {
+                close(socket);
+                return NULL;
+            }
+
+            len -= (size_t)(end + 4 - buf);
+            memmove(buf, end + 4, len + 1);
+        }
+    }
+    close(socket);
+    return NULL;
+}
+
+/**
+ * Download an asset and compare it with its staged file.
+ *
+ * A download is resumed with a range, that is sent, if the asset was not
+ * modified since the previous download (``If-Range``).
+ *
+ * @param sock          The socket.
+ * @param path          The path of the asset.
+ * @param expected      The content of the staged file.
+ * @param len           The length of ``expected``.
+ * @param first         The first byte of the download, ``0`` for all of it.
+ * @param last_modified The ``Last-Modified`` of the previous download (with
+ *                      ``first``) or of this one, of
+ *                      ::MIN_HTTPD_ASSETS_DATE_LEN bytes.
+ * @param body          The buffer of the body, of ``len`` bytes at least.
+ * @return bool ``true`` if the content is intact.
+ */
+static bool min_httpd_partition_host_download(int sock,
+                                              const char* path,
+                                              const uint8_t* expected,
+                                              size_t len,
+                                              size_t first,
+                                              char* last_modified,
+                                              uint8_t* body) {
+    char buf[MIN_HTTPD_PARTITION_HOST_BUF_LEN];
+    int request_len =
+        (first == 0)
+            ? snprintf(buf, sizeof(buf), "GET %s HTTP/1.1\r\n\r\n", path)
+            : snprintf(buf,
+                       sizeof(buf),
+                       "GET %s HTTP/1.1\r\n"
+                       "Range: bytes=%zu-\r\n"
+                       "If-Range: %s\r\n"
+                       "\r\n",
+                       path,
+                       first,
+                       last_modified);
+    if (send(sock, buf, (size_t)request_len, MSG_NOSIGNAL) != request_len)
+        return false;
+
+    // The head is received byte by byte, so the body is not split
+    size_t got = 0;
+    while ((got < 4) || (memcmp(buf + got - 4, "\r\n\r\n", 4) != 0)) {
+        if ((got == sizeof(buf) - 1) || (recv(sock, buf + got, 1, 0) != 1))
+            return false;
+        got++;
+    }
+    buf[got] = '\0';
+
+    const char* status = (first == 0) ? "HTTP/1.1 200 OK\r\n"
+                                      : "HTTP/1.1 206 Partial Content\r\n";
+    unsigned int content_len = 0;
+    char* field = strstr(buf, "\r\nContent-Length: ");
+    if ((strncmp(buf, status, strlen(status)) != 0) || (field == NULL) ||
+        (sscanf(field, "\r\nContent-Length: %u", &content_len) != 1) ||
+        (content_len != len - first))
+        return false;
+    if (first == 0) {
+        char value[MIN_HTTPD_PARTITION_HOST_BUF_LEN];
+        if ((min_httpd_partition_host_header(buf,
+                                             "\r\nLast-Modified: ",
+                                             value) == NULL) ||
+            (strlen(value) >= MIN_HTTPD_ASSETS_DATE_LEN))
+            return false;
+        memcpy(last_modified, value, strlen(value) + 1);
+    }
+
+    for (got = 0; got < content_len;) {
+        ssize_t ret = recv(sock, body + got, content_len - got, 0);
+        if (ret <= 0)
+            return false;
+        got += (size_t)ret;
+    }
+    return memcmp(body, expected + first, content_len) == 0;
+}
+
+/**
+ * Download the large assets with the content mapped or copied.
+ *
+ * @param server  The server, without its listener.
+ * @param mapped  ``true`` to send the content from the mapped image.
+ * @param rounds  The number of downloads of every large asset.
+ * @param mb_s    The throughput in MB/s.
+ * @param resumed ``true`` if the downloads are resumed with ranges.
+ * @return bool ``true`` if all downloads are intact.
+ */
+static bool min_httpd_partition_host_run(
+    struct min_httpd_partition_host_server* server,
+    bool mapped,
+    uint32_t rounds,
+    double* mb_s,
+    bool* resumed) {
+    const size_t large = sizeof(min_httpd_partition_host_large) /
+                         sizeof(min_httpd_partition_host_large[0]);
+    uint8_t* expected[sizeof(min_httpd_partition_host_large) /
+                      sizeof(min_httpd_partition_host_large[0])];
+    size_t lens[sizeof(expected) / sizeof(expected[0])];
+    size_t max_len = 0;
+    char last_modified[MIN_HTTPD_ASSETS_DATE_LEN] = "";
+    bool ok = true;
+
+    for (size_t i = 0; i < large; i++) {
+        expected[i] =
+            min_httpd_partition_host_read(min_httpd_partition_host_large[i],
+                                          &lens[i]);
+        ok = ok && (expected[i] != NULL);
+        if (ok && (lens[i] > max_len))
+            max_len = lens[i];
+    }
+    uint8_t* body = ok ? malloc(max_len) : NULL;
+
+    server->mapped = mapped;
+    server->listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len = sizeof(address);
+    if ((body == NULL) ||
+        (bind(server->listener, (struct sockaddr*)&address, sizeof(address)) !=
+         0) ||
+        (listen(server->listener, 1) != 0) ||
+        (getsockname(server->listener,
+                     (struct sockaddr*)&address,
+                     &address_len) != 0)) {
+        perror("listen");
+        ok = false;
+    }
+
+    pthread_t thread;
+    bool serving = ok && (pthread_create(&thread,
+                                         NULL,
+                                         min_httpd_partition_host_serve,
+                                         server) == 0);
+    ok = ok && serving;
+
+    int sock = ok ? socket(AF_INET, SOCK_STREAM, 0) : -1;
+    ok = ok && (connect(sock,
+                        (const struct sockaddr*)&address,
+                        sizeof(address)) == 0);
+
+    size_t bytes = 0;
+    double start = min_httpd_partition_host_now();
+    for (uint32_t round = 0; ok && (round < rounds); round++) {
+        for (size_t i = 0; ok && (i < large); i++) {
+            ok = min_httpd_partition_host_download(
+                sock,
+                min_httpd_partition_host_large[i],
+                expected[i],
+                lens[i],
+                0,
+                last_modified,
+                body);
+            bytes += lens[i];
+        }
+    }
+    *mb_s = bytes / 1e6 / (min_httpd_partition_host_now() - start);
+
+    // Resume the downloads from the middle of the assets
+    *resumed = ok;
+    for (size_t i = 0; *resumed && (i < large); i++) {
+        *resumed = min_httpd_partition_host_download(
+            sock,
+            min_httpd_partition_host_large[i],
+            expected[i],
+            lens[i],
+            lens[i] / 2,
+            last_modified,
+            body);
+    }
+
+    if (sock >= 0)
+        close(sock);
+    if (serving)
+        pthread_join(thread, NULL);
+    close(server->listener);
+    for (size_t i = 0; i < large; i++)
+        free(expected[i]);
+    free(body);
+
+    printf("     %s: %.1f MB/s\n", mapped ? "mapped" : "copied", *mb_s);
+    return ok;
+}
+
+/**
+ * Run the benchmark.
+ *
+ * @param rounds The number of downloads of every large asset.
+ * @return int ``0`` if all checks passed.
+ */
+static int min_httpd_partition_host_bench(uint32_t rounds) {
+    int failures = 0;
+
+    if (rounds == 0) {
+        fprintf(stderr, "ROUNDS must be above 0!\n");
+        return 1;
+    }
+
+    // Map the image, like ``min_httpd_assets_mount()``
+    struct stat image_stat;
+    int fd = open(MIN_HTTPD_PARTITION_HOST_IMAGE, O_RDONLY);
+    if ((fd < 0) || (fstat(fd, &image_stat) != 0)) {
+        perror(MIN_HTTPD_PARTITION_HOST_IMAGE);
+        return 1;
+    }
+    size_t len = (size_t)image_stat.st_size;
+    const uint8_t* image = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    if (image == MAP_FAILED) {
+        perror("mmap");
+        close(fd);
+        return 1;
+    }
+
+    size_t count = min_httpd_assets_image_check(image, len);
+    host_check(&failures, count > 0, "Image is valid");
+    if (count == 0) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    struct min_httpd_asset* assets = malloc(count * sizeof(*assets));
+    struct min_httpd_asset_table table;
+    min_httpd_assets_image_open(image, assets, &table);
+    printf("     %zu assets, %zu bytes; table %zu bytes in RAM\n",
+           count,
+           len,
+           count * sizeof(*assets));
+
+    host_check(&failures,
+               min_httpd_partition_host_check_assets(&table),
+               "Assets are found with their content");
+    host_check(&failures,
+               min_httpd_partition_host_check_corrupted(image, len),
+               "Corrupted images are rejected");
+
+    struct min_httpd_partition_host_server server = {
+        .fd = fd,
+        .image = image,
+        .table = &table,
+    };
+    double mapped;
+    double copied;
+    bool resumed_mapped;
+    bool resumed_copied;
+    bool ok = min_httpd_partition_host_run(
+        &server, true, rounds, &mapped, &resumed_mapped);
+    ok = min_httpd_partition_host_run(
+             &server, false, rounds, &copied, &resumed_copied) &&
+         ok;
+    host_check(&failures, ok, "Downloads are intact");
+    host_check(
+        &failures, resumed_mapped && resumed_copied, "Downloads are resumed");
+
+    free(assets);
+    munmap((void*)image, len);
+    close(fd);
+
+    return host_check_summary(failures);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s bench [ROUNDS]\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "bench") == 0) {
+        return min_httpd_partition_host_bench(
+            (argc > 2) ? (uint32_t)atoi(argv[2])
+                       : MIN_HTTPD_PARTITION_HOST_ROUNDS);
+    }
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Host replacement of **ESP-IDF**'s ``esp_http_server.h`` for the routes.
+ *
+ * Only the types and functions, that are used by ``min_httpd_offload.c`` and
+ * ``min_httpd_limit.c``, are provided. The server does not parse requests:
+ * the requests are dispatched to the registered *URI handlers* by
+ * ``min_httpd_route_host.c``, which records the responses of every session.
+ *
+ * @file   esp_http_server.h
+ */
+
+#ifndef TOOLS_MIN_HTTPD_ROUTE_INCLUDE_ESP_HTTP_SERVER_H_
+#define TOOLS_MIN_HTTPD_ROUTE_INCLUDE_ESP_HTTP_SERVER_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "esp_err.h"
+
+/**
+ * The maximum length of a request's URI.
+ */
+#define HTTPD_MAX_URI_LEN 512
+
+#define HTTPD_RESP_USE_STRLEN -1
+#define HTTPD_SOCK_ERR_FAIL -1
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+
+/**
+ * The methods, with the values of ``http_parser``.
+ *
+ * The frames of a WebSocket are dispatched with ``HTTP_DELETE``, as the
+ * server clears the request of a frame.
+ */
+typedef enum {
+    HTTP_DELETE = 0,
+    HTTP_GET = 1,
+    HTTP_HEAD = 2,
+    HTTP_POST = 3,
+} httpd_method_t;
+
+typedef void* httpd_handle_t;
+
+typedef void (*httpd_work_fn_t)(void* arg);
+
+/**
+ * A request.
+ *
+ * ``aux`` is the session of the request (see ``min_httpd_route_host.c``).
+ */
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int method;
+    char uri[HTTPD_MAX_URI_LEN + 1];
+    size_t content_len;
+    void* aux;
+    void* user_ctx;
+} httpd_req_t;
+
+typedef struct httpd_uri {
+    const char* uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t* r);
+    void* user_ctx;
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    bool is_websocket;
+#endif
+} httpd_uri_t;
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
+                                     const httpd_uri_t* uri_handler);
+int httpd_req_to_sockfd(httpd_req_t* r);
+int httpd_req_recv(httpd_req_t* r, char* buf, size_t buf_len);
+esp_err_t httpd_resp_set_status(httpd_req_t* r, const char* status);
+esp_err_t httpd_resp_send(httpd_req_t* r, const char* buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_408(httpd_req_t* r);
+int httpd_send(httpd_req_t* r, const char* buf, size_t buf_len);
+int httpd_socket_send(httpd_handle_t hd,
+                      int sockfd,
+                      const char* buf,
+                      size_t buf_len,
+                      int flags);
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd);
+
+#endif  // TOOLS_MIN_HTTPD_ROUTE_INCLUDE_ESP_HTTP_SERVER_H_
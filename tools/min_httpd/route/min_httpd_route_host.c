@@ -0,0 +1,754 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Verify the admission of the routes of the ``min_httpd`` component on a
+ * Linux host.
+ *
+ * ``min_httpd_offload.c`` and ``min_httpd_limit.c`` are compiled unmodified
+ * against a fake ``esp_http_server`` (see ``include/esp_http_server.h``), the
+ * fake FreeRTOS and ESP-IDF headers of ``tools/mnet32/sim`` and the fakes of
+ * this file. The server does not parse requests, they are dispatched to the
+ * registered *URI handlers* directly. The worker tasks are created, but never
+ * run, so the jobs of offloaded routes stay pending:
+ *
+ *   - ``min_httpd_route_host check`` registers inline and offloaded routes,
+ *     a WebSocket endpoint and routes with the costs of the upgrades and the
+ *     firmware upload. Every registered *URI handler* must shed requests
+ *     below the minimum free heap, before the route's handler is executed,
+ *     and must take the tokens of its route; the frames of a WebSocket must
+ *     pass. A request, that is pipelined behind an offloaded job, must be
+ *     refused without a response, whatever its route. Finally, the
+ *     component's sources are searched for *URI handlers*, that are not
+ *     registered as routes, for requests, that are admitted by passing
+ *     ``min_httpd_offload_admit()``, and for routes without a cost.
+ *
+ * @file   min_httpd_route_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ``nftw()`` is part of the X/Open System Interfaces. */
+#define _XOPEN_SOURCE 700
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <arpa/inet.h>
+#include <ftw.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* The component, compiled against the fakes. */
+#include "min_httpd/min_httpd.h"
+#include "min_httpd_internal.h"
+
+/* The fakes of ESP-IDF and FreeRTOS. */
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The maximum number of registered *URI handlers*.
+ */
+#define MIN_HTTPD_ROUTE_HOST_MAX_URIS 16
+
+/**
+ * The maximum length of the responses of a request, that are recorded.
+ */
+#define MIN_HTTPD_ROUTE_HOST_SENT_LEN 256
+
+/**
+ * The maximum number of items of the workers' queue.
+ */
+#define MIN_HTTPD_ROUTE_HOST_QUEUE_LEN 16
+
+/**
+ * The number of sessions on the loopback interface.
+ */
+#define MIN_HTTPD_ROUTE_HOST_CLIENTS 4
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A session of the fake server.
+ *
+ * ``sockfd`` is either a socket on the loopback interface, so the client's
+ * address is determined like on the target, or a number, that is not a
+ * socket, so the rate limiting does not apply.
+ */
+struct min_httpd_route_host_session {
+    int sockfd;
+    const char* body;
+    size_t body_off;
+    const char* status;
+    char sent[MIN_HTTPD_ROUTE_HOST_SENT_LEN];
+    size_t sent_len;
+};
+
+/**
+ * The fake queue of the workers, which only stores the items.
+ */
+struct sim_queue {
+    UBaseType_t item_size;
+    size_t count;
+    uint8_t items[MIN_HTTPD_ROUTE_HOST_QUEUE_LEN][sizeof(void*)];
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * The fake server, only its address is used.
+ */
+static int min_httpd_route_host_server;
+
+/**
+ * The registered *URI handlers*.
+ */
+static httpd_uri_t min_httpd_route_host_uris[MIN_HTTPD_ROUTE_HOST_MAX_URIS];
+
+/**
+ * The number of ::min_httpd_route_host_uris .
+ */
+static size_t min_httpd_route_host_uri_count = 0;
+
+/**
+ * The queue of the workers.
+ */
+static struct sim_queue min_httpd_route_host_queue;
+
+/**
+ * The free heap, as reported by ``esp_get_free_heap_size()``.
+ */
+static uint32_t min_httpd_route_host_heap = 65536;
+
+/**
+ * The number of executions of the routes' handlers.
+ */
+static unsigned int min_httpd_route_host_executed = 0;
+
+/**
+ * The number of frames, that were passed to the WebSocket's handler.
+ */
+static unsigned int min_httpd_route_host_frames = 0;
+
+/* Provided by ``min_httpd_metrics.c`` and ``min_httpd_trace.c`` on the
+ * target.
+ */
+struct obs32_metric_counter min_httpd_metrics_inline = {0};
+struct obs32_metric_counter min_httpd_metrics_offloaded = {0};
+struct obs32_metric_counter min_httpd_metrics_limited = {0};
+struct obs32_metric_counter min_httpd_metrics_shed = {0};
+struct obs32_metric_histogram min_httpd_metrics_inline_us = {0};
+struct obs32_metric_histogram min_httpd_metrics_offloaded_us = {0};
+struct obs32_trace_group min_httpd_trace_group = {0};
+
+
+/* ***** FAKES ************************************************************* */
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
+                                     const httpd_uri_t* uri_handler) {
+    if (min_httpd_route_host_uri_count >= MIN_HTTPD_ROUTE_HOST_MAX_URIS)
+        return ESP_ERR_NO_MEM;
+    min_httpd_route_host_uris[min_httpd_route_host_uri_count++] =
+        *uri_handler;
+    return ESP_OK;
+}
+
+int httpd_req_to_sockfd(httpd_req_t* r) {
+    return ((struct min_httpd_route_host_session*)r->aux)->sockfd;
+}
+
+int httpd_req_recv(httpd_req_t* r, char* buf, size_t buf_len) {
+    struct min_httpd_route_host_session* session = r->aux;
+    size_t len = r->content_len - session->body_off;
+
+    if (len > buf_len)
+        len = buf_len;
+    memcpy(buf, session->body + session->body_off, len);
+    session->body_off += len;
+    return (int)len;
+}
+
+int httpd_send(httpd_req_t* r, const char* buf, size_t buf_len) {
+    struct min_httpd_route_host_session* session = r->aux;
+    size_t len = sizeof(session->sent) - 1 - session->sent_len;
+
+    if (len > buf_len)
+        len = buf_len;
+    memcpy(session->sent + session->sent_len, buf, len);
+    session->sent_len += len;
+    session->sent[session->sent_len] = '\0';
+    return (int)buf_len;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t* r, const char* status) {
+    ((struct min_httpd_route_host_session*)r->aux)->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t* r, const char* buf, ssize_t buf_len) {
+    struct min_httpd_route_host_session* session = r->aux;
+    char head[64];
+
+    int len = snprintf(head,
+                       sizeof(head),
+                       "HTTP/1.1 %s\r\n\r\n",
+                       (session->status != NULL) ? session->status : "200 OK");
+    httpd_send(r, head, (size_t)len);
+    if (buf != NULL)
+        httpd_send(r,
+                   buf,
+                   (buf_len == HTTPD_RESP_USE_STRLEN) ? strlen(buf)
+                                                      : (size_t)buf_len);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_408(httpd_req_t* r) {
+    httpd_resp_set_status(r, "408 Request Timeout");
+    return httpd_resp_send(r, NULL, 0);
+}
+
+int httpd_socket_send(httpd_handle_t hd,
+                      int sockfd,
+                      const char* buf,
+                      size_t buf_len,
+                      int flags) {
+    return (int)buf_len;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd) {
+    return ESP_OK;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    if (item_size > sizeof(min_httpd_route_host_queue.items[0]))
+        return NULL;
+    min_httpd_route_host_queue.item_size = item_size;
+    return &min_httpd_route_host_queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue,
+                      const void* item,
+                      TickType_t ticks_to_wait) {
+    if (queue->count >= MIN_HTTPD_ROUTE_HOST_QUEUE_LEN)
+        return errQUEUE_FULL;
+    memcpy(queue->items[queue->count++], item, queue->item_size);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue,
+                         void* buffer,
+                         TickType_t ticks_to_wait) {
+    if (queue->count == 0)
+        return pdFALSE;
+    memcpy(buffer, queue->items[--queue->count], queue->item_size);
+    return pdTRUE;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_code,
+                                   const char* name,
+                                   uint32_t stack_depth,
+                                   void* parameters,
+                                   UBaseType_t priority,
+                                   TaskHandle_t* created_task,
+                                   BaseType_t core_id) {
+    // The workers never run, so the jobs stay pending
+    return pdPASS;
+}
+
+void esp_log_write(esp_log_level_t level,
+                   const char* tag,
+                   const char* format,
+                   ...) {}
+
+int64_t esp_timer_get_time(void) {
+    return 0;
+}
+
+uint32_t esp_get_free_heap_size(void) {
+    return min_httpd_route_host_heap;
+}
+
+void min_httpd_log_message(httpd_req_t* request, esp_err_t success) {}
+
+esp_err_t min_httpd_queue_work(httpd_work_fn_t work, void* arg) {
+    work(arg);
+    return ESP_OK;
+}
+
+
+/* ***** ROUTES ************************************************************ */
+
+/**
+ * The handler of the inline routes, that responds with ``200 OK``.
+ *
+ * @param request The request.
+ * @return esp_err_t ``ESP_OK``.
+ */
+static esp_err_t min_httpd_route_host_handler(httpd_req_t* request) {
+    min_httpd_route_host_executed++;
+    if (request->method == HTTP_DELETE)
+        min_httpd_route_host_frames++;
+    else
+        httpd_resp_send(request, "ok", HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+/**
+ * The handler of the offloaded route, that responds with ``200 OK``.
+ *
+ * @param job The request.
+ * @return esp_err_t ``ESP_OK``.
+ */
+static esp_err_t min_httpd_route_host_job_handler(struct min_httpd_job* job) {
+    min_httpd_route_host_executed++;
+    return min_httpd_job_respond(job, NULL, "text/plain", "ok", 2);
+}
+
+static const struct min_httpd_route min_httpd_route_host_inline = {
+    .uri = "/inline",
+    .method = HTTP_GET,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = min_httpd_route_host_handler,
+    .cost = MIN_HTTPD_LIMIT_COST_INLINE};
+
+static const struct min_httpd_route min_httpd_route_host_offloaded = {
+    .uri = "/offloaded",
+    .method = HTTP_POST,
+    .mode = MIN_HTTPD_ROUTE_OFFLOADED,
+    .job_handler = min_httpd_route_host_job_handler,
+    .cost = MIN_HTTPD_LIMIT_COST_OFFLOADED};
+
+static const struct min_httpd_route min_httpd_route_host_events = {
+    .uri = "/events",
+    .method = HTTP_GET,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = min_httpd_route_host_handler,
+    .cost = MIN_HTTPD_LIMIT_COST_UPGRADE};
+
+static const struct min_httpd_route min_httpd_route_host_ws = {
+    .uri = "/ws",
+    .method = HTTP_GET,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = min_httpd_route_host_handler,
+    .cost = MIN_HTTPD_LIMIT_COST_UPGRADE,
+    .websocket = true};
+
+static const struct min_httpd_route min_httpd_route_host_ota = {
+    .uri = "/ota",
+    .method = HTTP_POST,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = min_httpd_route_host_handler,
+    .cost = MIN_HTTPD_LIMIT_COST_OTA};
+
+static const struct min_httpd_route min_httpd_route_host_free = {
+    .uri = "/free",
+    .method = HTTP_GET,
+    .mode = MIN_HTTPD_ROUTE_INLINE,
+    .handler = min_httpd_route_host_handler};
+
+static const struct min_httpd_route min_httpd_route_host_ws_offloaded = {
+    .uri = "/ws_offloaded",
+    .method = HTTP_GET,
+    .mode = MIN_HTTPD_ROUTE_OFFLOADED,
+    .job_handler = min_httpd_route_host_job_handler,
+    .cost = MIN_HTTPD_LIMIT_COST_OFFLOADED,
+    .websocket = true};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Find a registered *URI handler*.
+ *
+ * @param uri    The URI.
+ * @param method The method.
+ * @return const httpd_uri_t* The *URI handler*, ``NULL`` if there is none.
+ */
+static const httpd_uri_t* min_httpd_route_host_find(const char* uri,
+                                                    httpd_method_t method) {
+    for (size_t i = 0; i < min_httpd_route_host_uri_count; i++) {
+        if ((strcmp(min_httpd_route_host_uris[i].uri, uri) == 0) &&
+            (min_httpd_route_host_uris[i].method == method))
+            return &min_httpd_route_host_uris[i];
+    }
+    return NULL;
+}
+
+/**
+ * Dispatch a request to a *URI handler*, like the server's task.
+ *
+ * The responses of the request are recorded in the session.
+ *
+ * @param uri     The *URI handler*.
+ * @param method  The request's method, ``HTTP_DELETE`` for a WebSocket's
+ *                frame.
+ * @param session The session.
+ * @param body    The request's body, ``NULL`` for none.
+ * @return esp_err_t The return value of the *URI handler*.
+ */
+static esp_err_t min_httpd_route_host_dispatch(
+    const httpd_uri_t* uri,
+    httpd_method_t method,
+    struct min_httpd_route_host_session* session,
+    const char* body) {
+    httpd_req_t request = {0};
+
+    request.handle = &min_httpd_route_host_server;
+    request.method = method;
+    snprintf(request.uri, sizeof(request.uri), "%s", uri->uri);
+    request.content_len = (body != NULL) ? strlen(body) : 0;
+    request.aux = session;
+    request.user_ctx = uri->user_ctx;
+
+    session->body = body;
+    session->body_off = 0;
+    session->status = NULL;
+    session->sent_len = 0;
+    session->sent[0] = '\0';
+    return uri->handler(&request);
+}
+
+/**
+ * Dispatch a request and determine, whether it was admitted.
+ *
+ * @param uri     The URI of the route.
+ * @param method  The method of the route.
+ * @param session The session.
+ * @return bool ``true`` if the route's handler was executed, or its job was
+ *              queued.
+ */
+static bool min_httpd_route_host_admitted(
+    const char* uri,
+    httpd_method_t method,
+    struct min_httpd_route_host_session* session) {
+    const httpd_uri_t* handler = min_httpd_route_host_find(uri, method);
+    unsigned int executed = min_httpd_route_host_executed;
+    size_t queued = min_httpd_route_host_queue.count;
+
+    if (handler == NULL)
+        return false;
+    min_httpd_route_host_dispatch(handler, method, session, "a=b");
+    return (min_httpd_route_host_executed != executed) ||
+           (min_httpd_route_host_queue.count != queued);
+}
+
+/**
+ * Open sessions on the loopback interface.
+ *
+ * @param sessions The sessions, whose ``sockfd`` are set.
+ * @param count    The number of sessions.
+ * @return bool ``true`` on success.
+ */
+static bool min_httpd_route_host_connect(
+    struct min_httpd_route_host_session* sessions,
+    size_t count) {
+    struct sockaddr_in addr = {0};
+    socklen_t addr_len = sizeof(addr);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((listener < 0) ||
+        (bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0) ||
+        (getsockname(listener, (struct sockaddr*)&addr, &addr_len) != 0) ||
+        (listen(listener, (int)count) != 0))
+        return false;
+
+    for (size_t i = 0; i < count; i++) {
+        sessions[i].sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        if ((sessions[i].sockfd < 0) ||
+            (connect(sessions[i].sockfd,
+                     (struct sockaddr*)&addr,
+                     sizeof(addr)) != 0))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * The number of *URI handlers* of the firmware, that are not registered as
+ * routes, found by ::min_httpd_route_host_scan_file .
+ */
+static unsigned int min_httpd_route_host_unrouted = 0;
+
+/**
+ * The number of admissions of the firmware, that pass
+ * ``min_httpd_offload_admit()``, found by ::min_httpd_route_host_scan_file .
+ */
+static unsigned int min_httpd_route_host_bypassed = 0;
+
+/**
+ * The number of routes of the firmware, found by
+ * ::min_httpd_route_host_scan_file .
+ */
+static unsigned int min_httpd_route_host_routes = 0;
+
+/**
+ * The number of routes of the firmware without a cost, found by
+ * ::min_httpd_route_host_scan_file .
+ */
+static unsigned int min_httpd_route_host_costless = 0;
+
+/**
+ * Search a source file for *URI handlers*, that are not registered as
+ * routes, for admissions, that pass ``min_httpd_offload_admit()``, and for
+ * routes without a cost.
+ *
+ * This is the callback of ``nftw()``.
+ *
+ * @param path The path of the file.
+ * @param sb   Unused.
+ * @param type The type of the file.
+ * @param ftw  The position of the file's name in ``path``.
+ * @return int ``0`` to continue.
+ */
+static int min_httpd_route_host_scan_file(const char* path,
+                                          const struct stat* sb,
+                                          int type,
+                                          struct FTW* ftw) {
+    size_t len = strlen(path);
+    if ((type != FTW_F) || (len < 2) || (strcmp(path + len - 2, ".c") != 0))
+        return 0;
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return 0;
+    static char source[256 * 1024];
+    size_t source_len = fread(source, 1, sizeof(source) - 1, file);
+    fclose(file);
+    source[source_len] = '\0';
+
+    // Only the routes register URI handlers
+    if ((strcmp(path + ftw->base, "min_httpd_offload.c") != 0) &&
+        (strstr(source, "httpd_register_uri_handler(") != NULL)) {
+        printf("     %s registers a URI handler\n", path);
+        min_httpd_route_host_unrouted++;
+    }
+
+    // Only the central admission refuses pipelined requests
+    if ((strcmp(path + ftw->base, "min_httpd_offload.c") != 0) &&
+        (strcmp(path + ftw->base, "min_httpd_limit.c") != 0) &&
+        (strstr(source, "min_httpd_limit_admit(") != NULL)) {
+        printf("     %s admits requests by their rate only\n", path);
+        min_httpd_route_host_bypassed++;
+    }
+
+    const char* route = source;
+    while ((route = strstr(route, "struct min_httpd_route ")) != NULL) {
+        const char* open = strchr(route, '{');
+        const char* end = strchr(route, ';');
+        route += strlen("struct min_httpd_route ");
+        // Only definitions with an initializer
+        if ((open == NULL) || (end == NULL) || (open > end))
+            continue;
+
+        end = strstr(open, "};");
+        if (end == NULL)
+            continue;
+        min_httpd_route_host_routes++;
+
+        const char* cost = strstr(open, ".cost");
+        if ((cost == NULL) || (cost > end)) {
+            printf("     %s has a route without a cost\n", path);
+            min_httpd_route_host_costless++;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Verify the admission of the routes.
+ *
+ * @return int The exit code, ``0`` if all checks passed.
+ */
+static int min_httpd_route_host_check(void) {
+    int failures = 0;
+    httpd_handle_t server = &min_httpd_route_host_server;
+
+    min_httpd_offload_attach(server);
+    min_httpd_limit_reset();
+
+    bool ok = (min_httpd_register_route(server,
+                                        &min_httpd_route_host_inline) ==
+               ESP_OK) &&
+              (min_httpd_register_route(server,
+                                        &min_httpd_route_host_offloaded) ==
+               ESP_OK) &&
+              (min_httpd_register_route(server,
+                                        &min_httpd_route_host_events) ==
+               ESP_OK) &&
+              (min_httpd_register_route(server, &min_httpd_route_host_ws) ==
+               ESP_OK) &&
+              (min_httpd_register_route(server, &min_httpd_route_host_ota) ==
+               ESP_OK);
+    host_check(&failures,
+               ok && (min_httpd_route_host_uri_count == 5),
+               "Routes with a cost are registered");
+
+    ok = (min_httpd_register_route(server, &min_httpd_route_host_free) ==
+          ESP_ERR_INVALID_ARG) &&
+         (min_httpd_register_route(server,
+                                   &min_httpd_route_host_ws_offloaded) ==
+          ESP_ERR_INVALID_ARG);
+    host_check(&failures,
+               ok && (min_httpd_route_host_uri_count == 5),
+               "Routes without a cost and offloaded WebSockets are refused");
+
+    /* Every URI handler, that was registered, admits its requests */
+    min_httpd_route_host_heap = MIN_HTTPD_LIMIT_MIN_HEAP - 1;
+    ok = true;
+    for (size_t i = 0; i < min_httpd_route_host_uri_count; i++) {
+        struct min_httpd_route_host_session session = {.sockfd = 1000 + i};
+        const httpd_uri_t* uri = &min_httpd_route_host_uris[i];
+        if (min_httpd_route_host_admitted(uri->uri, uri->method, &session) ||
+            (strstr(session.sent, "503") == NULL)) {
+            printf("     '%s' was not shed\n", uri->uri);
+            ok = false;
+        }
+    }
+    min_httpd_route_host_heap = MIN_HTTPD_LIMIT_MIN_HEAP;
+    host_check(&failures,
+               ok,
+               "Every URI handler sheds requests below the minimum heap");
+
+    struct min_httpd_route_host_session clients[MIN_HTTPD_ROUTE_HOST_CLIENTS] =
+        {0};
+    host_check(&failures,
+               min_httpd_route_host_connect(clients,
+                                            MIN_HTTPD_ROUTE_HOST_CLIENTS),
+               "Sessions on the loopback interface are opened");
+
+    /* The bucket holds 10 tokens (see ``CMakeLists.txt``) */
+    min_httpd_limit_reset();
+    ok = min_httpd_route_host_admitted("/ota", HTTP_POST, &clients[0]) &&
+         !min_httpd_route_host_admitted("/ota", HTTP_POST, &clients[0]) &&
+         (strstr(clients[0].sent, "429") != NULL) &&
+         min_httpd_route_host_admitted("/inline", HTTP_GET, &clients[0]) &&
+         min_httpd_route_host_admitted("/inline", HTTP_GET, &clients[0]) &&
+         !min_httpd_route_host_admitted("/inline", HTTP_GET, &clients[0]);
+    host_check(&failures, ok, "An inline request takes its route's tokens");
+
+    // Every job stays pending, so every session takes one request
+    min_httpd_limit_reset();
+    ok = min_httpd_route_host_admitted("/offloaded", HTTP_POST, &clients[0]) &&
+         min_httpd_route_host_admitted("/offloaded", HTTP_POST, &clients[1]) &&
+         !min_httpd_route_host_admitted("/offloaded",
+                                        HTTP_POST,
+                                        &clients[2]) &&
+         (strstr(clients[2].sent, "429") != NULL);
+    host_check(&failures, ok, "An offloaded request takes its route's tokens");
+
+    // The jobs of the first sessions are pending, whatever the route
+    min_httpd_limit_reset();
+    ok = true;
+    for (size_t i = 0; i < min_httpd_route_host_uri_count; i++) {
+        const httpd_uri_t* uri = &min_httpd_route_host_uris[i];
+        unsigned int executed = min_httpd_route_host_executed;
+        size_t queued = min_httpd_route_host_queue.count;
+        if ((min_httpd_route_host_dispatch(uri,
+                                           uri->method,
+                                           &clients[0],
+                                           "a=b") != ESP_FAIL) ||
+            (min_httpd_route_host_executed != executed) ||
+            (min_httpd_route_host_queue.count != queued) ||
+            (clients[0].sent_len != 0)) {
+            printf("     '%s' overtook the pending job\n", uri->uri);
+            ok = false;
+        }
+    }
+    host_check(&failures,
+               ok,
+               "A request pipelined behind an offloaded job is refused");
+
+    host_check(&failures,
+               min_httpd_route_host_admitted("/inline", HTTP_GET, &clients[3]),
+               "The requests of other sessions are admitted");
+
+    min_httpd_limit_reset();
+    ok = min_httpd_route_host_admitted("/events", HTTP_GET, &clients[3]) &&
+         min_httpd_route_host_admitted("/ws", HTTP_GET, &clients[3]) &&
+         !min_httpd_route_host_admitted("/ws", HTTP_GET, &clients[3]);
+    host_check(&failures, ok, "An upgrade takes its route's tokens");
+
+    // The server responded to the handshake already
+    host_check(&failures,
+               min_httpd_route_host_dispatch(
+                   min_httpd_route_host_find("/ws", HTTP_GET),
+                   HTTP_GET,
+                   &clients[3],
+                   NULL) == ESP_FAIL,
+               "The session of a refused WebSocket is closed");
+
+    // The bucket is empty and the heap is exhausted
+    min_httpd_route_host_heap = 0;
+    unsigned int frames = min_httpd_route_host_frames;
+    ok = (min_httpd_route_host_dispatch(
+              min_httpd_route_host_find("/ws", HTTP_GET),
+              HTTP_DELETE,
+              &clients[3],
+              NULL) == ESP_OK) &&
+         (clients[3].sent_len == 0) &&
+         (min_httpd_route_host_frames == frames + 1);
+    min_httpd_route_host_heap = MIN_HTTPD_LIMIT_MIN_HEAP;
+    host_check(&failures,
+               ok,
+               "The frames of a WebSocket pass without admission");
+
+    for (size_t i = 0; i < MIN_HTTPD_ROUTE_HOST_CLIENTS; i++)
+        close(clients[i].sockfd);
+
+    /* The routes of the firmware */
+    ok = nftw(MIN_HTTPD_ROUTE_HOST_SRC_DIR,
+              min_httpd_route_host_scan_file,
+              16,
+              FTW_PHYS) == 0;
+    host_check(&failures,
+               ok && (min_httpd_route_host_unrouted == 0),
+               "Only min_httpd_register_route() registers URI handlers");
+    host_check(&failures,
+               ok && (min_httpd_route_host_bypassed == 0),
+               "Every request is admitted by min_httpd_offload_admit()");
+    printf("     %u routes of the firmware\n", min_httpd_route_host_routes);
+    host_check(&failures,
+               (min_httpd_route_host_routes > 0) &&
+                   (min_httpd_route_host_costless == 0),
+               "Every route of the firmware has a cost");
+
+    return host_check_summary(failures);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s check\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "check") == 0)
+        return min_httpd_route_host_check();
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,603 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Run the Server-Sent Events stream of the ``min_httpd`` component on a
+ * Linux host.
+ *
+ * The stream's engine is compiled unmodified and loaded with clients on the
+ * loopback interface. The head of the response is sent by the handler on the
+ * device, so the clients only receive events:
+ *
+ *   - ``min_httpd_sse_host loopback [CLIENTS [EVENTS]]`` verifies the wire
+ *     format of events, coalescing, dropping and retained events, then
+ *     publishes ``EVENTS`` to ``CLIENTS`` (verifying every event they receive)
+ *     and finally streams large events to a slow client, whose events are
+ *     sent partially, and closes a client.
+ *
+ * Every event carries its sequence number, so clients detect events, that
+ * were received out of order or cut.
+ *
+ * @file   min_httpd_sse_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* The stream's engine. */
+#include "min_httpd_sse_engine.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The default number of clients of the loopback test.
+ */
+#define MIN_HTTPD_SSE_HOST_CLIENTS 3
+
+/**
+ * The default number of events of the loopback test.
+ */
+#define MIN_HTTPD_SSE_HOST_EVENTS 20000
+
+/**
+ * The maximum number of clients.
+ */
+#define MIN_HTTPD_SSE_HOST_MAX_CLIENTS 16
+
+/**
+ * The maximum length of an event's data, just like
+ * ``MIN_HTTPD_SSE_MAX_EVENT_LEN``.
+ */
+#define MIN_HTTPD_SSE_HOST_DATA_LEN 512
+
+/**
+ * The length of the sequence number, that starts every event's data.
+ */
+#define MIN_HTTPD_SSE_HOST_SEQ_LEN 10
+
+/**
+ * The number of names of the slow client's events.
+ */
+#define MIN_HTTPD_SSE_HOST_NAMES 12
+
+/**
+ * The number of events of the slow client.
+ */
+#define MIN_HTTPD_SSE_HOST_SLOW_EVENTS 2000
+
+/**
+ * The socket buffers of the slow client, so events are sent partially.
+ */
+#define MIN_HTTPD_SSE_HOST_SLOW_BUF 2048
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A client, receiving and verifying events in its own thread.
+ */
+struct min_httpd_sse_host_client {
+    int socket;
+    pthread_t thread;
+    bool slow;  // read in small pieces with a delay
+    uint32_t received;
+    uint32_t invalid;  // malformed or reordered events
+    uint32_t last[MIN_HTTPD_SSE_HOST_NAMES];  // the last sequence number + 1
+                                              // per name
+};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get the current time.
+ *
+ * @return double The time in seconds.
+ */
+static double min_httpd_sse_host_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Build the data of an event.
+ *
+ * The data is the sequence number, followed by a character, that depends on
+ * the sequence number. Its length varies between the sequence number's length
+ * and ::MIN_HTTPD_SSE_HOST_DATA_LEN .
+ *
+ * @param buf The buffer.
+ * @param seq The sequence number.
+ * @return size_t The length of the data.
+ */
+static size_t min_httpd_sse_host_data(char* buf, uint32_t seq) {
+    size_t len = MIN_HTTPD_SSE_HOST_SEQ_LEN +
+                 (seq * 37) % (MIN_HTTPD_SSE_HOST_DATA_LEN -
+                               MIN_HTTPD_SSE_HOST_SEQ_LEN + 1);
+    char digits[MIN_HTTPD_SSE_HOST_SEQ_LEN + 1];
+    snprintf(digits, sizeof(digits), "%010u", seq);
+    memcpy(buf, digits, MIN_HTTPD_SSE_HOST_SEQ_LEN);
+    memset(buf + MIN_HTTPD_SSE_HOST_SEQ_LEN,
+           'a' + seq % 26,
+           len - MIN_HTTPD_SSE_HOST_SEQ_LEN);
+    return len;
+}
+
+/**
+ * Build the event of a sequence number.
+ *
+ * The name is ``nX`` with ``X = seq % names``.
+ *
+ * @param seq   The sequence number.
+ * @param names The number of names.
+ * @return struct min_httpd_sse_event* The event.
+ */
+static struct min_httpd_sse_event* min_httpd_sse_host_event(uint32_t seq,
+                                                            uint32_t names) {
+    char name[MIN_HTTPD_SSE_NAME_LEN];
+    char data[MIN_HTTPD_SSE_HOST_DATA_LEN];
+
+    snprintf(name, sizeof(name), "n%u", seq % names);
+    size_t len = min_httpd_sse_host_data(data, seq);
+    return min_httpd_sse_event_create(name, data, len);
+}
+
+/**
+ * Verify a received event.
+ *
+ * The sequence numbers of every name must increase, events of different
+ * names may be reordered by coalescing.
+ *
+ * @param client The client.
+ * @param text   The event, without the terminating empty line.
+ * @param len    The length of the event.
+ * @return bool ``true`` if the event is valid.
+ */
+static bool min_httpd_sse_host_verify(struct min_httpd_sse_host_client* client,
+                                      const char* text,
+                                      size_t len) {
+    unsigned int index;
+    int offset = 0;
+    if ((sscanf(text, "event: n%u\ndata: %n", &index, &offset) != 1) ||
+        (offset == 0) || (index >= MIN_HTTPD_SSE_HOST_NAMES))
+        return false;
+
+    const char* data = text + offset;
+    size_t data_len = len - (size_t)offset - 1;
+    if ((data_len < MIN_HTTPD_SSE_HOST_SEQ_LEN) || (text[len - 1] != '\n'))
+        return false;
+
+    char expected[MIN_HTTPD_SSE_HOST_DATA_LEN];
+    uint32_t seq = (uint32_t)strtoul(data, NULL, 10);
+    if ((min_httpd_sse_host_data(expected, seq) != data_len) ||
+        (memcmp(expected, data, data_len) != 0))
+        return false;
+
+    if (seq + 1 <= client->last[index])
+        return false;
+    client->last[index] = seq + 1;
+    return true;
+}
+
+/**
+ * Receive and verify events, until the server closes the connection.
+ *
+ * @param arg The client (::min_httpd_sse_host_client ).
+ * @return void* Always ``NULL``.
+ */
+static void* min_httpd_sse_host_client_run(void* arg) {
+    struct min_httpd_sse_host_client* client = arg;
+    size_t size = 4 * MIN_HTTPD_SSE_HOST_DATA_LEN;
+    char* buf = malloc(size);
+    size_t len = 0;
+
+    for (;;) {
+        size_t chunk = client->slow ? 97 : size - len;
+        if (chunk > size - len)
+            chunk = size - len;
+        ssize_t ret = recv(client->socket, buf + len, chunk, 0);
+        if (ret <= 0)
+            break;
+        len += (size_t)ret;
+        if (client->slow)
+            usleep(50);
+
+        /* Events are terminated by an empty line. */
+        size_t start = 0;
+        for (size_t i = 1; i < len; i++) {
+            if ((buf[i - 1] != '\n') || (buf[i] != '\n'))
+                continue;
+            if (min_httpd_sse_host_verify(client, buf + start, i - start))
+                client->received++;
+            else
+                client->invalid++;
+            start = i + 1;
+            i++;
+        }
+        memmove(buf, buf + start, len - start);
+        len -= start;
+        if (len == size) {
+            client->invalid++;
+            break;
+        }
+    }
+
+    free(buf);
+    return NULL;
+}
+
+/**
+ * Connect a client and start its thread.
+ *
+ * @param listener The listening socket of the server.
+ * @param address  The address of the server.
+ * @param client   The client.
+ * @return int The server's socket of the client, ``-1`` on failure.
+ */
+static int min_httpd_sse_host_connect(
+    int listener,
+    const struct sockaddr_in* address,
+    struct min_httpd_sse_host_client* client) {
+    int buf = MIN_HTTPD_SSE_HOST_SLOW_BUF;
+
+    client->socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (client->slow)
+        setsockopt(client->socket, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+
+    if (connect(client->socket,
+                (const struct sockaddr*)address,
+                sizeof(*address)) != 0) {
+        perror("connect");
+        return -1;
+    }
+
+    int server_socket = accept(listener, NULL, NULL);
+    if (server_socket < 0) {
+        perror("accept");
+        return -1;
+    }
+    if (client->slow)
+        setsockopt(server_socket, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+
+    pthread_create(&client->thread,
+                   NULL,
+                   min_httpd_sse_host_client_run,
+                   client);
+    return server_socket;
+}
+
+/**
+ * Flush the clients, until all queues are empty.
+ *
+ * Removed clients are shut down, just like the device closes their sessions.
+ *
+ * @param clients The clients.
+ * @return size_t The number of flushes, that left events queued.
+ */
+static size_t min_httpd_sse_host_drain(struct min_httpd_sse_clients* clients) {
+    int closed[MIN_HTTPD_SSE_HOST_MAX_CLIENTS];
+    size_t partial = 0;
+
+    for (;;) {
+        size_t count = min_httpd_sse_clients_flush(clients, closed);
+        for (size_t i = 0; i < count; i++)
+            shutdown(closed[i], SHUT_RDWR);
+
+        bool queued = false;
+        for (size_t i = 0; i < clients->size; i++) {
+            if ((clients->clients[i].socket >= 0) &&
+                (clients->clients[i].count > 0))
+                queued = true;
+        }
+        if (!queued)
+            return partial;
+        partial++;
+        usleep(100);
+    }
+}
+
+/**
+ * Verify the wire format of events.
+ *
+ * @param failures The number of failures.
+ */
+static void min_httpd_sse_host_format(int* failures) {
+    static const char* const expected[] = {
+        "event: status\ndata: {\"a\":1}\n\n",
+        "event: x\ndata: \n\n",
+        "event: multi\ndata: one\ndata: \ndata: three\n\n",
+        "event: y\ndata: \ndata: \n\n"};
+    struct min_httpd_sse_event* events[] = {
+        min_httpd_sse_event_create("status", "{\"a\":1}", 7),
+        min_httpd_sse_event_create("x", NULL, 0),
+        min_httpd_sse_event_create("multi", "one\n\nthree", 10),
+        min_httpd_sse_event_create("y", "\n", 1)};
+    bool ok = true;
+
+    for (size_t i = 0; i < sizeof(events) / sizeof(events[0]); i++) {
+        ok = ok && (events[i] != NULL) &&
+             (events[i]->len == strlen(expected[i])) &&
+             (memcmp(events[i]->text, expected[i], events[i]->len) == 0);
+        min_httpd_sse_event_release(events[i]);
+    }
+    host_check(failures, ok, "Events are encoded correctly");
+
+    struct min_httpd_sse_event* event =
+        min_httpd_sse_event_create("abcdefghijklmnop", "", 0);
+    host_check(failures, event == NULL, "Long names are rejected");
+    min_httpd_sse_event_release(event);
+}
+
+/**
+ * Verify coalescing, dropping and retained events, without sending.
+ *
+ * @param failures The number of failures.
+ */
+static void min_httpd_sse_host_queues(int* failures) {
+    struct min_httpd_sse_client storage[2];
+    struct min_httpd_sse_clients clients;
+    min_httpd_sse_clients_init(&clients, storage, 2);
+
+    min_httpd_sse_clients_add(&clients, 100);
+    for (uint32_t seq = 0; seq < 5; seq++) {
+        struct min_httpd_sse_event* event = min_httpd_sse_host_event(seq, 1);
+        min_httpd_sse_clients_publish(&clients, event);
+        min_httpd_sse_event_release(event);
+    }
+    host_check(
+        failures,
+        (storage[0].count == 1) && (clients.coalesced == 4) &&
+            (strstr(storage[0].queue[storage[0].head]->text, "0000000004") !=
+             NULL),
+        "Events of the same name are coalesced");
+
+    /* The head is being sent, so it is neither coalesced nor dropped. */
+    storage[0].offset = 1;
+    struct min_httpd_sse_event* head = storage[0].queue[storage[0].head];
+    for (uint32_t seq = 5; seq < 5 + 2 * MIN_HTTPD_SSE_QUEUE_LEN; seq++) {
+        struct min_httpd_sse_event* event =
+            min_httpd_sse_host_event(seq, MIN_HTTPD_SSE_HOST_NAMES);
+        min_httpd_sse_clients_publish(&clients, event);
+        min_httpd_sse_event_release(event);
+    }
+    bool newest = true;
+    for (size_t i = 1; i < storage[0].count; i++) {
+        size_t index = (storage[0].head + i) % MIN_HTTPD_SSE_QUEUE_LEN;
+        char digits[MIN_HTTPD_SSE_HOST_SEQ_LEN + 1];
+        snprintf(digits,
+                 sizeof(digits),
+                 "%010u",
+                 (uint32_t)(5 + 2 * MIN_HTTPD_SSE_QUEUE_LEN -
+                            MIN_HTTPD_SSE_QUEUE_LEN + i));
+        newest = newest && (strstr(storage[0].queue[index]->text, digits) !=
+                            NULL);
+    }
+    host_check(failures,
+               (storage[0].count == MIN_HTTPD_SSE_QUEUE_LEN) &&
+                   (storage[0].queue[storage[0].head] == head) &&
+                   (clients.dropped > 0) && newest,
+               "Full queues drop the oldest events");
+
+    /* ``n0`` was coalesced with ``0000000004`` and published again. */
+    min_httpd_sse_clients_add(&clients, 101);
+    size_t retained = 0;
+    for (size_t i = 0; i < MIN_HTTPD_SSE_RETAINED; i++)
+        retained += (clients.retained[i] != NULL) ? 1 : 0;
+    host_check(failures,
+               (retained == MIN_HTTPD_SSE_RETAINED) &&
+                   (storage[1].count == retained),
+               "New clients receive the retained events");
+
+    host_check(failures,
+               min_httpd_sse_clients_remove(&clients, 100) &&
+                   !min_httpd_sse_clients_remove(&clients, 100) &&
+                   (clients.count == 1),
+               "Clients are removed");
+    min_httpd_sse_clients_clear(&clients);
+}
+
+/**
+ * Run the loopback test.
+ *
+ * @param count  The number of clients.
+ * @param events The number of events.
+ * @return int ``0`` if all checks passed.
+ */
+static int min_httpd_sse_host_loopback(size_t count, uint32_t events) {
+    int failures = 0;
+
+    if ((count == 0) || (count > MIN_HTTPD_SSE_HOST_MAX_CLIENTS - 1)) {
+        fprintf(stderr,
+                "CLIENTS must be between 1 and %d!\n",
+                MIN_HTTPD_SSE_HOST_MAX_CLIENTS - 1);
+        return 1;
+    }
+
+    min_httpd_sse_host_format(&failures);
+    min_httpd_sse_host_queues(&failures);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len = sizeof(address);
+    if ((bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0) ||
+        (listen(listener, MIN_HTTPD_SSE_HOST_MAX_CLIENTS) != 0) ||
+        (getsockname(listener, (struct sockaddr*)&address, &address_len) !=
+         0)) {
+        perror("listen");
+        return 1;
+    }
+
+    struct min_httpd_sse_client storage[MIN_HTTPD_SSE_HOST_MAX_CLIENTS];
+    struct min_httpd_sse_host_client clients[MIN_HTTPD_SSE_HOST_MAX_CLIENTS];
+    struct min_httpd_sse_clients set;
+    memset(clients, 0, sizeof(clients));
+    min_httpd_sse_clients_init(&set, storage, count);
+
+    /* Phase 1: a single name, so every client receives the latest event. */
+    int sockets[MIN_HTTPD_SSE_HOST_MAX_CLIENTS];
+    for (size_t i = 0; i < count; i++) {
+        sockets[i] =
+            min_httpd_sse_host_connect(listener, &address, &clients[i]);
+        if ((sockets[i] < 0) || !min_httpd_sse_clients_add(&set, sockets[i]))
+            return 1;
+    }
+
+    int closed[MIN_HTTPD_SSE_HOST_MAX_CLIENTS];
+    size_t removed = 0;
+    double start = min_httpd_sse_host_now();
+    for (uint32_t seq = 0; seq < events; seq++) {
+        struct min_httpd_sse_event* event = min_httpd_sse_host_event(seq, 1);
+        min_httpd_sse_clients_publish(&set, event);
+        min_httpd_sse_event_release(event);
+        removed += min_httpd_sse_clients_flush(&set, closed);
+    }
+    min_httpd_sse_host_drain(&set);
+    double elapsed = min_httpd_sse_host_now() - start;
+
+    uint32_t received = 0;
+    bool intact = true;
+    bool latest = true;
+    for (size_t i = 0; i < count; i++) {
+        shutdown(sockets[i], SHUT_RDWR);
+        pthread_join(clients[i].thread, NULL);
+        close(clients[i].socket);
+        close(sockets[i]);
+        received += clients[i].received;
+        intact = intact && (clients[i].invalid == 0);
+        latest = latest && (clients[i].last[0] == events);
+    }
+    min_httpd_sse_clients_clear(&set);
+
+    printf("     %zu clients, %u events in %.3f s (%.0f events/s), "
+           "%u sent, %u coalesced\n",
+           count,
+           events,
+           elapsed,
+           events / elapsed,
+           set.sent,
+           set.coalesced);
+    host_check(&failures, intact, "Events are intact and in order");
+    host_check(&failures,
+               (removed == 0) && (received == set.sent) &&
+                   (set.sent + set.coalesced + set.dropped ==
+                    events * count),
+               "Every event is received or coalesced");
+    host_check(&failures, latest, "Clients receive the latest event");
+
+    /* Phase 2: a slow client with small buffers and large events. */
+    struct min_httpd_sse_host_client* slow = &clients[count];
+    slow->slow = true;
+    min_httpd_sse_clients_init(&set, storage, 1);
+    int slow_socket = min_httpd_sse_host_connect(listener, &address, slow);
+    if ((slow_socket < 0) || !min_httpd_sse_clients_add(&set, slow_socket))
+        return 1;
+
+    size_t partial = 0;
+    for (uint32_t seq = 0; seq < MIN_HTTPD_SSE_HOST_SLOW_EVENTS; seq++) {
+        struct min_httpd_sse_event* event =
+            min_httpd_sse_host_event(seq, MIN_HTTPD_SSE_HOST_NAMES);
+        min_httpd_sse_clients_publish(&set, event);
+        min_httpd_sse_event_release(event);
+        removed += min_httpd_sse_clients_flush(&set, closed);
+        partial += (storage[0].offset > 0) ? 1 : 0;
+    }
+    min_httpd_sse_host_drain(&set);
+    shutdown(slow_socket, SHUT_RDWR);
+    pthread_join(slow->thread, NULL);
+    close(slow->socket);
+    close(slow_socket);
+
+    /* The events behind the head of a full queue are never dropped. */
+    bool last = true;
+    for (uint32_t seq = MIN_HTTPD_SSE_HOST_SLOW_EVENTS -
+                        (MIN_HTTPD_SSE_QUEUE_LEN - 1);
+         seq < MIN_HTTPD_SSE_HOST_SLOW_EVENTS;
+         seq++) {
+        last = last &&
+               (slow->last[seq % MIN_HTTPD_SSE_HOST_NAMES] == seq + 1);
+    }
+    printf("     slow client: %u received, %zu partial, %u coalesced, "
+           "%u dropped\n",
+           slow->received,
+           partial,
+           set.coalesced,
+           set.dropped);
+    host_check(&failures,
+               (removed == 0) && (partial > 0) &&
+                   (slow->invalid == 0) &&
+                   (slow->received == set.sent),
+               "Partially sent events are continued");
+    host_check(&failures,
+               last && (set.coalesced + set.dropped > 0),
+               "Slow clients receive the latest events");
+    min_httpd_sse_clients_clear(&set);
+
+    /* Phase 3: a client, that closes its connection, is removed. */
+    struct min_httpd_sse_host_client* gone = &clients[count];
+    memset(gone, 0, sizeof(*gone));
+    min_httpd_sse_clients_init(&set, storage, 1);
+    int gone_socket = min_httpd_sse_host_connect(listener, &address, gone);
+    if ((gone_socket < 0) || !min_httpd_sse_clients_add(&set, gone_socket))
+        return 1;
+    shutdown(gone->socket, SHUT_RDWR);
+    pthread_join(gone->thread, NULL);
+    close(gone->socket);
+
+    removed = 0;
+    for (uint32_t seq = 0; (seq < 1000) && (removed == 0); seq++) {
+        struct min_httpd_sse_event* event = min_httpd_sse_host_event(seq, 1);
+        min_httpd_sse_clients_publish(&set, event);
+        min_httpd_sse_event_release(event);
+        removed = min_httpd_sse_clients_flush(&set, closed);
+        usleep(100);
+    }
+    host_check(&failures,
+               (removed == 1) && (closed[0] == gone_socket) &&
+                   (set.count == 0) && (set.closed == 1),
+               "Closed clients are removed");
+    min_httpd_sse_clients_clear(&set);
+    close(gone_socket);
+    close(listener);
+
+    return host_check_summary(failures);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s loopback [CLIENTS [EVENTS]]\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "loopback") == 0) {
+        return min_httpd_sse_host_loopback(
+            (argc > 2) ? (size_t)atoi(argv[2]) : MIN_HTTPD_SSE_HOST_CLIENTS,
+            (argc > 3) ? (uint32_t)atoi(argv[3]) : MIN_HTTPD_SSE_HOST_EVENTS);
+    }
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,554 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Run the WebSocket push channel of the ``min_httpd`` component on a Linux
+ * host.
+ *
+ * The channel's engine is compiled unmodified and loaded with subscribers on
+ * the loopback interface. The handshake is performed by ``esp_http_server``
+ * on the device, so the subscribers connect with plain TCP:
+ *
+ *   - ``min_httpd_ws_host loopback [SUBSCRIBERS [MESSAGES]]`` verifies the
+ *     encoding of frames and the set of subscribers, broadcasts ``MESSAGES``
+ *     to ``SUBSCRIBERS`` (verifying every frame they receive) and finally
+ *     adds a stalled subscriber, which must not block the others. It misses
+ *     frames and is dropped, as soon as it takes a partial frame.
+ *
+ * Every message carries its sequence number, so subscribers detect frames,
+ * that were skipped, and frames, that were received out of order.
+ *
+ * @file   min_httpd_ws_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* The channel's engine. */
+#include "min_httpd_ws_engine.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The default number of subscribers of the loopback test.
+ */
+#define MIN_HTTPD_WS_HOST_SUBSCRIBERS 5
+
+/**
+ * The default number of messages of the loopback test.
+ */
+#define MIN_HTTPD_WS_HOST_MESSAGES 20000
+
+/**
+ * The maximum number of subscribers, including the stalled one.
+ */
+#define MIN_HTTPD_WS_HOST_MAX_SUBSCRIBERS 16
+
+/**
+ * The maximum length of a message, just like ``MIN_HTTPD_WS_MAX_MESSAGE_LEN``.
+ */
+#define MIN_HTTPD_WS_HOST_MESSAGE_LEN 1024
+
+/**
+ * The length of the sequence number, that starts every message.
+ */
+#define MIN_HTTPD_WS_HOST_SEQ_LEN 10
+
+/**
+ * The send buffer of the stalled subscriber's socket, so it fills quickly.
+ */
+#define MIN_HTTPD_WS_HOST_STALLED_SNDBUF 4096
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A subscriber, receiving and verifying frames in its own thread.
+ */
+struct min_httpd_ws_host_subscriber {
+    int socket;
+    pthread_t thread;
+    uint32_t first;  // the sequence number of the first message
+    uint32_t end;    // the sequence number after the last message, ``0`` if
+                     // the subscriber is dropped before
+    volatile bool* hold;  // do not read, while this is set (stalled)
+    uint32_t received;
+    uint32_t missed;   // gaps in the sequence numbers
+    uint32_t invalid;  // malformed or reordered frames
+    uint64_t bytes;
+};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get the current time.
+ *
+ * @return double The time in seconds.
+ */
+static double min_httpd_ws_host_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Receive exactly ``len`` bytes.
+ *
+ * @param socket The socket.
+ * @param buf    The buffer.
+ * @param len    The number of bytes.
+ * @return bool ``false`` if the connection was closed.
+ */
+static bool min_httpd_ws_host_recv(int socket, uint8_t* buf, size_t len) {
+    while (len > 0) {
+        ssize_t ret = recv(socket, buf, len, 0);
+        if (ret <= 0)
+            return false;
+        buf += ret;
+        len -= (size_t)ret;
+    }
+    return true;
+}
+
+/**
+ * Build the payload of a message.
+ *
+ * The payload is the sequence number, followed by a character, that depends
+ * on the sequence number. Its length varies between the sequence number's
+ * length and ::MIN_HTTPD_WS_HOST_MESSAGE_LEN .
+ *
+ * @param buf The buffer.
+ * @param seq The sequence number.
+ * @return size_t The length of the payload.
+ */
+static size_t min_httpd_ws_host_payload(uint8_t* buf, uint32_t seq) {
+    size_t len = MIN_HTTPD_WS_HOST_SEQ_LEN +
+                 (seq * 37) % (MIN_HTTPD_WS_HOST_MESSAGE_LEN -
+                               MIN_HTTPD_WS_HOST_SEQ_LEN + 1);
+    char digits[MIN_HTTPD_WS_HOST_SEQ_LEN + 1];
+    snprintf(digits, sizeof(digits), "%010u", seq);
+    memcpy(buf, digits, MIN_HTTPD_WS_HOST_SEQ_LEN);
+    memset(buf + MIN_HTTPD_WS_HOST_SEQ_LEN,
+           'a' + seq % 26,
+           len - MIN_HTTPD_WS_HOST_SEQ_LEN);
+    return len;
+}
+
+/**
+ * Receive and verify frames, until the server closes the connection.
+ *
+ * A frame, that is cut off by the server closing the connection, is not
+ * counted, as the server drops subscribers after a partial frame.
+ *
+ * @param arg The subscriber (::min_httpd_ws_host_subscriber ).
+ * @return void* Always ``NULL``.
+ */
+static void* min_httpd_ws_host_subscriber_run(void* arg) {
+    struct min_httpd_ws_host_subscriber* subscriber = arg;
+    uint8_t* payload = malloc(MIN_HTTPD_WS_HOST_MESSAGE_LEN);
+    uint8_t* expected = malloc(MIN_HTTPD_WS_HOST_MESSAGE_LEN);
+    int64_t last = (int64_t)subscriber->first - 1;
+
+    while ((subscriber->hold != NULL) && *subscriber->hold)
+        usleep(1000);
+
+    for (;;) {
+        uint8_t header[8];
+        if (!min_httpd_ws_host_recv(subscriber->socket, header, 2))
+            break;
+
+        /* Frames of a server are final, text and not masked. */
+        if ((header[0] != 0x81) || (header[1] & 0x80)) {
+            subscriber->invalid++;
+            break;
+        }
+
+        uint64_t len = header[1] & 0x7f;
+        if (len == 126) {
+            if (!min_httpd_ws_host_recv(subscriber->socket, header, 2))
+                break;
+            len = ((uint64_t)header[0] << 8) | header[1];
+        } else if (len == 127) {
+            if (!min_httpd_ws_host_recv(subscriber->socket, header, 8))
+                break;
+            len = 0;
+            for (int i = 0; i < 8; i++)
+                len = (len << 8) | header[i];
+        }
+
+        if ((len < MIN_HTTPD_WS_HOST_SEQ_LEN) ||
+            (len > MIN_HTTPD_WS_HOST_MESSAGE_LEN)) {
+            subscriber->invalid++;
+            break;
+        }
+        if (!min_httpd_ws_host_recv(subscriber->socket, payload, len))
+            break;
+
+        char digits[MIN_HTTPD_WS_HOST_SEQ_LEN + 1] = {0};
+        memcpy(digits, payload, MIN_HTTPD_WS_HOST_SEQ_LEN);
+        int64_t seq = strtoll(digits, NULL, 10);
+
+        size_t expected_len = min_httpd_ws_host_payload(expected,
+                                                        (uint32_t)seq);
+        if ((seq <= last) || (expected_len != len) ||
+            (memcmp(expected, payload, len) != 0)) {
+            subscriber->invalid++;
+            continue;
+        }
+
+        subscriber->missed += (uint32_t)(seq - last - 1);
+        subscriber->received++;
+        subscriber->bytes += len;
+        last = seq;
+    }
+
+    if ((subscriber->end > 0) && (last + 1 < (int64_t)subscriber->end))
+        subscriber->missed += (uint32_t)(subscriber->end - last - 1);
+
+    free(payload);
+    free(expected);
+    return NULL;
+}
+
+/**
+ * Connect a subscriber and start its thread.
+ *
+ * The members of ``subscriber``, that control the verification (``first``,
+ * ``end`` and ``hold``), must be set before.
+ *
+ * @param listener   The listening socket of the server.
+ * @param address    The address of the server.
+ * @param subscriber The subscriber.
+ * @return int The server's socket of the subscriber, ``-1`` on failure.
+ */
+static int min_httpd_ws_host_subscribe(
+    int listener,
+    const struct sockaddr_in* address,
+    struct min_httpd_ws_host_subscriber* subscriber) {
+    bool stalled = subscriber->hold != NULL;
+
+    subscriber->socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (stalled) {
+        int rcvbuf = MIN_HTTPD_WS_HOST_STALLED_SNDBUF;
+        setsockopt(subscriber->socket,
+                   SOL_SOCKET,
+                   SO_RCVBUF,
+                   &rcvbuf,
+                   sizeof(rcvbuf));
+    }
+
+    if (connect(subscriber->socket,
+                (const struct sockaddr*)address,
+                sizeof(*address)) != 0) {
+        perror("connect");
+        return -1;
+    }
+
+    int server_socket = accept(listener, NULL, NULL);
+    if (server_socket < 0) {
+        perror("accept");
+        return -1;
+    }
+    if (stalled) {
+        int sndbuf = MIN_HTTPD_WS_HOST_STALLED_SNDBUF;
+        setsockopt(server_socket,
+                   SOL_SOCKET,
+                   SO_SNDBUF,
+                   &sndbuf,
+                   sizeof(sndbuf));
+    }
+
+    pthread_create(&subscriber->thread,
+                   NULL,
+                   min_httpd_ws_host_subscriber_run,
+                   subscriber);
+    return server_socket;
+}
+
+/**
+ * Broadcast messages, just like ``min_httpd_ws_broadcast()``.
+ *
+ * Every frame is built once and passed to ::min_httpd_ws_fanout . Dropped
+ * subscribers are shut down, just like the device closes their sessions.
+ *
+ * @param subscribers The set of subscribers.
+ * @param first       The sequence number of the first message.
+ * @param end         The sequence number after the last message.
+ * @return double The elapsed time in seconds.
+ */
+static double min_httpd_ws_host_broadcast(
+    struct min_httpd_ws_subscribers* subscribers,
+    uint32_t first,
+    uint32_t end) {
+    uint8_t* buf = malloc(MIN_HTTPD_WS_HEADROOM +
+                          MIN_HTTPD_WS_HOST_MESSAGE_LEN);
+    int dropped[MIN_HTTPD_WS_HOST_MAX_SUBSCRIBERS];
+
+    double start = min_httpd_ws_host_now();
+    for (uint32_t seq = first; seq < end; seq++) {
+        size_t len = min_httpd_ws_host_payload(buf + MIN_HTTPD_WS_HEADROOM,
+                                               seq);
+        const uint8_t* frame;
+        size_t frame_len = min_httpd_ws_frame_finish(buf,
+                                                     len,
+                                                     MIN_HTTPD_WS_OPCODE_TEXT,
+                                                     &frame);
+
+        size_t count = min_httpd_ws_fanout(subscribers,
+                                           frame,
+                                           frame_len,
+                                           dropped);
+        for (size_t i = 0; i < count; i++)
+            shutdown(dropped[i], SHUT_RDWR);
+    }
+    double elapsed = min_httpd_ws_host_now() - start;
+
+    free(buf);
+    return elapsed;
+}
+
+/**
+ * Verify the encoding of frames.
+ *
+ * @param failures The number of failures.
+ */
+static void min_httpd_ws_host_frames(int* failures) {
+    static uint8_t buf[MIN_HTTPD_WS_HEADROOM + 70000];
+    const uint8_t* frame;
+    size_t len;
+
+    len = min_httpd_ws_frame_finish(buf, 0, MIN_HTTPD_WS_OPCODE_TEXT, &frame);
+    host_check(failures,
+               (len == 2) && (frame == buf + MIN_HTTPD_WS_HEADROOM - 2) &&
+                   (frame[0] == 0x81) && (frame[1] == 0),
+               "Empty frame has 2 byte header");
+
+    len = min_httpd_ws_frame_finish(buf,
+                                    125,
+                                    MIN_HTTPD_WS_OPCODE_BINARY,
+                                    &frame);
+    host_check(failures,
+               (len == 127) && (frame[0] == 0x82) && (frame[1] == 125),
+               "125 bytes use the short length");
+
+    len = min_httpd_ws_frame_finish(buf, 126, MIN_HTTPD_WS_OPCODE_TEXT, &frame);
+    host_check(failures,
+               (len == 130) && (frame[1] == 126) &&
+                   (frame[2] == 0) && (frame[3] == 126),
+               "126 bytes use the 16 bit length");
+
+    len = min_httpd_ws_frame_finish(buf,
+                                    65535,
+                                    MIN_HTTPD_WS_OPCODE_TEXT,
+                                    &frame);
+    host_check(failures,
+               (len == 65539) && (frame[1] == 126) &&
+                   (frame[2] == 0xff) && (frame[3] == 0xff),
+               "65535 bytes use the 16 bit length");
+
+    len = min_httpd_ws_frame_finish(buf,
+                                    65536,
+                                    MIN_HTTPD_WS_OPCODE_TEXT,
+                                    &frame);
+    host_check(failures,
+               (len == 65546) && (frame == buf) && (frame[1] == 127) &&
+                   (frame[7] == 1) && (frame[8] == 0) && (frame[9] == 0),
+               "65536 bytes use the 64 bit length");
+}
+
+/**
+ * Verify the set of subscribers.
+ *
+ * @param failures The number of failures.
+ */
+static void min_httpd_ws_host_set(int* failures) {
+    int sockets[2];
+    struct min_httpd_ws_subscribers subscribers;
+    min_httpd_ws_subscribers_init(&subscribers, sockets, 2);
+
+    bool ok = min_httpd_ws_subscribers_add(&subscribers, 10) &&
+              min_httpd_ws_subscribers_add(&subscribers, 11) &&
+              min_httpd_ws_subscribers_add(&subscribers, 11) &&
+              (subscribers.count == 2);
+    host_check(failures, ok, "Subscribers are added once");
+
+    host_check(failures,
+               !min_httpd_ws_subscribers_add(&subscribers, 12),
+               "Full set rejects subscribers");
+
+    ok = min_httpd_ws_subscribers_remove(&subscribers, 10) &&
+         !min_httpd_ws_subscribers_remove(&subscribers, 10) &&
+         min_httpd_ws_subscribers_add(&subscribers, 12) &&
+         (subscribers.count == 2);
+    host_check(failures, ok, "Removed slots are reused");
+}
+
+/**
+ * Run the loopback test.
+ *
+ * @param count    The number of subscribers.
+ * @param messages The number of messages.
+ * @return int The exit code, ``0`` if all checks passed.
+ */
+static int min_httpd_ws_host_loopback(size_t count, uint32_t messages) {
+    int failures = 0;
+
+    if ((count < 1) || (count >= MIN_HTTPD_WS_HOST_MAX_SUBSCRIBERS)) {
+        fprintf(stderr,
+                "SUBSCRIBERS must be within 1 and %d!\n",
+                MIN_HTTPD_WS_HOST_MAX_SUBSCRIBERS - 1);
+        return 1;
+    }
+
+    min_httpd_ws_host_frames(&failures);
+    min_httpd_ws_host_set(&failures);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {0};
+    socklen_t address_len = sizeof(address);
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0) ||
+        (listen(listener, MIN_HTTPD_WS_HOST_MAX_SUBSCRIBERS) != 0) ||
+        (getsockname(listener, (struct sockaddr*)&address, &address_len) !=
+         0)) {
+        perror("listen");
+        return 1;
+    }
+
+    static struct min_httpd_ws_host_subscriber
+        clients[MIN_HTTPD_WS_HOST_MAX_SUBSCRIBERS];
+    int sockets[MIN_HTTPD_WS_HOST_MAX_SUBSCRIBERS];
+    int server_sockets[MIN_HTTPD_WS_HOST_MAX_SUBSCRIBERS];
+    struct min_httpd_ws_subscribers subscribers;
+    min_httpd_ws_subscribers_init(&subscribers,
+                                  sockets,
+                                  MIN_HTTPD_WS_HOST_MAX_SUBSCRIBERS);
+
+    /* The stalled subscriber joins for the last quarter of the messages. */
+    uint32_t stall = messages - messages / 4;
+    volatile bool hold = true;
+
+    for (size_t i = 0; i <= count; i++) {
+        clients[i].first = (i < count) ? 0 : stall;
+        clients[i].end = (i < count) ? messages : 0;
+        clients[i].hold = (i < count) ? NULL : &hold;
+    }
+
+    /* Load: all subscribers read as fast as they can. */
+    for (size_t i = 0; i < count; i++) {
+        server_sockets[i] =
+            min_httpd_ws_host_subscribe(listener, &address, &clients[i]);
+        if (server_sockets[i] < 0)
+            return 1;
+        min_httpd_ws_subscribers_add(&subscribers, server_sockets[i]);
+    }
+
+    double elapsed = min_httpd_ws_host_broadcast(&subscribers, 0, stall);
+    uint32_t dropped = subscribers.dropped;
+
+    /* The stalled subscriber does not read, until all messages are sent. */
+    server_sockets[count] =
+        min_httpd_ws_host_subscribe(listener, &address, &clients[count]);
+    if (server_sockets[count] < 0)
+        return 1;
+    min_httpd_ws_subscribers_add(&subscribers, server_sockets[count]);
+
+    double stalled_elapsed =
+        min_httpd_ws_host_broadcast(&subscribers, stall, messages);
+    /* The stalled subscriber is either still skipped or dropped. */
+    bool kept = subscribers.count == count + 1 - subscribers.dropped;
+    hold = false;
+
+    for (size_t i = 0; i <= count; i++) {
+        shutdown(server_sockets[i], SHUT_RDWR);
+        pthread_join(clients[i].thread, NULL);
+        close(server_sockets[i]);
+        close(clients[i].socket);
+    }
+    close(listener);
+
+    uint32_t received = 0;
+    uint32_t missed = 0;
+    uint32_t invalid = 0;
+    uint64_t bytes = 0;
+    bool complete = true;
+    for (size_t i = 0; i <= count; i++) {
+        received += clients[i].received;
+        invalid += clients[i].invalid;
+        bytes += clients[i].bytes;
+        if (i == count)
+            continue;
+        missed += clients[i].missed;
+        if (clients[i].received + clients[i].missed != messages)
+            complete = false;
+    }
+
+    printf("     %zu subscribers: %.0f broadcasts/s, %.1f MB/s received\n",
+           count,
+           stall / elapsed,
+           bytes / (elapsed + stalled_elapsed) / 1e6);
+    printf("     %u frames sent, %u skipped, %u subscriber(s) dropped\n",
+           subscribers.sent,
+           subscribers.skipped,
+           subscribers.dropped);
+    printf("     stalled subscriber: %u frames, %.2f us per broadcast "
+           "(%.2f us before)\n",
+           clients[count].received,
+           stalled_elapsed * 1e6 / (messages - stall),
+           elapsed * 1e6 / stall);
+
+    host_check(&failures, invalid == 0, "Frames are intact and in order");
+    host_check(&failures,
+               received == subscribers.sent,
+               "Every sent frame is received once");
+    host_check(&failures,
+               complete && (dropped == 0) && (missed <= subscribers.skipped),
+               "Subscribers only miss skipped frames");
+    host_check(&failures,
+               (subscribers.dropped <= 1) && kept &&
+                   (clients[count].received < messages - stall),
+               "Stalled subscriber is not waited for");
+
+    return host_check_summary(failures);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr,
+                "Usage: %s loopback [SUBSCRIBERS [MESSAGES]]\n",
+                argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "loopback") == 0) {
+        return min_httpd_ws_host_loopback(
+            (argc > 2) ? (size_t)atoi(argv[2]) : MIN_HTTPD_WS_HOST_SUBSCRIBERS,
+            (argc > 3) ? (uint32_t)atoi(argv[3]) : MIN_HTTPD_WS_HOST_MESSAGES);
+    }
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
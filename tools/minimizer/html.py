@@ -6,39 +6,41 @@
 The script is basically just a tiny wrapper around ``minify-html`` and sets the
 desired configuration values. These are hard-coded, to create coherent results
 for all files during every run.
+
+With ``--template NAME``, the source is a *template*, that is compiled into
+the C source OUTPUT instead. Placeholders (``{{ name }}``) are replaced by
+runtime values, see ``min_httpd_template_send()``. The minified template is
+split into *segments*: a static text, that is followed by a placeholder (or
+by nothing, at the end). OUTPUT provides the table ``NAME`` (see
+``struct min_httpd_template`` in ``min_httpd_template.h``), so the static
+text is sent directly from flash and the page is not assembled at runtime.
+
+Placeholders are not supported inside of ``<script>`` and ``<style>``, the
+compilation fails, if the minification modifies them. In attributes, they
+must be quoted (the minification keeps the quotes), as the values are
+escaped for HTML, but may contain spaces.
 """
 
 # Python imports
+import argparse
+import os
+import re
 import sys
 
 # external imports
 import minify_html
 
-if __name__ == "__main__":
-    # get parameters from ``argv``
-    try:
-        input_file = sys.argv[1]
-        output_file = sys.argv[2]
-    except IndexError:
-        print("Please specify an INPUT / OUTPUT file!")
-        sys.exit(1)
+# A placeholder, ``{{ name }}``.
+PLACEHOLDER = re.compile(r"\{\{\s*([A-Za-z_][A-Za-z0-9_]*)\s*\}\}")
 
-    print("Minimizing HTML source '{}'".format(input_file))
+# The maximum length of the lines of a string literal in OUTPUT.
+LITERAL_LEN = 64
 
-    # open input_file, read its content
-    try:
-        with open(input_file) as f_in:
-            source = f_in.read()
-    except FileNotFoundError:
-        print("Could not open INPUT '{}' (file not found)!".format(input_file))
-        sys.exit(1)
-    except PermissionError:
-        print("Could not read INPUT '{}' (missing permission)!".format(input_file))
-        sys.exit(1)
 
-    # run through minify_html
+def minify(source):
+    """Minify HTML source code."""
     # all configuration options are specified explicitly!
-    result = minify_html.minify(
+    return minify_html.minify(
         source,
         do_not_minify_doctype=True,
         ensure_spec_compliant_unquoted_attribute_values=True,
@@ -52,6 +54,113 @@ if __name__ == "__main__":
         remove_processing_instructions=True,
     )
 
+
+def c_literal(data):
+    """Format bytes as C string literal, split into lines.
+
+    All bytes, that are not printable ASCII, are written as octal escapes
+    with three digits, so they can not merge with the following characters.
+    """
+    lines = []
+    line = ""
+    for byte in data:
+        if byte in (0x22, 0x5C):
+            char = "\\" + chr(byte)
+        elif 0x20 <= byte < 0x7F:
+            char = chr(byte)
+        else:
+            char = "\\{:03o}".format(byte)
+        if len(line) + len(char) > LITERAL_LEN:
+            lines.append(line)
+            line = ""
+        line += char
+    lines.append(line)
+    return "\n".join('        "{}"'.format(line) for line in lines)
+
+
+def compile_template(name, source, input_file):
+    """Compile a template into the C source of its table."""
+    names = PLACEHOLDER.findall(source)
+
+    # The canonical form contains spaces, so quotes of attributes are kept
+    result = minify(PLACEHOLDER.sub(r"{{ \1 }}", source))
+    if PLACEHOLDER.findall(result) != names:
+        raise ValueError("Placeholders were modified by the minification")
+
+    parts = PLACEHOLDER.split(result)
+    segments = []
+    for index in range(0, len(parts), 2):
+        text = parts[index].encode("utf-8")
+        placeholder = parts[index + 1] if index + 1 < len(parts) else None
+        if (len(text) > 0) or (placeholder is not None):
+            segments.append((text, placeholder))
+
+    lines = [
+        "// Generated by tools/minimizer/html.py from",
+        "// {}".format(os.path.basename(input_file)),
+        "// Do not edit!",
+        "",
+        '#include "min_httpd/min_httpd_template.h"',
+        "",
+        "static const struct min_httpd_template_segment {}_segments[] = {{".format(
+            name
+        ),
+    ]
+    for text, placeholder in segments:
+        lines.append("    {")
+        lines.append(c_literal(text) + ",")
+        lines.append("        {},".format(len(text)))
+        lines.append(
+            "        {},".format(
+                '"{}"'.format(placeholder) if placeholder is not None else "NULL"
+            )
+        )
+        lines.append("    },")
+    lines += [
+        "};",
+        "",
+        "const struct min_httpd_template {} = {{".format(name),
+        "    .segments = {}_segments,".format(name),
+        "    .count = {},".format(len(segments)),
+        "    .len = {},".format(sum(len(text) for text, _ in segments)),
+        "};",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+if __name__ == "__main__":
+    # get parameters from ``argv``
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--template", metavar="NAME", help="compile a template")
+    parser.add_argument("input_file", metavar="INPUT")
+    parser.add_argument("output_file", metavar="OUTPUT")
+    args = parser.parse_args()
+    input_file = args.input_file
+    output_file = args.output_file
+
+    # open input_file, read its content
+    try:
+        with open(input_file) as f_in:
+            source = f_in.read()
+    except FileNotFoundError:
+        print("Could not open INPUT '{}' (file not found)!".format(input_file))
+        sys.exit(1)
+    except PermissionError:
+        print("Could not read INPUT '{}' (missing permission)!".format(input_file))
+        sys.exit(1)
+
+    if args.template is not None:
+        print("Compiling HTML template '{}'".format(input_file))
+        try:
+            result = compile_template(args.template, source, input_file)
+        except ValueError as e:
+            print("Could not compile '{}' ({})!".format(input_file, e))
+            sys.exit(1)
+    else:
+        print("Minimizing HTML source '{}'".format(input_file))
+        result = minify(source)
+
     # write to output_file
     try:
         with open(output_file, "w") as f_out:
@@ -0,0 +1,453 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Run the DNS responder of the ``mnet32`` component on a Linux host.
+ *
+ * The responder is compiled unmodified, so it may be verified with common
+ * tools (e.g. ``dig -p 5353 @127.0.0.1 example.com``) or with the included
+ * resolver client:
+ *
+ *   - ``mnet32_dns_host serve [PORT [ADDRESS]]`` answers queries with
+ *     ``ADDRESS``;
+ *   - ``mnet32_dns_host query NAME [SERVER [PORT]]`` resolves ``NAME``;
+ *   - ``mnet32_dns_host loopback [PORT]`` runs the responder and sends valid
+ *     and malformed queries over the loopback interface, verifying every
+ *     response.
+ *
+ * @file   mnet32_dns_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* The DNS responder of the component. */
+#include "mnet32_dns.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The default port, as the actual DNS port requires privileges.
+ */
+#define MNET32_DNS_HOST_PORT 5353
+
+/**
+ * The default address to answer with, matching **ESP-IDF**'s access point.
+ */
+#define MNET32_DNS_HOST_ADDRESS "192.168.4.1"
+
+/**
+ * The time to wait for a response (in milliseconds).
+ */
+#define MNET32_DNS_HOST_TIMEOUT 500
+
+/* Types of resource records. */
+#define MNET32_DNS_HOST_TYPE_A 1
+#define MNET32_DNS_HOST_TYPE_OPT 41
+#define MNET32_DNS_HOST_TYPE_AAAA 28
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * The responder of the loopback test, running in its own thread.
+ */
+struct mnet32_dns_host_loopback {
+    struct mnet32_dns dns;
+    volatile bool stop;
+};
+
+/**
+ * The relevant fields of a response.
+ */
+struct mnet32_dns_host_response {
+    uint16_t id;
+    uint8_t flags;
+    uint8_t rcode;
+    uint16_t ancount;
+    uint16_t arcount;
+    uint32_t address;  // network byte order, of the first answer
+    uint32_t ttl;
+};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Build a query.
+ *
+ * @param buf    The buffer, at least ::MNET32_DNS_MSG_LEN bytes.
+ * @param id     The query's ID.
+ * @param name   The name to query, e.g. ``example.com``.
+ * @param type   The type of the query.
+ * @param edns   Flag to append an EDNS OPT record.
+ * @return size_t The length of the query.
+ */
+static size_t mnet32_dns_host_build(uint8_t* buf,
+                                    uint16_t id,
+                                    const char* name,
+                                    uint16_t type,
+                                    bool edns) {
+    memset(buf, 0, 12);
+    buf[0] = id >> 8;
+    buf[1] = id & 0xff;
+    buf[2] = 0x01;  // RD
+    buf[5] = 1;     // QDCOUNT
+    buf[11] = edns ? 1 : 0;
+
+    size_t off = 12;
+    while (*name != '\0') {
+        size_t label = strcspn(name, ".");
+        buf[off++] = (uint8_t)label;
+        memcpy(buf + off, name, label);
+        off += label;
+        name += label;
+        if (*name == '.')
+            name++;
+    }
+    buf[off++] = 0;
+    buf[off++] = type >> 8;
+    buf[off++] = type & 0xff;
+    buf[off++] = 0;
+    buf[off++] = 1;  // IN
+
+    if (edns) {
+        // root name, type, UDP payload size (4096), TTL, RDLENGTH
+        uint8_t opt[] = {
+            0, 0, MNET32_DNS_HOST_TYPE_OPT, 0x10, 0, 0, 0, 0, 0, 0, 0};
+        memcpy(buf + off, opt, sizeof(opt));
+        off += sizeof(opt);
+    }
+
+    return off;
+}
+
+/**
+ * Send a query and wait for the response.
+ *
+ * @param server   The address of the responder.
+ * @param query    The query.
+ * @param len      The length of the query.
+ * @param response The response.
+ * @return int The length of the response, ``0`` if there is no response and
+ *             ``-1`` on failure.
+ */
+static int mnet32_dns_host_exchange(const struct sockaddr_in* server,
+                                    const uint8_t* query,
+                                    size_t len,
+                                    struct mnet32_dns_host_response* response) {
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+        return -1;
+
+    struct timeval timeout = {
+        .tv_sec = 0,
+        .tv_usec = MNET32_DNS_HOST_TIMEOUT * 1000,
+    };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    if (sendto(sock,
+               query,
+               len,
+               0,
+               (const struct sockaddr*)server,
+               sizeof(*server)) < 0) {
+        close(sock);
+        return -1;
+    }
+
+    uint8_t buf[MNET32_DNS_MSG_LEN];
+    ssize_t ret = recv(sock, buf, sizeof(buf), 0);
+    close(sock);
+    if (ret < 0)
+        return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? 0 : -1;
+    if (ret < 12)
+        return -1;
+
+    memset(response, 0, sizeof(*response));
+    response->id = (uint16_t)((buf[0] << 8) | buf[1]);
+    response->flags = buf[2];
+    response->rcode = buf[3] & 0x0f;
+    response->ancount = (uint16_t)((buf[6] << 8) | buf[7]);
+    response->arcount = (uint16_t)((buf[10] << 8) | buf[11]);
+
+    /* The answer directly follows the question, which is echoed. */
+    size_t off = len;
+    if (query[11] != 0)  // the query's EDNS record is stripped
+        off -= 11;
+    if ((response->ancount > 0) && (ret >= (ssize_t)off + 16)) {
+        response->ttl = ((uint32_t)buf[off + 6] << 24) |
+                        ((uint32_t)buf[off + 7] << 16) |
+                        ((uint32_t)buf[off + 8] << 8) | buf[off + 9];
+        memcpy(&response->address, buf + off + 12, 4);
+    }
+
+    return (int)ret;
+}
+
+/**
+ * Answer queries forever.
+ *
+ * @param port    The port to listen on.
+ * @param address The address to answer with.
+ * @return int The exit code.
+ */
+static int mnet32_dns_host_serve(uint16_t port, const char* address) {
+    struct mnet32_dns dns;
+    struct in_addr addr;
+
+    if (inet_aton(address, &addr) == 0) {
+        fprintf(stderr, "Please specify a valid ADDRESS!\n");
+        return 1;
+    }
+    if (mnet32_dns_open(&dns, port, addr.s_addr) != 0) {
+        fprintf(stderr, "Could not open responder: %s\n", strerror(errno));
+        return 1;
+    }
+    printf("Answering queries on port %d with %s\n", port, address);
+
+    for (;;) {
+        int ret = mnet32_dns_serve(&dns);
+        if (ret > 0) {
+            printf("%u answered, %u dropped\n", dns.answered, dns.dropped);
+            fflush(stdout);
+        } else if (ret < 0) {
+            fprintf(stderr, "Responder failed: %s\n", strerror(errno));
+            break;
+        }
+    }
+
+    mnet32_dns_close(&dns);
+    return 1;
+}
+
+/**
+ * Resolve a name.
+ *
+ * @param name   The name to resolve.
+ * @param server The address of the responder.
+ * @param port   The port of the responder.
+ * @return int The exit code.
+ */
+static int mnet32_dns_host_query(const char* name,
+                                 const char* server,
+                                 uint16_t port) {
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+    };
+    if (inet_aton(server, &addr.sin_addr) == 0) {
+        fprintf(stderr, "Please specify a valid SERVER!\n");
+        return 1;
+    }
+
+    uint8_t query[MNET32_DNS_MSG_LEN];
+    struct mnet32_dns_host_response response;
+    size_t len = mnet32_dns_host_build(query,
+                                       0x4d33,
+                                       name,
+                                       MNET32_DNS_HOST_TYPE_A,
+                                       false);
+
+    int ret = mnet32_dns_host_exchange(&addr, query, len, &response);
+    if (ret <= 0) {
+        fprintf(stderr, "No response!\n");
+        return 1;
+    }
+    if (response.ancount == 0) {
+        printf("%s: no address (rcode %d)\n", name, response.rcode);
+        return 1;
+    }
+
+    struct in_addr answer = {.s_addr = response.address};
+    printf("%s: %s (ttl %u)\n", name, inet_ntoa(answer), response.ttl);
+    return 0;
+}
+
+/**
+ * The thread of the loopback test's responder.
+ *
+ * @param arg The loopback test.
+ * @return void* Always ``NULL``.
+ */
+static void* mnet32_dns_host_loopback_thread(void* arg) {
+    struct mnet32_dns_host_loopback* loopback = arg;
+
+    while (!loopback->stop) {
+        if (mnet32_dns_serve(&loopback->dns) < 0)
+            break;
+    }
+
+    return NULL;
+}
+
+/**
+ * Send valid and malformed queries to the responder over the loopback
+ * interface.
+ *
+ * @param port The port to use.
+ * @return int The exit code.
+ */
+static int mnet32_dns_host_loopback(uint16_t port) {
+    struct mnet32_dns_host_loopback loopback = {0};
+    struct in_addr address;
+    int failures = 0;
+
+    inet_aton(MNET32_DNS_HOST_ADDRESS, &address);
+    if (mnet32_dns_open(&loopback.dns, port, address.s_addr) != 0) {
+        fprintf(stderr, "Could not open responder: %s\n", strerror(errno));
+        return 1;
+    }
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, mnet32_dns_host_loopback_thread, &loopback);
+
+    struct sockaddr_in server = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    uint8_t query[MNET32_DNS_MSG_LEN];
+    struct mnet32_dns_host_response r;
+    size_t len;
+    int ret;
+
+    len = mnet32_dns_host_build(query,
+                                0x1234,
+                                "connectivitycheck.gstatic.com",
+                                MNET32_DNS_HOST_TYPE_A,
+                                false);
+    ret = mnet32_dns_host_exchange(&server, query, len, &r);
+    host_check(&failures,
+               (ret == (int)len + 16) && (r.id == 0x1234) &&
+                   (r.flags == 0x85) && (r.rcode == 0) &&
+                   (r.ancount == 1) &&
+                   (r.address == address.s_addr) &&
+                   (r.ttl == MNET32_DNS_TTL),
+               "A query is answered with the address");
+
+    len = mnet32_dns_host_build(query,
+                                0x2345,
+                                "captive.apple.com",
+                                MNET32_DNS_HOST_TYPE_AAAA,
+                                false);
+    ret = mnet32_dns_host_exchange(&server, query, len, &r);
+    host_check(&failures,
+               (ret == (int)len) && (r.id == 0x2345) &&
+                   (r.rcode == 0) && (r.ancount == 0),
+               "AAAA query is answered without address");
+
+    len = mnet32_dns_host_build(query,
+                                0x3456,
+                                "www.msftconnecttest.com",
+                                MNET32_DNS_HOST_TYPE_A,
+                                true);
+    ret = mnet32_dns_host_exchange(&server, query, len, &r);
+    host_check(&failures,
+               (ret == (int)len - 11 + 16) && (r.ancount == 1) &&
+                   (r.arcount == 0) &&
+                   (r.address == address.s_addr),
+               "EDNS record is stripped");
+
+    len = mnet32_dns_host_build(query,
+                                0x4567,
+                                "example.com",
+                                MNET32_DNS_HOST_TYPE_A,
+                                false);
+    query[2] = 0x10;  // opcode STATUS
+    ret = mnet32_dns_host_exchange(&server, query, len, &r);
+    host_check(&failures,
+               (ret == 12) && (r.id == 0x4567) && (r.rcode == 4),
+               "Other operations are not implemented");
+
+    ret = mnet32_dns_host_exchange(&server, query, 5, &r);
+    host_check(&failures, ret == 0, "Short message is dropped");
+
+    len = mnet32_dns_host_build(query,
+                                0x5678,
+                                "example.com",
+                                MNET32_DNS_HOST_TYPE_A,
+                                false);
+    query[2] |= 0x80;  // QR
+    ret = mnet32_dns_host_exchange(&server, query, len, &r);
+    host_check(&failures, ret == 0, "Response is dropped");
+
+    len = mnet32_dns_host_build(query,
+                                0x6789,
+                                "example.com",
+                                MNET32_DNS_HOST_TYPE_A,
+                                false);
+    query[12] = 0xc0;  // a pointer instead of the first label
+    ret = mnet32_dns_host_exchange(&server, query, len, &r);
+    host_check(&failures, ret == 0, "Compressed name is dropped");
+
+    len = mnet32_dns_host_build(query,
+                                0x789a,
+                                "example.com",
+                                MNET32_DNS_HOST_TYPE_A,
+                                false);
+    ret = mnet32_dns_host_exchange(&server, query, len - 3, &r);
+    host_check(&failures, ret == 0, "Truncated question is dropped");
+
+    loopback.stop = true;
+    pthread_join(thread, NULL);
+    mnet32_dns_close(&loopback.dns);
+
+    host_check(&failures,
+               (loopback.dns.answered == 4) && (loopback.dns.dropped == 4),
+               "Responder counted 4 answered, 4 dropped");
+
+    return host_check_summary(failures);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr,
+                "Usage: %s serve [PORT [ADDRESS]]\n"
+                "       %s query NAME [SERVER [PORT]]\n"
+                "       %s loopback [PORT]\n",
+                argv[0],
+                argv[0],
+                argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "serve") == 0) {
+        return mnet32_dns_host_serve(
+            (argc > 2) ? (uint16_t)atoi(argv[2]) : MNET32_DNS_HOST_PORT,
+            (argc > 3) ? argv[3] : MNET32_DNS_HOST_ADDRESS);
+    }
+    if ((strcmp(argv[1], "query") == 0) && (argc > 2)) {
+        return mnet32_dns_host_query(
+            argv[2],
+            (argc > 3) ? argv[3] : "127.0.0.1",
+            (argc > 4) ? (uint16_t)atoi(argv[4]) : MNET32_DNS_HOST_PORT);
+    }
+    if (strcmp(argv[1], "loopback") == 0) {
+        return mnet32_dns_host_loopback(
+            (argc > 2) ? (uint16_t)atoi(argv[2]) : MNET32_DNS_HOST_PORT);
+    }
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
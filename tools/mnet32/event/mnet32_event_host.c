@@ -0,0 +1,656 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Benchmark the event delivery of the ``mnet32`` component on a Linux host.
+ *
+ * ``mnet32_event.c`` is compiled unmodified, but twice: once posting to the
+ * default event loop and once with ``CONFIG_MNET32_EVENT_LOOP_DEDICATED``.
+ * The symbols of both builds are renamed (``mnet32_default_*`` and
+ * ``mnet32_dedicated_*``), so both are linked into the benchmark.
+ *
+ * The event loops are replaced by threads with a bounded queue, just like
+ * **ESP-IDF**'s event loops:
+ *
+ *   - ``mnet32_event_host bench [EVENTS]`` keeps the default event loop busy
+ *     with the events of other components, that take a while to be handled
+ *     (like the WiFi driver's events). Meanwhile, ``EVENTS`` events of the
+ *     component are emitted with both builds. The benchmark reports the
+ *     posted and dropped events and the maximum dispatch latency, as counted
+ *     by the component. The latency is not checked, as it depends on the
+ *     host.
+ *
+ * Before, several threads register handlers concurrently, which must create
+ * exactly one dedicated event loop.
+ *
+ * @file   mnet32_event_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* The component's headers. */
+#include "mnet32/mnet32.h"
+#include "mnet32_trace.h"
+
+/* The host replacements of ESP-IDF's headers. */
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The default number of events of the component.
+ */
+#define MNET32_EVENT_HOST_EVENTS 200
+
+/**
+ * The interval between the component's events, given in microseconds.
+ */
+#define MNET32_EVENT_HOST_INTERVAL_US 2000
+
+/**
+ * The queue size of the default event loop, just like
+ * ``CONFIG_ESP_SYSTEM_EVENT_QUEUE_SIZE``.
+ */
+#define MNET32_EVENT_HOST_DEFAULT_QUEUE_SIZE 32
+
+/**
+ * The number of threads posting the events of other components.
+ */
+#define MNET32_EVENT_HOST_PRODUCERS 2
+
+/**
+ * The time to handle an event of another component, given in microseconds.
+ */
+#define MNET32_EVENT_HOST_LOAD_US 500
+
+/**
+ * The number of threads registering handlers concurrently.
+ */
+#define MNET32_EVENT_HOST_RACERS 4
+
+/**
+ * The maximum number of handlers of an event loop.
+ */
+#define MNET32_EVENT_HOST_HANDLERS 16
+
+/**
+ * The maximum size of the context data of an event.
+ */
+#define MNET32_EVENT_HOST_DATA_LEN 64
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A registered handler.
+ */
+struct mnet32_event_host_handler {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void* arg;
+};
+
+/**
+ * A queued event, with a copy of its context data.
+ */
+struct mnet32_event_host_item {
+    esp_event_base_t base;
+    int32_t id;
+    size_t data_size;
+    uint8_t data[MNET32_EVENT_HOST_DATA_LEN];
+};
+
+/**
+ * An event loop with its own thread and a bounded queue.
+ */
+struct mnet32_event_host_loop {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    struct mnet32_event_host_item* items;
+    size_t size;
+    size_t head;
+    size_t count;
+    bool stop;
+    pthread_t thread;
+
+    struct mnet32_event_host_handler handlers[MNET32_EVENT_HOST_HANDLERS];
+    size_t handler_count;
+};
+
+/**
+ * The context data of the component's events in the benchmark.
+ */
+struct mnet32_event_host_payload {
+    uint32_t seq;
+    uint32_t check;
+    char text[24];
+};
+
+/**
+ * One build of ``mnet32_event.c``.
+ */
+struct mnet32_event_host_variant {
+    const char* name;
+    esp_err_t (*handler_register)(int32_t event_id,
+                                  esp_event_handler_t handler,
+                                  void* handler_arg,
+                                  esp_event_handler_instance_t* instance);
+    void (*emit)(int32_t event_id, void* event_data, size_t event_data_size);
+    void (*get_stats)(struct mnet32_event_stats* stats);
+
+    uint32_t received;
+    uint32_t invalid;
+};
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+/* The renamed symbols of the builds of ``mnet32_event.c``. */
+esp_err_t mnet32_default_event_handler_register(
+    int32_t event_id,
+    esp_event_handler_t handler,
+    void* handler_arg,
+    esp_event_handler_instance_t* instance);
+void mnet32_default_emit_event(int32_t event_id,
+                               void* event_data,
+                               size_t event_data_size);
+void mnet32_default_event_get_stats(struct mnet32_event_stats* stats);
+esp_err_t mnet32_dedicated_event_handler_register(
+    int32_t event_id,
+    esp_event_handler_t handler,
+    void* handler_arg,
+    esp_event_handler_instance_t* instance);
+void mnet32_dedicated_emit_event(int32_t event_id,
+                                 void* event_data,
+                                 size_t event_data_size);
+void mnet32_dedicated_event_get_stats(struct mnet32_event_stats* stats);
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * The default event loop.
+ */
+static struct mnet32_event_host_loop mnet32_event_host_default_loop;
+
+/**
+ * The number of event loops created by ``esp_event_loop_create()``.
+ */
+static uint32_t mnet32_event_host_loops_created = 0;
+
+/**
+ * Protect ::mnet32_event_host_loops_created .
+ */
+static pthread_mutex_t mnet32_event_host_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * The event base of the other components' events.
+ */
+static esp_event_base_t const mnet32_event_host_load = "LOAD";
+
+/**
+ * Stop the threads posting the other components' events.
+ */
+static volatile bool mnet32_event_host_load_stop = false;
+
+/* The component's trace points are not recorded. */
+struct obs32_trace_group mnet32_trace_group;
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    default:
+        return "ESP_FAIL";
+    }
+}
+
+void esp_log_level_set(const char* tag, esp_log_level_t level) {
+}
+
+/* Only errors are printed, dropped events are counted by the component. */
+void esp_log_write(esp_log_level_t level,
+                   const char* tag,
+                   const char* format,
+                   ...) {
+    if (level > ESP_LOG_ERROR)
+        return;
+
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "E %s: ", tag);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+}
+
+int64_t esp_timer_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void vTaskDelay(TickType_t ticks_to_delay) {
+    usleep(ticks_to_delay * 1000);
+}
+
+/**
+ * The thread of an event loop, dispatching the queued events.
+ *
+ * @param arg The event loop (::mnet32_event_host_loop ).
+ * @return void* Always ``NULL``.
+ */
+static void* mnet32_event_host_loop_run(void* arg) {
+    struct mnet32_event_host_loop* loop = arg;
+    struct mnet32_event_host_handler handlers[MNET32_EVENT_HOST_HANDLERS];
+    struct mnet32_event_host_item item;
+
+    for (;;) {
+        pthread_mutex_lock(&loop->lock);
+        while ((loop->count == 0) && !loop->stop)
+            pthread_cond_wait(&loop->not_empty, &loop->lock);
+        if (loop->count == 0) {
+            pthread_mutex_unlock(&loop->lock);
+            return NULL;
+        }
+        item = loop->items[loop->head];
+        loop->head = (loop->head + 1) % loop->size;
+        loop->count--;
+        size_t handler_count = loop->handler_count;
+        memcpy(handlers, loop->handlers, sizeof(handlers));
+        pthread_cond_signal(&loop->not_full);
+        pthread_mutex_unlock(&loop->lock);
+
+        for (size_t i = 0; i < handler_count; i++) {
+            if ((handlers[i].base != item.base) ||
+                ((handlers[i].id != ESP_EVENT_ANY_ID) &&
+                 (handlers[i].id != item.id)))
+                continue;
+            handlers[i].handler(handlers[i].arg,
+                                item.base,
+                                item.id,
+                                (item.data_size > 0) ? item.data : NULL);
+        }
+    }
+}
+
+/**
+ * Set up an event loop and start its thread.
+ *
+ * @param loop The event loop.
+ * @param size The size of the queue.
+ */
+static void mnet32_event_host_loop_start(struct mnet32_event_host_loop* loop,
+                                         size_t size) {
+    memset(loop, 0, sizeof(*loop));
+    pthread_mutex_init(&loop->lock, NULL);
+    pthread_cond_init(&loop->not_empty, NULL);
+    pthread_cond_init(&loop->not_full, NULL);
+    loop->items = calloc(size, sizeof(struct mnet32_event_host_item));
+    loop->size = size;
+    pthread_create(&loop->thread, NULL, mnet32_event_host_loop_run, loop);
+}
+
+esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args,
+                                esp_event_loop_handle_t* event_loop) {
+    struct mnet32_event_host_loop* loop = malloc(sizeof(*loop));
+    if (loop == NULL)
+        return ESP_ERR_NO_MEM;
+
+    /* Give the racing threads a chance to interfere. */
+    usleep(1000);
+    mnet32_event_host_loop_start(loop, (size_t)event_loop_args->queue_size);
+
+    pthread_mutex_lock(&mnet32_event_host_lock);
+    mnet32_event_host_loops_created++;
+    pthread_mutex_unlock(&mnet32_event_host_lock);
+
+    *event_loop = loop;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop,
+                            esp_event_base_t event_base,
+                            int32_t event_id,
+                            const void* event_data,
+                            size_t event_data_size,
+                            TickType_t ticks_to_wait) {
+    struct mnet32_event_host_loop* loop = event_loop;
+
+    if (event_data_size > MNET32_EVENT_HOST_DATA_LEN)
+        return ESP_ERR_INVALID_ARG;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ticks_to_wait / 1000;
+    deadline.tv_nsec += (long)(ticks_to_wait % 1000) * 1000000;  // NOLINT
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&loop->lock);
+    while (loop->count == loop->size) {
+        if (ticks_to_wait == portMAX_DELAY) {
+            pthread_cond_wait(&loop->not_full, &loop->lock);
+        } else if (pthread_cond_timedwait(&loop->not_full,
+                                          &loop->lock,
+                                          &deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&loop->lock);
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    struct mnet32_event_host_item* item =
+        &loop->items[(loop->head + loop->count) % loop->size];
+    item->base = event_base;
+    item->id = event_id;
+    item->data_size = (event_data != NULL) ? event_data_size : 0;
+    if (item->data_size > 0)
+        memcpy(item->data, event_data, item->data_size);
+    loop->count++;
+    pthread_cond_signal(&loop->not_empty);
+    pthread_mutex_unlock(&loop->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base,
+                         int32_t event_id,
+                         const void* event_data,
+                         size_t event_data_size,
+                         TickType_t ticks_to_wait) {
+    return esp_event_post_to(&mnet32_event_host_default_loop,
+                             event_base,
+                             event_id,
+                             event_data,
+                             event_data_size,
+                             ticks_to_wait);
+}
+
+esp_err_t esp_event_handler_instance_register_with(
+    esp_event_loop_handle_t event_loop,
+    esp_event_base_t event_base,
+    int32_t event_id,
+    esp_event_handler_t event_handler,
+    void* event_handler_arg,
+    esp_event_handler_instance_t* instance) {
+    struct mnet32_event_host_loop* loop = event_loop;
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    pthread_mutex_lock(&loop->lock);
+    if (loop->handler_count < MNET32_EVENT_HOST_HANDLERS) {
+        struct mnet32_event_host_handler* handler =
+            &loop->handlers[loop->handler_count++];
+        handler->base = event_base;
+        handler->id = event_id;
+        handler->handler = event_handler;
+        handler->arg = event_handler_arg;
+        if (instance != NULL)
+            *instance = handler;
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&loop->lock);
+
+    return ret;
+}
+
+esp_err_t esp_event_handler_instance_register(
+    esp_event_base_t event_base,
+    int32_t event_id,
+    esp_event_handler_t event_handler,
+    void* event_handler_arg,
+    esp_event_handler_instance_t* instance) {
+    return esp_event_handler_instance_register_with(
+        &mnet32_event_host_default_loop,
+        event_base,
+        event_id,
+        event_handler,
+        event_handler_arg,
+        instance);
+}
+
+/* Handlers are never unregistered by the benchmark. */
+esp_err_t esp_event_handler_instance_unregister_with(
+    esp_event_loop_handle_t event_loop,
+    esp_event_base_t event_base,
+    int32_t event_id,
+    esp_event_handler_instance_t instance) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_event_handler_instance_unregister(
+    esp_event_base_t event_base,
+    int32_t event_id,
+    esp_event_handler_instance_t instance) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+/**
+ * Handle an event of another component, which takes a while.
+ */
+static void mnet32_event_host_on_load(void* arg,
+                                      esp_event_base_t event_base,
+                                      int32_t event_id,
+                                      void* event_data) {
+    usleep(MNET32_EVENT_HOST_LOAD_US);
+}
+
+/**
+ * The thread of another component, posting events to the default loop.
+ *
+ * @param arg Not used.
+ * @return void* Always ``NULL``.
+ */
+static void* mnet32_event_host_produce(void* arg) {
+    while (!mnet32_event_host_load_stop)
+        esp_event_post(mnet32_event_host_load, 0, NULL, 0, 100);
+    return NULL;
+}
+
+/**
+ * Handle the component's events and verify their context data.
+ *
+ * @param arg        The build (::mnet32_event_host_variant ).
+ * @param event_base Not used.
+ * @param event_id   Not used.
+ * @param event_data The ``struct mnet32_event_host_payload``.
+ */
+static void mnet32_event_host_on_event(void* arg,
+                                       esp_event_base_t event_base,
+                                       int32_t event_id,
+                                       void* event_data) {
+    struct mnet32_event_host_variant* variant = arg;
+    struct mnet32_event_host_payload* payload = event_data;
+
+    if ((payload == NULL) || (payload->check != ~payload->seq) ||
+        (strcmp(payload->text, "mnet32_event_host") != 0))
+        variant->invalid++;
+    variant->received++;
+}
+
+/**
+ * Register a handler concurrently with other threads.
+ *
+ * @param arg The build (::mnet32_event_host_variant ).
+ * @return void* Always ``NULL``.
+ */
+static void* mnet32_event_host_race(void* arg) {
+    struct mnet32_event_host_variant* variant = arg;
+
+    variant->handler_register(MNET32_EVENT_READY,
+                              mnet32_event_host_on_load,
+                              NULL,
+                              NULL);
+    return NULL;
+}
+
+/**
+ * Emit the component's events while the default loop is busy.
+ *
+ * @param variant The build of ``mnet32_event.c``.
+ * @param events  The number of events.
+ * @param stats   The component's statistics after the run.
+ */
+static void mnet32_event_host_run(struct mnet32_event_host_variant* variant,
+                                  uint32_t events,
+                                  struct mnet32_event_stats* stats) {
+    pthread_t producers[MNET32_EVENT_HOST_PRODUCERS];
+
+    variant->handler_register(ESP_EVENT_ANY_ID,
+                              mnet32_event_host_on_event,
+                              variant,
+                              NULL);
+
+    mnet32_event_host_load_stop = false;
+    for (size_t i = 0; i < MNET32_EVENT_HOST_PRODUCERS; i++)
+        pthread_create(&producers[i], NULL, mnet32_event_host_produce, NULL);
+    usleep(50000);
+
+    for (uint32_t i = 0; i < events; i++) {
+        struct mnet32_event_host_payload payload = {
+            .seq = i,
+            .check = ~i,
+            .text = "mnet32_event_host",
+        };
+        variant->emit((i % 2) ? MNET32_EVENT_UNAVAILABLE : MNET32_EVENT_READY,
+                      &payload,
+                      sizeof(payload));
+        usleep(MNET32_EVENT_HOST_INTERVAL_US);
+    }
+
+    mnet32_event_host_load_stop = true;
+    for (size_t i = 0; i < MNET32_EVENT_HOST_PRODUCERS; i++)
+        pthread_join(producers[i], NULL);
+
+    /* Let the loops drain. */
+    usleep(200000);
+
+    variant->get_stats(stats);
+    printf("     %-9s: posted %u, dropped %u, max. latency %u us\n",
+           variant->name,
+           stats->posted,
+           stats->dropped,
+           stats->max_dispatch_latency_us);
+}
+
+/**
+ * Run the benchmark.
+ *
+ * @param events The number of events of the component.
+ * @return int ``0`` if all checks passed.
+ */
+static int mnet32_event_host_bench(uint32_t events) {
+    struct mnet32_event_host_variant shared = {
+        .name = "default",
+        .handler_register = mnet32_default_event_handler_register,
+        .emit = mnet32_default_emit_event,
+        .get_stats = mnet32_default_event_get_stats,
+    };
+    struct mnet32_event_host_variant dedicated = {
+        .name = "dedicated",
+        .handler_register = mnet32_dedicated_event_handler_register,
+        .emit = mnet32_dedicated_emit_event,
+        .get_stats = mnet32_dedicated_event_get_stats,
+    };
+    struct mnet32_event_stats shared_stats;
+    struct mnet32_event_stats dedicated_stats;
+    int failures = 0;
+
+    if (events == 0) {
+        fprintf(stderr, "EVENTS must be above 0!\n");
+        return 1;
+    }
+
+    mnet32_event_host_loop_start(&mnet32_event_host_default_loop,
+                                 MNET32_EVENT_HOST_DEFAULT_QUEUE_SIZE);
+    esp_event_handler_instance_register(mnet32_event_host_load,
+                                        ESP_EVENT_ANY_ID,
+                                        mnet32_event_host_on_load,
+                                        NULL,
+                                        NULL);
+
+    pthread_t racers[MNET32_EVENT_HOST_RACERS];
+    for (size_t i = 0; i < MNET32_EVENT_HOST_RACERS; i++)
+        pthread_create(&racers[i], NULL, mnet32_event_host_race, &dedicated);
+    for (size_t i = 0; i < MNET32_EVENT_HOST_RACERS; i++)
+        pthread_join(racers[i], NULL);
+    host_check(&failures,
+               mnet32_event_host_loops_created == 1,
+               "Concurrent registrations create one event loop");
+
+    mnet32_event_host_run(&shared, events, &shared_stats);
+    mnet32_event_host_run(&dedicated, events, &dedicated_stats);
+
+    /* The latencies depend on the host's scheduler, so they are reported but
+     * not checked.
+     */
+    printf("     max dispatch latency shared / dedicated: %.1fx\n",
+           (dedicated_stats.max_dispatch_latency_us > 0)
+               ? (double)shared_stats.max_dispatch_latency_us /
+                     dedicated_stats.max_dispatch_latency_us
+               : 0.0);
+
+    host_check(
+        &failures,
+        (shared_stats.posted + shared_stats.dropped == events) &&
+            (dedicated_stats.posted + dedicated_stats.dropped == events) &&
+            (shared.received == shared_stats.posted) &&
+            (dedicated.received == dedicated_stats.posted),
+        "Posted and dropped events are counted");
+    host_check(&failures,
+               (shared.invalid == 0) && (dedicated.invalid == 0),
+               "Context data is copied completely");
+    host_check(&failures,
+               dedicated_stats.dropped == 0,
+               "The dedicated loop does not drop events");
+
+    return host_check_summary(failures);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s bench [EVENTS]\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "bench") == 0) {
+        return mnet32_event_host_bench(
+            (argc > 2) ? (uint32_t)atoi(argv[2]) : MNET32_EVENT_HOST_EVENTS);
+    }
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,728 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Run the caching DNS resolver of the ``mnet32`` component on a Linux host.
+ *
+ * The resolver's engine is compiled unmodified and tested against a local
+ * stand-in DNS server, which answers every query with an address of
+ * ``10.0.0.0/24`` and counts the queries:
+ *
+ *   - ``mnet32_resolver_host serve [PORT [TTL]]`` runs the stand-in server;
+ *   - ``mnet32_resolver_host query NAME [SERVER [PORT]]`` resolves ``NAME``,
+ *     e.g. with an actual DNS server;
+ *   - ``mnet32_resolver_host loopback [PORT]`` runs the stand-in server and
+ *     verifies lookups, expiry, prefetching and invalidation of the cache in
+ *     virtual time, and that forged responses are not accepted.
+ *
+ * The stand-in server answers names starting with ``nx.`` with ``NXDOMAIN``
+ * and names starting with ``alias.`` with an alias (``CNAME``, TTL
+ * ::MNET32_RESOLVER_HOST_ALIAS_TTL ) and the address of the alias' target.
+ *
+ * @file   mnet32_resolver_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* The resolver's engine. */
+#include "mnet32_resolver_engine.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The default port of the stand-in server, as the actual DNS port requires
+ * privileges.
+ */
+#define MNET32_RESOLVER_HOST_PORT 5354
+
+/**
+ * The default TTL of the stand-in server's addresses, given in seconds.
+ */
+#define MNET32_RESOLVER_HOST_TTL 300
+
+/**
+ * The TTL of the stand-in server's aliases, given in seconds.
+ */
+#define MNET32_RESOLVER_HOST_ALIAS_TTL 60
+
+/**
+ * The number of entries of the loopback test's cache.
+ */
+#define MNET32_RESOLVER_HOST_CACHE_SIZE 2
+
+/**
+ * The prefetch window of the loopback test (in milliseconds).
+ */
+#define MNET32_RESOLVER_HOST_WINDOW 10000
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * The stand-in DNS server.
+ */
+struct mnet32_resolver_host_server {
+    int socket;
+    volatile uint32_t ttl;
+    volatile uint32_t queries;
+    volatile bool stop;
+};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Append a resource record.
+ *
+ * @param buf      The message.
+ * @param off      The offset of the record.
+ * @param pointer  The offset of the record's name (compression).
+ * @param type     The record's type.
+ * @param ttl      The record's TTL.
+ * @param data     The record's data.
+ * @param data_len The length of ``data``.
+ * @return size_t The offset after the record.
+ */
+static size_t mnet32_resolver_host_record(uint8_t* buf,
+                                          size_t off,
+                                          uint16_t pointer,
+                                          uint16_t type,
+                                          uint32_t ttl,
+                                          const uint8_t* data,
+                                          uint16_t data_len) {
+    buf[off++] = 0xc0 | (pointer >> 8);
+    buf[off++] = pointer & 0xff;
+    buf[off++] = type >> 8;
+    buf[off++] = type & 0xff;
+    buf[off++] = 0;
+    buf[off++] = 1;  // IN
+    for (int shift = 24; shift >= 0; shift -= 8)
+        buf[off++] = (ttl >> shift) & 0xff;
+    buf[off++] = data_len >> 8;
+    buf[off++] = data_len & 0xff;
+    memcpy(buf + off, data, data_len);
+    return off + data_len;
+}
+
+/**
+ * Answer one query of the stand-in server.
+ *
+ * @param server The server.
+ * @return int ``0`` on success (or timeout), ``-1`` on failure.
+ */
+static int mnet32_resolver_host_answer(
+    struct mnet32_resolver_host_server* server) {
+    uint8_t buf[MNET32_RESOLVER_MSG_LEN];
+    struct sockaddr_in peer;
+    socklen_t peer_len = sizeof(peer);
+
+    ssize_t len = recvfrom(server->socket,
+                           buf,
+                           sizeof(buf),
+                           0,
+                           (struct sockaddr*)&peer,
+                           &peer_len);
+    if (len < 0)
+        return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? 0 : -1;
+    if (len < 17)
+        return 0;
+
+    /* Decode the name of the question, e.g. to detect ``nx.``. */
+    char name[256] = {0};
+    size_t off = 12;
+    while ((off < (size_t)len) && (buf[off] != 0) &&
+           (off + 1 + buf[off] < (size_t)len)) {
+        strncat(name, (const char*)buf + off + 1, buf[off]);
+        strcat(name, ".");
+        off += 1 + buf[off];
+    }
+    off += 5;  // root label, type, class
+    if (off > (size_t)len)
+        return 0;
+
+    uint32_t count = ++server->queries;
+    uint8_t address[4] = {10, 0, 0, (uint8_t)count};
+
+    buf[2] = 0x81;  // QR, RD
+    buf[3] = 0x80;  // RA
+    memset(buf + 6, 0, 6);
+
+    if (strncmp(name, "nx.", 3) == 0) {
+        buf[3] |= 3;  // NXDOMAIN
+    } else if (strncmp(name, "alias.", 6) == 0) {
+        const uint8_t target[] = "\6target\7example\0";
+        size_t target_off = off + 12;
+        off = mnet32_resolver_host_record(buf,
+                                          off,
+                                          12,
+                                          5,  // CNAME
+                                          MNET32_RESOLVER_HOST_ALIAS_TTL,
+                                          target,
+                                          sizeof(target) - 1);
+        off = mnet32_resolver_host_record(buf,
+                                          off,
+                                          (uint16_t)target_off,
+                                          1,  // A
+                                          server->ttl,
+                                          address,
+                                          sizeof(address));
+        buf[7] = 2;
+    } else {
+        off = mnet32_resolver_host_record(buf,
+                                          off,
+                                          12,
+                                          1,  // A
+                                          server->ttl,
+                                          address,
+                                          sizeof(address));
+        buf[7] = 1;
+    }
+
+    sendto(server->socket,
+           buf,
+           off,
+           0,
+           (struct sockaddr*)&peer,
+           peer_len);
+    return 0;
+}
+
+/**
+ * Open the socket of the stand-in server.
+ *
+ * @param server The server.
+ * @param port   The port to listen on.
+ * @param ttl    The TTL of the addresses, given in seconds.
+ * @return int ``0`` on success, ``-1`` on failure (with ``errno`` set).
+ */
+static int mnet32_resolver_host_open(struct mnet32_resolver_host_server* server,
+                                     uint16_t port,
+                                     uint32_t ttl) {
+    server->ttl = ttl;
+    server->queries = 0;
+    server->stop = false;
+
+    server->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (server->socket < 0)
+        return -1;
+
+    struct timeval timeout = {.tv_sec = 0, .tv_usec = 100000};
+    struct sockaddr_in local = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+
+    setsockopt(server->socket,
+               SOL_SOCKET,
+               SO_RCVTIMEO,
+               &timeout,
+               sizeof(timeout));
+    if (bind(server->socket, (struct sockaddr*)&local, sizeof(local)) != 0) {
+        close(server->socket);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * The thread of the stand-in server.
+ *
+ * @param arg The server.
+ * @return void* Always ``NULL``.
+ */
+static void* mnet32_resolver_host_thread(void* arg) {
+    struct mnet32_resolver_host_server* server = arg;
+
+    while (!server->stop) {
+        if (mnet32_resolver_host_answer(server) != 0)
+            break;
+    }
+
+    return NULL;
+}
+
+/**
+ * Run the stand-in server forever.
+ *
+ * @param port The port to listen on.
+ * @param ttl  The TTL of the addresses, given in seconds.
+ * @return int The exit code.
+ */
+static int mnet32_resolver_host_serve(uint16_t port, uint32_t ttl) {
+    struct mnet32_resolver_host_server server;
+
+    if (mnet32_resolver_host_open(&server, port, ttl) != 0) {
+        fprintf(stderr, "Could not open server: %s\n", strerror(errno));
+        return 1;
+    }
+    printf("Answering queries on 127.0.0.1:%d (TTL %us)\n", port, ttl);
+
+    mnet32_resolver_host_thread(&server);
+    close(server.socket);
+    return 1;
+}
+
+/**
+ * Resolve a name.
+ *
+ * @param name   The name to resolve.
+ * @param server The address of the DNS server.
+ * @param port   The port of the DNS server.
+ * @return int The exit code.
+ */
+static int mnet32_resolver_host_query(const char* name,
+                                      const char* server,
+                                      uint16_t port) {
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+    };
+    if (inet_aton(server, &addr.sin_addr) == 0) {
+        fprintf(stderr, "Please specify a valid SERVER!\n");
+        return 1;
+    }
+
+    uint32_t address;
+    uint32_t ttl;
+    if (mnet32_resolver_query(&addr, 0x4d33, name, &address, &ttl) != 0) {
+        fprintf(stderr, "%s: %s\n", name, strerror(errno));
+        return 1;
+    }
+
+    struct in_addr answer = {.s_addr = address};
+    printf("%s: %s (ttl %u)\n", name, inet_ntoa(answer), ttl);
+    return 0;
+}
+
+/**
+ * Resolve a name with the cache, just like ``mnet32_resolve()``.
+ *
+ * @param cache   The cache.
+ * @param server  The address of the DNS server.
+ * @param name    The name to resolve.
+ * @param now     The (virtual) time.
+ * @param address The address.
+ * @return int ``0`` on success, ``-1`` on failure (with ``errno`` set).
+ */
+static int mnet32_resolver_host_resolve(struct mnet32_resolver_cache* cache,
+                                        const struct sockaddr_in* server,
+                                        const char* name,
+                                        int64_t now,
+                                        uint32_t* address) {
+    static uint16_t id = 0;
+    uint32_t ttl;
+
+    if (mnet32_resolver_cache_lookup(cache, name, now, address))
+        return 0;
+
+    uint32_t generation = cache->generation;
+    if (mnet32_resolver_query(server, ++id, name, address, &ttl) != 0)
+        return -1;
+
+    mnet32_resolver_cache_store(cache, generation, name, *address, ttl, now);
+    return 0;
+}
+
+/**
+ * Build a response with an address, as an attacker would forge it.
+ *
+ * @param buf  The message, at least ::MNET32_RESOLVER_MSG_LEN bytes.
+ * @param id   The ID of the response.
+ * @param name The name of the question.
+ * @return size_t The length of the response.
+ */
+static size_t mnet32_resolver_host_forge(uint8_t* buf,
+                                         uint16_t id,
+                                         const char* name) {
+    const uint8_t address[4] = {10, 0, 0, 0xee};
+
+    size_t off = mnet32_resolver_build_query(buf, id, name);
+    buf[2] = 0x81;  // QR, RD
+    buf[3] = 0x80;  // RA
+    buf[7] = 1;
+    return mnet32_resolver_host_record(buf,
+                                       off,
+                                       12,
+                                       1,  // A
+                                       MNET32_RESOLVER_HOST_TTL,
+                                       address,
+                                       sizeof(address));
+}
+
+/**
+ * Send a forged response to the socket of a prefetch from another socket.
+ *
+ * @param prefetch The prefetch.
+ * @param id       The ID of the response.
+ * @param name     The name of the question.
+ * @return int ``0`` on success, ``-1`` on failure (with ``errno`` set).
+ */
+static int mnet32_resolver_host_spoof(
+    const struct mnet32_resolver_prefetch* prefetch,
+    uint16_t id,
+    const char* name) {
+    uint8_t buf[MNET32_RESOLVER_MSG_LEN];
+    struct sockaddr_in target;
+    socklen_t target_len = sizeof(target);
+
+    if (getsockname(prefetch->socket,
+                    (struct sockaddr*)&target,
+                    &target_len) != 0)
+        return -1;
+    target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+        return -1;
+
+    size_t len = mnet32_resolver_host_forge(buf, id, name);
+    ssize_t sent = sendto(sock,
+                          buf,
+                          len,
+                          0,
+                          (struct sockaddr*)&target,
+                          sizeof(target));
+    close(sock);
+    return (sent < 0) ? -1 : 0;
+}
+
+/**
+ * Verify the resolver with the stand-in server over the loopback interface.
+ *
+ * @param port The port to use.
+ * @return int The exit code.
+ */
+static int mnet32_resolver_host_loopback(uint16_t port) {
+    struct mnet32_resolver_host_server stand_in;
+    int failures = 0;
+
+    if (mnet32_resolver_host_open(&stand_in,
+                                  port,
+                                  MNET32_RESOLVER_HOST_TTL) != 0) {
+        fprintf(stderr, "Could not open server: %s\n", strerror(errno));
+        return 1;
+    }
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, mnet32_resolver_host_thread, &stand_in);
+
+    struct sockaddr_in server = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    struct mnet32_resolver_entry entries[MNET32_RESOLVER_HOST_CACHE_SIZE];
+    struct mnet32_resolver_cache cache;
+    struct mnet32_resolver_prefetch prefetch = {.socket = -1};
+    char name[MNET32_RESOLVER_NAME_LEN];
+    uint32_t address;
+    uint32_t ttl;
+    int64_t now = 1000;
+    int ret;
+
+    mnet32_resolver_cache_init(&cache,
+                               entries,
+                               MNET32_RESOLVER_HOST_CACHE_SIZE);
+
+    /* Lookups and expiry. */
+    ret = mnet32_resolver_host_resolve(&cache,
+                                       &server,
+                                       "stream.example",
+                                       now,
+                                       &address);
+    host_check(&failures,
+               (ret == 0) && (stand_in.queries == 1) &&
+                   (address == htonl(0x0a000001)),
+               "Miss is resolved by the server");
+
+    ret = mnet32_resolver_host_resolve(&cache,
+                                       &server,
+                                       "STREAM.example",
+                                       now + 299000,
+                                       &address);
+    host_check(&failures,
+               (ret == 0) && (stand_in.queries == 1) &&
+                   (address == htonl(0x0a000001)),
+               "Hit within the TTL does not query");
+
+    ret = mnet32_resolver_host_resolve(&cache,
+                                       &server,
+                                       "stream.example",
+                                       now + 300000,
+                                       &address);
+    host_check(&failures,
+               (ret == 0) && (stand_in.queries == 2) &&
+                   (address == htonl(0x0a000002)),
+               "Expired name is resolved again");
+    now += 300000;
+
+    ret = mnet32_resolver_query(&server,
+                                0x0101,
+                                "alias.example",
+                                &address,
+                                &ttl);
+    host_check(&failures,
+               (ret == 0) && (address == htonl(0x0a000003)) &&
+                   (ttl == MNET32_RESOLVER_HOST_ALIAS_TTL),
+               "Alias is followed, with the minimum TTL");
+
+    ret = mnet32_resolver_query(&server, 0x0102, "nx.example", &address, &ttl);
+    host_check(&failures,
+               (ret == -1) && (errno == ENOENT),
+               "Unknown name is reported");
+
+    /* Prefetching. */
+    stand_in.ttl = 30;
+    mnet32_resolver_host_resolve(&cache,
+                                 &server,
+                                 "api.example",
+                                 now,
+                                 &address);
+    bool found = mnet32_resolver_cache_prefetch(&cache,
+                                                now,
+                                                MNET32_RESOLVER_HOST_WINDOW,
+                                                name);
+    host_check(&failures, !found, "Names are not refreshed before the window");
+
+    found = mnet32_resolver_cache_prefetch(&cache,
+                                           now + 25000,
+                                           MNET32_RESOLVER_HOST_WINDOW,
+                                           name);
+    host_check(&failures,
+               !found,
+               "Names, that were not looked up, are not "
+               "refreshed");
+
+    mnet32_resolver_host_resolve(&cache,
+                                 &server,
+                                 "api.example",
+                                 now + 1000,
+                                 &address);
+    found = mnet32_resolver_cache_prefetch(&cache,
+                                           now + 25000,
+                                           MNET32_RESOLVER_HOST_WINDOW,
+                                           name);
+    ret = found ? mnet32_resolver_prefetch_send(&prefetch,
+                                                &server,
+                                                0x0201,
+                                                cache.generation,
+                                                name)
+                : -1;
+    usleep(100000);
+    ret = (ret == 0) ? mnet32_resolver_prefetch_receive(&prefetch,
+                                                        &address,
+                                                        &ttl)
+                     : -1;
+    if (ret == 1)
+        mnet32_resolver_cache_store(&cache,
+                                    prefetch.generation,
+                                    prefetch.name,
+                                    address,
+                                    ttl,
+                                    now + 30000);
+    uint32_t queries = stand_in.queries;
+    ret = mnet32_resolver_host_resolve(&cache,
+                                       &server,
+                                       "api.example",
+                                       now + 45000,
+                                       &address);
+    host_check(&failures,
+               found && (strcmp(name, "api.example") == 0) &&
+                   (ret == 0) &&
+                   (stand_in.queries == queries) &&
+                   (address == htonl(0x0a000006)),
+               "Hot name is refreshed ahead of its expiry");
+
+    /* There is no server on the next port, only the forged response. */
+    struct sockaddr_in silent = server;
+    silent.sin_port = htons(port + 1);
+    ret = mnet32_resolver_prefetch_send(&prefetch,
+                                        &silent,
+                                        0x0202,
+                                        cache.generation,
+                                        "api.example");
+    ret = (ret == 0) ? mnet32_resolver_host_spoof(&prefetch,
+                                                  0x0202,
+                                                  "api.example")
+                     : -1;
+    usleep(100000);
+    ret = (ret == 0) ? mnet32_resolver_prefetch_receive(&prefetch,
+                                                        &address,
+                                                        &ttl)
+                     : -1;
+    host_check(&failures,
+               ret == 0,
+               "Prefetch ignores responses of other peers");
+
+    /* Answers of another question. */
+    uint8_t forged[MNET32_RESOLVER_MSG_LEN];
+    size_t forged_len =
+        mnet32_resolver_host_forge(forged, 0x0203, "evil.example");
+    ret = mnet32_resolver_parse_response(forged,
+                                         forged_len,
+                                         0x0203,
+                                         "api.example",
+                                         &address,
+                                         &ttl);
+    host_check(&failures,
+               (ret == -1) && (errno == EBADMSG),
+               "Answer of another question is rejected");
+
+    forged_len = mnet32_resolver_host_forge(forged, 0x0204, "API.example");
+    ret = mnet32_resolver_parse_response(forged,
+                                         forged_len,
+                                         0x0204,
+                                         "api.example",
+                                         &address,
+                                         &ttl);
+    host_check(&failures,
+               (ret == 0) && (address == htonl(0x0a0000ee)),
+               "Question is compared case-insensitively");
+
+    /* Replacement, a cache of two names. */
+    mnet32_resolver_host_resolve(&cache,
+                                 &server,
+                                 "a.example",
+                                 now + 46000,
+                                 &address);
+    queries = stand_in.queries;
+    mnet32_resolver_host_resolve(&cache,
+                                 &server,
+                                 "api.example",
+                                 now + 46000,
+                                 &address);
+    mnet32_resolver_host_resolve(&cache,
+                                 &server,
+                                 "a.example",
+                                 now + 46000,
+                                 &address);
+    host_check(
+        &failures, stand_in.queries == queries, "Recently used names are kept");
+
+    /* Invalidation. */
+    uint32_t generation = cache.generation;
+    mnet32_resolver_cache_invalidate(&cache);
+    mnet32_resolver_cache_store(&cache,
+                                generation,
+                                "late.example",
+                                htonl(0x0a0000ff),
+                                300,
+                                now + 46000);
+    found = mnet32_resolver_cache_lookup(&cache,
+                                         "a.example",
+                                         now + 46000,
+                                         &address) ||
+            mnet32_resolver_cache_lookup(&cache,
+                                         "late.example",
+                                         now + 46000,
+                                         &address);
+    host_check(&failures,
+               !found,
+               "Invalidation empties the cache and discards "
+               "pending answers");
+
+    mnet32_resolver_cache_store(&cache,
+                                cache.generation,
+                                "zero.example",
+                                htonl(0x0a0000fe),
+                                0,
+                                now + 46000);
+    mnet32_resolver_cache_store(&cache,
+                                cache.generation,
+                                "long.example",
+                                htonl(0x0a0000fd),
+                                86400,
+                                now + 46000);
+    found = mnet32_resolver_cache_lookup(&cache,
+                                         "zero.example",
+                                         now + 46000,
+                                         &address);
+    bool clamped = !mnet32_resolver_cache_lookup(
+        &cache,
+        "long.example",
+        now + 46000 + MNET32_RESOLVER_TTL_MAX * 1000,
+        &address);
+    host_check(&failures,
+               !found && clamped,
+               "TTL of 0 is not cached, long TTLs are "
+               "shortened");
+
+    host_check(&failures,
+               (cache.hits == 5) && (cache.misses == 8) &&
+                   (cache.prefetches == 1) &&
+                   (cache.invalidations == 1),
+               "Cache counted 5 hits, 8 misses, 1 prefetch");
+
+    /* Timeout, there is no server on the next port. */
+    server.sin_port = htons(port + 1);
+    ret = mnet32_resolver_query(&server,
+                                0x0301,
+                                "example.com",
+                                &address,
+                                &ttl);
+    host_check(&failures,
+               (ret == -1) && (errno == ETIMEDOUT),
+               "Missing server times out");
+
+    stand_in.stop = true;
+    pthread_join(thread, NULL);
+    close(stand_in.socket);
+    mnet32_resolver_prefetch_close(&prefetch);
+
+    return host_check_summary(failures);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr,
+                "Usage: %s serve [PORT [TTL]]\n"
+                "       %s query NAME [SERVER [PORT]]\n"
+                "       %s loopback [PORT]\n",
+                argv[0],
+                argv[0],
+                argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "serve") == 0) {
+        return mnet32_resolver_host_serve(
+            (argc > 2) ? (uint16_t)atoi(argv[2]) : MNET32_RESOLVER_HOST_PORT,
+            (argc > 3) ? (uint32_t)atoi(argv[3]) : MNET32_RESOLVER_HOST_TTL);
+    }
+    if ((strcmp(argv[1], "query") == 0) && (argc > 2)) {
+        return mnet32_resolver_host_query(
+            argv[2],
+            (argc > 3) ? argv[3] : "127.0.0.1",
+            (argc > 4) ? (uint16_t)atoi(argv[4]) : MNET32_RESOLVER_HOST_PORT);
+    }
+    if (strcmp(argv[1], "loopback") == 0) {
+        return mnet32_resolver_host_loopback(
+            (argc > 2) ? (uint16_t)atoi(argv[2]) : MNET32_RESOLVER_HOST_PORT);
+    }
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,36 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Host replacement of **ESP-IDF**'s ``esp_err.h`` for the simulator.
+ *
+ * @file   esp_err.h
+ */
+
+#ifndef TOOLS_MNET32_SIM_INCLUDE_ESP_ERR_H_
+#define TOOLS_MNET32_SIM_INCLUDE_ESP_ERR_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT 0x107
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+
+const char* esp_err_to_name(esp_err_t code);
+
+#define ESP_ERROR_CHECK(x) (void)(x)
+
+#endif  // TOOLS_MNET32_SIM_INCLUDE_ESP_ERR_H_
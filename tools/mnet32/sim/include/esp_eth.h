@@ -0,0 +1,82 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Host replacement of **ESP-IDF**'s ``esp_eth.h`` for the simulator.
+ *
+ * The functions are implemented by a scripted fake (see ``sim_eth.c``),
+ * which posts the corresponding ``ETH_EVENT`` and ``IP_EVENT`` occurences in
+ * *virtual* time. The MAC and PHY are not modelled, only the link.
+ *
+ * @file   esp_eth.h
+ */
+
+#ifndef TOOLS_MNET32_SIM_INCLUDE_ESP_ETH_H_
+#define TOOLS_MNET32_SIM_INCLUDE_ESP_ETH_H_
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+
+ESP_EVENT_DECLARE_BASE(ETH_EVENT);
+
+typedef enum {
+    ETHERNET_EVENT_START,
+    ETHERNET_EVENT_STOP,
+    ETHERNET_EVENT_CONNECTED,
+    ETHERNET_EVENT_DISCONNECTED
+} eth_event_t;
+
+typedef void* esp_eth_handle_t;
+typedef void* esp_eth_netif_glue_handle_t;
+
+typedef struct esp_eth_mac_s {
+    esp_err_t (*del)(struct esp_eth_mac_s* mac);
+} esp_eth_mac_t;
+
+typedef struct esp_eth_phy_s {
+    esp_err_t (*del)(struct esp_eth_phy_s* phy);
+} esp_eth_phy_t;
+
+typedef struct {
+    int smi_mdc_gpio_num;
+    int smi_mdio_gpio_num;
+} eth_mac_config_t;
+
+typedef struct {
+    int32_t phy_addr;
+    int reset_gpio_num;
+} eth_phy_config_t;
+
+typedef struct {
+    esp_eth_mac_t* mac;
+    esp_eth_phy_t* phy;
+} esp_eth_config_t;
+
+#define ETH_MAC_DEFAULT_CONFIG() \
+    { .smi_mdc_gpio_num = 23, .smi_mdio_gpio_num = 18 }
+
+#define ETH_PHY_DEFAULT_CONFIG() \
+    { .phy_addr = 1, .reset_gpio_num = 5 }
+
+#define ETH_DEFAULT_CONFIG(emac, ephy) \
+    { .mac = emac, .phy = ephy }
+
+esp_eth_mac_t* esp_eth_mac_new_esp32(const eth_mac_config_t* config);
+esp_eth_phy_t* esp_eth_phy_new_ip101(const eth_phy_config_t* config);
+esp_eth_phy_t* esp_eth_phy_new_lan87xx(const eth_phy_config_t* config);
+esp_eth_phy_t* esp_eth_phy_new_rtl8201(const eth_phy_config_t* config);
+esp_eth_phy_t* esp_eth_phy_new_dp83848(const eth_phy_config_t* config);
+
+esp_err_t esp_eth_driver_install(const esp_eth_config_t* config,
+                                 esp_eth_handle_t* out_hdl);
+esp_err_t esp_eth_driver_uninstall(esp_eth_handle_t hdl);
+esp_err_t esp_eth_start(esp_eth_handle_t hdl);
+esp_err_t esp_eth_stop(esp_eth_handle_t hdl);
+esp_eth_netif_glue_handle_t esp_eth_new_netif_glue(esp_eth_handle_t eth_hdl);
+esp_err_t esp_eth_del_netif_glue(esp_eth_netif_glue_handle_t eth_netif_glue);
+esp_err_t esp_eth_set_default_handlers(void* esp_netif);
+esp_err_t esp_eth_clear_default_handlers(void* esp_netif);
+
+#endif  // TOOLS_MNET32_SIM_INCLUDE_ESP_ETH_H_
@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Host replacement of **ESP-IDF**'s ``esp_netif.h`` for the simulator.
+ *
+ * @file   esp_netif.h
+ */
+
+#ifndef TOOLS_MNET32_SIM_INCLUDE_ESP_NETIF_H_
+#define TOOLS_MNET32_SIM_INCLUDE_ESP_NETIF_H_
+
+#include "esp_err.h"
+#include "esp_event.h"
+
+typedef struct esp_netif_obj esp_netif_t;
+
+typedef struct {
+    uint32_t addr;
+} esp_ip4_addr_t;
+typedef esp_ip4_addr_t ip4_addr_t;
+
+typedef struct {
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+typedef struct {
+    const char* if_key;
+} esp_netif_config_t;
+
+#define ESP_NETIF_DEFAULT_ETH() \
+    { .if_key = "ETH_DEF" }
+
+#define IPSTR "%d.%d.%d.%d"
+#define IP2STR(ipaddr)                     \
+    (int)((ipaddr)->addr & 0xFF),          \
+        (int)(((ipaddr)->addr >> 8) & 0xFF), \
+        (int)(((ipaddr)->addr >> 16) & 0xFF), \
+        (int)(((ipaddr)->addr >> 24) & 0xFF)
+
+ESP_EVENT_DECLARE_BASE(IP_EVENT);
+
+typedef enum {
+    IP_EVENT_STA_GOT_IP,
+    IP_EVENT_STA_LOST_IP,
+    IP_EVENT_AP_STAIPASSIGNED,
+    IP_EVENT_GOT_IP6,
+    IP_EVENT_ETH_GOT_IP,
+    IP_EVENT_ETH_LOST_IP
+} ip_event_t;
+
+esp_err_t esp_netif_init(void);
+esp_err_t esp_netif_deinit(void);
+esp_netif_t* esp_netif_create_default_wifi_ap(void);
+esp_netif_t* esp_netif_create_default_wifi_sta(void);
+esp_netif_t* esp_netif_new(const esp_netif_config_t* esp_netif_config);
+esp_err_t esp_netif_attach(esp_netif_t* esp_netif, void* driver_handle);
+void esp_netif_destroy_default_wifi(void* esp_netif);
+void esp_netif_destroy(esp_netif_t* esp_netif);
+esp_err_t esp_netif_get_ip_info(esp_netif_t* esp_netif,
+                                esp_netif_ip_info_t* ip_info);
+
+#endif  // TOOLS_MNET32_SIM_INCLUDE_ESP_NETIF_H_
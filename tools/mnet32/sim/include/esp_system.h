@@ -0,0 +1,27 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Host replacement of **ESP-IDF**'s ``esp_system.h`` for the simulator.
+ *
+ * @file   esp_system.h
+ */
+
+#ifndef TOOLS_MNET32_SIM_INCLUDE_ESP_SYSTEM_H_
+#define TOOLS_MNET32_SIM_INCLUDE_ESP_SYSTEM_H_
+
+/* C's standard libraries. */
+#include <stdint.h>
+
+/**
+ * Get a pseudo-random number, the same sequence with every run.
+ */
+uint32_t esp_random(void);
+
+/**
+ * Get the free heap, only provided by ``tools/min_httpd/route``.
+ */
+uint32_t esp_get_free_heap_size(void);
+
+#endif  // TOOLS_MNET32_SIM_INCLUDE_ESP_SYSTEM_H_
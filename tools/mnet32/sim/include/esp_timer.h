@@ -0,0 +1,22 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Host replacement of **ESP-IDF**'s ``esp_timer.h`` for the simulator.
+ *
+ * @file   esp_timer.h
+ */
+
+#ifndef TOOLS_MNET32_SIM_INCLUDE_ESP_TIMER_H_
+#define TOOLS_MNET32_SIM_INCLUDE_ESP_TIMER_H_
+
+/* C's standard libraries. */
+#include <stdint.h>
+
+/**
+ * Get the *virtual* time since the start of the simulation in microseconds.
+ */
+int64_t esp_timer_get_time(void);
+
+#endif  // TOOLS_MNET32_SIM_INCLUDE_ESP_TIMER_H_
@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Host replacement of ``FreeRTOS.h`` for the simulator.
+ *
+ * One tick equals one millisecond of *virtual* time. Critical sections are
+ * no-ops, because the simulator executes exactly one context at a time.
+ *
+ * The header is reused by the event benchmark (``tools/mnet32/event``), which
+ * runs actual threads concurrently. It sets ``SIM_CRITICAL_MUTEX``, so
+ * critical sections are mutexes.
+ *
+ * @file   FreeRTOS.h
+ */
+
+#ifndef TOOLS_MNET32_SIM_INCLUDE_FREERTOS_FREERTOS_H_
+#define TOOLS_MNET32_SIM_INCLUDE_FREERTOS_FREERTOS_H_
+
+/* C's standard libraries. */
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(x) ((TickType_t)(x))
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+#ifdef SIM_CRITICAL_MUTEX
+#include <pthread.h>
+
+typedef pthread_mutex_t portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED PTHREAD_MUTEX_INITIALIZER
+#define portENTER_CRITICAL(mux) pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux) pthread_mutex_unlock(mux)
+#else
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) (void)(mux)
+#define portEXIT_CRITICAL(mux) (void)(mux)
+#endif  // SIM_CRITICAL_MUTEX
+
+#endif  // TOOLS_MNET32_SIM_INCLUDE_FREERTOS_FREERTOS_H_
@@ -0,0 +1,32 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Host replacement of FreeRTOS' ``queue.h`` for the simulator.
+ *
+ * Sending never blocks; a task, that receives from an empty queue, blocks
+ * until an item is sent or its timeout expires in *virtual* time.
+ *
+ * @file   queue.h
+ */
+
+#ifndef TOOLS_MNET32_SIM_INCLUDE_FREERTOS_QUEUE_H_
+#define TOOLS_MNET32_SIM_INCLUDE_FREERTOS_QUEUE_H_
+
+#include "freertos/FreeRTOS.h"
+
+#define errQUEUE_FULL 0
+
+typedef struct sim_queue* QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue,
+                      const void* item,
+                      TickType_t ticks_to_wait);
+BaseType_t xQueueReceive(QueueHandle_t queue,
+                         void* buffer,
+                         TickType_t ticks_to_wait);
+
+#endif  // TOOLS_MNET32_SIM_INCLUDE_FREERTOS_QUEUE_H_
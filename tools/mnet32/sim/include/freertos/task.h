@@ -0,0 +1,56 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Host replacement of FreeRTOS' ``task.h`` for the simulator.
+ *
+ * Tasks are executed in threads, but only one of them (or the simulator
+ * itself) is running at any time, so the simulation is deterministic.
+ *
+ * @file   task.h
+ */
+
+#ifndef TOOLS_MNET32_SIM_INCLUDE_FREERTOS_TASK_H_
+#define TOOLS_MNET32_SIM_INCLUDE_FREERTOS_TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct sim_task* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+typedef enum {
+    eNoAction,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite
+} eNotifyAction;
+
+BaseType_t xTaskCreate(TaskFunction_t task_code,
+                       const char* name,
+                       uint32_t stack_depth,
+                       void* parameters,
+                       UBaseType_t priority,
+                       TaskHandle_t* created_task);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_code,
+                                   const char* name,
+                                   uint32_t stack_depth,
+                                   void* parameters,
+                                   UBaseType_t priority,
+                                   TaskHandle_t* created_task,
+                                   BaseType_t core_id);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks_to_delay);
+BaseType_t xTaskNotifyWaitIndexed(UBaseType_t index,
+                                  uint32_t clear_on_entry,
+                                  uint32_t clear_on_exit,
+                                  uint32_t* notification_value,
+                                  TickType_t ticks_to_wait);
+BaseType_t xTaskNotifyIndexed(TaskHandle_t task,
+                              UBaseType_t index,
+                              uint32_t value,
+                              eNotifyAction action);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+#endif  // TOOLS_MNET32_SIM_INCLUDE_FREERTOS_TASK_H_
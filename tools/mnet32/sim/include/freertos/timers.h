@@ -0,0 +1,39 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Host replacement of FreeRTOS' ``timers.h`` for the simulator.
+ *
+ * Timers expire in *virtual* time; their callbacks are executed in the
+ * simulator's context (like FreeRTOS' timer service task).
+ *
+ * @file   timers.h
+ */
+
+#ifndef TOOLS_MNET32_SIM_INCLUDE_FREERTOS_TIMERS_H_
+#define TOOLS_MNET32_SIM_INCLUDE_FREERTOS_TIMERS_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct sim_timer* TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+typedef void (*PendedFunction_t)(void*, uint32_t);
+
+TimerHandle_t xTimerCreate(const char* name,
+                           TickType_t period,
+                           UBaseType_t auto_reload,
+                           void* timer_id,
+                           TimerCallbackFunction_t callback);
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks_to_wait);
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks_to_wait);
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks_to_wait);
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticks_to_wait);
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer);
+void* pvTimerGetTimerID(TimerHandle_t timer);
+BaseType_t xTimerPendFunctionCall(PendedFunction_t function,
+                                  void* parameter1,
+                                  uint32_t parameter2,
+                                  TickType_t ticks_to_wait);
+
+#endif  // TOOLS_MNET32_SIM_INCLUDE_FREERTOS_TIMERS_H_
@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Host replacement of lwIP's ``lwip/dns.h`` for the simulator.
+ *
+ * @file   dns.h
+ */
+
+#ifndef TOOLS_MNET32_SIM_INCLUDE_LWIP_DNS_H_
+#define TOOLS_MNET32_SIM_INCLUDE_LWIP_DNS_H_
+
+#include <stdint.h>
+
+#include "esp_netif.h"
+
+#define DNS_MAX_SERVERS 2
+
+typedef struct {
+    ip4_addr_t ip4;
+} ip_addr_t;
+
+#define IP_IS_V4(ipaddr) 1
+#define ip_2_ip4(ipaddr) (&((ipaddr)->ip4))
+#define ip4_addr_isany(ip4addr) ((ip4addr) == NULL || (ip4addr)->addr == 0)
+
+const ip_addr_t* dns_getserver(uint8_t numdns);
+
+#endif  // TOOLS_MNET32_SIM_INCLUDE_LWIP_DNS_H_
@@ -0,0 +1,33 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Host replacement of **ESP-IDF**'s ``nvs_flash.h`` for the simulator.
+ *
+ * The non-volatile storage is kept in memory and may be modified by the
+ * scenario (see ``sim.c``).
+ *
+ * @file   nvs_flash.h
+ */
+
+#ifndef TOOLS_MNET32_SIM_INCLUDE_NVS_FLASH_H_
+#define TOOLS_MNET32_SIM_INCLUDE_NVS_FLASH_H_
+
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle_t;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+
+esp_err_t nvs_open(const char* name,
+                   nvs_open_mode_t open_mode,
+                   nvs_handle_t* out_handle);
+esp_err_t nvs_get_str(nvs_handle_t handle,
+                      const char* key,
+                      char* out_value,
+                      size_t* length);
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value);
+esp_err_t nvs_commit(nvs_handle_t handle);
+void nvs_close(nvs_handle_t handle);
+
+#endif  // TOOLS_MNET32_SIM_INCLUDE_NVS_FLASH_H_
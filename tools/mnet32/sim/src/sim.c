@@ -0,0 +1,982 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Deterministic fast-forward simulator of the ``mnet32`` component.
+ *
+ * The simulator links the component's actual sources against fake
+ * implementations of FreeRTOS and **ESP-IDF** (see ``sim_freertos.c``,
+ * ``sim_esp.c``, ``sim_eth.c`` and ``sim_wifi.c``) and runs them in *virtual*
+ * time. Hours of flaky WiFi are simulated in (milli-) seconds.
+ *
+ * The simulation is driven by a scenario file, one command per line:
+ *
+ *     <time> network up|down
+ *     <time> eth up|down
+ *     <time> client join|leave
+ *     <time> credentials <ssid> <psk>
+ *     <time> credentials clear
+ *     <time> latency <connect> <fail>
+ *     <time> lock interactive|performance acquire|release
+ *     <time> rssi 0|1 <dBm>|off
+ *     <time> flap <until> <up> <down>
+ *     <time> seed <number>
+ *     <time> random <until> <mean up> <mean down>
+ *     <time> stop
+ *     <time> expect status <name>
+ *     <time> expect medium ethernet|wifi|none
+ *     <time> expect event <name> <count>
+ *     <time> end
+ *
+ * Times are given as a sequence of numbers with the units ``h``, ``m``,
+ * ``s`` and ``ms`` (default), e.g. ``1h30m`` or ``2500``. Lines starting with
+ * ``#`` are ignored.
+ *
+ * The network has two access points; only the first one is in range (at
+ * -50 dBm) by default. ``rssi`` sets the signal strength of an access point
+ * or takes it out of range.
+ *
+ * The Ethernet cable is plugged in by default, but the Ethernet is only used,
+ * if the component is built with ``CONFIG_MNET32_ETH_ENABLED`` (the
+ * ``mnet32_sim_eth`` executable).
+ *
+ * At the end of the simulation, the availability (the time between
+ * ``MNET32_EVENT_READY`` and ``MNET32_EVENT_UNAVAILABLE``), the time spent in
+ * every status of the component's state machine and the number of events are
+ * printed.
+ *
+ * ``expect`` checks the status, the active medium or the number of events
+ * (counted since the start of the simulation) at the given time. If a
+ * scenario has expectations, their results are printed at the end and the
+ * simulator exits with ``1`` if any of them failed, so scenarios may be used
+ * as tests.
+ *
+ * @file   sim.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The simulator's header. */
+#include "sim.h"
+
+/* The component's headers. */
+#include "mnet32/mnet32.h"
+#include "mnet32_fsm.h"
+#include "mnet32_state.h"
+#include "mnet32_wifi.h"
+
+/* The host replacements of ESP-IDF's headers. */
+#include "esp_eth.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The default duration of the simulation (one hour), if the scenario does
+ * not specify its ``end``.
+ */
+#define SIM_DEFAULT_DURATION (60 * 60 * 1000)
+
+/**
+ * The pseudo status, if the component's task is not running.
+ */
+#define SIM_STATUS_STOPPED 5
+
+/**
+ * The number of (pseudo) status.
+ */
+#define SIM_STATUS_COUNT 6
+
+/**
+ * The maximum number of distinct events to be counted.
+ */
+#define SIM_EVENT_COUNTERS 32
+
+/**
+ * The maximum number of expectations of a scenario.
+ */
+#define SIM_EXPECTATIONS 32
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A scheduled action.
+ */
+struct sim_item {
+    uint64_t at;
+    uint64_t seq;
+    sim_tag_t tag;
+    sim_action_t action;
+    void* arg;
+    struct sim_item* next;
+};
+
+/**
+ * A counter of dispatched events.
+ */
+struct sim_event_counter {
+    esp_event_base_t event_base;
+    int32_t event_id;
+    uint32_t count;
+};
+
+
+/**
+ * The subject of an expectation.
+ */
+enum sim_expect_kind {
+    SIM_EXPECT_STATUS,
+    SIM_EXPECT_MEDIUM,
+    SIM_EXPECT_EVENT,
+};
+
+/**
+ * An expectation of the scenario, see ::sim_action_expect .
+ */
+struct sim_expectation {
+    enum sim_expect_kind kind;
+    uint64_t at;
+    char* name;
+    uint32_t count;
+    bool checked;
+    bool ok;
+    char actual[48];
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ */
+static const char* TAG = "sim";
+
+/**
+ * The *virtual* time in milliseconds.
+ */
+static uint64_t sim_clock = 0;
+
+/**
+ * The scheduled actions, ordered by time and sequence.
+ */
+static struct sim_item* sim_agenda = NULL;
+
+/**
+ * The sequence number of the next scheduled action.
+ */
+static uint64_t sim_seq = 0;
+
+/**
+ * The end of the simulation.
+ */
+static uint64_t sim_end = SIM_DEFAULT_DURATION;
+
+/**
+ * The state of the pseudo random number generator (xorshift64).
+ */
+static uint64_t sim_random_state = 0x9E3779B97F4A7C15ULL;
+
+/**
+ * Track, if the component is available (see ::sim_on_mnet32_event ).
+ */
+static bool sim_available = false;
+
+/**
+ * The accumulated time of availability.
+ */
+static uint64_t sim_time_available = 0;
+
+/**
+ * The accumulated time spent in every status.
+ */
+static uint64_t sim_time_in_status[SIM_STATUS_COUNT];
+
+/**
+ * The names of the status, see ``mnet32_status``.
+ */
+static const char* sim_status_names[SIM_STATUS_COUNT] = {
+    "DOWN", "READY", "CONNECTING", "IDLE", "BUSY", "STOPPED"};
+
+/**
+ * The counters of dispatched events.
+ */
+static struct sim_event_counter sim_event_counters[SIM_EVENT_COUNTERS];
+
+/**
+ * The expectations of the scenario.
+ */
+static struct sim_expectation sim_expectations[SIM_EXPECTATIONS];
+
+/**
+ * The number of expectations of the scenario.
+ */
+static int sim_expectation_count = 0;
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static void sim_settle(void);
+static void sim_account(uint64_t until);
+static uint8_t sim_status(void);
+static const char* sim_event_name(esp_event_base_t base, int32_t id);
+static void sim_on_mnet32_event(void* arg,
+                                esp_event_base_t event_base,
+                                int32_t event_id,
+                                void* event_data);
+static uint64_t sim_random(void);
+static bool sim_parse_time(const char* str, uint64_t* result);
+static int sim_load_scenario(const char* filename);
+static void sim_report(void);
+static int sim_report_expectations(void);
+
+static void sim_action_start(void* arg);
+static void sim_action_network_up(void* arg);
+static void sim_action_network_down(void* arg);
+static void sim_action_eth_up(void* arg);
+static void sim_action_eth_down(void* arg);
+static void sim_action_client_join(void* arg);
+static void sim_action_client_leave(void* arg);
+static void sim_action_credentials(void* arg);
+static void sim_action_latency(void* arg);
+static void sim_action_lock(void* arg);
+static void sim_action_stop(void* arg);
+static void sim_action_expect(void* arg);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+uint64_t sim_now(void) {
+    return sim_clock;
+}
+
+void sim_schedule(uint64_t at, sim_tag_t tag, sim_action_t action, void* arg) {
+    struct sim_item* item = calloc(1, sizeof(struct sim_item));
+    if (item == NULL) {
+        fprintf(stderr, "Out of memory!\n");
+        exit(1);
+    }
+
+    item->at = at;
+    item->seq = sim_seq++;
+    item->tag = tag;
+    item->action = action;
+    item->arg = arg;
+
+    struct sim_item** pos = &sim_agenda;
+    while ((*pos != NULL) && ((*pos)->at <= at))
+        pos = &(*pos)->next;
+    item->next = *pos;
+    *pos = item;
+}
+
+void sim_cancel(sim_tag_t tag) {
+    struct sim_item** pos = &sim_agenda;
+
+    while (*pos != NULL) {
+        struct sim_item* item = *pos;
+        if (item->tag == tag) {
+            *pos = item->next;
+            free(item);
+        } else {
+            pos = &item->next;
+        }
+    }
+}
+
+void sim_count_event(esp_event_base_t event_base, int32_t event_id) {
+    for (int i = 0; i < SIM_EVENT_COUNTERS; i++) {
+        struct sim_event_counter* counter = &sim_event_counters[i];
+
+        if (counter->event_base == NULL) {
+            counter->event_base = event_base;
+            counter->event_id = event_id;
+        }
+        if ((counter->event_base == event_base) &&
+            (counter->event_id == event_id)) {
+            counter->count++;
+            return;
+        }
+    }
+}
+
+/**
+ * Run everything that is due at the current *virtual* time.
+ *
+ * This dispatches all events, fires all expired timers and runs all tasks,
+ * that are ready, until nothing is left to be done.
+ */
+static void sim_settle(void) {
+    for (;;) {
+        if (sim_events_dispatch())
+            continue;
+        if (sim_timers_fire())
+            continue;
+        if (sim_tasks_run_ready())
+            continue;
+        break;
+    }
+}
+
+/**
+ * Get the current status of the component.
+ *
+ * @return uint8_t The ``mnet32_status`` or ::SIM_STATUS_STOPPED .
+ */
+static uint8_t sim_status(void) {
+    if (!sim_tasks_alive() || !mnet32_state_is_initialized())
+        return SIM_STATUS_STOPPED;
+
+    uint8_t status = mnet32_state_get_status();
+    if (status >= SIM_STATUS_STOPPED)
+        return SIM_STATUS_STOPPED;
+
+    return status;
+}
+
+/**
+ * Advance the *virtual* time and account the elapsed time.
+ *
+ * @param until The new *virtual* time.
+ */
+static void sim_account(uint64_t until) {
+    uint64_t elapsed = until - sim_clock;
+
+    sim_time_in_status[sim_status()] += elapsed;
+    if (sim_available)
+        sim_time_available += elapsed;
+
+    sim_clock = until;
+}
+
+/**
+ * Get a human-readable name of an event.
+ *
+ * @param base The event's base.
+ * @param id   The event's id.
+ * @return const char* The name (statically allocated).
+ */
+static const char* sim_event_name(esp_event_base_t base, int32_t id) {
+    static char unknown[64];
+
+    if (base == MNET32_EVENTS) {
+        switch (id) {
+        case MNET32_EVENT_UNAVAILABLE:
+            return "MNET32_EVENT_UNAVAILABLE";
+        case MNET32_EVENT_READY:
+            return "MNET32_EVENT_READY";
+        }
+    }
+    if (base == WIFI_EVENT) {
+        switch (id) {
+        case WIFI_EVENT_STA_START:
+            return "WIFI_EVENT_STA_START";
+        case WIFI_EVENT_STA_STOP:
+            return "WIFI_EVENT_STA_STOP";
+        case WIFI_EVENT_STA_CONNECTED:
+            return "WIFI_EVENT_STA_CONNECTED";
+        case WIFI_EVENT_STA_DISCONNECTED:
+            return "WIFI_EVENT_STA_DISCONNECTED";
+        case WIFI_EVENT_AP_START:
+            return "WIFI_EVENT_AP_START";
+        case WIFI_EVENT_AP_STOP:
+            return "WIFI_EVENT_AP_STOP";
+        case WIFI_EVENT_AP_STACONNECTED:
+            return "WIFI_EVENT_AP_STACONNECTED";
+        case WIFI_EVENT_AP_STADISCONNECTED:
+            return "WIFI_EVENT_AP_STADISCONNECTED";
+        case WIFI_EVENT_SCAN_DONE:
+            return "WIFI_EVENT_SCAN_DONE";
+        case WIFI_EVENT_STA_BSS_RSSI_LOW:
+            return "WIFI_EVENT_STA_BSS_RSSI_LOW";
+        }
+    }
+    if (base == ETH_EVENT) {
+        switch (id) {
+        case ETHERNET_EVENT_START:
+            return "ETHERNET_EVENT_START";
+        case ETHERNET_EVENT_STOP:
+            return "ETHERNET_EVENT_STOP";
+        case ETHERNET_EVENT_CONNECTED:
+            return "ETHERNET_EVENT_CONNECTED";
+        case ETHERNET_EVENT_DISCONNECTED:
+            return "ETHERNET_EVENT_DISCONNECTED";
+        }
+    }
+    if (base == IP_EVENT) {
+        switch (id) {
+        case IP_EVENT_STA_GOT_IP:
+            return "IP_EVENT_STA_GOT_IP";
+        case IP_EVENT_AP_STAIPASSIGNED:
+            return "IP_EVENT_AP_STAIPASSIGNED";
+        case IP_EVENT_ETH_GOT_IP:
+            return "IP_EVENT_ETH_GOT_IP";
+        }
+    }
+
+    snprintf(unknown, sizeof(unknown), "%s:%d", base, id);
+    return unknown;
+}
+
+/**
+ * Track the availability of the component.
+ *
+ * @param arg        Not used.
+ * @param event_base Always ``MNET32_EVENTS``.
+ * @param event_id   The actual event.
+ * @param event_data Not used.
+ */
+static void sim_on_mnet32_event(void* arg,
+                                esp_event_base_t event_base,
+                                int32_t event_id,
+                                void* event_data) {
+    if (event_id == MNET32_EVENT_READY)
+        sim_available = true;
+    if (event_id == MNET32_EVENT_UNAVAILABLE)
+        sim_available = false;
+}
+
+/**
+ * Get the next pseudo random number.
+ *
+ * The generator is seeded by the scenario, so the simulation is
+ * reproducible.
+ *
+ * @return uint64_t The pseudo random number.
+ */
+static uint64_t sim_random(void) {
+    sim_random_state ^= sim_random_state << 13;
+    sim_random_state ^= sim_random_state >> 7;
+    sim_random_state ^= sim_random_state << 17;
+    return sim_random_state;
+}
+
+/**
+ * Parse a time specification, e.g. ``1h30m`` or ``2500``.
+ *
+ * @param str    The time specification.
+ * @param result The parsed time in milliseconds.
+ * @return bool  ``true`` on success.
+ */
+static bool sim_parse_time(const char* str, uint64_t* result) {
+    uint64_t total = 0;
+
+    if (*str == '\0')
+        return false;
+
+    while (*str != '\0') {
+        char* end;
+        uint64_t value = strtoull(str, &end, 10);
+        if (end == str)
+            return false;
+
+        if (strncmp(end, "ms", 2) == 0) {
+            end += 2;
+        } else if (*end == 'h') {
+            value *= 60 * 60 * 1000;
+            end++;
+        } else if (*end == 'm') {
+            value *= 60 * 1000;
+            end++;
+        } else if (*end == 's') {
+            value *= 1000;
+            end++;
+        }
+
+        total += value;
+        str = end;
+    }
+
+    *result = total;
+    return true;
+}
+
+static void sim_action_start(void* arg) {
+    ESP_LOGI(TAG, "Starting the component");
+    if (mnet32_start() != ESP_OK)
+        ESP_LOGE(TAG, "mnet32_start() failed!");
+}
+
+static void sim_action_network_up(void* arg) {
+    sim_wifi_set_network(true);
+}
+
+static void sim_action_network_down(void* arg) {
+    sim_wifi_set_network(false);
+}
+
+static void sim_action_eth_up(void* arg) {
+    sim_eth_set_link(true);
+}
+
+static void sim_action_eth_down(void* arg) {
+    sim_eth_set_link(false);
+}
+
+static void sim_action_client_join(void* arg) {
+    sim_wifi_client_join();
+}
+
+static void sim_action_client_leave(void* arg) {
+    sim_wifi_client_leave();
+}
+
+static void sim_action_credentials(void* arg) {
+    char** credentials = arg;
+
+    if (credentials == NULL) {
+        sim_nvs_erase(MNET32_WIFI_NVS_SSID);
+        sim_nvs_erase(MNET32_WIFI_NVS_PSK);
+        return;
+    }
+
+    sim_nvs_set(MNET32_WIFI_NVS_SSID, credentials[0]);
+    sim_nvs_set(MNET32_WIFI_NVS_PSK, credentials[1]);
+}
+
+static void sim_action_latency(void* arg) {
+    uint64_t* latency = arg;
+
+    sim_wifi_set_latency((uint32_t)latency[0], (uint32_t)latency[1]);
+}
+
+static void sim_action_lock(void* arg) {
+    uintptr_t lock = (uintptr_t)arg;
+    enum mnet32_ps_lock ps_lock = (lock & 1) ? MNET32_PS_LOCK_PERFORMANCE
+                                             : MNET32_PS_LOCK_INTERACTIVE;
+
+    if (lock & 2)
+        mnet32_ps_lock_release(ps_lock);
+    else
+        mnet32_ps_lock_acquire(ps_lock);
+}
+
+static void sim_action_rssi(void* arg) {
+    uintptr_t rssi = (uintptr_t)arg;
+
+    sim_wifi_set_rssi((int)(rssi >> 8), (int8_t)(rssi & 0xff));
+}
+
+static void sim_action_stop(void* arg) {
+    ESP_LOGI(TAG, "Stopping the component");
+    mnet32_stop();
+}
+
+/**
+ * Check an expectation of the scenario.
+ *
+ * The result is only recorded here, see ::sim_report_expectations .
+ *
+ * @param arg The ``struct sim_expectation``.
+ */
+static void sim_action_expect(void* arg) {
+    struct sim_expectation* expect = arg;
+    const char* actual = "";
+    uint32_t count = 0;
+
+    switch (expect->kind) {
+    case SIM_EXPECT_STATUS:
+        actual = sim_status_names[sim_status()];
+        break;
+    case SIM_EXPECT_MEDIUM:
+        if (!mnet32_state_is_initialized())
+            actual = "none";
+        else if (mnet32_state_is_medium_ethernet())
+            actual = "ethernet";
+        else if (mnet32_state_is_medium_wireless())
+            actual = "wifi";
+        else
+            actual = "none";
+        break;
+    case SIM_EXPECT_EVENT:
+        for (int i = 0; i < SIM_EVENT_COUNTERS; i++) {
+            struct sim_event_counter* counter = &sim_event_counters[i];
+            if (counter->event_base == NULL)
+                break;
+            if (strcmp(sim_event_name(counter->event_base, counter->event_id),
+                       expect->name) == 0)
+                count = counter->count;
+        }
+        break;
+    }
+
+    if (expect->kind == SIM_EXPECT_EVENT) {
+        snprintf(expect->actual, sizeof(expect->actual), "%u", count);
+        expect->ok = (count == expect->count);
+    } else {
+        snprintf(expect->actual, sizeof(expect->actual), "%s", actual);
+        expect->ok = (strcmp(actual, expect->name) == 0);
+    }
+    expect->checked = true;
+}
+
+/**
+ * Read the scenario and schedule its commands.
+ *
+ * @param filename The scenario file.
+ * @return int     ``0`` on success, ``1`` on error.
+ */
+static int sim_load_scenario(const char* filename) {
+    FILE* f_in = fopen(filename, "r");
+    if (f_in == NULL) {
+        fprintf(stderr, "Could not open scenario '%s'!\n", filename);
+        return 1;
+    }
+
+    char line[256];
+    int line_no = 0;
+    bool has_end = false;
+
+    while (fgets(line, sizeof(line), f_in) != NULL) {
+        line_no++;
+
+        char* argv[8];
+        int argc = 0;
+        for (char* tok = strtok(line, " \t\r\n");
+             (tok != NULL) && (argc < 8);
+             tok = strtok(NULL, " \t\r\n")) {
+            if (*tok == '#')
+                break;
+            argv[argc++] = tok;
+        }
+        if (argc == 0)
+            continue;
+
+        uint64_t at;
+        uint64_t t[3];
+        bool valid = (argc >= 2) && sim_parse_time(argv[0], &at);
+        const char* cmd = valid ? argv[1] : "";
+
+        if ((strcmp(cmd, "network") == 0) && (argc == 3) &&
+            (strcmp(argv[2], "up") == 0)) {
+            sim_schedule(at, SIM_TAG_SCENARIO, sim_action_network_up, NULL);
+        } else if ((strcmp(cmd, "network") == 0) && (argc == 3) &&
+                   (strcmp(argv[2], "down") == 0)) {
+            sim_schedule(at, SIM_TAG_SCENARIO, sim_action_network_down, NULL);
+        } else if ((strcmp(cmd, "eth") == 0) && (argc == 3) &&
+                   (strcmp(argv[2], "up") == 0)) {
+            sim_schedule(at, SIM_TAG_SCENARIO, sim_action_eth_up, NULL);
+        } else if ((strcmp(cmd, "eth") == 0) && (argc == 3) &&
+                   (strcmp(argv[2], "down") == 0)) {
+            sim_schedule(at, SIM_TAG_SCENARIO, sim_action_eth_down, NULL);
+        } else if ((strcmp(cmd, "client") == 0) && (argc == 3) &&
+                   (strcmp(argv[2], "join") == 0)) {
+            sim_schedule(at, SIM_TAG_SCENARIO, sim_action_client_join, NULL);
+        } else if ((strcmp(cmd, "client") == 0) && (argc == 3) &&
+                   (strcmp(argv[2], "leave") == 0)) {
+            sim_schedule(at, SIM_TAG_SCENARIO, sim_action_client_leave, NULL);
+        } else if ((strcmp(cmd, "credentials") == 0) && (argc == 3) &&
+                   (strcmp(argv[2], "clear") == 0)) {
+            sim_schedule(at, SIM_TAG_SCENARIO, sim_action_credentials, NULL);
+        } else if ((strcmp(cmd, "credentials") == 0) && (argc == 4)) {
+            char** credentials = calloc(2, sizeof(char*));
+            credentials[0] = strdup(argv[2]);
+            credentials[1] = strdup(argv[3]);
+            sim_schedule(at,
+                         SIM_TAG_SCENARIO,
+                         sim_action_credentials,
+                         credentials);
+        } else if ((strcmp(cmd, "latency") == 0) && (argc == 4) &&
+                   sim_parse_time(argv[2], &t[0]) &&
+                   sim_parse_time(argv[3], &t[1])) {
+            uint64_t* latency = calloc(2, sizeof(uint64_t));
+            latency[0] = t[0];
+            latency[1] = t[1];
+            sim_schedule(at, SIM_TAG_SCENARIO, sim_action_latency, latency);
+        } else if ((strcmp(cmd, "lock") == 0) && (argc == 4) &&
+                   ((strcmp(argv[2], "interactive") == 0) ||
+                    (strcmp(argv[2], "performance") == 0)) &&
+                   ((strcmp(argv[3], "acquire") == 0) ||
+                    (strcmp(argv[3], "release") == 0))) {
+            /* Bit 0 selects the lock, bit 1 releases it. */
+            uintptr_t lock = ((strcmp(argv[2], "performance") == 0) ? 1 : 0) |
+                             ((strcmp(argv[3], "release") == 0) ? 2 : 0);
+            sim_schedule(at, SIM_TAG_SCENARIO, sim_action_lock, (void*)lock);
+        } else if ((strcmp(cmd, "rssi") == 0) && (argc == 4) &&
+                   ((strcmp(argv[2], "0") == 0) ||
+                    (strcmp(argv[2], "1") == 0))) {
+            /* The access point in the upper bits, the RSSI in the lowest
+             * byte; ``off`` is mapped to ``INT8_MIN``.
+             */
+            int dbm = (strcmp(argv[3], "off") == 0) ? INT8_MIN
+                                                    : atoi(argv[3]);
+            if ((dbm < INT8_MIN) || (dbm > 0)) {
+                fprintf(stderr, "%s:%d: Invalid RSSI!\n", filename, line_no);
+                fclose(f_in);
+                return 1;
+            }
+            uintptr_t rssi = ((uintptr_t)atoi(argv[2]) << 8) | (uint8_t)dbm;
+            sim_schedule(at, SIM_TAG_SCENARIO, sim_action_rssi, (void*)rssi);
+        } else if ((strcmp(cmd, "flap") == 0) && (argc == 5) &&
+                   sim_parse_time(argv[2], &t[0]) &&
+                   sim_parse_time(argv[3], &t[1]) &&
+                   sim_parse_time(argv[4], &t[2]) && (t[1] + t[2] > 0)) {
+            /* The network is up for ``t[1]``, then down for ``t[2]``. */
+            for (uint64_t i = at; i < t[0]; i += t[1] + t[2]) {
+                sim_schedule(i + t[1],
+                             SIM_TAG_SCENARIO,
+                             sim_action_network_down,
+                             NULL);
+                sim_schedule(i + t[1] + t[2],
+                             SIM_TAG_SCENARIO,
+                             sim_action_network_up,
+                             NULL);
+            }
+        } else if ((strcmp(cmd, "seed") == 0) && (argc == 3)) {
+            sim_random_state = strtoull(argv[2], NULL, 10) | 1;
+        } else if ((strcmp(cmd, "random") == 0) && (argc == 5) &&
+                   sim_parse_time(argv[2], &t[0]) &&
+                   sim_parse_time(argv[3], &t[1]) &&
+                   sim_parse_time(argv[4], &t[2]) && (t[1] > 0) &&
+                   (t[2] > 0)) {
+            /* Up- and downtimes are uniformly distributed between ``0`` and
+             * twice their mean.
+             */
+            uint64_t i = at;
+            while (i < t[0]) {
+                i += 1 + (sim_random() % (2 * t[1]));
+                sim_schedule(i,
+                             SIM_TAG_SCENARIO,
+                             sim_action_network_down,
+                             NULL);
+                i += 1 + (sim_random() % (2 * t[2]));
+                sim_schedule(i, SIM_TAG_SCENARIO, sim_action_network_up, NULL);
+            }
+        } else if ((strcmp(cmd, "expect") == 0) &&
+                   (sim_expectation_count < SIM_EXPECTATIONS) &&
+                   (((argc == 4) && ((strcmp(argv[2], "status") == 0) ||
+                                     (strcmp(argv[2], "medium") == 0))) ||
+                    ((argc == 5) && (strcmp(argv[2], "event") == 0)))) {
+            struct sim_expectation* expect =
+                &sim_expectations[sim_expectation_count++];
+            expect->at = at;
+            expect->name = strdup(argv[3]);
+            if (strcmp(argv[2], "status") == 0) {
+                expect->kind = SIM_EXPECT_STATUS;
+            } else if (strcmp(argv[2], "medium") == 0) {
+                expect->kind = SIM_EXPECT_MEDIUM;
+            } else {
+                expect->kind = SIM_EXPECT_EVENT;
+                expect->count = (uint32_t)strtoul(argv[4], NULL, 10);
+            }
+            sim_schedule(at, SIM_TAG_SCENARIO, sim_action_expect, expect);
+        } else if ((strcmp(cmd, "stop") == 0) && (argc == 2)) {
+            sim_schedule(at, SIM_TAG_SCENARIO, sim_action_stop, NULL);
+        } else if ((strcmp(cmd, "end") == 0) && (argc == 2)) {
+            sim_end = at;
+            has_end = true;
+        } else {
+            fprintf(stderr, "%s:%d: Invalid command!\n", filename, line_no);
+            fclose(f_in);
+            return 1;
+        }
+    }
+
+    fclose(f_in);
+
+    if (!has_end)
+        fprintf(stderr, "No 'end' in scenario, simulating one hour.\n");
+
+    return 0;
+}
+
+/**
+ * Print the results of the simulation.
+ */
+static void sim_report(void) {
+    printf("\n");
+    printf("Simulated........... %llu ms\n",
+           (unsigned long long)sim_clock);  // NOLINT(runtime/int)
+    printf("Availability........ %.2f %%\n",
+           (sim_clock > 0) ? (100.0 * sim_time_available / sim_clock) : 0.0);
+
+    printf("\nTime in status:\n");
+    for (int i = 0; i < SIM_STATUS_COUNT; i++) {
+        if (sim_time_in_status[i] == 0)
+            continue;
+        printf("  %-12s %12llu ms  %6.2f %%\n",
+               sim_status_names[i],
+               (unsigned long long)sim_time_in_status[i],  // NOLINT
+               100.0 * sim_time_in_status[i] / sim_clock);
+    }
+
+    printf("\nEvents:\n");
+    for (int i = 0; i < SIM_EVENT_COUNTERS; i++) {
+        struct sim_event_counter* counter = &sim_event_counters[i];
+        if (counter->event_base == NULL)
+            break;
+        printf("  %-32s %8u\n",
+               sim_event_name(counter->event_base, counter->event_id),
+               counter->count);
+    }
+
+    printf("\nInvalid transitions. %u\n", mnet32_fsm_get_invalid_transitions());
+    printf("Power save changes.. %u\n", sim_wifi_get_ps_changes());
+
+    struct mnet32_status_snapshot snapshot;
+    mnet32_get_status_snapshot(&snapshot);
+    printf("Roam scans.......... %u\n", snapshot.roam_scans);
+    printf("Roams............... %u\n", snapshot.roams);
+}
+
+/**
+ * Print the results of the scenario's expectations.
+ *
+ * Expectations after the end of the simulation are never checked and count
+ * as failures.
+ *
+ * @return int The number of failed expectations.
+ */
+static int sim_report_expectations(void) {
+    int failures = 0;
+
+    if (sim_expectation_count == 0)
+        return 0;
+
+    printf("\nExpectations:\n");
+    for (int i = 0; i < sim_expectation_count; i++) {
+        struct sim_expectation* expect = &sim_expectations[i];
+        static const char* kinds[] = {"status", "medium", "event"};
+        char count[16] = "";
+
+        if (expect->kind == SIM_EXPECT_EVENT)
+            snprintf(count, sizeof(count), " %u", expect->count);
+
+        if (!expect->checked || !expect->ok)
+            failures++;
+        printf("%-4s %s %s%s at %llu ms (got %s)\n",
+               (expect->checked && expect->ok) ? "ok" : "FAIL",
+               kinds[expect->kind],
+               expect->name,
+               count,
+               (unsigned long long)expect->at,  // NOLINT(runtime/int)
+               expect->checked ? expect->actual : "nothing");
+    }
+    printf("%s\n", (failures == 0) ? "OK" : "FAIL");
+
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    const char* scenario = NULL;
+    const char* trace_file = NULL;
+    esp_log_level_t log_level = ESP_LOG_WARN;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            if (log_level < ESP_LOG_VERBOSE)
+                log_level++;
+        } else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc)) {
+            trace_file = argv[++i];
+        } else if (scenario == NULL) {
+            scenario = argv[i];
+        } else {
+            scenario = NULL;
+            break;
+        }
+    }
+
+    if (scenario == NULL) {
+        fprintf(stderr, "Usage: %s [-v...] [-t TRACE] SCENARIO\n", argv[0]);
+        return 1;
+    }
+
+    sim_log_set_level(log_level);
+
+    /* The device is provisioned by default. */
+    sim_nvs_set(MNET32_WIFI_NVS_SSID, "sim_network");
+    sim_nvs_set(MNET32_WIFI_NVS_PSK, "sim_password");
+
+    if (sim_load_scenario(scenario) != 0)
+        return 1;
+
+    mnet32_event_handler_register(ESP_EVENT_ANY_ID,
+                                  sim_on_mnet32_event,
+                                  NULL,
+                                  NULL);
+
+    /* Scheduled last, so the scenario's commands at ``0`` are applied
+     * before the component is started.
+     */
+    sim_schedule(0, SIM_TAG_SCENARIO, sim_action_start, NULL);
+
+    for (;;) {
+        sim_settle();
+
+        uint64_t next = sim_end;
+        uint64_t at;
+        if ((sim_agenda != NULL) && (sim_agenda->at < next))
+            next = sim_agenda->at;
+        if (sim_timers_next_expiry(&at) && (at < next))
+            next = at;
+        if (sim_tasks_next_deadline(&at) && (at < next))
+            next = at;
+        if (next < sim_clock)
+            next = sim_clock;
+
+        sim_account(next);
+        if (sim_clock >= sim_end)
+            break;
+
+        /* The events of all items, that are due, are handled before the
+         * tasks run, just like the event loop's task preempts the
+         * component's task, so the task may face a burst of notifications.
+         * Expectations are checked, once everything before them is settled.
+         */
+        while ((sim_agenda != NULL) && (sim_agenda->at <= sim_clock)) {
+            struct sim_item* item = sim_agenda;
+            sim_agenda = item->next;
+            if (item->action == sim_action_expect)
+                sim_settle();
+            item->action(item->arg);
+            free(item);
+            while (sim_events_dispatch())
+                continue;
+        }
+    }
+
+    /* Expectations at the very end of the simulation are checked after the
+     * last step.
+     */
+    while ((sim_agenda != NULL) && (sim_agenda->at <= sim_end)) {
+        struct sim_item* item = sim_agenda;
+        sim_agenda = item->next;
+        if (item->action == sim_action_expect)
+            item->action(item->arg);
+        free(item);
+    }
+
+    sim_report();
+    int failures = sim_report_expectations();
+
+    if (trace_file != NULL) {
+        static uint8_t buf[sizeof(struct mnet32_fsm_trace_header) +
+                           (MNET32_FSM_TRACE_LEN *
+                            sizeof(struct mnet32_fsm_trace_record))];
+        size_t len = mnet32_fsm_trace_dump(buf, sizeof(buf));
+
+        FILE* f_out = fopen(trace_file, "wb");
+        if ((f_out == NULL) || (fwrite(buf, 1, len, f_out) != len)) {
+            fprintf(stderr, "Could not write trace '%s'!\n", trace_file);
+            return 1;
+        }
+        fclose(f_out);
+    }
+
+    /* The component's task is still blocked in its thread. */
+    exit((failures == 0) ? 0 : 1);
+}
@@ -0,0 +1,84 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+#ifndef TOOLS_MNET32_SIM_SRC_SIM_H_
+#define TOOLS_MNET32_SIM_SRC_SIM_H_
+
+/* C's standard libraries. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The host replacements of ESP-IDF's headers. */
+#include "esp_event.h"
+#include "esp_log.h"
+
+
+/**
+ * Callback of a scheduled action, see ::sim_schedule .
+ */
+typedef void (*sim_action_t)(void* arg);
+
+/**
+ * Tags of scheduled actions, used to cancel them, see ::sim_cancel .
+ */
+typedef enum {
+    SIM_TAG_SCENARIO,
+    SIM_TAG_WIFI,
+    SIM_TAG_ETH,
+    SIM_TAG_TIMER_SERVICE,
+} sim_tag_t;
+
+/**
+ * Get the *virtual* time since the start of the simulation in milliseconds.
+ */
+uint64_t sim_now(void);
+
+/**
+ * Schedule an action at the given *virtual* time.
+ *
+ * Actions with the same time are executed in the order they were scheduled.
+ */
+void sim_schedule(uint64_t at, sim_tag_t tag, sim_action_t action, void* arg);
+
+/**
+ * Cancel all pending actions with the given tag.
+ */
+void sim_cancel(sim_tag_t tag);
+
+/**
+ * Count an event, that is dispatched by the fake event loop.
+ */
+void sim_count_event(esp_event_base_t event_base, int32_t event_id);
+
+/**
+ * Set the maximum level of log messages to be printed.
+ */
+void sim_log_set_level(esp_log_level_t level);
+
+/* Provided by the fake event loop (``sim_esp.c``). */
+bool sim_events_dispatch(void);
+
+/* Provided by the fake non-volatile storage (``sim_esp.c``). */
+void sim_nvs_set(const char* key, const char* value);
+void sim_nvs_erase(const char* key);
+
+/* Provided by the fake Ethernet (``sim_eth.c``). */
+void sim_eth_set_link(bool up);
+
+/* Provided by the fake FreeRTOS (``sim_freertos.c``). */
+bool sim_tasks_alive(void);
+bool sim_tasks_run_ready(void);
+bool sim_tasks_next_deadline(uint64_t* at);
+bool sim_timers_fire(void);
+bool sim_timers_next_expiry(uint64_t* at);
+
+/* Provided by the fake WiFi (``sim_wifi.c``). */
+void sim_wifi_set_network(bool available);
+void sim_wifi_set_latency(uint32_t connect_ms, uint32_t fail_ms);
+void sim_wifi_set_rssi(int ap, int8_t rssi);
+void sim_wifi_client_join(void);
+void sim_wifi_client_leave(void);
+uint32_t sim_wifi_get_ps_changes(void);
+
+#endif  // TOOLS_MNET32_SIM_SRC_SIM_H_
@@ -0,0 +1,482 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Fake **ESP-IDF** libraries for the simulator.
+ *
+ * This provides error names, logging, the event loop, the network interfaces,
+ * the high resolution timer, random numbers, the non-volatile storage and
+ * lwIP's DNS servers (there are none). The WiFi driver is provided by ``sim_wifi.c``, the
+ * Ethernet driver by ``sim_eth.c``.
+ *
+ * @file   sim_esp.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The simulator's header. */
+#include "sim.h"
+
+/* The host replacements of ESP-IDF's headers. */
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "lwip/dns.h"
+#include "nvs_flash.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The maximum number of entries in the fake non-volatile storage.
+ */
+#define SIM_NVS_MAX_ENTRIES 8
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A registered event handler.
+ */
+struct sim_event_handler {
+    esp_event_base_t event_base;
+    int32_t event_id;
+    esp_event_handler_t handler;
+    void* handler_arg;
+    bool removed;
+    struct sim_event_handler* next;
+};
+
+/**
+ * A posted, but not yet dispatched event.
+ */
+struct sim_event {
+    esp_event_base_t event_base;
+    int32_t event_id;
+    void* event_data;
+    struct sim_event* next;
+};
+
+/**
+ * An entry of the fake non-volatile storage.
+ */
+struct sim_nvs_entry {
+    char key[16];
+    char value[128];
+    bool used;
+};
+
+/**
+ * A fake network interface.
+ */
+struct esp_netif_obj {
+    const char* name;
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/* The event bases of ESP-IDF's components. */
+ESP_EVENT_DEFINE_BASE(IP_EVENT);
+ESP_EVENT_DEFINE_BASE(WIFI_EVENT);
+
+/**
+ * The maximum level of log messages to be printed.
+ */
+static esp_log_level_t sim_log_level = ESP_LOG_WARN;
+
+/**
+ * The registered event handlers, in order of registration.
+ */
+static struct sim_event_handler* sim_event_handlers = NULL;
+
+/**
+ * The queue of posted events.
+ */
+static struct sim_event* sim_event_queue = NULL;
+
+/**
+ * The dummy handle of a dedicated event loop.
+ *
+ * All events are dispatched from one single queue, regardless of the event
+ * loop they were posted to.
+ */
+static int sim_event_loop_dummy;
+
+/**
+ * The state of ``esp_random()``, so the simulation is deterministic.
+ */
+static uint32_t sim_random_state = 0x6d6e6574;
+
+/**
+ * The fake non-volatile storage.
+ */
+static struct sim_nvs_entry sim_nvs[SIM_NVS_MAX_ENTRIES];
+
+/**
+ * The fake network interfaces.
+ */
+static struct esp_netif_obj sim_netif_ap = {"ap"};
+static struct esp_netif_obj sim_netif_sta = {"sta"};
+static struct esp_netif_obj sim_netif_eth = {"eth"};
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static struct sim_nvs_entry* sim_nvs_find(const char* key);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_NVS_NOT_FOUND:
+        return "ESP_ERR_NVS_NOT_FOUND";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+void sim_log_set_level(esp_log_level_t level) {
+    sim_log_level = level;
+}
+
+void esp_log_level_set(const char* tag, esp_log_level_t level) {
+    /* The simulator uses one global level, see ::sim_log_set_level . */
+}
+
+void esp_log_write(esp_log_level_t level,
+                   const char* tag,
+                   const char* format,
+                   ...) {
+    static const char letters[] = "NEWIDV";
+
+    if (level > sim_log_level)
+        return;
+
+    printf("%c (%llu) %s: ",
+           letters[level],
+           (unsigned long long)sim_now(),  // NOLINT(runtime/int)
+           tag);
+
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+
+    printf("\n");
+}
+
+int64_t esp_timer_get_time(void) {
+    return (int64_t)sim_now() * 1000;
+}
+
+uint32_t esp_random(void) {
+    /* xorshift32 */
+    sim_random_state ^= sim_random_state << 13;
+    sim_random_state ^= sim_random_state >> 17;
+    sim_random_state ^= sim_random_state << 5;
+    return sim_random_state;
+}
+
+esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args,
+                                esp_event_loop_handle_t* event_loop) {
+    *event_loop = &sim_event_loop_dummy;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop,
+                            esp_event_base_t event_base,
+                            int32_t event_id,
+                            const void* event_data,
+                            size_t event_data_size,
+                            TickType_t ticks_to_wait) {
+    struct sim_event* event = calloc(1, sizeof(struct sim_event));
+    if (event == NULL)
+        return ESP_ERR_NO_MEM;
+
+    event->event_base = event_base;
+    event->event_id = event_id;
+    if ((event_data != NULL) && (event_data_size > 0)) {
+        event->event_data = malloc(event_data_size);
+        if (event->event_data == NULL) {
+            free(event);
+            return ESP_ERR_NO_MEM;
+        }
+        memcpy(event->event_data, event_data, event_data_size);
+    }
+
+    struct sim_event** tail = &sim_event_queue;
+    while (*tail != NULL)
+        tail = &(*tail)->next;
+    *tail = event;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base,
+                         int32_t event_id,
+                         const void* event_data,
+                         size_t event_data_size,
+                         TickType_t ticks_to_wait) {
+    return esp_event_post_to(NULL,
+                             event_base,
+                             event_id,
+                             event_data,
+                             event_data_size,
+                             ticks_to_wait);
+}
+
+esp_err_t esp_event_handler_instance_register_with(
+    esp_event_loop_handle_t event_loop,
+    esp_event_base_t event_base,
+    int32_t event_id,
+    esp_event_handler_t event_handler,
+    void* event_handler_arg,
+    esp_event_handler_instance_t* instance) {
+    struct sim_event_handler* entry =
+        calloc(1, sizeof(struct sim_event_handler));
+    if (entry == NULL)
+        return ESP_ERR_NO_MEM;
+
+    entry->event_base = event_base;
+    entry->event_id = event_id;
+    entry->handler = event_handler;
+    entry->handler_arg = event_handler_arg;
+
+    struct sim_event_handler** tail = &sim_event_handlers;
+    while (*tail != NULL)
+        tail = &(*tail)->next;
+    *tail = entry;
+
+    if (instance != NULL)
+        *instance = entry;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(
+    esp_event_base_t event_base,
+    int32_t event_id,
+    esp_event_handler_t event_handler,
+    void* event_handler_arg,
+    esp_event_handler_instance_t* instance) {
+    return esp_event_handler_instance_register_with(NULL,
+                                                    event_base,
+                                                    event_id,
+                                                    event_handler,
+                                                    event_handler_arg,
+                                                    instance);
+}
+
+esp_err_t esp_event_handler_instance_unregister_with(
+    esp_event_loop_handle_t event_loop,
+    esp_event_base_t event_base,
+    int32_t event_id,
+    esp_event_handler_instance_t instance) {
+    for (struct sim_event_handler* entry = sim_event_handlers; entry != NULL;
+         entry = entry->next) {
+        if ((entry == instance) && !entry->removed) {
+            /* The entry is not freed, as the handler might be unregistered
+             * while the event is dispatched.
+             */
+            entry->removed = true;
+            return ESP_OK;
+        }
+    }
+
+    return ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_event_handler_instance_unregister(
+    esp_event_base_t event_base,
+    int32_t event_id,
+    esp_event_handler_instance_t instance) {
+    return esp_event_handler_instance_unregister_with(NULL,
+                                                      event_base,
+                                                      event_id,
+                                                      instance);
+}
+
+bool sim_events_dispatch(void) {
+    struct sim_event* event = sim_event_queue;
+    if (event == NULL)
+        return false;
+
+    sim_event_queue = event->next;
+    sim_count_event(event->event_base, event->event_id);
+
+    for (struct sim_event_handler* entry = sim_event_handlers; entry != NULL;
+         entry = entry->next) {
+        if (entry->removed || (entry->event_base != event->event_base))
+            continue;
+        if ((entry->event_id != ESP_EVENT_ANY_ID) &&
+            (entry->event_id != event->event_id))
+            continue;
+
+        entry->handler(entry->handler_arg,
+                       event->event_base,
+                       event->event_id,
+                       event->event_data);
+    }
+
+    free(event->event_data);
+    free(event);
+    return true;
+}
+
+esp_err_t esp_netif_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_deinit(void) {
+    /* Just like ESP-IDF. */
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_netif_t* esp_netif_create_default_wifi_ap(void) {
+    return &sim_netif_ap;
+}
+
+esp_netif_t* esp_netif_create_default_wifi_sta(void) {
+    return &sim_netif_sta;
+}
+
+esp_netif_t* esp_netif_new(const esp_netif_config_t* esp_netif_config) {
+    return &sim_netif_eth;
+}
+
+esp_err_t esp_netif_attach(esp_netif_t* esp_netif, void* driver_handle) {
+    return ESP_OK;
+}
+
+void esp_netif_destroy_default_wifi(void* esp_netif) {}
+
+void esp_netif_destroy(esp_netif_t* esp_netif) {}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t* esp_netif,
+                                esp_netif_ip_info_t* ip_info) {
+    if (esp_netif == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    /* The default address of ESP-IDF's access point. */
+    memset(ip_info, 0, sizeof(*ip_info));
+    if (esp_netif == &sim_netif_ap)
+        ip_info->ip.addr = (uint32_t)(192 | (168 << 8) | (4 << 16) | (1 << 24));
+    return ESP_OK;
+}
+
+const ip_addr_t* dns_getserver(uint8_t numdns) {
+    /* There is no DNS server in the simulation, the resolver is not used. */
+    static const ip_addr_t sim_dns_server_any = {0};
+    return &sim_dns_server_any;
+}
+
+/**
+ * Find an entry of the fake non-volatile storage.
+ *
+ * @param key The entry's key.
+ * @return struct sim_nvs_entry* The entry or ``NULL``.
+ */
+static struct sim_nvs_entry* sim_nvs_find(const char* key) {
+    for (int i = 0; i < SIM_NVS_MAX_ENTRIES; i++) {
+        if (sim_nvs[i].used && (strcmp(sim_nvs[i].key, key) == 0))
+            return &sim_nvs[i];
+    }
+
+    return NULL;
+}
+
+void sim_nvs_set(const char* key, const char* value) {
+    struct sim_nvs_entry* entry = sim_nvs_find(key);
+
+    for (int i = 0; (entry == NULL) && (i < SIM_NVS_MAX_ENTRIES); i++) {
+        if (!sim_nvs[i].used)
+            entry = &sim_nvs[i];
+    }
+    if (entry == NULL)
+        return;
+
+    entry->used = true;
+    snprintf(entry->key, sizeof(entry->key), "%s", key);
+    snprintf(entry->value, sizeof(entry->value), "%s", value);
+}
+
+void sim_nvs_erase(const char* key) {
+    struct sim_nvs_entry* entry = sim_nvs_find(key);
+
+    if (entry != NULL)
+        entry->used = false;
+}
+
+esp_err_t nvs_open(const char* name,
+                   nvs_open_mode_t open_mode,
+                   nvs_handle_t* out_handle) {
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle,
+                      const char* key,
+                      char* out_value,
+                      size_t* length) {
+    struct sim_nvs_entry* entry = sim_nvs_find(key);
+    if (entry == NULL)
+        return ESP_ERR_NVS_NOT_FOUND;
+
+    size_t required = strlen(entry->value) + 1;
+    if (out_value == NULL) {
+        *length = required;
+        return ESP_OK;
+    }
+    if (*length < required)
+        return ESP_ERR_INVALID_SIZE;
+
+    memcpy(out_value, entry->value, required);
+    *length = required;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+    sim_nvs_set(key, value);
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {}
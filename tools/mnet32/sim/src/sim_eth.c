@@ -0,0 +1,265 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Scripted fake of **ESP-IDF**'s Ethernet driver.
+ *
+ * The fake models the Ethernet link (the cable may be plugged in or not),
+ * which is controlled by the scenario (see ``sim.c``). The MAC and the PHY
+ * are dummies.
+ *
+ * Just like the actual driver, the fake reports the link by posting
+ * ``ETH_EVENT`` occurences. ``IP_EVENT_ETH_GOT_IP`` is posted after the
+ * (simulated) DHCP lease, if the link is still up.
+ *
+ * @file   sim_eth.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <stdbool.h>
+
+/* The simulator's header. */
+#include "sim.h"
+
+/* The host replacements of ESP-IDF's headers. */
+#include "esp_err.h"
+#include "esp_eth.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The time it takes to get an address by DHCP (in milliseconds).
+ */
+#define SIM_ETH_DHCP_LATENCY 500
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * The state of the fake driver and of the simulated cable.
+ */
+struct sim_eth {
+    bool installed;
+    bool started;
+    bool link;
+    bool connected;
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/* The event base of ESP-IDF's Ethernet driver. */
+ESP_EVENT_DEFINE_BASE(ETH_EVENT);
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ */
+static const char* TAG = "sim.eth";
+
+/**
+ * The state of the fake driver.
+ *
+ * The cable is plugged in by default.
+ */
+static struct sim_eth sim_eth = {
+    .link = true,
+};
+
+/**
+ * The dummy handle of the driver.
+ */
+static int sim_eth_handle_dummy;
+
+/**
+ * The dummy handle of the glue between the driver and the ``netif``.
+ */
+static int sim_eth_glue_dummy;
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static void sim_eth_post(int32_t event_id);
+static void sim_eth_link_up(void);
+static void sim_eth_got_ip(void* arg);
+static esp_err_t sim_eth_mac_del(esp_eth_mac_t* mac);
+static esp_err_t sim_eth_phy_del(esp_eth_phy_t* phy);
+
+
+/* ***** DUMMIES ***********************************************************
+ * (technically, these are ``variables``, but as the ``del()`` functions must
+ *  be referenced, these must come after the ``prototypes``)
+ */
+
+/**
+ * The dummy MAC.
+ */
+static esp_eth_mac_t sim_eth_mac = {.del = sim_eth_mac_del};
+
+/**
+ * The dummy PHY.
+ */
+static esp_eth_phy_t sim_eth_phy = {.del = sim_eth_phy_del};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Post an ``ETH_EVENT`` occurence.
+ *
+ * @param event_id The event to post.
+ */
+static void sim_eth_post(int32_t event_id) {
+    esp_event_post(ETH_EVENT, event_id, NULL, 0, 0);
+}
+
+/**
+ * The DHCP lease is finished.
+ *
+ * @param arg Not used.
+ */
+static void sim_eth_got_ip(void* arg) {
+    if (!sim_eth.connected)
+        return;
+
+    ESP_LOGI(TAG, "Got address");
+    esp_event_post(IP_EVENT, IP_EVENT_ETH_GOT_IP, NULL, 0, 0);
+}
+
+/**
+ * Report the link and start the DHCP lease.
+ */
+static void sim_eth_link_up(void) {
+    sim_eth.connected = true;
+    sim_eth_post(ETHERNET_EVENT_CONNECTED);
+    sim_schedule(sim_now() + SIM_ETH_DHCP_LATENCY,
+                 SIM_TAG_ETH,
+                 sim_eth_got_ip,
+                 NULL);
+}
+
+void sim_eth_set_link(bool up) {
+    ESP_LOGI(TAG, "Cable %s", up ? "plugged in" : "unplugged");
+    sim_eth.link = up;
+
+    if (!sim_eth.started)
+        return;
+
+    if (up && !sim_eth.connected) {
+        sim_eth_link_up();
+    } else if (!up && sim_eth.connected) {
+        sim_cancel(SIM_TAG_ETH);
+        sim_eth.connected = false;
+        sim_eth_post(ETHERNET_EVENT_DISCONNECTED);
+    }
+}
+
+/**
+ * Delete the dummy MAC.
+ *
+ * @param mac Not used.
+ * @return esp_err_t Always ``ESP_OK``.
+ */
+static esp_err_t sim_eth_mac_del(esp_eth_mac_t* mac) {
+    return ESP_OK;
+}
+
+/**
+ * Delete the dummy PHY.
+ *
+ * @param phy Not used.
+ * @return esp_err_t Always ``ESP_OK``.
+ */
+static esp_err_t sim_eth_phy_del(esp_eth_phy_t* phy) {
+    return ESP_OK;
+}
+
+esp_eth_mac_t* esp_eth_mac_new_esp32(const eth_mac_config_t* config) {
+    return &sim_eth_mac;
+}
+
+esp_eth_phy_t* esp_eth_phy_new_ip101(const eth_phy_config_t* config) {
+    return &sim_eth_phy;
+}
+
+esp_eth_phy_t* esp_eth_phy_new_lan87xx(const eth_phy_config_t* config) {
+    return &sim_eth_phy;
+}
+
+esp_eth_phy_t* esp_eth_phy_new_rtl8201(const eth_phy_config_t* config) {
+    return &sim_eth_phy;
+}
+
+esp_eth_phy_t* esp_eth_phy_new_dp83848(const eth_phy_config_t* config) {
+    return &sim_eth_phy;
+}
+
+esp_err_t esp_eth_driver_install(const esp_eth_config_t* config,
+                                 esp_eth_handle_t* out_hdl) {
+    if (sim_eth.installed)
+        return ESP_ERR_INVALID_STATE;
+
+    sim_eth.installed = true;
+    *out_hdl = &sim_eth_handle_dummy;
+    return ESP_OK;
+}
+
+esp_err_t esp_eth_driver_uninstall(esp_eth_handle_t hdl) {
+    if (sim_eth.started)
+        return ESP_ERR_INVALID_STATE;
+
+    sim_eth.installed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_eth_start(esp_eth_handle_t hdl) {
+    if (!sim_eth.installed || sim_eth.started)
+        return ESP_ERR_INVALID_STATE;
+
+    sim_eth.started = true;
+    sim_eth_post(ETHERNET_EVENT_START);
+    if (sim_eth.link)
+        sim_eth_link_up();
+    return ESP_OK;
+}
+
+esp_err_t esp_eth_stop(esp_eth_handle_t hdl) {
+    if (!sim_eth.started)
+        return ESP_ERR_INVALID_STATE;
+
+    /* Pending leases are dropped, the driver does not report anything after
+     * being stopped.
+     */
+    sim_cancel(SIM_TAG_ETH);
+
+    sim_eth.started = false;
+    sim_eth.connected = false;
+    sim_eth_post(ETHERNET_EVENT_STOP);
+    return ESP_OK;
+}
+
+esp_eth_netif_glue_handle_t esp_eth_new_netif_glue(esp_eth_handle_t eth_hdl) {
+    return &sim_eth_glue_dummy;
+}
+
+esp_err_t esp_eth_del_netif_glue(esp_eth_netif_glue_handle_t eth_netif_glue) {
+    return ESP_OK;
+}
+
+esp_err_t esp_eth_set_default_handlers(void* esp_netif) {
+    return ESP_OK;
+}
+
+esp_err_t esp_eth_clear_default_handlers(void* esp_netif) {
+    return ESP_OK;
+}
@@ -0,0 +1,546 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Fake FreeRTOS tasks, queues and timers, running in *virtual* time.
+ *
+ * Every task is executed in its own thread, but there is always exactly one
+ * context running: either the simulator or one of the tasks. Control is
+ * handed over explicitly (like a baton), so the simulation is deterministic.
+ *
+ * A task runs until it blocks in ``xTaskNotifyWaitIndexed()`` or
+ * ``xQueueReceive()`` or deletes itself. The simulator resumes a blocked task,
+ * if it was notified, if an item was sent to its queue or if its timeout
+ * expired in *virtual* time.
+ *
+ * Timer callbacks are executed in the simulator's context, like they would be
+ * executed by FreeRTOS' timer service task.
+ *
+ * @file   sim_freertos.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The simulator's header. */
+#include "sim.h"
+
+/* The host replacements of ESP-IDF's headers. */
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A fake task.
+ */
+struct sim_task {
+    TaskFunction_t code;
+    void* parameters;
+    const char* name;
+    pthread_t thread;
+    bool started;
+    bool deleted;
+    bool waiting;
+    bool has_deadline;
+    uint64_t deadline;
+    bool notified;
+    uint32_t value;
+    struct sim_queue* receiving;
+    struct sim_task* next;
+};
+
+/**
+ * A fake queue, a ring of ``length`` items.
+ */
+struct sim_queue {
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t* items;
+};
+
+/**
+ * A function call, pended to the (fake) timer service task.
+ */
+struct sim_pended_call {
+    PendedFunction_t function;
+    void* parameter1;
+    uint32_t parameter2;
+};
+
+/**
+ * A fake software timer.
+ */
+struct sim_timer {
+    const char* name;
+    TickType_t period;
+    bool auto_reload;
+    void* timer_id;
+    TimerCallbackFunction_t callback;
+    bool active;
+    bool deleted;
+    uint64_t expiry;
+    struct sim_timer* next;
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * All tasks, in order of creation.
+ */
+static struct sim_task* sim_tasks = NULL;
+
+/**
+ * All timers, in order of creation.
+ */
+static struct sim_timer* sim_timers = NULL;
+
+/**
+ * The task that is currently running or ``NULL``, if the simulator is
+ * running.
+ */
+static struct sim_task* sim_running = NULL;
+
+/**
+ * Protect ::sim_running while handing over control.
+ */
+static pthread_mutex_t sim_baton_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Signal a change of ::sim_running .
+ */
+static pthread_cond_t sim_baton_cond = PTHREAD_COND_INITIALIZER;
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static void sim_task_switch_to(struct sim_task* task);
+static void sim_task_yield(struct sim_task* self);
+static void sim_task_exit(struct sim_task* self);
+static void* sim_task_thread(void* arg);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Hand over control from the simulator to a task and wait until it blocks.
+ *
+ * @param task The task to run.
+ */
+static void sim_task_switch_to(struct sim_task* task) {
+    pthread_mutex_lock(&sim_baton_lock);
+    sim_running = task;
+    pthread_cond_broadcast(&sim_baton_cond);
+    while (sim_running != NULL)
+        pthread_cond_wait(&sim_baton_cond, &sim_baton_lock);
+    pthread_mutex_unlock(&sim_baton_lock);
+}
+
+/**
+ * Hand back control from a task to the simulator and wait until the task is
+ * resumed.
+ *
+ * @param self The calling task.
+ */
+static void sim_task_yield(struct sim_task* self) {
+    pthread_mutex_lock(&sim_baton_lock);
+    sim_running = NULL;
+    pthread_cond_broadcast(&sim_baton_cond);
+    while (sim_running != self)
+        pthread_cond_wait(&sim_baton_cond, &sim_baton_lock);
+    pthread_mutex_unlock(&sim_baton_lock);
+}
+
+/**
+ * Hand back control from a task to the simulator and terminate the task.
+ *
+ * Like FreeRTOS' ``vTaskDelete(NULL)``, this function does not return.
+ *
+ * @param self The calling task.
+ */
+static void sim_task_exit(struct sim_task* self) {
+    pthread_mutex_lock(&sim_baton_lock);
+    self->deleted = true;
+    sim_running = NULL;
+    pthread_cond_broadcast(&sim_baton_cond);
+    pthread_mutex_unlock(&sim_baton_lock);
+    pthread_exit(NULL);
+}
+
+/**
+ * The thread of a fake task.
+ *
+ * @param arg The task.
+ * @return void* Never returns.
+ */
+static void* sim_task_thread(void* arg) {
+    struct sim_task* self = arg;
+
+    pthread_mutex_lock(&sim_baton_lock);
+    while (sim_running != self)
+        pthread_cond_wait(&sim_baton_cond, &sim_baton_lock);
+    pthread_mutex_unlock(&sim_baton_lock);
+
+    self->code(self->parameters);
+
+    /* FreeRTOS tasks must not return, but be nice here. */
+    sim_task_exit(self);
+    return NULL;
+}
+
+bool sim_tasks_alive(void) {
+    for (struct sim_task* task = sim_tasks; task != NULL; task = task->next) {
+        if (!task->deleted)
+            return true;
+    }
+
+    return false;
+}
+
+bool sim_tasks_run_ready(void) {
+    for (struct sim_task* task = sim_tasks; task != NULL; task = task->next) {
+        if (task->deleted)
+            continue;
+
+        bool ready = !task->started;
+        if (task->waiting) {
+            ready = task->notified ||
+                    ((task->receiving != NULL) &&
+                     (task->receiving->count > 0)) ||
+                    (task->has_deadline && (task->deadline <= sim_now()));
+        }
+
+        if (ready) {
+            task->started = true;
+            sim_task_switch_to(task);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool sim_tasks_next_deadline(uint64_t* at) {
+    bool found = false;
+
+    for (struct sim_task* task = sim_tasks; task != NULL; task = task->next) {
+        if (task->deleted || !task->waiting || !task->has_deadline)
+            continue;
+        if (!found || (task->deadline < *at)) {
+            *at = task->deadline;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task_code,
+                       const char* name,
+                       uint32_t stack_depth,
+                       void* parameters,
+                       UBaseType_t priority,
+                       TaskHandle_t* created_task) {
+    struct sim_task* task = calloc(1, sizeof(struct sim_task));
+    if (task == NULL)
+        return pdFAIL;
+
+    task->code = task_code;
+    task->parameters = parameters;
+    task->name = name;
+
+    if (pthread_create(&task->thread, NULL, sim_task_thread, task) != 0) {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+
+    struct sim_task** tail = &sim_tasks;
+    while (*tail != NULL)
+        tail = &(*tail)->next;
+    *tail = task;
+
+    if (created_task != NULL)
+        *created_task = task;
+
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if ((task == NULL) || (task == sim_running)) {
+        sim_task_exit(sim_running);
+        return;  // not reached
+    }
+
+    /* The task is blocked in its thread and will never be resumed. */
+    task->deleted = true;
+}
+
+void vTaskDelay(TickType_t ticks_to_delay) {
+    struct sim_task* self = sim_running;
+    uint64_t deadline = sim_now() + ticks_to_delay;
+
+    /* A notification wakes the task, but must not shorten the delay. */
+    while (sim_now() < deadline) {
+        self->waiting = true;
+        self->has_deadline = true;
+        self->deadline = deadline;
+        sim_task_yield(self);
+        self->waiting = false;
+    }
+}
+
+BaseType_t xTaskNotifyWaitIndexed(UBaseType_t index,
+                                  uint32_t clear_on_entry,
+                                  uint32_t clear_on_exit,
+                                  uint32_t* notification_value,
+                                  TickType_t ticks_to_wait) {
+    struct sim_task* self = sim_running;
+
+    if (!self->notified && (ticks_to_wait > 0)) {
+        self->waiting = true;
+        self->has_deadline = (ticks_to_wait != portMAX_DELAY);
+        self->deadline = sim_now() + ticks_to_wait;
+        sim_task_yield(self);
+        self->waiting = false;
+    }
+
+    if (!self->notified)
+        return pdFAIL;
+
+    if (notification_value != NULL)
+        *notification_value = self->value;
+    self->notified = false;
+
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyIndexed(TaskHandle_t task,
+                              UBaseType_t index,
+                              uint32_t value,
+                              eNotifyAction action) {
+    if ((task == NULL) || task->deleted)
+        return pdFAIL;
+
+    /* The component only uses ``eSetValueWithOverwrite``. */
+    task->value = value;
+    task->notified = true;
+
+    return pdPASS;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    struct sim_queue* queue = calloc(1, sizeof(struct sim_queue));
+    if (queue == NULL)
+        return NULL;
+
+    queue->items = calloc(length, item_size);
+    if (queue->items == NULL) {
+        free(queue);
+        return NULL;
+    }
+    queue->length = length;
+    queue->item_size = item_size;
+
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    free(queue->items);
+    free(queue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue,
+                      const void* item,
+                      TickType_t ticks_to_wait) {
+    /* Only one context runs at a time, so a full queue stays full. */
+    if (queue->count == queue->length)
+        return errQUEUE_FULL;
+
+    UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(queue->items + (tail * queue->item_size), item, queue->item_size);
+    queue->count++;
+
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue,
+                         void* buffer,
+                         TickType_t ticks_to_wait) {
+    struct sim_task* self = sim_running;
+
+    if ((queue->count == 0) && (ticks_to_wait > 0)) {
+        self->waiting = true;
+        self->receiving = queue;
+        self->has_deadline = (ticks_to_wait != portMAX_DELAY);
+        self->deadline = sim_now() + ticks_to_wait;
+        sim_task_yield(self);
+        self->receiving = NULL;
+        self->waiting = false;
+    }
+
+    if (queue->count == 0)
+        return pdFAIL;
+
+    memcpy(buffer,
+           queue->items + (queue->head * queue->item_size),
+           queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+
+    return pdPASS;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return 0;
+}
+
+bool sim_timers_fire(void) {
+    struct sim_timer* due = NULL;
+
+    for (struct sim_timer* timer = sim_timers; timer != NULL;
+         timer = timer->next) {
+        if (timer->deleted || !timer->active || (timer->expiry > sim_now()))
+            continue;
+        if ((due == NULL) || (timer->expiry < due->expiry))
+            due = timer;
+    }
+
+    if (due == NULL)
+        return false;
+
+    if (due->auto_reload)
+        due->expiry += due->period;
+    else
+        due->active = false;
+
+    due->callback(due);
+    return true;
+}
+
+bool sim_timers_next_expiry(uint64_t* at) {
+    bool found = false;
+
+    for (struct sim_timer* timer = sim_timers; timer != NULL;
+         timer = timer->next) {
+        if (timer->deleted || !timer->active)
+            continue;
+        if (!found || (timer->expiry < *at)) {
+            *at = timer->expiry;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+TimerHandle_t xTimerCreate(const char* name,
+                           TickType_t period,
+                           UBaseType_t auto_reload,
+                           void* timer_id,
+                           TimerCallbackFunction_t callback) {
+    struct sim_timer* timer = calloc(1, sizeof(struct sim_timer));
+    if (timer == NULL)
+        return NULL;
+
+    timer->name = name;
+    timer->period = period;
+    timer->auto_reload = (auto_reload == pdTRUE);
+    timer->timer_id = timer_id;
+    timer->callback = callback;
+
+    /* Deleted timers are kept in the list, as they might be deleted from
+     * within their own callback.
+     */
+    struct sim_timer** tail = &sim_timers;
+    while (*tail != NULL)
+        tail = &(*tail)->next;
+    *tail = timer;
+
+    return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks_to_wait) {
+    if ((timer == NULL) || timer->deleted)
+        return pdFAIL;
+
+    timer->active = true;
+    timer->expiry = sim_now() + timer->period;
+    return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks_to_wait) {
+    if ((timer == NULL) || timer->deleted)
+        return pdFAIL;
+
+    timer->active = false;
+    return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks_to_wait) {
+    return xTimerStart(timer, ticks_to_wait);
+}
+
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticks_to_wait) {
+    if (timer == NULL)
+        return pdFAIL;
+
+    timer->active = false;
+    timer->deleted = true;
+    return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer) {
+    if ((timer == NULL) || timer->deleted)
+        return pdFALSE;
+
+    return timer->active ? pdTRUE : pdFALSE;
+}
+
+void* pvTimerGetTimerID(TimerHandle_t timer) {
+    return timer->timer_id;
+}
+
+/**
+ * Execute a pended function call, see ``xTimerPendFunctionCall()``.
+ *
+ * @param arg The ::sim_pended_call .
+ */
+static void sim_pended_call_run(void* arg) {
+    struct sim_pended_call* call = arg;
+
+    call->function(call->parameter1, call->parameter2);
+    free(call);
+}
+
+BaseType_t xTimerPendFunctionCall(PendedFunction_t function,
+                                  void* parameter1,
+                                  uint32_t parameter2,
+                                  TickType_t ticks_to_wait) {
+    struct sim_pended_call* call = calloc(1, sizeof(struct sim_pended_call));
+    if (call == NULL)
+        return pdFAIL;
+
+    call->function = function;
+    call->parameter1 = parameter1;
+    call->parameter2 = parameter2;
+
+    /* Executed in the simulator's context, like timer callbacks. */
+    sim_schedule(sim_now(), SIM_TAG_TIMER_SERVICE, sim_pended_call_run, call);
+    return pdPASS;
+}
@@ -0,0 +1,460 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Scripted fake of **ESP-IDF**'s WiFi driver.
+ *
+ * The fake models the configured WiFi network (which may be available or
+ * not) and the stations, that connect to the access point. Both are
+ * controlled by the scenario (see ``sim.c``).
+ *
+ * Just like the actual driver, the fake reports its progress by posting
+ * ``WIFI_EVENT`` and ``IP_EVENT`` occurences, after a configurable latency
+ * in *virtual* time.
+ *
+ * @file   sim_wifi.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <stdint.h>
+#include <string.h>
+
+/* The simulator's header. */
+#include "sim.h"
+
+/* The host replacements of ESP-IDF's headers. */
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The time it takes to start the driver (in milliseconds).
+ */
+#define SIM_WIFI_START_LATENCY 100
+
+/**
+ * The time it takes to scan for access points (in milliseconds).
+ */
+#define SIM_WIFI_SCAN_LATENCY 1500
+
+/**
+ * The number of simulated access points of the network.
+ */
+#define SIM_WIFI_APS 2
+
+/**
+ * The RSSI of an access point, that is out of range.
+ */
+#define SIM_WIFI_RSSI_OFF INT8_MIN
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * The state of the fake driver and of the simulated world.
+ */
+struct sim_wifi {
+    bool initialized;
+    bool started;
+    wifi_mode_t mode;
+    bool connecting;
+    bool connected;
+    int stations;
+    bool network_available;
+    uint32_t connect_latency;
+    uint32_t fail_latency;
+    wifi_ps_type_t ps_type;
+    uint32_t ps_changes;
+    wifi_config_t sta_config;
+    int8_t rssi[SIM_WIFI_APS];
+    int ap;
+    bool rssi_armed;
+    int32_t rssi_threshold;
+    bool scanning;
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * Set the module-specific ``TAG`` to be used with ESP-IDF's logging library.
+ */
+static const char* TAG = "sim.wifi";
+
+/**
+ * The state of the fake driver.
+ *
+ * The network is available by default and a connection attempt takes 2
+ * seconds, while a failing attempt is reported after 3 seconds. Only the
+ * first of the network's access points is in range.
+ */
+static struct sim_wifi sim_wifi = {
+    .mode = WIFI_MODE_NULL,
+    .network_available = true,
+    .connect_latency = 2000,
+    .fail_latency = 3000,
+    .rssi = {-50, SIM_WIFI_RSSI_OFF},
+};
+
+
+/* ***** PROTOTYPES ******************************************************** */
+
+static void sim_wifi_post(int32_t event_id);
+static void sim_wifi_started(void* arg);
+static void sim_wifi_connect_result(void* arg);
+static int sim_wifi_select_ap(void);
+static void sim_wifi_scan_done(void* arg);
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Post a ``WIFI_EVENT`` occurence.
+ *
+ * @param event_id The event to post.
+ */
+static void sim_wifi_post(int32_t event_id) {
+    esp_event_post(WIFI_EVENT, event_id, NULL, 0, 0);
+}
+
+/**
+ * The driver is started.
+ *
+ * @param arg Not used.
+ */
+static void sim_wifi_started(void* arg) {
+    if (sim_wifi.mode == WIFI_MODE_AP)
+        sim_wifi_post(WIFI_EVENT_AP_START);
+    else
+        sim_wifi_post(WIFI_EVENT_STA_START);
+}
+
+/**
+ * Select the access point to connect to.
+ *
+ * A pinned BSSID selects the access point by its last octet, otherwise the
+ * strongest access point in range is selected.
+ *
+ * @return int The index of the access point, ``-1`` if none is in range.
+ */
+static int sim_wifi_select_ap(void) {
+    if (sim_wifi.sta_config.sta.bssid_set) {
+        int ap = sim_wifi.sta_config.sta.bssid[5];
+        if ((ap >= SIM_WIFI_APS) || (sim_wifi.rssi[ap] == SIM_WIFI_RSSI_OFF))
+            return -1;
+        return ap;
+    }
+
+    int best = -1;
+    for (int i = 0; i < SIM_WIFI_APS; i++) {
+        if (sim_wifi.rssi[i] == SIM_WIFI_RSSI_OFF)
+            continue;
+        if ((best < 0) || (sim_wifi.rssi[i] > sim_wifi.rssi[best]))
+            best = i;
+    }
+    return best;
+}
+
+/**
+ * A connection attempt is finished.
+ *
+ * The attempt succeeds, if the network is available and the selected access
+ * point is in range *at the end* of the attempt.
+ *
+ * @param arg Not used.
+ */
+static void sim_wifi_connect_result(void* arg) {
+    sim_wifi.connecting = false;
+
+    int ap = sim_wifi_select_ap();
+    if (!sim_wifi.network_available || (ap < 0)) {
+        sim_wifi_post(WIFI_EVENT_STA_DISCONNECTED);
+        return;
+    }
+
+    ESP_LOGI(TAG,
+             "Connected to access point %d (%d dBm)",
+             ap,
+             sim_wifi.rssi[ap]);
+    sim_wifi.ap = ap;
+    sim_wifi.rssi_armed = false;
+    sim_wifi.connected = true;
+    sim_wifi_post(WIFI_EVENT_STA_CONNECTED);
+    esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, NULL, 0, 0);
+}
+
+void sim_wifi_set_network(bool available) {
+    ESP_LOGI(TAG, "Network %s", available ? "available" : "unavailable");
+
+    sim_wifi.network_available = available;
+
+    if (!available && sim_wifi.connected) {
+        sim_wifi.connected = false;
+        sim_wifi_post(WIFI_EVENT_STA_DISCONNECTED);
+    }
+}
+
+void sim_wifi_set_rssi(int ap, int8_t rssi) {
+    if ((ap < 0) || (ap >= SIM_WIFI_APS))
+        return;
+
+    ESP_LOGI(TAG, "Access point %d: %d dBm", ap, rssi);
+    sim_wifi.rssi[ap] = rssi;
+
+    if (!sim_wifi.connected || (sim_wifi.ap != ap))
+        return;
+
+    if (rssi == SIM_WIFI_RSSI_OFF) {
+        sim_wifi.connected = false;
+        sim_wifi_post(WIFI_EVENT_STA_DISCONNECTED);
+        return;
+    }
+
+    /* Just like the actual driver, the event is emitted once. */
+    if (sim_wifi.rssi_armed && (rssi < sim_wifi.rssi_threshold)) {
+        sim_wifi.rssi_armed = false;
+        wifi_event_bss_rssi_low_t event = {.rssi = rssi};
+        esp_event_post(WIFI_EVENT,
+                       WIFI_EVENT_STA_BSS_RSSI_LOW,
+                       &event,
+                       sizeof(event),
+                       0);
+    }
+}
+
+void sim_wifi_set_latency(uint32_t connect_ms, uint32_t fail_ms) {
+    sim_wifi.connect_latency = connect_ms;
+    sim_wifi.fail_latency = fail_ms;
+}
+
+void sim_wifi_client_join(void) {
+    if (!sim_wifi.started || (sim_wifi.mode != WIFI_MODE_AP)) {
+        ESP_LOGI(TAG, "No access point, client can not join!");
+        return;
+    }
+
+    sim_wifi.stations++;
+    sim_wifi_post(WIFI_EVENT_AP_STACONNECTED);
+
+    esp_ip4_addr_t address = {
+        .addr = (uint32_t)(192 | (168 << 8) | (4 << 16)) |
+                ((uint32_t)(sim_wifi.stations + 1) << 24)};
+    esp_event_post(IP_EVENT,
+                   IP_EVENT_AP_STAIPASSIGNED,
+                   &address,
+                   sizeof(address),
+                   0);
+}
+
+void sim_wifi_client_leave(void) {
+    if (sim_wifi.stations == 0) {
+        ESP_LOGI(TAG, "No client connected, client can not leave!");
+        return;
+    }
+
+    sim_wifi.stations--;
+    sim_wifi_post(WIFI_EVENT_AP_STADISCONNECTED);
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t* config) {
+    sim_wifi.initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_deinit(void) {
+    if (sim_wifi.started)
+        return ESP_ERR_INVALID_STATE;
+
+    sim_wifi.initialized = false;
+    sim_wifi.mode = WIFI_MODE_NULL;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode) {
+    if (!sim_wifi.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    sim_wifi.mode = mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t* conf) {
+    if (!sim_wifi.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    if (interface == WIFI_IF_STA)
+        sim_wifi.sta_config = *conf;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t* conf) {
+    if (!sim_wifi.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    if (interface == WIFI_IF_STA)
+        *conf = sim_wifi.sta_config;
+    else
+        memset(conf, 0, sizeof(*conf));
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void) {
+    if (!sim_wifi.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    sim_wifi.started = true;
+    sim_schedule(sim_now() + SIM_WIFI_START_LATENCY,
+                 SIM_TAG_WIFI,
+                 sim_wifi_started,
+                 NULL);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop(void) {
+    if (!sim_wifi.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    /* Pending results are dropped, the driver does not report anything
+     * after being stopped.
+     */
+    sim_cancel(SIM_TAG_WIFI);
+
+    if (sim_wifi.started) {
+        sim_wifi_post((sim_wifi.mode == WIFI_MODE_AP) ? WIFI_EVENT_AP_STOP
+                                                      : WIFI_EVENT_STA_STOP);
+    }
+
+    sim_wifi.started = false;
+    sim_wifi.connecting = false;
+    sim_wifi.connected = false;
+    sim_wifi.scanning = false;
+    sim_wifi.stations = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect(void) {
+    if (!sim_wifi.started || (sim_wifi.mode != WIFI_MODE_STA))
+        return ESP_ERR_INVALID_STATE;
+    if (sim_wifi.connecting || sim_wifi.connected)
+        return ESP_OK;
+
+    sim_wifi.connecting = true;
+    sim_schedule(sim_now() + (sim_wifi.network_available
+                                  ? sim_wifi.connect_latency
+                                  : sim_wifi.fail_latency),
+                 SIM_TAG_WIFI,
+                 sim_wifi_connect_result,
+                 NULL);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_disconnect(void) {
+    if (!sim_wifi.started || (sim_wifi.mode != WIFI_MODE_STA))
+        return ESP_ERR_INVALID_STATE;
+
+    if (sim_wifi.connected) {
+        sim_wifi.connected = false;
+        sim_wifi_post(WIFI_EVENT_STA_DISCONNECTED);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t* ap_info) {
+    if (!sim_wifi.connected)
+        return ESP_ERR_WIFI_NOT_CONNECT;
+
+    memset(ap_info, 0, sizeof(*ap_info));
+    ap_info->bssid[0] = 0x02;
+    ap_info->bssid[5] = (uint8_t)sim_wifi.ap;
+    ap_info->rssi = sim_wifi.rssi[sim_wifi.ap];
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_rssi_threshold(int32_t rssi) {
+    if (!sim_wifi.connected)
+        return ESP_ERR_WIFI_NOT_CONNECT;
+
+    sim_wifi.rssi_threshold = rssi;
+    sim_wifi.rssi_armed = true;
+    return ESP_OK;
+}
+
+/**
+ * A scan is finished.
+ *
+ * @param arg Not used.
+ */
+static void sim_wifi_scan_done(void* arg) {
+    sim_wifi_post(WIFI_EVENT_SCAN_DONE);
+}
+
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t* config, bool block) {
+    if (!sim_wifi.started || (sim_wifi.mode != WIFI_MODE_STA))
+        return ESP_ERR_INVALID_STATE;
+
+    sim_wifi.scanning = true;
+    sim_schedule(sim_now() + SIM_WIFI_SCAN_LATENCY,
+                 SIM_TAG_WIFI,
+                 sim_wifi_scan_done,
+                 NULL);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_records(uint16_t* number,
+                                       wifi_ap_record_t* ap_records) {
+    if (!sim_wifi.scanning) {
+        *number = 0;
+        return ESP_OK;
+    }
+    sim_wifi.scanning = false;
+
+    uint16_t num = 0;
+    for (int i = 0; (i < SIM_WIFI_APS) && (num < *number); i++) {
+        if (sim_wifi.rssi[i] == SIM_WIFI_RSSI_OFF)
+            continue;
+
+        memset(&ap_records[num], 0, sizeof(ap_records[num]));
+        ap_records[num].bssid[0] = 0x02;
+        ap_records[num].bssid[5] = (uint8_t)i;
+        ap_records[num].rssi = sim_wifi.rssi[i];
+        num++;
+    }
+    *number = num;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t* sta) {
+    if (!sim_wifi.started || (sim_wifi.mode != WIFI_MODE_AP))
+        return ESP_ERR_INVALID_STATE;
+
+    sta->num = sim_wifi.stations;
+    return ESP_OK;
+}
+
+uint32_t sim_wifi_get_ps_changes(void) {
+    return sim_wifi.ps_changes;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) {
+    if (!sim_wifi.initialized)
+        return ESP_ERR_INVALID_STATE;
+
+    if (type != sim_wifi.ps_type) {
+        ESP_LOGI(TAG, "Power save mode %d -> %d", sim_wifi.ps_type, type);
+        sim_wifi.ps_type = type;
+        sim_wifi.ps_changes++;
+    }
+    return ESP_OK;
+}
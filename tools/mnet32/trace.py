@@ -0,0 +1,173 @@
+# SPDX-FileCopyrightText: 2022 Mischback
+# SPDX-License-Identifier: MIT
+# SPDX-FileType: SOURCE
+"""Decode and replay the binary trace of the ``mnet32`` state machine.
+
+The trace is provided by the component's web interface (see
+``MNET32_WEB_URL_TRACE``) and may be fetched with any HTTP client, e.g.
+
+    curl -o trace.bin http://<device>/mnet32/trace
+
+The script prints the recorded transitions, oldest first, and replays them,
+verifying that every transition starts in the status the previous one ended
+in. Finally, the time spent in every status is summarized.
+
+The names of the status and notifications are hard-coded and MUST be kept in
+sync with ``mnet32_status`` (``mnet32_state.h``) and
+``mnet32_task_notification`` (``mnet32_internal.h``).
+"""
+
+# Python imports
+import struct
+import sys
+
+# see ``struct mnet32_fsm_trace_header`` in ``mnet32_fsm.h``
+HEADER_FORMAT = "<IBBHI"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+TRACE_MAGIC = 0x5432334D
+TRACE_VERSION = 1
+
+# see ``struct mnet32_fsm_trace_record`` in ``mnet32_fsm.h``
+RECORD_FORMAT = "<IBBBB"
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+# see ``MNET32_FSM_INVALID`` in ``mnet32_fsm.h``
+STATUS_INVALID = 0xFF
+
+STATUS = (
+    "DOWN",
+    "READY",
+    "CONNECTING",
+    "IDLE",
+    "BUSY",
+)
+
+NOTIFICATIONS = (
+    "BASE",
+    "CMD_NETWORKING_STOP",
+    "CMD_WIFI_START",
+    "CMD_WIFI_RESTART",
+    "CMD_ETH_START",
+    "EVENT_ETH_DISCONNECTED",
+    "EVENT_ETH_GOT_IP",
+    "EVENT_ETH_HANDOVER_TIMEOUT",
+    "EVENT_WIFI_AP_START",
+    "EVENT_WIFI_AP_STACONNECTED",
+    "EVENT_WIFI_AP_STADISCONNECTED",
+    "EVENT_WIFI_STA_START",
+    "EVENT_WIFI_STA_CONNECTED",
+    "EVENT_WIFI_STA_DISCONNECTED",
+    "EVENT_WIFI_STA_RSSI_LOW",
+    "EVENT_WIFI_SCAN_DONE",
+)
+
+
+def name_of(names, value):
+    """Get the human-readable name of a status or notification."""
+    if value < len(names):
+        return names[value]
+    return "<{}>".format(value)
+
+
+def decode(data):
+    """Decode a trace dump into its header and a list of records."""
+    if len(data) < HEADER_SIZE:
+        raise ValueError("Dump is too short to contain the header")
+
+    magic, version, record_size, count, invalid = struct.unpack_from(
+        HEADER_FORMAT, data
+    )
+    if magic != TRACE_MAGIC:
+        raise ValueError("Invalid magic 0x{:08X}".format(magic))
+    if version != TRACE_VERSION:
+        raise ValueError("Unsupported version {}".format(version))
+    if record_size != RECORD_SIZE:
+        raise ValueError("Unexpected record size {}".format(record_size))
+    if len(data) < HEADER_SIZE + count * RECORD_SIZE:
+        raise ValueError("Dump is truncated")
+
+    records = []
+    for i in range(count):
+        timestamp, t_from, notification, t_to, _ = struct.unpack_from(
+            RECORD_FORMAT, data, HEADER_SIZE + i * RECORD_SIZE
+        )
+        records.append((timestamp, t_from, notification, t_to))
+
+    return invalid, records
+
+
+def replay(records):
+    """Print the records and check their continuity.
+
+    Returns the number of discontinuities and the time spent in every status
+    (in milliseconds).
+    """
+    discontinuities = 0
+    time_in_status = {}
+    previous = None
+
+    for timestamp, t_from, notification, t_to in records:
+        marker = ""
+        if t_to == STATUS_INVALID:
+            marker = "  [INVALID]"
+            t_to = t_from
+        if previous is not None:
+            p_timestamp, p_to = previous
+            if p_to != t_from:
+                marker += "  [DISCONTINUITY, expected {}]".format(
+                    name_of(STATUS, p_to)
+                )
+                discontinuities += 1
+            time_in_status[p_to] = time_in_status.get(p_to, 0) + (
+                timestamp - p_timestamp
+            )
+
+        print(
+            "{:>10} ms  {:<10} --({})--> {}{}".format(
+                timestamp,
+                name_of(STATUS, t_from),
+                name_of(NOTIFICATIONS, notification),
+                name_of(STATUS, t_to),
+                marker,
+            )
+        )
+        previous = (timestamp, t_to)
+
+    return discontinuities, time_in_status
+
+
+if __name__ == "__main__":
+    # get parameters from ``argv``
+    try:
+        input_file = sys.argv[1]
+    except IndexError:
+        print("Please specify an INPUT file!")
+        sys.exit(1)
+
+    # open input_file, read its content
+    try:
+        with open(input_file, "rb") as f_in:
+            dump = f_in.read()
+    except FileNotFoundError:
+        print("Could not open INPUT '{}' (file not found)!".format(input_file))
+        sys.exit(1)
+    except PermissionError:
+        print("Could not read INPUT '{}' (missing permission)!".format(input_file))
+        sys.exit(1)
+
+    try:
+        invalid, records = decode(dump)
+    except ValueError as e:
+        print("Could not decode INPUT '{}' ({})!".format(input_file, e))
+        sys.exit(1)
+
+    discontinuities, time_in_status = replay(records)
+
+    print()
+    print("Records............. {}".format(len(records)))
+    print("Invalid transitions. {} (since boot)".format(invalid))
+    print("Discontinuities..... {}".format(discontinuities))
+    for status, duration in sorted(time_in_status.items()):
+        print("Time {:<14} {} ms".format(name_of(STATUS, status), duration))
+
+    sys.exit(1 if discontinuities > 0 else 0)
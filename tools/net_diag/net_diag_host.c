@@ -0,0 +1,286 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Run the measurement engine of the ``net_diag`` component on a Linux host.
+ *
+ * The engine is compiled unmodified, so it may be verified against
+ * **iperf** (version 2) or against itself:
+ *
+ *   - ``net_diag_host sink [PORT]`` serves tests of remote sources;
+ *   - ``net_diag_host source tcp|udp HOST [PORT [SECONDS [KBPS]]]`` runs a
+ *     test as source;
+ *   - ``net_diag_host loopback [PORT [SECONDS]]`` runs a TCP and a UDP test
+ *     over the loopback interface and verifies, that both ends agree.
+ *
+ * @file   net_diag_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The engine of the component. */
+#include "net_diag_engine.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The length of a single read / write, matching the component's default.
+ */
+#define NET_DIAG_HOST_LENGTH 1470
+
+/**
+ * The default port, matching the component's default.
+ */
+#define NET_DIAG_HOST_PORT 5001
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * The sink of the loopback test, running in its own thread.
+ */
+struct net_diag_host_loopback {
+    struct net_diag_sink sink;
+    volatile bool stop;
+    int served;
+    struct net_diag_result results[2];
+};
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Print the result of a test.
+ *
+ * @param prefix A short description of the test.
+ * @param result The result of the test.
+ */
+static void net_diag_host_print(const char* prefix,
+                                const struct net_diag_result* result) {
+    struct in_addr peer = {.s_addr = result->peer_address};
+
+    printf("%-6s %s %s:%d  %" PRIu64 " bytes in %" PRIu32 " ms = %" PRIu32
+           " kbit/s",
+           prefix,
+           (result->protocol == NET_DIAG_PROTOCOL_TCP) ? "TCP" : "UDP",
+           inet_ntoa(peer),
+           result->peer_port,
+           result->bytes,
+           result->duration_ms,
+           net_diag_result_kbps(result));
+    if (result->protocol == NET_DIAG_PROTOCOL_UDP) {
+        printf("  (%" PRIu32 " datagrams, %" PRIu32 " lost, %" PRIu32
+               " out of order, jitter %" PRIu32 " us)",
+               result->datagrams,
+               result->lost,
+               result->out_of_order,
+               result->jitter_us);
+    }
+    if (result->error != 0)
+        printf("  [%s]", strerror(result->error));
+    printf("\n");
+}
+
+/**
+ * Serve tests of remote sources forever.
+ *
+ * @param port The port to listen on.
+ * @return int The exit code.
+ */
+static int net_diag_host_sink(uint16_t port) {
+    struct net_diag_sink sink;
+    struct net_diag_result result;
+    bool stop = false;
+
+    if (net_diag_sink_open(&sink, port, NET_DIAG_HOST_LENGTH, 0) != 0) {
+        fprintf(stderr, "Could not open sink: %s\n", strerror(errno));
+        return 1;
+    }
+    printf("Sink listening on port %d (TCP/UDP)\n", port);
+
+    for (;;) {
+        int ret = net_diag_sink_serve(&sink, 1000, &stop, &result);
+        if (ret > 0) {
+            net_diag_host_print("Sink", &result);
+            fflush(stdout);
+        } else if (ret < 0) {
+            fprintf(stderr, "Sink failed: %s\n", strerror(errno));
+            break;
+        }
+    }
+
+    net_diag_sink_close(&sink);
+    return 1;
+}
+
+/**
+ * The thread of the loopback test's sink.
+ *
+ * @param arg The loopback test.
+ * @return void* Always ``NULL``.
+ */
+static void* net_diag_host_loopback_thread(void* arg) {
+    struct net_diag_host_loopback* loopback = arg;
+
+    while (!loopback->stop && (loopback->served < 2)) {
+        int ret = net_diag_sink_serve(&loopback->sink,
+                                      NET_DIAG_ENGINE_POLL_INTERVAL,
+                                      &loopback->stop,
+                                      &loopback->results[loopback->served]);
+        if (ret > 0)
+            loopback->served++;
+        else if (ret < 0)
+            break;
+    }
+
+    return NULL;
+}
+
+/**
+ * Run a TCP and a UDP test over the loopback interface.
+ *
+ * The test fails, if the sink's results do not match the sources' results.
+ *
+ * @param port     The port to use.
+ * @param duration The duration of each test in milliseconds.
+ * @return int The exit code.
+ */
+static int net_diag_host_loopback(uint16_t port, uint32_t duration) {
+    struct net_diag_host_loopback loopback = {0};
+    struct net_diag_result tx[2];
+    bool stop = false;
+    int failures = 0;
+
+    if (net_diag_sink_open(&loopback.sink, port, NET_DIAG_HOST_LENGTH, 0) !=
+        0) {
+        fprintf(stderr, "Could not open sink: %s\n", strerror(errno));
+        return 1;
+    }
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, net_diag_host_loopback_thread, &loopback);
+
+    struct net_diag_source_config config = {
+        .protocol = NET_DIAG_PROTOCOL_TCP,
+        .address = htonl(INADDR_LOOPBACK),
+        .port = port,
+        .duration_ms = duration,
+        .bandwidth = 100000000,
+        .length = NET_DIAG_HOST_LENGTH,
+    };
+    if (net_diag_source_run(&config, &stop, &tx[0]) != 0)
+        failures++;
+
+    config.protocol = NET_DIAG_PROTOCOL_UDP;
+    if (net_diag_source_run(&config, &stop, &tx[1]) != 0)
+        failures++;
+
+    loopback.stop = true;
+    pthread_join(thread, NULL);
+    net_diag_sink_close(&loopback.sink);
+
+    for (int i = 0; i < 2; i++) {
+        net_diag_host_print("Source", &tx[i]);
+        if (i < loopback.served)
+            net_diag_host_print("Sink", &loopback.results[i]);
+    }
+
+    if (loopback.served != 2) {
+        printf("FAIL: sink served %d of 2 tests\n", loopback.served);
+        return 1;
+    }
+    host_check(&failures,
+               loopback.results[0].bytes == tx[0].bytes,
+               "TCP bytes match");
+    // The sink's bytes include the final datagram, so compare datagrams. The
+    // loopback interface drops datagrams, if the sink falls behind.
+    host_check(&failures,
+               (loopback.results[1].datagrams + loopback.results[1].lost) ==
+                   tx[1].datagrams,
+               "UDP datagrams match");
+    host_check(&failures,
+               (loopback.results[1].lost == tx[1].lost) &&
+                   (loopback.results[1].jitter_us == tx[1].jitter_us),
+               "UDP report is received");
+
+    return host_check_summary(failures);
+}
+
+/**
+ * Run a test as source.
+ *
+ * @param argc The number of arguments, starting with the protocol.
+ * @param argv The arguments.
+ * @return int The exit code.
+ */
+static int net_diag_host_source(int argc, char** argv) {
+    struct in_addr address;
+    bool stop = false;
+
+    if ((argc < 2) || (inet_aton(argv[1], &address) == 0)) {
+        fprintf(stderr, "Please specify a valid HOST!\n");
+        return 1;
+    }
+
+    struct net_diag_source_config config = {
+        .protocol = (strcmp(argv[0], "udp") == 0) ? NET_DIAG_PROTOCOL_UDP
+                                                  : NET_DIAG_PROTOCOL_TCP,
+        .address = address.s_addr,
+        .port = (argc > 2) ? (uint16_t)atoi(argv[2]) : NET_DIAG_HOST_PORT,
+        .duration_ms = ((argc > 3) ? (uint32_t)atoi(argv[3]) : 10) * 1000,
+        .bandwidth = ((argc > 4) ? (uint32_t)atoi(argv[4]) : 1000) * 1000,
+        .length = NET_DIAG_HOST_LENGTH,
+    };
+
+    struct net_diag_result result;
+    int ret = net_diag_source_run(&config, &stop, &result);
+    net_diag_host_print("Source", &result);
+
+    return (ret == 0) ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr,
+                "Usage: %s sink [PORT]\n"
+                "       %s source tcp|udp HOST [PORT [SECONDS [KBPS]]]\n"
+                "       %s loopback [PORT [SECONDS]]\n",
+                argv[0],
+                argv[0],
+                argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "sink") == 0) {
+        return net_diag_host_sink(
+            (argc > 2) ? (uint16_t)atoi(argv[2]) : NET_DIAG_HOST_PORT);
+    }
+    if ((strcmp(argv[1], "source") == 0) && (argc > 2))
+        return net_diag_host_source(argc - 2, argv + 2);
+    if (strcmp(argv[1], "loopback") == 0) {
+        return net_diag_host_loopback(
+            (argc > 2) ? (uint16_t)atoi(argv[2]) : NET_DIAG_HOST_PORT,
+            ((argc > 3) ? (uint32_t)atoi(argv[3]) : 2) * 1000);
+    }
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,623 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Verify and benchmark the metrics registry of the ``obs32`` component on a
+ * Linux host.
+ *
+ * The registry is compiled unmodified, the core of a task is simulated by a
+ * thread-local variable:
+ *
+ *   - ``obs32_metrics_host bench`` verifies the rendering (``# HELP`` and
+ *     ``# TYPE`` once per name, labels, cumulative buckets), that the chunks
+ *     of a small buffer add up to the rendering of a large buffer, that
+ *     counters do not wrap around, that a group is registered once and that
+ *     concurrent increments of two "cores" are not lost. Then it renders a
+ *     registry of the size of the firmware's: the cost of a scrape is linear
+ *     in its output, so its size and its number of chunks are checked
+ *     against fixed bounds, that keep a scrape within the default budget of
+ *     ``min_httpd``'s endpoint on the target. The time per update and per
+ *     scrape and the share of the time, that scraping every 15 seconds takes
+ *     on the host, are reported, but not checked, as they depend on the host.
+ *
+ * @file   obs32_metrics_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+/**
+ * The simulated core of the calling thread.
+ */
+static __thread unsigned int obs32_metrics_host_core = 0;
+
+/* The registry selects the slots with this. */
+#define OBS32_METRICS_CORE_ID() obs32_metrics_host_core
+
+/* The metrics registry. */
+#include "obs32/obs32_metrics.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The number of increments of every thread of the concurrency check.
+ */
+#define OBS32_METRICS_HOST_INCREMENTS 2000000
+
+/**
+ * The number of updates, that are timed.
+ */
+#define OBS32_METRICS_HOST_UPDATES 20000000
+
+/**
+ * The number of scrapes, that are timed.
+ */
+#define OBS32_METRICS_HOST_SCRAPES 20000
+
+/**
+ * The size of the chunks, just like ``MIN_HTTPD_METRICS_CHUNK_LEN``.
+ */
+#define OBS32_METRICS_HOST_CHUNK_LEN 512
+
+/**
+ * The scrape interval, that is assumed for the report, in seconds.
+ */
+#define OBS32_METRICS_HOST_INTERVAL 15
+
+/**
+ * The default budget, just like ``CONFIG_MIN_HTTPD_METRICS_CPU_BUDGET``.
+ */
+#define OBS32_METRICS_HOST_BUDGET 2
+
+/**
+ * The assumed time of the ESP32 to render and send a byte of a scrape, in
+ * nanoseconds.
+ *
+ * The host takes less than 2 ns per byte and the ESP32 is about two orders of
+ * magnitude slower, so this is a generous margin.
+ */
+#define OBS32_METRICS_HOST_TARGET_NS_PER_BYTE 1000
+
+/**
+ * The maximum size of a scrape of a registry of the size of the firmware's.
+ */
+#define OBS32_METRICS_HOST_MAX_SCRAPE_LEN 12288
+
+// The largest scrape takes at most a tenth of the budget on the target
+_Static_assert((uint64_t)OBS32_METRICS_HOST_MAX_SCRAPE_LEN *
+                       OBS32_METRICS_HOST_TARGET_NS_PER_BYTE * 10 <=
+                   (uint64_t)OBS32_METRICS_HOST_INTERVAL * 1000000000 *
+                       OBS32_METRICS_HOST_BUDGET / 100,
+               "A scrape of the maximum size exceeds the budget");
+
+/**
+ * The number of counters of a registry of the size of the firmware's.
+ */
+#define OBS32_METRICS_HOST_COUNTERS 24
+
+/**
+ * The number of histograms of a registry of the size of the firmware's.
+ */
+#define OBS32_METRICS_HOST_HISTOGRAMS 4
+
+/**
+ * The number of metrics of a registry of the size of the firmware's.
+ */
+#define OBS32_METRICS_HOST_FIRMWARE \
+    (OBS32_METRICS_HOST_COUNTERS + OBS32_METRICS_HOST_HISTOGRAMS)
+
+/**
+ * The maximum length of a rendering, that is collected.
+ */
+#define OBS32_METRICS_HOST_OUTPUT_LEN 16384
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A collected rendering.
+ */
+struct obs32_metrics_host_output {
+    char data[OBS32_METRICS_HOST_OUTPUT_LEN];
+    size_t len;
+    size_t chunks;
+};
+
+/**
+ * The argument of a thread of the concurrency check.
+ */
+struct obs32_metrics_host_thread {
+    unsigned int core;
+    struct obs32_metric_counter* counter;
+    struct obs32_metric_histogram* histogram;
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * The upper bounds of the verified histogram.
+ */
+static const uint32_t obs32_metrics_host_bounds[] = {10, 100, 1000};
+
+/**
+ * The upper bounds of the handlers' durations, just like ``min_httpd``'s.
+ */
+static const uint32_t obs32_metrics_host_handler_bounds[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000,
+    1000000};
+
+static struct obs32_metric_counter obs32_metrics_host_get = {0};
+static struct obs32_metric_counter obs32_metrics_host_post = {0};
+static struct obs32_metric_gauge obs32_metrics_host_temp = {0};
+static struct obs32_metric_histogram obs32_metrics_host_latency =
+    OBS32_METRICS_HISTOGRAM(obs32_metrics_host_bounds);
+
+/**
+ * Read a constant value.
+ *
+ * @return int64_t ``-42``.
+ */
+static int64_t obs32_metrics_host_read(void) {
+    return -42;
+}
+
+/**
+ * The verified metrics.
+ */
+static const struct obs32_metric obs32_metrics_host_table[] = {
+    {.name = "test_requests_total",
+     .help = "Requests by method.",
+     .labels = "method=\"get\"",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &obs32_metrics_host_get},
+    {.name = "test_requests_total",
+     .labels = "method=\"post\"",
+     .type = OBS32_METRIC_COUNTER,
+     .counter = &obs32_metrics_host_post},
+    {.name = "test_temperature",
+     .help = "A gauge.",
+     .type = OBS32_METRIC_GAUGE,
+     .gauge = &obs32_metrics_host_temp},
+    {.name = "test_read",
+     .help = "A gauge, that is read.",
+     .type = OBS32_METRIC_GAUGE,
+     .read = obs32_metrics_host_read},
+    {.name = "test_latency_us",
+     .help = "A histogram.",
+     .type = OBS32_METRIC_HISTOGRAM,
+     .histogram = &obs32_metrics_host_latency},
+};
+
+/**
+ * The group of ::obs32_metrics_host_table .
+ */
+static struct obs32_metrics_group obs32_metrics_host_group = {
+    .metrics = obs32_metrics_host_table,
+    .count = sizeof(obs32_metrics_host_table) /
+             sizeof(obs32_metrics_host_table[0]),
+};
+
+/**
+ * The expected rendering of ::obs32_metrics_host_group .
+ */
+static const char obs32_metrics_host_expected[] =
+    "# HELP test_requests_total Requests by method.\n"
+    "# TYPE test_requests_total counter\n"
+    "test_requests_total{method=\"get\"} 3\n"
+    "test_requests_total{method=\"post\"} 0\n"
+    "# HELP test_temperature A gauge.\n"
+    "# TYPE test_temperature gauge\n"
+    "test_temperature -7\n"
+    "# HELP test_read A gauge, that is read.\n"
+    "# TYPE test_read gauge\n"
+    "test_read -42\n"
+    "# HELP test_latency_us A histogram.\n"
+    "# TYPE test_latency_us histogram\n"
+    "test_latency_us_bucket{le=\"10\"} 1\n"
+    "test_latency_us_bucket{le=\"100\"} 3\n"
+    "test_latency_us_bucket{le=\"1000\"} 3\n"
+    "test_latency_us_bucket{le=\"+Inf\"} 4\n"
+    "test_latency_us_sum 5065\n"
+    "test_latency_us_count 4\n";
+
+/**
+ * The counters of the registry of the size of the firmware's.
+ */
+static struct obs32_metric_counter
+    obs32_metrics_host_counters[OBS32_METRICS_HOST_COUNTERS];
+
+/**
+ * The histograms of the registry of the size of the firmware's.
+ */
+static struct obs32_metric_histogram
+    obs32_metrics_host_histograms[OBS32_METRICS_HOST_HISTOGRAMS];
+
+/**
+ * The metrics of the registry of the size of the firmware's.
+ */
+static struct obs32_metric
+    obs32_metrics_host_firmware[OBS32_METRICS_HOST_FIRMWARE];
+
+/**
+ * The names of ::obs32_metrics_host_firmware .
+ */
+static char obs32_metrics_host_names[OBS32_METRICS_HOST_FIRMWARE][40];
+
+/**
+ * The group of ::obs32_metrics_host_firmware .
+ */
+static struct obs32_metrics_group obs32_metrics_host_firmware_group;
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get the current time.
+ *
+ * @return double The time in seconds.
+ */
+static double obs32_metrics_host_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Collect a chunk of a rendering.
+ *
+ * @param ctx  The output (::obs32_metrics_host_output ).
+ * @param data The chunk.
+ * @param len  The length of ``data``.
+ * @return bool ``true`` if the chunk fits into the output.
+ */
+static bool obs32_metrics_host_collect(void* ctx,
+                                       const char* data,
+                                       size_t len) {
+    struct obs32_metrics_host_output* out = ctx;
+
+    if (out->len + len > sizeof(out->data))
+        return false;
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+    out->chunks++;
+    return true;
+}
+
+/**
+ * Discard a chunk of a rendering, like a socket, that takes it immediately.
+ *
+ * @param ctx  The number of bytes (``size_t``).
+ * @param data The chunk.
+ * @param len  The length of ``data``.
+ * @return bool Always ``true``.
+ */
+static bool obs32_metrics_host_discard(void* ctx,
+                                       const char* data,
+                                       size_t len) {
+    (void)data;
+    *((size_t*)ctx) += len;
+    return true;
+}
+
+/**
+ * Refuse a chunk of a rendering, like a closed socket.
+ *
+ * @param ctx  Unused.
+ * @param data Unused.
+ * @param len  Unused.
+ * @return bool Always ``false``.
+ */
+static bool obs32_metrics_host_refuse(void* ctx,
+                                      const char* data,
+                                      size_t len) {
+    (void)ctx;
+    (void)data;
+    (void)len;
+    return false;
+}
+
+/**
+ * Render the registry into an output.
+ *
+ * @param out  The output, that is reset first.
+ * @param size The size of the chunks.
+ * @return bool The return value of ::obs32_metrics_render .
+ */
+static bool obs32_metrics_host_render(
+    struct obs32_metrics_host_output* out,
+    size_t size) {
+    char* buf = malloc(size);
+    out->len = 0;
+    out->chunks = 0;
+
+    bool ret = obs32_metrics_render(buf,
+                                    size,
+                                    obs32_metrics_host_collect,
+                                    out);
+    free(buf);
+    return ret;
+}
+
+/**
+ * Increment a counter and observe a histogram from a simulated core.
+ *
+ * @param arg The thread (::obs32_metrics_host_thread ).
+ * @return void* ``NULL``.
+ */
+static void* obs32_metrics_host_worker(void* arg) {
+    struct obs32_metrics_host_thread* thread = arg;
+
+    obs32_metrics_host_core = thread->core;
+    for (uint32_t i = 0; i < OBS32_METRICS_HOST_INCREMENTS; i++) {
+        obs32_metrics_inc(thread->counter);
+        obs32_metrics_observe(thread->histogram, i % 2000);
+    }
+    return NULL;
+}
+
+/**
+ * Verify the rendering of the registry.
+ *
+ * @param failures The number of failures.
+ */
+static void obs32_metrics_host_verify(int* failures) {
+    static struct obs32_metrics_host_output out;
+    static struct obs32_metrics_host_output chunked;
+
+    host_check(failures,
+               obs32_metrics_register(&obs32_metrics_host_group),
+               "A group is registered");
+    host_check(failures,
+               !obs32_metrics_register(&obs32_metrics_host_group),
+               "A group is registered once");
+
+    obs32_metrics_inc(&obs32_metrics_host_get);
+    obs32_metrics_host_core = 1;
+    obs32_metrics_add(&obs32_metrics_host_get, 2);
+    obs32_metrics_observe(&obs32_metrics_host_latency, 5000);
+    obs32_metrics_host_core = 0;
+    obs32_metrics_set(&obs32_metrics_host_temp, -7);
+    obs32_metrics_observe(&obs32_metrics_host_latency, 10);
+    obs32_metrics_observe(&obs32_metrics_host_latency, 11);
+    obs32_metrics_observe(&obs32_metrics_host_latency, 44);
+
+    bool ok = obs32_metrics_host_render(&out, 4096);
+    out.data[out.len] = '\0';
+    bool same = ok && (strcmp(out.data, obs32_metrics_host_expected) == 0);
+    if (!same)
+        printf("%s", out.data);
+    host_check(failures, same, "The rendering is exact");
+
+    ok = obs32_metrics_host_render(&chunked, 7);
+    host_check(failures,
+               ok && (chunked.len == out.len) &&
+                   (memcmp(chunked.data, out.data, out.len) == 0) &&
+                   (chunked.chunks == (out.len + 6) / 7),
+               "Chunks of 7 bytes add up to the rendering");
+
+    char buf[16];
+    host_check(failures,
+               !obs32_metrics_render(buf,
+                                     sizeof(buf),
+                                     obs32_metrics_host_refuse,
+                                     NULL),
+               "A refused chunk fails the rendering");
+
+    // The slots wrap around, the total does not
+    obs32_metrics_add(&obs32_metrics_host_post, 0xF0000000u);
+    obs32_metrics_host_render(&out, 4096);
+    obs32_metrics_host_core = 1;
+    obs32_metrics_add(&obs32_metrics_host_post, 0xF0000000u);
+    obs32_metrics_host_render(&out, 4096);
+    obs32_metrics_host_core = 0;
+    obs32_metrics_add(&obs32_metrics_host_post, 0x20000000u);
+    obs32_metrics_host_render(&out, 4096);
+    out.data[out.len] = '\0';
+    host_check(
+        failures,
+        strstr(out.data, "test_requests_total{method=\"post\"} 8589934592\n") !=
+            NULL,
+        "Counters do not wrap around");
+
+    // Two simulated cores update the same metrics concurrently, the group
+    // stays registered
+    static struct obs32_metric_counter counter = {0};
+    static struct obs32_metric_histogram histogram =
+        OBS32_METRICS_HISTOGRAM(obs32_metrics_host_bounds);
+    static const struct obs32_metric concurrent[] = {
+        {.name = "test_concurrent_total",
+         .help = "Increments of two cores.",
+         .type = OBS32_METRIC_COUNTER,
+         .counter = &counter},
+        {.name = "test_concurrent_us",
+         .help = "Observations of two cores.",
+         .type = OBS32_METRIC_HISTOGRAM,
+         .histogram = &histogram},
+    };
+    static struct obs32_metrics_group group = {
+        .metrics = concurrent,
+        .count = sizeof(concurrent) / sizeof(concurrent[0]),
+    };
+    obs32_metrics_register(&group);
+
+    pthread_t threads[2];
+    struct obs32_metrics_host_thread args[2];
+    for (unsigned int i = 0; i < 2; i++) {
+        args[i] = (struct obs32_metrics_host_thread){
+            .core = i,
+            .counter = &counter,
+            .histogram = &histogram,
+        };
+        pthread_create(&threads[i], NULL, obs32_metrics_host_worker, &args[i]);
+    }
+    // Scrapes run concurrently with the updates
+    while (__atomic_load_n(&counter.cores[1], __ATOMIC_RELAXED) <
+           OBS32_METRICS_HOST_INCREMENTS / 2)
+        obs32_metrics_host_render(&out, 512);
+    for (unsigned int i = 0; i < 2; i++)
+        pthread_join(threads[i], NULL);
+
+    obs32_metrics_host_render(&out, 512);
+    out.data[out.len] = '\0';
+    char expected[96];
+    snprintf(expected,
+             sizeof(expected),
+             "test_concurrent_total %u\n",
+             2 * OBS32_METRICS_HOST_INCREMENTS);
+    bool counted = strstr(out.data, expected) != NULL;
+    snprintf(expected,
+             sizeof(expected),
+             "test_concurrent_us_count %u\n",
+             2 * OBS32_METRICS_HOST_INCREMENTS);
+    counted = counted && (strstr(out.data, expected) != NULL);
+    host_check(
+        failures, counted, "Concurrent updates of two cores are counted");
+}
+
+/**
+ * Register a group of the size of the firmware's metrics.
+ *
+ * The firmware registers about two dozen counters and gauges and four
+ * histograms (``min_httpd``, ``mnet32`` and the application).
+ */
+static void obs32_metrics_host_firmware_register(void) {
+    for (size_t i = 0; i < OBS32_METRICS_HOST_FIRMWARE; i++) {
+        struct obs32_metric* metric = &obs32_metrics_host_firmware[i];
+
+        snprintf(obs32_metrics_host_names[i],
+                 sizeof(obs32_metrics_host_names[i]),
+                 "firmware_metric_%02zu_total",
+                 i);
+        metric->name = obs32_metrics_host_names[i];
+        metric->help = "A metric of the size of the firmware's.";
+        metric->labels = "route=\"inline\"";
+        if (i < OBS32_METRICS_HOST_COUNTERS) {
+            metric->type = OBS32_METRIC_COUNTER;
+            metric->counter = &obs32_metrics_host_counters[i];
+        } else {
+            struct obs32_metric_histogram* histogram =
+                &obs32_metrics_host_histograms
+                    [i - OBS32_METRICS_HOST_COUNTERS];
+            histogram->bounds = obs32_metrics_host_handler_bounds;
+            histogram->count = sizeof(obs32_metrics_host_handler_bounds) /
+                               sizeof(obs32_metrics_host_handler_bounds[0]);
+            metric->type = OBS32_METRIC_HISTOGRAM;
+            metric->histogram = histogram;
+        }
+    }
+    obs32_metrics_host_firmware_group.metrics =
+        obs32_metrics_host_firmware;
+    obs32_metrics_host_firmware_group.count =
+        OBS32_METRICS_HOST_FIRMWARE;
+    obs32_metrics_register(&obs32_metrics_host_firmware_group);
+}
+
+/**
+ * Verify the registry and report the time per update and per scrape.
+ *
+ * @return int ``0`` if all checks passed, ``1`` otherwise.
+ */
+static int obs32_metrics_host_bench(void) {
+    int failures = 0;
+
+    obs32_metrics_host_verify(&failures);
+    obs32_metrics_host_firmware_register();
+
+    double start = obs32_metrics_host_now();
+    for (uint32_t i = 0; i < OBS32_METRICS_HOST_UPDATES; i++)
+        obs32_metrics_inc(
+            &obs32_metrics_host_counters[i %
+                                         OBS32_METRICS_HOST_COUNTERS]);
+    double inc = obs32_metrics_host_now() - start;
+
+    start = obs32_metrics_host_now();
+    for (uint32_t i = 0; i < OBS32_METRICS_HOST_UPDATES; i++)
+        obs32_metrics_observe(
+            &obs32_metrics_host_histograms
+                [i % OBS32_METRICS_HOST_HISTOGRAMS],
+            (i * 7919u) % 2000000u);
+    double observe = obs32_metrics_host_now() - start;
+
+    char chunk[OBS32_METRICS_HOST_CHUNK_LEN];
+    size_t bytes = 0;
+    start = obs32_metrics_host_now();
+    for (uint32_t i = 0; i < OBS32_METRICS_HOST_SCRAPES; i++)
+        obs32_metrics_render(chunk,
+                             sizeof(chunk),
+                             obs32_metrics_host_discard,
+                             &bytes);
+    double scrape = (obs32_metrics_host_now() - start) /
+                    OBS32_METRICS_HOST_SCRAPES;
+    bytes /= OBS32_METRICS_HOST_SCRAPES;
+
+    // The work of a scrape is determined by its output and its chunks
+    static struct obs32_metrics_host_output out;
+    bool ok = obs32_metrics_host_render(&out, OBS32_METRICS_HOST_CHUNK_LEN);
+    host_check(&failures,
+               ok && (out.len <= OBS32_METRICS_HOST_MAX_SCRAPE_LEN),
+               "A scrape of the firmware's size renders at most 12 KiB");
+    host_check(&failures,
+               out.chunks == (out.len + OBS32_METRICS_HOST_CHUNK_LEN - 1) /
+                                 OBS32_METRICS_HOST_CHUNK_LEN,
+               "A scrape sends full chunks, but the last");
+
+    /* The timings depend on the host's load, so they are reported but not
+     * checked. The ESP32 is about two orders of magnitude slower than the
+     * host.
+     */
+    double share = scrape * 100.0 / OBS32_METRICS_HOST_INTERVAL;
+    printf("     increment: %.1f ns\n",
+           inc * 1e9 / OBS32_METRICS_HOST_UPDATES);
+    printf("     observe:   %.1f ns\n",
+           observe * 1e9 / OBS32_METRICS_HOST_UPDATES);
+    printf("     scrape:    %.1f us for %zu bytes in %zu chunks\n",
+           scrape * 1e6,
+           bytes,
+           out.chunks);
+    printf("     share:     %.5f %% every %d s (budget: %d %%)\n",
+           share,
+           OBS32_METRICS_HOST_INTERVAL,
+           OBS32_METRICS_HOST_BUDGET);
+    printf("     of budget: %.3f %%\n",
+           share * 100.0 / OBS32_METRICS_HOST_BUDGET);
+
+    return host_check_summary(failures);
+}
+
+/**
+ * The entry point of the tool.
+ *
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return int The exit status.
+ */
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s bench\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "bench") == 0)
+        return obs32_metrics_host_bench();
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,590 @@
+// SPDX-FileCopyrightText: 2022 Mischback
+// SPDX-License-Identifier: MIT
+// SPDX-FileType: SOURCE
+
+/**
+ * Verify and benchmark the trace buffers of the ``obs32`` component on a Linux
+ * host.
+ *
+ * The buffers are compiled unmodified, together with ``min_httpd``'s export
+ * and JSON writer, the core of a task is simulated by a thread-local variable:
+ *
+ *   - ``obs32_trace_host bench`` verifies the ids of registered groups, that
+ *     trace points of unregistered groups and of a paused export are ignored,
+ *     that a ring keeps the most recent records, that the export is valid
+ *     Chrome trace JSON with a process per core and that concurrent trace
+ *     points of two tasks of the same core and of two cores are not lost.
+ *     Then it reports the time per trace point and per timestamp. The
+ *     timings are not checked, as they depend on the host.
+ *   - ``obs32_trace_host demo`` records the timeline of a simulated task,
+ *     that is woken by notifications, next to a server and a worker on the
+ *     other core, and writes the export to ``stdout``, so it may be opened
+ *     with the Perfetto UI.
+ *
+ * @file   obs32_trace_host.c
+ * @author Mischback
+ * @bug    Bugs are tracked with the
+ *         [issue tracker](https://github.com/Mischback/krachkiste_esp32/issues)
+ *         at GitHub.
+ */
+
+/* ***** INCLUDES ********************************************************** */
+
+/* C's standard libraries. */
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/**
+ * The simulated core of the calling thread.
+ */
+static __thread unsigned int obs32_trace_host_core = 0;
+
+/* The trace buffers select the ring with this. */
+#define OBS32_METRICS_CORE_ID() obs32_trace_host_core
+
+/* The trace buffers. */
+#include "obs32/obs32_trace.h"
+
+/* The export of ``min_httpd``. */
+#include "min_httpd_trace_engine.h"
+
+/* The checks of the host tools. */
+#include "host_check.h"
+
+
+/* ***** DEFINES *********************************************************** */
+
+/**
+ * The number of trace points of every thread of the concurrency check.
+ */
+#define OBS32_TRACE_HOST_POINTS 2000000
+
+/**
+ * The number of trace points and timestamps, that are timed.
+ */
+#define OBS32_TRACE_HOST_TIMED 20000000
+
+/**
+ * The size of the chunks, just like ``MIN_HTTPD_TRACE_CHUNK_LEN``.
+ */
+#define OBS32_TRACE_HOST_CHUNK_LEN 512
+
+/**
+ * The maximum length of an export, that is collected.
+ */
+#define OBS32_TRACE_HOST_OUTPUT_LEN 131072
+
+/**
+ * The number of notifications of the demo.
+ */
+#define OBS32_TRACE_HOST_DEMO_ROUNDS 40
+
+
+/* ***** TYPES ************************************************************* */
+
+/**
+ * A collected export.
+ */
+struct obs32_trace_host_output {
+    char data[OBS32_TRACE_HOST_OUTPUT_LEN];
+    size_t len;
+};
+
+/**
+ * The argument of a thread of the concurrency check.
+ */
+struct obs32_trace_host_thread {
+    unsigned int core;
+    uint16_t arg;
+};
+
+
+/* ***** VARIABLES ********************************************************* */
+
+/**
+ * The names of the trace points of the verified group.
+ */
+static const char* const obs32_trace_host_names[] = {
+    "span",
+    "instant",
+};
+
+/**
+ * The verified group.
+ */
+static struct obs32_trace_group obs32_trace_host_group = {
+    .category = "test",
+    .names = obs32_trace_host_names,
+    .count = sizeof(obs32_trace_host_names) /
+             sizeof(obs32_trace_host_names[0]),
+};
+
+/**
+ * A group, that is registered after ::obs32_trace_host_group .
+ */
+static struct obs32_trace_group obs32_trace_host_second = {
+    .category = "second",
+    .names = obs32_trace_host_names,
+    .count = 1,
+};
+
+/**
+ * A group, that exceeds the ids.
+ */
+static struct obs32_trace_group obs32_trace_host_huge = {
+    .category = "huge",
+    .names = obs32_trace_host_names,
+    .count = (1U << OBS32_TRACE_POINT_BITS),
+};
+
+/**
+ * A group, that is never registered.
+ */
+static struct obs32_trace_group obs32_trace_host_unregistered = {
+    .category = "unregistered",
+    .names = obs32_trace_host_names,
+    .count = 1,
+};
+
+/**
+ * The names of the trace points of the demo's task, just like ``mnet32``'s.
+ */
+static const char* const obs32_trace_host_task_names[] = {
+    "notify",
+    "dispatch",
+};
+
+/**
+ * The group of the demo's task.
+ */
+static struct obs32_trace_group obs32_trace_host_task = {
+    .category = "mnet32",
+    .names = obs32_trace_host_task_names,
+    .count = sizeof(obs32_trace_host_task_names) /
+             sizeof(obs32_trace_host_task_names[0]),
+};
+
+/**
+ * The names of the trace points of the demo's server, just like
+ * ``min_httpd``'s.
+ */
+static const char* const obs32_trace_host_server_names[] = {
+    "inline",
+    "offload_queued",
+    "offload_run",
+};
+
+/**
+ * The group of the demo's server.
+ */
+static struct obs32_trace_group obs32_trace_host_server = {
+    .category = "min_httpd",
+    .names = obs32_trace_host_server_names,
+    .count = sizeof(obs32_trace_host_server_names) /
+             sizeof(obs32_trace_host_server_names[0]),
+};
+
+/**
+ * The collected export.
+ */
+static struct obs32_trace_host_output obs32_trace_host_output;
+
+
+/* ***** FUNCTIONS ********************************************************* */
+
+/**
+ * Get the current time.
+ *
+ * @return double The time in seconds.
+ */
+static double obs32_trace_host_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Collect a chunk of an export.
+ *
+ * @param ctx  The output (::obs32_trace_host_output ).
+ * @param data The chunk.
+ * @param len  The length of ``data``.
+ * @return bool ``true`` if the chunk fits into the output.
+ */
+static bool obs32_trace_host_collect(void* ctx, const char* data, size_t len) {
+    struct obs32_trace_host_output* out = ctx;
+
+    if (out->len + len >= sizeof(out->data))
+        return false;
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+    out->data[out->len] = '\0';
+    return true;
+}
+
+/**
+ * Write a chunk of an export to ``stdout``.
+ *
+ * @param ctx  Unused.
+ * @param data The chunk.
+ * @param len  The length of ``data``.
+ * @return bool ``true`` if the chunk was written.
+ */
+static bool obs32_trace_host_write(void* ctx, const char* data, size_t len) {
+    (void)ctx;
+    return fwrite(data, 1, len, stdout) == len;
+}
+
+/**
+ * Export the rings into ::obs32_trace_host_output .
+ *
+ * @return bool ``true`` if the document was written completely.
+ */
+static bool obs32_trace_host_export(void) {
+    char chunk[OBS32_TRACE_HOST_CHUNK_LEN];
+    struct min_httpd_json json;
+
+    obs32_trace_host_output.len = 0;
+    obs32_trace_host_output.data[0] = '\0';
+    min_httpd_json_init(&json,
+                        chunk,
+                        sizeof(chunk),
+                        obs32_trace_host_collect,
+                        &obs32_trace_host_output);
+    min_httpd_trace_export(&json);
+    return min_httpd_json_finish(&json);
+}
+
+/**
+ * Count the occurrences of a string in the collected export.
+ *
+ * @param needle The string.
+ * @return size_t The number of occurrences.
+ */
+static size_t obs32_trace_host_count(const char* needle) {
+    size_t count = 0;
+
+    for (const char* it = strstr(obs32_trace_host_output.data, needle);
+         it != NULL;
+         it = strstr(it + 1, needle))
+        count++;
+    return count;
+}
+
+/**
+ * Verify, that the timestamps of the exported records do not decrease.
+ *
+ * The records of every core are exported oldest first, the metadata has no
+ * timestamp.
+ *
+ * @return bool ``true`` if the timestamps of every process ascend.
+ */
+static bool obs32_trace_host_ascending(void) {
+    unsigned long long previous = 0;
+    unsigned int pid = 0;
+
+    for (const char* it = strstr(obs32_trace_host_output.data, "\"ts\":");
+         it != NULL;
+         it = strstr(it + 1, "\"ts\":")) {
+        unsigned long long ts = strtoull(it + 5, NULL, 10);
+        const char* p = strstr(it, "\"pid\":");
+        unsigned int current = (p != NULL) ? (unsigned int)atoi(p + 6) : 0;
+
+        if ((current == pid) && (ts < previous))
+            return false;
+        pid = current;
+        previous = ts;
+    }
+    return true;
+}
+
+/**
+ * Forget all records.
+ */
+static void obs32_trace_host_clear(void) {
+    memset(obs32_trace_rings, 0, sizeof(obs32_trace_rings));
+}
+
+/**
+ * Record trace points from a simulated core.
+ *
+ * @param arg The thread's core and argument
+ *            (::obs32_trace_host_thread ).
+ * @return void* ``NULL``.
+ */
+static void* obs32_trace_host_thread(void* arg) {
+    const struct obs32_trace_host_thread* thread = arg;
+
+    obs32_trace_host_core = thread->core;
+    for (int i = 0; i < OBS32_TRACE_HOST_POINTS; i++)
+        obs32_trace_instant(&obs32_trace_host_group, 1, thread->arg);
+    return NULL;
+}
+
+/**
+ * Record trace points of two threads at the same time.
+ *
+ * @param first_core  The core of the first thread.
+ * @param second_core The core of the second thread.
+ */
+static void obs32_trace_host_concurrent(unsigned int first_core,
+                                        unsigned int second_core) {
+    struct obs32_trace_host_thread args[2] = {
+        {.core = first_core, .arg = 1},
+        {.core = second_core, .arg = 2},
+    };
+    pthread_t threads[2];
+
+    obs32_trace_host_clear();
+    for (int i = 0; i < 2; i++)
+        pthread_create(&threads[i], NULL, obs32_trace_host_thread, &args[i]);
+    for (int i = 0; i < 2; i++)
+        pthread_join(threads[i], NULL);
+}
+
+/**
+ * Verify, that all records of a ring are instants of one of two threads.
+ *
+ * @param ring The ring.
+ * @return bool ``true`` if no record is torn.
+ */
+static bool obs32_trace_host_intact(const struct obs32_trace_ring* ring) {
+    uint16_t id =
+        (uint16_t)((OBS32_TRACE_INSTANT << OBS32_TRACE_POINT_BITS) |
+                   (obs32_trace_host_group.base + 1));
+
+    for (int i = 0; i < OBS32_TRACE_LEN; i++) {
+        if ((ring->records[i].id != id) ||
+            ((ring->records[i].arg != 1) && (ring->records[i].arg != 2)))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Verify the trace buffers and measure the cost of a trace point.
+ *
+ * @return int The exit status, ``0`` if all checks passed.
+ */
+static int obs32_trace_host_bench(void) {
+    int failures = 0;
+    char expected[64];
+
+    /* The ids of the groups */
+    bool registered =
+        obs32_trace_register(&obs32_trace_host_group) &&
+        obs32_trace_register(&obs32_trace_host_second);
+    host_check(&failures,
+               registered &&
+                   (obs32_trace_host_group.base == 1) &&
+                   (obs32_trace_host_second.base == 3),
+               "The ids of a group follow the previous group");
+    host_check(&failures,
+               !obs32_trace_register(&obs32_trace_host_group),
+               "A group is registered once");
+    host_check(&failures,
+               !obs32_trace_register(&obs32_trace_host_huge) &&
+                   (obs32_trace_host_huge.base == 0),
+               "A group, that exceeds the ids, is refused");
+
+    /* Ignored trace points */
+    obs32_trace_host_clear();
+    obs32_trace_instant(&obs32_trace_host_unregistered, 0, 1);
+    obs32_trace_paused = true;
+    obs32_trace_instant(&obs32_trace_host_group, 1, 1);
+    obs32_trace_paused = false;
+    host_check(&failures,
+               obs32_trace_rings[0].head == 0,
+               "Unregistered groups and pauses are ignored");
+
+    /* The most recent records of a ring */
+    for (int i = 0; i < 3 * OBS32_TRACE_LEN; i++)
+        obs32_trace_instant(&obs32_trace_host_group, 1, (uint16_t)i);
+    obs32_trace_host_core = 1;
+    obs32_trace_begin(&obs32_trace_host_group, 0, 7);
+    obs32_trace_end(&obs32_trace_host_group, 0, 7);
+    obs32_trace_host_core = 0;
+
+    bool exported = obs32_trace_host_export();
+    host_check(&failures, exported, "The export is a complete JSON document");
+    snprintf(expected,
+             sizeof(expected),
+             "\"arg\":%d}",
+             2 * OBS32_TRACE_LEN - 1);
+    bool kept = (obs32_trace_host_count("\"ph\":\"i\"") == OBS32_TRACE_LEN) &&
+                (obs32_trace_host_count(expected) == 0);
+    snprintf(expected,
+             sizeof(expected),
+             "\"arg\":%d}",
+             3 * OBS32_TRACE_LEN - 1);
+    kept = kept && (obs32_trace_host_count(expected) == 1);
+    host_check(&failures, kept, "A ring keeps the most recent records");
+    host_check(&failures,
+               (obs32_trace_host_count("\"ph\":\"B\"") == 1) &&
+                   (obs32_trace_host_count("\"ph\":\"E\"") == 1) &&
+                   (obs32_trace_host_count("\"ts\":0,") >= 1) &&
+                   obs32_trace_host_ascending(),
+               "Spans are exported with ascending timestamps from 0");
+    host_check(&failures,
+               (obs32_trace_host_count("\"process_name\"") ==
+                OBS32_TRACE_CORES) &&
+                   (obs32_trace_host_count("\"name\":\"test.span\"") ==
+                    OBS32_TRACE_CORES) &&
+                   (obs32_trace_host_count("\"name\":\"second.span\"") ==
+                    OBS32_TRACE_CORES),
+               "Every core is a process, every trace point a thread");
+    host_check(&failures,
+               !obs32_trace_paused,
+               "The trace points resume after the export");
+
+    /* Concurrent trace points */
+    obs32_trace_host_concurrent(0, 0);
+    host_check(&failures,
+               (obs32_trace_rings[0].head == 2 * OBS32_TRACE_HOST_POINTS) &&
+                   obs32_trace_host_intact(&obs32_trace_rings[0]),
+               "Concurrent trace points of one core are not lost");
+    obs32_trace_host_concurrent(0, 1);
+    host_check(&failures,
+               (obs32_trace_rings[0].head == OBS32_TRACE_HOST_POINTS) &&
+                   (obs32_trace_rings[1].head == OBS32_TRACE_HOST_POINTS),
+               "Trace points of two cores use their own rings");
+
+    /* The cost of a trace point */
+    obs32_trace_host_clear();
+    double start = obs32_trace_host_now();
+    for (int i = 0; i < OBS32_TRACE_HOST_TIMED; i++)
+        obs32_trace_instant(&obs32_trace_host_group, 1, (uint16_t)i);
+    double point = (obs32_trace_host_now() - start) * 1e9 /
+                   OBS32_TRACE_HOST_TIMED;
+
+    volatile uint32_t sink = 0;
+    start = obs32_trace_host_now();
+    for (int i = 0; i < OBS32_TRACE_HOST_TIMED; i++)
+        sink += OBS32_TRACE_TIMESTAMP();
+    double timestamp = (obs32_trace_host_now() - start) * 1e9 /
+                       OBS32_TRACE_HOST_TIMED;
+
+    obs32_trace_host_clear();
+    for (int i = 0; i < OBS32_TRACE_LEN; i++)
+        obs32_trace_instant(&obs32_trace_host_group, 1, (uint16_t)i);
+    obs32_trace_host_export();
+
+    /* The timings depend on the host's load, so they are reported but not
+     * checked.
+     */
+    printf("     trace point: %.1f ns\n", point);
+    printf("     timestamp:   %.1f ns\n", timestamp);
+    printf("     recording:   %.1f ns\n", point - timestamp);
+    printf("     export:      %zu bytes for %d records\n",
+           obs32_trace_host_output.len,
+           OBS32_TRACE_LEN);
+
+    return host_check_summary(failures);
+}
+
+/**
+ * The simulated task of the demo, woken by notifications.
+ *
+ * @param arg Unused.
+ * @return void* ``NULL``.
+ */
+static void* obs32_trace_host_demo_task(void* arg) {
+    (void)arg;
+
+    obs32_trace_host_core = 0;
+    for (uint16_t i = 0; i < OBS32_TRACE_HOST_DEMO_ROUNDS; i++) {
+        usleep(1500);
+        obs32_trace_instant(&obs32_trace_host_task, 0, i % 16);
+        obs32_trace_begin(&obs32_trace_host_task, 1, i % 16);
+        usleep(200 + (i % 4) * 100);
+        obs32_trace_end(&obs32_trace_host_task, 1, i % 16);
+    }
+    return NULL;
+}
+
+/**
+ * The simulated server and worker of the demo.
+ *
+ * @param arg Unused.
+ * @return void* ``NULL``.
+ */
+static void* obs32_trace_host_demo_server(void* arg) {
+    (void)arg;
+
+    obs32_trace_host_core = 1;
+    for (uint16_t i = 0; i < OBS32_TRACE_HOST_DEMO_ROUNDS; i++) {
+        uint16_t sockfd = 54 + (i % 3);
+
+        obs32_trace_begin(&obs32_trace_host_server, 0, sockfd);
+        usleep(300);
+        obs32_trace_end(&obs32_trace_host_server, 0, sockfd);
+
+        if ((i % 4) == 0) {
+            obs32_trace_instant(&obs32_trace_host_server, 1, i % 4);
+            obs32_trace_begin(&obs32_trace_host_server, 2, i % 4);
+            usleep(800);
+            obs32_trace_end(&obs32_trace_host_server, 2, i % 4);
+        }
+        usleep(1000);
+    }
+    return NULL;
+}
+
+/**
+ * Record a simulated timeline and write its export to ``stdout``.
+ *
+ * @return int The exit status, ``0`` if the export was written.
+ */
+static int obs32_trace_host_demo(void) {
+    char chunk[OBS32_TRACE_HOST_CHUNK_LEN];
+    struct min_httpd_json json;
+    pthread_t task;
+    pthread_t server;
+
+    obs32_trace_register(&obs32_trace_host_task);
+    obs32_trace_register(&obs32_trace_host_server);
+
+    pthread_create(&task, NULL, obs32_trace_host_demo_task, NULL);
+    pthread_create(&server, NULL, obs32_trace_host_demo_server, NULL);
+    pthread_join(task, NULL);
+    pthread_join(server, NULL);
+
+    min_httpd_json_init(&json,
+                        chunk,
+                        sizeof(chunk),
+                        obs32_trace_host_write,
+                        NULL);
+    min_httpd_trace_export(&json);
+    if (!min_httpd_json_finish(&json))
+        return 1;
+    fputc('\n', stdout);
+    return 0;
+}
+
+/**
+ * The entry point of the tool.
+ *
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return int The exit status.
+ */
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s bench|demo\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "bench") == 0)
+        return obs32_trace_host_bench();
+    if (strcmp(argv[1], "demo") == 0)
+        return obs32_trace_host_demo();
+
+    fprintf(stderr, "Unknown command '%s'!\n", argv[1]);
+    return 1;
+}
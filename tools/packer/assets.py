@@ -0,0 +1,388 @@
+# SPDX-FileCopyrightText: 2022 Mischback
+# SPDX-License-Identifier: MIT
+# SPDX-FileType: SOURCE
+"""Pack a directory of web assets into a blob and a table with a perfect hash.
+
+Every file of SOURCE_DIR becomes an *asset*, served from its path relative to
+SOURCE_DIR (``index.html`` is served from its directory, too). The contents
+of all assets are written to ``OUTPUT.bin``, the *blob*. Compressible assets
+are stored with a ``gzip`` variant, if it is actually smaller.
+
+``OUTPUT.c`` provides the table ``NAME`` (see ``struct min_httpd_asset_table``
+in ``min_httpd_assets.h``), that locates every asset in the blob and provides
+its MIME type, length and hash (used as ``ETag``). The paths are looked up by
+a minimal perfect hash (*hash and displace*): the path's hash with the seed
+``0`` selects a displacement, that is either the asset's index itself or the
+seed of a second hash, that selects the asset without collisions.
+
+By default, the blob is referenced by the symbols of **ESP-IDF**'s
+``EMBED_FILES``, so ``OUTPUT.bin`` must be embedded with the same file name.
+The time of packing is sent as ``Last-Modified`` of all assets. It may be
+fixed with the environment variable ``SOURCE_DATE_EPOCH`` for reproducible
+builds.
+
+With ``--inline``, the blob is included in ``OUTPUT.c`` instead (e.g. for the
+host tools).
+
+With ``--image``, the table and the blob are written to ``OUTPUT.img`` in
+addition, an *image*, that is flashed to a data partition and memory-mapped
+by ``min_httpd`` (see ``min_httpd_assets_image_check()``). All values are
+little-endian ``uint32_t``:
+
+- the header: ``magic``, ``version``, ``count`` and the offsets (relative to
+  the image) of the entries, the displacements and the blob, followed by the
+  length of the blob, the length of the image, the time of packing and its
+  checksum (the hash of everything after the header with the seed ``0``);
+- the entries, ordered like the table: the offsets of ``path`` and ``type``
+  (NUL-terminated strings in the image), ``hash``, ``offset``, ``len``,
+  ``gzip_offset`` and ``gzip_len`` (relative to the blob);
+- the displacements (``int32_t``);
+- the strings;
+- the blob.
+
+The image must fit into a partition of ``--image`` bytes.
+
+The hash function MUST be kept in sync with ``min_httpd_assets_hash()``
+(``min_httpd_assets_engine.c``).
+"""
+
+# Python imports
+import argparse
+import gzip
+import hashlib
+import os
+import struct
+import sys
+import time
+
+# The MIME types by extension, anything else is ``application/octet-stream``.
+MIME_TYPES = {
+    ".css": "text/css",
+    ".gif": "image/gif",
+    ".htm": "text/html",
+    ".html": "text/html",
+    ".ico": "image/x-icon",
+    ".jpeg": "image/jpeg",
+    ".jpg": "image/jpeg",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".png": "image/png",
+    ".svg": "image/svg+xml",
+    ".txt": "text/plain",
+    ".wasm": "application/wasm",
+    ".woff2": "font/woff2",
+    ".xml": "application/xml",
+}
+
+# The MIME types, that are compressed; others are compressed already.
+COMPRESSIBLE = (
+    "application/javascript",
+    "application/json",
+    "application/wasm",
+    "application/xml",
+    "image/svg+xml",
+    "image/x-icon",
+    "text/",
+)
+
+# A ``gzip`` variant is only stored, if it saves at least this ratio.
+GZIP_MIN_SAVING = 0.1
+
+# The offsets of the blob are aligned to this number of bytes.
+BLOB_ALIGNMENT = 4
+
+# The image's magic number ("MHAP") and version, see ``min_httpd_assets_engine.h``.
+IMAGE_MAGIC = 0x5041484D
+IMAGE_VERSION = 2
+
+# The number of ``uint32_t`` fields of the image's header and of an entry.
+IMAGE_HEADER_FIELDS = 10
+IMAGE_ENTRY_FIELDS = 7
+
+# The maximum seed, that is tried for a bucket of the perfect hash.
+MAX_SEED = 1 << 20
+
+
+def asset_hash(key, seed):
+    """Hash a path, see ``min_httpd_assets_hash()``.
+
+    This is FNV-1a, starting with the seed, and the finalizer of MurmurHash3.
+    """
+    h = (0x811C9DC5 ^ seed) & 0xFFFFFFFF
+    for byte in key:
+        h ^= byte
+        h = (h * 0x01000193) & 0xFFFFFFFF
+    h ^= h >> 16
+    h = (h * 0x85EBCA6B) & 0xFFFFFFFF
+    h ^= h >> 13
+    h = (h * 0xC2B2AE35) & 0xFFFFFFFF
+    h ^= h >> 16
+    return h
+
+
+def perfect_hash(keys):
+    """Build the displacements of a minimal perfect hash of ``keys``.
+
+    A negative displacement ``d`` is the index ``-d - 1``, a positive one is
+    the seed of the second hash.
+    """
+    count = len(keys)
+    buckets = [[] for _ in range(count)]
+    for index, key in enumerate(keys):
+        buckets[asset_hash(key, 0) % count].append(index)
+
+    displacements = [0] * count
+    slots = [None] * count
+
+    # The largest buckets first, while most slots are free.
+    order = sorted(range(count), key=lambda b: len(buckets[b]), reverse=True)
+    for bucket in order:
+        members = buckets[bucket]
+        if len(members) <= 1:
+            break
+        for seed in range(1, MAX_SEED):
+            candidates = [asset_hash(keys[i], seed) % count for i in members]
+            if len(set(candidates)) == len(candidates) and all(
+                slots[c] is None for c in candidates
+            ):
+                break
+        else:
+            raise RuntimeError("No perfect hash found!")
+        displacements[bucket] = seed
+        for index, slot in zip(members, candidates):
+            slots[slot] = index
+
+    # The remaining buckets have a single key, that takes any free slot.
+    free = [slot for slot in range(count) if slots[slot] is None]
+    for bucket in order:
+        if len(buckets[bucket]) != 1:
+            continue
+        slot = free.pop()
+        displacements[bucket] = -slot - 1
+        slots[slot] = buckets[bucket][0]
+
+    return displacements, slots
+
+
+def collect(source_dir):
+    """Collect the assets of ``source_dir`` as (path, file name) tuples."""
+    assets = []
+    for root, dirs, files in os.walk(source_dir):
+        dirs.sort()
+        for name in sorted(files):
+            file_name = os.path.join(root, name)
+            path = "/" + os.path.relpath(file_name, source_dir).replace(os.sep, "/")
+            assets.append((path, file_name))
+            if name == "index.html":
+                assets.append((path[: -len("index.html")], file_name))
+    return assets
+
+
+def c_string(value):
+    """Quote ``value`` as C string literal."""
+    return '"{}"'.format(value.replace("\\", "\\\\").replace('"', '\\"'))
+
+
+def image(entries, slots, displacements, blob, timestamp):
+    """Build the image of a table and its blob."""
+    header_len = IMAGE_HEADER_FIELDS * 4
+    entries_offset = header_len
+    displacements_offset = entries_offset + len(slots) * IMAGE_ENTRY_FIELDS * 4
+
+    strings = bytearray()
+    string_offsets = {}
+    strings_offset = displacements_offset + len(displacements) * 4
+
+    def string(value):
+        if value not in string_offsets:
+            string_offsets[value] = strings_offset + len(strings)
+            strings.extend(value.encode("utf-8") + b"\0")
+        return string_offsets[value]
+
+    fields = []
+    for index in slots:
+        path, offset, length, gzip_offset, gzip_len, content_hash, mime = entries[index]
+        fields += [
+            string(path),
+            string(mime),
+            content_hash,
+            offset,
+            length,
+            gzip_offset,
+            gzip_len,
+        ]
+
+    body = bytearray(struct.pack("<{}I".format(len(fields)), *fields))
+    body += struct.pack("<{}i".format(len(displacements)), *displacements)
+    body += strings
+    body += b"\0" * (-(header_len + len(body)) % BLOB_ALIGNMENT)
+    blob_offset = header_len + len(body)
+    body += blob
+
+    header = struct.pack(
+        "<{}I".format(IMAGE_HEADER_FIELDS),
+        IMAGE_MAGIC,
+        IMAGE_VERSION,
+        len(slots),
+        entries_offset,
+        displacements_offset,
+        blob_offset,
+        len(blob),
+        header_len + len(body),
+        timestamp,
+        asset_hash(body, 0),
+    )
+    return header + body
+
+
+def pack(name, source_dir, output, inline, image_size):
+    """Pack the assets of ``source_dir`` into ``output`` (.bin, .c and .img).
+
+    The image is only written, if ``image_size`` is set.
+    """
+    assets = collect(source_dir)
+    if not assets:
+        raise RuntimeError("No assets in '{}'!".format(source_dir))
+
+    blob = bytearray()
+    stored = {}  # file name -> (offset, len, gzip offset, gzip len, hash, type)
+
+    def append(data):
+        blob.extend(b"\0" * (-len(blob) % BLOB_ALIGNMENT))
+        offset = len(blob)
+        blob.extend(data)
+        return offset
+
+    entries = []
+    for path, file_name in assets:
+        if file_name not in stored:
+            with open(file_name, "rb") as f_in:
+                data = f_in.read()
+            mime = MIME_TYPES.get(
+                os.path.splitext(file_name)[1].lower(), "application/octet-stream"
+            )
+            content_hash = int.from_bytes(hashlib.sha256(data).digest()[:4], "big")
+            offset = append(data)
+            gzip_offset, gzip_len = 0, 0
+            if mime.startswith(COMPRESSIBLE):
+                compressed = gzip.compress(data, compresslevel=9, mtime=0)
+                if len(compressed) <= len(data) * (1 - GZIP_MIN_SAVING):
+                    gzip_offset, gzip_len = append(compressed), len(compressed)
+            stored[file_name] = (
+                offset,
+                len(data),
+                gzip_offset,
+                gzip_len,
+                content_hash,
+                mime,
+            )
+        entries.append((path,) + stored[file_name])
+
+    timestamp = int(os.environ.get("SOURCE_DATE_EPOCH", time.time()))
+
+    keys = [entry[0].encode("utf-8") for entry in entries]
+    displacements, slots = perfect_hash(keys)
+
+    with open(output + ".bin", "wb") as f_out:
+        f_out.write(blob)
+
+    if image_size:
+        data = image(entries, slots, displacements, blob, timestamp)
+        if len(data) > image_size:
+            raise RuntimeError(
+                "The image ({} bytes) exceeds the partition ({} bytes)!".format(
+                    len(data), image_size
+                )
+            )
+        with open(output + ".img", "wb") as f_out:
+            f_out.write(data)
+
+    lines = [
+        "// Generated by tools/packer/assets.py from '{}', do not edit!".format(
+            os.path.basename(os.path.normpath(source_dir))
+        ),
+        "",
+        "#include <stdint.h>",
+        "",
+        '#include "min_httpd/min_httpd_assets.h"',
+        "",
+    ]
+    if inline:
+        lines.append("static const uint8_t {}_blob[] = {{".format(name))
+        for i in range(0, len(blob), 16):
+            lines.append(
+                "    " + " ".join("0x{:02x},".format(b) for b in blob[i : i + 16])
+            )
+        lines.append("};")
+    else:
+        symbol = "_binary_{}_start".format(
+            os.path.basename(output + ".bin").replace(".", "_").replace("-", "_")
+        )
+        lines.append('extern const uint8_t {}_blob[] asm("{}");'.format(name, symbol))
+    lines += ["", "static const struct min_httpd_asset {}_entries[] = {{".format(name)]
+    for index in slots:
+        path, offset, length, gzip_offset, gzip_len, content_hash, mime = entries[index]
+        lines.append(
+            "    {{{}, {}, 0x{:08x}u, {}u, {}u, {}u, {}u}},".format(
+                c_string(path),
+                c_string(mime),
+                content_hash,
+                offset,
+                length,
+                gzip_offset,
+                gzip_len,
+            )
+        )
+    lines += ["};", ""]
+    lines.append("static const int32_t {}_displacements[] = {{".format(name))
+    for i in range(0, len(displacements), 8):
+        lines.append(
+            "    " + " ".join("{},".format(d) for d in displacements[i : i + 8])
+        )
+    lines += [
+        "};",
+        "",
+        "const struct min_httpd_asset_table {} = {{".format(name),
+        "    .assets = {}_entries,".format(name),
+        "    .displacements = {}_displacements,".format(name),
+        "    .count = {}u,".format(len(entries)),
+        "    .blob = {}_blob,".format(name),
+        "    .blob_len = {}u,".format(len(blob)),
+        "    .timestamp = {}u}};".format(timestamp),
+        "",
+    ]
+    with open(output + ".c", "w") as f_out:
+        f_out.write("\n".join(lines))
+
+    print(
+        "Packed {} assets of '{}' into {} bytes".format(
+            len(entries), source_dir, len(blob)
+        )
+    )
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("name", help="the name of the table")
+    parser.add_argument("source_dir", help="the directory of the assets")
+    parser.add_argument("output", help="the output files, without extension")
+    parser.add_argument(
+        "--inline", action="store_true", help="include the blob in the table"
+    )
+    parser.add_argument(
+        "--image",
+        type=lambda value: int(value, 0),
+        default=0,
+        metavar="SIZE",
+        help="write an image for a partition of SIZE bytes, too",
+    )
+    args = parser.parse_args()
+
+    try:
+        pack(args.name, args.source_dir, args.output, args.inline, args.image)
+    except (OSError, RuntimeError) as error:
+        print("Could not pack assets: {}".format(error))
+        sys.exit(1)
+
+    # return "0" = SUCCESS
+    sys.exit(0)
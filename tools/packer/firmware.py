@@ -0,0 +1,335 @@
+# SPDX-FileCopyrightText: 2022 Mischback
+# SPDX-License-Identifier: MIT
+# SPDX-FileType: SOURCE
+"""Pack a firmware into a payload for the firmware upload of ``min_httpd``.
+
+The payload reduces the number of bytes, that are sent to the device. It is
+uploaded like the plain firmware, with the SHA-256 digest of the *firmware*
+(not of the payload) in ``X-Firmware-SHA256``.
+
+With ``--base``, the payload is a *delta* against BASE, the firmware, that is
+running on the device. The delta is a sequence of instructions (see
+``enum min_httpd_ota_delta_op`` in ``min_httpd_ota_engine.h``):
+
+- ``INSERT`` bytes, that are not found in BASE;
+- ``COPY`` bytes of BASE;
+- ``ADD`` bytes to bytes of BASE (modulo 256), for regions, that differ in
+  single bytes only (e.g. addresses, that were shifted by the linker).
+
+Matches are found by indexing BASE with keys of ``KEY_LEN`` bytes. Every
+match is extended backwards and forwards, then it is extended *approximately*
+(like ``bsdiff``), while most bytes still match.
+
+Unless ``--no-compress`` is given, the (delta or plain) firmware is
+compressed in the format of ``heatshrink`` with a window of ``2 ^
+WINDOW_BITS`` bytes, that is decoded with a fixed amount of memory.
+
+The payload starts with a header, all values are little-endian: ``magic``
+(``uint32_t``), ``version``, ``flags``, ``window_bits``, ``lookahead_bits``
+(``uint8_t``), the length of the firmware, the length of the decompressed
+payload, the length of BASE (``uint32_t``) and the SHA-256 digest of BASE.
+
+The format MUST be kept in sync with ``min_httpd_ota_engine.h``.
+"""
+
+# Python imports
+import argparse
+import hashlib
+import struct
+import sys
+
+# The payload's magic number ("MOTA") and version, see ``min_httpd_ota_engine.h``.
+PAYLOAD_MAGIC = 0x41544F4D
+PAYLOAD_VERSION = 1
+PAYLOAD_HEADER_FORMAT = "<IBBBBIII32s"
+
+# The flags of the payload's header.
+FLAG_COMPRESSED = 0x01
+FLAG_DELTA = 0x02
+
+# The compression, see ``MIN_HTTPD_OTA_WINDOW_BITS``.
+WINDOW_BITS = 11
+LOOKAHEAD_BITS = 4
+
+# A back-reference costs ``1 + WINDOW_BITS + LOOKAHEAD_BITS`` bits, a literal
+# 9 bits, so shorter matches are not worth it.
+MIN_MATCH = 3
+
+# The number of candidates, that are tried for a back-reference.
+MAX_CANDIDATES = 8
+
+# The instructions of the delta, see ``enum min_httpd_ota_delta_op``.
+OP_INSERT = 0
+OP_COPY = 1
+OP_ADD = 2
+
+# The length of the keys, that index the base, and their distance.
+KEY_LEN = 8
+KEY_STRIDE = 4
+
+# An approximate match ends, if its score (matching bytes minus differing
+# bytes) drops by this value, or at a run of this many matching bytes, that
+# is copied instead.
+APPROX_SLACK = 8
+APPROX_RUN = 32
+
+
+class BitWriter:
+    """Write bits, most significant first."""
+
+    def __init__(self):
+        """Create an empty writer."""
+        self.data = bytearray()
+        self.bits = 0
+        self.count = 0
+
+    def write(self, value, count):
+        """Write the ``count`` lowest bits of ``value``."""
+        self.bits = (self.bits << count) | value
+        self.count += count
+        while self.count >= 8:
+            self.count -= 8
+            self.data.append((self.bits >> self.count) & 0xFF)
+        self.bits &= (1 << self.count) - 1
+
+    def finish(self):
+        """Pad the last byte with zeros and return the data."""
+        if self.count > 0:
+            self.data.append((self.bits << (8 - self.count)) & 0xFF)
+            self.count = 0
+        return bytes(self.data)
+
+
+def compress(data):
+    """Compress ``data`` in the format of ``heatshrink``.
+
+    Every literal is a ``1`` bit and 8 bits, every back-reference a ``0`` bit,
+    the distance minus 1 (``WINDOW_BITS`` bits) and the length minus 1
+    (``LOOKAHEAD_BITS`` bits). The matches are found greedily with hash chains.
+    """
+    window = 1 << WINDOW_BITS
+    max_len = 1 << LOOKAHEAD_BITS
+    chains = {}
+    writer = BitWriter()
+
+    i = 0
+    size = len(data)
+    while i < size:
+        best_len = 0
+        best_dist = 0
+        key = data[i : i + MIN_MATCH]
+        chain = chains.get(key)
+        if chain is not None and len(key) == MIN_MATCH:
+            limit = min(max_len, size - i)
+            for candidate in reversed(chain[-MAX_CANDIDATES:]):
+                if i - candidate > window:
+                    break
+                length = MIN_MATCH
+                while length < limit and data[candidate + length] == data[i + length]:
+                    length += 1
+                if length > best_len:
+                    best_len = length
+                    best_dist = i - candidate
+                    if length == limit:
+                        break
+
+        if best_len >= MIN_MATCH:
+            writer.write(best_dist - 1, 1 + WINDOW_BITS)
+            writer.write(best_len - 1, LOOKAHEAD_BITS)
+            step = best_len
+        else:
+            writer.write(0x100 | data[i], 9)
+            step = 1
+
+        for position in range(i, i + step):
+            chains.setdefault(data[position : position + MIN_MATCH], []).append(
+                position
+            )
+        i += step
+
+    return writer.finish()
+
+
+def varint(value):
+    """Encode an unsigned varint (7 bits per byte, least significant first)."""
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return out
+
+
+def svarint(value):
+    """Encode a signed varint (zigzag: 0, -1, 1, -2, ...)."""
+    return varint(value * 2 if value >= 0 else -value * 2 - 1)
+
+
+def match_len(a, i, b, j):
+    """Get the length of the exact match of ``a[i:]`` and ``b[j:]``."""
+    limit = min(len(a) - i, len(b) - j)
+    length = 0
+    while (
+        length + 256 <= limit
+        and a[i + length : i + length + 256] == b[j + length : j + length + 256]
+    ):
+        length += 256
+    while length < limit and a[i + length] == b[j + length]:
+        length += 1
+    return length
+
+
+def approx_len(a, i, b, j):
+    """Get the length of the approximate match of ``a[i:]`` and ``b[j:]``."""
+    limit = min(len(a) - i, len(b) - j)
+    score = best = best_len = run = 0
+    for k in range(limit):
+        if a[i + k] == b[j + k]:
+            score += 1
+            run += 1
+            if run >= APPROX_RUN:
+                return min(best_len, k + 1 - run)
+        else:
+            score -= 1
+            run = 0
+            if score < best - APPROX_SLACK:
+                break
+        if score > best:
+            best = score
+            best_len = k + 1
+    return best_len
+
+
+def delta(base, firmware):
+    """Encode ``firmware`` as a delta against ``base``."""
+    index = {}
+    for j in range(len(base) - KEY_LEN, -1, -KEY_STRIDE):
+        index[base[j : j + KEY_LEN]] = j
+
+    out = bytearray()
+    pending = 0  # the start of the bytes, that are inserted
+    base_pos = 0  # the end of the last ``COPY`` or ``ADD``
+
+    def emit(op, position, length, data=b""):
+        nonlocal base_pos
+        out.append(op)
+        if op != OP_INSERT:
+            out.extend(svarint(position - base_pos))
+            base_pos = position + length
+        out.extend(varint(length))
+        out.extend(data)
+
+    i = 0
+    while i + KEY_LEN <= len(firmware):
+        key = firmware[i : i + KEY_LEN]
+        # Prefer to continue the previous match
+        expected = base_pos + (i - pending)
+        if base[expected : expected + KEY_LEN] == key:
+            j = expected
+        else:
+            j = index.get(key)
+            if j is None:
+                i += 1
+                continue
+
+        while i > pending and j > 0 and firmware[i - 1] == base[j - 1]:
+            i -= 1
+            j -= 1
+        exact = match_len(firmware, i, base, j)
+        approx = approx_len(firmware, i + exact, base, j + exact)
+
+        if i > pending:
+            emit(OP_INSERT, 0, i - pending, firmware[pending:i])
+        emit(OP_COPY, j, exact)
+        if approx > 0:
+            start = i + exact
+            diff = bytes(
+                (firmware[start + k] - base[j + exact + k]) & 0xFF
+                for k in range(approx)
+            )
+            emit(OP_ADD, j + exact, approx, diff)
+        i += exact + approx
+        pending = i
+
+    if pending < len(firmware):
+        emit(OP_INSERT, 0, len(firmware) - pending, firmware[pending:])
+    return bytes(out)
+
+
+def pack(firmware_file, output, base_file, compressed):
+    """Pack ``firmware_file`` into the payload ``output``."""
+    with open(firmware_file, "rb") as f_in:
+        firmware = f_in.read()
+    if not firmware:
+        raise RuntimeError("Empty firmware '{}'!".format(firmware_file))
+
+    flags = 0
+    base = b""
+    stream = firmware
+    if base_file is not None:
+        with open(base_file, "rb") as f_in:
+            base = f_in.read()
+        if not base:
+            raise RuntimeError("Empty base '{}'!".format(base_file))
+        flags |= FLAG_DELTA
+        stream = delta(base, firmware)
+
+    payload = stream
+    if compressed:
+        payload = compress(stream)
+        if len(payload) < len(stream):
+            flags |= FLAG_COMPRESSED
+        else:
+            payload = stream
+
+    header = struct.pack(
+        PAYLOAD_HEADER_FORMAT,
+        PAYLOAD_MAGIC,
+        PAYLOAD_VERSION,
+        flags,
+        WINDOW_BITS,
+        LOOKAHEAD_BITS,
+        len(firmware),
+        len(stream),
+        len(base),
+        hashlib.sha256(base).digest() if base else bytes(32),
+    )
+    with open(output, "wb") as f_out:
+        f_out.write(header)
+        f_out.write(payload)
+
+    print(
+        "Packed '{}' ({} bytes{}{}) into {} bytes, SHA-256 {}".format(
+            firmware_file,
+            len(firmware),
+            ", delta" if flags & FLAG_DELTA else "",
+            ", compressed" if flags & FLAG_COMPRESSED else "",
+            len(header) + len(payload),
+            hashlib.sha256(firmware).hexdigest(),
+        )
+    )
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("firmware", help="the firmware")
+    parser.add_argument("output", help="the payload")
+    parser.add_argument(
+        "--base", metavar="BASE", help="generate a delta against the firmware BASE"
+    )
+    parser.add_argument(
+        "--no-compress",
+        dest="compressed",
+        action="store_false",
+        help="do not compress the payload",
+    )
+    args = parser.parse_args()
+
+    try:
+        pack(args.firmware, args.output, args.base, args.compressed)
+    except (OSError, RuntimeError) as error:
+        print("Could not pack firmware: {}".format(error))
+        sys.exit(1)
+
+    # return "0" = SUCCESS
+    sys.exit(0)